@@ -5,6 +5,7 @@
 
 #include "lmgl/assets/model_loader.hpp"
 #include "lmgl/core/engine.hpp"
+#include "lmgl/renderer/program_cache.hpp"
 #include "lmgl/renderer/renderer.hpp"
 #include "lmgl/renderer/shader.hpp"
 #include "lmgl/scene/camera.hpp"
@@ -150,7 +151,7 @@ int main() {
   }
 
   // Load PBR shader
-  auto pbr_shader = renderer::Shader::from_glsl_file("shaders/pbr.glsl");
+  auto pbr_shader = renderer::Shader::from_glsl_file_with_variants("shaders/pbr.glsl");
 
   // Create scene
   auto scene = std::make_shared<scene::Scene>("PBR Demo Scene");
@@ -191,6 +192,7 @@ int main() {
   ground_node->set_mesh(ground);
   ground_node->set_rotation(glm::vec3(-90.0f, 0.0f, 0.0f));
   ground_node->set_position(glm::vec3(0.0f, -5.0f, 0.0f));
+  ground_node->set_static(true);
   scene->get_root()->add_child(ground_node);
 
   auto options = assets::ModelLoadOptions();
@@ -211,6 +213,7 @@ int main() {
   auto sun = scene::Light::create_directional(glm::vec3(0.5f, -1.0f, -0.3f),
                                               glm::vec3(1.0f, 0.95f, 0.9f));
   sun->set_intensity(3.0f);
+  sun->set_casts_shadows(true);
   scene->add_light(sun);
 
   // Fill light (soft ambient from opposite direction)
@@ -223,6 +226,7 @@ int main() {
   auto point_light = scene::Light::create_point(
       glm::vec3(3.0f, 3.0f, 3.0f), 15.0f, glm::vec3(1.0f, 0.7f, 0.4f));
   point_light->set_intensity(15.0f);
+  point_light->set_casts_shadows(true);
   scene->add_light(point_light);
 
   // Animation state
@@ -238,6 +242,13 @@ int main() {
   scene->set_shadows_enabled(true);
   scene->set_shadow_resolution(4096);
 
+  // Shader startup cost, the second run loads the programs from .lmgl_cache
+  const auto &program_stats = renderer::ProgramCache::get_stats();
+  std::cout << "Shaders: " << program_stats.misses << " compiled in "
+            << program_stats.compile_ms << " ms, " << program_stats.hits
+            << " loaded from cache in " << program_stats.load_ms << " ms"
+            << std::endl;
+
   // Camera movement - free camera setup
   glm::vec3 camera_pos = camera->get_position();
   float camera_yaw = -90.0f;
@@ -406,7 +417,7 @@ int main() {
     engine.clear(0.05f, 0.05f, 0.1f);
 
     // Setup shadows automatically
-    renderer->setup_shadows(scene, pbr_shader, enable_point_shadows, enable_directional_shadows);
+    renderer->setup_shadows(scene, pbr_shader, camera, enable_point_shadows, enable_directional_shadows);
 
     // Render scene with frustum culling (automatic)
     scene->update();
@@ -427,6 +438,14 @@ int main() {
           "LMGL Sandbox | Draw Calls: " +
           std::to_string(renderer->get_draw_calls()) +
           " | Tris: " + std::to_string(renderer->get_triangles_count());
+      const auto &shadows = renderer->get_shadow_renderer();
+      title += " | Shadow Casters: " +
+               std::to_string(shadows.get_directional_stats().casters) +
+               " dir, " + std::to_string(shadows.get_atlas_stats().casters) +
+               " atlas, " +
+               std::to_string(shadows.get_directional_stats().cached +
+                              shadows.get_atlas_stats().cached) +
+               " cached";
       engine.set_title(title);
       title_timer = 0.0f;
     }
@@ -0,0 +1,148 @@
+/*!
+ * @file gltf_loader.hpp
+ * @brief Fast path for binary glTF 2.0 (GLB) models.
+ *
+ * This header provides the GLTFLoader class, which reads GLB files without Assimp: the
+ * file is memory mapped, accessors are read where they lie and vertex attributes whose
+ * layout the GPU can read as stored are uploaded straight from the mapping. ModelLoader
+ * uses it for .glb files and falls back to Assimp for files it does not handle.
+ *
+ * \copyright{Copyright (c) 2026 Luca Mazza. All rights reserved.}
+ * \license{This project is released under the MIT License.}
+ */
+
+#pragma once
+
+#include "lmgl/assets/model_loader.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace lmgl {
+
+namespace assets {
+
+/*!
+ * @brief Loads GLB models without going through Assimp and scene::Vertex.
+ *
+ * Every primitive gets one vertex buffer per attribute. Float attributes, and the integer
+ * ones of KHR_mesh_quantization that map to a vertex format, are uploaded from the mapped
+ * file as they are; the others are converted to floats first. Index buffers are uploaded
+ * in place too, except 8-bit ones. Missing normals, and tangents of normal-mapped
+ * primitives when options.compute_tangents is set, are generated. Embedded images are
+ * decoded from the file and added to TextureLibrary under "<file>#image<index>".
+ *
+ * Meshes keep their indices but no CPU vertices, as with scene::Mesh::create(). The file
+ * order of vertices and triangles is kept (optimize_meshes and optimize_vertex_order do
+ * not apply) and the model cache is not used, since reading a GLB is as fast as reading
+ * the cache.
+ *
+ * Files the fast path cannot serve make parse() fail: glTF files with separate buffers,
+ * compression extensions (Draco, meshopt), sparse accessors, primitives other than
+ * triangle lists, and the options that need interleaved scene::Vertex data
+ * (pack_vertices, geometry_pool) or flipped UVs (flip_uvs off).
+ */
+class GLTFLoader {
+  public:
+    //! @brief A parsed GLB file, ready to be built on the render thread.
+    struct Model;
+
+    /*!
+     * @brief Check if a file should go through the fast path.
+     *
+     * @param fpath The file path to the model.
+     * @return True for .glb files, by extension.
+     */
+    static bool is_glb(const std::string &fpath);
+
+    /*!
+     * @brief Load a GLB model.
+     *
+     * @param fpath The file path to the model.
+     * @param shader A shared pointer to the shader to be used for rendering the model.
+     * @param options Options for loading the model.
+     * @return The root node of the model, nullptr if the file cannot take the fast path.
+     */
+    static std::shared_ptr<scene::Node> load(const std::string &fpath, std::shared_ptr<renderer::Shader> shader,
+                                             const ModelLoadOptions &options);
+
+    /*!
+     * @brief Reads a GLB file and does all the CPU work of loading it.
+     *
+     * Maps the file, validates the accessors, converts the attributes that cannot be
+     * uploaded as stored and decodes the embedded images. Touches no OpenGL state.
+     *
+     * @param fpath The file path to the model.
+     * @param options Options for loading the model.
+     * @return The parsed model, nullptr if the file cannot take the fast path.
+     */
+    static std::shared_ptr<Model> parse(const std::string &fpath, const ModelLoadOptions &options);
+
+    /*!
+     * @brief Getter for the number of uploads of a parsed model.
+     *
+     * Shared buffer views come first, then the images used by materials, then one upload
+     * per primitive the scene graph refers to.
+     *
+     * @param model The parsed model.
+     * @return Number of build_step() calls build() makes.
+     */
+    static std::size_t get_step_count(const Model &model);
+
+    /*!
+     * @brief Bytes uploaded by a step, for budgeting the upload.
+     *
+     * @param model The parsed model.
+     * @param step Index of the step.
+     * @return Size of the buffer view, image or primitive data uploaded by the step.
+     */
+    static std::size_t get_upload_size(const Model &model, std::size_t step);
+
+    /*!
+     * @brief Runs one upload of a parsed model, steps being run in order.
+     *
+     * Render thread only.
+     *
+     * @param model The parsed model.
+     * @param step Index of the step.
+     * @param shader A shared pointer to the shader to be used for rendering the model.
+     * @param options Options for loading the model, the ones passed to parse().
+     */
+    static void build_step(Model &model, std::size_t step, std::shared_ptr<renderer::Shader> shader,
+                           const ModelLoadOptions &options);
+
+    /*!
+     * @brief Builds the scene graph once every step is run, and frees the model.
+     *
+     * @param model The parsed model.
+     * @param options Options for loading the model, the ones passed to parse().
+     * @return The root node of the model.
+     */
+    static std::shared_ptr<scene::Node> assemble(Model &model, const ModelLoadOptions &options);
+
+    /*!
+     * @brief Uploads a parsed model and builds its scene graph.
+     *
+     * Render thread only. The model can be discarded afterwards, the meshes do not refer to it.
+     *
+     * @param model The parsed model.
+     * @param shader A shared pointer to the shader to be used for rendering the model.
+     * @param options Options for loading the model, the ones passed to parse().
+     * @return The root node of the model.
+     */
+    static std::shared_ptr<scene::Node> build(Model &model, std::shared_ptr<renderer::Shader> shader,
+                                              const ModelLoadOptions &options);
+
+    /*!
+     * @brief Bytes build() uploads, the sum of the sizes of every step.
+     *
+     * @param model The parsed model.
+     * @return Size of the vertex, index and image data.
+     */
+    static std::size_t get_upload_size(const Model &model);
+};
+
+} // namespace assets
+
+} // namespace lmgl
@@ -0,0 +1,97 @@
+/*!
+ * @file mapped_file.hpp
+ * @brief Read-only memory mapping of files.
+ *
+ * This header defines the MappedFile class, which maps a whole file into memory so
+ * that binary assets can be read in place, without copying them through a stream.
+ *
+ * \copyright{Copyright (c) 2026 Luca Mazza. All rights reserved.}
+ * \license{This project is released under the MIT License.}
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace lmgl {
+
+namespace assets {
+
+/*!
+ * @brief Read-only view of a whole file, memory mapped where the platform allows it.
+ *
+ * On POSIX systems the file is mapped with mmap, elsewhere it is read into memory.
+ * The mapping is released when the object is destroyed or another file is opened.
+ */
+class MappedFile {
+  public:
+    //! @brief Creates an empty mapping.
+    MappedFile() = default;
+
+    /*!
+     * @brief Maps a file.
+     *
+     * @param fpath Path of the file to map.
+     */
+    explicit MappedFile(const std::string &fpath);
+
+    //! @brief Releases the mapping.
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    /*!
+     * @brief Maps a file, releasing the current mapping first.
+     *
+     * @param fpath Path of the file to map.
+     * @return True if the file was mapped, false if it could not be opened. Empty files map to no data.
+     */
+    bool open(const std::string &fpath);
+
+    //! @brief Releases the mapping.
+    void close();
+
+    /*!
+     * @brief Check if a file is open.
+     *
+     * @return True if open() succeeded and close() was not called since.
+     */
+    inline bool is_open() const { return m_open; }
+
+    /*!
+     * @brief Getter for the file contents.
+     *
+     * @return Pointer to the first byte, nullptr when nothing is mapped.
+     */
+    inline const unsigned char *data() const { return m_data; }
+
+    /*!
+     * @brief Getter for the file size.
+     *
+     * @return Size of the mapped file in bytes.
+     */
+    inline std::size_t size() const { return m_size; }
+
+  private:
+    //! @brief First byte of the mapping.
+    const unsigned char *m_data = nullptr;
+
+    //! @brief Size of the mapping in bytes.
+    std::size_t m_size = 0;
+
+    //! @brief Whether a file is open.
+    bool m_open = false;
+
+    //! @brief Whether m_data comes from mmap and must be unmapped.
+    bool m_mapped = false;
+
+    //! @brief File contents on platforms without mmap.
+    std::vector<unsigned char> m_buffer;
+};
+
+} // namespace assets
+
+} // namespace lmgl
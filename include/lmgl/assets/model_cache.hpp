@@ -0,0 +1,176 @@
+/*!
+ * @file model_cache.hpp
+ * @brief Binary cache of imported models.
+ *
+ * This header defines ModelData, the processed, GPU-ready form of a model that the
+ * ModelLoader builds its scene graph from, and ModelCache, which stores it in a
+ * versioned binary file. Later loads map the file and skip Assimp entirely, reading the
+ * geometry in place from the mapping.
+ *
+ * \copyright{Copyright (c) 2026 Luca Mazza. All rights reserved.}
+ * \license{This project is released under the MIT License.}
+ */
+
+#pragma once
+
+#include "lmgl/scene/vertex.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace lmgl {
+
+namespace assets {
+
+class MappedFile;
+
+/*!
+ * @brief Material parameters and texture references of an imported mesh.
+ */
+struct MaterialData {
+    std::string name;                     //!< Material name
+    glm::vec3 albedo = glm::vec3(1.0f);   //!< Albedo color
+    float metallic = 0.0f;                //!< Metallic factor
+    float roughness = 0.5f;               //!< Roughness factor
+    glm::vec3 emissive = glm::vec3(0.0f); //!< Emissive color
+    std::string albedo_map;               //!< Path of the albedo texture, empty if none
+    std::string normal_map;               //!< Path of the normal map, empty if none
+    std::string metallic_map;             //!< Path of the metallic texture, empty if none
+    std::string roughness_map;            //!< Path of the roughness texture, empty if none
+    std::string ao_map;                   //!< Path of the ambient occlusion texture, empty if none
+    std::string emissive_map;             //!< Path of the emissive texture, empty if none
+};
+
+/*!
+ * @brief Geometry of an imported mesh, after optimization.
+ *
+ * An imported mesh owns its vertices and indices. A mesh read from a cache file points into
+ * the mapping held by its ModelData instead, and its vectors stay empty.
+ */
+struct MeshData {
+    std::string name;                              //!< Mesh name
+    std::vector<scene::Vertex> vertices;           //!< Vertices in upload order
+    std::vector<unsigned int> indices;             //!< Triangle list indices
+    const scene::Vertex *mapped_vertices = nullptr; //!< Vertices in the cache mapping, used instead of vertices
+    const unsigned int *mapped_indices = nullptr;   //!< Indices in the cache mapping, used instead of indices
+    std::size_t mapped_vertex_count = 0;            //!< Number of mapped vertices
+    std::size_t mapped_index_count = 0;             //!< Number of mapped indices
+    bool has_material = false;                     //!< Whether material is meaningful
+    MaterialData material;                         //!< Material of the mesh
+    uint32_t material_index = 0;                   //!< Index of the material in the source, shared by meshes using it
+
+    //! @brief First vertex, owned or mapped.
+    inline const scene::Vertex *get_vertices() const { return mapped_vertices ? mapped_vertices : vertices.data(); }
+
+    //! @brief Number of vertices, owned or mapped.
+    inline std::size_t get_vertex_count() const { return mapped_vertices ? mapped_vertex_count : vertices.size(); }
+
+    //! @brief First index, owned or mapped.
+    inline const unsigned int *get_indices() const { return mapped_indices ? mapped_indices : indices.data(); }
+
+    //! @brief Number of indices, owned or mapped.
+    inline std::size_t get_index_count() const { return mapped_indices ? mapped_index_count : indices.size(); }
+};
+
+/*!
+ * @brief A node of the imported hierarchy.
+ */
+struct NodeData {
+    std::string name;                 //!< Node name
+    std::vector<unsigned int> meshes; //!< Indices into ModelData::meshes
+    std::vector<NodeData> children;   //!< Child nodes
+};
+
+/*!
+ * @brief A processed model: meshes and the node hierarchy referencing them.
+ */
+struct ModelData {
+    std::vector<MeshData> meshes;              //!< Meshes of the model
+    NodeData root;                             //!< Root of the hierarchy
+    std::shared_ptr<const MappedFile> mapping; //!< Cache file the mapped meshes point into, null when imported
+};
+
+/*!
+ * @brief Identifies the source a cache file was built from.
+ */
+struct ModelCacheKey {
+    uint64_t source_time = 0;  //!< Last write time of the source file
+    uint64_t source_size = 0;  //!< Size of the source file in bytes
+    uint64_t options_hash = 0; //!< Hash of the import options that change the processed data
+};
+
+/*!
+ * @brief Reads and writes ModelData as a versioned binary file.
+ *
+ * The file starts with a header holding a magic number, the format version, the size of
+ * scene::Vertex, the ModelCacheKey and a checksum of the payload. Reading maps the file and
+ * rejects it when any of these do not match, or when the payload is truncated, so callers
+ * can fall back to importing the source again. Vertex and index arrays are aligned to 16
+ * bytes in the file, so that meshes read them from the mapping without a copy.
+ */
+class ModelCache {
+  public:
+    //! @brief Version of the file format, bump it whenever the layout changes.
+    static constexpr uint32_t VERSION = 3;
+
+    /*!
+     * @brief Get the cache file used for a source file.
+     *
+     * @param source_path Path of the source model.
+     * @param cache_directory Directory holding the cache files.
+     * @return Path inside cache_directory, named after a hash of the source path.
+     */
+    static std::string get_cache_path(const std::string &source_path, const std::string &cache_directory);
+
+    /*!
+     * @brief Builds the key of a source file.
+     *
+     * @param source_path Path of the source model.
+     * @param options_hash Hash of the import options.
+     * @param key Filled with the file time and size.
+     * @return False if the source file does not exist.
+     */
+    static bool make_key(const std::string &source_path, uint64_t options_hash, ModelCacheKey &key);
+
+    /*!
+     * @brief Writes a model to a cache file.
+     *
+     * The file is written next to its final path and renamed, so readers never see a
+     * partial file. Missing directories are created.
+     *
+     * @param cache_path Path of the cache file.
+     * @param key Key of the source.
+     * @param model Model to store.
+     * @return True on success.
+     */
+    static bool write(const std::string &cache_path, const ModelCacheKey &key, const ModelData &model);
+
+    /*!
+     * @brief Reads a model from a cache file.
+     *
+     * @param cache_path Path of the cache file.
+     * @param key Expected key, the file is rejected when it differs.
+     * @param model Filled with the cached model on success, its meshes pointing into the mapping it holds.
+     * @return True if the file exists, matches the key and is intact.
+     */
+    static bool read(const std::string &cache_path, const ModelCacheKey &key, ModelData &model);
+
+    /*!
+     * @brief 64-bit FNV-1a hash.
+     *
+     * @param data First byte to hash.
+     * @param size Number of bytes.
+     * @param seed Hash to continue from (default is the FNV offset basis).
+     * @return Hash of the bytes.
+     */
+    static uint64_t hash(const void *data, std::size_t size, uint64_t seed = 14695981039346656037ull);
+};
+
+} // namespace assets
+
+} // namespace lmgl
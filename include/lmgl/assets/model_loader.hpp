@@ -11,15 +11,27 @@
 
 #pragma once
 
+#include "lmgl/assets/model_cache.hpp"
+#include "lmgl/core/resource_cache.hpp"
 #include "lmgl/renderer/shader.hpp"
 #include "lmgl/renderer/texture.hpp"
 #include "lmgl/scene/mesh.hpp"
 #include "lmgl/scene/node.hpp"
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+namespace Assimp {
+class Importer; //!< Forward declaration for the Assimp importer
+} // namespace Assimp
+
 struct aiScene;    //!< Forward declarations for Assimp Scene structure
 struct aiNode;     //!< Forward declarations for Assimp Node structure
 struct aiMesh;     //!< Forward declarations for Assimp Mesh structure
@@ -48,6 +60,106 @@ struct ModelLoadOptions {
     bool optimize_meshes = true;  //!< Whether to optimize meshes for better performance
     bool triangulate = true;      //!< Whether to triangulate meshes (convert polygons to triangles)
     float scale = 1.0f;           //!< Scale factor to apply to the model
+    bool pack_vertices = false;   //!< Whether to upload vertices as scene::PackedVertex (28 instead of 72 bytes)
+    bool depth_stream = false;    //!< Whether to build a position-only stream for shadow and depth passes
+    bool optimize_vertex_order = true; //!< Whether to reorder triangles and vertices with scene::MeshOptimizer
+
+    //! What meshes keep of their geometry in CPU memory after upload (picking BVHs are built before dropping it).
+    scene::GeometryResidency residency = scene::GeometryResidency::Keep;
+
+    //! Whether to read and write the binary model cache, so that later loads skip Assimp.
+    bool use_cache = true;
+    //! Directory of the model cache files.
+    std::string cache_directory = ".lmgl_cache";
+
+    //! OBJ and PLY files of at least this many bytes are read by ScanLoader, in parallel, instead of Assimp.
+    //! Off by default: ScanLoader generates no tangents and only reads the Kd, Ke and map_Kd material entries.
+    std::size_t scan_threshold = std::numeric_limits<std::size_t>::max();
+    //! Triangles per spatial part of the scans read by ScanLoader (0 keeps a single mesh per material).
+    unsigned int scan_part_triangles = 0;
+
+    //! Pool to sub-allocate mesh geometry from (nullptr gives every mesh its own buffers).
+    //! Must be created with scene::Mesh::get_vertex_layout(), or get_packed_vertex_layout() when packing.
+    std::shared_ptr<renderer::GeometryPool> geometry_pool = nullptr;
+};
+
+/*!
+ * @brief Handle to a model loading in the background.
+ *
+ * Returned by ModelLoader::load_async. The state and progress can be polled from any
+ * thread, the node is only handed out on the render thread, once the load is Ready.
+ */
+class ModelLoadHandle {
+  public:
+    //! @brief Stages of an asynchronous load.
+    enum class State {
+        Loading, //!< Still importing, decoding or uploading
+        Ready,   //!< Finished, the node is available
+        Failed   //!< The model could not be loaded
+    };
+
+    /*!
+     * @brief Creates a handle for a load that has not started yet.
+     *
+     * @param fpath The file path of the model.
+     */
+    explicit ModelLoadHandle(const std::string &fpath) : m_path(fpath) {}
+
+    /*!
+     * @brief Getter for the state of the load.
+     *
+     * @return Current state.
+     */
+    inline State get_state() const { return m_state.load(std::memory_order_acquire); }
+
+    /*!
+     * @brief Check if the load is over.
+     *
+     * @return True once the load is Ready or Failed.
+     */
+    inline bool is_done() const { return get_state() != State::Loading; }
+
+    /*!
+     * @brief Getter for the loaded model.
+     *
+     * @return The root node of the model, nullptr until the load is Ready.
+     */
+    inline std::shared_ptr<scene::Node> get_node() const { return is_done() ? m_node : nullptr; }
+
+    /*!
+     * @brief Getter for the progress of the load.
+     *
+     * Counts finished tasks against the tasks known so far, so it can step back when a
+     * stage schedules new work.
+     *
+     * @return Progress between 0 and 1.
+     */
+    float get_progress() const;
+
+    /*!
+     * @brief Getter for the file path of the model.
+     *
+     * @return The file path passed to ModelLoader::load_async.
+     */
+    inline const std::string &get_path() const { return m_path; }
+
+  private:
+    friend class ModelLoader;
+
+    //! @brief File path of the model.
+    std::string m_path;
+
+    //! @brief Current state, published after m_node is set.
+    std::atomic<State> m_state{State::Loading};
+
+    //! @brief Loaded model, written on the render thread before the state becomes Ready.
+    std::shared_ptr<scene::Node> m_node;
+
+    //! @brief Number of tasks scheduled so far.
+    std::atomic<unsigned int> m_total{0};
+
+    //! @brief Number of tasks finished.
+    std::atomic<unsigned int> m_completed{0};
 };
 
 /*!
@@ -64,7 +176,11 @@ class ModelLoader {
      *
      * This function loads a 3D model from the specified file path using the Assimp library.
      * It processes the model's meshes, materials, and textures, and constructs a scene graph
-     * representation of the model.
+     * representation of the model. With options.use_cache, the processed model is stored in
+     * the binary model cache and later loads read it from there, falling back to Assimp when
+     * the source file or the import options changed, or the cache file is damaged.
+     * GLB files are read by GLTFLoader instead, unless they need a feature it lacks, and
+     * OBJ and PLY files of at least options.scan_threshold bytes by ScanLoader.
      *
      * @param fpath The file path to the 3D model.
      * @param shader A shared pointer to the shader to be used for rendering the model.
@@ -74,50 +190,234 @@ class ModelLoader {
     static std::shared_ptr<scene::Node> load(const std::string &fpath, std::shared_ptr<renderer::Shader> shader,
                                              const ModelLoadOptions &options);
 
+    /*!
+     * @brief Load a 3D model in the background.
+     *
+     * Returns immediately. The file is imported (or read from the model cache) on a
+     * core::ThreadPool worker, then every mesh is converted and optimized in a task of
+     * its own and the textures it references are decoded in parallel. The OpenGL
+     * uploads, one per texture and per mesh, are queued on UploadQueue, which the render
+     * thread drains under a per-frame budget, and the last one assembles the scene graph.
+     * GLB files that GLTFLoader handles are parsed on a worker and uploaded one buffer view,
+     * image and primitive at a time;
+     * scans that ScanLoader handles are parsed in parallel and uploaded one part at a time.
+     *
+     * Must be called from the render thread, which has to keep calling
+     * UploadQueue::process() (core::Engine::run does) for the load to complete.
+     *
+     * @param fpath The file path to the 3D model.
+     * @param shader A shared pointer to the shader to be used for rendering the model.
+     * @param options Options for loading the model, copied.
+     * @return Handle to poll for the loaded model.
+     */
+    static std::shared_ptr<ModelLoadHandle> load_async(const std::string &fpath,
+                                                       std::shared_ptr<renderer::Shader> shader,
+                                                       const ModelLoadOptions &options);
+
+    /*!
+     * @brief Place an instance of a model, importing it only the first time.
+     *
+     * The first call loads the model like load() and keeps its scene graph as a prefab;
+     * every call returns a clone of the prefab (see scene::Node::clone), sharing its
+     * meshes and materials. Placing many copies of a model thus costs one node per node
+     * of the model and per copy, with a single import and a single set of GPU buffers.
+     * Prefabs are keyed by file, shader and options.
+     *
+     * @param fpath The file path to the 3D model.
+     * @param shader A shared pointer to the shader to be used for rendering the model.
+     * @param options Options for loading the model.
+     * @return A shared pointer to the root node of the new instance, nullptr if loading failed.
+     */
+    static std::shared_ptr<scene::Node> instantiate(const std::string &fpath, std::shared_ptr<renderer::Shader> shader,
+                                                    const ModelLoadOptions &options);
+
+    /*!
+     * @brief Drop every prefab kept by instantiate().
+     *
+     * Placed instances keep their meshes, the next instantiate() imports again.
+     */
+    static void clear_prefabs();
+
+    /*!
+     * @brief Get the prefab cache counters.
+     *
+     * Hits count instantiate() calls served by a prefab, misses the ones that loaded the model.
+     *
+     * @return Hits, misses and evictions.
+     */
+    static const core::CacheStats &get_prefab_stats();
+
+    /*!
+     * @brief Hash of the options that change the imported data.
+     *
+     * Used to key the model cache: options applied after import (scale, packing, pools,
+     * depth streams, residency) do not invalidate cached files.
+     *
+     * @param options Options for loading the model.
+     * @return Hash of the import options.
+     */
+    static uint64_t get_options_hash(const ModelLoadOptions &options);
+
   private:
+    //! @brief Shared state of an asynchronous load, passed between its tasks.
+    struct AsyncLoad;
+
+    //! @brief Materials built for a model, by index in the source file.
+    using MaterialMap = std::unordered_map<uint32_t, std::shared_ptr<scene::Material>>;
+
+    //! @brief Textures uploaded for a model, by file path.
+    using TextureMap = std::unordered_map<std::string, std::shared_ptr<renderer::Texture>>;
+
+    //! @brief Scene graphs handed out by instantiate(), by prefab key.
+    static core::ResourceCache<scene::Node> s_prefabs;
+
+    /*!
+     * @brief Key of the prefab of a model.
+     *
+     * @param fpath The file path to the 3D model.
+     * @param shader The shader of the model.
+     * @param options Options for loading the model.
+     * @return Key covering every input that changes the built scene graph.
+     */
+    static std::string get_prefab_key(const std::string &fpath, const std::shared_ptr<renderer::Shader> &shader,
+                                      const ModelLoadOptions &options);
+
+    /*!
+     * @brief Runs a step of an asynchronous load on the core::ThreadPool.
+     *
+     * The load fails if the step throws.
+     *
+     * @param load The load the step belongs to.
+     * @param step The work to run.
+     */
+    static void spawn(const std::shared_ptr<AsyncLoad> &load, std::function<void()> step);
+
+    /*!
+     * @brief Queues a step of an asynchronous load on the UploadQueue.
+     *
+     * The load fails if the step throws, and the steps queued after a failure are skipped.
+     *
+     * @param load The load the step belongs to.
+     * @param step The work to run on the render thread.
+     * @param bytes Bytes the step uploads, counted against the per-frame budget.
+     */
+    static void upload(const std::shared_ptr<AsyncLoad> &load, std::function<void()> step, std::size_t bytes = 0);
+
+    /*!
+     * @brief First task of an asynchronous load: reads the cache or the file, then fans out.
+     *
+     * @param load The load to run.
+     */
+    static void start_async(const std::shared_ptr<AsyncLoad> &load);
+
+    /*!
+     * @brief Decodes the textures of an asynchronous load in parallel.
+     *
+     * Runs once every mesh is processed.
+     *
+     * @param load The load to continue.
+     */
+    static void decode_textures(const std::shared_ptr<AsyncLoad> &load);
+
+    /*!
+     * @brief Queues the uploads of an asynchronous load on the render thread.
+     *
+     * Runs once every texture is decoded.
+     *
+     * @param load The load to continue.
+     */
+    static void queue_uploads(const std::shared_ptr<AsyncLoad> &load);
+
+    /*!
+     * @brief Read a model file with Assimp.
+     *
+     * @param importer The importer owning the returned scene.
+     * @param fpath The file path to the 3D model.
+     * @param options Options for loading the model.
+     * @return The imported scene, nullptr if Assimp failed to load the file.
+     */
+    static const aiScene *read_scene(Assimp::Importer &importer, const std::string &fpath,
+                                     const ModelLoadOptions &options);
+
+    /*!
+     * @brief Import a model file with Assimp.
+     *
+     * @param fpath The file path to the 3D model.
+     * @param options Options for loading the model.
+     * @param model Filled with the processed meshes and hierarchy.
+     * @return True on success, false if Assimp failed to load the file.
+     */
+    static bool import(const std::string &fpath, const ModelLoadOptions &options, ModelData &model);
+
     /*!
      * @brief Process an Assimp node and its children.
      *
-     * This function processes an Assimp node, converting it into a scene graph node.
-     * It recursively processes all child nodes and their meshes.
+     * This function records the meshes referenced by an Assimp node and recursively
+     * processes all its child nodes.
      *
      * @param ai_node The Assimp node to process.
-     * @param ai_scene The Assimp scene containing the node.
-     * @param dir The directory of the model file, used for loading textures.
-     * @param shader A shared pointer to the shader to be used for rendering the model.
-     * @return A shared pointer to the processed scene graph node.
+     * @param node The node data to fill.
      */
-    static std::shared_ptr<scene::Node> process_node(aiNode *ai_node, const aiScene *ai_scene, const std::string &dir,
-                                                     std::shared_ptr<renderer::Shader> shader);
+    static void process_node(aiNode *ai_node, NodeData &node);
 
     /*!
-     * @brief Process an Assimp mesh and convert it to a Mesh object.
+     * @brief Process an Assimp mesh.
      *
-     * This function processes an Assimp mesh, extracting its vertices, indices,
-     * and material information, and converts it into a Mesh object.
+     * This function extracts the vertices, indices and material information of an
+     * Assimp mesh, and optimizes the vertex order when requested.
      *
      * @param ai_mesh The Assimp mesh to process.
      * @param ai_scene The Assimp scene containing the mesh.
-     * @param dir The directory of the model file, used for loading textures.
-     * @param shader A shared pointer to the shader to be used for rendering the mesh.
-     * @return A shared pointer to the processed Mesh object.
+     * @param dir The directory of the model file, used for resolving textures.
+     * @param options Options for loading the model.
+     * @return The processed mesh data.
+     */
+    static MeshData process_mesh(aiMesh *ai_mesh, const aiScene *ai_scene, const std::string &dir,
+                                 const ModelLoadOptions &options);
+
+    /*!
+     * @brief Find the first existing texture of a type in an Assimp material.
+     *
+     * @param ai_material The Assimp material to look into.
+     * @param type The type of texture to find (e.g., diffuse, specular).
+     * @param dir The directory of the model file, used for resolving textures.
+     * @return The texture path, or an empty string if there is none.
      */
-    static std::shared_ptr<scene::Mesh> process_mesh(aiMesh *ai_mesh, const aiScene *ai_scene, const std::string &dir,
-                                                     std::shared_ptr<renderer::Shader> shader);
+    static std::string find_material_texture(aiMaterial *ai_material, unsigned int type, const std::string &dir);
 
     /*!
-     * @brief Load textures from an Assimp material.
+     * @brief Build a scene graph node and its children from node data.
      *
-     * This function loads textures of a specified type from an Assimp material.
-     * It retrieves the texture file paths and loads the textures into Texture objects.
+     * @param node_data The node to build.
+     * @param model The model the node belongs to, its mesh data is moved into the meshes.
+     * @param meshes Meshes built so far, indexed like model.meshes, so that shared meshes are built once.
+     * @param materials Materials built so far, so that meshes sharing a material share one object.
+     * @param shader A shared pointer to the shader to be used for rendering the model.
+     * @param options Options for loading the model.
+     * @param textures Textures already uploaded for the model, nullptr to load them from the TextureLibrary.
+     * @return A shared pointer to the built scene graph node.
+     */
+    static std::shared_ptr<scene::Node> build_node(const NodeData &node_data, ModelData &model,
+                                                   std::vector<std::shared_ptr<scene::Mesh>> &meshes,
+                                                   MaterialMap &materials, std::shared_ptr<renderer::Shader> shader,
+                                                   const ModelLoadOptions &options,
+                                                   const TextureMap *textures = nullptr);
+
+    /*!
+     * @brief Build a mesh, with its material, from mesh data.
      *
-     * @param ai_material The Assimp material to load textures from.
-     * @param type The type of texture to load (e.g., diffuse, specular).
-     * @param dir The directory of the model file, used for loading textures.
-     * @return A vector of shared pointers to the loaded Texture objects.
+     * @param data The mesh data, its vectors are moved into the mesh.
+     * @param materials Materials built so far, the mesh reuses the one of its material index.
+     * @param shader A shared pointer to the shader to be used for rendering the mesh.
+     * @param options Options for loading the model.
+     * @param textures Textures already uploaded for the model, nullptr to load them from the TextureLibrary.
+     * @return A shared pointer to the built Mesh object.
      */
-    static std::vector<std::shared_ptr<renderer::Texture>>
-    load_material_textures(aiMaterial *ai_material, unsigned int type, const std::string &dir);
+    static std::shared_ptr<scene::Mesh> build_mesh(MeshData &data, MaterialMap &materials,
+                                                   std::shared_ptr<renderer::Shader> shader,
+                                                   const ModelLoadOptions &options,
+                                                   const TextureMap *textures = nullptr);
+
     /*!
      * @brief Get the directory from a file path.
      *
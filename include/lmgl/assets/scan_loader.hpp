@@ -0,0 +1,141 @@
+/*!
+ * @file scan_loader.hpp
+ * @brief Parallel loader for large OBJ and PLY scans.
+ *
+ * This header provides the ScanLoader class, which reads photogrammetry and scan data
+ * without Assimp: the file is memory mapped, split into line-aligned chunks parsed on the
+ * core::ThreadPool, and the mesh is emitted as spatially split sub-meshes. ModelLoader uses
+ * it for OBJ and PLY files of at least ModelLoadOptions::scan_threshold bytes, which is
+ * opt-in since scans carry no tangents and only colour and emissive materials.
+ *
+ * \copyright{Copyright (c) 2026 Luca Mazza. All rights reserved.}
+ * \license{This project is released under the MIT License.}
+ */
+
+#pragma once
+
+#include "lmgl/assets/model_loader.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace lmgl {
+
+namespace assets {
+
+/*!
+ * @brief Loads OBJ and PLY meshes in parallel, for files too large for Assimp.
+ *
+ * Parsing takes two passes over the chunks: the first counts the elements of each chunk,
+ * the second writes them straight into arrays sized from the counts, so no per-chunk
+ * copies are merged and peak memory stays close to the size of the mesh. Floats are read
+ * with a parser that is exact for up to 19 significant digits and falls back to strtod
+ * beyond.
+ *
+ * OBJ files may use vertex colors ("v x y z r g b"), negative indices, polygons (fan
+ * triangulated) and several materials from their mtllib: Kd, Ke and map_Kd are read.
+ * Corners whose position, UV and normal indices differ are welded into unique vertices.
+ * PLY files may be ASCII, with one element per line, or binary of either byte order, with
+ * positions, normals, colors and UVs per vertex. Missing normals are generated.
+ *
+ * With options.scan_part_triangles set, the triangles of each material are split at the
+ * median of their centroids along the longest axis until each part fits, and every part
+ * becomes a mesh of its own, so that frustum culling skips the parts out of view. Parts
+ * have their vertex order optimized when options.optimize_vertex_order is set. Tangents
+ * are not computed and the model cache is not used.
+ */
+class ScanLoader {
+  public:
+    //! @brief A parsed scan, ready to be uploaded on the render thread.
+    struct Model;
+
+    /*!
+     * @brief Check if ModelLoader should read a file with ScanLoader.
+     *
+     * @param fpath The file path to the model.
+     * @param options Options for loading the model.
+     * @return True for .obj and .ply files of at least options.scan_threshold bytes.
+     */
+    static bool handles(const std::string &fpath, const ModelLoadOptions &options);
+
+    /*!
+     * @brief Load an OBJ or PLY scan.
+     *
+     * @param fpath The file path to the model.
+     * @param shader A shared pointer to the shader to be used for rendering the model.
+     * @param options Options for loading the model.
+     * @return The root node of the model, nullptr if the file could not be read.
+     */
+    static std::shared_ptr<scene::Node> load(const std::string &fpath, std::shared_ptr<renderer::Shader> shader,
+                                             const ModelLoadOptions &options);
+
+    /*!
+     * @brief Reads a scan and does all the CPU work of loading it.
+     *
+     * Parses the file in parallel, generates missing normals, splits the mesh into parts
+     * and decodes the textures of its materials. Touches no OpenGL state; may be called
+     * from a core::ThreadPool task.
+     *
+     * @param fpath The file path to the model.
+     * @param options Options for loading the model.
+     * @return The parsed model, nullptr if the file could not be read.
+     */
+    static std::shared_ptr<Model> parse(const std::string &fpath, const ModelLoadOptions &options);
+
+    /*!
+     * @brief Getter for the number of parts of a parsed scan.
+     *
+     * @param model The parsed model.
+     * @return Number of meshes build() creates.
+     */
+    static std::size_t get_part_count(const Model &model);
+
+    /*!
+     * @brief Bytes uploaded for a part, for budgeting the upload.
+     *
+     * @param model The parsed model.
+     * @param part Index of the part.
+     * @return Size of the vertices and indices of the part.
+     */
+    static std::size_t get_upload_size(const Model &model, std::size_t part);
+
+    /*!
+     * @brief Uploads a part of a parsed scan and frees its CPU data.
+     *
+     * Render thread only.
+     *
+     * @param model The parsed model.
+     * @param part Index of the part.
+     * @param shader A shared pointer to the shader to be used for rendering the model.
+     * @param options Options for loading the model, the ones passed to parse().
+     */
+    static void build_part(Model &model, std::size_t part, std::shared_ptr<renderer::Shader> shader,
+                           const ModelLoadOptions &options);
+
+    /*!
+     * @brief Builds the scene graph once every part is uploaded, and frees the model.
+     *
+     * @param model The parsed model.
+     * @param options Options for loading the model, the ones passed to parse().
+     * @return The root node, holding the single mesh or one child per part.
+     */
+    static std::shared_ptr<scene::Node> assemble(Model &model, const ModelLoadOptions &options);
+
+    /*!
+     * @brief Uploads every part of a parsed scan and builds its scene graph.
+     *
+     * Render thread only.
+     *
+     * @param model The parsed model.
+     * @param shader A shared pointer to the shader to be used for rendering the model.
+     * @param options Options for loading the model, the ones passed to parse().
+     * @return The root node of the model.
+     */
+    static std::shared_ptr<scene::Node> build(Model &model, std::shared_ptr<renderer::Shader> shader,
+                                              const ModelLoadOptions &options);
+};
+
+} // namespace assets
+
+} // namespace lmgl
@@ -13,11 +13,11 @@
 
 #pragma once
 
+#include "lmgl/core/resource_cache.hpp"
 #include "lmgl/renderer/texture.hpp"
 
 #include <memory>
 #include <string>
-#include <unordered_map>
 
 namespace lmgl {
 
@@ -29,7 +29,11 @@ namespace assets {
  * The TextureLibrary class provides methods to load textures from files,
  * check for their existence in the cache, retrieve cached textures, and clear
  * the cache. It uses a singleton pattern to ensure a single instance throughout
- * the application.
+ * the application. It is not thread-safe and is only used from the render thread.
+ *
+ * Textures are measured with all their mip levels. Once the library goes over its
+ * budget, the least recently used textures that no material or caller holds anymore
+ * are released.
  */
 class TextureLibrary {
   public:
@@ -42,7 +46,8 @@ class TextureLibrary {
     /*!
      * @brief Load a texture from a file path
      *
-     * If the texture has already been loaded, it returns the cached version.
+     * If the texture has already been loaded, it returns the cached version. With
+     * streaming enabled, the texture is created by the renderer::TextureStreamer.
      *
      * @param path The file path of the texture
      * @param srgb Whether to load the texture in sRGB color space
@@ -50,6 +55,73 @@ class TextureLibrary {
      */
     std::shared_ptr<renderer::Texture> load(const std::string &fpath);
 
+    /*!
+     * @brief Load a texture from a file path in the background
+     *
+     * Returns immediately with a texture showing a 1x1 white placeholder. The file is
+     * decoded on a core::ThreadPool worker and the image is swapped into the same texture
+     * by an UploadQueue task, so materials holding it need no update. Many textures
+     * requested together decode in parallel, one worker each. If the texture has already
+     * been loaded or requested, it returns the cached version. Never streamed, as the
+     * placeholder is handed out before the image exists.
+     *
+     * @param fpath The file path of the texture
+     * @param flip_vertically Whether to flip the image so that its first row is the bottom one
+     * @return Shared pointer to the texture, a placeholder until its upload runs
+     */
+    std::shared_ptr<renderer::Texture> load_async(const std::string &fpath, bool flip_vertically = false);
+
+    /*!
+     * @brief Get the number of textures still loading in the background
+     *
+     * @return Number of load_async() requests whose upload has not run yet
+     */
+    inline size_t get_pending() const { return m_pending; }
+
+    /*!
+     * @brief Add a texture created elsewhere to the cache
+     *
+     * Used for textures decoded on worker threads and uploaded later. If a texture
+     * is already cached under the path, it is kept and returned instead.
+     *
+     * @param fpath The file path of the texture
+     * @param texture The texture to cache
+     * @return Shared pointer to the cached texture
+     */
+    std::shared_ptr<renderer::Texture> insert(const std::string &fpath, std::shared_ptr<renderer::Texture> texture);
+
+    /*!
+     * @brief Create a texture from a decoded image, streamed if streaming is enabled
+     *
+     * The texture is not cached, pass it to insert().
+     *
+     * @param fpath The file path of the texture
+     * @param image The decoded image
+     * @param from_file Whether the image was decoded from fpath, so that a streamed texture can read
+     *                  its finer levels back instead of keeping them in memory
+     * @return Shared pointer to the new texture
+     */
+    std::shared_ptr<renderer::Texture> create(const std::string &fpath, const renderer::ImageData &image,
+                                              bool from_file = true) const;
+
+    /*!
+     * @brief Enable or disable streaming of the textures created from now on
+     *
+     * Streamed textures start with only their low mips resident and get finer levels from
+     * the renderer::TextureStreamer as they are drawn larger. Their cached size is the one
+     * measured when they were added.
+     *
+     * @param streaming True to create textures through the streamer
+     */
+    inline void set_streaming(bool streaming) { m_streaming = streaming; }
+
+    /*!
+     * @brief Check if new textures are streamed
+     *
+     * @return True if load() and the model loaders go through the streamer
+     */
+    inline bool is_streaming() const { return m_streaming; }
+
     /*!
      * @brief Check if a texture exists in the cache
      *
@@ -88,9 +160,40 @@ class TextureLibrary {
      */
     inline size_t size() const { return m_textures.size(); }
 
+    /*!
+     * @brief Set the memory budget of the cache
+     *
+     * Evicts unused textures down to the budget right away. The default is 512 MiB.
+     *
+     * @param bytes The budget in bytes, 0 for no limit
+     */
+    inline void set_budget(size_t bytes) { m_textures.set_budget(bytes); }
+
+    /*!
+     * @brief Get the memory budget of the cache
+     *
+     * @return The budget in bytes, 0 when unlimited
+     */
+    inline size_t get_budget() const { return m_textures.get_budget(); }
+
+    /*!
+     * @brief Get the cache counters
+     *
+     * Hits and misses count load() and load_async() calls.
+     *
+     * @return Resident bytes, hits, misses and evictions
+     */
+    inline const core::CacheStats &get_stats() const { return m_textures.get_stats(); }
+
+    //! @brief Reset hits, misses and evictions
+    inline void reset_stats() { m_textures.reset_stats(); }
+
   private:
+    //! @brief Budget the library starts with, in bytes
+    static constexpr size_t DEFAULT_BUDGET = 512 * 1024 * 1024;
+
     //! @brief Private constructor for singleton pattern
-    TextureLibrary() = default;
+    TextureLibrary();
 
     //! @brief Destructor
     ~TextureLibrary() = default;
@@ -101,8 +204,14 @@ class TextureLibrary {
     //! @brief Delete assignment operator
     TextureLibrary &operator=(const TextureLibrary &) = delete;
 
-    //! @brief Map storing cached textures
-    std::unordered_map<std::string, std::shared_ptr<renderer::Texture>> m_textures;
+    //! @brief Cached textures by file path
+    core::ResourceCache<renderer::Texture> m_textures;
+
+    //! @brief Number of background loads still waiting for their upload
+    size_t m_pending = 0;
+
+    //! @brief Whether new textures go through the renderer::TextureStreamer
+    bool m_streaming = false;
 };
 
 } // namespace assets
@@ -0,0 +1,135 @@
+/*!
+ * @file upload_queue.hpp
+ * @brief Budgeted queue of work that must run on the render thread.
+ *
+ * This header defines the UploadQueue class. Worker threads prepare assets in CPU memory
+ * and queue the OpenGL side of their creation here; the render thread drains the queue a
+ * slice at a time, so that streaming assets in never stalls a frame.
+ *
+ * \copyright{Copyright (c) 2026 Luca Mazza. All rights reserved.}
+ * \license{This project is released under the MIT License.}
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+namespace lmgl {
+
+namespace assets {
+
+/*!
+ * @brief Thread-safe FIFO of render thread tasks, processed under a per-frame budget.
+ *
+ * Any thread may push tasks; process() must be called from the thread owning the OpenGL
+ * context, which core::Engine::run does once per frame. Each call runs tasks in order
+ * until the time budget or the byte budget of the frame is spent. The first task always
+ * runs, so a task larger than the budget still completes, in a frame of its own.
+ */
+class UploadQueue {
+  public:
+    /*!
+     * @brief Get the singleton instance of the UploadQueue.
+     *
+     * @return Reference to the UploadQueue instance.
+     */
+    static UploadQueue &get_instance();
+
+    //! @brief Creates an empty queue with the default budgets.
+    UploadQueue() = default;
+
+    UploadQueue(const UploadQueue &) = delete;
+    UploadQueue &operator=(const UploadQueue &) = delete;
+
+    /*!
+     * @brief Queues a task.
+     *
+     * @param task Task to run on the render thread.
+     * @param bytes Approximate amount of data the task uploads, charged to the byte budget.
+     */
+    void push(std::function<void()> task, std::size_t bytes = 0);
+
+    /*!
+     * @brief Runs queued tasks until the frame budget is spent.
+     *
+     * Tasks queued while processing run in the same call if budget remains.
+     *
+     * @return Number of tasks run.
+     */
+    std::size_t process();
+
+    /*!
+     * @brief Runs every queued task, ignoring the budget.
+     *
+     * Used when blocking is acceptable, e.g. on a loading screen or before shutdown.
+     *
+     * @return Number of tasks run.
+     */
+    std::size_t flush();
+
+    /*!
+     * @brief Sets the per-frame budget.
+     *
+     * @param milliseconds Time spent running tasks per process() call.
+     * @param bytes Data uploaded per process() call, 0 for no limit.
+     */
+    void set_budget(double milliseconds, std::size_t bytes = 0);
+
+    /*!
+     * @brief Getter for the per-frame time budget.
+     *
+     * @return Time budget in milliseconds.
+     */
+    inline double get_time_budget() const { return m_time_budget; }
+
+    /*!
+     * @brief Getter for the per-frame byte budget.
+     *
+     * @return Byte budget, 0 when unlimited.
+     */
+    inline std::size_t get_byte_budget() const { return m_byte_budget; }
+
+    /*!
+     * @brief Getter for the number of queued tasks.
+     *
+     * @return Number of tasks waiting to run.
+     */
+    std::size_t get_pending() const;
+
+    //! @brief Drops every queued task without running it.
+    void clear();
+
+  private:
+    //! @brief A queued task and its upload size.
+    struct Task {
+        std::function<void()> run; //!< Task to run
+        std::size_t bytes;         //!< Bytes charged to the budget
+    };
+
+    /*!
+     * @brief Takes the next task off the queue.
+     *
+     * @param task Filled with the task.
+     * @return False if the queue is empty.
+     */
+    bool pop(Task &task);
+
+    //! @brief Queued tasks.
+    std::deque<Task> m_tasks;
+
+    //! @brief Protects the queue.
+    mutable std::mutex m_mutex;
+
+    //! @brief Time budget per process() call in milliseconds.
+    double m_time_budget = 2.0;
+
+    //! @brief Byte budget per process() call, 0 for no limit.
+    std::size_t m_byte_budget = 16 * 1024 * 1024;
+};
+
+} // namespace assets
+
+} // namespace lmgl
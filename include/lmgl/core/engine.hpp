@@ -188,7 +188,8 @@ class Engine {
     /*!
      * @brief Free resources and clean up the engine.
      *
-     * Destroys the GLFW window and terminates GLFW.
+     * Waits for the core::ThreadPool to go idle and drops the uploads still queued, so that
+     * no load in flight outlives the context, then destroys the GLFW window and terminates GLFW.
      */
     void free();
 
@@ -0,0 +1,259 @@
+/*!
+ * @file resource_cache.hpp
+ * @brief Named cache of shared resources with a memory budget and LRU eviction.
+ *
+ * This file contains the ResourceCache class template, the storage behind
+ * assets::TextureLibrary, renderer::ShaderLibrary and ui::FontManager. It accounts for
+ * the memory of each resource and, once over budget, drops the least recently used ones
+ * that nothing outside the cache still refers to.
+ *
+ * \copyright{Copyright (c) 2026 Luca Mazza. All rights reserved.}
+ * \license{This project is released under the MIT License.}
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace lmgl {
+
+namespace core {
+
+//! @brief Usage counters of a ResourceCache.
+struct CacheStats {
+    std::size_t resident_bytes = 0; //!< Memory taken by the cached resources
+    std::size_t hits = 0;           //!< Lookups served from the cache
+    std::size_t misses = 0;         //!< Lookups that had to load the resource
+    std::size_t evictions = 0;      //!< Resources dropped to fit the budget
+};
+
+/*!
+ * @brief Cache of shared resources by name, evicting the least recently used ones over budget.
+ *
+ * Only resources whose sole owner is the cache are evicted: dropping one still in use
+ * would free no memory and make the next lookup load a duplicate. The cache may thus stay
+ * over budget while everything in it is in use. A budget of 0 means no limit. Not
+ * thread-safe.
+ *
+ * @tparam T The resource type.
+ */
+template <typename T> class ResourceCache {
+  public:
+    //! @brief Function returning the memory a resource takes, in bytes.
+    using SizeFunction = std::function<std::size_t(const T &)>;
+
+    /*!
+     * @brief Creates an empty cache without a budget.
+     *
+     * @param size_of Measures a resource, nullptr to count every resource as 0 bytes.
+     */
+    explicit ResourceCache(SizeFunction size_of = nullptr) : m_size_of(std::move(size_of)) {}
+
+    /*!
+     * @brief Looks a resource up and counts a hit or a miss.
+     *
+     * @param key The resource name.
+     * @return The resource, marked as most recently used, or nullptr on a miss.
+     */
+    std::shared_ptr<T> find(const std::string &key) {
+        std::shared_ptr<T> value = get(key);
+        if (value)
+            ++m_stats.hits;
+        else
+            ++m_stats.misses;
+        return value;
+    }
+
+    /*!
+     * @brief Looks a resource up without touching the counters.
+     *
+     * @param key The resource name.
+     * @return The resource, marked as most recently used, or nullptr if not cached.
+     */
+    std::shared_ptr<T> get(const std::string &key) const {
+        auto it = m_entries.find(key);
+        if (it == m_entries.end())
+            return nullptr;
+        m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+        return it->second.value;
+    }
+
+    /*!
+     * @brief Check if a resource is cached.
+     *
+     * @param key The resource name.
+     * @return True if cached.
+     */
+    bool contains(const std::string &key) const { return m_entries.find(key) != m_entries.end(); }
+
+    /*!
+     * @brief Adds a resource, then evicts down to the budget.
+     *
+     * @param key The resource name.
+     * @param value The resource.
+     * @param replace Whether to replace a resource already cached under the name, or keep it.
+     * @return The cached resource, nullptr if value is null.
+     */
+    std::shared_ptr<T> insert(const std::string &key, std::shared_ptr<T> value, bool replace = false) {
+        if (!value)
+            return nullptr;
+        auto it = m_entries.find(key);
+        if (it != m_entries.end()) {
+            m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+            if (!replace)
+                return it->second.value;
+            m_stats.resident_bytes -= it->second.bytes;
+            it->second.value = std::move(value);
+            it->second.bytes = measure(*it->second.value);
+            m_stats.resident_bytes += it->second.bytes;
+        } else {
+            m_lru.push_front(key);
+            Entry entry;
+            entry.bytes = measure(*value);
+            entry.value = std::move(value);
+            entry.lru = m_lru.begin();
+            m_stats.resident_bytes += entry.bytes;
+            it = m_entries.emplace(key, std::move(entry)).first;
+        }
+        std::shared_ptr<T> result = it->second.value;
+        trim();
+        return result;
+    }
+
+    /*!
+     * @brief Measures a resource again, after its memory changed.
+     *
+     * @param key The resource name.
+     */
+    void update_size(const std::string &key) {
+        auto it = m_entries.find(key);
+        if (it == m_entries.end())
+            return;
+        m_stats.resident_bytes -= it->second.bytes;
+        it->second.bytes = measure(*it->second.value);
+        m_stats.resident_bytes += it->second.bytes;
+    }
+
+    /*!
+     * @brief Removes a resource.
+     *
+     * @param key The resource name.
+     * @return True if it was cached.
+     */
+    bool erase(const std::string &key) {
+        auto it = m_entries.find(key);
+        if (it == m_entries.end())
+            return false;
+        m_stats.resident_bytes -= it->second.bytes;
+        m_lru.erase(it->second.lru);
+        m_entries.erase(it);
+        return true;
+    }
+
+    /*!
+     * @brief Evicts least recently used resources owned only by the cache until within budget.
+     *
+     * @return Number of resources evicted.
+     */
+    std::size_t trim() {
+        std::size_t evicted = 0;
+        for (auto it = m_lru.end(); m_budget > 0 && m_stats.resident_bytes > m_budget && it != m_lru.begin();) {
+            --it;
+            auto entry = m_entries.find(*it);
+            if (entry->second.value.use_count() > 1)
+                continue;
+            m_stats.resident_bytes -= entry->second.bytes;
+            m_entries.erase(entry);
+            it = m_lru.erase(it);
+            ++evicted;
+        }
+        m_stats.evictions += evicted;
+        return evicted;
+    }
+
+    //! @brief Removes every resource, keeping the counters.
+    void clear() {
+        m_entries.clear();
+        m_lru.clear();
+        m_stats.resident_bytes = 0;
+    }
+
+    /*!
+     * @brief Sets the memory budget and evicts down to it.
+     *
+     * @param bytes The budget in bytes, 0 for no limit.
+     */
+    void set_budget(std::size_t bytes) {
+        m_budget = bytes;
+        trim();
+    }
+
+    /*!
+     * @brief Getter for the memory budget.
+     *
+     * @return The budget in bytes, 0 when unlimited.
+     */
+    std::size_t get_budget() const { return m_budget; }
+
+    /*!
+     * @brief Getter for the usage counters.
+     *
+     * @return The counters, with the current resident memory.
+     */
+    const CacheStats &get_stats() const { return m_stats; }
+
+    //! @brief Resets hits, misses and evictions to zero.
+    void reset_stats() {
+        m_stats.hits = 0;
+        m_stats.misses = 0;
+        m_stats.evictions = 0;
+    }
+
+    /*!
+     * @brief Getter for the number of cached resources.
+     *
+     * @return Number of resources.
+     */
+    std::size_t size() const { return m_entries.size(); }
+
+  private:
+    //! @brief A cached resource.
+    struct Entry {
+        std::shared_ptr<T> value;             //!< The resource
+        std::size_t bytes = 0;                //!< Memory measured when added or updated
+        std::list<std::string>::iterator lru; //!< Position in the recency list
+    };
+
+    /*!
+     * @brief Measures a resource.
+     *
+     * @param value The resource.
+     * @return Its memory in bytes.
+     */
+    std::size_t measure(const T &value) const { return m_size_of ? m_size_of(value) : 0; }
+
+    //! @brief Measures resources.
+    SizeFunction m_size_of;
+
+    //! @brief Cached resources by name.
+    std::unordered_map<std::string, Entry> m_entries;
+
+    //! @brief Names from most to least recently used, reordered by const lookups too.
+    mutable std::list<std::string> m_lru;
+
+    //! @brief Memory budget in bytes, 0 for no limit.
+    std::size_t m_budget = 0;
+
+    //! @brief Usage counters.
+    CacheStats m_stats;
+};
+
+} // namespace core
+
+} // namespace lmgl
@@ -0,0 +1,146 @@
+/*!
+ * @file thread_pool.hpp
+ * @brief Declaration of the ThreadPool class for running work off the render thread.
+ *
+ * This file contains the declaration of the ThreadPool class, a fixed set of worker
+ * threads consuming a shared task queue. It is used to import, convert and decode
+ * assets without stalling the frame loop.
+ *
+ * \copyright{Copyright (c) 2026 Luca Mazza. All rights reserved.}
+ * \license{This project is released under the MIT License.}
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace lmgl {
+
+namespace core {
+
+/*!
+ * @brief Fixed-size pool of worker threads.
+ *
+ * Tasks are run in submission order by the first idle worker. Workers never touch
+ * OpenGL, work that needs the context is handed back to the render thread through
+ * assets::UploadQueue. Tasks may submit further tasks, but must not block waiting on
+ * them, since every worker could end up waiting; parallel_for() is the exception.
+ */
+class ThreadPool {
+  public:
+    /*!
+     * @brief Get the shared pool used by the engine.
+     *
+     * Created on first use with one worker per hardware thread, minus the render thread.
+     *
+     * @return Reference to the ThreadPool instance.
+     */
+    static ThreadPool &get_instance();
+
+    /*!
+     * @brief Starts the worker threads.
+     *
+     * @param thread_count Number of workers, 0 uses the hardware concurrency minus one (at least one).
+     */
+    explicit ThreadPool(unsigned int thread_count = 0);
+
+    //! @brief Finishes the queued tasks and joins the workers.
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    /*!
+     * @brief Queues a task.
+     *
+     * @param task Callable taking no arguments.
+     * @return Future receiving the result of the task, or the exception it threw.
+     */
+    template <typename F> std::future<std::invoke_result_t<std::decay_t<F>>> submit(F &&task) {
+        using Result = std::invoke_result_t<std::decay_t<F>>;
+        // std::function needs a copyable target, the packaged task is not
+        auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+        std::future<Result> future = packaged->get_future();
+        enqueue([packaged]() { (*packaged)(); });
+        return future;
+    }
+
+    /*!
+     * @brief Runs a loop body for every index, spread over the workers.
+     *
+     * The calling thread claims indices too and only waits for the ones already running
+     * on a worker, so it may be called from a task. Indices are claimed in order, one at
+     * a time: each call of the body should be a sizeable piece of work.
+     *
+     * @param count Number of indices, the body is called for 0 to count - 1.
+     * @param body Callable taking the index.
+     * @throws The first exception thrown by the body, once every index is done.
+     */
+    void parallel_for(std::size_t count, const std::function<void(std::size_t)> &body);
+
+    /*!
+     * @brief Blocks until the queue is empty and every worker is idle.
+     *
+     * Must not be called from a task.
+     */
+    void wait_idle();
+
+    /*!
+     * @brief Getter for the number of workers.
+     *
+     * @return Number of worker threads.
+     */
+    inline unsigned int get_thread_count() const { return static_cast<unsigned int>(m_threads.size()); }
+
+    /*!
+     * @brief Getter for the number of queued tasks.
+     *
+     * @return Number of tasks not yet picked up by a worker.
+     */
+    std::size_t get_pending() const;
+
+  private:
+    /*!
+     * @brief Appends a task to the queue and wakes a worker.
+     *
+     * @param task Task to run.
+     */
+    void enqueue(std::function<void()> task);
+
+    //! @brief Worker loop: runs tasks until the pool is destroyed.
+    void worker();
+
+    //! @brief Worker threads.
+    std::vector<std::thread> m_threads;
+
+    //! @brief Tasks waiting for a worker.
+    std::deque<std::function<void()>> m_tasks;
+
+    //! @brief Protects the queue and the counters.
+    mutable std::mutex m_mutex;
+
+    //! @brief Signaled when a task is queued or the pool stops.
+    std::condition_variable m_task_available;
+
+    //! @brief Signaled when a worker finishes a task.
+    std::condition_variable m_task_done;
+
+    //! @brief Number of tasks currently running.
+    std::size_t m_active = 0;
+
+    //! @brief Whether the workers should exit once the queue is empty.
+    bool m_stopping = false;
+};
+
+} // namespace core
+
+} // namespace lmgl
@@ -28,10 +28,12 @@
 // Assets
 #include "lmgl/assets/model_loader.hpp"
 #include "lmgl/assets/texture_library.hpp"
+#include "lmgl/assets/upload_queue.hpp"
 
 // Renderer (commonly used)
 #include "lmgl/renderer/shader.hpp"
 #include "lmgl/renderer/texture.hpp"
+#include "lmgl/renderer/texture_streamer.hpp"
 
 // UI
 #include "lmgl/ui/button.hpp"
@@ -0,0 +1,82 @@
+/*!
+ * @file block_encoder.hpp
+ * @brief CPU encoder for block-compressed textures.
+ *
+ * This header defines the BlockEncoder class, which converts decoded images (PNG, JPG
+ * and the other formats stb_image reads) to BCn with a precomputed mip chain, so that
+ * existing assets can be stored as DDS files and uploaded without any processing.
+ *
+ * \copyright{Copyright (c) 2026 Luca Mazza. All rights reserved.}
+ * \license{This project is released under the MIT License.}
+ */
+
+#pragma once
+
+#include "lmgl/renderer/texture.hpp"
+#include "lmgl/renderer/texture_container.hpp"
+
+#include <string>
+#include <vector>
+
+namespace lmgl {
+
+namespace renderer {
+
+/*!
+ * @brief Encodes images to BC1, BC3, BC4, BC5 and BC7.
+ *
+ * Endpoints are fitted along the principal axis of each block's colors, which is fast
+ * and good enough for offline conversion, not a match for dedicated compressors. BC7
+ * blocks all use mode 6 (one subset, RGBA endpoints with 4-bit indices). Mip levels
+ * are box-filtered down to 1x1 before encoding.
+ */
+class BlockEncoder {
+  public:
+    /*!
+     * @brief Encodes an image.
+     *
+     * One-channel images are treated as grey, two-channel images as grey and alpha.
+     * BC4 keeps the red channel and BC5 the red and green ones.
+     *
+     * @param image The decoded image.
+     * @param format The format to encode to.
+     * @param compressed Filled with the encoded levels.
+     * @param mipmaps Whether to encode the full mip chain or only the base level.
+     * @return True on success, false if the image holds no pixels.
+     */
+    static bool encode(const ImageData &image, BlockFormat format, CompressedImage &compressed, bool mipmaps = true);
+
+    /*!
+     * @brief Converts an image file to a DDS file.
+     *
+     * @param source_path The image to convert, in any format stb_image reads.
+     * @param dds_path The DDS file to write.
+     * @param format The format to encode to.
+     * @param mipmaps Whether to encode the full mip chain.
+     * @return True on success.
+     */
+    static bool convert(const std::string &source_path, const std::string &dds_path, BlockFormat format,
+                        bool mipmaps = true);
+
+    /*!
+     * @brief Encodes a 4x4 block of RGBA8 pixels.
+     *
+     * @param pixels 16 pixels, row by row, 4 bytes each.
+     * @param format The format to encode to.
+     * @param block Receives TextureContainer::get_block_size(format) bytes.
+     */
+    static void encode_block(const unsigned char *pixels, BlockFormat format, unsigned char *block);
+
+    /*!
+     * @brief Builds the uncompressed mip chain the encoder works from.
+     *
+     * @param image The decoded image.
+     * @param levels Filled with RGBA8 levels, full size first and 1x1 last.
+     * @return True on success, false if the image holds no pixels.
+     */
+    static bool build_mip_chain(const ImageData &image, std::vector<CompressedLevel> &levels);
+};
+
+} // namespace renderer
+
+} // namespace lmgl
@@ -3,7 +3,7 @@
  * @brief Defines classes and structures for managing vertex and index buffers in OpenGL.
  *
  * This header file contains the definitions for BufferElement, BufferLayout,
- * VertexBuffer, and IndexBuffer classes. These classes facilitate the creation,
+ * VertexBuffer, IndexBuffer and StreamBuffer classes. These classes facilitate the creation,
  * management, and usage of vertex and index buffers in an OpenGL rendering context.
  *
  * \copyright{Copyright (c) 2026 Luca Mazza. All rights reserved.}
@@ -13,6 +13,7 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 #include <initializer_list>
 #include <string>
 #include <vector>
@@ -28,9 +29,80 @@ namespace renderer {
  * in shader programs, including floats, integers, matrices, and booleans.
  * Each type corresponds to a specific size and structure in memory.
  *
+ * The packed types (half floats, bytes, shorts and Int2_10_10_10) are stored compactly
+ * in the buffer but read as floating point vectors by the shader. Mark them normalized
+ * to map their integer range to [0, 1] (unsigned) or [-1, 1] (signed). UByte4I is stored
+ * like UByte4 but read as an integer vector (uvec4), for indices such as skinning joints.
+ *
  * @note The sizes of these types are important for buffer layout calculations.
  */
-enum class ShaderDataType { None = 0, Float, Float2, Float3, Float4, Mat3, Mat4, Int, Int2, Int3, Int4, Bool };
+enum class ShaderDataType {
+    None = 0,
+    Float,
+    Float2,
+    Float3,
+    Float4,
+    Mat3,
+    Mat4,
+    Int,
+    Int2,
+    Int3,
+    Int4,
+    Bool,
+    Half2,
+    Half4,
+    Byte4,
+    UByte4,
+    UByte4I,
+    Short2,
+    Short4,
+    UShort2,
+    UShort4,
+    Int2_10_10_10
+};
+
+/*!
+ * @brief Get the size in bytes of a ShaderDataType.
+ *
+ * @param type Data type to measure.
+ * @return Size in bytes, or 0 for ShaderDataType::None.
+ */
+constexpr unsigned int shader_data_type_size(ShaderDataType type) {
+    switch (type) {
+    case ShaderDataType::Float:         return 4;
+    case ShaderDataType::Float2:        return 4 * 2;
+    case ShaderDataType::Float3:        return 4 * 3;
+    case ShaderDataType::Float4:        return 4 * 4;
+    case ShaderDataType::Mat3:          return 4 * 3 * 3;
+    case ShaderDataType::Mat4:          return 4 * 4 * 4;
+    case ShaderDataType::Int:           return 4;
+    case ShaderDataType::Int2:          return 4 * 2;
+    case ShaderDataType::Int3:          return 4 * 3;
+    case ShaderDataType::Int4:          return 4 * 4;
+    case ShaderDataType::Bool:          return 1;
+    case ShaderDataType::Half2:         return 2 * 2;
+    case ShaderDataType::Half4:         return 2 * 4;
+    case ShaderDataType::Byte4:         return 4;
+    case ShaderDataType::UByte4:        return 4;
+    case ShaderDataType::UByte4I:       return 4;
+    case ShaderDataType::Short2:        return 2 * 2;
+    case ShaderDataType::Short4:        return 2 * 4;
+    case ShaderDataType::UShort2:       return 2 * 2;
+    case ShaderDataType::UShort4:       return 2 * 4;
+    case ShaderDataType::Int2_10_10_10: return 4;
+    default:                            return 0;
+    }
+}
+
+/*!
+ * @brief Get the number of attribute locations a ShaderDataType occupies.
+ *
+ * @param type Data type to measure.
+ * @return 3 for Mat3, 4 for Mat4, 1 otherwise.
+ */
+constexpr unsigned int shader_data_type_location_count(ShaderDataType type) {
+    return type == ShaderDataType::Mat3 ? 3 : type == ShaderDataType::Mat4 ? 4 : 1;
+}
 
 /*!
  * @brief Represents a single element in a buffer layout.
@@ -58,6 +130,9 @@ struct BufferElement {
     //! @brief Indicates if the data is normalized.
     bool normalized;
 
+    //! @brief Explicit attribute location, or -1 to follow the previous element.
+    int location = -1;
+
     //! @brief Default constructor.
     BufferElement() = default;
 
@@ -70,8 +145,9 @@ struct BufferElement {
      * @param type Data type of the buffer element.
      * @param name Name of the buffer element.
      * @param normalized Indicates if the data is normalized (default is false).
+     * @param location Explicit attribute location (default is -1, right after the previous element).
      */
-    BufferElement(ShaderDataType type, const std::string &name, bool normalized = false);
+    BufferElement(ShaderDataType type, const std::string &name, bool normalized = false, int location = -1);
 
     /*!
      * @brief Get the number of components in the buffer element.
@@ -82,6 +158,15 @@ struct BufferElement {
      * @return Number of components in the buffer element.
      */
     unsigned int get_component_count() const;
+
+    /*!
+     * @brief Check whether the element is read as an integer vector by the shader.
+     *
+     * Integer elements must be declared with int/ivec inputs and are not converted to float.
+     *
+     * @return True for the Int and Bool types.
+     */
+    bool is_integer() const;
 };
 
 /*!
@@ -108,6 +193,17 @@ class BufferLayout {
      */
     BufferLayout(const std::initializer_list<BufferElement> &elements);
 
+    /*!
+     * @brief Constructor for layouts with precomputed offsets.
+     *
+     * The element offsets are kept as given, which allows padding and arbitrary member
+     * order. Used by make_vertex_layout() for compile-time vertex formats.
+     *
+     * @param elements Buffer elements with their offsets already set.
+     * @param stride Size of one vertex in bytes.
+     */
+    BufferLayout(const std::vector<BufferElement> &elements, unsigned int stride);
+
     /*!
      * @brief Get the stride of the buffer layout.
      *
@@ -226,12 +322,26 @@ class VertexBuffer {
     /*!
      * @brief Set the data of the vertex buffer.
      *
-     * Updates the contents of the vertex buffer with new data.
+     * Updates the contents of the vertex buffer with new data, starting at the given
+     * byte offset. The written range must fit inside the storage allocated at construction.
      *
      * @param data Pointer to the new vertex data.
      * @param size Size of the new vertex data in bytes.
+     * @param offset Byte offset into the buffer where the data is written (default is 0).
      */
-    void set_data(const void *data, unsigned int size);
+    void set_data(const void *data, unsigned int size, unsigned int offset = 0);
+
+    /*!
+     * @brief Replace the storage of the vertex buffer.
+     *
+     * Allocates new storage of the given size and fills it with data. The buffer keeps
+     * its ID, so vertex arrays that reference it stay valid. The previous storage is
+     * orphaned, which lets the driver avoid waiting for draws still reading it.
+     *
+     * @param data Pointer to the new vertex data (may be nullptr).
+     * @param size Size of the new storage in bytes.
+     */
+    void reallocate(const void *data, unsigned int size);
 
     /*!
      * @brief Set the layout of the vertex buffer.
@@ -253,6 +363,13 @@ class VertexBuffer {
      */
     const BufferLayout &get_layout() const;
 
+    /*!
+     * @brief Get the OpenGL ID of the vertex buffer.
+     *
+     * @return Renderer ID assigned by OpenGL.
+     */
+    inline unsigned int get_id() const { return m_renderer_id; }
+
   private:
     //! @brief Layout of the vertex buffer.
     unsigned int m_renderer_id;
@@ -285,6 +402,16 @@ class IndexBuffer {
      */
     IndexBuffer(const unsigned int *indices, unsigned int count);
 
+    /*!
+     * @brief Constructor for a 16-bit IndexBuffer.
+     *
+     * Halves the index memory and bandwidth of meshes with at most 65536 vertices.
+     *
+     * @param indices Pointer to the 16-bit index data.
+     * @param count Number of indices.
+     */
+    IndexBuffer(const uint16_t *indices, unsigned int count);
+
     //! @brief Destructor for the IndexBuffer.
     ~IndexBuffer();
 
@@ -302,6 +429,19 @@ class IndexBuffer {
      */
     void unbind() const;
 
+    /*!
+     * @brief Set a range of indices in the buffer.
+     *
+     * Updates the contents of the index buffer starting at the given index offset.
+     * The written range must fit inside the storage allocated at construction. Only
+     * 32-bit index buffers can be updated.
+     *
+     * @param indices Pointer to the new index data.
+     * @param count Number of indices to write.
+     * @param offset Offset, in indices, where the data is written (default is 0).
+     */
+    void set_data(const unsigned int *indices, unsigned int count, unsigned int offset = 0);
+
     /*!
      * @brief Get the count of indices in the buffer.
      *
@@ -311,12 +451,149 @@ class IndexBuffer {
      */
     inline unsigned int get_count() const { return m_count; }
 
+    /*!
+     * @brief Get the OpenGL type of the indices.
+     *
+     * @return GL_UNSIGNED_INT or GL_UNSIGNED_SHORT, to be passed to the draw calls.
+     */
+    inline unsigned int get_index_type() const { return m_index_type; }
+
+    /*!
+     * @brief Get the size of one index in bytes.
+     *
+     * @return 4 for 32-bit and 2 for 16-bit indices.
+     */
+    unsigned int get_index_size() const;
+
+    /*!
+     * @brief Get the OpenGL ID of the index buffer.
+     *
+     * @return Renderer ID assigned by OpenGL.
+     */
+    inline unsigned int get_id() const { return m_renderer_id; }
+
   private:
     //! @brief Renderer ID assigned by OpenGL.
     unsigned int m_renderer_id;
 
     //! @brief Number of indices in the buffer.
     unsigned int m_count;
+
+    //! @brief OpenGL type of the indices.
+    unsigned int m_index_type;
+};
+
+/*!
+ * @brief Ring buffer for data that is rewritten every frame.
+ *
+ * The buffer is split into a fixed number of regions (three by default). Data is pushed
+ * linearly into the current region and each push returns the byte offset it was written
+ * at, to be used as attribute offset, first vertex, base instance or indirect offset.
+ * When a region is full, or when end_frame() is called, a fence is inserted and writing
+ * moves to the next region, which is only reused once the GPU has signalled its fence.
+ *
+ * When immutable storage is available the whole buffer is persistently mapped and pushes
+ * are plain memory copies. Otherwise each push maps its range unsynchronized, and if the
+ * next region is still in use at end_frame() the storage is orphaned instead of waiting for
+ * the GPU. A region filling up mid-frame waits for the fence of the region it reuses, since
+ * data pushed earlier in the frame may not have been drawn yet.
+ *
+ * @note The buffer is never bound to GL_ELEMENT_ARRAY_BUFFER internally, so writing to it
+ * does not disturb the index buffer of the currently bound vertex array.
+ */
+class StreamBuffer {
+  public:
+    //! @brief Offset returned when a push cannot be satisfied.
+    static constexpr unsigned int invalid = 0xFFFFFFFFu;
+
+    /*!
+     * @brief Constructor for the StreamBuffer.
+     *
+     * @param region_size Size of one region in bytes, i.e. the most data a single push can hold.
+     * @param region_count Number of regions in the ring (default is 3).
+     * @param allow_persistent Use persistent mapping when the context supports it (default is true).
+     */
+    StreamBuffer(unsigned int region_size, unsigned int region_count = 3, bool allow_persistent = true);
+
+    //! @brief Destructor for the StreamBuffer.
+    ~StreamBuffer();
+
+    StreamBuffer(const StreamBuffer &) = delete;
+    StreamBuffer &operator=(const StreamBuffer &) = delete;
+
+    /*!
+     * @brief Copy data into the ring.
+     *
+     * @param data Pointer to the data.
+     * @param size Size of the data in bytes.
+     * @param alignment Alignment of the returned offset in bytes (default is 16).
+     * @return Byte offset of the data inside the buffer, or StreamBuffer::invalid if it does not fit in a region.
+     */
+    unsigned int push(const void *data, unsigned int size, unsigned int alignment = 16);
+
+    /*!
+     * @brief Close the current region and move to the next one.
+     *
+     * Call once per frame after the draws that read the pushed data have been issued.
+     * Does nothing if nothing was pushed since the last call.
+     */
+    void end_frame();
+
+    //! @brief Get the OpenGL ID of the buffer.
+    inline unsigned int get_id() const { return m_renderer_id; }
+
+    //! @brief Get the size of one region in bytes.
+    inline unsigned int get_region_size() const { return m_region_size; }
+
+    //! @brief Get the number of regions in the ring.
+    inline unsigned int get_region_count() const { return m_region_count; }
+
+    //! @brief Get the index of the region currently written to.
+    inline unsigned int get_current_region() const { return m_region; }
+
+    //! @brief Check if the buffer is persistently mapped.
+    inline bool is_persistent() const { return m_mapped != nullptr; }
+
+    //! @brief Get how many times the CPU had to wait for the GPU before reusing a region.
+    inline unsigned int get_stall_count() const { return m_stall_count; }
+
+    //! @brief Get how many times the storage was orphaned instead of waiting.
+    inline unsigned int get_orphan_count() const { return m_orphan_count; }
+
+  private:
+    /*!
+     * @brief Fence the current region and make the next one writable.
+     *
+     * @param end_of_frame True when called from end_frame(), the only point where orphaning is allowed.
+     */
+    void advance(bool end_of_frame);
+
+    //! @brief Renderer ID assigned by OpenGL.
+    unsigned int m_renderer_id = 0;
+
+    //! @brief Size of one region in bytes.
+    unsigned int m_region_size;
+
+    //! @brief Number of regions.
+    unsigned int m_region_count;
+
+    //! @brief Region currently written to.
+    unsigned int m_region = 0;
+
+    //! @brief Write position inside the current region, in bytes.
+    unsigned int m_head = 0;
+
+    //! @brief Fence of each region, null when the region is free.
+    std::vector<void *> m_fences;
+
+    //! @brief Persistent mapping of the whole buffer, null when not persistent.
+    unsigned char *m_mapped = nullptr;
+
+    //! @brief Number of fence waits that blocked.
+    unsigned int m_stall_count = 0;
+
+    //! @brief Number of times the storage was orphaned.
+    unsigned int m_orphan_count = 0;
 };
 
 } // namespace renderer
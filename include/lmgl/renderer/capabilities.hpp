@@ -0,0 +1,177 @@
+/*!
+ * @file capabilities.hpp
+ * @brief Runtime detection of OpenGL versions, extensions and optional entry points.
+ *
+ * The engine targets a 4.1 core context, but drivers routinely return newer contexts
+ * or expose features of later versions as extensions. This header defines the
+ * Capabilities singleton, which is filled once a context is current and lets the
+ * renderer pick faster paths when they exist while keeping the 4.1 path as fallback.
+ * Entry points newer than the generated loader are resolved here as well.
+ *
+ * \copyright{Copyright (c) 2026 Luca Mazza. All rights reserved.}
+ * \license{This project is released under the MIT License.}
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <unordered_set>
+
+namespace lmgl {
+
+namespace renderer {
+
+/*!
+ * @brief Layout of one command consumed by glMultiDrawElementsIndirect.
+ *
+ * Matches the DrawElementsIndirectCommand structure defined by the OpenGL specification.
+ */
+struct DrawElementsIndirectCommand {
+
+    //! @brief Number of indices to draw.
+    unsigned int count;
+
+    //! @brief Number of instances to draw.
+    unsigned int instance_count;
+
+    //! @brief Offset of the first index, in indices.
+    unsigned int first_index;
+
+    //! @brief Value added to every index before fetching vertices.
+    int base_vertex;
+
+    //! @brief First instance, used to index per-draw instanced attributes.
+    unsigned int base_instance;
+};
+
+/*!
+ * @brief Describes what the current OpenGL context supports.
+ *
+ * Call detect() after a context has been made current (Engine::init does this).
+ * Before detection, or without a context, every optional feature reports false.
+ */
+class Capabilities {
+  public:
+    /*!
+     * @brief Get the singleton instance.
+     *
+     * @return Reference to the Capabilities instance.
+     */
+    static Capabilities &get_instance();
+
+    /*!
+     * @brief Query the current context and resolve optional entry points.
+     *
+     * Safe to call repeatedly, e.g. after the context has been recreated.
+     */
+    void detect();
+
+    /*!
+     * @brief Check whether the context advertises an extension.
+     *
+     * @param name Extension name, e.g. "GL_ARB_multi_draw_indirect".
+     * @return True if the extension is present.
+     */
+    bool has_extension(const std::string &name) const;
+
+    /*!
+     * @brief Check whether the context version is at least the given one.
+     *
+     * @param major Required major version.
+     * @param minor Required minor version.
+     * @return True if the context version is greater or equal.
+     */
+    bool is_version_at_least(int major, int minor) const;
+
+    //! @brief Check if detect() found a context.
+    inline bool is_detected() const { return m_detected; }
+
+    //! @brief Get the context major version.
+    inline int get_major_version() const { return m_major; }
+
+    //! @brief Get the context minor version.
+    inline int get_minor_version() const { return m_minor; }
+
+    //! @brief Check if glMultiDrawElementsIndirect with per-command base instance is usable.
+    inline bool has_multi_draw_indirect() const { return m_multi_draw_indirect; }
+
+    /*!
+     * @brief Issue glMultiDrawElementsIndirect.
+     *
+     * Commands are read from the buffer bound to GL_DRAW_INDIRECT_BUFFER.
+     *
+     * @param mode Primitive mode, e.g. GL_TRIANGLES.
+     * @param type Index type, e.g. GL_UNSIGNED_INT.
+     * @param indirect Byte offset of the first command in the indirect buffer.
+     * @param draw_count Number of commands.
+     * @param stride Distance between commands in bytes (0 for tightly packed).
+     */
+    void multi_draw_elements_indirect(unsigned int mode, unsigned int type, const void *indirect, int draw_count,
+                                      int stride) const;
+
+    //! @brief Check if immutable buffer storage (and therefore persistent mapping) is usable.
+    inline bool has_buffer_storage() const { return m_buffer_storage != nullptr; }
+
+    /*!
+     * @brief Issue glBufferStorage.
+     *
+     * @param target Buffer binding target, e.g. GL_COPY_WRITE_BUFFER.
+     * @param size Size of the storage in bytes.
+     * @param data Initial contents (may be nullptr).
+     * @param flags Storage flags, e.g. GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT.
+     */
+    void buffer_storage(unsigned int target, std::ptrdiff_t size, const void *data, unsigned int flags) const;
+
+    /*!
+     * @brief Check if the driver compiles and links shaders in the background.
+     *
+     * True with KHR_parallel_shader_compile or ARB_parallel_shader_compile, whose
+     * GL_COMPLETION_STATUS_KHR query tells without blocking whether a build is done.
+     */
+    inline bool has_parallel_shader_compile() const { return m_max_shader_compiler_threads != nullptr; }
+
+    /*!
+     * @brief Issue glMaxShaderCompilerThreadsKHR.
+     *
+     * detect() lets the driver pick the number of threads.
+     *
+     * @param count Number of background compiler threads, 0 to compile on the calling thread.
+     */
+    void set_max_shader_compiler_threads(unsigned int count) const;
+
+  private:
+    //! @brief Private constructor for the singleton.
+    Capabilities() = default;
+
+    //! @brief Resolve an entry point through the window system.
+    static void *get_proc_address(const char *name);
+
+    //! @brief Whether detect() found a context.
+    bool m_detected = false;
+
+    //! @brief Context major version.
+    int m_major = 0;
+
+    //! @brief Context minor version.
+    int m_minor = 0;
+
+    //! @brief Extensions advertised by the context.
+    std::unordered_set<std::string> m_extensions;
+
+    //! @brief Multi-draw indirect with base instance support.
+    bool m_multi_draw_indirect = false;
+
+    //! @brief glMultiDrawElementsIndirect entry point.
+    void *m_multi_draw_elements_indirect = nullptr;
+
+    //! @brief glBufferStorage entry point.
+    void *m_buffer_storage = nullptr;
+
+    //! @brief glMaxShaderCompilerThreadsKHR entry point.
+    void *m_max_shader_compiler_threads = nullptr;
+};
+
+} // namespace renderer
+
+} // namespace lmgl
@@ -0,0 +1,317 @@
+/*!
+ * @file geometry_pool.hpp
+ * @brief Defines a pool that sub-allocates mesh geometry from shared vertex and index buffers.
+ *
+ * This header file contains the definitions for RangeAllocator, GeometryAllocation,
+ * GeometryPage and GeometryPool. Instead of giving every mesh its own vertex buffer,
+ * index buffer and vertex array, meshes that share a vertex format are packed into a
+ * few large buffers and addressed through a base vertex and a first index. Meshes that
+ * live in the same page share a single vertex array, which removes VAO switches between
+ * them and makes it possible to batch their draws.
+ *
+ * \copyright{Copyright (c) 2026 Luca Mazza. All rights reserved.}
+ * \license{This project is released under the MIT License.}
+ */
+
+#pragma once
+
+#include "lmgl/renderer/buffer.hpp"
+#include "lmgl/renderer/vertex_array.hpp"
+
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace lmgl {
+
+namespace renderer {
+
+/*!
+ * @brief Free-list allocator for ranges of elements inside a fixed-size buffer.
+ *
+ * Free space is tracked as a sorted map of offset to size. Allocation is first-fit and
+ * freeing a range merges it with its free neighbours, so the free list never contains
+ * two adjacent blocks. The allocator does not own any memory: it only hands out offsets.
+ *
+ * @note Offsets and sizes are expressed in elements (vertices or indices), not bytes.
+ */
+class RangeAllocator {
+  public:
+    //! @brief Offset returned when an allocation cannot be satisfied.
+    static constexpr unsigned int invalid = 0xFFFFFFFFu;
+
+    /*!
+     * @brief Constructor for the RangeAllocator.
+     *
+     * @param capacity Total number of elements that can be allocated.
+     */
+    explicit RangeAllocator(unsigned int capacity);
+
+    /*!
+     * @brief Allocate a contiguous range.
+     *
+     * @param size Number of elements to allocate.
+     * @return Offset of the allocated range, or RangeAllocator::invalid if no free block is large enough.
+     */
+    unsigned int allocate(unsigned int size);
+
+    /*!
+     * @brief Return a range to the allocator.
+     *
+     * @param offset Offset previously returned by allocate().
+     * @param size Size that was passed to allocate().
+     */
+    void free(unsigned int offset, unsigned int size);
+
+    /*!
+     * @brief Reset the allocator so that only the first @p used elements are allocated.
+     *
+     * Used after compaction, when all live ranges have been moved to the front.
+     *
+     * @param used Number of leading elements that stay allocated (default is 0).
+     */
+    void reset(unsigned int used = 0);
+
+    //! @brief Get the total capacity in elements.
+    inline unsigned int get_capacity() const { return m_capacity; }
+
+    //! @brief Get the number of allocated elements.
+    inline unsigned int get_used() const { return m_used; }
+
+    //! @brief Get the number of disjoint free blocks.
+    inline unsigned int get_free_block_count() const { return static_cast<unsigned int>(m_free_blocks.size()); }
+
+    //! @brief Get the size of the largest free block.
+    unsigned int get_largest_free_block() const;
+
+    //! @brief Check whether every allocated element precedes every free element.
+    bool is_compact() const;
+
+  private:
+    //! @brief Free blocks, keyed by offset.
+    std::map<unsigned int, unsigned int> m_free_blocks;
+
+    //! @brief Total capacity in elements.
+    unsigned int m_capacity;
+
+    //! @brief Number of allocated elements.
+    unsigned int m_used = 0;
+};
+
+class GeometryPage;
+
+/*!
+ * @brief Handle to a range of vertices and indices inside a GeometryPage.
+ *
+ * The handle keeps its page alive and returns its ranges to the page when destroyed.
+ * Indices stored in the range are relative to the first vertex of the range, so draws
+ * must pass get_base_vertex() as the base vertex and get_first_index() as the index offset.
+ *
+ * @note Offsets may change when the owning pool is defragmented; read them at draw time.
+ */
+class GeometryAllocation {
+  public:
+    //! @brief Destructor, releases the ranges back to the page.
+    ~GeometryAllocation();
+
+    GeometryAllocation(const GeometryAllocation &) = delete;
+    GeometryAllocation &operator=(const GeometryAllocation &) = delete;
+
+    //! @brief Get the index of the first vertex of the range.
+    inline unsigned int get_base_vertex() const { return m_base_vertex; }
+
+    //! @brief Get the number of vertices in the range.
+    inline unsigned int get_vertex_count() const { return m_vertex_count; }
+
+    //! @brief Get the offset of the first index of the range, in indices.
+    inline unsigned int get_first_index() const { return m_first_index; }
+
+    //! @brief Get the number of indices in the range.
+    inline unsigned int get_index_count() const { return m_index_count; }
+
+    //! @brief Get the page that owns the range.
+    inline const std::shared_ptr<GeometryPage> &get_page() const { return m_page; }
+
+    //! @brief Get the vertex array shared by every allocation in the page.
+    const std::shared_ptr<VertexArray> &get_vertex_array() const;
+
+  private:
+    friend class GeometryPage;
+
+    /*!
+     * @brief Constructor for the GeometryAllocation.
+     *
+     * @param page Page that owns the ranges.
+     * @param base_vertex Index of the first vertex.
+     * @param vertex_count Number of vertices.
+     * @param first_index Offset of the first index.
+     * @param index_count Number of indices.
+     */
+    GeometryAllocation(std::shared_ptr<GeometryPage> page, unsigned int base_vertex, unsigned int vertex_count,
+                       unsigned int first_index, unsigned int index_count);
+
+    //! @brief Page that owns the ranges.
+    std::shared_ptr<GeometryPage> m_page;
+
+    //! @brief Index of the first vertex.
+    unsigned int m_base_vertex;
+
+    //! @brief Number of vertices.
+    unsigned int m_vertex_count;
+
+    //! @brief Offset of the first index.
+    unsigned int m_first_index;
+
+    //! @brief Number of indices.
+    unsigned int m_index_count;
+};
+
+/*!
+ * @brief A vertex buffer, an index buffer and the vertex array binding them.
+ *
+ * Pages have a fixed capacity chosen at creation. When a page is full the pool creates
+ * another one rather than reallocating, so existing allocations never move implicitly.
+ */
+class GeometryPage : public std::enable_shared_from_this<GeometryPage> {
+  public:
+    /*!
+     * @brief Constructor for the GeometryPage.
+     *
+     * @param layout Vertex layout shared by every mesh in the page.
+     * @param vertex_capacity Number of vertices the page can hold.
+     * @param index_capacity Number of indices the page can hold.
+     */
+    GeometryPage(const BufferLayout &layout, unsigned int vertex_capacity, unsigned int index_capacity);
+
+    /*!
+     * @brief Allocate and upload a mesh into the page.
+     *
+     * @param vertices Pointer to the vertex data, laid out according to the page layout.
+     * @param vertex_count Number of vertices.
+     * @param indices Pointer to the index data, relative to the first vertex.
+     * @param index_count Number of indices.
+     * @return Allocation handle, or nullptr if the page does not have enough contiguous space.
+     */
+    std::shared_ptr<GeometryAllocation> allocate(const void *vertices, unsigned int vertex_count,
+                                                 const unsigned int *indices, unsigned int index_count);
+
+    /*!
+     * @brief Move every live range to the front of the page.
+     *
+     * Live ranges are copied on the GPU through a scratch buffer, so no CPU copy of
+     * the geometry is needed. Allocation handles are updated in place.
+     */
+    void defragment();
+
+    //! @brief Get the vertex array of the page.
+    inline const std::shared_ptr<VertexArray> &get_vertex_array() const { return m_vertex_array; }
+
+    //! @brief Get the vertex buffer of the page.
+    inline const std::shared_ptr<VertexBuffer> &get_vertex_buffer() const { return m_vertex_buffer; }
+
+    //! @brief Get the index buffer of the page.
+    inline const std::shared_ptr<IndexBuffer> &get_index_buffer() const { return m_index_buffer; }
+
+    //! @brief Get the allocator tracking vertex ranges.
+    inline const RangeAllocator &get_vertex_allocator() const { return m_vertex_allocator; }
+
+    //! @brief Get the allocator tracking index ranges.
+    inline const RangeAllocator &get_index_allocator() const { return m_index_allocator; }
+
+    //! @brief Get the number of live allocations in the page.
+    inline unsigned int get_allocation_count() const { return static_cast<unsigned int>(m_allocations.size()); }
+
+  private:
+    friend class GeometryAllocation;
+
+    //! @brief Remove an allocation from the page and free its ranges.
+    void release(GeometryAllocation *allocation);
+
+    //! @brief Stride of one vertex in bytes.
+    unsigned int m_stride;
+
+    //! @brief Vertex array binding the page buffers.
+    std::shared_ptr<VertexArray> m_vertex_array;
+
+    //! @brief Vertex buffer of the page.
+    std::shared_ptr<VertexBuffer> m_vertex_buffer;
+
+    //! @brief Index buffer of the page.
+    std::shared_ptr<IndexBuffer> m_index_buffer;
+
+    //! @brief Allocator for vertex ranges.
+    RangeAllocator m_vertex_allocator;
+
+    //! @brief Allocator for index ranges.
+    RangeAllocator m_index_allocator;
+
+    //! @brief Live allocations, used to patch offsets during defragmentation.
+    std::vector<GeometryAllocation *> m_allocations;
+};
+
+/*!
+ * @brief Pool of geometry pages sharing a single vertex layout.
+ *
+ * Create one pool per vertex format and pass it to the meshes (or to the model loader)
+ * that should share buffers. Allocations are served from the first page with enough room;
+ * a new page is created when none fits.
+ */
+class GeometryPool {
+  public:
+    /*!
+     * @brief Constructor for the GeometryPool.
+     *
+     * @param layout Vertex layout of every mesh stored in the pool.
+     * @param vertices_per_page Vertex capacity of newly created pages (default is 262144).
+     * @param indices_per_page Index capacity of newly created pages (default is 1048576).
+     */
+    GeometryPool(const BufferLayout &layout, unsigned int vertices_per_page = 1u << 18,
+                 unsigned int indices_per_page = 1u << 20);
+
+    /*!
+     * @brief Allocate and upload a mesh into the pool.
+     *
+     * Meshes larger than the page size get a dedicated page sized to fit them.
+     *
+     * @param vertices Pointer to the vertex data, laid out according to the pool layout.
+     * @param vertex_count Number of vertices.
+     * @param indices Pointer to the index data, relative to the first vertex.
+     * @param index_count Number of indices.
+     * @return Allocation handle, or nullptr if the mesh is empty.
+     */
+    std::shared_ptr<GeometryAllocation> allocate(const void *vertices, unsigned int vertex_count,
+                                                 const unsigned int *indices, unsigned int index_count);
+
+    /*!
+     * @brief Compact every page and release pages that no longer hold any geometry.
+     *
+     * The first page is always kept so that the pool does not thrash on a single mesh.
+     */
+    void defragment();
+
+    //! @brief Get the vertex layout of the pool.
+    inline const BufferLayout &get_layout() const { return m_layout; }
+
+    //! @brief Get the pages of the pool.
+    inline const std::vector<std::shared_ptr<GeometryPage>> &get_pages() const { return m_pages; }
+
+    //! @brief Get the number of pages in the pool.
+    inline unsigned int get_page_count() const { return static_cast<unsigned int>(m_pages.size()); }
+
+  private:
+    //! @brief Vertex layout of the pool.
+    BufferLayout m_layout;
+
+    //! @brief Vertex capacity of new pages.
+    unsigned int m_vertices_per_page;
+
+    //! @brief Index capacity of new pages.
+    unsigned int m_indices_per_page;
+
+    //! @brief Pages owned by the pool.
+    std::vector<std::shared_ptr<GeometryPage>> m_pages;
+};
+
+} // namespace renderer
+
+} // namespace lmgl
@@ -0,0 +1,151 @@
+/*!
+ * @file program_cache.hpp
+ * @brief On-disk cache of linked shader program binaries.
+ *
+ * Compiling and linking GLSL is the largest part of startup once the PBR shader and its
+ * variants are loaded. This header defines ProgramCache, which stores the binary the
+ * driver returns for a linked program and hands it back to glProgramBinary on the next
+ * run, so that only programs whose source or driver changed are compiled again.
+ *
+ * \copyright{Copyright (c) 2026 Luca Mazza. All rights reserved.}
+ * \license{This project is released under the MIT License.}
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace lmgl {
+
+namespace renderer {
+
+/*!
+ * @brief Counters and timings of the program cache, to measure what it saves at startup.
+ */
+struct ProgramCacheStats {
+    size_t hits = 0;         //!< Programs loaded from their binary
+    size_t misses = 0;       //!< Programs compiled and linked from source
+    size_t rejected = 0;     //!< Cache files the driver refused, compiled again
+    double load_ms = 0.0;    //!< Time spent loading binaries, in milliseconds
+    double compile_ms = 0.0; //!< Time spent compiling and linking, until polled done when asynchronous, in ms
+};
+
+/*!
+ * @brief Stores linked programs as glGetProgramBinary blobs, one file per program.
+ *
+ * Files are named after a key hashing the source of every stage together with the vendor,
+ * renderer and version strings of the driver, so editing a shader, or updating the driver,
+ * picks a new file. A binary the driver rejects anyway is deleted and the program is built
+ * from source, so a stale cache never breaks a shader. The cache is disabled when the
+ * directory is empty or the driver supports no binary format.
+ */
+class ProgramCache {
+  public:
+    //! @brief Version of the file format, bump it whenever the layout changes.
+    static constexpr uint32_t VERSION = 1;
+
+    /*!
+     * @brief Sets the directory holding the cache files.
+     *
+     * @param directory Directory, created on the first write; empty disables the cache.
+     */
+    static void set_directory(const std::string &directory);
+
+    /*!
+     * @brief Getter for the directory holding the cache files.
+     *
+     * @return The directory, ".lmgl_cache/programs" by default.
+     */
+    static const std::string &get_directory();
+
+    /*!
+     * @brief Check if programs are read from and written to the cache.
+     *
+     * Needs a current context.
+     *
+     * @return True if a directory is set and the driver supports a binary format.
+     */
+    static bool is_enabled();
+
+    /*!
+     * @brief Builds the key of a program.
+     *
+     * @param sources Source of every stage, in pipeline order.
+     * @return Hash of the sources and, with a current context, of the driver strings.
+     */
+    static uint64_t make_key(const std::vector<std::string> &sources);
+
+    /*!
+     * @brief Get the cache file of a key.
+     *
+     * @param key Key of the program.
+     * @return Path inside the cache directory.
+     */
+    static std::string get_cache_path(uint64_t key);
+
+    /*!
+     * @brief Creates a program from its cached binary.
+     *
+     * Counts a hit, and the time it took, on success.
+     *
+     * @param key Key of the program.
+     * @return The linked program, 0 if there is no file or the driver rejects it.
+     */
+    static unsigned int load(uint64_t key);
+
+    /*!
+     * @brief Writes the binary of a linked program to the cache.
+     *
+     * The file is written next to its final path and renamed, so readers never see a
+     * partial file.
+     *
+     * @param key Key of the program.
+     * @param program The linked program.
+     * @return True on success.
+     */
+    static bool store(uint64_t key, unsigned int program);
+
+    /*!
+     * @brief Loads a program from the cache, or builds and stores it.
+     *
+     * Times both paths in the stats, builds also while the cache is disabled.
+     *
+     * @param sources Source of every stage, in pipeline order.
+     * @param build Compiles and links the program from the sources, returns 0 on failure.
+     * @return The linked program, 0 if building failed.
+     */
+    static unsigned int get_or_build(const std::vector<std::string> &sources,
+                                     const std::function<unsigned int()> &build);
+
+    /*!
+     * @brief Counts a program built from source outside get_or_build(), as asynchronous builds are.
+     *
+     * @param milliseconds Time the build took.
+     */
+    static void record_build(double milliseconds);
+
+    /*!
+     * @brief Getter for the cache counters.
+     *
+     * @return Hits, misses, rejected files and the time spent on each path.
+     */
+    static const ProgramCacheStats &get_stats();
+
+    //! @brief Resets the cache counters.
+    static void reset_stats();
+
+  private:
+    //! Directory holding the cache files
+    static std::string s_directory;
+
+    //! Counters and timings
+    static ProgramCacheStats s_stats;
+};
+
+} // namespace renderer
+
+} // namespace lmgl
@@ -13,6 +13,7 @@
 
 #pragma once
 
+#include "lmgl/renderer/capabilities.hpp"
 #include "lmgl/renderer/framebuffer.hpp"
 #include "lmgl/renderer/shadow_map.hpp"
 #include "lmgl/scene/camera.hpp"
@@ -205,16 +206,144 @@ class Renderer {
      * @brief Configure shadow rendering for the scene.
      *
      * Call this before rendering to automatically handle shadow maps.
-     * The renderer will create shadow maps for directional and/or point lights if enabled.
+     * Only lights with Light::casts_shadows() are shadowed: the first such directional light
+     * renders into cascades, every such spot and point light into tiles of the shadow atlas.
      *
      * @param scene The scene to render shadows for.
      * @param shader The PBR shader to bind shadow uniforms to.
-     * @param enable_point Enable point light shadows (default true).
+     * @param enable_point Enable spot and point light shadows (default true).
      * @param enable_directional Enable directional light shadows (default true).
      */
     void setup_shadows(std::shared_ptr<scene::Scene> scene, std::shared_ptr<Shader> shader, 
                       bool enable_point = true, bool enable_directional = true);
 
+    /*!
+     * @brief Configure shadow rendering for the scene, fitting directional shadows to a camera.
+     *
+     * The directional light renders into cascades covering slices of the camera frustum, up to
+     * the max distance of the cascaded map, so resolution follows what the camera sees. Atlas
+     * tiles are sized by how much of the screen each light covers from the camera.
+     *
+     * @param scene The scene to render shadows for.
+     * @param shader The PBR shader to bind shadow uniforms to.
+     * @param camera The camera the scene is rendered with, null for a fixed box at the origin.
+     * @param enable_point Enable spot and point light shadows (default true).
+     * @param enable_directional Enable directional light shadows (default true).
+     */
+    void setup_shadows(std::shared_ptr<scene::Scene> scene, std::shared_ptr<Shader> shader,
+                       std::shared_ptr<scene::Camera> camera, bool enable_point = true,
+                       bool enable_directional = true);
+
+    /*!
+     * @brief Set the number of directional shadow cascades.
+     *
+     * @param count Number of cascades, clamped to 1..CascadedShadowMap::MAX_CASCADES (default 3).
+     */
+    void set_shadow_cascades(unsigned int count);
+
+    /*!
+     * @brief Get the cascaded shadow map of the directional light.
+     *
+     * @return The map, null until setup_shadows() rendered a directional light.
+     */
+    inline std::shared_ptr<CascadedShadowMap> get_cascaded_shadow_map() const { return m_shadow_map; }
+
+    /*!
+     * @brief Set the size of the shadow atlas shared by spot and point lights.
+     *
+     * The atlas is created again on the next setup_shadows().
+     *
+     * @param size Width and height in pixels, rounded down to a power of two (default 4096).
+     */
+    void set_shadow_atlas_size(unsigned int size);
+
+    /*!
+     * @brief Get the shadow atlas of the spot and point lights.
+     *
+     * @return The atlas, null until setup_shadows() rendered a spot or point light.
+     */
+    inline std::shared_ptr<ShadowAtlas> get_shadow_atlas() const { return m_shadow_atlas; }
+
+    /*!
+     * @brief Get the shadow renderer, to configure caster culling and LOD or read its counters.
+     *
+     * Created on first use.
+     *
+     * @return The shadow renderer used by setup_shadows().
+     */
+    ShadowRenderer &get_shadow_renderer();
+
+    /*!
+     * @brief Enable or disable multi-draw indirect submission.
+     *
+     * When enabled and supported by the context, runs of pooled meshes sharing shader,
+     * material and geometry page are submitted with a single glMultiDrawElementsIndirect.
+     * Per-draw model matrices are read from the a_InstanceModel attribute (location 6)
+     * through the command base instance. Meshes that are not pooled, or whose shader
+     * does not declare a_InstanceModel, keep using one draw call each.
+     *
+     * @param enabled True to allow indirect submission (default), false to force the per-mesh path.
+     */
+    inline void set_multi_draw_indirect(bool enabled) { m_multi_draw_indirect = enabled; }
+
+    /*!
+     * @brief Check whether multi-draw indirect submission is enabled and supported.
+     *
+     * @return True if render() will batch pooled meshes into indirect draws.
+     */
+    bool is_multi_draw_indirect_active() const;
+
+    /*!
+     * @brief Enable or disable meshlet culling.
+     *
+     * When enabled, meshes split with Mesh::build_meshlets() are culled per meshlet against
+     * the view frustum and, while face culling is on, against their normal cones. Only the
+     * visible index ranges are submitted, through glMultiDrawElements or as extra commands
+     * of the indirect batch.
+     *
+     * @param enabled True to cull meshlets (default), false to draw such meshes as a whole.
+     */
+    inline void set_meshlet_culling(bool enabled) { m_meshlet_culling = enabled; }
+
+    /*!
+     * @brief Check whether meshlet culling is enabled.
+     *
+     * @return True if meshes with meshlets are culled per meshlet.
+     */
+    inline bool is_meshlet_culling_enabled() const { return m_meshlet_culling; }
+
+    /*!
+     * @brief Get the number of triangles skipped by meshlet culling in the last render.
+     *
+     * @return Number of triangles of culled meshlets.
+     */
+    inline unsigned int get_culled_triangles_count() const { return m_culled_triangles; }
+
+    /*!
+     * @brief Sets the shader drawn in place of shaders that are still compiling.
+     *
+     * Meshes whose shader is still compiling, see Shader::compile_async(), are drawn with
+     * the fallback while it is ready itself, and skipped otherwise. It must read the vertex
+     * attributes of those meshes; a plain PBR or unlit shader built synchronously does.
+     *
+     * @param shader The fallback shader, nullptr to skip such meshes (default).
+     */
+    inline void set_fallback_shader(std::shared_ptr<Shader> shader) { m_fallback_shader = std::move(shader); }
+
+    /*!
+     * @brief Get the shader drawn in place of shaders that are still compiling.
+     *
+     * @return The fallback shader, nullptr if none.
+     */
+    inline std::shared_ptr<Shader> get_fallback_shader() const { return m_fallback_shader; }
+
+    /*!
+     * @brief Get the number of meshes whose shader was still compiling in the last render.
+     *
+     * @return Number of meshes drawn with the fallback shader or skipped.
+     */
+    inline unsigned int get_pending_shader_count() const { return m_pending_shaders; }
+
   private:
     //! @brief Current rendering mode.
     RenderMode m_render_mode;
@@ -249,6 +378,73 @@ class Renderer {
     //! Cached material to minimize state changes
     std::shared_ptr<scene::Material> m_last_bound_material;
 
+    //! Program the cached material was bound to, uniforms and samplers are per program
+    std::shared_ptr<Shader> m_last_bound_material_shader;
+
+    //! Last bound vertex array, meshes sharing a geometry pool page skip the rebind
+    const VertexArray *m_last_bound_vertex_array = nullptr;
+
+    //! Whether multi-draw indirect submission is allowed
+    bool m_multi_draw_indirect = true;
+
+    //! Whether meshes with meshlets are culled per meshlet
+    bool m_meshlet_culling = true;
+
+    //! Number of triangles skipped by meshlet culling in the last render
+    unsigned int m_culled_triangles = 0;
+
+    //! Shader drawn in place of shaders that are still compiling
+    std::shared_ptr<Shader> m_fallback_shader;
+
+    //! Number of meshes whose shader was still compiling in the last render
+    unsigned int m_pending_shaders = 0;
+
+    //! Shader::Feature bits of the scene in the current render, shadows and environment map
+    uint32_t m_scene_features = 0;
+
+    //! View frustum of the frame being rendered
+    scene::Frustum m_frustum;
+
+    //! Scratch list of visible meshlet ranges
+    std::vector<scene::MeshletRange> m_meshlet_ranges;
+
+    //! Per-draw model matrices of indirect batches, attached to pool VAOs as an instanced attribute
+    std::shared_ptr<StreamBuffer> m_instance_stream;
+
+    //! Ring holding the indirect draw commands of each frame
+    std::unique_ptr<StreamBuffer> m_command_stream;
+
+    //! Byte offset of the frame's first indirect command inside the command ring
+    unsigned int m_command_offset = 0;
+
+    //! CPU staging for per-draw model matrices
+    std::vector<glm::mat4> m_instance_transforms;
+
+    //! CPU staging for indirect draw commands
+    std::vector<DrawElementsIndirectCommand> m_indirect_commands;
+
+    //! A run of render queue items submitted with one indirect draw
+    struct IndirectBatch {
+
+        //! @brief Index of the first render item in the queue.
+        size_t first_item;
+
+        //! @brief Index of the first command in the indirect buffer.
+        unsigned int first_command;
+
+        //! @brief Number of commands in the batch.
+        unsigned int command_count;
+
+        //! @brief Number of render items covered by the batch (meshlet ranges add commands).
+        unsigned int item_count;
+
+        //! @brief Number of triangles drawn by the batch.
+        unsigned int triangles;
+    };
+
+    //! Indirect batches of the frame, ordered by first item
+    std::vector<IndirectBatch> m_indirect_batches;
+
     //! Framebuffer for postprocess effects
     std::unique_ptr<Framebuffer> m_framebuffer;
 
@@ -271,20 +467,44 @@ class Renderer {
     int m_window_width = 1920;
     int m_window_height = 1080;
 
-    //! Shadow map for directional light (lazy initialized)
-    std::shared_ptr<ShadowMap> m_shadow_map;
+    //! Cascaded shadow map for directional light (lazy initialized)
+    std::shared_ptr<CascadedShadowMap> m_shadow_map;
+
+    //! Number of directional shadow cascades
+    unsigned int m_shadow_cascades = 3;
+
+    //! Index of the shadowed light in m_directional_lights, -1 for none
+    int m_shadow_dir_light = -1;
+
+    //! Shadow atlas for spot and point lights (lazy initialized)
+    std::shared_ptr<ShadowAtlas> m_shadow_atlas;
+
+    //! Width and height of the shadow atlas
+    unsigned int m_shadow_atlas_size = 4096;
+
+    //! Lights of the last atlas pass, the bound point lights then the bound spot lights
+    std::vector<std::shared_ptr<scene::Light>> m_atlas_lights;
+
+    //! Cascade matrices of the frame
+    std::vector<glm::mat4> m_cascade_matrices;
 
-    //! Cubemap shadow map for point light (lazy initialized)
-    std::shared_ptr<CubemapShadowMap> m_cubemap_shadow_map;
+    //! Atlas rects of the frame, six per point light of m_atlas_lights
+    std::vector<glm::vec4> m_point_shadow_rects;
+
+    //! Atlas rects of the frame, one per spot light of m_atlas_lights
+    std::vector<glm::vec4> m_spot_shadow_rects;
+
+    //! Light views of the frame, one per spot light of m_atlas_lights
+    std::vector<glm::mat4> m_spot_shadow_matrices;
+
+    //! Programs the scene uniforms of the frame were bound to
+    std::vector<unsigned int> m_scene_uniform_programs;
 
     //! Shadow renderer (lazy initialized)
     std::unique_ptr<ShadowRenderer> m_shadow_renderer;
 
     //! Shadow state
     bool m_shadow_enabled = false;
-    glm::vec3 m_shadow_light_pos = glm::vec3(0.0f);
-    float m_shadow_far_plane = 1.0f;
-    glm::mat4 m_light_space_matrix = glm::mat4(1.0f);
 
     /*!
      * @brief Structure representing an item to be rendered.
@@ -308,6 +528,9 @@ class Renderer {
 
         //! @brief Flag indicating if the mesh is transparent.
         bool is_transparent;
+
+        //! @brief Shader::Feature bits of the material and the scene, selecting the shader variant.
+        uint32_t features = 0;
     };
 
     //! @brief Render queue containing items to be rendered.
@@ -363,12 +586,116 @@ class Renderer {
      * the provided transformation matrix and using the camera's
      * view and projection matrices.
      *
-     * @param mesh Shared pointer to the mesh to be rendered.
-     * @param transform Transformation matrix to be applied to the mesh.
+     * @param item The render item holding the mesh, its transformation and its features.
+     * @param camera Shared pointer to the camera used for rendering.
+     */
+    void render_mesh(const RenderItem &item, std::shared_ptr<scene::Camera> camera,
+                     std::shared_ptr<scene::Scene> scene);
+
+    /*!
+     * @brief Gathers the shadow matrices and atlas rects of the frame, uploaded by bind_scene_uniforms().
+     */
+    void prepare_scene_uniforms();
+
+    /*!
+     * @brief Binds the per-frame uniforms shared by every draw with a shader.
+     *
+     * Sets the camera position, lights, shadow maps and environment map, once per program and frame.
+     *
+     * @param shader The shader to bind uniforms to.
+     * @param camera Shared pointer to the camera used for rendering.
+     * @param scene Shared pointer to the scene being rendered.
+     */
+    void bind_scene_uniforms(std::shared_ptr<Shader> shader, std::shared_ptr<scene::Camera> camera,
+                             std::shared_ptr<scene::Scene> scene);
+
+    /*!
+     * @brief Pick the shader to draw a mesh with.
+     *
+     * @param shader The shader of the mesh.
+     * @return The shader unless still compiling, else the fallback shader if ready, else nullptr.
+     */
+    std::shared_ptr<Shader> get_ready_shader(const std::shared_ptr<Shader> &shader);
+
+    /*!
+     * @brief Pick the shader to draw a render item with.
+     *
+     * Shaders with variants draw with the variant of the item features once it is
+     * compiled, and with the generic program until then.
+     *
+     * @param item The render item.
+     * @return The shader to bind, nullptr to skip the item.
+     */
+    std::shared_ptr<Shader> get_item_shader(const RenderItem &item);
+
+    /*!
+     * @brief Get the shader features the scene enables for every draw.
+     *
+     * @param scene Shared pointer to the scene being rendered.
+     * @return Shader::Feature bits of the shadow maps and the environment map in use.
+     */
+    uint32_t get_scene_features(std::shared_ptr<scene::Scene> scene) const;
+
+    /*!
+     * @brief Get the shader features of a mesh in the current render.
+     *
+     * @param mesh The mesh.
+     * @return Bits of the mesh material combined with the scene features.
+     */
+    uint32_t get_mesh_features(const scene::Mesh &mesh) const;
+
+    /*!
+     * @brief Check whether a render item can be part of an indirect batch.
+     *
+     * The mesh must live in a geometry pool and its shader must be built and read
+     * the per-draw transform from a_InstanceModel at location 6.
+     *
+     * @param item The render item to check.
+     * @return True if the item can be drawn indirectly.
+     */
+    bool can_draw_indirect(const RenderItem &item);
+
+    /*!
+     * @brief Group the sorted render queue into indirect batches and upload their data.
+     *
+     * Consecutive items sharing shader, material and vertex array form a batch.
+     * Every batch gets one command per item, or one per visible range for meshes with
+     * meshlets, and all commands and transforms of the frame are uploaded in one go.
+     *
+     * @param camera_position World-space camera position, used by meshlet culling.
+     */
+    void build_indirect_batches(const glm::vec3 &camera_position);
+
+    /*!
+     * @brief Cull the meshlets of a mesh into m_meshlet_ranges.
+     *
+     * @param mesh Mesh with meshlets.
+     * @param transform Model matrix of the mesh.
+     * @param camera_position World-space camera position.
+     * @return Number of visible triangles.
+     */
+    unsigned int cull_mesh_meshlets(const scene::Mesh &mesh, const glm::mat4 &transform,
+                                    const glm::vec3 &camera_position);
+
+    /*!
+     * @brief Request mip levels of streamed textures from the render queue.
+     *
+     * Each mesh asks for the level matching the on-screen size of its bounding sphere,
+     * assuming its texture spans the mesh once.
+     *
+     * @param camera Shared pointer to the camera used for rendering.
+     */
+    void request_texture_levels(std::shared_ptr<scene::Camera> camera);
+
+    /*!
+     * @brief Submit one indirect batch.
+     *
+     * @param batch The batch to draw.
      * @param camera Shared pointer to the camera used for rendering.
+     * @param scene Shared pointer to the scene being rendered.
      */
-    void render_mesh(std::shared_ptr<scene::Mesh> mesh, const glm::mat4 &transform,
-                     std::shared_ptr<scene::Camera> camera, std::shared_ptr<scene::Scene> scene);
+    void render_indirect_batch(const IndirectBatch &batch, std::shared_ptr<scene::Camera> camera,
+                               std::shared_ptr<scene::Scene> scene);
 
     /*!
      * @brief Apply the current render mode settings.
@@ -403,7 +730,7 @@ class Renderer {
      * @brief Binds a material if it differs from the last bound material.
      *
      * This method implements material caching to avoid redundant state changes.
-     * It only binds the material if it is different from the previously bound one.
+     * It only binds the material if it, or the shader it is bound to, differs from the previous one.
      *
      * @param material The material to bind.
      * @param shader The shader to use.
@@ -13,10 +13,14 @@
 
 #pragma once
 
+#include "lmgl/core/resource_cache.hpp"
+
+#include <cstdint>
 #include <glm/glm.hpp>
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace lmgl {
@@ -30,9 +34,53 @@ namespace renderer {
  * shader programs consisting of vertex and fragment shaders. It provides an interface
  * for loading shader source code, compiling it, and linking it into a usable program
  * for rendering graphics.
+ *
+ * Linked programs go through the ProgramCache: a program whose sources were linked on a
+ * previous run, with the same driver, is loaded from its binary instead of compiled.
+ *
+ * The compile_async() factories submit every stage and the link without waiting for the
+ * driver, so that many programs compile at once on drivers with KHR_parallel_shader_compile.
+ * Such a shader reports State::Compiling until poll() finds the link complete; binding it,
+ * or querying its uniforms and attributes, waits for the link instead.
+ *
+ * Shaders read from files go through a small preprocessor: `#include "file"` pastes a file,
+ * resolved relative to the including one, and the defines passed to the factories are added
+ * after the `#version` line of every stage. from_glsl_file_with_variants() uses it to build
+ * specialized variants of an uber-shader, see get_variant().
  */
 class Shader {
   public:
+    //! @brief Build state of a shader program.
+    enum class State {
+        Compiling, //!< Submitted to the driver, not linked yet
+        Ready,     //!< Linked and usable
+        Failed     //!< Compiling or linking failed, the program id is 0
+    };
+
+    /*!
+     * @brief Features a shader can be specialized for, as bits of a feature mask.
+     *
+     * A variant is compiled with LMGL_VARIANT defined, and the define of get_feature_define()
+     * for every bit of its mask, so that the shader resolves its feature checks at compile time.
+     */
+    enum Feature : uint32_t {
+        AlbedoMap = 1u << 0,         //!< FEATURE_ALBEDO_MAP, the material has an albedo map
+        NormalMap = 1u << 1,         //!< FEATURE_NORMAL_MAP, the material has a normal map
+        MetallicMap = 1u << 2,       //!< FEATURE_METALLIC_MAP, the material has a metallic map
+        RoughnessMap = 1u << 3,      //!< FEATURE_ROUGHNESS_MAP, the material has a roughness map
+        AoMap = 1u << 4,             //!< FEATURE_AO_MAP, the material has an ambient occlusion map
+        EmissiveMap = 1u << 5,       //!< FEATURE_EMISSIVE_MAP, the material has an emissive map
+        DirectionalShadow = 1u << 6, //!< FEATURE_DIRECTIONAL_SHADOW, the scene casts directional shadows
+        PointShadow = 1u << 7,       //!< FEATURE_POINT_SHADOW, spot and point lights cast shadows in the atlas
+        EnvironmentMap = 1u << 8     //!< FEATURE_ENVIRONMENT_MAP, the scene has an environment map
+    };
+
+    //! @brief Number of bits in Feature.
+    static constexpr unsigned int FEATURE_COUNT = 9;
+
+    //! @brief Every feature, the mask of an uber-shader that checks them all.
+    static constexpr uint32_t ALL_FEATURES = (1u << FEATURE_COUNT) - 1;
+
     /*!
      * @brief Creates a shader program from vertex and fragment shader source code.
      *
@@ -90,9 +138,134 @@ class Shader {
      * Also supports optional geometry shader with #shader geometry directive.
      *
      * @param glsl The file path to the GLSL shader source code.
+     * @param defines Macros defined in every stage, as a name or "NAME value".
      * @return A shared pointer to the created Shader instance.
      */
-    static std::shared_ptr<Shader> from_glsl_file(const std::string &glsl);
+    static std::shared_ptr<Shader> from_glsl_file(const std::string &glsl,
+                                                  const std::vector<std::string> &defines = {});
+
+    /*!
+     * @brief Creates an uber-shader from a GLSL file, able to build specialized variants of itself.
+     *
+     * The shader itself is compiled without LMGL_VARIANT, so it checks every feature at run
+     * time and works for any mask; get_variant() compiles the specialized ones on demand.
+     *
+     * @param glsl The file path to the GLSL shader source code.
+     * @param features Features the variants are specialized for, other bits of a mask are ignored.
+     * @return A shared pointer to the created Shader instance, nullptr if the file is invalid.
+     */
+    static std::shared_ptr<Shader> from_glsl_file_with_variants(const std::string &glsl,
+                                                                uint32_t features = ALL_FEATURES);
+
+    /*!
+     * @brief Submits a program from vertex and fragment shader source code, without waiting for it.
+     *
+     * Programs in the ProgramCache are loaded right away and start out ready.
+     *
+     * @param vert The source code for the vertex shader.
+     * @param frag The source code for the fragment shader.
+     * @return A shared pointer to the Shader, compiling or ready.
+     */
+    static std::shared_ptr<Shader> compile_async(const std::string &vert, const std::string &frag);
+
+    /*!
+     * @brief Submits a program with vertex, geometry, and fragment shaders, without waiting for it.
+     *
+     * @param vert The source code for the vertex shader.
+     * @param geom The source code for the geometry shader.
+     * @param frag The source code for the fragment shader.
+     * @return A shared pointer to the Shader, compiling or ready.
+     */
+    static std::shared_ptr<Shader> compile_async(const std::string &vert, const std::string &geom,
+                                                 const std::string &frag);
+
+    /*!
+     * @brief Submits a program from a single GLSL file, without waiting for it.
+     *
+     * @param glsl The file path to the GLSL shader source code.
+     * @param defines Macros defined in every stage, as a name or "NAME value".
+     * @return A shared pointer to the Shader, nullptr if the file is not a valid GLSL shader file.
+     */
+    static std::shared_ptr<Shader> from_glsl_file_async(const std::string &glsl,
+                                                        const std::vector<std::string> &defines = {});
+
+    /*!
+     * @brief Runs the preprocessor on the source of one stage.
+     *
+     * Expands `#include "file"` lines, recursively and at most once per file, then adds a
+     * `#define` for every entry of defines right after the `#version` line.
+     *
+     * @param src The source code of the stage.
+     * @param directory Directory that includes of src are relative to.
+     * @param defines Macros to define, as a name or "NAME value".
+     * @return The preprocessed source.
+     */
+    static std::string preprocess(const std::string &src, const std::string &directory,
+                                  const std::vector<std::string> &defines = {});
+
+    /*!
+     * @brief Get the macro a variant defines for a feature.
+     *
+     * @param feature A single feature bit.
+     * @return The name of the macro, e.g. "FEATURE_ALBEDO_MAP".
+     */
+    static const char *get_feature_define(Feature feature);
+
+    /*!
+     * @brief Checks whether the shader builds specialized variants.
+     *
+     * @return True if it was created by from_glsl_file_with_variants().
+     */
+    inline bool has_variants() const { return m_variants != nullptr; }
+
+    /*!
+     * @brief Getter for the features the variants are specialized for.
+     *
+     * @return The feature mask, 0 without variants.
+     */
+    uint32_t get_variant_features() const;
+
+    /*!
+     * @brief Get the variant specialized for a feature mask, compiling it on first use.
+     *
+     * Variants compile asynchronously; until one is ready, or if it failed, the caller
+     * keeps drawing with this shader, which handles every mask at run time.
+     *
+     * @param features Feature mask of the draw, masked to get_variant_features().
+     * @return The ready variant, nullptr while it compiles, if it failed or without variants.
+     */
+    std::shared_ptr<Shader> get_variant(uint32_t features);
+
+    /*!
+     * @brief Getter for the number of variants requested so far.
+     *
+     * @return Number of variants, compiling, ready or failed.
+     */
+    size_t get_variant_count() const;
+
+    /*!
+     * @brief Checks whether the driver finished building the program.
+     *
+     * Never blocks when the context supports KHR_parallel_shader_compile; without it, the
+     * first poll waits for the link. Compile and link errors are printed once known.
+     *
+     * @return The build state of the program.
+     */
+    State poll() const;
+
+    /*!
+     * @brief Checks whether the program can be used for rendering, see poll().
+     *
+     * @return True if the program is linked.
+     */
+    inline bool is_ready() const { return poll() == State::Ready; }
+
+    /*!
+     * @brief Waits for the driver to finish building the program.
+     *
+     * @return The final build state, Ready or Failed.
+     */
+    State wait() const;
 
     /*!
      * @brief Binds the shader program for use in rendering.
@@ -111,10 +284,32 @@ class Shader {
     /*!
      * @brief Retrieves the unique identifier of the shader program.
      *
-     * @return The OpenGL-assigned ID of the shader program.
+     * Does not wait for an asynchronous build, whose program already has its ID.
+     *
+     * @return The OpenGL-assigned ID of the shader program, 0 if building it failed.
      */
     unsigned int get_id() const;
 
+    /*!
+     * @brief Retrieves the location of a vertex attribute in the shader program.
+     *
+     * The result is cached, including for attributes that are not active.
+     *
+     * @param name The name of the attribute.
+     * @return The attribute location, or -1 if the attribute is not active.
+     */
+    int get_attribute_location(const std::string &name) const;
+
+    /*!
+     * @brief Checks whether the shader program has an active uniform.
+     *
+     * Unlike the setters, a missing uniform does not print a warning.
+     *
+     * @param name The name of the uniform.
+     * @return True if the uniform is active.
+     */
+    bool has_uniform(const std::string &name) const;
+
     /*!
      * @brief Sets an integer uniform variable in the shader program.
      *
@@ -164,6 +359,15 @@ class Shader {
      */
     void set_vec4(const std::string &name, const glm::vec4 &val);
 
+    /*!
+     * @brief Sets an array of vec4 uniform variables in the shader program, in a single call.
+     *
+     * @param name The name of the uniform array.
+     * @param vals Pointer to the first value.
+     * @param count The number of values in the array.
+     */
+    void set_vec4_array(const std::string &name, const glm::vec4 *vals, unsigned int count);
+
     /*!
      * @brief Sets a mat3 uniform variable in the shader program.
      *
@@ -180,23 +384,85 @@ class Shader {
      */
     void set_mat4(const std::string &name, const glm::mat4 &val);
 
+    /*!
+     * @brief Sets an array of mat4 uniform variables in the shader program, in a single call.
+     *
+     * @param name The name of the uniform array.
+     * @param vals Pointer to the first matrix.
+     * @param count The number of matrices in the array.
+     */
+    void set_mat4_array(const std::string &name, const glm::mat4 *vals, unsigned int count);
+
   private:
-    //! Caches uniform locations to optimize performance
-    unsigned int m_renderer_id;
+    //! @brief Stages and timing of a build still running in the driver.
+    struct PendingBuild;
+
+    //! @brief Preprocessed stages and built variants of an uber-shader.
+    struct VariantSet;
+
+    //! OpenGL ID of the program, reset to 0 when an asynchronous build fails
+    mutable unsigned int m_renderer_id = 0;
+
+    //! Build state of the program
+    mutable State m_state = State::Ready;
+
+    //! Build still running in the driver, nullptr once finished
+    mutable std::unique_ptr<PendingBuild> m_pending;
+
+    //! Variants of the shader, nullptr unless it was created with from_glsl_file_with_variants()
+    std::unique_ptr<VariantSet> m_variants;
 
-    //! Cache for uniform locations
+    //! True for variants, whose compiled out uniforms are expected to be missing
+    bool m_is_variant = false;
+
+    //! Cache for uniform locations, including -1 for uniforms that are not active
     mutable std::unordered_map<std::string, int> m_uniform_location_cache;
 
+    //! Cache for attribute locations
+    mutable std::unordered_map<std::string, int> m_attribute_location_cache;
+
     /*!
      * @brief Retrieves the location of a uniform variable in the shader program.
      *
      * Caches the location to avoid redundant OpenGL calls for performance optimization.
+     * A missing uniform is cached too, and only warned about the first time.
      *
      * @param name The name of the uniform variable.
      * @return The location of the uniform variable.
      */
     int get_uniform_location(const std::string &name) const;
 
+    //! @brief Creates an empty shader, for the asynchronous factories.
+    Shader();
+
+    /*!
+     * @brief Submits the compilation of every stage and the link of the program.
+     *
+     * @param types The type of every stage (e.g., GL_VERTEX_SHADER).
+     * @param sources The source code of every stage.
+     */
+    void submit(const std::vector<unsigned int> &types, const std::vector<std::string> &sources);
+
+    //! @brief Checks the result of a submitted build, stores it in the cache and frees its stages.
+    void finish() const;
+
+    /*!
+     * @brief Checks the compile status of a shader, printing its log on failure.
+     *
+     * @param shader The shader ID.
+     * @param type The type of shader, for the message.
+     * @return True if the shader compiled.
+     */
+    static bool check_compile_status(unsigned int shader, unsigned int type);
+
+    /*!
+     * @brief Checks the link status of a program, printing its log on failure.
+     *
+     * @param program The program ID.
+     * @return True if the program linked.
+     */
+    static bool check_link_status(unsigned int program);
+
     /*!
      * @brief Compiles a shader of the specified type from source code.
      *
@@ -242,6 +508,27 @@ class Shader {
      */
     static std::string read_file(const std::string &fpath);
 
+    /*!
+     * @brief Expands the include lines of a source, see preprocess().
+     *
+     * @param src The source code.
+     * @param directory Directory that includes of src are relative to.
+     * @param included Files already pasted, which are skipped.
+     * @param depth Nesting depth of src, to stop include cycles.
+     * @return The source with every include expanded.
+     */
+    static std::string expand_includes(const std::string &src, const std::string &directory,
+                                       std::vector<std::string> &included, int depth);
+
+    /*!
+     * @brief Reads a GLSL file and preprocesses every stage of it.
+     *
+     * @param glsl The file path to the GLSL shader source code.
+     * @param defines Macros defined in every stage.
+     * @return The stages, empty if the file is not a valid GLSL shader file.
+     */
+    static std::vector<std::string> load_glsl_stages(const std::string &glsl, const std::vector<std::string> &defines);
+
     /*!
      * @brief Parses a GLSL shader source code into shader components.
      *
@@ -261,6 +548,13 @@ class Shader {
  * and retrieve shader programs used in rendering operations.
  * It serves as a centralized repository for shaders, allowing
  * easy access and management of multiple shader programs.
+ *
+ * Programs are measured by the size of their linked binary. Without a budget, the
+ * default, nothing is evicted; with one, the least recently used programs that nobody
+ * else holds are deleted, and get() reports them as not found.
+ *
+ * warm_up() submits a whole set of programs at once, e.g. at the start of a level load,
+ * so that the driver compiles them in parallel while the level streams in.
  */
 class ShaderLibrary {
   public:
@@ -299,6 +593,30 @@ class ShaderLibrary {
      */
     static std::shared_ptr<Shader> load_glsl(const std::string &name, const std::string &src);
 
+    /*!
+     * @brief Submits GLSL files for asynchronous compilation and adds them to the library.
+     *
+     * Returns right away: get() hands out the shaders while they compile, and the renderer
+     * draws with its fallback shader, or skips, until they are ready. Names already in the
+     * library are kept as they are.
+     *
+     * @param shaders Pairs of library name and GLSL file path.
+     * @return Number of shaders submitted.
+     */
+    static size_t warm_up(const std::vector<std::pair<std::string, std::string>> &shaders);
+
+    /*!
+     * @brief Checks the shaders submitted by warm_up(), without blocking.
+     *
+     * Shaders that failed to build are removed from the library.
+     *
+     * @return Number of shaders still compiling.
+     */
+    static size_t poll();
+
+    //! @brief Waits for every shader submitted by warm_up().
+    static void finish();
+
     /*!
      * @brief Retrieve a shader program from the library by name.
      *
@@ -324,9 +642,40 @@ class ShaderLibrary {
      */
     static void clear();
 
+    /*!
+     * @brief Sets the memory budget of the library.
+     *
+     * Evicts unused shader programs down to the budget right away.
+     *
+     * @param bytes The budget in bytes, 0 for no limit.
+     */
+    static void set_budget(size_t bytes);
+
+    /*!
+     * @brief Getter for the memory budget of the library.
+     *
+     * @return The budget in bytes, 0 when unlimited.
+     */
+    static size_t get_budget();
+
+    /*!
+     * @brief Getter for the library counters.
+     *
+     * Hits and misses count get() calls.
+     *
+     * @return Resident bytes, hits, misses and evictions.
+     */
+    static const core::CacheStats &get_stats();
+
+    //! @brief Resets hits, misses and evictions.
+    static void reset_stats();
+
   private:
-    //! Static map storing shader programs by name
-    static std::unordered_map<std::string, std::shared_ptr<Shader>> s_shaders;
+    //! Static cache storing shader programs by name
+    static core::ResourceCache<Shader> s_shaders;
+
+    //! Shaders submitted by warm_up() that are still compiling
+    static std::vector<std::pair<std::string, std::shared_ptr<Shader>>> s_pending;
 };
 
 } // namespace renderer
@@ -0,0 +1,272 @@
+/*!
+ * @file shadow_atlas.hpp
+ * @brief Depth atlas shared by the shadows of spot and point lights.
+ *
+ * A single depth texture of fixed size is partitioned again on every frame among the lights
+ * casting shadows: one square tile per spot light and six per point light, one for each cube
+ * face. Lights that cover more of the screen get larger tiles, so the memory footprint stays
+ * the same whatever the number of lights. A second texture of the same layout caches the depth
+ * of static casters, copied into a tile before dynamic casters are drawn over it.
+ *
+ * \copyright{Copyright (c) 2026 Luca Mazza. All rights reserved.}
+ * \license{This project is released under the MIT License.}
+ */
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace lmgl {
+
+namespace renderer {
+
+/*!
+ * @brief A square region of the atlas and the light view rendered into it.
+ */
+struct ShadowAtlasTile {
+    unsigned int x = 0;                 //!< Left edge, in pixels
+    unsigned int y = 0;                 //!< Bottom edge, in pixels
+    unsigned int size = 0;              //!< Width and height, in pixels
+    glm::mat4 light_space_matrix{1.0f}; //!< Projection of the light view rendered into the tile
+};
+
+/*!
+ * @brief What the depth of a tile was rendered from, like ShadowCacheState for one slice.
+ *
+ * Each key hashes the region and the light view of the tile, plus the meshes and world
+ * transforms of the static or the dynamic casters reaching it.
+ */
+struct ShadowAtlasTileCache {
+    uint64_t light_key = 0;      //!< Region and light view the static depth was rendered with, 0 for never
+    uint64_t static_key = 0;     //!< Static casters and light view of the cached static depth
+    uint64_t dynamic_key = 0;    //!< Dynamic casters and light view composited over the static depth
+    unsigned int next_slice = 0; //!< On the first tile of a light, the tile time slicing looks at first
+};
+
+/*!
+ * @brief The tiles a light asks of the atlas for one frame.
+ */
+struct ShadowAtlasRequest {
+    unsigned int tile_size = 0;  //!< Wanted size of each tile, rounded to a power of two within the atlas limits
+    unsigned int tile_count = 1; //!< Tiles of the light, 1 for a spot light and 6 for a point light
+};
+
+/*!
+ * @brief Depth texture partitioned into power-of-two tiles, one set per shadowed light.
+ *
+ * allocate() packs the tiles from the largest down in Z-order, so power-of-two squares fill the
+ * atlas without gaps. When they do not fit, the largest tiles are halved first, down to the
+ * minimum size, then the requests with the smallest tiles are dropped. Equal requests get the
+ * same tiles on every frame, which lets the shadow renderer keep the depth of tiles whose light
+ * and casters did not change.
+ *
+ * @note The default atlas is 4096x4096 pixels, with tiles from 128 to 1024 pixels, and takes
+ * 128 MB with its static cache.
+ */
+class ShadowAtlas {
+  public:
+    /*!
+     * @brief Constructs a ShadowAtlas and its depth texture.
+     *
+     * @param size Width and height of the atlas, in pixels, rounded down to a power of two.
+     * @param min_tile_size Smallest tile, rounded down to a power of two no larger than the atlas.
+     * @param max_tile_size Largest tile, rounded down to a power of two between the smallest tile and the atlas.
+     */
+    ShadowAtlas(unsigned int size = 4096, unsigned int min_tile_size = 128, unsigned int max_tile_size = 1024);
+
+    //! @brief Destructor for ShadowAtlas.
+    ~ShadowAtlas();
+
+    /*!
+     * @brief Partitions the atlas among the requests of a frame.
+     *
+     * @param requests One request per light, in the order of the lights.
+     * @return Index of the first tile of each request, its tiles being consecutive, -1 if it was dropped.
+     */
+    const std::vector<int> &allocate(const std::vector<ShadowAtlasRequest> &requests);
+
+    /*!
+     * @brief Picks the tile size for a light covering part of the screen.
+     *
+     * @param screen_size Size of the light volume on screen, in pixels.
+     * @return The next power of two, clamped to the tile limits of the atlas.
+     */
+    unsigned int get_tile_size(float screen_size) const;
+
+    /*!
+     * @brief Binds the framebuffer object and clears one tile for rendering.
+     *
+     * Sets the viewport and the scissor box to the tile; unbind() disables the scissor test.
+     *
+     * @param tile Index of the tile.
+     */
+    void bind_tile(unsigned int tile);
+
+    /*!
+     * @brief Binds the static depth cache and clears one of its tiles for rendering static casters.
+     *
+     * Sets the viewport and the scissor box to the tile, like bind_tile().
+     *
+     * @param tile Index of the tile.
+     */
+    void bind_static_tile(unsigned int tile);
+
+    /*!
+     * @brief Copies the static depth of a tile into the atlas and binds the tile to draw dynamic casters over it.
+     *
+     * Sets the viewport and the scissor box to the tile, like bind_tile().
+     *
+     * @param tile Index of the tile.
+     */
+    void composite_tile(unsigned int tile);
+
+    //! @brief Unbinds the framebuffer object and disables the scissor test.
+    void unbind();
+
+    /*!
+     * @brief Binds the depth texture of the atlas to a texture slot for use in shaders.
+     *
+     * @param slot The texture slot to bind to. Default is 0.
+     */
+    void bind_texture(unsigned int slot = 0) const;
+
+    /*!
+     * @brief Getter for a tile of the current frame.
+     *
+     * @param tile Index of the tile.
+     * @return The tile.
+     */
+    inline const ShadowAtlasTile &get_tile(unsigned int tile) const { return m_tiles[tile]; }
+
+    /*!
+     * @brief Records the light view rendered into a tile.
+     *
+     * @param tile Index of the tile.
+     * @param matrix Projection and view of the light.
+     */
+    inline void set_tile_matrix(unsigned int tile, const glm::mat4 &matrix) {
+        m_tiles[tile].light_space_matrix = matrix;
+    }
+
+    /*!
+     * @brief Get the region of a tile in texture coordinates.
+     *
+     * @param tile Index of the tile.
+     * @return Left and bottom edges, then width and height.
+     */
+    glm::vec4 get_tile_rect(unsigned int tile) const;
+
+    /*!
+     * @brief Get the number of tiles of the current frame.
+     *
+     * @return The number of tiles.
+     */
+    inline unsigned int get_tile_count() const { return static_cast<unsigned int>(m_tiles.size()); }
+
+    /*!
+     * @brief Get the first tile of a request of the current frame.
+     *
+     * @param request Index of the request passed to allocate().
+     * @return Index of the first tile, -1 if the request was dropped or does not exist.
+     */
+    int get_first_tile(unsigned int request) const;
+
+    /*!
+     * @brief Getter for what the depth of a tile was rendered from.
+     *
+     * @param tile Index of the tile.
+     * @return The cache state of the tile, updated by ShadowRenderer.
+     */
+    inline ShadowAtlasTileCache &get_tile_cache(unsigned int tile) { return m_tile_caches[tile]; }
+
+    //! @brief Renders every tile again on the next frame.
+    void invalidate();
+
+    /*!
+     * @brief Returns the OpenGL texture ID of the depth texture.
+     *
+     * @return The texture ID.
+     */
+    inline unsigned int get_texture_id() const { return m_depth_map; }
+
+    /*!
+     * @brief Returns the OpenGL framebuffer object ID.
+     *
+     * @return The FBO ID.
+     */
+    inline unsigned int get_fbo() const { return m_fbo; }
+
+    /*!
+     * @brief Returns the depth texture caching static casters.
+     *
+     * @return The texture ID.
+     */
+    inline unsigned int get_static_texture_id() const { return m_static_depth_map; }
+
+    /*!
+     * @brief Returns the width and height of the atlas.
+     *
+     * @return The size in pixels.
+     */
+    inline unsigned int get_size() const { return m_size; }
+
+    /*!
+     * @brief Returns the smallest tile size.
+     *
+     * @return The size in pixels.
+     */
+    inline unsigned int get_min_tile_size() const { return m_min_tile_size; }
+
+    /*!
+     * @brief Returns the largest tile size.
+     *
+     * @return The size in pixels.
+     */
+    inline unsigned int get_max_tile_size() const { return m_max_tile_size; }
+
+  private:
+    //! Framebuffer object ID
+    unsigned int m_fbo = 0;
+
+    //! Depth texture ID
+    unsigned int m_depth_map = 0;
+
+    //! Framebuffer object of the static depth cache
+    unsigned int m_static_fbo = 0;
+
+    //! Depth texture caching static casters, with the layout of the atlas
+    unsigned int m_static_depth_map = 0;
+
+    //! Width and height of the atlas
+    unsigned int m_size;
+
+    //! Smallest tile size
+    unsigned int m_min_tile_size;
+
+    //! Largest tile size
+    unsigned int m_max_tile_size;
+
+    //! Tiles of the current frame, the tiles of a request being consecutive
+    std::vector<ShadowAtlasTile> m_tiles;
+
+    //! First tile of each request of the current frame, -1 when dropped
+    std::vector<int> m_first_tiles;
+
+    //! What each tile was last rendered from
+    std::vector<ShadowAtlasTileCache> m_tile_caches;
+
+    /*!
+     * @brief Binds a framebuffer object, with the viewport and the scissor box on a tile.
+     *
+     * @param fbo The framebuffer object.
+     * @param tile Index of the tile.
+     */
+    void bind_region(unsigned int fbo, unsigned int tile);
+};
+
+} // namespace renderer
+
+} // namespace lmgl
@@ -1,10 +1,12 @@
 /*!
  * @file shadow_map.hpp
- * @brief This file contains the ShadowMap, CubemapShadowMap, and ShadowRenderer classes for rendering shadows in a 3D
- * scene.
+ * @brief This file contains the ShadowMap, CascadedShadowMap, CubemapShadowMap, and ShadowRenderer classes for
+ * rendering shadows in a 3D scene.
  *
  * ShadowMap class manages a 2D depth texture for directional light shadows.
+ * CascadedShadowMap class manages a layered depth texture for directional light shadows fitted to the camera.
  * CubemapShadowMap class manages a cubemap depth texture for point light shadows.
+ * ShadowAtlas, in shadow_atlas.hpp, shares one depth texture among many spot and point lights.
  * ShadowRenderer class provides methods to render shadows for directional and point lights using the respective shadow
  * maps.
  *
@@ -14,13 +16,18 @@
 #pragma once
 
 #include "lmgl/renderer/shader.hpp"
+#include "lmgl/renderer/shadow_atlas.hpp"
+#include "lmgl/scene/camera.hpp"
+#include "lmgl/scene/frustum.hpp"
 #include "lmgl/scene/light.hpp"
 #include "lmgl/scene/scene.hpp"
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include <cstdint>
 #include <memory>
+#include <vector>
 
 namespace lmgl {
 
@@ -123,6 +130,278 @@ class ShadowMap {
     unsigned int m_height;
 };
 
+/*!
+ * @brief What the depth of a cached shadow map was rendered from, one slice per cascade or cube face.
+ *
+ * Static casters are rendered into a cache texture and only copied into the shadow map,
+ * dynamic casters are drawn on top. Each key hashes the light volume of a slice and the
+ * meshes and world transforms of the casters reaching it, so a slice is only rendered
+ * again when one of them changed.
+ */
+struct ShadowCacheState {
+    //! @brief Largest number of slices, the faces of a cube.
+    static constexpr unsigned int MAX_SLICES = 6;
+
+    uint64_t light_key = 0;                 //!< Light the cached static depth was rendered for
+    uint64_t static_keys[MAX_SLICES] = {};  //!< Static casters and light volume of each cached slice
+    uint64_t dynamic_keys[MAX_SLICES] = {}; //!< Dynamic casters and light volume composited over each slice
+    unsigned int next_slice = 0;            //!< Slice time slicing looks at first on the next pass
+};
+
+/*!
+ * @brief Manages the cascades of a directional light shadow, one layer of a depth array texture each.
+ *
+ * fit() splits the view distance of a camera into slices, nearer slices being shorter,
+ * and fits an orthographic light volume around the bounding sphere of each one, so the
+ * shadow map resolution goes where the camera looks. The splits blend a logarithmic and
+ * a uniform distribution, the practical split scheme. Each volume keeps the size of its
+ * sphere and moves in whole texels, so the shadows do not shimmer as the camera moves or
+ * turns.
+ *
+ * A second array caches the depth of static casters, see ShadowCacheState.
+ *
+ * @note The default resolution is set to 2048x2048 pixels per cascade.
+ */
+class CascadedShadowMap {
+  public:
+    //! @brief Largest number of cascades, the size of the shader uniform arrays.
+    static constexpr unsigned int MAX_CASCADES = 4;
+
+    /*!
+     * @brief Constructs a CascadedShadowMap with the specified resolution and number of cascades.
+     *
+     * @param resolution The resolution of each cascade. Default is 2048.
+     * @param cascade_count The number of cascades, clamped to 1..MAX_CASCADES. Default is 3.
+     */
+    CascadedShadowMap(unsigned int resolution = 2048, unsigned int cascade_count = 3);
+
+    //! @brief Destructor for CascadedShadowMap.
+    ~CascadedShadowMap();
+
+    /*!
+     * @brief Binds the framebuffer object for rendering to one cascade.
+     *
+     * @param cascade The index of the cascade, the layer rendered to.
+     */
+    void bind(unsigned int cascade);
+
+    //! @brief Unbinds the framebuffer object, returning to the default framebuffer.
+    void unbind();
+
+    /*!
+     * @brief Binds the depth array texture to the specified texture slot for use in shaders.
+     *
+     * @param slot The texture slot to bind the texture to. Default is 0.
+     */
+    void bind_texture(unsigned int slot = 0) const;
+
+    /*!
+     * @brief Returns the OpenGL texture ID of the depth array texture.
+     *
+     * @return The texture ID.
+     */
+    inline unsigned int get_texture_id() const { return m_depth_array; }
+
+    /*!
+     * @brief Returns the resolution of each cascade.
+     *
+     * @return The resolution in pixels.
+     */
+    inline unsigned int get_resolution() const { return m_resolution; }
+
+    /*!
+     * @brief Returns the number of cascades, the layers of the texture.
+     *
+     * @return The number of cascades.
+     */
+    inline unsigned int get_cascade_count() const { return m_cascade_count; }
+
+    /*!
+     * @brief Returns the number of cascades fitted by the last fit() or fit_sphere().
+     *
+     * @return The cascades in use, 0 before the first fit.
+     */
+    inline unsigned int get_active_cascade_count() const { return m_active_cascades; }
+
+    /*!
+     * @brief Sets the blend between logarithmic and uniform split distances.
+     *
+     * @param lambda 1 for logarithmic splits, 0 for uniform ones, clamped. Default is 0.75.
+     */
+    void set_split_lambda(float lambda);
+
+    /*!
+     * @brief Getter for the blend between logarithmic and uniform split distances.
+     *
+     * @return The blend factor.
+     */
+    inline float get_split_lambda() const { return m_split_lambda; }
+
+    /*!
+     * @brief Sets the distance from the camera up to which shadows are drawn.
+     *
+     * @param distance The distance, capped by the far plane of the camera. Default is 100.
+     */
+    inline void set_max_distance(float distance) { m_max_distance = distance; }
+
+    /*!
+     * @brief Getter for the distance from the camera up to which shadows are drawn.
+     *
+     * @return The distance.
+     */
+    inline float get_max_distance() const { return m_max_distance; }
+
+    /*!
+     * @brief Fits every cascade to a slice of the camera frustum.
+     *
+     * @param camera The camera the shadows are seen from.
+     * @param light_direction The direction the light travels in.
+     */
+    void fit(const scene::Camera &camera, const glm::vec3 &light_direction);
+
+    /*!
+     * @brief Fits a single cascade around a sphere, for rendering without a camera.
+     *
+     * @param center The center of the sphere.
+     * @param radius The radius of the sphere.
+     * @param light_direction The direction the light travels in.
+     */
+    void fit_sphere(const glm::vec3 &center, float radius, const glm::vec3 &light_direction);
+
+    /*!
+     * @brief Returns the light space matrix of a cascade.
+     *
+     * @param cascade The index of the cascade.
+     * @return The matrix from world space to the clip space of the cascade.
+     */
+    inline const glm::mat4 &get_light_space_matrix(unsigned int cascade) const { return m_matrices[cascade]; }
+
+    /*!
+     * @brief Returns the far end of a cascade, as a distance along the camera view direction.
+     *
+     * @param cascade The index of the cascade.
+     * @return The split distance.
+     */
+    inline float get_split_distance(unsigned int cascade) const { return m_splits[cascade]; }
+
+    /*!
+     * @brief Returns the sphere a cascade was fitted around.
+     *
+     * @param cascade The index of the cascade.
+     * @return The bounding sphere of its camera slice.
+     */
+    inline const scene::BoundingSphere &get_bounds(unsigned int cascade) const { return m_bounds[cascade]; }
+
+    /*!
+     * @brief Get the light space matrix the depth of a cascade was last rendered with.
+     *
+     * Differs from get_light_space_matrix() while a time-sliced cascade waits for its update,
+     * shaders sample the cascade with this one.
+     *
+     * @param cascade Index of the cascade.
+     * @return The light space matrix of the rendered depth.
+     */
+    inline const glm::mat4 &get_shadow_matrix(unsigned int cascade) const { return m_shadow_matrices[cascade]; }
+
+    /*!
+     * @brief Records the light space matrix a cascade was rendered with, called by ShadowRenderer.
+     *
+     * @param cascade Index of the cascade.
+     * @param matrix The light space matrix.
+     */
+    inline void set_shadow_matrix(unsigned int cascade, const glm::mat4 &matrix) {
+        m_shadow_matrices[cascade] = matrix;
+    }
+
+    /*!
+     * @brief Returns the OpenGL framebuffer object ID.
+     *
+     * @return The FBO ID.
+     */
+    inline unsigned int get_fbo() const { return m_fbo; }
+
+    /*!
+     * @brief Returns the framebuffer object of the static depth cache.
+     *
+     * @return The FBO ID.
+     */
+    inline unsigned int get_static_fbo() const { return m_static_fbo; }
+
+    /*!
+     * @brief Returns the depth array texture caching static casters.
+     *
+     * @return The texture ID.
+     */
+    inline unsigned int get_static_texture_id() const { return m_static_depth_array; }
+
+    /*!
+     * @brief Getter for what the cached depth was rendered from.
+     *
+     * @return The cache state, updated by ShadowRenderer.
+     */
+    inline ShadowCacheState &get_cache_state() { return m_cache_state; }
+
+    /*!
+     * @brief Renders every cascade again on the next pass.
+     *
+     * Needed after editing the geometry of a caster mesh in place, which the keys do not see.
+     */
+    inline void invalidate() { m_cache_state = ShadowCacheState(); }
+
+  private:
+    //! Framebuffer object ID
+    unsigned int m_fbo = 0;
+
+    //! Depth array texture ID, one layer per cascade
+    unsigned int m_depth_array = 0;
+
+    //! Framebuffer object of the static depth cache
+    unsigned int m_static_fbo = 0;
+
+    //! Depth array texture caching static casters, one layer per cascade
+    unsigned int m_static_depth_array = 0;
+
+    //! What the cached depth was rendered from
+    ShadowCacheState m_cache_state;
+
+    //! Resolution of each cascade
+    unsigned int m_resolution;
+
+    //! Number of cascades
+    unsigned int m_cascade_count;
+
+    //! Number of cascades fitted by the last fit
+    unsigned int m_active_cascades = 0;
+
+    //! Blend between logarithmic and uniform splits
+    float m_split_lambda = 0.75f;
+
+    //! Distance from the camera up to which shadows are drawn
+    float m_max_distance = 100.0f;
+
+    //! Light space matrix of every cascade
+    glm::mat4 m_matrices[MAX_CASCADES];
+
+    //! Light space matrix the depth of every cascade was rendered with
+    glm::mat4 m_shadow_matrices[MAX_CASCADES];
+
+    //! Far end of every cascade along the view direction
+    float m_splits[MAX_CASCADES] = {};
+
+    //! Bounding sphere of every cascade
+    scene::BoundingSphere m_bounds[MAX_CASCADES];
+
+    /*!
+     * @brief Fits the light volume of a cascade around a sphere, snapped to whole texels.
+     *
+     * @param cascade The index of the cascade.
+     * @param center The center of the sphere.
+     * @param radius The radius of the sphere.
+     * @param light_direction The normalized direction the light travels in.
+     */
+    void fit_cascade(unsigned int cascade, const glm::vec3 &center, float radius, const glm::vec3 &light_direction);
+};
+
 /*!
  * @brief Manages a cubemap depth texture for rendering shadows from point lights.
  *
@@ -198,6 +477,34 @@ class CubemapShadowMap {
      */
     inline unsigned int get_fbo() const { return m_fbo; }
 
+    /*!
+     * @brief Returns the framebuffer object of the static depth cache.
+     *
+     * @return The FBO ID.
+     */
+    inline unsigned int get_static_fbo() const { return m_static_fbo; }
+
+    /*!
+     * @brief Returns the cubemap depth texture caching static casters.
+     *
+     * @return The texture ID.
+     */
+    inline unsigned int get_static_texture_id() const { return m_static_cubemap; }
+
+    /*!
+     * @brief Getter for what the cached depth was rendered from.
+     *
+     * @return The cache state, updated by ShadowRenderer.
+     */
+    inline ShadowCacheState &get_cache_state() { return m_cache_state; }
+
+    /*!
+     * @brief Renders every face again on the next pass.
+     *
+     * Needed after editing the geometry of a caster mesh in place, which the keys do not see.
+     */
+    inline void invalidate() { m_cache_state = ShadowCacheState(); }
+
   private:
     //! Framebuffer object ID
     unsigned int m_fbo = 0;
@@ -205,16 +512,44 @@ class CubemapShadowMap {
     //! Cubemap depth texture ID
     unsigned int m_depth_cubemap = 0;
 
+    //! Framebuffer object of the static depth cache
+    unsigned int m_static_fbo = 0;
+
+    //! Cubemap depth texture caching static casters
+    unsigned int m_static_cubemap = 0;
+
+    //! What the cached depth was rendered from
+    ShadowCacheState m_cache_state;
+
     //! Resolution of each face of the cubemap shadow map
     unsigned int m_resolution;
 };
 
+/*!
+ * @brief Counters of the last shadow pass of one light type.
+ */
+struct ShadowPassStats {
+    unsigned int casters = 0;          //!< Meshes drawn into the shadow map
+    unsigned int culled = 0;           //!< Meshes outside the light volume, skipped
+    unsigned int cached = 0;           //!< Meshes inside the light volume whose cached depth was reused
+    unsigned int updated_slices = 0;   //!< Cascades, cube faces or atlas tiles rendered again
+    unsigned int triangles = 0;        //!< Triangles submitted, once per mesh even when emitted to several faces
+    unsigned int face_casters[6] = {}; //!< Point lights only, meshes drawn into each cube face
+    unsigned int cascade_casters[CascadedShadowMap::MAX_CASCADES] = {}; //!< Cascaded maps only, meshes per cascade
+};
+
 /*!
  * @brief Renders shadows for directional and point lights using shadow maps.
  *
  * This class provides methods to render shadows for both directional lights
  * and point lights using the respective shadow maps. It utilizes depth shaders
  * to render the scene from the light's perspective and generate the shadow maps.
+ *
+ * Only meshes that can cast into the light volume are drawn. For directional lights this
+ * is the orthographic shadow frustum, extended toward the light: casters in front of its
+ * near plane are clamped onto it rather than clipped. For point lights, a caster must
+ * overlap the range sphere of the light, and is only emitted to the cube faces whose
+ * frustum it overlaps. Nodes with a LOD can cast with a coarser level than the view uses.
  */
 class ShadowRenderer {
   public:
@@ -243,11 +578,28 @@ class ShadowRenderer {
     void render_directional_shadow(std::shared_ptr<scene::Scene> scene, std::shared_ptr<scene::Light> light,
                                    std::shared_ptr<ShadowMap> shadow_map);
 
+    /*!
+     * @brief Renders every fitted cascade of a directional light.
+     *
+     * Casters are gathered once and culled against the volume of each cascade, extended
+     * toward the light, and drawn into the layers they overlap. Static casters are drawn
+     * into the cache of a cascade only when its volume or static casters changed; a cascade
+     * is composited again only when that cache or its dynamic casters changed.
+     *
+     * @param scene The scene to render.
+     * @param light The directional light casting shadows.
+     * @param shadow_map The cascades, fitted with fit() or fit_sphere() beforehand.
+     */
+    void render_cascaded_shadow(std::shared_ptr<scene::Scene> scene, std::shared_ptr<scene::Light> light,
+                                std::shared_ptr<CascadedShadowMap> shadow_map);
+
     /*!
      * @brief Renders the shadow map for a point light.
      *
      * This method renders the scene from the perspective of the point light
      * and populates the provided cubemap shadow map with depth information.
+     * Like cascades, faces cache their static casters and are only drawn again
+     * when the light or the casters reaching them changed.
      *
      * @param scene The scene to render.
      * @param light The point light casting shadows.
@@ -256,6 +608,27 @@ class ShadowRenderer {
     void render_point_shadow(std::shared_ptr<scene::Scene> scene, std::shared_ptr<scene::Light> light,
                              std::shared_ptr<CubemapShadowMap> shadow_map);
 
+    /*!
+     * @brief Renders the shadows of many spot and point lights into a shadow atlas.
+     *
+     * Every light casting shadows asks for tiles sized by how much of the screen its range
+     * covers: one for a spot light, one per cube face for a point light. Tiles store the
+     * distance to the light over its range. As for cube faces, static casters are rendered
+     * into the static cache of the atlas and only copied into a tile, dynamic casters are
+     * drawn on top; a tile whose region, light view and casters are those of the previous
+     * pass keeps its depth and is not drawn again.
+     *
+     * @param scene The scene to render.
+     * @param lights The lights, a light and its request to the atlas sharing an index.
+     * @param atlas The atlas to partition and render into.
+     * @param camera Camera the scene is viewed from, null to give every light the largest tiles.
+     * @param viewport_height Height of the view, in pixels.
+     */
+    void render_atlas_shadows(std::shared_ptr<scene::Scene> scene,
+                              const std::vector<std::shared_ptr<scene::Light>> &lights,
+                              std::shared_ptr<ShadowAtlas> atlas, std::shared_ptr<scene::Camera> camera = nullptr,
+                              float viewport_height = 1080.0f);
+
     /*!
      * @brief Computes the light space matrix for a directional light.
      *
@@ -270,7 +643,118 @@ class ShadowRenderer {
     glm::mat4 get_light_space_matrix(std::shared_ptr<scene::Light> light, const glm::vec3 &scene_center,
                                      float scene_radius);
 
+    /*!
+     * @brief Enables or disables culling of shadow casters against the light volume.
+     *
+     * @param enabled True to cull (default), false to draw every mesh of the scene.
+     */
+    inline void set_caster_culling(bool enabled) { m_caster_culling = enabled; }
+
+    /*!
+     * @brief Check if shadow casters are culled against the light volume.
+     *
+     * @return True if culling is enabled.
+     */
+    inline bool is_caster_culling_enabled() const { return m_caster_culling; }
+
+    /*!
+     * @brief Sets how many levels coarser than the view shadow casters with a LOD are drawn.
+     *
+     * The level is picked by distance from the center of the shadow volume for directional
+     * lights, and from the light for point lights, then moved down by the bias, up to the
+     * last level.
+     *
+     * @param levels Number of levels to skip, 0 to cast with the node mesh like the view (default).
+     */
+    inline void set_lod_bias(unsigned int levels) { m_lod_bias = levels; }
+
+    /*!
+     * @brief Getter for the LOD bias of shadow casters.
+     *
+     * @return Number of levels skipped.
+     */
+    inline unsigned int get_lod_bias() const { return m_lod_bias; }
+
+    /*!
+     * @brief Enables or disables time slicing of stale static depth.
+     *
+     * When enabled, the first cascade is still refreshed on every pass but the further ones
+     * one per pass, sampled with the volume they were rendered with meanwhile. A point light
+     * refreshes one cube face or atlas tile per pass while it stays in place; after it moved,
+     * every face is refreshed, as all faces share its position. Dynamic casters are drawn
+     * every pass.
+     *
+     * @param enabled True to spread refreshes over several passes, false to refresh at once (default).
+     */
+    inline void set_time_slicing(bool enabled) { m_time_slicing = enabled; }
+
+    /*!
+     * @brief Check if stale static depth is refreshed one slice per pass.
+     *
+     * @return True if time slicing is enabled.
+     */
+    inline bool is_time_slicing_enabled() const { return m_time_slicing; }
+
+    /*!
+     * @brief Getter for the counters of the last directional shadow pass, single or cascaded.
+     *
+     * @return Casters drawn and culled, and their triangles.
+     */
+    inline const ShadowPassStats &get_directional_stats() const { return m_directional_stats; }
+
+    /*!
+     * @brief Getter for the counters of the last point shadow pass.
+     *
+     * @return Casters drawn, culled and drawn into each cube face, and their triangles.
+     */
+    inline const ShadowPassStats &get_point_stats() const { return m_point_stats; }
+
+    /*!
+     * @brief Getter for the counters of the last shadow atlas pass.
+     *
+     * @return Casters drawn, cached and culled, tiles rendered again, and their triangles.
+     */
+    inline const ShadowPassStats &get_atlas_stats() const { return m_atlas_stats; }
+
   private:
+    //! @brief A mesh that may cast a shadow, with its world transform and bounds.
+    struct ShadowCaster {
+        std::shared_ptr<scene::Mesh> mesh;
+        glm::mat4 transform;
+        scene::BoundingSphere bounds;
+        bool is_static;
+    };
+
+    //! Whether casters outside the light volume are skipped
+    bool m_caster_culling = true;
+
+    //! Number of LOD levels casters are drawn coarser than the view
+    unsigned int m_lod_bias = 0;
+
+    //! Whether stale static depth is refreshed one slice per pass
+    bool m_time_slicing = false;
+
+    //! Counters of the last directional pass
+    ShadowPassStats m_directional_stats;
+
+    //! Counters of the last point pass
+    ShadowPassStats m_point_stats;
+
+    //! Counters of the last atlas pass
+    ShadowPassStats m_atlas_stats;
+
+    //! Casters of the current pass, reused across passes
+    std::vector<ShadowCaster> m_casters;
+
+    /*!
+     * @brief Gathers the non-emissive meshes of a subtree as shadow casters.
+     *
+     * @param node Root of the subtree.
+     * @param parent_transform World transform of the parent node.
+     * @param lod_origin Point LOD levels are picked by distance from.
+     */
+    void collect_casters(std::shared_ptr<scene::Node> node, const glm::mat4 &parent_transform,
+                         const glm::vec3 &lod_origin);
 
     //! Depth shader for directional light shadow mapping
     std::shared_ptr<Shader> m_depth_shader;
@@ -278,6 +762,9 @@ class ShadowRenderer {
     //! Depth shader for point light shadow mapping
     std::shared_ptr<Shader> m_depth_cubemap_shader;
 
+    //! Depth shader for the tiles of the shadow atlas
+    std::shared_ptr<Shader> m_atlas_depth_shader;
+
     /*!
      * @brief Renders the scene to populate the depth information for shadow mapping.
      *
@@ -286,8 +773,10 @@ class ShadowRenderer {
      *
      * @param scene The scene to render.
      * @param light_space_matrix The light space transformation matrix.
+     * @param lod_origin Point LOD levels are picked by distance from.
      */
-    void render_scene_depth(std::shared_ptr<scene::Scene> scene, const glm::mat4 &light_space_matrix);
+    void render_scene_depth(std::shared_ptr<scene::Scene> scene, const glm::mat4 &light_space_matrix,
+                            const glm::vec3 &lod_origin);
 };
 
 } // namespace renderer
@@ -11,14 +11,51 @@
 
 #pragma once
 
+#include "lmgl/renderer/texture_container.hpp"
+
 #include <glad/glad.h>
 
+#include <cstddef>
+#include <memory>
 #include <string>
+#include <vector>
 
 namespace lmgl {
 
 namespace renderer {
 
+/*!
+ * @brief An image decoded in CPU memory, not yet uploaded.
+ *
+ * Produced by Texture::decode, which touches no OpenGL state and can run on any thread.
+ * DDS and KTX2 files decode to their compressed levels instead of pixels.
+ */
+struct ImageData {
+    int width = 0;                               //!< Width in pixels
+    int height = 0;                              //!< Height in pixels
+    int channels = 0;                            //!< Channels per pixel (1 to 4)
+    std::shared_ptr<unsigned char> pixels;       //!< Tightly packed rows, nullptr if decoding failed
+    std::shared_ptr<CompressedImage> compressed; //!< Block-compressed mip chain, set instead of pixels
+
+    /*!
+     * @brief Check if the image holds data to upload.
+     *
+     * @return True if either pixels or compressed levels are present.
+     */
+    inline bool is_valid() const { return pixels || compressed; }
+
+    /*!
+     * @brief Getter for the size of the pixel data.
+     *
+     * @return Size in bytes, of all levels for compressed images.
+     */
+    inline std::size_t size() const {
+        if (compressed)
+            return compressed->size();
+        return static_cast<std::size_t>(width) * static_cast<std::size_t>(height) * static_cast<std::size_t>(channels);
+    }
+};
+
 /*!
  * @brief Manages an OpenGL texture.
  *
@@ -52,11 +89,24 @@ class Texture {
     /*!
      * @brief Constructor for creating a texture from an image file.
      *
-     * Loads the texture data from the specified file path.
+     * Loads the texture data from the specified file path. DDS and KTX2 files are
+     * uploaded block-compressed, with the mip levels they contain.
      *
      * @param fpath The file path to the image to load as a texture.
+     * @param flip_vertically Whether to flip the image so that its first row is the bottom one.
      */
-    Texture(const std::string &fpath);
+    Texture(const std::string &fpath, bool flip_vertically = false);
+
+    /*!
+     * @brief Constructor for creating a texture from an already decoded image.
+     *
+     * Uploads the image and generates its mipmaps. Together with decode(), this lets
+     * the file be read and decoded on a worker thread and only uploaded on the render thread.
+     *
+     * @param fpath The file path the image was decoded from.
+     * @param image The decoded image, the texture is left empty if it holds no data.
+     */
+    Texture(const std::string &fpath, const ImageData &image);
 
     //! @brief Destructor for the Texture class.
     ~Texture();
@@ -118,6 +168,137 @@ class Texture {
      */
     void set_data(void *data, unsigned int size);
 
+    /*!
+     * @brief Replaces the storage of the texture with a decoded image.
+     *
+     * The OpenGL name is kept, so materials and bindings referring to the texture pick the
+     * new image up without being told. Used to swap the real image into a placeholder.
+     *
+     * @param image The decoded image, ignored if it holds no data.
+     */
+    void set_image(const ImageData &image);
+
+    /*!
+     * @brief Check if the texture still shows a placeholder.
+     *
+     * @return True from create_placeholder() until set_image() uploads an image.
+     */
+    inline bool is_placeholder() const { return m_placeholder; }
+
+    /*!
+     * @brief Check if the texture is stored block-compressed.
+     *
+     * @return True if it was created from a DDS or KTX2 image.
+     */
+    inline bool is_compressed() const { return m_compressed; }
+
+    /*!
+     * @brief Getter for the memory the texture takes on the GPU.
+     *
+     * @return Size in bytes of all mip levels, estimated for generated mipmaps.
+     */
+    inline std::size_t get_memory_usage() const { return m_memory_usage; }
+
+    /*!
+     * @brief Check if the current context can sample a block format.
+     *
+     * BC4 and BC5 are core since OpenGL 3.0, BC1 and BC3 need EXT_texture_compression_s3tc
+     * and BC7 needs OpenGL 4.2 or ARB_texture_compression_bptc.
+     *
+     * @param format The block format.
+     * @return True if textures of this format can be uploaded.
+     */
+    static bool is_format_supported(BlockFormat format);
+
+    /*!
+     * @brief Creates a 1x1 opaque white texture standing in for an image still loading.
+     *
+     * @param fpath The file path of the image that will replace it.
+     * @return The placeholder texture.
+     */
+    static std::shared_ptr<Texture> create_placeholder(const std::string &fpath);
+
+    /*!
+     * @brief Decodes an image file without creating a texture.
+     *
+     * Touches no OpenGL state and keeps the flip setting per thread, so it is safe to
+     * call from several worker threads at once. DDS and KTX2 files fill image.compressed
+     * and are never flipped, since that would mean reordering the rows inside each block.
+     *
+     * @param fpath The file path to the image to decode.
+     * @param image Filled with the decoded image.
+     * @param flip_vertically Whether to flip the image so that its first row is the bottom one.
+     * @return True on success, false if the file could not be read or decoded.
+     */
+    static bool decode(const std::string &fpath, ImageData &image, bool flip_vertically = false);
+
+    /*!
+     * @brief Decodes an image held in memory, such as one embedded in a model file.
+     *
+     * Same thread safety as decode(); only the formats of stb_image are recognized.
+     *
+     * @param data First byte of the encoded image.
+     * @param size Size of the encoded image in bytes.
+     * @param image Filled with the decoded image.
+     * @param flip_vertically Whether to flip the image so that its first row is the bottom one.
+     * @return True on success, false if the data could not be decoded.
+     */
+    static bool decode_memory(const unsigned char *data, std::size_t size, ImageData &image,
+                              bool flip_vertically = false);
+
+    /*!
+     * @brief Prepares the texture to receive its mip levels one at a time.
+     *
+     * No level is resident afterwards: the texture stays incomplete until upload_level()
+     * has filled in the coarsest one. Uncompressed images are streamed as RGBA8.
+     *
+     * @param image The full-size image, only its size and compressed format are read.
+     * @param level_count Number of levels in the full mip chain.
+     */
+    void init_streaming(const ImageData &image, int level_count);
+
+    /*!
+     * @brief Uploads the next finer mip level of a streamed texture.
+     *
+     * Levels have to arrive coarse to fine, each one right above the current base level,
+     * which then moves down to it through GL_TEXTURE_BASE_LEVEL.
+     *
+     * @param level The level index, base_level - 1.
+     * @param data The level, RGBA8 pixels or blocks in the format given to init_streaming().
+     * @return True if the level was uploaded.
+     */
+    bool upload_level(int level, const CompressedLevel &data);
+
+    /*!
+     * @brief Drops the finest resident mip level of a streamed texture.
+     *
+     * The base level is clamped past it first, then its storage is released.
+     *
+     * @return Bytes released, 0 if only the coarsest level is left.
+     */
+    std::size_t evict_level();
+
+    /*!
+     * @brief Check if the texture is fed level by level.
+     *
+     * @return True after init_streaming().
+     */
+    inline bool is_streamed() const { return m_streamed; }
+
+    /*!
+     * @brief Getter for the finest resident mip level.
+     *
+     * @return The base level, equal to the level count while nothing is resident.
+     */
+    inline int get_base_level() const { return m_base_level; }
+
+    /*!
+     * @brief Getter for the number of levels in the full mip chain.
+     *
+     * @return The level count, 1 for textures that are not streamed and not compressed.
+     */
+    inline int get_level_count() const { return m_level_count; }
+
   private:
     //! @brief OpenGL renderer ID for the texture.
     unsigned int m_renderer_id;
@@ -134,12 +315,59 @@ class Texture {
     //! @brief Internal format and data format of the texture.
     GLenum m_data_format;
 
+    //! @brief Whether the texture holds a placeholder instead of its image.
+    bool m_placeholder = false;
+
+    //! @brief Whether the texture is stored block-compressed.
+    bool m_compressed = false;
+
+    //! @brief Memory taken on the GPU, in bytes.
+    std::size_t m_memory_usage = 0;
+
+    //! @brief Whether mip levels are streamed in and out by TextureStreamer.
+    bool m_streamed = false;
+
+    //! @brief Finest resident mip level.
+    int m_base_level = 0;
+
+    //! @brief Number of levels in the full mip chain.
+    int m_level_count = 1;
+
+    //! @brief Bytes held by each level of a streamed texture, 0 for levels not resident.
+    std::vector<std::size_t> m_level_sizes;
+
     /*!
      * @brief Initializes texture parameters.
      *
      * Sets default parameters for the texture such as filtering and wrapping modes.
      */
     void init_texture_params();
+
+    /*!
+     * @brief Picks the uncompressed internal and data formats for a channel count.
+     *
+     * @param channels Channels per pixel (1 to 4).
+     */
+    void set_pixel_format(int channels);
+
+    /*!
+     * @brief Clamps sampling to the resident levels of a streamed texture.
+     */
+    void apply_level_range();
+
+    /*!
+     * @brief Creates the OpenGL texture from a decoded image.
+     *
+     * @param image The decoded image.
+     */
+    void upload(const ImageData &image);
+
+    /*!
+     * @brief Creates the OpenGL texture from compressed levels.
+     *
+     * @param image The compressed image.
+     */
+    void upload_compressed(const CompressedImage &image);
 };
 
 } // namespace renderer
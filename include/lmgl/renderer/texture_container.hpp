@@ -0,0 +1,134 @@
+/*!
+ * @file texture_container.hpp
+ * @brief Block-compressed images and the DDS and KTX2 files holding them.
+ *
+ * This header defines CompressedImage, a BCn-compressed image with its whole mip chain,
+ * and TextureContainer, which reads it from DDS and KTX2 files and writes it to DDS.
+ * Such images are uploaded as they are, so they take 4 to 8 times less memory than
+ * RGBA8 and need no mipmap generation at load time.
+ *
+ * \copyright{Copyright (c) 2026 Luca Mazza. All rights reserved.}
+ * \license{This project is released under the MIT License.}
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace lmgl {
+
+namespace renderer {
+
+/*!
+ * @brief Block compression formats, all using 4x4 pixel blocks.
+ */
+enum class BlockFormat {
+    BC1, //!< RGB, 8 bytes per block (DXT1)
+    BC3, //!< RGBA, 16 bytes per block (DXT5)
+    BC4, //!< Single channel, 8 bytes per block
+    BC5, //!< Two channels, 16 bytes per block, suited to normal maps
+    BC7  //!< High quality RGBA, 16 bytes per block
+};
+
+/*!
+ * @brief One mip level of a compressed image.
+ */
+struct CompressedLevel {
+    int width = 0;                   //!< Width in pixels
+    int height = 0;                  //!< Height in pixels
+    std::vector<unsigned char> data; //!< Blocks, row by row
+};
+
+/*!
+ * @brief A block-compressed image and its mip chain.
+ */
+struct CompressedImage {
+    BlockFormat format = BlockFormat::BC1; //!< Compression format
+    bool srgb = false;                     //!< Whether the color channels are sRGB encoded
+    std::vector<CompressedLevel> levels;   //!< Mip levels, the base level first
+
+    /*!
+     * @brief Getter for the size of all levels.
+     *
+     * @return Size in bytes.
+     */
+    std::size_t size() const;
+};
+
+/*!
+ * @brief Reads and writes block-compressed texture files.
+ *
+ * DDS files are read with the legacy DXT1, DXT5, ATI1, ATI2, BC4U and BC5U codes or with
+ * the DX10 header, which BC7 requires. KTX2 files are read when they hold a single 2D image
+ * without supercompression. Files are always written as DDS, with the DX10 header.
+ */
+class TextureContainer {
+  public:
+    /*!
+     * @brief Check if a path names a container file, by its extension.
+     *
+     * @param fpath The file path.
+     * @return True for .dds and .ktx2 files, in any case.
+     */
+    static bool is_container(const std::string &fpath);
+
+    /*!
+     * @brief Reads a DDS or KTX2 file.
+     *
+     * @param fpath The file path.
+     * @param image Filled with the image on success.
+     * @return True on success, false if the file is missing, malformed or holds an unsupported format.
+     */
+    static bool load(const std::string &fpath, CompressedImage &image);
+
+    /*!
+     * @brief Parses DDS or KTX2 data, telling them apart by their magic number.
+     *
+     * @param data First byte of the file.
+     * @param size Size of the file in bytes.
+     * @param image Filled with the image on success.
+     * @return True on success.
+     */
+    static bool parse(const unsigned char *data, std::size_t size, CompressedImage &image);
+
+    /*!
+     * @brief Writes an image as a DDS file.
+     *
+     * @param fpath The file path.
+     * @param image The image to write, its levels must form a mip chain.
+     * @return True on success.
+     */
+    static bool save_dds(const std::string &fpath, const CompressedImage &image);
+
+    /*!
+     * @brief Getter for the size of a block.
+     *
+     * @param format The compression format.
+     * @return Bytes per 4x4 block.
+     */
+    static std::size_t get_block_size(BlockFormat format);
+
+    /*!
+     * @brief Getter for the number of channels a format stores.
+     *
+     * @param format The compression format.
+     * @return 1 to 4.
+     */
+    static int get_channels(BlockFormat format);
+
+    /*!
+     * @brief Size of a level of the given dimensions.
+     *
+     * @param format The compression format.
+     * @param width Width in pixels.
+     * @param height Height in pixels.
+     * @return Size in bytes, partial blocks count as whole.
+     */
+    static std::size_t get_level_size(BlockFormat format, int width, int height);
+};
+
+} // namespace renderer
+
+} // namespace lmgl
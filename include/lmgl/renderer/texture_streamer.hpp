@@ -0,0 +1,291 @@
+/*!
+ * @file texture_streamer.hpp
+ * @brief Mip-level texture streaming under a memory budget.
+ *
+ * This header defines the TextureStreamer class. Streamed textures start out with only
+ * their low mips resident; the renderer requests finer levels from the on-screen size of
+ * the meshes using them, and the streamer uploads and evicts levels so that the textures
+ * fit a global budget, sampling only what is resident through GL_TEXTURE_BASE_LEVEL.
+ *
+ * \copyright{Copyright (c) 2026 Luca Mazza. All rights reserved.}
+ * \license{This project is released under the MIT License.}
+ */
+
+#pragma once
+
+#include "lmgl/renderer/texture.hpp"
+
+#include <atomic>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace lmgl {
+
+namespace renderer {
+
+/*!
+ * @brief Feeds the GPU the mip levels of streamed textures on request.
+ *
+ * Levels up to the resident size (64 pixels by default) are uploaded when a texture is
+ * added and never leave. Finer levels are uploaded one per texture per frame, coarse to
+ * fine, when requested. Resident levels leave CPU memory once uploaded. Textures read from
+ * a file drop their finer levels too and decode the file again on a core::ThreadPool worker
+ * when one is requested; images with no file behind them keep the finer levels.
+ * When the budget is full, the finest levels of textures that went unused or are sharper
+ * than needed make room; if nothing can go, the texture stays at a coarser level instead
+ * of exceeding the budget.
+ *
+ * Render thread only: request() is called while drawing, update() once per frame, which
+ * core::Engine::run does.
+ */
+class TextureStreamer {
+  public:
+    /*!
+     * @brief Get the singleton instance of the TextureStreamer.
+     *
+     * @return Reference to the TextureStreamer instance.
+     */
+    static TextureStreamer &get_instance();
+
+    //! @brief Creates an empty streamer with the default budgets.
+    TextureStreamer() = default;
+
+    TextureStreamer(const TextureStreamer &) = delete;
+    TextureStreamer &operator=(const TextureStreamer &) = delete;
+
+    /*!
+     * @brief Loads an image file as a streamed texture.
+     *
+     * @param fpath The file path to the image to load.
+     * @param flip_vertically Whether to flip the image so that its first row is the bottom one.
+     * @return The texture with its low mips resident, nullptr if the file could not be decoded.
+     */
+    std::shared_ptr<Texture> load(const std::string &fpath, bool flip_vertically = false);
+
+    /*!
+     * @brief Creates a streamed texture from a decoded image, keeping its whole mip chain.
+     *
+     * Uncompressed images get an RGBA8 mip chain built here; compressed ones stream the
+     * levels they contain. Meant for images with no file of their own, such as the ones
+     * embedded in a model.
+     *
+     * @param fpath The name of the texture.
+     * @param image The decoded image.
+     * @return The texture with its low mips resident, nullptr if the image holds no data.
+     */
+    std::shared_ptr<Texture> add(const std::string &fpath, const ImageData &image);
+
+    /*!
+     * @brief Creates a streamed texture from an image decoded from a file.
+     *
+     * Like add(), but no level stays in CPU memory: finer ones are read from the file
+     * again when requested, and dropped once uploaded.
+     *
+     * @param fpath The file path the image was decoded from.
+     * @param image The decoded image.
+     * @param flip_vertically Whether the image was flipped when decoded.
+     * @return The texture with its low mips resident, nullptr if the image holds no data.
+     */
+    std::shared_ptr<Texture> add_file(const std::string &fpath, const ImageData &image, bool flip_vertically = false);
+
+    /*!
+     * @brief Asks for a texture to be sharp enough for a given on-screen size.
+     *
+     * Ignored for textures that are not streamed.
+     *
+     * @param texture The texture drawn.
+     * @param screen_size Size in pixels the texture covers on screen, along its larger side.
+     */
+    void request(const Texture *texture, float screen_size);
+
+    /*!
+     * @brief Asks for a texture to have a mip level resident.
+     *
+     * The finest level requested during a frame wins.
+     *
+     * @param texture The texture drawn.
+     * @param level The finest level needed, 0 for full resolution.
+     */
+    void request_level(const Texture *texture, int level);
+
+    /*!
+     * @brief Uploads and evicts levels for the requests of the past frame.
+     *
+     * Forgets textures destroyed since the last call.
+     */
+    void update();
+
+    /*!
+     * @brief Selects the mip level matching an on-screen size.
+     *
+     * @param width Width of the full-size texture.
+     * @param height Height of the full-size texture.
+     * @param screen_size Size in pixels the texture covers on screen, along its larger side.
+     * @return The level with about one texel per pixel.
+     */
+    static int select_level(int width, int height, float screen_size);
+
+    /*!
+     * @brief Sets the memory all streamed textures may take on the GPU together.
+     *
+     * Lowering it evicts levels on the next update(), down to the resident size if needed.
+     *
+     * @param bytes The budget in bytes.
+     */
+    inline void set_budget(std::size_t bytes) { m_budget = bytes; }
+
+    /*!
+     * @brief Getter for the memory budget.
+     *
+     * @return The budget in bytes.
+     */
+    inline std::size_t get_budget() const { return m_budget; }
+
+    /*!
+     * @brief Sets the amount of level data uploaded per update().
+     *
+     * The first level of a frame is always uploaded, even if larger.
+     *
+     * @param bytes The upload budget in bytes.
+     */
+    inline void set_upload_budget(std::size_t bytes) { m_upload_budget = bytes; }
+
+    /*!
+     * @brief Getter for the per-frame upload budget.
+     *
+     * @return The upload budget in bytes.
+     */
+    inline std::size_t get_upload_budget() const { return m_upload_budget; }
+
+    /*!
+     * @brief Sets the size below which levels are always resident.
+     *
+     * Only affects textures added afterwards.
+     *
+     * @param size Largest side in pixels of the finest level that never leaves.
+     */
+    inline void set_resident_size(int size) { m_resident_size = size; }
+
+    /*!
+     * @brief Getter for the size below which levels are always resident.
+     *
+     * @return Size in pixels.
+     */
+    inline int get_resident_size() const { return m_resident_size; }
+
+    /*!
+     * @brief Getter for the memory taken by streamed textures.
+     *
+     * @return Bytes on the GPU as of the last update().
+     */
+    inline std::size_t get_memory_usage() const { return m_memory_usage; }
+
+    /*!
+     * @brief Getter for the level data streamed textures hold in CPU memory.
+     *
+     * @return Bytes of mip levels kept or read back for upload.
+     */
+    std::size_t get_cpu_memory_usage() const;
+
+    /*!
+     * @brief Getter for the number of streamed textures.
+     *
+     * @return Number of textures tracked.
+     */
+    inline std::size_t get_count() const { return m_entries.size(); }
+
+    /*!
+     * @brief Check if no texture is streamed.
+     *
+     * @return True if the renderer can skip computing requests.
+     */
+    inline bool is_empty() const { return m_entries.empty(); }
+
+    //! @brief Stops streaming every texture, leaving their resident levels in place.
+    void clear();
+
+  private:
+    //! @brief No request this frame.
+    static constexpr int NO_REQUEST = INT_MAX;
+
+    //! @brief Mip chain decoded again by a worker.
+    struct Reload {
+        std::vector<CompressedLevel> levels; //!< Every level, empty if the file could not be read
+        std::atomic<bool> done{false};       //!< Set by the worker once levels is filled
+    };
+
+    //! @brief A streamed texture and its mip chain.
+    struct Entry {
+        std::weak_ptr<Texture> texture;      //!< The texture, not kept alive by the streamer
+        std::vector<CompressedLevel> levels; //!< Every level, full size first, data empty when not held
+        std::string source;                  //!< File finer levels are read back from, empty if held
+        bool flip_vertically = false;        //!< Whether the file is decoded flipped
+        std::shared_ptr<Reload> reload;      //!< Read of the file in flight
+        int min_level = 0;                   //!< Coarsest level that can be evicted is min_level - 1
+        int wanted = 0;                      //!< Finest level requested when last drawn
+        int requested = NO_REQUEST;          //!< Finest level requested this frame
+        uint64_t last_used = 0;              //!< Frame the texture was last drawn in
+    };
+
+    /*!
+     * @brief Builds the mip chain of a decoded image.
+     *
+     * @param image The decoded image.
+     * @param levels Receives every level, full size first.
+     * @return True if the image holds at least one level.
+     */
+    static bool build_levels(const ImageData &image, std::vector<CompressedLevel> &levels);
+
+    //! @brief Creates the texture of add() and add_file() and uploads its resident levels.
+    std::shared_ptr<Texture> add_entry(const std::string &fpath, const ImageData &image, Entry entry);
+
+    /*!
+     * @brief Makes the data of a level available, reading the file again if needed.
+     *
+     * @param entry The texture the level belongs to.
+     * @param level The level to upload.
+     * @return True if the level can be uploaded now, false while the file is read or if it cannot be.
+     */
+    bool fetch_level(Entry &entry, int level);
+
+    //! @brief Drops the levels read back from the file of a texture that needs no more of them.
+    static void release_levels(Entry &entry);
+
+    /*!
+     * @brief Finds the texture that should give up its finest level.
+     *
+     * Textures not drawn for longest go first, then the ones sharper than needed.
+     *
+     * @param exclude Entry making room, never picked.
+     * @param allow_visible Whether textures drawn this frame at the level they need may be picked.
+     * @return The entry to evict from, nullptr if none can give anything up.
+     */
+    Entry *pick_victim(const Entry *exclude, bool allow_visible);
+
+    //! @brief Streamed textures by address.
+    std::unordered_map<const Texture *, Entry> m_entries;
+
+    //! @brief Memory budget in bytes.
+    std::size_t m_budget = 256 * 1024 * 1024;
+
+    //! @brief Level data uploaded per update() in bytes.
+    std::size_t m_upload_budget = 4 * 1024 * 1024;
+
+    //! @brief Largest side of the finest level always resident.
+    int m_resident_size = 64;
+
+    //! @brief Memory taken by streamed textures as of the last update().
+    std::size_t m_memory_usage = 0;
+
+    //! @brief Number of update() calls so far.
+    uint64_t m_frame = 1;
+};
+
+} // namespace renderer
+
+} // namespace lmgl
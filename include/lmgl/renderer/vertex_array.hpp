@@ -61,10 +61,39 @@ class VertexArray {
      * @brief Adds a Vertex Buffer to the Vertex Array Object.
      *
      * This method associates a Vertex Buffer with the VAO, allowing it to be used for rendering.
+     * Attribute locations continue after those of previously added buffers, unless an element
+     * sets an explicit location. Matrix elements occupy one location per column.
      *
      * @param vertexBuffer A shared pointer to the Vertex Buffer to be added.
+     * @param divisor Instance divisor for every attribute of the buffer (default is 0, per vertex).
      */
-    void add_vertex_buffer(const std::shared_ptr<VertexBuffer> &vertex_buffer);
+    void add_vertex_buffer(const std::shared_ptr<VertexBuffer> &vertex_buffer, unsigned int divisor = 0);
+
+    /*!
+     * @brief Adds a Vertex Buffer read through a layout of its own.
+     *
+     * Lets several vertex arrays read different attributes of one buffer, e.g. a buffer
+     * holding the data of many meshes, with the offsets of the layout counted from its start.
+     *
+     * @param vertex_buffer A shared pointer to the Vertex Buffer to be added.
+     * @param layout Layout of the attributes read by this vertex array, used instead of the buffer's.
+     * @param divisor Instance divisor for every attribute of the buffer (default is 0, per vertex).
+     */
+    void add_vertex_buffer(const std::shared_ptr<VertexBuffer> &vertex_buffer, const BufferLayout &layout,
+                           unsigned int divisor = 0);
+
+    /*!
+     * @brief Adds a Stream Buffer as an attribute source of the Vertex Array Object.
+     *
+     * Attributes read from the start of the ring; select the data pushed in a frame with the
+     * first vertex (or base instance) of the draw, i.e. the pushed offset divided by the stride.
+     *
+     * @param stream_buffer A shared pointer to the Stream Buffer to be added.
+     * @param layout Layout of the data pushed into the buffer.
+     * @param divisor Instance divisor for every attribute of the buffer (default is 0, per vertex).
+     */
+    void add_stream_buffer(const std::shared_ptr<StreamBuffer> &stream_buffer, const BufferLayout &layout,
+                           unsigned int divisor = 0);
 
     /*!
      * @brief Sets the Index Buffer for the Vertex Array Object.
@@ -93,13 +122,41 @@ class VertexArray {
      */
     const std::shared_ptr<IndexBuffer> &get_index_buffer() const;
 
+    /*!
+     * @brief Retrieves the attribute location the next added Vertex Buffer will start at.
+     *
+     * @return One past the highest attribute location in use.
+     */
+    inline unsigned int get_next_attribute_location() const { return m_next_attribute_location; }
+
+    /*!
+     * @brief Retrieves the list of Stream Buffers associated with the Vertex Array Object.
+     *
+     * @return A constant reference to a vector of shared pointers to the Stream Buffers.
+     */
+    inline const std::vector<std::shared_ptr<StreamBuffer>> &get_stream_buffers() const { return m_stream_buffers; }
+
   private:
+    /*!
+     * @brief Enable and describe the attributes of a layout for the buffer bound to GL_ARRAY_BUFFER.
+     *
+     * @param layout Layout of the bound buffer.
+     * @param divisor Instance divisor for every attribute.
+     */
+    void add_attributes(const BufferLayout &layout, unsigned int divisor);
+
     //! Renderer ID for the Vertex Array Object
     unsigned int m_renderer_id;
 
+    //! Next free attribute location
+    unsigned int m_next_attribute_location = 0;
+
     //! List of Vertex Buffers associated with the VAO
     std::vector<std::shared_ptr<VertexBuffer>> m_vertex_buffers;
 
+    //! List of Stream Buffers associated with the VAO
+    std::vector<std::shared_ptr<StreamBuffer>> m_stream_buffers;
+
     //! Index Buffer associated with the VAO
     std::shared_ptr<IndexBuffer> m_index_buffer;
 };
@@ -0,0 +1,142 @@
+/*!
+ * @file vertex_format.hpp
+ * @brief Compile-time description of vertex structs.
+ *
+ * This header file contains VertexAttribute, the VertexFormat trait and the helpers that
+ * turn a vertex struct into a BufferLayout. A vertex struct is described once, next to its
+ * definition, by specializing VertexFormat with a constexpr table of attributes built with
+ * LMGL_VERTEX_ATTRIBUTE. Offsets and sizes come from the struct itself, and the table is
+ * checked at compile time against the member types, the struct size and the locations.
+ *
+ * \copyright{Copyright (c) 2026 Luca Mazza. All rights reserved.}
+ * \license{This project is released under the MIT License.}
+ */
+
+#pragma once
+
+#include "lmgl/renderer/buffer.hpp"
+
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+namespace lmgl {
+
+namespace renderer {
+
+/*!
+ * @brief One attribute of a compile-time vertex format.
+ *
+ * @note Build instances with LMGL_VERTEX_ATTRIBUTE so that offset and member size are
+ * taken from the struct.
+ */
+struct VertexAttribute {
+
+    //! @brief Data type as seen by the vertex fetch.
+    ShaderDataType type;
+
+    //! @brief Name of the attribute (informative only, binding is by location).
+    const char *name;
+
+    //! @brief Attribute location in the shader.
+    unsigned int location;
+
+    //! @brief Indicates if integer data is normalized.
+    bool normalized;
+
+    //! @brief Offset of the member inside the vertex struct.
+    std::size_t offset;
+
+    //! @brief Size of the member inside the vertex struct.
+    std::size_t member_size;
+};
+
+/*!
+ * @brief Trait describing the attributes of a vertex struct.
+ *
+ * Specialize it for every vertex struct with a static constexpr array named attributes:
+ *
+ * @code
+ * template <> struct VertexFormat<MyVertex> {
+ *     static constexpr VertexAttribute attributes[] = {
+ *         LMGL_VERTEX_ATTRIBUTE(MyVertex, position, ShaderDataType::Float3, 0, false),
+ *         LMGL_VERTEX_ATTRIBUTE(MyVertex, uvs, ShaderDataType::Half2, 3, false)};
+ * };
+ * @endcode
+ */
+template <typename V> struct VertexFormat;
+
+/*!
+ * @brief Describe a member of a vertex struct as a VertexAttribute.
+ *
+ * @param vertex Vertex struct type.
+ * @param member Member name.
+ * @param type ShaderDataType of the member.
+ * @param location Attribute location in the shader.
+ * @param normalized Whether integer data is normalized.
+ */
+#define LMGL_VERTEX_ATTRIBUTE(vertex, member, type, location, normalized)                                              \
+    ::lmgl::renderer::VertexAttribute {                                                                                \
+        type, #member, location, normalized, offsetof(vertex, member), sizeof(vertex::member)                          \
+    }
+
+/*!
+ * @brief Check a vertex format at compile time.
+ *
+ * Every attribute must match the size of its member, lie inside the struct and use
+ * attribute locations that no other attribute of the format uses.
+ *
+ * @return True if the format is consistent.
+ */
+template <typename V> constexpr bool is_valid_vertex_format() {
+    constexpr std::size_t count = sizeof(VertexFormat<V>::attributes) / sizeof(VertexAttribute);
+    for (std::size_t i = 0; i < count; ++i) {
+        const VertexAttribute &a = VertexFormat<V>::attributes[i];
+        if (shader_data_type_size(a.type) != a.member_size || a.offset + a.member_size > sizeof(V))
+            return false;
+        for (std::size_t j = 0; j < i; ++j) {
+            const VertexAttribute &b = VertexFormat<V>::attributes[j];
+            unsigned int a_end = a.location + shader_data_type_location_count(a.type);
+            unsigned int b_end = b.location + shader_data_type_location_count(b.type);
+            if (a.location < b_end && b.location < a_end)
+                return false;
+        }
+    }
+    return true;
+}
+
+/*!
+ * @brief Get the number of attributes of a vertex format.
+ *
+ * @return Number of entries in VertexFormat<V>::attributes.
+ */
+template <typename V> constexpr std::size_t vertex_attribute_count() {
+    return sizeof(VertexFormat<V>::attributes) / sizeof(VertexAttribute);
+}
+
+/*!
+ * @brief Build the BufferLayout of a vertex struct.
+ *
+ * The layout uses the struct size as stride and sets explicit locations, so vertex arrays
+ * bind each attribute where the shader expects it regardless of which attributes a format
+ * leaves out.
+ *
+ * @return BufferLayout describing V.
+ */
+template <typename V> BufferLayout make_vertex_layout() {
+    static_assert(std::is_standard_layout<V>::value, "Vertex formats must be standard layout types");
+    static_assert(is_valid_vertex_format<V>(), "Vertex format attributes do not match the vertex struct");
+    std::vector<BufferElement> elements;
+    elements.reserve(vertex_attribute_count<V>());
+    for (const VertexAttribute &attribute : VertexFormat<V>::attributes) {
+        BufferElement element(attribute.type, attribute.name, attribute.normalized,
+                              static_cast<int>(attribute.location));
+        element.offset = attribute.offset;
+        elements.push_back(element);
+    }
+    return BufferLayout(elements, sizeof(V));
+}
+
+} // namespace renderer
+
+} // namespace lmgl
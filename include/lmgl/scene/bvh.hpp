@@ -0,0 +1,131 @@
+/*!
+ * @file bvh.hpp
+ * @brief Defines the triangle bounding volume hierarchy used for picking.
+ *
+ * This header file contains the TriangleBVH class, a binary tree of axis-aligned boxes
+ * over the triangles of a mesh, and the RayHit structure it reports. The hierarchy keeps
+ * its own copy of the positions, so a mesh can still be ray-picked after its CPU vertices
+ * have been released.
+ *
+ * \copyright{Copyright (c) 2026 Luca Mazza. All rights reserved.}
+ * \license{This project is released under the MIT License.}
+ */
+
+#pragma once
+
+#include "lmgl/scene/frustum.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+namespace lmgl {
+
+namespace scene {
+
+/*!
+ * @brief Closest intersection found by a ray query.
+ */
+struct RayHit {
+
+    //! @brief Distance along the ray, in units of the ray direction.
+    float distance = std::numeric_limits<float>::max();
+
+    //! @brief Index of the hit triangle in the original index order.
+    unsigned int triangle = 0;
+
+    //! @brief Barycentric coordinates of the hit point (weights of the second and third corner).
+    glm::vec2 barycentric = glm::vec2(0.0f);
+};
+
+/*!
+ * @brief Bounding volume hierarchy over the triangles of a mesh, in object space.
+ *
+ * Nodes are split at the median centroid along their longest axis until they hold at
+ * most four triangles, and stored depth-first so that the left child always follows
+ * its parent. Only positions are stored (12 bytes per vertex), one sixth of a Vertex.
+ */
+class TriangleBVH {
+  public:
+    //! @brief Maximum number of triangles stored in a leaf.
+    static constexpr unsigned int LEAF_SIZE = 4;
+
+    /*!
+     * @brief Builds the hierarchy, replacing any previous one.
+     *
+     * @param positions Position of the first vertex.
+     * @param vertex_count Number of vertices.
+     * @param stride Distance between two positions in bytes.
+     * @param indices Triangle list indices.
+     */
+    void build(const glm::vec3 *positions, std::size_t vertex_count, std::size_t stride,
+               const std::vector<unsigned int> &indices);
+
+    /*!
+     * @brief Finds the closest triangle hit by a ray.
+     *
+     * Triangles are hit from both sides.
+     *
+     * @param origin Ray origin.
+     * @param direction Ray direction, need not be normalized.
+     * @param hit Closest hit, only written when the function returns true.
+     * @param max_distance Hits farther than this are ignored.
+     * @return True if a triangle was hit.
+     */
+    bool intersect(const glm::vec3 &origin, const glm::vec3 &direction, RayHit &hit,
+                   float max_distance = std::numeric_limits<float>::max()) const;
+
+    /*!
+     * @brief Check if the hierarchy holds no triangles.
+     *
+     * @return True if build() was not called or the mesh had no triangles.
+     */
+    inline bool empty() const { return m_nodes.empty(); }
+
+    /*!
+     * @brief Getter for the bounds of the root node.
+     *
+     * @return Box around every triangle, empty when there are none.
+     */
+    inline AABB get_bounds() const { return m_nodes.empty() ? AABB() : m_nodes[0].bounds; }
+
+    /*!
+     * @brief Getter for the number of nodes.
+     *
+     * @return Number of nodes, leaves included.
+     */
+    inline std::size_t get_node_count() const { return m_nodes.size(); }
+
+    /*!
+     * @brief Getter for the CPU memory held by the hierarchy.
+     *
+     * @return Size of the nodes, positions and triangle indices in bytes.
+     */
+    std::size_t get_memory_usage() const;
+
+  private:
+    //! @brief A node of the tree, a leaf when count is not zero.
+    struct Node {
+        AABB bounds;
+        unsigned int first = 0; //!< First triangle of a leaf, right child of an inner node.
+        unsigned int count = 0; //!< Number of triangles of a leaf.
+    };
+
+    //! @brief Nodes in depth-first order.
+    std::vector<Node> m_nodes;
+
+    //! @brief Copy of the vertex positions.
+    std::vector<glm::vec3> m_positions;
+
+    //! @brief Triangle indices, three per triangle, in leaf order.
+    std::vector<unsigned int> m_indices;
+
+    //! @brief Original index of each triangle, in leaf order.
+    std::vector<unsigned int> m_triangle_ids;
+};
+
+} // namespace scene
+
+} // namespace lmgl
@@ -87,6 +87,17 @@ class LOD {
      */
     std::shared_ptr<Mesh> get_mesh(float distance_sq) const;
 
+    /*!
+     * @brief Retrieves the index of the LOD level used at a squared distance.
+     *
+     * Follows the same rule as get_mesh(), so that callers can offset the level,
+     * e.g. to draw shadow casters coarser than the view.
+     *
+     * @param distance_sq Squared distance from the camera to the object.
+     * @return Index of the LOD level, 0 when there are no levels.
+     */
+    size_t get_level_index(float distance_sq) const;
+
     /*!
      * @brief Retrieves the appropriate mesh based on camera and object positions.
      *
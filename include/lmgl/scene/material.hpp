@@ -213,6 +213,13 @@ class Material {
      */
     inline std::shared_ptr<renderer::Texture> get_emissive_map() const { return m_emissive_map; };
 
+    /*!
+     * @brief Gets the shader features the material needs, one bit per texture map it has.
+     *
+     * @return Mask of renderer::Shader::Feature bits, used to pick a shader variant.
+     */
+    uint32_t get_features() const;
+
     /*!
      * @brief Binds the material properties and textures to the given shader.
      *
@@ -13,58 +13,33 @@
 
 #pragma once
 
+#include "lmgl/renderer/geometry_pool.hpp"
 #include "lmgl/renderer/shader.hpp"
 #include "lmgl/renderer/vertex_array.hpp"
+#include "lmgl/scene/bvh.hpp"
 #include "lmgl/scene/frustum.hpp"
 #include "lmgl/scene/material.hpp"
+#include "lmgl/scene/meshlet.hpp"
+#include "lmgl/scene/vertex.hpp"
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace lmgl {
 
 namespace scene {
 
 /*!
- * @brief Represents a single vertex in 3D space.
- *
- * The Vertex struct encapsulates the properties of a vertex, including its position,
- * normal vector, color, and texture coordinates (UVs). This structure is commonly used
- * in 3D graphics applications to define the attributes of vertices in a mesh.
+ * @brief What a mesh keeps of its geometry in CPU memory once it has been uploaded.
  */
-struct Vertex {
-
-    //! @brief Position of the vertex in 3D space.
-    glm::vec3 position;
-
-    //! @brief Normal vector at the vertex.
-    glm::vec3 normal;
-
-    //! @brief Color of the vertex.
-    glm::vec4 color;
-
-    //! @brief Texture coordinates (UVs) of the vertex.
-    glm::vec2 uvs;
-
-    //! @brief Texture tangent
-    glm::vec3 tangent;
-
-    //! @brief Texture bitangetn
-    glm::vec3 bitangent;
-
-    /*!
-     * @brief Constructor for the Vertex struct.
-     *
-     * Initializes a Vertex with specified position, normal, color, and UVs.
-     * Default values are provided for each attribute.
-     *
-     * @param pos Position of the vertex (default is (0.0, 0.0, 0.0)).
-     * @param norm Normal vector at the vertex (default is (0.0, 1.0, 0.0)).
-     * @param col Color of the vertex (default is (1.0, 1.0, 1.0, 1.0)).
-     * @param uv Texture coordinates of the vertex (default is (0.0, 0.0)).
-     */
-    Vertex(const glm::vec3 &pos = glm::vec3(0.0f), const glm::vec3 &norm = glm::vec3(0.0f, 1.0f, 0.0f),
-           const glm::vec4 &col = glm::vec4(1.0f), const glm::vec2 &uv = glm::vec2(0.0f))
-        : position(pos), normal(norm), color(col), uvs(uv) {}
+enum class GeometryResidency {
+    Keep,       //!< Keep the Vertex and index vectors (72 bytes per vertex).
+    Compressed, //!< Keep the vertices as PackedVertex (28 bytes per vertex) and the indices.
+    Release     //!< Drop the vertices and indices, only the GPU buffers, bounds and BVH remain.
 };
 
 /*!
@@ -88,6 +63,47 @@ class Mesh {
     Mesh(const std::vector<Vertex> &vert, const std::vector<unsigned int> &indices,
          std::shared_ptr<renderer::Shader> shader);
 
+    /*!
+     * @brief Constructor for the Mesh class, taking ownership of the geometry.
+     *
+     * Same as the copying constructor, but the vectors are moved into the mesh.
+     *
+     * @param vert Vector of Vertex objects defining the mesh geometry.
+     * @param indices Vector of unsigned integers defining the mesh indices.
+     * @param shader Shared pointer to the Shader object.
+     */
+    Mesh(std::vector<Vertex> &&vert, std::vector<unsigned int> &&indices, std::shared_ptr<renderer::Shader> shader);
+
+    /*!
+     * @brief Constructor for the Mesh class, storing the geometry in a shared pool.
+     *
+     * Instead of creating dedicated buffers, the vertices and indices are sub-allocated
+     * from the pool, and the mesh draws with a base vertex and first index. Meshes from
+     * the same pool page share one vertex array. If the pool layout does not match
+     * Vertex, the mesh falls back to dedicated buffers.
+     *
+     * @param vert Vector of Vertex objects defining the mesh geometry.
+     * @param indices Vector of unsigned integers defining the mesh indices.
+     * @param shader Shared pointer to the Shader object.
+     * @param pool Geometry pool created with Mesh::get_vertex_layout() (or get_packed_vertex_layout()
+     * when packed), may be nullptr.
+     * @param packed Upload the vertices as PackedVertex (default is false).
+     */
+    Mesh(const std::vector<Vertex> &vert, const std::vector<unsigned int> &indices,
+         std::shared_ptr<renderer::Shader> shader, std::shared_ptr<renderer::GeometryPool> pool, bool packed = false);
+
+    /*!
+     * @brief Constructor for the Mesh class, taking ownership of the geometry and storing it in a pool.
+     *
+     * @param vert Vector of Vertex objects defining the mesh geometry.
+     * @param indices Vector of unsigned integers defining the mesh indices.
+     * @param shader Shared pointer to the Shader object.
+     * @param pool Geometry pool, may be nullptr.
+     * @param packed Upload the vertices as PackedVertex (default is false).
+     */
+    Mesh(std::vector<Vertex> &&vert, std::vector<unsigned int> &&indices, std::shared_ptr<renderer::Shader> shader,
+         std::shared_ptr<renderer::GeometryPool> pool, bool packed = false);
+
     /*!
      * @brief Constructor for the Mesh class.
      *
@@ -123,6 +139,166 @@ class Mesh {
      */
     void render() const;
 
+    /*!
+     * @brief Builds the position-only stream used by depth passes.
+     *
+     * Uploads the positions of the CPU vertices to a separate 12-byte-per-vertex buffer and
+     * creates a depth vertex array that only binds location 0. Shadow and depth passes then
+     * fetch one sixth of the data they would read from the interleaved Vertex buffer. Pooled
+     * meshes get a dedicated position buffer and index buffer, the pool is left untouched.
+     *
+     * @return True if the stream was created, false if the mesh keeps no CPU vertices.
+     */
+    bool create_depth_stream();
+
+    /*!
+     * @brief Builds the position-only stream from the given positions.
+     *
+     * Use this overload for meshes created without CPU vertices (e.g. through create<V>()).
+     *
+     * @param positions One position per vertex, in the order of the mesh vertices.
+     */
+    void create_depth_stream(const std::vector<glm::vec3> &positions);
+
+    /*!
+     * @brief Check if the mesh carries a position-only depth stream.
+     *
+     * @return True if create_depth_stream() succeeded.
+     */
+    inline bool has_depth_stream() const { return m_depth_vertex_array != nullptr; }
+
+    /*!
+     * @brief Getter for the vertex array used by depth passes.
+     *
+     * @return The position-only vertex array if there is one, the regular vertex array otherwise.
+     */
+    inline std::shared_ptr<renderer::VertexArray> get_depth_vertex_array() const {
+        return m_depth_vertex_array ? m_depth_vertex_array : m_vertex_array;
+    }
+
+    /*!
+     * @brief Renders the mesh for a depth pass.
+     *
+     * Must be called with get_depth_vertex_array() bound. Falls back to render() when the
+     * mesh has no depth stream.
+     */
+    void render_depth() const;
+
+    /*!
+     * @brief Splits the mesh into meshlets for cluster culling.
+     *
+     * Reorders the indices so that every meshlet is a contiguous range and uploads them
+     * again. The renderer then culls meshlets against the frustum and their normal cone
+     * and draws only the visible ranges. Worth it for large meshes that are often partially
+     * visible, such as terrain chunks or architecture.
+     *
+     * @param max_vertices Maximum number of distinct vertices per meshlet (default is 64).
+     * @param max_triangles Maximum number of triangles per meshlet (default is 124).
+     * @return True if meshlets were built, false if the mesh keeps no CPU vertices.
+     */
+    bool build_meshlets(unsigned int max_vertices = 64, unsigned int max_triangles = 124);
+
+    /*!
+     * @brief Getter for the meshlets.
+     *
+     * @return Meshlets of the mesh, empty if build_meshlets() was not called.
+     */
+    inline const std::vector<Meshlet> &get_meshlets() const { return m_meshlets; }
+
+    /*!
+     * @brief Check if the mesh was split into meshlets.
+     *
+     * @return True if the mesh has meshlets.
+     */
+    inline bool has_meshlets() const { return !m_meshlets.empty(); }
+
+    /*!
+     * @brief Renders index ranges of the mesh with a single draw call.
+     *
+     * Must be called with the mesh vertex array bound.
+     *
+     * @param ranges Ranges relative to the first index of the mesh, e.g. from cull_meshlets().
+     */
+    void render_ranges(const std::vector<MeshletRange> &ranges) const;
+
+    /*!
+     * @brief Sets what the mesh keeps of its geometry in CPU memory.
+     *
+     * The dropped vectors are freed. Releasing the geometry builds the picking BVH first, so
+     * raycast() keeps working. Compressed meshes keep full-precision positions: depth streams,
+     * meshlets and the BVH can still be built from them, and they can go back to Keep (the
+     * other attributes come back with the precision of PackedVertex). Released geometry
+     * cannot be restored.
+     *
+     * @param residency New residency.
+     * @return True on success, false when asked to restore released geometry.
+     */
+    bool set_residency(GeometryResidency residency);
+
+    /*!
+     * @brief Getter for the geometry residency.
+     *
+     * @return Current residency, Keep for meshes built from CPU vertices.
+     */
+    inline GeometryResidency get_residency() const { return m_residency; }
+
+    /*!
+     * @brief Getter for the unique id of the mesh.
+     *
+     * Unlike the address of the mesh, an id is never handed out again, so caches keyed on it
+     * cannot mistake a new mesh for a freed one.
+     *
+     * @return Id of the mesh, unique for the lifetime of the program.
+     */
+    inline uint64_t get_uid() const { return m_uid; }
+
+    /*!
+     * @brief Getter for the CPU memory held by the geometry.
+     *
+     * @return Size of the vertex, compressed vertex and index vectors and of the BVH in bytes.
+     */
+    std::size_t get_cpu_memory_usage() const;
+
+    /*!
+     * @brief Builds the triangle BVH used by raycast().
+     *
+     * @return True if the BVH was built, false if the mesh keeps no CPU positions or indices.
+     */
+    bool build_bvh();
+
+    /*!
+     * @brief Builds the triangle BVH from positions the mesh does not keep.
+     *
+     * For meshes uploaded without CPU vertices, such as the ones from create_from_vertex_array().
+     *
+     * @param positions Position of the first vertex.
+     * @param vertex_count Number of vertices.
+     * @param stride Distance between two positions in bytes.
+     * @return True if the BVH was built, false if the mesh keeps no indices.
+     */
+    bool build_bvh(const glm::vec3 *positions, std::size_t vertex_count, std::size_t stride);
+
+    /*!
+     * @brief Getter for the triangle BVH.
+     *
+     * @return The BVH, empty until build_bvh() or releasing the geometry builds it.
+     */
+    inline const TriangleBVH &get_bvh() const { return m_bvh; }
+
+    /*!
+     * @brief Finds the closest triangle hit by an object-space ray.
+     *
+     * Requires the BVH, see build_bvh().
+     *
+     * @param origin Ray origin in object space.
+     * @param direction Ray direction in object space.
+     * @param hit Closest hit, only written when the function returns true.
+     * @return True if a triangle was hit.
+     */
+    inline bool raycast(const glm::vec3 &origin, const glm::vec3 &direction, RayHit &hit) const {
+        return m_bvh.intersect(origin, direction, hit);
+    }
+
     /*!
      * @brief Getter for vertex array
      *
@@ -168,6 +344,15 @@ class Mesh {
      */
     inline const std::vector<Vertex> &get_vertices() const { return m_vertices; }
 
+    /*!
+     * @brief Getter for the index type used by the draw calls.
+     *
+     * Dedicated buffers use 16-bit indices when the mesh has at most 65536 vertices.
+     *
+     * @return GL_UNSIGNED_SHORT or GL_UNSIGNED_INT.
+     */
+    inline unsigned int get_index_type() const { return m_index_type; }
+
     /*!
      * @brief Getter for indices
      *
@@ -218,8 +403,107 @@ class Mesh {
      */
     inline const BoundingSphere &get_bounding_sphere() const { return m_bounding_sphere; }
 
+    /*!
+     * @brief Getter for the pooled geometry range
+     *
+     * @return Shared pointer to the allocation, or nullptr if the mesh owns its buffers.
+     */
+    inline std::shared_ptr<renderer::GeometryAllocation> get_allocation() const { return m_allocation; }
+
+    /*!
+     * @brief Check if the mesh geometry lives in a shared geometry pool.
+     *
+     * @return True if the mesh was sub-allocated from a GeometryPool, false otherwise.
+     */
+    inline bool is_pooled() const { return m_allocation != nullptr; }
+
+    /*!
+     * @brief Get the buffer layout matching the Vertex struct.
+     *
+     * Use this layout to create geometry pools that store Mesh vertices.
+     *
+     * @return BufferLayout describing Vertex.
+     */
+    static renderer::BufferLayout get_vertex_layout();
+
+    /*!
+     * @brief Check if the GPU copy of the vertices uses the PackedVertex format.
+     *
+     * Shaders must decode the normal and rebuild the bitangent for packed meshes;
+     * the renderer sets u_PackedVertex accordingly.
+     *
+     * @return True if the mesh was uploaded packed.
+     */
+    inline bool is_packed() const { return m_packed; }
+
+    /*!
+     * @brief Get the buffer layout matching the PackedVertex struct.
+     *
+     * @return BufferLayout describing PackedVertex.
+     */
+    static renderer::BufferLayout get_packed_vertex_layout();
+
+    /*!
+     * @brief Convert vertices to the packed format.
+     *
+     * @param vertices Vertices to convert.
+     * @return Packed vertices, in the same order.
+     */
+    static std::vector<PackedVertex> pack_vertices(const std::vector<Vertex> &vertices);
+
+    /*!
+     * @brief Convert packed vertices back to the full format.
+     *
+     * The bitangent is rebuilt from the normal, the tangent and its handedness.
+     *
+     * @param packed Packed vertices to convert.
+     * @return Vertices, in the same order.
+     */
+    static std::vector<Vertex> unpack_vertices(const std::vector<PackedVertex> &packed);
+
     // Factory Methods
 
+    /*!
+     * @brief Creates a mesh from any vertex struct with a VertexFormat.
+     *
+     * The buffer layout, stride and attribute locations are derived from VertexFormat<V> and
+     * checked at compile time, so formats that leave attributes out (e.g. PositionVertex)
+     * upload only what they contain. Unlike the Vertex constructors, no CPU copy of the
+     * vertices is kept: get_vertices() is empty, while the indices and bounds are available.
+     *
+     * @tparam V Vertex struct with a VertexFormat specialization and a glm::vec3 position member.
+     * @param vertices Vertices to upload.
+     * @param indices Indices of the mesh.
+     * @param shader Shared pointer to the Shader object.
+     * @param pool Geometry pool created with make_vertex_layout<V>() (default is nullptr, dedicated buffers).
+     * @return Shared pointer to the created Mesh object.
+     */
+    template <typename V>
+    static std::shared_ptr<Mesh> create(const std::vector<V> &vertices, std::vector<unsigned int> indices,
+                                        std::shared_ptr<renderer::Shader> shader,
+                                        std::shared_ptr<renderer::GeometryPool> pool = nullptr);
+
+    /*!
+     * @brief Creates a mesh around a vertex array whose buffers are already uploaded.
+     *
+     * For loaders that upload file data in place, attribute by attribute. The vertex array
+     * must have its index buffer set. The positions are only read to compute the bounds: like
+     * create(), the mesh keeps its indices but no CPU vertices.
+     *
+     * @param vertex_array Vertex array with the attribute and index buffers.
+     * @param indices Indices of the mesh, matching the index buffer.
+     * @param positions Position of the first vertex.
+     * @param vertex_count Number of vertices.
+     * @param stride Distance between two positions in bytes.
+     * @param shader Shared pointer to the Shader object.
+     * @return Shared pointer to the created Mesh object.
+     */
+    static std::shared_ptr<Mesh> create_from_vertex_array(std::shared_ptr<renderer::VertexArray> vertex_array,
+                                                          std::vector<unsigned int> indices,
+                                                          const glm::vec3 *positions, std::size_t vertex_count,
+                                                          std::size_t stride,
+                                                          std::shared_ptr<renderer::Shader> shader);
+
     /*!
      * @brief Creates a cube mesh.
      *
@@ -259,6 +543,9 @@ class Mesh {
                                                unsigned int lonsegs = 32, unsigned int latsegs = 32);
 
   private:
+    //! @brief Unique id of the mesh, see get_uid().
+    uint64_t m_uid = next_uid();
+
     //! @brief Material associated to the mesh.
     std::shared_ptr<Material> m_material;
 
@@ -271,6 +558,9 @@ class Mesh {
     //! @brief Number of indices in the mesh.
     unsigned int m_index_count;
 
+    //! @brief OpenGL type of the indices of the dedicated index buffer.
+    unsigned int m_index_type;
+
     //! @brief Vector of vertices defining the mesh geometry.
     std::vector<Vertex> m_vertices;
 
@@ -283,12 +573,61 @@ class Mesh {
     //! @brief Bounding sphere of the mesh.
     BoundingSphere m_bounding_sphere;
 
+    //! @brief Range inside a geometry pool, nullptr when the mesh owns its buffers.
+    std::shared_ptr<renderer::GeometryAllocation> m_allocation;
+
+    //! @brief Whether the GPU vertices use the PackedVertex format.
+    bool m_packed = false;
+
+    //! @brief Meshlets in index order, empty when the mesh is drawn as a whole.
+    std::vector<Meshlet> m_meshlets;
+
+    //! @brief Position-only vertex array for depth passes, nullptr when there is no depth stream.
+    std::shared_ptr<renderer::VertexArray> m_depth_vertex_array;
+
+    //! @brief What the mesh keeps of its geometry in CPU memory.
+    GeometryResidency m_residency = GeometryResidency::Keep;
+
+    //! @brief Packed copy of the vertices, only filled with GeometryResidency::Compressed.
+    std::vector<PackedVertex> m_compressed_vertices;
+
+    //! @brief Triangle hierarchy for picking, built before CPU geometry is dropped.
+    TriangleBVH m_bvh;
+
     /*!
-     * @brief Sets up the mesh by creating the vertex array.
+     * @brief Finds the CPU copy of the positions, full or compressed.
      *
-     * Initializes the vertex array using the stored vertices and indices.
+     * @param stride Set to the distance between two positions in bytes.
+     * @param count Set to the number of vertices.
+     * @return Position of the first vertex, nullptr if the mesh keeps no CPU vertices.
      */
-    void setup_mesh();
+    const glm::vec3 *cpu_positions(std::size_t &stride, std::size_t &count) const;
+
+    /*!
+     * @brief Uploads strided positions as the depth stream.
+     *
+     * @param first_position Position of the first vertex.
+     * @param count Number of vertices.
+     * @param stride Distance between two positions in bytes.
+     */
+    void create_depth_stream(const glm::vec3 *first_position, size_t count, size_t stride);
+
+    //! @brief Takes the next mesh id from a counter shared by all threads.
+    static uint64_t next_uid();
+
+    /*!
+     * @brief Uploads vertex and index data and creates the vertex array.
+     *
+     * Sub-allocates from the pool when it is given and its layout matches, otherwise
+     * creates dedicated buffers, with 16-bit indices when the vertex count allows it.
+     *
+     * @param vertices Pointer to vertex data laid out according to layout.
+     * @param vertex_count Number of vertices.
+     * @param layout Layout of the vertex data.
+     * @param pool Pool to sub-allocate the geometry from, may be nullptr.
+     */
+    void upload(const void *vertices, unsigned int vertex_count, const renderer::BufferLayout &layout,
+                renderer::GeometryPool *pool);
 
     /*!
      * @brief Calculates the bounding box and bounding sphere of the mesh.
@@ -296,7 +635,31 @@ class Mesh {
      * Computes the axis-aligned bounding box and bounding sphere based on the mesh vertices.
      */
     void calculate_bounds();
+
+    /*!
+     * @brief Calculates the bounds from strided positions.
+     *
+     * @param first_position Position of the first vertex, may be nullptr if there are none.
+     * @param count Number of vertices.
+     * @param stride Distance between two positions in bytes.
+     */
+    void calculate_bounds(const glm::vec3 *first_position, size_t count, size_t stride);
 };
 
+template <typename V>
+std::shared_ptr<Mesh> Mesh::create(const std::vector<V> &vertices, std::vector<unsigned int> indices,
+                                   std::shared_ptr<renderer::Shader> shader,
+                                   std::shared_ptr<renderer::GeometryPool> pool) {
+    static_assert(std::is_same<decltype(V::position), glm::vec3>::value,
+                  "Mesh vertex formats need a glm::vec3 position member");
+    static const renderer::BufferLayout layout = renderer::make_vertex_layout<V>();
+    auto mesh = std::make_shared<Mesh>(nullptr, shader, static_cast<unsigned int>(indices.size()));
+    mesh->m_indices = std::move(indices);
+    mesh->m_packed = std::is_same<V, PackedVertex>::value;
+    mesh->upload(vertices.data(), static_cast<unsigned int>(vertices.size()), layout, pool.get());
+    mesh->calculate_bounds(vertices.empty() ? nullptr : &vertices[0].position, vertices.size(), sizeof(V));
+    return mesh;
+}
+
 } // namespace scene
 } // namespace lmgl
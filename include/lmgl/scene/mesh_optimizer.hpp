@@ -0,0 +1,178 @@
+/*!
+ * @file mesh_optimizer.hpp
+ * @brief Defines the MeshOptimizer class for reordering mesh geometry before upload.
+ *
+ * This header file contains the MeshOptimizer class, which reorders triangles and vertices
+ * so that the GPU transforms fewer vertices and shades fewer hidden fragments. The pipeline
+ * runs in three steps: triangle reordering for the post-transform vertex cache (Forsyth),
+ * overdraw-aware reordering of triangle clusters, and vertex fetch remapping so that
+ * vertices are stored in the order they are first referenced.
+ *
+ * \copyright{Copyright (c) 2026 Luca Mazza. All rights reserved.}
+ * \license{This project is released under the MIT License.}
+ */
+
+#pragma once
+
+#include "lmgl/scene/vertex.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+namespace lmgl {
+
+namespace scene {
+
+/*!
+ * @brief Post-transform vertex cache statistics of an index sequence.
+ *
+ * Computed by simulating a FIFO cache of the given size.
+ */
+struct VertexCacheStatistics {
+
+    //! @brief Number of vertices transformed (cache misses).
+    unsigned int vertices_transformed = 0;
+
+    //! @brief Average cache miss ratio: transformed vertices per triangle (0.5 is optimal, 3 is worst).
+    float acmr = 0.0f;
+
+    //! @brief Average transform to vertex ratio: transformed vertices per vertex (1 is optimal).
+    float atvr = 0.0f;
+};
+
+/*!
+ * @brief Options of the full optimization pipeline.
+ */
+struct MeshOptimizerOptions {
+    bool vertex_cache = true; //!< Whether to reorder triangles for the vertex cache
+    bool overdraw = true;     //!< Whether to reorder triangle clusters to reduce overdraw
+    bool vertex_fetch = true; //!< Whether to reorder vertices in first-use order
+    //! Maximum ACMR degradation accepted by the overdraw step (1.05 allows 5% more misses).
+    float overdraw_threshold = 1.05f;
+};
+
+/*!
+ * @brief Cache statistics measured before and after an optimization.
+ */
+struct MeshOptimizationReport {
+
+    //! @brief Statistics of the input geometry.
+    VertexCacheStatistics before;
+
+    //! @brief Statistics of the optimized geometry.
+    VertexCacheStatistics after;
+};
+
+/*!
+ * @brief Reorders triangle lists to make better use of the GPU.
+ *
+ * All functions work on triangle lists. Index functions return a new index vector and
+ * never change the number of triangles.
+ */
+class MeshOptimizer {
+  public:
+    //! @brief Cache size used by analyze_vertex_cache() when none is given.
+    static constexpr unsigned int default_cache_size = 16;
+
+    /*!
+     * @brief Simulate a FIFO post-transform cache over an index sequence.
+     *
+     * @param indices Triangle list indices.
+     * @param vertex_count Number of vertices referenced by the indices.
+     * @param cache_size Number of entries of the simulated cache.
+     * @return ACMR and ATVR of the sequence.
+     */
+    static VertexCacheStatistics analyze_vertex_cache(const std::vector<unsigned int> &indices,
+                                                      unsigned int vertex_count,
+                                                      unsigned int cache_size = default_cache_size);
+
+    /*!
+     * @brief Reorder triangles for the post-transform vertex cache.
+     *
+     * Implements Tom Forsyth's linear-speed vertex cache optimization: triangles are emitted
+     * greedily by a score that favours vertices recently used and vertices with few
+     * remaining triangles, which keeps the result good for any cache size.
+     *
+     * @param indices Triangle list indices.
+     * @param vertex_count Number of vertices referenced by the indices.
+     * @return Reordered indices.
+     */
+    static std::vector<unsigned int> optimize_vertex_cache(const std::vector<unsigned int> &indices,
+                                                           unsigned int vertex_count);
+
+    /*!
+     * @brief Reorder clusters of triangles to reduce overdraw.
+     *
+     * The cache-optimized sequence is split into clusters wherever it can be cut without
+     * raising the ACMR above threshold times its current value. Clusters are then sorted so
+     * that those facing away from the mesh centre come first, which lets them occlude the
+     * rest from most view directions. Run this after optimize_vertex_cache().
+     *
+     * @param indices Cache-optimized triangle list indices.
+     * @param positions Position of the first vertex.
+     * @param vertex_count Number of vertices.
+     * @param stride Distance between two positions in bytes.
+     * @param threshold Maximum ACMR degradation (1.05 allows 5% more misses).
+     * @return Reordered indices.
+     */
+    static std::vector<unsigned int> optimize_overdraw(const std::vector<unsigned int> &indices,
+                                                       const glm::vec3 *positions, unsigned int vertex_count,
+                                                       std::size_t stride, float threshold = 1.05f);
+
+    /*!
+     * @brief Compute the vertex order that matches the index order.
+     *
+     * Rewrites the indices so that vertices are numbered in the order they are first
+     * referenced. Vertices never referenced are dropped.
+     *
+     * @param indices Triangle list indices, rewritten in place.
+     * @param vertex_count Number of vertices.
+     * @return For each old vertex, its new position, or invalid if it is unused.
+     */
+    static std::vector<unsigned int> optimize_vertex_fetch_remap(std::vector<unsigned int> &indices,
+                                                                 unsigned int vertex_count);
+
+    /*!
+     * @brief Reorder vertices in the order they are first referenced.
+     *
+     * @tparam V Vertex struct.
+     * @param vertices Vertices, reordered in place (unused ones are removed).
+     * @param indices Triangle list indices, rewritten in place.
+     */
+    template <typename V>
+    static void optimize_vertex_fetch(std::vector<V> &vertices, std::vector<unsigned int> &indices);
+
+    /*!
+     * @brief Run the optimization pipeline on a mesh.
+     *
+     * @param vertices Vertices, reordered in place.
+     * @param indices Triangle list indices, reordered in place.
+     * @param options Steps to run.
+     * @return Cache statistics before and after the optimization.
+     */
+    static MeshOptimizationReport optimize(std::vector<Vertex> &vertices, std::vector<unsigned int> &indices,
+                                           const MeshOptimizerOptions &options = MeshOptimizerOptions());
+
+    //! @brief Marks vertices removed by optimize_vertex_fetch_remap().
+    static constexpr unsigned int invalid = 0xFFFFFFFFu;
+};
+
+template <typename V>
+void MeshOptimizer::optimize_vertex_fetch(std::vector<V> &vertices, std::vector<unsigned int> &indices) {
+    std::vector<unsigned int> remap = optimize_vertex_fetch_remap(indices, static_cast<unsigned int>(vertices.size()));
+    std::size_t used = 0;
+    for (unsigned int target : remap)
+        used += target != invalid ? 1 : 0;
+    std::vector<V> reordered(used);
+    for (std::size_t i = 0; i < remap.size(); ++i) {
+        if (remap[i] != invalid)
+            reordered[remap[i]] = vertices[i];
+    }
+    vertices.swap(reordered);
+}
+
+} // namespace scene
+
+} // namespace lmgl
@@ -0,0 +1,120 @@
+/*!
+ * @file meshlet.hpp
+ * @brief Defines meshlets and the CPU cluster culling pass.
+ *
+ * This header file contains the Meshlet and MeshletRange structures together with the
+ * functions that split a triangle list into meshlets and cull them. A meshlet is a small
+ * cluster of triangles (up to 124 by default, sharing at most 64 vertices) stored as a
+ * contiguous range of the mesh index buffer, with its own bounding sphere and normal cone.
+ * Culling meshlets against the view frustum and the cone lets large, partially visible
+ * meshes submit only the clusters that can contribute pixels.
+ *
+ * \copyright{Copyright (c) 2026 Luca Mazza. All rights reserved.}
+ * \license{This project is released under the MIT License.}
+ */
+
+#pragma once
+
+#include "lmgl/scene/frustum.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+namespace lmgl {
+
+namespace scene {
+
+/*!
+ * @brief A cluster of triangles with its culling data, in object space.
+ */
+struct Meshlet {
+
+    //! @brief Offset of the first index, relative to the first index of the mesh.
+    unsigned int first_index = 0;
+
+    //! @brief Number of triangles in the meshlet.
+    unsigned int triangle_count = 0;
+
+    //! @brief Number of distinct vertices referenced by the meshlet.
+    unsigned int vertex_count = 0;
+
+    //! @brief Bounding sphere of the meshlet vertices.
+    BoundingSphere bounds;
+
+    //! @brief Average facing direction of the triangles.
+    glm::vec3 cone_axis = glm::vec3(0.0f, 0.0f, 1.0f);
+
+    //! @brief Apex of the normal cone, behind every triangle plane of the meshlet.
+    glm::vec3 cone_apex = glm::vec3(0.0f);
+
+    /*!
+     * @brief Sine of the largest angle between a triangle normal and the axis.
+     *
+     * 1 when the normals spread too much for the cone to ever cull the meshlet.
+     */
+    float cone_cutoff = 1.0f;
+};
+
+/*!
+ * @brief A contiguous range of indices to draw, produced by cull_meshlets().
+ */
+struct MeshletRange {
+
+    //! @brief Offset of the first index, relative to the first index of the mesh.
+    unsigned int first_index;
+
+    //! @brief Number of indices in the range.
+    unsigned int index_count;
+};
+
+/*!
+ * @brief Split a triangle list into meshlets.
+ *
+ * Meshlets are grown greedily from a seed triangle, always adding the neighbouring
+ * triangle that brings in the fewest new vertices (the one closest to the meshlet centre
+ * on ties), so that clusters stay spatially compact. The indices are reordered so that
+ * every meshlet is a contiguous range.
+ *
+ * @param indices Triangle list indices, reordered in place.
+ * @param positions Position of the first vertex.
+ * @param vertex_count Number of vertices.
+ * @param stride Distance between two positions in bytes.
+ * @param max_vertices Maximum number of distinct vertices per meshlet (default is 64).
+ * @param max_triangles Maximum number of triangles per meshlet (default is 124).
+ * @return Meshlets in index order.
+ */
+std::vector<Meshlet> build_meshlets(std::vector<unsigned int> &indices, const glm::vec3 *positions,
+                                    unsigned int vertex_count, std::size_t stride, unsigned int max_vertices = 64,
+                                    unsigned int max_triangles = 124);
+
+/*!
+ * @brief Check whether a meshlet faces away from a point.
+ *
+ * @param meshlet Meshlet to test.
+ * @param camera_position Viewer position in the meshlet (object) space.
+ * @return True if every triangle of the meshlet is back-facing from the point.
+ */
+bool is_meshlet_backfacing(const Meshlet &meshlet, const glm::vec3 &camera_position);
+
+/*!
+ * @brief Cull meshlets and collect the index ranges to draw.
+ *
+ * Meshlets outside the frustum, or facing away from the camera, are dropped. Visible
+ * meshlets that are adjacent in the index buffer are merged into a single range.
+ *
+ * @param meshlets Meshlets of the mesh.
+ * @param frustum World-space view frustum.
+ * @param model Model matrix of the mesh.
+ * @param camera_position World-space camera position.
+ * @param cone_culling Whether to cull back-facing meshlets (disable with face culling off).
+ * @param ranges Output ranges, cleared first.
+ * @return Number of visible triangles.
+ */
+unsigned int cull_meshlets(const std::vector<Meshlet> &meshlets, const Frustum &frustum, const glm::mat4 &model,
+                           const glm::vec3 &camera_position, bool cone_culling, std::vector<MeshletRange> &ranges);
+
+} // namespace scene
+
+} // namespace lmgl
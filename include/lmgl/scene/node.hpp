@@ -316,6 +316,34 @@ class Node : public std::enable_shared_from_this<Node> {
      */
     inline bool has_lod() const { return m_lod != nullptr && m_lod->has_levels(); }
 
+    /*!
+     * @brief Mark the node as static, a hint that its mesh and transform rarely change.
+     *
+     * Shadow maps cache the depth of static shadow casters and only draw them again when
+     * one of them, or the light, changed.
+     *
+     * @param is_static True for static, false for dynamic (default).
+     */
+    inline void set_static(bool is_static) { m_static = is_static; }
+
+    /*!
+     * @brief Check if the node is marked as static.
+     *
+     * @return True if the node is static.
+     */
+    inline bool is_static() const { return m_static; }
+
+    /*!
+     * @brief Copy the node and its descendants.
+     *
+     * The copy shares the meshes and LODs of the original, so it costs one node per node
+     * and no GPU memory; lights are copied so that each copy can move its own. The copy
+     * has no parent.
+     *
+     * @return Shared pointer to the root of the copy.
+     */
+    std::shared_ptr<Node> clone() const;
+
     /*!
      * @brief Get the appropriate mesh for rendering based on camera position.
      *
@@ -361,6 +389,9 @@ class Node : public std::enable_shared_from_this<Node> {
     //! @brief LOD (Level of Detail) associated with the node
     std::shared_ptr<LOD> m_lod;
 
+    //! @brief Whether the mesh and transform of the node rarely change
+    bool m_static = false;
+
     /*!
      * @brief Update the local transformation matrix.
      *
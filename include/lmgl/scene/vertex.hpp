@@ -0,0 +1,216 @@
+/*!
+ * @file vertex.hpp
+ * @brief Defines the vertex structs used by meshes and their compile-time formats.
+ *
+ * This header file contains Vertex, the full-precision vertex produced by the model loader
+ * and the mesh factories, PackedVertex, its compact GPU form, and smaller formats for
+ * geometry that does not need every attribute. Each struct has a VertexFormat
+ * specialization, so Mesh::create and renderer::make_vertex_layout can derive the buffer
+ * layout at compile time.
+ *
+ * \copyright{Copyright (c) 2026 Luca Mazza. All rights reserved.}
+ * \license{This project is released under the MIT License.}
+ */
+
+#pragma once
+
+#include "lmgl/renderer/vertex_format.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+
+namespace lmgl {
+
+namespace scene {
+
+/*!
+ * @brief Represents a single vertex in 3D space.
+ *
+ * The Vertex struct encapsulates the properties of a vertex, including its position,
+ * normal vector, color, and texture coordinates (UVs). This structure is commonly used
+ * in 3D graphics applications to define the attributes of vertices in a mesh.
+ */
+struct Vertex {
+
+    //! @brief Position of the vertex in 3D space.
+    glm::vec3 position;
+
+    //! @brief Normal vector at the vertex.
+    glm::vec3 normal;
+
+    //! @brief Color of the vertex.
+    glm::vec4 color;
+
+    //! @brief Texture coordinates (UVs) of the vertex.
+    glm::vec2 uvs;
+
+    //! @brief Texture tangent
+    glm::vec3 tangent;
+
+    //! @brief Texture bitangetn
+    glm::vec3 bitangent;
+
+    /*!
+     * @brief Constructor for the Vertex struct.
+     *
+     * Initializes a Vertex with specified position, normal, color, and UVs.
+     * Default values are provided for each attribute.
+     *
+     * @param pos Position of the vertex (default is (0.0, 0.0, 0.0)).
+     * @param norm Normal vector at the vertex (default is (0.0, 1.0, 0.0)).
+     * @param col Color of the vertex (default is (1.0, 1.0, 1.0, 1.0)).
+     * @param uv Texture coordinates of the vertex (default is (0.0, 0.0)).
+     */
+    Vertex(const glm::vec3 &pos = glm::vec3(0.0f), const glm::vec3 &norm = glm::vec3(0.0f, 1.0f, 0.0f),
+           const glm::vec4 &col = glm::vec4(1.0f), const glm::vec2 &uv = glm::vec2(0.0f))
+        : position(pos), normal(norm), color(col), uvs(uv) {}
+};
+
+/*!
+ * @brief Compact GPU representation of a Vertex (28 bytes instead of 72).
+ *
+ * The normal is octahedral-encoded into two signed shorts, the tangent is stored as
+ * 10:10:10 with the bitangent sign in the 2-bit w component, the color as four unsigned
+ * bytes and the UVs as half floats. Attribute locations match Vertex except that there
+ * is no bitangent: shaders rebuild it as cross(normal, tangent.xyz) * tangent.w.
+ * Only the position keeps full precision.
+ */
+struct PackedVertex {
+
+    //! @brief Position of the vertex in 3D space.
+    glm::vec3 position;
+
+    //! @brief Octahedral normal, two snorm16 values.
+    std::uint32_t normal;
+
+    //! @brief Color, four unorm8 values.
+    std::uint32_t color;
+
+    //! @brief Texture coordinates, two half floats.
+    std::uint32_t uvs;
+
+    //! @brief Tangent as snorm 10:10:10, bitangent sign in the 2-bit w.
+    std::uint32_t tangent;
+};
+
+/*!
+ * @brief Position-only vertex, for depth-only passes and simple geometry.
+ */
+struct PositionVertex {
+
+    //! @brief Position of the vertex in 3D space.
+    glm::vec3 position;
+};
+
+/*!
+ * @brief Vertex with position, normal and texture coordinates, for lit geometry without normal mapping.
+ */
+struct PositionNormalUVVertex {
+
+    //! @brief Position of the vertex in 3D space.
+    glm::vec3 position;
+
+    //! @brief Normal vector at the vertex.
+    glm::vec3 normal;
+
+    //! @brief Texture coordinates (UVs) of the vertex.
+    glm::vec2 uvs;
+};
+
+/*!
+ * @brief Vertex for skinned meshes with up to four joint influences.
+ *
+ * Joint indices and weights are stored as bytes; weights are normalized to [0, 1].
+ */
+struct SkinnedVertex {
+
+    //! @brief Position of the vertex in 3D space.
+    glm::vec3 position;
+
+    //! @brief Normal vector at the vertex.
+    glm::vec3 normal;
+
+    //! @brief Texture coordinates (UVs) of the vertex.
+    glm::vec2 uvs;
+
+    //! @brief Tangent, with the bitangent sign in w.
+    glm::vec4 tangent;
+
+    //! @brief Indices of the influencing joints.
+    std::uint8_t joints[4];
+
+    //! @brief Weights of the influencing joints.
+    std::uint8_t weights[4];
+};
+
+/*!
+ * @brief Two-dimensional vertex used by UI quads and text.
+ */
+struct UIVertex {
+
+    //! @brief Position in canvas pixels.
+    glm::vec2 position;
+
+    //! @brief Texture coordinates.
+    glm::vec2 uvs;
+};
+
+} // namespace scene
+
+namespace renderer {
+
+// Locations follow pbr.glsl: 0 position, 1 normal, 2 color, 3 UVs, 4 tangent, 5 bitangent,
+// 6-9 per-draw model matrix. Skinning data uses 10 and 11.
+
+template <> struct VertexFormat<scene::Vertex> {
+    static constexpr VertexAttribute attributes[] = {
+        LMGL_VERTEX_ATTRIBUTE(scene::Vertex, position, ShaderDataType::Float3, 0, false),
+        LMGL_VERTEX_ATTRIBUTE(scene::Vertex, normal, ShaderDataType::Float3, 1, false),
+        LMGL_VERTEX_ATTRIBUTE(scene::Vertex, color, ShaderDataType::Float4, 2, false),
+        LMGL_VERTEX_ATTRIBUTE(scene::Vertex, uvs, ShaderDataType::Float2, 3, false),
+        LMGL_VERTEX_ATTRIBUTE(scene::Vertex, tangent, ShaderDataType::Float3, 4, false),
+        LMGL_VERTEX_ATTRIBUTE(scene::Vertex, bitangent, ShaderDataType::Float3, 5, false)};
+};
+
+template <> struct VertexFormat<scene::PackedVertex> {
+    static constexpr VertexAttribute attributes[] = {
+        LMGL_VERTEX_ATTRIBUTE(scene::PackedVertex, position, ShaderDataType::Float3, 0, false),
+        LMGL_VERTEX_ATTRIBUTE(scene::PackedVertex, normal, ShaderDataType::Short2, 1, true),
+        LMGL_VERTEX_ATTRIBUTE(scene::PackedVertex, color, ShaderDataType::UByte4, 2, true),
+        LMGL_VERTEX_ATTRIBUTE(scene::PackedVertex, uvs, ShaderDataType::Half2, 3, false),
+        LMGL_VERTEX_ATTRIBUTE(scene::PackedVertex, tangent, ShaderDataType::Int2_10_10_10, 4, true)};
+};
+
+template <> struct VertexFormat<scene::PositionVertex> {
+    static constexpr VertexAttribute attributes[] = {
+        LMGL_VERTEX_ATTRIBUTE(scene::PositionVertex, position, ShaderDataType::Float3, 0, false)};
+};
+
+template <> struct VertexFormat<scene::PositionNormalUVVertex> {
+    static constexpr VertexAttribute attributes[] = {
+        LMGL_VERTEX_ATTRIBUTE(scene::PositionNormalUVVertex, position, ShaderDataType::Float3, 0, false),
+        LMGL_VERTEX_ATTRIBUTE(scene::PositionNormalUVVertex, normal, ShaderDataType::Float3, 1, false),
+        LMGL_VERTEX_ATTRIBUTE(scene::PositionNormalUVVertex, uvs, ShaderDataType::Float2, 3, false)};
+};
+
+template <> struct VertexFormat<scene::SkinnedVertex> {
+    static constexpr VertexAttribute attributes[] = {
+        LMGL_VERTEX_ATTRIBUTE(scene::SkinnedVertex, position, ShaderDataType::Float3, 0, false),
+        LMGL_VERTEX_ATTRIBUTE(scene::SkinnedVertex, normal, ShaderDataType::Float3, 1, false),
+        LMGL_VERTEX_ATTRIBUTE(scene::SkinnedVertex, uvs, ShaderDataType::Float2, 3, false),
+        LMGL_VERTEX_ATTRIBUTE(scene::SkinnedVertex, tangent, ShaderDataType::Float4, 4, false),
+        LMGL_VERTEX_ATTRIBUTE(scene::SkinnedVertex, joints, ShaderDataType::UByte4I, 10, false),
+        LMGL_VERTEX_ATTRIBUTE(scene::SkinnedVertex, weights, ShaderDataType::UByte4, 11, true)};
+};
+
+// UI shaders read a_position at 0 and a_tex_coord at 1
+template <> struct VertexFormat<scene::UIVertex> {
+    static constexpr VertexAttribute attributes[] = {
+        LMGL_VERTEX_ATTRIBUTE(scene::UIVertex, position, ShaderDataType::Float2, 0, false),
+        LMGL_VERTEX_ATTRIBUTE(scene::UIVertex, uvs, ShaderDataType::Float2, 1, false)};
+};
+
+} // namespace renderer
+
+} // namespace lmgl
@@ -11,6 +11,7 @@
 
 #pragma once
 
+#include "lmgl/core/resource_cache.hpp"
 #include "lmgl/renderer/texture.hpp"
 
 #include <glm/glm.hpp>
@@ -102,6 +103,15 @@ class Font {
      */
     float measure_text(const std::string &text) const;
 
+    /*!
+     * @brief Get the memory taken by the glyph atlas.
+     *
+     * @return Size in bytes, one byte per atlas pixel.
+     */
+    inline size_t get_memory_usage() const {
+        return m_atlas ? static_cast<size_t>(m_atlas->get_width()) * static_cast<size_t>(m_atlas->get_height()) : 0;
+    }
+
   private:
     //! @brief Font size in pixels
     unsigned int m_font_size;
@@ -126,7 +136,9 @@ class Font {
 /*!
  * @brief Font manager for caching loaded fonts.
  *
- * Singleton class that manages font loading and caching.
+ * Singleton class that manages font loading and caching. Fonts are measured by their
+ * glyph atlas; with a budget set, the least recently used fonts that no text element
+ * holds anymore are released.
  */
 class FontManager {
   public:
@@ -168,12 +180,42 @@ class FontManager {
      */
     void clear();
 
+    /*!
+     * @brief Set the memory budget of the cache.
+     *
+     * Evicts unused fonts down to the budget right away.
+     *
+     * @param bytes The budget in bytes, 0 for no limit.
+     */
+    void set_budget(size_t bytes);
+
+    /*!
+     * @brief Get the memory budget of the cache.
+     *
+     * @return The budget in bytes, 0 when unlimited.
+     */
+    size_t get_budget() const;
+
+    /*!
+     * @brief Get the cache counters.
+     *
+     * Hits and misses count load() calls.
+     *
+     * @return Resident bytes, hits, misses and evictions.
+     */
+    const core::CacheStats &get_stats() const;
+
+    /*!
+     * @brief Reset hits, misses and evictions.
+     */
+    void reset_stats();
+
   private:
     FontManager() = default;
     ~FontManager() = default;
 
     //! @brief Cached fonts
-    static std::unordered_map<std::string, std::shared_ptr<Font>> s_fonts;
+    static core::ResourceCache<Font> s_fonts;
 };
 
 } // namespace ui
@@ -115,6 +115,13 @@ class Text : public UIElement {
      */
     void render(float canvas_width, float canvas_height, const glm::mat4 &projection) override;
 
+    /*!
+     * @brief Close the frame of the glyph stream shared by every text element.
+     *
+     * Called once per frame after the text has been drawn, so the next frame writes to another region.
+     */
+    static void end_frame();
+
   private:
     //! @brief Text string to render
     std::string m_text;
@@ -134,8 +141,8 @@ class Text : public UIElement {
     //! @brief Vertex array for quad rendering
     static std::shared_ptr<renderer::VertexArray> s_vao;
 
-    //! @brief Vertex buffer (dynamic)
-    static std::shared_ptr<renderer::VertexBuffer> s_vbo;
+    //! @brief Streaming vertex ring shared by every text element
+    static std::shared_ptr<renderer::StreamBuffer> s_stream;
 
     //! @brief Initialize static rendering resources
     static void initialize_resources();
@@ -0,0 +1,26 @@
+#shader vertex
+#version 410 core
+layout (location = 0) in vec3 a_Position;
+
+uniform mat4 u_LightSpaceMatrix;
+uniform mat4 u_Model;
+
+out vec3 v_FragPos;
+
+void main() {
+    vec4 worldPos = u_Model * vec4(a_Position, 1.0);
+    v_FragPos = worldPos.xyz;
+    gl_Position = u_LightSpaceMatrix * worldPos;
+}
+
+#shader fragment
+#version 410 core
+in vec3 v_FragPos;
+
+uniform vec3 u_LightPos;
+uniform float u_FarPlane;
+
+void main() {
+    // Distance to the light over its range, the same for spot lights and point light faces
+    gl_FragDepth = length(v_FragPos - u_LightPos) / u_FarPlane;
+}
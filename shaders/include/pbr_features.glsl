@@ -0,0 +1,75 @@
+// Feature checks of the PBR fragment shader.
+//
+// Specialized variants, compiled with LMGL_VARIANT, turn every check into a constant from the
+// FEATURE_* defines of their feature mask, so the compiler drops the branches they never take.
+// The generic program reads the material and scene flags at run time instead.
+
+#ifdef LMGL_VARIANT
+
+#ifdef FEATURE_ALBEDO_MAP
+#define HAS_ALBEDO_MAP true
+#else
+#define HAS_ALBEDO_MAP false
+#endif
+
+#ifdef FEATURE_NORMAL_MAP
+#define HAS_NORMAL_MAP true
+#else
+#define HAS_NORMAL_MAP false
+#endif
+
+#ifdef FEATURE_METALLIC_MAP
+#define HAS_METALLIC_MAP true
+#else
+#define HAS_METALLIC_MAP false
+#endif
+
+#ifdef FEATURE_ROUGHNESS_MAP
+#define HAS_ROUGHNESS_MAP true
+#else
+#define HAS_ROUGHNESS_MAP false
+#endif
+
+#ifdef FEATURE_AO_MAP
+#define HAS_AO_MAP true
+#else
+#define HAS_AO_MAP false
+#endif
+
+#ifdef FEATURE_EMISSIVE_MAP
+#define HAS_EMISSIVE_MAP true
+#else
+#define HAS_EMISSIVE_MAP false
+#endif
+
+#ifdef FEATURE_DIRECTIONAL_SHADOW
+#define USE_DIRECTIONAL_SHADOW true
+#else
+#define USE_DIRECTIONAL_SHADOW false
+#endif
+
+#ifdef FEATURE_POINT_SHADOW
+#define USE_POINT_SHADOW true
+#else
+#define USE_POINT_SHADOW false
+#endif
+
+#ifdef FEATURE_ENVIRONMENT_MAP
+#define USE_ENVIRONMENT_MAP true
+#else
+#define USE_ENVIRONMENT_MAP false
+#endif
+
+#else
+
+#define HAS_ALBEDO_MAP (u_Material.hasAlbedoMap == 1)
+#define HAS_NORMAL_MAP (u_Material.hasNormalMap == 1)
+#define HAS_METALLIC_MAP (u_Material.hasMetallicMap == 1)
+#define HAS_ROUGHNESS_MAP (u_Material.hasRoughnessMap == 1)
+#define HAS_AO_MAP (u_Material.hasAoMap == 1)
+#define HAS_EMISSIVE_MAP (u_Material.hasEmissiveMap == 1)
+#define USE_DIRECTIONAL_SHADOW (u_UseDirectionalShadow == 1)
+#define USE_POINT_SHADOW (u_UsePointShadow == 1)
+#define USE_ENVIRONMENT_MAP (u_UseEnvironmentMap == 1)
+
+#endif
@@ -5,35 +5,62 @@ layout(location = 0) in vec3 a_Position;
 layout(location = 1) in vec3 a_Normal;
 layout(location = 2) in vec4 a_Color;
 layout(location = 3) in vec2 a_TexCoord;
-layout(location = 4) in vec3 a_Tangent;
+// Unpacked meshes leave w at its default of 1; packed meshes store the bitangent sign there
+layout(location = 4) in vec4 a_Tangent;
 layout(location = 5) in vec3 a_Bitangent;
+// Per-draw model matrix for multi-draw indirect batches (fetched through base instance)
+layout(location = 6) in mat4 a_InstanceModel;
 
 uniform mat4 u_Model;
 uniform mat4 u_View;
 uniform mat4 u_Projection;
 uniform mat4 u_MVP;
 uniform mat3 u_NormalMatrix;
-uniform mat4 u_LightSpaceMatrix;
+uniform mat4 u_ViewProjection;
+uniform int u_UseInstanceTransform;
+// Set for meshes uploaded as PackedVertex (octahedral normal, no bitangent attribute)
+uniform int u_PackedVertex;
 
 out vec3 v_FragPos;
 out vec3 v_Normal;
 out vec4 v_Color;
 out vec2 v_TexCoord;
 out mat3 v_TBN;
-out vec4 v_FragPosLightSpace;
+
+vec3 octDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
 
 void main() {
-    vec4 worldPos = u_Model * vec4(a_Position, 1.0);
+    mat4 model = u_Model;
+    mat3 normalMatrix = u_NormalMatrix;
+    if (u_UseInstanceTransform == 1) {
+        model = a_InstanceModel;
+        normalMatrix = transpose(inverse(mat3(model)));
+    }
+    vec3 normal = a_Normal;
+    vec3 bitangent = a_Bitangent;
+    if (u_PackedVertex == 1) {
+        normal = octDecode(a_Normal.xy);
+        bitangent = cross(normal, a_Tangent.xyz) * (a_Tangent.w < 0.0 ? -1.0 : 1.0);
+    }
+    vec4 worldPos = model * vec4(a_Position, 1.0);
     v_FragPos = worldPos.xyz;
-    v_Normal = u_NormalMatrix * a_Normal;
+    v_Normal = normalMatrix * normal;
     v_Color = a_Color;
     v_TexCoord = a_TexCoord;
-    vec3 T = normalize(u_NormalMatrix * a_Tangent);
-    vec3 B = normalize(u_NormalMatrix * a_Bitangent);
+    vec3 T = normalize(normalMatrix * a_Tangent.xyz);
+    vec3 B = normalize(normalMatrix * bitangent);
     vec3 N = normalize(v_Normal);
     v_TBN = mat3(T, B, N);
-    v_FragPosLightSpace = u_LightSpaceMatrix * worldPos;
-    gl_Position = u_MVP * vec4(a_Position, 1.0);
+    if (u_UseInstanceTransform == 1)
+        gl_Position = u_ViewProjection * worldPos;
+    else
+        gl_Position = u_MVP * vec4(a_Position, 1.0);
 }
 
 #shader fragment
@@ -44,7 +71,6 @@ in vec3 v_Normal;
 in vec4 v_Color;
 in vec2 v_TexCoord;
 in mat3 v_TBN;
-in vec4 v_FragPosLightSpace;
 
 out vec4 FragColor;
 
@@ -105,16 +131,25 @@ uniform PointLight u_PointLights[16];
 uniform int u_NumSpotLights;
 uniform SpotLight u_SpotLights[8];
 
-uniform sampler2D u_ShadowMap;
-uniform samplerCube u_ShadowCubemap;
+// One layer per cascade, cascades ordered by distance from the camera
+uniform sampler2DArray u_ShadowMap;
+uniform mat4 u_LightSpaceMatrices[4];
+uniform int u_CascadeCount;
+uniform int u_ShadowDirLight;
+// Spot and point lights share one atlas; a rect is the tile origin and size in texture
+// coordinates, zero for lights without a tile, six per point light in cube face order
+uniform sampler2D u_ShadowAtlas;
+uniform vec4 u_PointShadowRects[96];
+uniform vec4 u_SpotShadowRects[8];
+uniform mat4 u_SpotShadowMatrices[8];
 uniform int u_UseDirectionalShadow;
 uniform int u_UsePointShadow;
-uniform vec3 u_ShadowLightPos;
-uniform float u_ShadowFarPlane;
 
 uniform samplerCube u_EnvironmentMap;
 uniform int u_UseEnvironmentMap;
 
+#include "include/pbr_features.glsl"
+
 const float PI = 3.14159265359;
 
 float DistributionGGX(vec3 N, vec3 H, float roughness) {
@@ -157,18 +192,27 @@ vec3 fresnelSchlickRoughness(float cosTheta, vec3 F0, float roughness) {
     return F0 + (max(vec3(1.0 - roughness), F0) - F0) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
 }
 
-float ShadowCalculation(vec4 fragPosLightSpace, vec3 normal, vec3 lightDir) {
-    if (u_UseDirectionalShadow == 0) return 0.0;
-    vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
-    projCoords = projCoords * 0.5 + 0.5;
-    float closestDepth = texture(u_ShadowMap, projCoords.xy).r;
+float ShadowCalculation(vec3 fragPos, vec3 normal, vec3 lightDir) {
+    if (!USE_DIRECTIONAL_SHADOW) return 0.0;
+    // Cascades are nested by distance, the first one covering the fragment is the sharpest
+    int cascade = -1;
+    vec3 projCoords = vec3(0.0);
+    for (int i = 0; i < u_CascadeCount; ++i) {
+        vec4 fragPosLightSpace = u_LightSpaceMatrices[i] * vec4(fragPos, 1.0);
+        projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w * 0.5 + 0.5;
+        if (all(greaterThanEqual(projCoords.xy, vec2(0.0))) && all(lessThanEqual(projCoords.xy, vec2(1.0)))) {
+            cascade = i;
+            break;
+        }
+    }
+    if (cascade < 0) return 0.0;
     float currentDepth = projCoords.z;
     float bias = max(0.002 * (1.0 - dot(normal, lightDir)), 0.0005);
     float shadow = 0.0;
-    vec2 texelSize = 1.0 / textureSize(u_ShadowMap, 0);
+    vec2 texelSize = 1.0 / vec2(textureSize(u_ShadowMap, 0).xy);
     for(int x = -1; x <= 1; ++x) {
         for(int y = -1; y <= 1; ++y) {
-            float pcfDepth = texture(u_ShadowMap, projCoords.xy + vec2(x, y) * texelSize).r;
+            float pcfDepth = texture(u_ShadowMap, vec3(projCoords.xy + vec2(x, y) * texelSize, cascade)).r;
             shadow += currentDepth - bias > pcfDepth ? 1.0 : 0.0;
         }
     }
@@ -177,59 +221,92 @@ float ShadowCalculation(vec4 fragPosLightSpace, vec3 normal, vec3 lightDir) {
     return shadow;
 }
 
-float PointShadowCalculation(vec3 fragPos) {
-    if (u_UsePointShadow == 0) return 0.0;
-    vec3 fragToLight = fragPos - u_ShadowLightPos;
-    float currentDepth = length(fragToLight);
+// Atlas tiles hold the distance to the light over its range
+float AtlasShadow(vec4 rect, vec2 uv, float currentDepth, float bias) {
+    if (rect.z <= 0.0 || any(lessThan(uv, vec2(0.0))) || any(greaterThan(uv, vec2(1.0)))) return 0.0;
+    vec2 texelSize = 1.0 / vec2(textureSize(u_ShadowAtlas, 0));
+    // The filter must not read the neighbouring tiles
+    vec2 minCoord = rect.xy + 1.5 * texelSize;
+    vec2 maxCoord = rect.xy + rect.zw - 1.5 * texelSize;
+    vec2 coord = rect.xy + uv * rect.zw;
     float shadow = 0.0;
-    float bias = 0.05;
-    int samples = 20;
-    vec3 sampleOffsetDirections[20] = vec3[](
-       vec3( 1,  1,  1), vec3( 1, -1,  1), vec3(-1, -1,  1), vec3(-1,  1,  1), 
-       vec3( 1,  1, -1), vec3( 1, -1, -1), vec3(-1, -1, -1), vec3(-1,  1, -1),
-       vec3( 1,  1,  0), vec3( 1, -1,  0), vec3(-1, -1,  0), vec3(-1,  1,  0),
-       vec3( 1,  0,  1), vec3(-1,  0,  1), vec3( 1,  0, -1), vec3(-1,  0, -1),
-       vec3( 0,  1,  1), vec3( 0, -1,  1), vec3( 0, -1, -1), vec3( 0,  1, -1)
-    );
-    float diskRadius = 0.05;
-    for(int i = 0; i < samples; ++i) {
-        float closestDepth = texture(u_ShadowCubemap, fragToLight + sampleOffsetDirections[i] * diskRadius).r;
-        closestDepth *= u_ShadowFarPlane;
-        if(currentDepth - bias > closestDepth)
-            shadow += 1.0;
+    for(int x = -1; x <= 1; ++x) {
+        for(int y = -1; y <= 1; ++y) {
+            vec2 sampleCoord = clamp(coord + vec2(x, y) * texelSize, minCoord, maxCoord);
+            float pcfDepth = texture(u_ShadowAtlas, sampleCoord).r;
+            shadow += currentDepth - bias > pcfDepth ? 1.0 : 0.0;
+        }
     }
-    shadow /= float(samples);
-    return shadow;
+    return shadow / 9.0;
+}
+
+float SpotShadowCalculation(int light, vec3 fragPos) {
+    if (!USE_POINT_SHADOW) return 0.0;
+    vec4 fragPosLightSpace = u_SpotShadowMatrices[light] * vec4(fragPos, 1.0);
+    if (fragPosLightSpace.w <= 0.0) return 0.0;
+    vec2 uv = fragPosLightSpace.xy / fragPosLightSpace.w * 0.5 + 0.5;
+    float range = u_SpotLights[light].range;
+    float currentDepth = length(fragPos - u_SpotLights[light].position) / range;
+    return AtlasShadow(u_SpotShadowRects[light], uv, currentDepth, 0.05 / range);
+}
+
+float PointShadowCalculation(int light, vec3 fragPos) {
+    if (!USE_POINT_SHADOW) return 0.0;
+    // Same face order and orientation as the atlas pass: +X, -X, +Y, -Y, +Z, -Z
+    vec3 fragToLight = fragPos - u_PointLights[light].position;
+    vec3 absDir = abs(fragToLight);
+    int face;
+    vec3 forward;
+    vec3 up;
+    if (absDir.x >= absDir.y && absDir.x >= absDir.z) {
+        face = fragToLight.x > 0.0 ? 0 : 1;
+        forward = vec3(sign(fragToLight.x), 0.0, 0.0);
+        up = vec3(0.0, -1.0, 0.0);
+    } else if (absDir.y >= absDir.z) {
+        face = fragToLight.y > 0.0 ? 2 : 3;
+        forward = vec3(0.0, sign(fragToLight.y), 0.0);
+        up = vec3(0.0, 0.0, sign(fragToLight.y));
+    } else {
+        face = fragToLight.z > 0.0 ? 4 : 5;
+        forward = vec3(0.0, 0.0, sign(fragToLight.z));
+        up = vec3(0.0, -1.0, 0.0);
+    }
+    vec3 side = normalize(cross(forward, up));
+    up = cross(side, forward);
+    vec2 uv = vec2(dot(side, fragToLight), dot(up, fragToLight)) / dot(forward, fragToLight) * 0.5 + 0.5;
+    float range = u_PointLights[light].range;
+    float currentDepth = length(fragToLight) / range;
+    return AtlasShadow(u_PointShadowRects[light * 6 + face], uv, currentDepth, 0.05 / range);
 }
 
 void main() {
     vec3 albedo = u_Material.albedo;
-    if (u_Material.hasAlbedoMap == 1) {
+    if (HAS_ALBEDO_MAP) {
         albedo = texture(u_Material.albedoMap, v_TexCoord).rgb;
     }
 
     float metallic = u_Material.metallic;
-    if (u_Material.hasMetallicMap == 1) {
+    if (HAS_METALLIC_MAP) {
         metallic = texture(u_Material.metallicMap, v_TexCoord).b;
     }
 
     float roughness = u_Material.roughness;
-    if (u_Material.hasRoughnessMap == 1) {
+    if (HAS_ROUGHNESS_MAP) {
         roughness = texture(u_Material.roughnessMap, v_TexCoord).g;
     }
 
     float ao = u_Material.ao;
-    if (u_Material.hasAoMap == 1) {
+    if (HAS_AO_MAP) {
         ao = texture(u_Material.aoMap, v_TexCoord).r;
     }
 
     vec3 emissive = u_Material.emissive;
-    if (u_Material.hasEmissiveMap == 1) {
+    if (HAS_EMISSIVE_MAP) {
         emissive = texture(u_Material.emissiveMap, v_TexCoord).rgb;
     }
 
     vec3 N;
-    if (u_Material.hasNormalMap == 1) {
+    if (HAS_NORMAL_MAP) {
         vec3 normalMap = texture(u_Material.normalMap, v_TexCoord).rgb;
         normalMap = normalMap * 2.0 - 1.0;
         N = normalize(v_TBN * normalMap);
@@ -264,8 +341,8 @@ void main() {
 
         float NdotL = max(dot(N, L), 0.0);
         float shadow = 0.0;
-        if (u_UseDirectionalShadow == 1) {
-            shadow = ShadowCalculation(v_FragPosLightSpace, N, L);
+        if (USE_DIRECTIONAL_SHADOW && i == u_ShadowDirLight) {
+            shadow = ShadowCalculation(v_FragPos, N, L);
         }
         Lo += (kD * albedo / PI + specular) * radiance * NdotL * (1.0 - shadow);
     }
@@ -291,14 +368,47 @@ void main() {
 
         float NdotL = max(dot(N, L), 0.0);
         float shadow = 0.0;
-        if (u_UsePointShadow == 1 && length(u_PointLights[i].position - u_ShadowLightPos) < 0.1) {
-            shadow = PointShadowCalculation(v_FragPos);
+        if (USE_POINT_SHADOW) {
+            shadow = PointShadowCalculation(i, v_FragPos);
+        }
+        Lo += (kD * albedo / PI + specular) * radiance * NdotL * (1.0 - shadow);
+    }
+
+    for (int i = 0; i < u_NumSpotLights; ++i) {
+        vec3 L = normalize(u_SpotLights[i].position - v_FragPos);
+        // Cutoffs are angles in radians, full intensity inside the inner cone
+        float theta = dot(L, normalize(-u_SpotLights[i].direction));
+        float innerCos = cos(u_SpotLights[i].innerCutoff);
+        float outerCos = cos(u_SpotLights[i].outerCutoff);
+        float cone = clamp((theta - outerCos) / max(innerCos - outerCos, 0.0001), 0.0, 1.0);
+        if (cone <= 0.0) continue;
+        vec3 H = normalize(V + L);
+        float distance = length(u_SpotLights[i].position - v_FragPos);
+        float attenuation = 1.0 / (distance * distance);
+        vec3 radiance = u_SpotLights[i].color * u_SpotLights[i].intensity * attenuation * cone;
+
+        float NDF = DistributionGGX(N, H, roughness);
+        float G = GeometrySmith(N, V, L, roughness);
+        vec3 F = fresnelSchlick(max(dot(H, V), 0.0), F0);
+
+        vec3 numerator = NDF * G * F;
+        float denominator = 4.0 * max(dot(N, V), 0.0) * max(dot(N, L), 0.0) + 0.0001;
+        vec3 specular = min(numerator / denominator, vec3(10.0));
+
+        vec3 kS = F;
+        vec3 kD = vec3(1.0) - kS;
+        kD *= 1.0 - metallic;
+
+        float NdotL = max(dot(N, L), 0.0);
+        float shadow = 0.0;
+        if (USE_POINT_SHADOW) {
+            shadow = SpotShadowCalculation(i, v_FragPos);
         }
         Lo += (kD * albedo / PI + specular) * radiance * NdotL * (1.0 - shadow);
     }
 
     vec3 ambient;
-    if (u_UseEnvironmentMap == 1) {
+    if (USE_ENVIRONMENT_MAP) {
         vec3 R = reflect(-V, N);
 
         vec3 F = fresnelSchlickRoughness(max(dot(N, V), 0.0), F0, roughness);
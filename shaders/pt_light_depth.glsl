@@ -14,11 +14,15 @@ layout (triangles) in;
 layout (triangle_strip, max_vertices=18) out;
 
 uniform mat4 u_ShadowMatrices[6];
+uniform int u_FaceMask;
 
 out vec4 v_FragPos;
 
 void main() {
     for(int face = 0; face < 6; ++face) {
+        // Faces the caster cannot reach, as culled on the CPU
+        if ((u_FaceMask & (1 << face)) == 0)
+            continue;
         gl_Layer = face;
         for(int i = 0; i < 3; ++i) {
             v_FragPos = gl_in[i].gl_Position;
@@ -0,0 +1,977 @@
+#include "lmgl/assets/gltf_loader.hpp"
+#include "lmgl/assets/mapped_file.hpp"
+#include "lmgl/assets/texture_library.hpp"
+#include "lmgl/renderer/buffer.hpp"
+#include "lmgl/renderer/vertex_array.hpp"
+
+#include <glad/glad.h>
+#include <glm/gtc/quaternion.hpp>
+#include <json.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+namespace lmgl {
+
+namespace assets {
+
+using json = nlohmann::json;
+
+namespace {
+
+constexpr uint32_t GLB_MAGIC = 0x46546C67; // "glTF"
+constexpr uint32_t CHUNK_JSON = 0x4E4F534A;
+constexpr uint32_t CHUNK_BIN = 0x004E4942;
+
+constexpr int COMPONENT_BYTE = 5120;
+constexpr int COMPONENT_UNSIGNED_BYTE = 5121;
+constexpr int COMPONENT_SHORT = 5122;
+constexpr int COMPONENT_UNSIGNED_SHORT = 5123;
+constexpr int COMPONENT_UNSIGNED_INT = 5125;
+constexpr int COMPONENT_FLOAT = 5126;
+
+constexpr int MODE_TRIANGLES = 4;
+
+// Attribute locations of pbr.glsl
+constexpr int LOCATION_POSITION = 0;
+constexpr int LOCATION_NORMAL = 1;
+constexpr int LOCATION_COLOR = 2;
+constexpr int LOCATION_UVS = 3;
+constexpr int LOCATION_TANGENT = 4;
+constexpr int LOCATION_BITANGENT = 5;
+
+// Range of the BIN chunk covered by a buffer view
+struct BufferView {
+    const unsigned char *data = nullptr;
+    std::size_t size = 0;
+    std::size_t stride = 0; // 0 when tightly packed
+};
+
+// Elements of an accessor, read where they lie in the file
+struct Accessor {
+    const unsigned char *data = nullptr; // First element
+    std::size_t count = 0;
+    std::size_t stride = 0;      // Distance between two elements
+    std::size_t view_offset = 0; // Offset of the first element inside its view
+    int view = -1;
+    int component_type = 0;
+    int components = 0;
+    bool normalized = false;
+};
+
+// A vertex buffer of a primitive, a whole buffer view uploaded once or converted data
+struct Stream {
+    int view = -1; // View uploaded as stored, -1 for converted data
+    std::vector<float> converted;
+    renderer::BufferElement element;
+    unsigned int stride = 0;
+};
+
+// A glTF primitive, ready to upload
+struct Primitive {
+    std::vector<Stream> streams;
+    const unsigned char *index_data = nullptr; // Indices uploaded as stored, nullptr to upload indices
+    int index_type = 0;
+    std::vector<unsigned int> indices;
+    std::size_t vertex_count = 0;
+    const glm::vec3 *positions = nullptr; // Positions as stored, nullptr to read converted_positions
+    std::size_t position_stride = 0;
+    std::vector<glm::vec3> converted_positions;
+    int material = -1;
+};
+
+struct MeshEntry {
+    std::string name;
+    std::vector<std::size_t> primitives;
+};
+
+struct NodeEntry {
+    std::string name;
+    glm::vec3 position = glm::vec3(0.0f);
+    glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+    glm::vec3 scale = glm::vec3(1.0f);
+    int mesh = -1;
+    std::vector<int> children;
+};
+
+// An upload of build(), run as one UploadQueue task by asynchronous loads
+struct UploadStep {
+    enum class Kind { View, Image, Primitive };
+    Kind kind = Kind::View;
+    std::size_t index = 0; // Index of the view, image or primitive
+    std::size_t size = 0;  // Bytes uploaded
+};
+
+// Members that may be missing, without copying them as json::value() would
+const json &get_array(const json &object, const char *key) {
+    static const json empty = json::array();
+    auto it = object.find(key);
+    return it != object.end() && it->is_array() ? *it : empty;
+}
+
+const json &get_object(const json &object, const char *key) {
+    static const json empty = json::object();
+    auto it = object.find(key);
+    return it != object.end() && it->is_object() ? *it : empty;
+}
+
+std::size_t component_size(int component_type) {
+    switch (component_type) {
+    case COMPONENT_BYTE:
+    case COMPONENT_UNSIGNED_BYTE:
+        return 1;
+    case COMPONENT_SHORT:
+    case COMPONENT_UNSIGNED_SHORT:
+        return 2;
+    case COMPONENT_UNSIGNED_INT:
+    case COMPONENT_FLOAT:
+        return 4;
+    default:
+        return 0;
+    }
+}
+
+int component_count(const std::string &type) {
+    if (type == "SCALAR")
+        return 1;
+    if (type == "VEC2")
+        return 2;
+    if (type == "VEC3")
+        return 3;
+    if (type == "VEC4")
+        return 4;
+    return 0;
+}
+
+// Value of a component, normalized integers mapped to [0, 1] or [-1, 1]
+float read_component(const unsigned char *data, int component_type, bool normalized) {
+    switch (component_type) {
+    case COMPONENT_FLOAT: {
+        float value;
+        std::memcpy(&value, data, sizeof(value));
+        return value;
+    }
+    case COMPONENT_BYTE: {
+        float value = static_cast<float>(static_cast<int8_t>(data[0]));
+        return normalized ? std::max(value / 127.0f, -1.0f) : value;
+    }
+    case COMPONENT_UNSIGNED_BYTE:
+        return normalized ? data[0] / 255.0f : static_cast<float>(data[0]);
+    case COMPONENT_SHORT: {
+        int16_t value;
+        std::memcpy(&value, data, sizeof(value));
+        return normalized ? std::max(value / 32767.0f, -1.0f) : static_cast<float>(value);
+    }
+    case COMPONENT_UNSIGNED_SHORT: {
+        uint16_t value;
+        std::memcpy(&value, data, sizeof(value));
+        return normalized ? value / 65535.0f : static_cast<float>(value);
+    }
+    case COMPONENT_UNSIGNED_INT: {
+        uint32_t value;
+        std::memcpy(&value, data, sizeof(value));
+        return static_cast<float>(value);
+    }
+    default:
+        return 0.0f;
+    }
+}
+
+// Reads an element into out, missing components left untouched
+void read_element(const Accessor &accessor, std::size_t index, float *out) {
+    const unsigned char *element = accessor.data + index * accessor.stride;
+    std::size_t size = component_size(accessor.component_type);
+    for (int c = 0; c < accessor.components; ++c)
+        out[c] = read_component(element + c * size, accessor.component_type, accessor.normalized);
+}
+
+glm::vec3 read_vec3(const Accessor &accessor, std::size_t index) {
+    float value[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    read_element(accessor, index, value);
+    return glm::vec3(value[0], value[1], value[2]);
+}
+
+// Vertex format reading the accessor as stored, None if the data has to be converted.
+// Three-component bytes and shorts are read as four when the padding glTF requires is there.
+renderer::ShaderDataType stored_type(const Accessor &accessor, std::size_t view_size, bool allow_padding) {
+    using renderer::ShaderDataType;
+    int components = accessor.components;
+    std::size_t size = component_size(accessor.component_type);
+    if (components == 3 && size < 4 && allow_padding && accessor.stride >= 4 * size &&
+        accessor.view_offset + (accessor.count - 1) * accessor.stride + 4 * size <= view_size)
+        components = 4;
+    switch (accessor.component_type) {
+    case COMPONENT_FLOAT:
+        return components == 1   ? ShaderDataType::Float
+               : components == 2 ? ShaderDataType::Float2
+               : components == 3 ? ShaderDataType::Float3
+                                 : ShaderDataType::Float4;
+    case COMPONENT_BYTE:
+        return components == 4 ? ShaderDataType::Byte4 : ShaderDataType::None;
+    case COMPONENT_UNSIGNED_BYTE:
+        return components == 4 ? ShaderDataType::UByte4 : ShaderDataType::None;
+    case COMPONENT_SHORT:
+        return components == 2 ? ShaderDataType::Short2
+               : components == 4 ? ShaderDataType::Short4
+                                 : ShaderDataType::None;
+    case COMPONENT_UNSIGNED_SHORT:
+        return components == 2 ? ShaderDataType::UShort2
+               : components == 4 ? ShaderDataType::UShort4
+                                 : ShaderDataType::None;
+    default:
+        return ShaderDataType::None;
+    }
+}
+
+renderer::ShaderDataType float_type(int components) {
+    using renderer::ShaderDataType;
+    return components == 1   ? ShaderDataType::Float
+           : components == 2 ? ShaderDataType::Float2
+           : components == 3 ? ShaderDataType::Float3
+                             : ShaderDataType::Float4;
+}
+
+// Stream of tightly packed floats
+Stream make_float_stream(std::vector<float> data, int components, const char *name, int location) {
+    Stream stream;
+    stream.converted = std::move(data);
+    stream.element = renderer::BufferElement(float_type(components), name, false, location);
+    stream.stride = static_cast<unsigned int>(components * sizeof(float));
+    return stream;
+}
+
+// Area-weighted vertex normals, for primitives without NORMAL
+std::vector<float> generate_normals(const std::vector<glm::vec3> &positions, const std::vector<unsigned int> &indices) {
+    std::vector<glm::vec3> normals(positions.size(), glm::vec3(0.0f));
+    for (std::size_t i = 0; i + 2 < indices.size(); i += 3) {
+        const glm::vec3 &a = positions[indices[i]];
+        glm::vec3 face = glm::cross(positions[indices[i + 1]] - a, positions[indices[i + 2]] - a);
+        for (std::size_t k = 0; k < 3; ++k)
+            normals[indices[i + k]] += face;
+    }
+    std::vector<float> data;
+    data.reserve(normals.size() * 3);
+    for (const glm::vec3 &normal : normals) {
+        float length = glm::length(normal);
+        glm::vec3 n = length > 0.0f ? normal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+        data.insert(data.end(), {n.x, n.y, n.z});
+    }
+    return data;
+}
+
+// Tangents from the UV gradients of the triangles, with the bitangent sign in w
+std::vector<float> generate_tangents(const std::vector<glm::vec3> &positions, const std::vector<glm::vec3> &normals,
+                                     const Accessor &uvs, const std::vector<unsigned int> &indices) {
+    std::vector<glm::vec3> tangents(positions.size(), glm::vec3(0.0f));
+    std::vector<glm::vec3> bitangents(positions.size(), glm::vec3(0.0f));
+    for (std::size_t i = 0; i + 2 < indices.size(); i += 3) {
+        unsigned int v[3] = {indices[i], indices[i + 1], indices[i + 2]};
+        glm::vec3 e1 = positions[v[1]] - positions[v[0]];
+        glm::vec3 e2 = positions[v[2]] - positions[v[0]];
+        glm::vec3 uv0 = read_vec3(uvs, v[0]);
+        glm::vec3 d1 = read_vec3(uvs, v[1]) - uv0;
+        glm::vec3 d2 = read_vec3(uvs, v[2]) - uv0;
+        float det = d1.x * d2.y - d2.x * d1.y;
+        if (std::abs(det) < 1e-12f)
+            continue;
+        float r = 1.0f / det;
+        glm::vec3 t = (e1 * d2.y - e2 * d1.y) * r;
+        glm::vec3 b = (e2 * d1.x - e1 * d2.x) * r;
+        for (unsigned int k : v) {
+            tangents[k] += t;
+            bitangents[k] += b;
+        }
+    }
+    std::vector<float> data;
+    data.reserve(positions.size() * 4);
+    for (std::size_t i = 0; i < positions.size(); ++i) {
+        const glm::vec3 &n = normals[i];
+        // Gram-Schmidt against the normal
+        glm::vec3 t = tangents[i] - n * glm::dot(n, tangents[i]);
+        float length = glm::length(t);
+        t = length > 0.0f ? t / length : glm::vec3(1.0f, 0.0f, 0.0f);
+        float sign = glm::dot(glm::cross(n, t), bitangents[i]) < 0.0f ? -1.0f : 1.0f;
+        data.insert(data.end(), {t.x, t.y, t.z, sign});
+    }
+    return data;
+}
+
+std::vector<glm::vec3> read_positions(const Accessor &accessor) {
+    std::vector<glm::vec3> positions(accessor.count);
+    for (std::size_t i = 0; i < accessor.count; ++i)
+        positions[i] = read_vec3(accessor, i);
+    return positions;
+}
+
+std::string get_directory(const std::string &fpath) {
+    std::size_t last_slash = fpath.find_last_of("/\\");
+    return last_slash == std::string::npos ? "." : fpath.substr(0, last_slash);
+}
+
+} // namespace
+
+struct GLTFLoader::Model {
+    std::string path;                        //!< File path of the model
+    MappedFile file;                         //!< The mapped GLB file, read in place
+    std::vector<BufferView> views;           //!< Buffer views of the BIN chunk
+    std::vector<Primitive> primitives;       //!< Every primitive of every mesh
+    std::vector<MeshEntry> meshes;           //!< glTF meshes, as ranges of primitives
+    std::vector<NodeEntry> nodes;            //!< glTF nodes
+    std::vector<int> roots;                  //!< Nodes of the scene
+    std::vector<MaterialData> materials;     //!< Materials, maps named by texture key
+    std::vector<std::string> image_keys;     //!< TextureLibrary key of every image
+    std::vector<renderer::ImageData> images; //!< Decoded images, indexed like image_keys, freed once uploaded
+    std::vector<bool> image_files;           //!< Whether each image was read from its own file
+    std::vector<UploadStep> steps;           //!< Uploads of build(), in order
+    std::size_t upload_size = 0;             //!< Bytes build() uploads
+
+    std::vector<std::shared_ptr<renderer::VertexBuffer>> view_buffers; //!< Uploaded views, indexed like views
+    std::vector<std::shared_ptr<renderer::Texture>> textures;          //!< Uploaded images, indexed like images
+    std::vector<std::shared_ptr<scene::Material>> built_materials;     //!< Built materials, indexed like materials
+    std::vector<std::shared_ptr<scene::Mesh>> built_meshes;            //!< Built meshes, indexed like primitives
+};
+
+namespace {
+
+// Parses and bounds-checks an accessor
+bool read_accessor(const json &document, const std::vector<BufferView> &views, int index, Accessor &accessor) {
+    const json &accessors = get_array(document, "accessors");
+    if (index < 0 || index >= static_cast<int>(accessors.size()))
+        return false;
+    const json &a = accessors[index];
+    if (a.contains("sparse") || !a.contains("bufferView"))
+        return false;
+    accessor.view = a["bufferView"].get<int>();
+    if (accessor.view < 0 || accessor.view >= static_cast<int>(views.size()))
+        return false;
+    const BufferView &view = views[accessor.view];
+    accessor.count = a.value("count", 0u);
+    accessor.component_type = a.value("componentType", 0);
+    accessor.components = component_count(a.value("type", std::string()));
+    accessor.normalized = a.value("normalized", false);
+    accessor.view_offset = a.value("byteOffset", static_cast<std::size_t>(0));
+    std::size_t element_size = component_size(accessor.component_type) * accessor.components;
+    accessor.stride = view.stride ? view.stride : element_size;
+    if (element_size == 0 || accessor.count == 0 ||
+        accessor.view_offset + (accessor.count - 1) * accessor.stride + element_size > view.size)
+        return false;
+    accessor.data = view.data + accessor.view_offset;
+    return true;
+}
+
+// Reads the indices of a primitive, or numbers the vertices when it has none
+bool read_indices(const json &document, const json &primitive, const std::vector<BufferView> &views,
+                  Primitive &result) {
+    if (!primitive.contains("indices")) {
+        result.indices.resize(result.vertex_count);
+        for (std::size_t i = 0; i < result.vertex_count; ++i)
+            result.indices[i] = static_cast<unsigned int>(i);
+        return true;
+    }
+    Accessor accessor;
+    if (!read_accessor(document, views, primitive["indices"].get<int>(), accessor) || accessor.components != 1)
+        return false;
+    std::size_t size = component_size(accessor.component_type);
+    if (accessor.component_type != COMPONENT_UNSIGNED_BYTE && accessor.component_type != COMPONENT_UNSIGNED_SHORT &&
+        accessor.component_type != COMPONENT_UNSIGNED_INT)
+        return false;
+    result.indices.resize(accessor.count);
+    for (std::size_t i = 0; i < accessor.count; ++i) {
+        uint32_t index = 0;
+        std::memcpy(&index, accessor.data + i * accessor.stride, size);
+        if (index >= result.vertex_count)
+            return false;
+        result.indices[i] = index;
+    }
+    // GL has no 8-bit index buffers worth using, and strided indices do not exist in glTF
+    if (accessor.component_type != COMPONENT_UNSIGNED_BYTE && accessor.stride == size) {
+        result.index_data = accessor.data;
+        result.index_type = accessor.component_type == COMPONENT_UNSIGNED_SHORT ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    }
+    return true;
+}
+
+// Adds an attribute as stored, or converted to floats when no vertex format reads it
+void add_stream(const Accessor &accessor, const std::vector<BufferView> &views, const char *name, int location,
+                bool allow_padding, std::vector<Stream> &streams) {
+    renderer::ShaderDataType type = stored_type(accessor, views[accessor.view].size, allow_padding);
+    if (type != renderer::ShaderDataType::None) {
+        Stream stream;
+        stream.view = accessor.view;
+        stream.element = renderer::BufferElement(type, name, accessor.normalized, location);
+        stream.element.offset = accessor.view_offset;
+        stream.stride = static_cast<unsigned int>(accessor.stride);
+        streams.push_back(std::move(stream));
+        return;
+    }
+    std::vector<float> data(accessor.count * accessor.components);
+    for (std::size_t i = 0; i < accessor.count; ++i)
+        read_element(accessor, i, &data[i * accessor.components]);
+    streams.push_back(make_float_stream(std::move(data), accessor.components, name, location));
+}
+
+bool read_primitive(const json &document, const json &primitive, const std::vector<BufferView> &views,
+                    const std::vector<MaterialData> &materials, const ModelLoadOptions &options, Primitive &result) {
+    if (primitive.value("mode", MODE_TRIANGLES) != MODE_TRIANGLES)
+        return false;
+    const json &attributes = get_object(primitive, "attributes");
+    Accessor position;
+    if (!attributes.contains("POSITION") ||
+        !read_accessor(document, views, attributes["POSITION"].get<int>(), position) || position.components != 3)
+        return false;
+    result.vertex_count = position.count;
+    if (!read_indices(document, primitive, views, result))
+        return false;
+    result.material = primitive.value("material", -1);
+    if (result.material >= static_cast<int>(materials.size()))
+        return false;
+    add_stream(position, views, "a_Position", LOCATION_POSITION, true, result.streams);
+    if (position.component_type == COMPONENT_FLOAT) {
+        result.positions = reinterpret_cast<const glm::vec3 *>(position.data);
+        result.position_stride = position.stride;
+    } else {
+        result.converted_positions = read_positions(position);
+    }
+
+    // Optional attributes must cover every vertex
+    auto find = [&](const char *name, int components, Accessor &accessor) {
+        return attributes.contains(name) && read_accessor(document, views, attributes[name].get<int>(), accessor) &&
+               accessor.count == position.count && (components == 0 || accessor.components == components);
+    };
+    Accessor normal, uvs, tangent, color;
+    bool has_normal = find("NORMAL", 3, normal);
+    bool has_uvs = find("TEXCOORD_0", 2, uvs);
+    bool has_tangent = find("TANGENT", 4, tangent);
+    if (find("COLOR_0", 0, color) && color.components >= 3)
+        add_stream(color, views, "a_Color", LOCATION_COLOR, false, result.streams);
+    if (has_uvs)
+        add_stream(uvs, views, "a_TexCoord", LOCATION_UVS, false, result.streams);
+    if (has_normal)
+        add_stream(normal, views, "a_Normal", LOCATION_NORMAL, true, result.streams);
+
+    // Normal mapping needs tangents and, since pbr.glsl reads it for unpacked meshes, the bitangent
+    bool normal_mapped = result.material >= 0 && !materials[result.material].normal_map.empty();
+    bool need_tangents = normal_mapped && (has_tangent || (options.compute_tangents && has_uvs));
+    if (!has_normal && !need_tangents) {
+        std::vector<glm::vec3> positions =
+            result.converted_positions.empty() ? read_positions(position) : result.converted_positions;
+        result.streams.push_back(
+            make_float_stream(generate_normals(positions, result.indices), 3, "a_Normal", LOCATION_NORMAL));
+    }
+    if (!need_tangents)
+        return true;
+    std::vector<glm::vec3> positions =
+        result.converted_positions.empty() ? read_positions(position) : result.converted_positions;
+    std::vector<glm::vec3> normals(position.count);
+    if (has_normal) {
+        for (std::size_t i = 0; i < position.count; ++i)
+            normals[i] = glm::normalize(read_vec3(normal, i));
+    } else {
+        std::vector<float> generated = generate_normals(positions, result.indices);
+        for (std::size_t i = 0; i < position.count; ++i)
+            normals[i] = glm::vec3(generated[i * 3], generated[i * 3 + 1], generated[i * 3 + 2]);
+        result.streams.push_back(make_float_stream(std::move(generated), 3, "a_Normal", LOCATION_NORMAL));
+    }
+    std::vector<float> tangents;
+    if (has_tangent) {
+        add_stream(tangent, views, "a_Tangent", LOCATION_TANGENT, false, result.streams);
+        tangents.resize(position.count * 4);
+        for (std::size_t i = 0; i < position.count; ++i)
+            read_element(tangent, i, &tangents[i * 4]);
+    } else {
+        tangents = generate_tangents(positions, normals, uvs, result.indices);
+    }
+    std::vector<float> bitangents(position.count * 3);
+    for (std::size_t i = 0; i < position.count; ++i) {
+        glm::vec3 t(tangents[i * 4], tangents[i * 4 + 1], tangents[i * 4 + 2]);
+        glm::vec3 b = glm::cross(normals[i], t) * (tangents[i * 4 + 3] < 0.0f ? -1.0f : 1.0f);
+        bitangents[i * 3] = b.x;
+        bitangents[i * 3 + 1] = b.y;
+        bitangents[i * 3 + 2] = b.z;
+    }
+    if (!has_tangent)
+        result.streams.push_back(make_float_stream(std::move(tangents), 4, "a_Tangent", LOCATION_TANGENT));
+    result.streams.push_back(make_float_stream(std::move(bitangents), 3, "a_Bitangent", LOCATION_BITANGENT));
+    return true;
+}
+
+// Texture key of a material texture slot, empty if unset
+std::string read_texture(const json &slot, const json &document, const std::vector<std::string> &image_keys) {
+    if (!slot.is_object() || !slot.contains("index"))
+        return std::string();
+    const json &textures = get_array(document, "textures");
+    int texture = slot["index"].get<int>();
+    if (texture < 0 || texture >= static_cast<int>(textures.size()))
+        return std::string();
+    int image = textures[texture].value("source", -1);
+    if (image < 0 || image >= static_cast<int>(image_keys.size()))
+        return std::string();
+    return image_keys[image];
+}
+
+MaterialData read_material(const json &material, const json &document, const std::vector<std::string> &image_keys) {
+    MaterialData data;
+    data.name = material.value("name", std::string());
+    const json &pbr = get_object(material, "pbrMetallicRoughness");
+    if (pbr.contains("baseColorFactor")) {
+        const json &factor = pbr["baseColorFactor"];
+        data.albedo = glm::vec3(factor[0].get<float>(), factor[1].get<float>(), factor[2].get<float>());
+    } else {
+        data.albedo = glm::vec3(1.0f);
+    }
+    data.metallic = pbr.value("metallicFactor", 1.0f);
+    data.roughness = pbr.value("roughnessFactor", 1.0f);
+    if (material.contains("emissiveFactor")) {
+        const json &factor = material["emissiveFactor"];
+        data.emissive = glm::vec3(factor[0].get<float>(), factor[1].get<float>(), factor[2].get<float>());
+    }
+    data.albedo_map = read_texture(get_object(pbr, "baseColorTexture"), document, image_keys);
+    // Metalness in blue and roughness in green of the same texture
+    data.metallic_map = read_texture(get_object(pbr, "metallicRoughnessTexture"), document, image_keys);
+    data.roughness_map = data.metallic_map;
+    data.normal_map = read_texture(get_object(material, "normalTexture"), document, image_keys);
+    data.ao_map = read_texture(get_object(material, "occlusionTexture"), document, image_keys);
+    data.emissive_map = read_texture(get_object(material, "emissiveTexture"), document, image_keys);
+    return data;
+}
+
+NodeEntry read_node(const json &node) {
+    NodeEntry entry;
+    entry.name = node.value("name", std::string("Node"));
+    entry.mesh = node.value("mesh", -1);
+    entry.children = node.value("children", std::vector<int>());
+    if (node.contains("matrix")) {
+        std::vector<float> values = node["matrix"].get<std::vector<float>>();
+        if (values.size() == 16) {
+            // Column-major, without shear as the specification requires
+            glm::vec3 columns[3];
+            for (int c = 0; c < 3; ++c)
+                columns[c] = glm::vec3(values[c * 4], values[c * 4 + 1], values[c * 4 + 2]);
+            entry.position = glm::vec3(values[12], values[13], values[14]);
+            entry.scale = glm::vec3(glm::length(columns[0]), glm::length(columns[1]), glm::length(columns[2]));
+            if (entry.scale.x > 0.0f && entry.scale.y > 0.0f && entry.scale.z > 0.0f)
+                entry.rotation = glm::quat_cast(
+                    glm::mat3(columns[0] / entry.scale.x, columns[1] / entry.scale.y, columns[2] / entry.scale.z));
+        }
+        return entry;
+    }
+    if (node.contains("translation")) {
+        std::vector<float> t = node["translation"].get<std::vector<float>>();
+        if (t.size() == 3)
+            entry.position = glm::vec3(t[0], t[1], t[2]);
+    }
+    if (node.contains("rotation")) {
+        // glTF stores x, y, z, w
+        std::vector<float> r = node["rotation"].get<std::vector<float>>();
+        if (r.size() == 4)
+            entry.rotation = glm::quat(r[3], r[0], r[1], r[2]);
+    }
+    if (node.contains("scale")) {
+        std::vector<float> s = node["scale"].get<std::vector<float>>();
+        if (s.size() == 3)
+            entry.scale = glm::vec3(s[0], s[1], s[2]);
+    }
+    return entry;
+}
+
+// Checks that nodes form a forest reachable from the roots, which rules out cycles
+bool validate_hierarchy(const std::vector<NodeEntry> &nodes, const std::vector<int> &roots, std::size_t mesh_count) {
+    std::vector<int> parents(nodes.size(), 0);
+    for (const NodeEntry &node : nodes) {
+        if (node.mesh >= static_cast<int>(mesh_count))
+            return false;
+        for (int child : node.children) {
+            if (child < 0 || child >= static_cast<int>(nodes.size()) || ++parents[child] > 1)
+                return false;
+        }
+    }
+    for (int root : roots) {
+        if (root < 0 || root >= static_cast<int>(nodes.size()) || parents[root] != 0)
+            return false;
+    }
+    return true;
+}
+
+// Meshes referenced by a node or its descendants
+void mark_used_meshes(const std::vector<NodeEntry> &nodes, int index, std::vector<bool> &used) {
+    const NodeEntry &node = nodes[index];
+    if (node.mesh >= 0)
+        used[node.mesh] = true;
+    for (int child : node.children)
+        mark_used_meshes(nodes, child, used);
+}
+
+std::shared_ptr<scene::Material> build_material(const MaterialData &data, const GLTFLoader::Model &model) {
+    auto material = std::make_shared<scene::Material>(data.name);
+    material->set_albedo(data.albedo);
+    material->set_metallic(data.metallic);
+    material->set_roughness(data.roughness);
+    material->set_emissive(data.emissive);
+    // Image steps have uploaded every map, and hold them so that the library cannot evict them meanwhile
+    auto load_map = [&](const std::string &key) -> std::shared_ptr<renderer::Texture> {
+        if (key.empty())
+            return nullptr;
+        auto image = std::find(model.image_keys.begin(), model.image_keys.end(), key) - model.image_keys.begin();
+        return image < static_cast<std::ptrdiff_t>(model.textures.size()) ? model.textures[image] : nullptr;
+    };
+    material->set_albedo_map(load_map(data.albedo_map));
+    material->set_normal_map(load_map(data.normal_map));
+    material->set_metallic_map(load_map(data.metallic_map));
+    material->set_roughness_map(load_map(data.roughness_map));
+    material->set_ao_map(load_map(data.ao_map));
+    material->set_emissive_map(load_map(data.emissive_map));
+    return material;
+}
+
+} // namespace
+
+bool GLTFLoader::is_glb(const std::string &fpath) {
+    if (fpath.size() < 4)
+        return false;
+    std::string extension = fpath.substr(fpath.size() - 4);
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return extension == ".glb";
+}
+
+std::shared_ptr<scene::Node> GLTFLoader::load(const std::string &fpath, std::shared_ptr<renderer::Shader> shader,
+                                              const ModelLoadOptions &options) {
+    auto model = parse(fpath, options);
+    if (!model)
+        return nullptr;
+    return build(*model, shader, options);
+}
+
+std::shared_ptr<GLTFLoader::Model> GLTFLoader::parse(const std::string &fpath, const ModelLoadOptions &options) {
+    if (options.pack_vertices || options.geometry_pool || !options.flip_uvs)
+        return nullptr;
+    auto model = std::make_shared<Model>();
+    model->path = fpath;
+    if (!model->file.open(fpath)) {
+        std::cerr << "ERROR: GLTFLoader: could not open " << fpath << std::endl;
+        return nullptr;
+    }
+    const unsigned char *data = model->file.data();
+    std::size_t size = model->file.size();
+    auto read_u32 = [data](std::size_t offset) {
+        uint32_t value;
+        std::memcpy(&value, data + offset, sizeof(value));
+        return value;
+    };
+    if (size < 20 || read_u32(0) != GLB_MAGIC || read_u32(4) != 2 || read_u32(8) > size) {
+        std::cerr << "Warning: GLTFLoader: " << fpath << " is not a glTF 2.0 binary file" << std::endl;
+        return nullptr;
+    }
+    size = read_u32(8);
+    std::size_t json_size = read_u32(12);
+    if (read_u32(16) != CHUNK_JSON || 20 + json_size > size) {
+        std::cerr << "Warning: GLTFLoader: " << fpath << " has no JSON chunk" << std::endl;
+        return nullptr;
+    }
+    const unsigned char *bin = nullptr;
+    std::size_t bin_size = 0;
+    std::size_t bin_header = 20 + ((json_size + 3) & ~static_cast<std::size_t>(3));
+    if (bin_header + 8 <= size && read_u32(bin_header + 4) == CHUNK_BIN) {
+        bin = data + bin_header + 8;
+        bin_size = std::min<std::size_t>(read_u32(bin_header), size - bin_header - 8);
+    }
+
+    json document;
+    try {
+        document = json::parse(data + 20, data + 20 + json_size);
+        for (const json &extension : get_array(document, "extensionsRequired")) {
+            if (extension.get<std::string>() != "KHR_mesh_quantization") {
+                std::cout << "GLTFLoader: " << fpath << " requires " << extension.get<std::string>() << std::endl;
+                return nullptr;
+            }
+        }
+        // Only the BIN chunk is read, external and data URI buffers go through Assimp
+        const json &buffers = get_array(document, "buffers");
+        if (buffers.size() > 1 || (buffers.size() == 1 && (buffers[0].contains("uri") || !bin)))
+            return nullptr;
+        for (const json &view : get_array(document, "bufferViews")) {
+            BufferView entry;
+            std::size_t offset = view.value("byteOffset", static_cast<std::size_t>(0));
+            entry.size = view.value("byteLength", static_cast<std::size_t>(0));
+            entry.stride = view.value("byteStride", static_cast<std::size_t>(0));
+            if (view.value("buffer", 0) != 0 || offset + entry.size > bin_size)
+                throw std::runtime_error("buffer view out of range");
+            entry.data = bin + offset;
+            model->views.push_back(entry);
+        }
+
+        std::string dir = get_directory(fpath);
+        const json &images = get_array(document, "images");
+        for (std::size_t i = 0; i < images.size(); ++i) {
+            const json &image = images[i];
+            renderer::ImageData decoded;
+            if (image.contains("bufferView")) {
+                model->image_keys.push_back(fpath + "#image" + std::to_string(i));
+                model->image_files.push_back(false);
+                int view = image["bufferView"].get<int>();
+                if (view >= 0 && view < static_cast<int>(model->views.size()))
+                    renderer::Texture::decode_memory(model->views[view].data, model->views[view].size, decoded);
+            } else {
+                std::string uri = image.value("uri", std::string());
+                if (uri.compare(0, 5, "data:") == 0) {
+                    std::cerr << "Warning: GLTFLoader: data URI images are not supported" << std::endl;
+                    model->image_keys.push_back(std::string());
+                    model->image_files.push_back(false);
+                    model->images.push_back(decoded);
+                    continue;
+                }
+                model->image_keys.push_back(dir + "/" + uri);
+                model->image_files.push_back(true);
+                renderer::Texture::decode(model->image_keys.back(), decoded);
+            }
+            model->images.push_back(decoded);
+        }
+        for (const json &material : get_array(document, "materials"))
+            model->materials.push_back(read_material(material, document, model->image_keys));
+
+        const json &meshes = get_array(document, "meshes");
+        for (const json &mesh : meshes) {
+            MeshEntry entry;
+            entry.name = mesh.value("name", std::string("Mesh"));
+            for (const json &primitive : get_array(mesh, "primitives")) {
+                Primitive result;
+                if (!read_primitive(document, primitive, model->views, model->materials, options, result)) {
+                    std::cout << "GLTFLoader: unsupported primitive in " << entry.name << std::endl;
+                    return nullptr;
+                }
+                entry.primitives.push_back(model->primitives.size());
+                model->primitives.push_back(std::move(result));
+            }
+            model->meshes.push_back(std::move(entry));
+        }
+
+        for (const json &node : get_array(document, "nodes"))
+            model->nodes.push_back(read_node(node));
+        const json &scenes = get_array(document, "scenes");
+        int scene = document.value("scene", 0);
+        if (scene >= 0 && scene < static_cast<int>(scenes.size())) {
+            model->roots = scenes[scene].value("nodes", std::vector<int>());
+        } else {
+            // Without scenes, every node that is nobody's child is a root
+            std::vector<bool> is_child(model->nodes.size(), false);
+            for (const NodeEntry &node : model->nodes) {
+                for (int child : node.children) {
+                    if (child >= 0 && child < static_cast<int>(is_child.size()))
+                        is_child[child] = true;
+                }
+            }
+            for (std::size_t i = 0; i < model->nodes.size(); ++i) {
+                if (!is_child[i])
+                    model->roots.push_back(static_cast<int>(i));
+            }
+        }
+        if (!validate_hierarchy(model->nodes, model->roots, model->meshes.size()))
+            throw std::runtime_error("invalid node hierarchy");
+    } catch (const std::exception &e) {
+        std::cerr << "Warning: GLTFLoader: could not read " << fpath << ": " << e.what() << std::endl;
+        return nullptr;
+    }
+
+    // Only what the scene graph reaches is uploaded: the meshes of its nodes and the maps of their materials
+    std::vector<bool> used_meshes(model->meshes.size(), false);
+    for (int root : model->roots)
+        mark_used_meshes(model->nodes, root, used_meshes);
+    std::vector<std::size_t> used_primitives;
+    std::vector<bool> used_materials(model->materials.size(), false);
+    for (std::size_t i = 0; i < model->meshes.size(); ++i) {
+        if (!used_meshes[i])
+            continue;
+        for (std::size_t primitive : model->meshes[i].primitives) {
+            used_primitives.push_back(primitive);
+            if (model->primitives[primitive].material >= 0)
+                used_materials[model->primitives[primitive].material] = true;
+        }
+    }
+    std::vector<bool> used_images(model->images.size(), false);
+    for (std::size_t i = 0; i < model->materials.size(); ++i) {
+        if (!used_materials[i])
+            continue;
+        const MaterialData &material = model->materials[i];
+        for (const std::string *map : {&material.albedo_map, &material.normal_map, &material.metallic_map,
+                                       &material.roughness_map, &material.ao_map, &material.emissive_map}) {
+            auto image = std::find(model->image_keys.begin(), model->image_keys.end(), *map);
+            if (!map->empty() && image != model->image_keys.end())
+                used_images[image - model->image_keys.begin()] = true;
+        }
+    }
+
+    // Views read in place are uploaded once, however many primitives use them
+    std::vector<bool> used_views(model->views.size(), false);
+    for (std::size_t primitive : used_primitives) {
+        for (const Stream &stream : model->primitives[primitive].streams) {
+            if (stream.view >= 0 && !used_views[stream.view]) {
+                used_views[stream.view] = true;
+                model->steps.push_back({UploadStep::Kind::View, static_cast<std::size_t>(stream.view),
+                                        model->views[stream.view].size});
+            }
+        }
+    }
+    for (std::size_t i = 0; i < model->images.size(); ++i) {
+        if (used_images[i])
+            model->steps.push_back({UploadStep::Kind::Image, i, model->images[i].size()});
+    }
+    for (std::size_t primitive : used_primitives) {
+        const Primitive &entry = model->primitives[primitive];
+        std::size_t size = entry.indices.size() *
+                           (entry.index_data ? component_size(entry.index_type) : sizeof(unsigned int));
+        for (const Stream &stream : entry.streams)
+            size += stream.converted.size() * sizeof(float);
+        model->steps.push_back({UploadStep::Kind::Primitive, primitive, size});
+    }
+    for (const UploadStep &step : model->steps)
+        model->upload_size += step.size;
+    model->view_buffers.resize(model->views.size());
+    model->textures.resize(model->images.size());
+    model->built_materials.resize(model->materials.size());
+    model->built_meshes.resize(model->primitives.size());
+    std::cout << "GLTFLoader: Loading model from " << fpath << std::endl;
+    std::cout << "  Meshes: " << model->meshes.size() << ", primitives: " << model->primitives.size() << std::endl;
+    std::cout << "  Materials: " << model->materials.size() << std::endl;
+    std::cout << "  Images: " << model->images.size() << std::endl;
+    return model;
+}
+
+std::size_t GLTFLoader::get_step_count(const Model &model) { return model.steps.size(); }
+
+std::size_t GLTFLoader::get_upload_size(const Model &model, std::size_t step) { return model.steps[step].size; }
+
+void GLTFLoader::build_step(Model &model, std::size_t step, std::shared_ptr<renderer::Shader> shader,
+                            const ModelLoadOptions &options) {
+    const UploadStep &entry = model.steps[step];
+    if (entry.kind == UploadStep::Kind::View) {
+        const BufferView &view = model.views[entry.index];
+        model.view_buffers[entry.index] =
+            std::make_shared<renderer::VertexBuffer>(view.data, static_cast<unsigned int>(view.size));
+        return;
+    }
+    if (entry.kind == UploadStep::Kind::Image) {
+        auto &tex_lib = TextureLibrary::get_instance();
+        const std::string &key = model.image_keys[entry.index];
+        std::shared_ptr<renderer::Texture> texture = tex_lib.get(key);
+        if (!texture && model.images[entry.index].is_valid())
+            texture = tex_lib.insert(key, tex_lib.create(key, model.images[entry.index],
+                                                         model.image_files[entry.index]));
+        model.textures[entry.index] = texture;
+        model.images[entry.index] = renderer::ImageData();
+        return;
+    }
+
+    Primitive &primitive = model.primitives[entry.index];
+    auto vertex_array = std::make_shared<renderer::VertexArray>();
+    for (Stream &stream : primitive.streams) {
+        std::shared_ptr<renderer::VertexBuffer> buffer;
+        if (stream.view >= 0) {
+            buffer = model.view_buffers[stream.view];
+        } else {
+            buffer = std::make_shared<renderer::VertexBuffer>(
+                stream.converted.data(), static_cast<unsigned int>(stream.converted.size() * sizeof(float)));
+            stream.converted = std::vector<float>();
+        }
+        vertex_array->add_vertex_buffer(buffer, renderer::BufferLayout({stream.element}, stream.stride));
+    }
+    unsigned int index_count = static_cast<unsigned int>(primitive.indices.size());
+    std::shared_ptr<renderer::IndexBuffer> index_buffer;
+    if (primitive.index_type == GL_UNSIGNED_SHORT)
+        index_buffer = std::make_shared<renderer::IndexBuffer>(
+            reinterpret_cast<const uint16_t *>(primitive.index_data), index_count);
+    else if (primitive.index_type == GL_UNSIGNED_INT)
+        index_buffer = std::make_shared<renderer::IndexBuffer>(
+            reinterpret_cast<const unsigned int *>(primitive.index_data), index_count);
+    else
+        index_buffer = std::make_shared<renderer::IndexBuffer>(primitive.indices.data(), index_count);
+    vertex_array->set_index_buffer(index_buffer);
+
+    const glm::vec3 *positions = primitive.positions;
+    std::size_t stride = primitive.position_stride;
+    if (!positions) {
+        positions = primitive.converted_positions.data();
+        stride = sizeof(glm::vec3);
+    }
+    auto mesh = scene::Mesh::create_from_vertex_array(vertex_array, std::move(primitive.indices), positions,
+                                                      primitive.vertex_count, stride, shader);
+    if (options.depth_stream) {
+        std::vector<glm::vec3> depth_positions(primitive.vertex_count);
+        const unsigned char *position = reinterpret_cast<const unsigned char *>(positions);
+        for (std::size_t i = 0; i < primitive.vertex_count; ++i, position += stride)
+            std::memcpy(&depth_positions[i], position, sizeof(glm::vec3));
+        mesh->create_depth_stream(depth_positions);
+    }
+    // Nothing can rebuild the BVH once the indices are gone
+    if (options.residency == scene::GeometryResidency::Release)
+        mesh->build_bvh(positions, primitive.vertex_count, stride);
+    mesh->set_residency(options.residency);
+    if (primitive.material >= 0) {
+        auto &material = model.built_materials[primitive.material];
+        if (!material)
+            material = build_material(model.materials[primitive.material], model);
+        mesh->set_material(material);
+    }
+    model.built_meshes[entry.index] = mesh;
+}
+
+std::shared_ptr<scene::Node> GLTFLoader::assemble(Model &model, const ModelLoadOptions &options) {
+    std::function<std::shared_ptr<scene::Node>(int)> build_node = [&](int index) {
+        const NodeEntry &entry = model.nodes[index];
+        auto node = std::make_shared<scene::Node>(entry.name);
+        node->set_position(entry.position);
+        node->set_rotation(entry.rotation);
+        node->set_scale(entry.scale);
+        if (entry.mesh >= 0) {
+            // Meshes referenced by several nodes are built once and shared
+            const MeshEntry &mesh = model.meshes[entry.mesh];
+            for (std::size_t i = 0; i < mesh.primitives.size(); ++i) {
+                const auto &built = model.built_meshes[mesh.primitives[i]];
+                if (mesh.primitives.size() == 1) {
+                    node->set_mesh(built);
+                } else {
+                    auto mesh_node = std::make_shared<scene::Node>(mesh.name + "_mesh_" + std::to_string(i));
+                    mesh_node->set_mesh(built);
+                    node->add_child(mesh_node);
+                }
+            }
+        }
+        for (int child : entry.children)
+            node->add_child(build_node(child));
+        return node;
+    };
+
+    std::size_t name_start = model.path.find_last_of("/\\");
+    auto root = std::make_shared<scene::Node>(
+        name_start == std::string::npos ? model.path : model.path.substr(name_start + 1));
+    for (int index : model.roots)
+        root->add_child(build_node(index));
+    if (options.scale != 1.0f)
+        root->set_scale(glm::vec3(options.scale));
+    // The last reference to the model may be dropped by a worker, keep every GL object out of it
+    model.view_buffers.clear();
+    model.textures.clear();
+    model.built_materials.clear();
+    model.built_meshes.clear();
+    std::cout << "GLTFLoader: Finished loading model " << model.path << std::endl;
+    return root;
+}
+
+std::shared_ptr<scene::Node> GLTFLoader::build(Model &model, std::shared_ptr<renderer::Shader> shader,
+                                               const ModelLoadOptions &options) {
+    for (std::size_t i = 0; i < model.steps.size(); ++i)
+        build_step(model, i, shader, options);
+    return assemble(model, options);
+}
+
+std::size_t GLTFLoader::get_upload_size(const Model &model) { return model.upload_size; }
+
+} // namespace assets
+
+} // namespace lmgl
@@ -0,0 +1,72 @@
+#include "lmgl/assets/mapped_file.hpp"
+
+#ifdef _WIN32
+#include <fstream>
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace lmgl {
+
+namespace assets {
+
+MappedFile::MappedFile(const std::string &fpath) { open(fpath); }
+
+MappedFile::~MappedFile() { close(); }
+
+bool MappedFile::open(const std::string &fpath) {
+    close();
+#ifndef _WIN32
+    int fd = ::open(fpath.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        ::close(fd);
+        return false;
+    }
+    m_size = static_cast<std::size_t>(info.st_size);
+    if (m_size > 0) {
+        void *address = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address == MAP_FAILED) {
+            ::close(fd);
+            m_size = 0;
+            return false;
+        }
+        m_data = static_cast<const unsigned char *>(address);
+        m_mapped = true;
+    }
+    // The mapping stays valid once the descriptor is closed
+    ::close(fd);
+#else
+    std::ifstream file(fpath, std::ios::binary);
+    if (!file)
+        return false;
+    m_buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    m_size = m_buffer.size();
+    m_data = m_buffer.empty() ? nullptr : m_buffer.data();
+#endif
+    m_open = true;
+    return true;
+}
+
+void MappedFile::close() {
+#ifndef _WIN32
+    if (m_mapped)
+        munmap(const_cast<unsigned char *>(m_data), m_size);
+#endif
+    m_buffer.clear();
+    m_buffer.shrink_to_fit();
+    m_data = nullptr;
+    m_size = 0;
+    m_open = false;
+    m_mapped = false;
+}
+
+} // namespace assets
+
+} // namespace lmgl
@@ -0,0 +1,334 @@
+#include "lmgl/assets/model_cache.hpp"
+#include "lmgl/assets/mapped_file.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <utility>
+
+namespace lmgl {
+
+namespace assets {
+
+namespace {
+
+constexpr char MAGIC[4] = {'L', 'M', 'D', 'L'};
+
+// Alignment of the vertex and index arrays from the start of the file
+constexpr std::size_t ARRAY_ALIGNMENT = 16;
+
+// Fixed-size file header, followed by the payload it describes
+struct Header {
+    char magic[4];
+    uint32_t version;
+    uint32_t vertex_size;
+    uint32_t reserved;
+    uint64_t source_time;
+    uint64_t source_size;
+    uint64_t options_hash;
+    uint64_t payload_size;
+    uint64_t checksum;
+};
+
+// Appends values to a growing byte buffer
+class Writer {
+  public:
+    void bytes(const void *data, std::size_t size) {
+        const char *begin = static_cast<const char *>(data);
+        m_data.insert(m_data.end(), begin, begin + size);
+    }
+
+    template <typename T> void value(const T &v) { bytes(&v, sizeof(T)); }
+
+    void string(const std::string &s) {
+        value(static_cast<uint32_t>(s.size()));
+        bytes(s.data(), s.size());
+    }
+
+    // Zero padding up to an aligned file offset, the payload starting after the header
+    void align(std::size_t alignment) {
+        while ((sizeof(Header) + m_data.size()) % alignment != 0)
+            m_data.push_back(0);
+    }
+
+    std::vector<char> &data() { return m_data; }
+
+  private:
+    std::vector<char> m_data;
+};
+
+// Reads values from a byte range, failing instead of reading past its end
+class Reader {
+  public:
+    Reader(const unsigned char *file, const unsigned char *data, std::size_t size)
+        : m_file(file), m_cursor(data), m_end(data + size) {}
+
+    bool bytes(void *out, std::size_t size) {
+        if (!m_ok || static_cast<std::size_t>(m_end - m_cursor) < size)
+            return m_ok = false;
+        std::memcpy(out, m_cursor, size);
+        m_cursor += size;
+        return true;
+    }
+
+    template <typename T> bool value(T &v) { return bytes(&v, sizeof(T)); }
+
+    bool string(std::string &s) {
+        uint32_t size = 0;
+        if (!value(size) || static_cast<std::size_t>(m_end - m_cursor) < size)
+            return m_ok = false;
+        s.assign(reinterpret_cast<const char *>(m_cursor), size);
+        m_cursor += size;
+        return true;
+    }
+
+    // Skips the padding written by Writer::align()
+    bool align(std::size_t alignment) {
+        std::size_t padding = (alignment - static_cast<std::size_t>(m_cursor - m_file) % alignment) % alignment;
+        if (!m_ok || static_cast<std::size_t>(m_end - m_cursor) < padding)
+            return m_ok = false;
+        m_cursor += padding;
+        return true;
+    }
+
+    // Array of n elements left in place, the cursor moves past it
+    template <typename T> const T *span(std::size_t n) {
+        if (!m_ok || static_cast<std::size_t>(m_end - m_cursor) / sizeof(T) < n) {
+            m_ok = false;
+            return nullptr;
+        }
+        const T *first = reinterpret_cast<const T *>(m_cursor);
+        m_cursor += n * sizeof(T);
+        return first;
+    }
+
+    // Element count of an array that must fit in the remaining bytes
+    bool count(uint32_t &n, std::size_t element_size) {
+        if (!value(n) || static_cast<std::size_t>(m_end - m_cursor) / element_size < n)
+            return m_ok = false;
+        return true;
+    }
+
+    bool ok() const { return m_ok; }
+    bool at_end() const { return m_cursor == m_end; }
+
+  private:
+    const unsigned char *m_file;
+    const unsigned char *m_cursor;
+    const unsigned char *m_end;
+    bool m_ok = true;
+};
+
+void write_material(Writer &writer, const MaterialData &material) {
+    writer.string(material.name);
+    writer.value(material.albedo);
+    writer.value(material.metallic);
+    writer.value(material.roughness);
+    writer.value(material.emissive);
+    for (const std::string *map : {&material.albedo_map, &material.normal_map, &material.metallic_map,
+                                   &material.roughness_map, &material.ao_map, &material.emissive_map})
+        writer.string(*map);
+}
+
+bool read_material(Reader &reader, MaterialData &material) {
+    reader.string(material.name);
+    reader.value(material.albedo);
+    reader.value(material.metallic);
+    reader.value(material.roughness);
+    reader.value(material.emissive);
+    for (std::string *map : {&material.albedo_map, &material.normal_map, &material.metallic_map,
+                             &material.roughness_map, &material.ao_map, &material.emissive_map})
+        reader.string(*map);
+    return reader.ok();
+}
+
+void write_node(Writer &writer, const NodeData &node) {
+    writer.string(node.name);
+    writer.value(static_cast<uint32_t>(node.meshes.size()));
+    writer.bytes(node.meshes.data(), node.meshes.size() * sizeof(unsigned int));
+    writer.value(static_cast<uint32_t>(node.children.size()));
+    for (const auto &child : node.children)
+        write_node(writer, child);
+}
+
+bool read_node(Reader &reader, NodeData &node, std::size_t mesh_count) {
+    uint32_t count = 0;
+    if (!reader.string(node.name) || !reader.count(count, sizeof(unsigned int)))
+        return false;
+    node.meshes.resize(count);
+    reader.bytes(node.meshes.data(), count * sizeof(unsigned int));
+    for (unsigned int mesh : node.meshes) {
+        if (mesh >= mesh_count)
+            return false;
+    }
+    // Every child takes at least its name length and two counts
+    if (!reader.count(count, 3 * sizeof(uint32_t)))
+        return false;
+    node.children.resize(count);
+    for (auto &child : node.children) {
+        if (!read_node(reader, child, mesh_count))
+            return false;
+    }
+    return reader.ok();
+}
+
+} // namespace
+
+uint64_t ModelCache::hash(const void *data, std::size_t size, uint64_t seed) {
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    uint64_t h = seed;
+    for (std::size_t i = 0; i < size; ++i) {
+        h ^= bytes[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+std::string ModelCache::get_cache_path(const std::string &source_path, const std::string &cache_directory) {
+    std::error_code error;
+    std::filesystem::path absolute = std::filesystem::absolute(source_path, error);
+    std::string key = error ? source_path : absolute.lexically_normal().string();
+    std::ostringstream name;
+    name << std::filesystem::path(source_path).stem().string() << '-' << std::hex << std::setw(16)
+         << std::setfill('0') << hash(key.data(), key.size()) << ".lmodel";
+    return (std::filesystem::path(cache_directory) / name.str()).string();
+}
+
+bool ModelCache::make_key(const std::string &source_path, uint64_t options_hash, ModelCacheKey &key) {
+    std::error_code error;
+    auto time = std::filesystem::last_write_time(source_path, error);
+    if (error)
+        return false;
+    auto size = std::filesystem::file_size(source_path, error);
+    if (error)
+        return false;
+    key.source_time = static_cast<uint64_t>(time.time_since_epoch().count());
+    key.source_size = static_cast<uint64_t>(size);
+    key.options_hash = options_hash;
+    return true;
+}
+
+bool ModelCache::write(const std::string &cache_path, const ModelCacheKey &key, const ModelData &model) {
+    Writer writer;
+    writer.value(static_cast<uint32_t>(model.meshes.size()));
+    for (const auto &mesh : model.meshes) {
+        writer.string(mesh.name);
+        writer.value(static_cast<uint32_t>(mesh.get_vertex_count()));
+        writer.align(ARRAY_ALIGNMENT);
+        writer.bytes(mesh.get_vertices(), mesh.get_vertex_count() * sizeof(scene::Vertex));
+        writer.value(static_cast<uint32_t>(mesh.get_index_count()));
+        writer.align(ARRAY_ALIGNMENT);
+        writer.bytes(mesh.get_indices(), mesh.get_index_count() * sizeof(unsigned int));
+        writer.value(static_cast<uint8_t>(mesh.has_material));
+        if (mesh.has_material) {
+            writer.value(mesh.material_index);
+            write_material(writer, mesh.material);
+        }
+    }
+    write_node(writer, model.root);
+
+    const std::vector<char> &payload = writer.data();
+    Header header = {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.vertex_size = sizeof(scene::Vertex);
+    header.source_time = key.source_time;
+    header.source_size = key.source_size;
+    header.options_hash = key.options_hash;
+    header.payload_size = payload.size();
+    header.checksum = hash(payload.data(), payload.size());
+
+    std::error_code error;
+    std::filesystem::path path(cache_path);
+    if (path.has_parent_path())
+        std::filesystem::create_directories(path.parent_path(), error);
+    std::string temporary = cache_path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            std::cerr << "Warning: ModelCache: cannot write " << temporary << std::endl;
+            return false;
+        }
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+        if (!file) {
+            std::cerr << "Warning: ModelCache: failed writing " << temporary << std::endl;
+            file.close();
+            std::remove(temporary.c_str());
+            return false;
+        }
+    }
+    std::filesystem::rename(temporary, cache_path, error);
+    if (error) {
+        std::cerr << "Warning: ModelCache: cannot replace " << cache_path << ": " << error.message() << std::endl;
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool ModelCache::read(const std::string &cache_path, const ModelCacheKey &key, ModelData &model) {
+    auto mapping = std::make_shared<MappedFile>();
+    if (!mapping->open(cache_path))
+        return false;
+    const MappedFile &file = *mapping;
+    Header header;
+    if (file.size() < sizeof(Header)) {
+        std::cerr << "Warning: ModelCache: " << cache_path << " is truncated" << std::endl;
+        return false;
+    }
+    std::memcpy(&header, file.data(), sizeof(Header));
+    // A stale cache is expected after the source or the options changed, stay quiet
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION ||
+        header.vertex_size != sizeof(scene::Vertex) || header.source_time != key.source_time ||
+        header.source_size != key.source_size || header.options_hash != key.options_hash)
+        return false;
+    const unsigned char *payload = file.data() + sizeof(Header);
+    if (header.payload_size != file.size() - sizeof(Header) ||
+        hash(payload, header.payload_size) != header.checksum) {
+        std::cerr << "Warning: ModelCache: " << cache_path << " is corrupted" << std::endl;
+        return false;
+    }
+
+    ModelData result;
+    Reader reader(file.data(), payload, header.payload_size);
+    uint32_t mesh_count = 0;
+    reader.count(mesh_count, 3 * sizeof(uint32_t));
+    result.meshes.resize(mesh_count);
+    for (auto &mesh : result.meshes) {
+        uint32_t count = 0;
+        reader.string(mesh.name);
+        // The geometry stays in the mapping, the model keeps it open until the meshes are uploaded
+        if (!reader.value(count) || !reader.align(ARRAY_ALIGNMENT))
+            break;
+        mesh.mapped_vertices = reader.span<scene::Vertex>(count);
+        mesh.mapped_vertex_count = count;
+        if (!reader.value(count) || !reader.align(ARRAY_ALIGNMENT))
+            break;
+        mesh.mapped_indices = reader.span<unsigned int>(count);
+        mesh.mapped_index_count = count;
+        uint8_t has_material = 0;
+        reader.value(has_material);
+        mesh.has_material = has_material != 0;
+        if (mesh.has_material) {
+            reader.value(mesh.material_index);
+            if (!read_material(reader, mesh.material))
+                break;
+        }
+    }
+    if (!reader.ok() || !read_node(reader, result.root, result.meshes.size()) || !reader.at_end()) {
+        std::cerr << "Warning: ModelCache: " << cache_path << " is malformed" << std::endl;
+        return false;
+    }
+    result.mapping = std::move(mapping);
+    model = std::move(result);
+    return true;
+}
+
+} // namespace assets
+
+} // namespace lmgl
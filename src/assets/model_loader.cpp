@@ -1,21 +1,342 @@
 #include "lmgl/assets/model_loader.hpp"
+#include "lmgl/assets/gltf_loader.hpp"
+#include "lmgl/assets/scan_loader.hpp"
 #include "lmgl/assets/texture_library.hpp"
+#include "lmgl/assets/upload_queue.hpp"
+#include "lmgl/core/thread_pool.hpp"
+#include "lmgl/scene/mesh_optimizer.hpp"
 
 #include <assimp/Importer.hpp>
 #include <assimp/postprocess.h>
 #include <assimp/scene.h>
 
+#include <algorithm>
+#include <exception>
 #include <filesystem>
 #include <iostream>
 #include <memory>
+#include <set>
+#include <utility>
 
 namespace lmgl {
 
 namespace assets {
 
+struct ModelLoader::AsyncLoad {
+    std::string path;                                 //!< File path of the model
+    std::shared_ptr<renderer::Shader> shader;         //!< Shader of the built meshes
+    ModelLoadOptions options;                         //!< Copy of the load options
+    std::shared_ptr<ModelLoadHandle> handle;          //!< Handle reporting to the caller
+    std::unique_ptr<Assimp::Importer> importer;       //!< Importer owning ai_scene while meshes are processed
+    const aiScene *ai_scene = nullptr;                //!< Scene being processed, nullptr on a cache hit
+    ModelData model;                                  //!< Processed model
+    ModelCacheKey key;                                //!< Key of the source file
+    std::string cache_path;                           //!< Cache file to write, empty when not caching
+    std::vector<std::string> texture_paths;           //!< Distinct textures referenced by the materials
+    std::vector<renderer::ImageData> images;          //!< Decoded textures, indexed like texture_paths
+    std::vector<std::shared_ptr<scene::Mesh>> meshes; //!< Built meshes, indexed like model.meshes
+    MaterialMap materials;                            //!< Built materials, by index in the source
+    TextureMap textures;                              //!< Uploaded textures, held until the nodes are built
+    std::atomic<unsigned int> remaining{0};           //!< Tasks left in the current fan-out
+};
+
+namespace {
+
+// Meshes referenced by a node or its descendants
+void mark_used_meshes(const NodeData &node, std::vector<bool> &used) {
+    for (unsigned int mesh : node.meshes)
+        used[mesh] = true;
+    for (const auto &child : node.children)
+        mark_used_meshes(child, used);
+}
+
+} // namespace
+
+core::ResourceCache<scene::Node> ModelLoader::s_prefabs;
+
+float ModelLoadHandle::get_progress() const {
+    if (get_state() != State::Loading)
+        return 1.0f;
+    unsigned int total = m_total.load(std::memory_order_relaxed);
+    if (total == 0)
+        return 0.0f;
+    unsigned int completed = m_completed.load(std::memory_order_relaxed);
+    return static_cast<float>(std::min(completed, total)) / static_cast<float>(total);
+}
+
 std::shared_ptr<scene::Node> ModelLoader::load(const std::string &fpath, std::shared_ptr<renderer::Shader> shader,
                                                const ModelLoadOptions &options) {
-    Assimp::Importer importer;
+    if (GLTFLoader::is_glb(fpath)) {
+        if (auto root_node = GLTFLoader::load(fpath, shader, options))
+            return root_node;
+        std::cout << "ModelLoader: Loading " << fpath << " through Assimp" << std::endl;
+    }
+    if (ScanLoader::handles(fpath, options)) {
+        if (auto root_node = ScanLoader::load(fpath, shader, options))
+            return root_node;
+        std::cout << "ModelLoader: Loading " << fpath << " through Assimp" << std::endl;
+    }
+    ModelData model;
+    ModelCacheKey key;
+    std::string cache_path;
+    bool cached = false;
+    if (options.use_cache && ModelCache::make_key(fpath, get_options_hash(options), key)) {
+        cache_path = ModelCache::get_cache_path(fpath, options.cache_directory);
+        cached = ModelCache::read(cache_path, key, model);
+    }
+    if (cached) {
+        std::cout << "ModelLoader: Loading model from cache " << cache_path << std::endl;
+    } else {
+        if (!import(fpath, options, model))
+            return nullptr;
+        if (!cache_path.empty() && ModelCache::write(cache_path, key, model))
+            std::cout << "  Cached as " << cache_path << std::endl;
+    }
+    std::vector<std::shared_ptr<scene::Mesh>> meshes(model.meshes.size());
+    MaterialMap materials;
+    auto root_node = build_node(model.root, model, meshes, materials, shader, options);
+    if (options.scale != 1.0f) {
+        root_node->set_scale(glm::vec3(options.scale));
+    }
+    std::cout << "ModelLoader: Finished loading model." << std::endl;
+    return root_node;
+}
+
+std::shared_ptr<scene::Node> ModelLoader::instantiate(const std::string &fpath,
+                                                      std::shared_ptr<renderer::Shader> shader,
+                                                      const ModelLoadOptions &options) {
+    const std::string key = get_prefab_key(fpath, shader, options);
+    auto prefab = s_prefabs.find(key);
+    if (!prefab) {
+        prefab = load(fpath, shader, options);
+        if (!prefab)
+            return nullptr;
+        s_prefabs.insert(key, prefab);
+    }
+    return prefab->clone();
+}
+
+void ModelLoader::clear_prefabs() { s_prefabs.clear(); }
+
+const core::CacheStats &ModelLoader::get_prefab_stats() { return s_prefabs.get_stats(); }
+
+std::string ModelLoader::get_prefab_key(const std::string &fpath, const std::shared_ptr<renderer::Shader> &shader,
+                                        const ModelLoadOptions &options) {
+    std::string key = fpath;
+    key += '|' + std::to_string(reinterpret_cast<uintptr_t>(shader.get()));
+    key += '|' + std::to_string(get_options_hash(options));
+    key += '|' + std::to_string(options.scale);
+    key += '|' + std::to_string(options.pack_vertices) + std::to_string(options.depth_stream);
+    key += '|' + std::to_string(static_cast<int>(options.residency));
+    key += '|' + std::to_string(reinterpret_cast<uintptr_t>(options.geometry_pool.get()));
+    key += '|' + std::to_string(options.scan_threshold) + ',' + std::to_string(options.scan_part_triangles);
+    return key;
+}
+
+void ModelLoader::spawn(const std::shared_ptr<AsyncLoad> &load, std::function<void()> step) {
+    load->handle->m_total.fetch_add(1, std::memory_order_relaxed);
+    core::ThreadPool::get_instance().submit([load, step]() {
+        try {
+            step();
+        } catch (const std::exception &e) {
+            std::cerr << "ERROR: ModelLoader: loading " << load->path << " failed: " << e.what() << std::endl;
+            load->handle->m_state.store(ModelLoadHandle::State::Failed, std::memory_order_release);
+        }
+        load->handle->m_completed.fetch_add(1, std::memory_order_relaxed);
+    });
+}
+
+void ModelLoader::upload(const std::shared_ptr<AsyncLoad> &load, std::function<void()> step, std::size_t bytes) {
+    load->handle->m_total.fetch_add(1, std::memory_order_relaxed);
+    UploadQueue::get_instance().push(
+        [load, step]() {
+            if (load->handle->get_state() != ModelLoadHandle::State::Failed) {
+                try {
+                    step();
+                } catch (const std::exception &e) {
+                    std::cerr << "ERROR: ModelLoader: uploading " << load->path << " failed: " << e.what()
+                              << std::endl;
+                    load->handle->m_state.store(ModelLoadHandle::State::Failed, std::memory_order_release);
+                }
+            }
+            load->handle->m_completed.fetch_add(1, std::memory_order_relaxed);
+        },
+        bytes);
+}
+
+std::shared_ptr<ModelLoadHandle> ModelLoader::load_async(const std::string &fpath,
+                                                         std::shared_ptr<renderer::Shader> shader,
+                                                         const ModelLoadOptions &options) {
+    auto load = std::make_shared<AsyncLoad>();
+    load->path = fpath;
+    load->shader = shader;
+    load->options = options;
+    load->handle = std::make_shared<ModelLoadHandle>(fpath);
+    spawn(load, [load]() { start_async(load); });
+    return load->handle;
+}
+
+void ModelLoader::start_async(const std::shared_ptr<AsyncLoad> &load) {
+    const ModelLoadOptions &options = load->options;
+    if (GLTFLoader::is_glb(load->path)) {
+        if (auto model = GLTFLoader::parse(load->path, options)) {
+            // One upload per buffer view, image and primitive, the last task assembles the scene graph
+            for (std::size_t i = 0; i < GLTFLoader::get_step_count(*model); ++i) {
+                upload(
+                    load, [load, model, i]() { GLTFLoader::build_step(*model, i, load->shader, load->options); },
+                    GLTFLoader::get_upload_size(*model, i));
+            }
+            upload(load, [load, model]() {
+                load->handle->m_node = GLTFLoader::assemble(*model, load->options);
+                load->handle->m_state.store(ModelLoadHandle::State::Ready, std::memory_order_release);
+            });
+            return;
+        }
+        std::cout << "ModelLoader: Loading " << load->path << " through Assimp" << std::endl;
+    }
+    if (ScanLoader::handles(load->path, options)) {
+        if (auto model = ScanLoader::parse(load->path, options)) {
+            // One upload per part, the last task assembles the scene graph
+            for (std::size_t i = 0; i < ScanLoader::get_part_count(*model); ++i) {
+                upload(
+                    load, [load, model, i]() { ScanLoader::build_part(*model, i, load->shader, load->options); },
+                    ScanLoader::get_upload_size(*model, i));
+            }
+            upload(load, [load, model]() {
+                load->handle->m_node = ScanLoader::assemble(*model, load->options);
+                load->handle->m_state.store(ModelLoadHandle::State::Ready, std::memory_order_release);
+            });
+            return;
+        }
+        std::cout << "ModelLoader: Loading " << load->path << " through Assimp" << std::endl;
+    }
+    if (options.use_cache && ModelCache::make_key(load->path, get_options_hash(options), load->key)) {
+        load->cache_path = ModelCache::get_cache_path(load->path, options.cache_directory);
+        if (ModelCache::read(load->cache_path, load->key, load->model)) {
+            std::cout << "ModelLoader: Loading model from cache " << load->cache_path << std::endl;
+            load->cache_path.clear();
+            decode_textures(load);
+            return;
+        }
+    }
+    load->importer = std::make_unique<Assimp::Importer>();
+    load->ai_scene = read_scene(*load->importer, load->path, options);
+    if (!load->ai_scene) {
+        load->handle->m_state.store(ModelLoadHandle::State::Failed, std::memory_order_release);
+        return;
+    }
+    const aiScene *ai_scene = load->ai_scene;
+    process_node(ai_scene->mRootNode, load->model.root);
+    load->model.meshes.resize(ai_scene->mNumMeshes);
+    if (ai_scene->mNumMeshes == 0) {
+        decode_textures(load);
+        return;
+    }
+    // One task per mesh, the last one to finish moves on to the textures
+    std::string dir = get_directory(load->path);
+    load->remaining.store(ai_scene->mNumMeshes);
+    for (unsigned int i = 0; i < ai_scene->mNumMeshes; ++i) {
+        spawn(load, [load, dir, i]() {
+            load->model.meshes[i] = process_mesh(load->ai_scene->mMeshes[i], load->ai_scene, dir, load->options);
+            if (load->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                decode_textures(load);
+        });
+    }
+}
+
+void ModelLoader::decode_textures(const std::shared_ptr<AsyncLoad> &load) {
+    if (load->handle->get_state() == ModelLoadHandle::State::Failed)
+        return;
+    if (load->importer) {
+        load->importer.reset();
+        load->ai_scene = nullptr;
+        if (!load->cache_path.empty() && ModelCache::write(load->cache_path, load->key, load->model))
+            std::cout << "  Cached as " << load->cache_path << std::endl;
+    }
+    std::set<std::string> paths;
+    for (const auto &mesh : load->model.meshes) {
+        if (!mesh.has_material)
+            continue;
+        const MaterialData &material = mesh.material;
+        for (const std::string *map : {&material.albedo_map, &material.normal_map, &material.metallic_map,
+                                       &material.roughness_map, &material.ao_map, &material.emissive_map}) {
+            if (!map->empty())
+                paths.insert(*map);
+        }
+    }
+    load->texture_paths.assign(paths.begin(), paths.end());
+    load->images.resize(load->texture_paths.size());
+    if (load->texture_paths.empty()) {
+        queue_uploads(load);
+        return;
+    }
+    load->remaining.store(static_cast<unsigned int>(load->texture_paths.size()));
+    for (size_t i = 0; i < load->texture_paths.size(); ++i) {
+        spawn(load, [load, i]() {
+            renderer::Texture::decode(load->texture_paths[i], load->images[i]);
+            if (load->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                queue_uploads(load);
+        });
+    }
+}
+
+void ModelLoader::queue_uploads(const std::shared_ptr<AsyncLoad> &load) {
+    if (load->handle->get_state() == ModelLoadHandle::State::Failed)
+        return;
+    // Textures first, held by the load so that the library evicting them cannot force a reload while building
+    for (size_t i = 0; i < load->texture_paths.size(); ++i) {
+        upload(
+            load,
+            [load, i]() {
+                auto &tex_lib = TextureLibrary::get_instance();
+                const std::string &path = load->texture_paths[i];
+                std::shared_ptr<renderer::Texture> texture = tex_lib.get(path);
+                if (!texture)
+                    texture = tex_lib.insert(path, tex_lib.create(path, load->images[i]));
+                load->textures[path] = texture;
+                load->images[i] = renderer::ImageData();
+            },
+            load->images[i].size());
+    }
+    std::vector<bool> used(load->model.meshes.size(), false);
+    mark_used_meshes(load->model.root, used);
+    load->meshes.resize(load->model.meshes.size());
+    for (size_t i = 0; i < load->model.meshes.size(); ++i) {
+        if (!used[i])
+            continue;
+        const MeshData &mesh = load->model.meshes[i];
+        upload(
+            load,
+            [load, i]() {
+                load->meshes[i] = build_mesh(load->model.meshes[i], load->materials, load->shader, load->options,
+                                             &load->textures);
+            },
+            mesh.get_vertex_count() * sizeof(scene::Vertex) + mesh.get_index_count() * sizeof(unsigned int));
+    }
+    upload(load, [load]() {
+        auto root_node = build_node(load->model.root, load->model, load->meshes, load->materials, load->shader,
+                                    load->options, &load->textures);
+        if (load->options.scale != 1.0f)
+            root_node->set_scale(glm::vec3(load->options.scale));
+        // The last reference to the load may be dropped by a worker, keep every GL object out of it
+        load->meshes.clear();
+        load->materials.clear();
+        load->textures.clear();
+        load->model = ModelData();
+        load->handle->m_node = root_node;
+        load->handle->m_state.store(ModelLoadHandle::State::Ready, std::memory_order_release);
+        std::cout << "ModelLoader: Finished loading model " << load->path << std::endl;
+    });
+}
+
+uint64_t ModelLoader::get_options_hash(const ModelLoadOptions &options) {
+    const uint8_t flags[] = {options.flip_uvs, options.compute_tangents, options.optimize_meshes, options.triangulate,
+                             options.optimize_vertex_order};
+    return ModelCache::hash(flags, sizeof(flags));
+}
+
+const aiScene *ModelLoader::read_scene(Assimp::Importer &importer, const std::string &fpath,
+                                       const ModelLoadOptions &options) {
     unsigned int flags = 0;
     if (options.triangulate)
         flags |= aiProcess_Triangulate;
@@ -35,48 +356,69 @@ std::shared_ptr<scene::Node> ModelLoader::load(const std::string &fpath, std::sh
         std::cerr << importer.GetErrorString() << std::endl;
         return nullptr;
     }
-    std::string dir = get_directory(fpath);
     std::cout << "ModelLoader: Loading model from " << fpath << std::endl;
     std::cout << "  Meshes: " << ai_scene->mNumMeshes << std::endl;
     std::cout << "  Materials: " << ai_scene->mNumMaterials << std::endl;
     std::cout << "  Textures: " << ai_scene->mNumTextures << std::endl;
-    auto root_node = process_node(ai_scene->mRootNode, ai_scene, dir, shader);
-    if (options.scale != 1.0f) {
-        root_node->set_scale(glm::vec3(options.scale));
-    }
-    std::cout << "ModelLoader: Finished loading model." << std::endl;
-    return root_node;
+    return ai_scene;
 }
 
-std::shared_ptr<scene::Node> ModelLoader::process_node(aiNode *ai_node, const aiScene *ai_scene, const std::string &dir,
-                                                       std::shared_ptr<renderer::Shader> shader) {
-    auto node = std::make_shared<scene::Node>(ai_node->mName.C_Str());
-    for (unsigned int i = 0; i < ai_node->mNumMeshes; ++i) {
-        aiMesh *ai_mesh = ai_scene->mMeshes[ai_node->mMeshes[i]];
-        auto mesh = process_mesh(ai_mesh, ai_scene, dir, shader);
-        if (mesh) {
-            if (ai_node->mNumMeshes == 1) {
-                node->set_mesh(mesh);
-            } else {
-                auto mesh_node =
-                    std::make_shared<scene::Node>(std::string(ai_mesh->mName.C_Str()) + "_mesh_" + std::to_string(i));
-                mesh_node->set_mesh(mesh);
-                node->add_child(mesh_node);
-            }
+bool ModelLoader::import(const std::string &fpath, const ModelLoadOptions &options, ModelData &model) {
+    Assimp::Importer importer;
+    const aiScene *ai_scene = read_scene(importer, fpath, options);
+    if (!ai_scene)
+        return false;
+    std::string dir = get_directory(fpath);
+    model.meshes.clear();
+    model.meshes.reserve(ai_scene->mNumMeshes);
+    for (unsigned int i = 0; i < ai_scene->mNumMeshes; ++i)
+        model.meshes.push_back(process_mesh(ai_scene->mMeshes[i], ai_scene, dir, options));
+    model.root = NodeData();
+    process_node(ai_scene->mRootNode, model.root);
+    return true;
+}
+
+void ModelLoader::process_node(aiNode *ai_node, NodeData &node) {
+    node.name = ai_node->mName.C_Str();
+    node.meshes.assign(ai_node->mMeshes, ai_node->mMeshes + ai_node->mNumMeshes);
+    node.children.resize(ai_node->mNumChildren);
+    for (unsigned int i = 0; i < ai_node->mNumChildren; ++i)
+        process_node(ai_node->mChildren[i], node.children[i]);
+}
+
+std::shared_ptr<scene::Node> ModelLoader::build_node(const NodeData &node_data, ModelData &model,
+                                                     std::vector<std::shared_ptr<scene::Mesh>> &meshes,
+                                                     MaterialMap &materials, std::shared_ptr<renderer::Shader> shader,
+                                                     const ModelLoadOptions &options, const TextureMap *textures) {
+    auto node = std::make_shared<scene::Node>(node_data.name);
+    for (size_t i = 0; i < node_data.meshes.size(); ++i) {
+        unsigned int index = node_data.meshes[i];
+        // Meshes referenced by several nodes are built once and shared
+        if (!meshes[index])
+            meshes[index] = build_mesh(model.meshes[index], materials, shader, options, textures);
+        auto mesh = meshes[index];
+        if (node_data.meshes.size() == 1) {
+            node->set_mesh(mesh);
+        } else {
+            auto mesh_node = std::make_shared<scene::Node>(model.meshes[index].name + "_mesh_" + std::to_string(i));
+            mesh_node->set_mesh(mesh);
+            node->add_child(mesh_node);
         }
     }
-    for (unsigned int i = 0; i < ai_node->mNumChildren; ++i) {
-        auto child_node = process_node(ai_node->mChildren[i], ai_scene, dir, shader);
-        if (child_node)
-            node->add_child(child_node);
-    }
+    for (const auto &child : node_data.children)
+        node->add_child(build_node(child, model, meshes, materials, shader, options, textures));
     return node;
 }
 
-std::shared_ptr<scene::Mesh> ModelLoader::process_mesh(aiMesh *ai_mesh, const aiScene *ai_scene, const std::string &dir,
-                                                       std::shared_ptr<renderer::Shader> shader) {
-    std::vector<scene::Vertex> vertices;
-    std::vector<unsigned int> indices;
+MeshData ModelLoader::process_mesh(aiMesh *ai_mesh, const aiScene *ai_scene, const std::string &dir,
+                                   const ModelLoadOptions &options) {
+    MeshData data;
+    data.name = ai_mesh->mName.C_Str();
+    std::vector<scene::Vertex> &vertices = data.vertices;
+    std::vector<unsigned int> &indices = data.indices;
+    vertices.reserve(ai_mesh->mNumVertices);
+    // Exact for triangulated meshes, the common case
+    indices.reserve(static_cast<size_t>(ai_mesh->mNumFaces) * 3);
     for (unsigned int i = 0; i < ai_mesh->mNumVertices; ++i) {
         scene::Vertex vertex;
         // position
@@ -107,88 +449,142 @@ std::shared_ptr<scene::Mesh> ModelLoader::process_mesh(aiMesh *ai_mesh, const ai
         }
         vertices.push_back(vertex);
     }
+    bool triangles_only = true;
     for (unsigned int i = 0; i < ai_mesh->mNumFaces; ++i) {
-        aiFace face = ai_mesh->mFaces[i];
+        const aiFace &face = ai_mesh->mFaces[i];
+        triangles_only = triangles_only && face.mNumIndices == 3;
         for (unsigned int j = 0; j < face.mNumIndices; ++j) {
             indices.push_back(face.mIndices[j]);
         }
     }
-    // Create mesh
-    auto mesh = std::make_shared<scene::Mesh>(vertices, indices, shader);
-
-    // Load and attach material
-    if (ai_mesh->mMaterialIndex >= 0) {
+    if (options.optimize_vertex_order && triangles_only) {
+        auto report = scene::MeshOptimizer::optimize(vertices, indices);
+        std::cout << "  Mesh " << ai_mesh->mName.C_Str() << ": ACMR " << report.before.acmr << " -> "
+                  << report.after.acmr << ", ATVR " << report.before.atvr << " -> " << report.after.atvr
+                  << std::endl;
+    }
+    // Material
+    if (ai_mesh->mMaterialIndex < ai_scene->mNumMaterials) {
         aiMaterial *ai_material = ai_scene->mMaterials[ai_mesh->mMaterialIndex];
-        auto material = std::make_shared<scene::Material>(ai_material->GetName().C_Str());
+        MaterialData &material = data.material;
+        data.has_material = true;
+        data.material_index = ai_mesh->mMaterialIndex;
+        material.name = ai_material->GetName().C_Str();
         // Load PBR properties
         aiColor3D color;
         float value;
         // Albedo/Diffuse
         if (ai_material->Get(AI_MATKEY_COLOR_DIFFUSE, color) == AI_SUCCESS) {
-            material->set_albedo(glm::vec3(color.r, color.g, color.b));
+            material.albedo = glm::vec3(color.r, color.g, color.b);
         }
         // Metallic
         if (ai_material->Get(AI_MATKEY_METALLIC_FACTOR, value) == AI_SUCCESS) {
-            material->set_metallic(value);
+            material.metallic = value;
         }
         // Roughness
         if (ai_material->Get(AI_MATKEY_ROUGHNESS_FACTOR, value) == AI_SUCCESS) {
-            material->set_roughness(value);
+            material.roughness = value;
         }
         // Emissive
         if (ai_material->Get(AI_MATKEY_COLOR_EMISSIVE, color) == AI_SUCCESS) {
-            material->set_emissive(glm::vec3(color.r, color.g, color.b));
-        }
-        // Load texture maps
-        auto &tex_lib = TextureLibrary::get_instance();
-        // Albedo/Diffuse map
-        auto diffuse_maps = load_material_textures(ai_material, aiTextureType_DIFFUSE, dir);
-        if (!diffuse_maps.empty()) {
-            material->set_albedo_map(diffuse_maps[0]);
-        }
-        // Normal map
-        auto normal_maps = load_material_textures(ai_material, aiTextureType_NORMALS, dir);
-        if (!normal_maps.empty()) {
-            material->set_normal_map(normal_maps[0]);
-        }
-        // Metallic map
-        auto metallic_maps = load_material_textures(ai_material, aiTextureType_METALNESS, dir);
-        if (!metallic_maps.empty()) {
-            material->set_metallic_map(metallic_maps[0]);
-        }
-        // Roughness map
-        auto roughness_maps = load_material_textures(ai_material, aiTextureType_DIFFUSE_ROUGHNESS, dir);
-        if (!roughness_maps.empty()) {
-            material->set_roughness_map(roughness_maps[0]);
+            material.emissive = glm::vec3(color.r, color.g, color.b);
         }
+        // Texture maps
+        material.albedo_map = find_material_texture(ai_material, aiTextureType_DIFFUSE, dir);
+        material.normal_map = find_material_texture(ai_material, aiTextureType_NORMALS, dir);
+        material.metallic_map = find_material_texture(ai_material, aiTextureType_METALNESS, dir);
+        material.roughness_map = find_material_texture(ai_material, aiTextureType_DIFFUSE_ROUGHNESS, dir);
         // GLTF combined metallic-roughness texture (if separate maps not found)
-        if (metallic_maps.empty() && roughness_maps.empty()) {
-            auto unknown_maps = load_material_textures(ai_material, aiTextureType_UNKNOWN, dir);
-            if (!unknown_maps.empty()) {
-                material->set_metallic_map(unknown_maps[0]);
-                material->set_roughness_map(unknown_maps[0]);
-                material->set_ao_map(unknown_maps[0]);  // AO is in red channel
-            }
+        if (material.metallic_map.empty() && material.roughness_map.empty()) {
+            std::string unknown_map = find_material_texture(ai_material, aiTextureType_UNKNOWN, dir);
+            material.metallic_map = unknown_map;
+            material.roughness_map = unknown_map;
+            material.ao_map = unknown_map; // AO is in red channel
         } else {
             // AO map (separate)
-            auto ao_maps = load_material_textures(ai_material, aiTextureType_AMBIENT_OCCLUSION, dir);
-            if (!ao_maps.empty()) {
-                material->set_ao_map(ao_maps[0]);
-            }
+            material.ao_map = find_material_texture(ai_material, aiTextureType_AMBIENT_OCCLUSION, dir);
+        }
+        material.emissive_map = find_material_texture(ai_material, aiTextureType_EMISSIVE, dir);
+    }
+    return data;
+}
+
+std::shared_ptr<scene::Mesh> ModelLoader::build_mesh(MeshData &data, MaterialMap &materials,
+                                                     std::shared_ptr<renderer::Shader> shader,
+                                                     const ModelLoadOptions &options, const TextureMap *textures) {
+    std::shared_ptr<scene::Mesh> mesh;
+    if (data.mapped_vertices && options.residency == scene::GeometryResidency::Release && !options.pack_vertices &&
+        !options.geometry_pool) {
+        // The mesh keeps no vertices, upload them straight from the cache mapping
+        auto vertex_buffer = std::make_shared<renderer::VertexBuffer>(
+            data.mapped_vertices, static_cast<unsigned int>(data.mapped_vertex_count * sizeof(scene::Vertex)));
+        vertex_buffer->set_layout(scene::Mesh::get_vertex_layout());
+        auto vertex_array = std::make_shared<renderer::VertexArray>();
+        vertex_array->add_vertex_buffer(vertex_buffer);
+        vertex_array->set_index_buffer(std::make_shared<renderer::IndexBuffer>(
+            data.mapped_indices, static_cast<unsigned int>(data.mapped_index_count)));
+        const glm::vec3 *positions = &data.mapped_vertices[0].position;
+        mesh = scene::Mesh::create_from_vertex_array(
+            vertex_array, std::vector<unsigned int>(data.mapped_indices, data.mapped_indices + data.mapped_index_count),
+            positions, data.mapped_vertex_count, sizeof(scene::Vertex), shader);
+        if (options.depth_stream) {
+            std::vector<glm::vec3> depth_positions(data.mapped_vertex_count);
+            for (std::size_t i = 0; i < data.mapped_vertex_count; ++i)
+                depth_positions[i] = data.mapped_vertices[i].position;
+            mesh->create_depth_stream(depth_positions);
         }
-        // Emissive map
-        auto emissive_maps = load_material_textures(ai_material, aiTextureType_EMISSIVE, dir);
-        if (!emissive_maps.empty()) {
-            material->set_emissive_map(emissive_maps[0]);
+        mesh->build_bvh(positions, data.mapped_vertex_count, sizeof(scene::Vertex));
+    } else {
+        std::vector<scene::Vertex> vertices = std::move(data.vertices);
+        std::vector<unsigned int> indices = std::move(data.indices);
+        // The mesh owns a copy either way, made here one mesh at a time
+        if (data.mapped_vertices) {
+            vertices.assign(data.mapped_vertices, data.mapped_vertices + data.mapped_vertex_count);
+            indices.assign(data.mapped_indices, data.mapped_indices + data.mapped_index_count);
         }
-        mesh->set_material(material);
+        mesh = std::make_shared<scene::Mesh>(std::move(vertices), std::move(indices), shader, options.geometry_pool,
+                                             options.pack_vertices);
+        if (options.depth_stream)
+            mesh->create_depth_stream();
     }
+    mesh->set_residency(options.residency);
+    if (!data.has_material)
+        return mesh;
+    // Meshes sharing a material in the source share the object, which also keeps them batched together
+    auto &shared = materials[data.material_index];
+    if (shared) {
+        mesh->set_material(shared);
+        return mesh;
+    }
+    const MaterialData &material_data = data.material;
+    auto material = std::make_shared<scene::Material>(material_data.name);
+    material->set_albedo(material_data.albedo);
+    material->set_metallic(material_data.metallic);
+    material->set_roughness(material_data.roughness);
+    material->set_emissive(material_data.emissive);
+    auto &tex_lib = TextureLibrary::get_instance();
+    auto load_map = [&tex_lib, textures](const std::string &path) -> std::shared_ptr<renderer::Texture> {
+        if (path.empty())
+            return nullptr;
+        if (textures) {
+            auto it = textures->find(path);
+            if (it != textures->end())
+                return it->second;
+        }
+        return tex_lib.load(path);
+    };
+    material->set_albedo_map(load_map(material_data.albedo_map));
+    material->set_normal_map(load_map(material_data.normal_map));
+    material->set_metallic_map(load_map(material_data.metallic_map));
+    material->set_roughness_map(load_map(material_data.roughness_map));
+    material->set_ao_map(load_map(material_data.ao_map));
+    material->set_emissive_map(load_map(material_data.emissive_map));
+    mesh->set_material(material);
+    shared = material;
     return mesh;
 }
 
-std::vector<std::shared_ptr<renderer::Texture>>
-ModelLoader::load_material_textures(aiMaterial *ai_material, unsigned int type, const std::string &dir) {
-    std::vector<std::shared_ptr<renderer::Texture>> textures;
+std::string ModelLoader::find_material_texture(aiMaterial *ai_material, unsigned int type, const std::string &dir) {
     unsigned int count = ai_material->GetTextureCount((aiTextureType)type);
     for (unsigned int i = 0; i < count; ++i) {
         aiString str;
@@ -196,18 +592,11 @@ ModelLoader::load_material_textures(aiMaterial *ai_material, unsigned int type,
         std::string filename = str.C_Str();
         std::string texture_path = dir + "/" + filename;
         std::cout << "    Looking for texture: " << texture_path << std::endl;
-        auto &tex_lib = TextureLibrary::get_instance();
-        if (std::filesystem::exists(texture_path)) {
-            auto texture = tex_lib.load(texture_path);
-            if (texture) {
-                textures.push_back(texture);
-                std::cout << "    Loaded successfully!" << std::endl;
-            }
-        } else {
-            std::cerr << "WARNING: Texture file not found: " << texture_path << std::endl;
-        }
+        if (std::filesystem::exists(texture_path))
+            return texture_path;
+        std::cerr << "WARNING: Texture file not found: " << texture_path << std::endl;
     }
-    return textures;
+    return std::string();
 }
 
 std::string ModelLoader::get_directory(const std::string &filepath) {
@@ -0,0 +1,1477 @@
+#include "lmgl/assets/scan_loader.hpp"
+#include "lmgl/assets/mapped_file.hpp"
+#include "lmgl/assets/texture_library.hpp"
+#include "lmgl/core/thread_pool.hpp"
+#include "lmgl/scene/mesh_optimizer.hpp"
+
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <initializer_list>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+namespace lmgl {
+
+namespace assets {
+
+namespace {
+
+// Bytes of text parsed by one task at least
+constexpr std::size_t MIN_CHUNK_BYTES = std::size_t(1) << 20;
+// Binary PLY records parsed by one task at least
+constexpr std::size_t MIN_CHUNK_RECORDS = std::size_t(1) << 16;
+// Missing index of a face corner, or triangle without a material
+constexpr unsigned int NO_INDEX = 0xFFFFFFFFu;
+constexpr uint32_t WHITE = 0xFFFFFFFFu;
+
+// Powers of ten exactly representable as doubles
+constexpr double POWERS_OF_TEN[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+inline bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+inline bool is_blank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+inline const char *skip_blanks(const char *p, const char *end) {
+    while (p < end && is_blank(*p))
+        ++p;
+    return p;
+}
+
+inline const char *skip_token(const char *p, const char *end) {
+    while (p < end && !is_blank(*p))
+        ++p;
+    return p;
+}
+
+inline const char *find_line_end(const char *p, const char *end) {
+    const void *newline = std::memchr(p, '\n', end - p);
+    return newline ? static_cast<const char *>(newline) : end;
+}
+
+// Parses a decimal number at p, advancing past it. Up to 19 significant digits with a decimal
+// exponent within 22 are converted exactly with one multiplication or division (Clinger's fast
+// path), anything longer goes through strtod.
+bool parse_float(const char *&p, const char *end, float &value) {
+    const char *start = p = skip_blanks(p, end);
+    const char *q = p;
+    bool negative = false;
+    if (q < end && (*q == '-' || *q == '+'))
+        negative = *q++ == '-';
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool exact = true;
+    bool any = false;
+    for (; q < end && is_digit(*q); ++q, any = true) {
+        if (digits < 19) {
+            mantissa = mantissa * 10 + static_cast<uint64_t>(*q - '0');
+            digits += mantissa != 0;
+        } else {
+            ++exponent;
+            exact = false;
+        }
+    }
+    if (q < end && *q == '.') {
+        for (++q; q < end && is_digit(*q); ++q, any = true) {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + static_cast<uint64_t>(*q - '0');
+                digits += mantissa != 0;
+                --exponent;
+            } else {
+                exact = false;
+            }
+        }
+    }
+    if (!any)
+        return false;
+    if (q < end && (*q == 'e' || *q == 'E')) {
+        const char *e = q + 1;
+        bool negative_exponent = false;
+        if (e < end && (*e == '-' || *e == '+'))
+            negative_exponent = *e++ == '-';
+        if (e < end && is_digit(*e)) {
+            int value_exponent = 0;
+            for (; e < end && is_digit(*e); ++e)
+                value_exponent = std::min(value_exponent * 10 + (*e - '0'), 100000);
+            exponent += negative_exponent ? -value_exponent : value_exponent;
+            q = e;
+        }
+    }
+    double result;
+    if (exact && mantissa <= (uint64_t(1) << 53) && exponent >= -22 && exponent <= 22) {
+        result = static_cast<double>(mantissa);
+        result = exponent < 0 ? result / POWERS_OF_TEN[-exponent] : result * POWERS_OF_TEN[exponent];
+        if (negative)
+            result = -result;
+    } else {
+        std::string text(start, q);
+        result = std::strtod(text.c_str(), nullptr);
+    }
+    value = static_cast<float>(result);
+    p = q;
+    return true;
+}
+
+// Parses a signed integer at p, advancing past it
+bool parse_integer(const char *&p, const char *end, long long &value) {
+    const char *q = skip_blanks(p, end);
+    bool negative = false;
+    if (q < end && (*q == '-' || *q == '+'))
+        negative = *q++ == '-';
+    if (q >= end || !is_digit(*q))
+        return false;
+    long long result = 0;
+    for (; q < end && is_digit(*q); ++q)
+        result = result * 10 + (*q - '0');
+    value = negative ? -result : result;
+    p = q;
+    return true;
+}
+
+// Returns the text after a keyword starting the line, nullptr if the line starts otherwise
+const char *match_keyword(const char *p, const char *end, const char *keyword) {
+    std::size_t length = std::strlen(keyword);
+    if (static_cast<std::size_t>(end - p) < length || std::memcmp(p, keyword, length) != 0)
+        return nullptr;
+    p += length;
+    return p == end || is_blank(*p) ? p : nullptr;
+}
+
+// Rest of a line without surrounding blanks
+std::string trimmed(const char *p, const char *end) {
+    p = skip_blanks(p, end);
+    while (end > p && is_blank(end[-1]))
+        --end;
+    return std::string(p, end);
+}
+
+// Splits [begin, end) into ranges ending after a newline, enough for every worker
+std::vector<std::pair<std::size_t, std::size_t>> split_lines(const char *data, std::size_t begin, std::size_t end) {
+    std::size_t workers = core::ThreadPool::get_instance().get_thread_count() + 1;
+    std::size_t parts = std::max<std::size_t>(1, std::min((end - begin) / MIN_CHUNK_BYTES, workers * 4));
+    std::vector<std::pair<std::size_t, std::size_t>> chunks;
+    std::size_t start = begin;
+    for (std::size_t i = 1; i <= parts && start < end; ++i) {
+        std::size_t stop = i == parts ? end : std::max(start, begin + (end - begin) / parts * i);
+        if (stop < end)
+            stop = static_cast<std::size_t>(find_line_end(data + stop, data + end) - data) + 1;
+        chunks.emplace_back(start, std::min(stop, end));
+        start = stop;
+    }
+    return chunks;
+}
+
+// Splits count records into ranges for the workers
+std::vector<std::pair<std::size_t, std::size_t>> split_records(std::size_t count) {
+    std::size_t workers = core::ThreadPool::get_instance().get_thread_count() + 1;
+    std::size_t parts = std::max<std::size_t>(1, std::min(count / MIN_CHUNK_RECORDS, workers * 4));
+    std::vector<std::pair<std::size_t, std::size_t>> ranges;
+    for (std::size_t i = 0; i < parts; ++i)
+        ranges.emplace_back(count * i / parts, count * (i + 1) / parts);
+    return ranges;
+}
+
+std::string get_directory(const std::string &fpath) {
+    std::size_t last_slash = fpath.find_last_of("/\\");
+    return last_slash == std::string::npos ? "." : fpath.substr(0, last_slash);
+}
+
+std::string get_extension(const std::string &fpath) {
+    std::string extension = std::filesystem::path(fpath).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return extension;
+}
+
+// Mesh of a scan, every array indexed by vertex
+struct Geometry {
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;    // Empty until generated when the file has none
+    std::vector<uint32_t> colors;      // RGBA8, empty when every vertex is white
+    std::vector<glm::vec2> uvs;        // Empty when the file has none
+    std::vector<unsigned int> indices; // Triangle list
+    std::vector<uint32_t> materials;   // Material of every triangle, empty when none has one
+};
+
+// Area-weighted vertex normals of a triangle list
+std::vector<glm::vec3> generate_normals(const std::vector<glm::vec3> &positions,
+                                        const std::vector<unsigned int> &indices) {
+    std::vector<glm::vec3> normals(positions.size(), glm::vec3(0.0f));
+    for (std::size_t i = 0; i + 2 < indices.size(); i += 3) {
+        const glm::vec3 &a = positions[indices[i]];
+        glm::vec3 normal = glm::cross(positions[indices[i + 1]] - a, positions[indices[i + 2]] - a);
+        normals[indices[i]] += normal;
+        normals[indices[i + 1]] += normal;
+        normals[indices[i + 2]] += normal;
+    }
+    auto ranges = split_records(normals.size());
+    core::ThreadPool::get_instance().parallel_for(ranges.size(), [&](std::size_t r) {
+        for (std::size_t i = ranges[r].first; i < ranges[r].second; ++i) {
+            float length = glm::length(normals[i]);
+            normals[i] = length > 0.0f ? normals[i] / length : glm::vec3(0.0f, 1.0f, 0.0f);
+        }
+    });
+    return normals;
+}
+
+// Materials of an OBJ file from its material libraries, by name
+void read_mtl(const std::string &fpath, std::unordered_map<std::string, MaterialData> &materials) {
+    std::ifstream file(fpath);
+    if (!file) {
+        std::cerr << "WARNING: Material library not found: " << fpath << std::endl;
+        return;
+    }
+    std::string dir = get_directory(fpath);
+    MaterialData *material = nullptr;
+    std::string line;
+    while (std::getline(file, line)) {
+        const char *p = skip_blanks(line.data(), line.data() + line.size());
+        const char *end = line.data() + line.size();
+        const char *rest;
+        float r = 0.0f, g = 0.0f, b = 0.0f;
+        if ((rest = match_keyword(p, end, "newmtl"))) {
+            std::string name = trimmed(rest, end);
+            material = &materials[name];
+            material->name = name;
+        } else if (!material) {
+            continue;
+        } else if ((rest = match_keyword(p, end, "Kd"))) {
+            if (parse_float(rest, end, r) && parse_float(rest, end, g) && parse_float(rest, end, b))
+                material->albedo = glm::vec3(r, g, b);
+        } else if ((rest = match_keyword(p, end, "Ke"))) {
+            if (parse_float(rest, end, r) && parse_float(rest, end, g) && parse_float(rest, end, b))
+                material->emissive = glm::vec3(r, g, b);
+        } else if ((rest = match_keyword(p, end, "map_Kd"))) {
+            // Options come first, the file name is the last word
+            std::string value = trimmed(rest, end);
+            std::size_t last_blank = value.find_last_of(" \t");
+            std::string texture_path = dir + "/" + value.substr(last_blank == std::string::npos ? 0 : last_blank + 1);
+            if (std::filesystem::exists(texture_path))
+                material->albedo_map = texture_path;
+            else
+                std::cerr << "WARNING: Texture file not found: " << texture_path << std::endl;
+        }
+    }
+}
+
+// Counts of an OBJ chunk from the first pass, and where the second pass writes them
+struct ObjChunk {
+    std::size_t begin = 0;
+    std::size_t end = 0;
+    std::size_t positions = 0;
+    std::size_t uvs = 0;
+    std::size_t normals = 0;
+    std::size_t triangles = 0;
+    bool colors = false;                // The first position of the chunk has a color
+    bool slashes = false;               // Some face corner has UV or normal indices
+    std::vector<std::string> materials; // usemtl names, in order
+    std::vector<std::string> libraries; // mtllib names, in order
+    std::size_t position_base = 0;
+    std::size_t uv_base = 0;
+    std::size_t normal_base = 0;
+    std::size_t triangle_base = 0;
+    uint32_t material = NO_INDEX; // Material active where the chunk starts
+    bool uv_corners = false;      // Some corner has a UV index
+    bool normal_corners = false;  // Some corner has a normal index
+    bool separate = false;        // Some corner has UV or normal indices other than its position index
+};
+
+// Position, UV and normal index of a face corner
+struct Corner {
+    unsigned int position;
+    unsigned int uv;
+    unsigned int normal;
+
+    bool operator==(const Corner &other) const {
+        return position == other.position && uv == other.uv && normal == other.normal;
+    }
+};
+
+// First pass over an OBJ chunk: counts elements and collects material names
+void count_obj(const char *data, ObjChunk &chunk) {
+    const char *end = data + chunk.end;
+    for (const char *p = data + chunk.begin; p < end;) {
+        const char *line_end = find_line_end(p, end);
+        const char *q = skip_blanks(p, line_end);
+        p = line_end + 1;
+        if (line_end - q < 2)
+            continue;
+        const char *rest;
+        if (q[0] == 'v' && is_blank(q[1])) {
+            if (chunk.positions++ == 0) {
+                int values = 0;
+                for (const char *r = skip_blanks(q + 1, line_end); r < line_end; r = skip_blanks(r, line_end)) {
+                    r = skip_token(r, line_end);
+                    ++values;
+                }
+                chunk.colors = values >= 6;
+            }
+        } else if (q[0] == 'v' && q[1] == 't' && (line_end - q == 2 || is_blank(q[2]))) {
+            ++chunk.uvs;
+        } else if (q[0] == 'v' && q[1] == 'n' && (line_end - q == 2 || is_blank(q[2]))) {
+            ++chunk.normals;
+        } else if (q[0] == 'f' && is_blank(q[1])) {
+            std::size_t corners = 0;
+            for (const char *r = skip_blanks(q + 1, line_end); r < line_end; r = skip_blanks(r, line_end)) {
+                const char *token_end = skip_token(r, line_end);
+                chunk.slashes = chunk.slashes || std::memchr(r, '/', token_end - r);
+                r = token_end;
+                ++corners;
+            }
+            if (corners >= 3)
+                chunk.triangles += corners - 2;
+        } else if ((rest = match_keyword(q, line_end, "usemtl"))) {
+            chunk.materials.push_back(trimmed(rest, line_end));
+        } else if ((rest = match_keyword(q, line_end, "mtllib"))) {
+            chunk.libraries.push_back(trimmed(rest, line_end));
+        }
+    }
+}
+
+// Arrays the second OBJ pass writes into, sized from the counts
+struct ObjArrays {
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> colors;
+    std::vector<glm::vec2> uvs;
+    std::vector<glm::vec3> normals;
+    std::vector<unsigned int> corner_positions;
+    std::vector<unsigned int> corner_uvs;     // Empty when no face has slashes
+    std::vector<unsigned int> corner_normals; // Empty when no face has slashes
+    std::vector<uint32_t> materials;          // Empty when no usemtl
+};
+
+// Resolves a 1-based or negative OBJ index against the count of elements read so far
+unsigned int resolve_index(long long index, std::size_t read, std::size_t total) {
+    long long resolved = index > 0 ? index - 1 : static_cast<long long>(read) + index;
+    if (index == 0 || resolved < 0 || resolved >= static_cast<long long>(total))
+        throw std::runtime_error("face index " + std::to_string(index) + " out of range");
+    return static_cast<unsigned int>(resolved);
+}
+
+// Second pass over an OBJ chunk: parses the elements into their place in the arrays
+void parse_obj(const char *data, ObjChunk &chunk, ObjArrays &arrays,
+               const std::unordered_map<std::string, uint32_t> &material_ids, bool flip_uvs) {
+    const char *end = data + chunk.end;
+    std::size_t positions = 0, uvs = 0, normals = 0, triangle = chunk.triangle_base;
+    uint32_t material = chunk.material;
+    std::vector<Corner> corners;
+    for (const char *p = data + chunk.begin; p < end;) {
+        const char *line_end = find_line_end(p, end);
+        const char *q = skip_blanks(p, line_end);
+        p = line_end + 1;
+        if (line_end - q < 2)
+            continue;
+        const char *rest;
+        if (q[0] == 'v' && is_blank(q[1])) {
+            glm::vec3 position;
+            rest = q + 1;
+            if (!parse_float(rest, line_end, position.x) || !parse_float(rest, line_end, position.y) ||
+                !parse_float(rest, line_end, position.z))
+                throw std::runtime_error("malformed vertex");
+            std::size_t index = chunk.position_base + positions++;
+            arrays.positions[index] = position;
+            glm::vec3 color;
+            if (!arrays.colors.empty() && parse_float(rest, line_end, color.x) &&
+                parse_float(rest, line_end, color.y) && parse_float(rest, line_end, color.z))
+                arrays.colors[index] = glm::packUnorm4x8(glm::vec4(color, 1.0f));
+        } else if (q[0] == 'v' && q[1] == 't' && (line_end - q == 2 || is_blank(q[2]))) {
+            glm::vec2 uv(0.0f);
+            rest = q + 2;
+            if (!parse_float(rest, line_end, uv.x))
+                throw std::runtime_error("malformed texture coordinate");
+            parse_float(rest, line_end, uv.y);
+            if (flip_uvs)
+                uv.y = 1.0f - uv.y;
+            arrays.uvs[chunk.uv_base + uvs++] = uv;
+        } else if (q[0] == 'v' && q[1] == 'n' && (line_end - q == 2 || is_blank(q[2]))) {
+            glm::vec3 normal;
+            rest = q + 2;
+            if (!parse_float(rest, line_end, normal.x) || !parse_float(rest, line_end, normal.y) ||
+                !parse_float(rest, line_end, normal.z))
+                throw std::runtime_error("malformed normal");
+            arrays.normals[chunk.normal_base + normals++] = normal;
+        } else if (q[0] == 'f' && is_blank(q[1])) {
+            corners.clear();
+            for (const char *r = skip_blanks(q + 1, line_end); r < line_end; r = skip_blanks(r, line_end)) {
+                Corner corner{0, NO_INDEX, NO_INDEX};
+                long long index = 0;
+                if (!parse_integer(r, line_end, index))
+                    throw std::runtime_error("malformed face");
+                corner.position = resolve_index(index, chunk.position_base + positions, arrays.positions.size());
+                if (r < line_end && *r == '/') {
+                    ++r;
+                    if (parse_integer(r, line_end, index)) {
+                        corner.uv = resolve_index(index, chunk.uv_base + uvs, arrays.uvs.size());
+                        chunk.uv_corners = true;
+                    }
+                    if (r < line_end && *r == '/') {
+                        ++r;
+                        if (parse_integer(r, line_end, index)) {
+                            corner.normal = resolve_index(index, chunk.normal_base + normals, arrays.normals.size());
+                            chunk.normal_corners = true;
+                        }
+                    }
+                }
+                chunk.separate = chunk.separate || (corner.uv != NO_INDEX && corner.uv != corner.position) ||
+                                 (corner.normal != NO_INDEX && corner.normal != corner.position);
+                corners.push_back(corner);
+                r = skip_token(r, line_end);
+            }
+            // Polygons are triangulated as fans
+            for (std::size_t i = 1; i + 1 < corners.size(); ++i, ++triangle) {
+                const Corner *fan[3] = {&corners[0], &corners[i], &corners[i + 1]};
+                for (int k = 0; k < 3; ++k) {
+                    arrays.corner_positions[triangle * 3 + k] = fan[k]->position;
+                    if (!arrays.corner_uvs.empty()) {
+                        arrays.corner_uvs[triangle * 3 + k] = fan[k]->uv;
+                        arrays.corner_normals[triangle * 3 + k] = fan[k]->normal;
+                    }
+                }
+                if (!arrays.materials.empty())
+                    arrays.materials[triangle] = material;
+            }
+        } else if ((rest = match_keyword(q, line_end, "usemtl"))) {
+            material = material_ids.at(trimmed(rest, line_end));
+        }
+    }
+}
+
+// Reads an OBJ file into geometry and materials
+void read_obj(const std::string &fpath, const MappedFile &file, const ModelLoadOptions &options,
+              Geometry &geometry, std::vector<MaterialData> &materials) {
+    auto &pool = core::ThreadPool::get_instance();
+    const char *data = reinterpret_cast<const char *>(file.data());
+    std::vector<ObjChunk> chunks;
+    for (const auto &range : split_lines(data, 0, file.size())) {
+        chunks.emplace_back();
+        chunks.back().begin = range.first;
+        chunks.back().end = range.second;
+    }
+    pool.parallel_for(chunks.size(), [&](std::size_t i) { count_obj(data, chunks[i]); });
+
+    // Where every chunk writes, and the material active where it starts
+    ObjChunk totals;
+    std::unordered_map<std::string, uint32_t> material_ids;
+    std::vector<std::string> material_names;
+    std::vector<std::string> libraries;
+    uint32_t material = NO_INDEX;
+    for (ObjChunk &chunk : chunks) {
+        chunk.position_base = totals.positions;
+        chunk.uv_base = totals.uvs;
+        chunk.normal_base = totals.normals;
+        chunk.triangle_base = totals.triangles;
+        chunk.material = material;
+        totals.positions += chunk.positions;
+        totals.uvs += chunk.uvs;
+        totals.normals += chunk.normals;
+        totals.triangles += chunk.triangles;
+        totals.colors = totals.colors || chunk.colors;
+        totals.slashes = totals.slashes || chunk.slashes;
+        for (const std::string &name : chunk.materials) {
+            auto it = material_ids.emplace(name, static_cast<uint32_t>(material_names.size())).first;
+            if (it->second == material_names.size())
+                material_names.push_back(name);
+            material = it->second;
+        }
+        libraries.insert(libraries.end(), chunk.libraries.begin(), chunk.libraries.end());
+    }
+    if (totals.positions >= NO_INDEX || totals.triangles * 3 >= NO_INDEX)
+        throw std::runtime_error("too many vertices for 32-bit indices");
+
+    ObjArrays arrays;
+    arrays.positions.resize(totals.positions);
+    if (totals.colors)
+        arrays.colors.assign(totals.positions, WHITE);
+    arrays.uvs.resize(totals.uvs);
+    arrays.normals.resize(totals.normals);
+    arrays.corner_positions.resize(totals.triangles * 3);
+    if (totals.slashes) {
+        arrays.corner_uvs.resize(totals.triangles * 3);
+        arrays.corner_normals.resize(totals.triangles * 3);
+    }
+    if (!material_names.empty())
+        arrays.materials.resize(totals.triangles);
+    pool.parallel_for(chunks.size(),
+                      [&](std::size_t i) { parse_obj(data, chunks[i], arrays, material_ids, options.flip_uvs); });
+
+    bool uv_corners = false, normal_corners = false, separate = false;
+    for (const ObjChunk &chunk : chunks) {
+        uv_corners = uv_corners || chunk.uv_corners;
+        normal_corners = normal_corners || chunk.normal_corners;
+        separate = separate || chunk.separate;
+    }
+    // Normals are generated per position, so that welded vertices at UV seams get the same one
+    std::vector<glm::vec3> normals = normal_corners ? std::move(arrays.normals)
+                                                    : generate_normals(arrays.positions, arrays.corner_positions);
+    if (!uv_corners)
+        arrays.uvs.clear();
+    if (!separate) {
+        // Every corner indexes its UV and normal like its position, vertices are the positions
+        geometry.positions = std::move(arrays.positions);
+        geometry.colors = std::move(arrays.colors);
+        geometry.indices = std::move(arrays.corner_positions);
+        geometry.normals = std::move(normals);
+        geometry.normals.resize(geometry.positions.size(), glm::vec3(0.0f, 1.0f, 0.0f));
+        if (!arrays.uvs.empty()) {
+            geometry.uvs = std::move(arrays.uvs);
+            geometry.uvs.resize(geometry.positions.size(), glm::vec2(0.0f));
+        }
+    } else {
+        // Weld every distinct position, UV and normal combination into a vertex. Sorting the corners
+        // needs one index per corner, a hash map would take several times the size of the mesh.
+        if (!normal_corners)
+            std::fill(arrays.corner_normals.begin(), arrays.corner_normals.end(), NO_INDEX);
+        auto corner_at = [&](unsigned int i) {
+            return Corner{arrays.corner_positions[i], arrays.corner_uvs[i], arrays.corner_normals[i]};
+        };
+        std::vector<unsigned int> sorted(arrays.corner_positions.size());
+        std::iota(sorted.begin(), sorted.end(), 0u);
+        std::sort(sorted.begin(), sorted.end(), [&](unsigned int a, unsigned int b) {
+            Corner first = corner_at(a), second = corner_at(b);
+            if (first.position != second.position)
+                return first.position < second.position;
+            if (first.uv != second.uv)
+                return first.uv < second.uv;
+            if (first.normal != second.normal)
+                return first.normal < second.normal;
+            return a < b;
+        });
+        // The first corner of every run of equal corners stands for the vertex
+        std::vector<Corner> vertices;
+        geometry.indices.resize(sorted.size());
+        for (std::size_t i = 0; i < sorted.size(); ++i) {
+            Corner corner = corner_at(sorted[i]);
+            if (vertices.empty() || !(vertices.back() == corner))
+                vertices.push_back(corner);
+            geometry.indices[sorted[i]] = static_cast<unsigned int>(vertices.size() - 1);
+        }
+        sorted = {};
+        arrays.corner_positions = {};
+        arrays.corner_uvs = {};
+        arrays.corner_normals = {};
+        vertices.shrink_to_fit();
+        geometry.positions.resize(vertices.size());
+        geometry.normals.resize(vertices.size());
+        if (!arrays.colors.empty())
+            geometry.colors.resize(vertices.size());
+        if (!arrays.uvs.empty())
+            geometry.uvs.resize(vertices.size());
+        auto ranges = split_records(vertices.size());
+        pool.parallel_for(ranges.size(), [&](std::size_t r) {
+            for (std::size_t i = ranges[r].first; i < ranges[r].second; ++i) {
+                const Corner &corner = vertices[i];
+                geometry.positions[i] = arrays.positions[corner.position];
+                if (!normal_corners)
+                    geometry.normals[i] = normals[corner.position];
+                else if (corner.normal != NO_INDEX)
+                    geometry.normals[i] = normals[corner.normal];
+                else
+                    geometry.normals[i] = glm::vec3(0.0f, 1.0f, 0.0f);
+                if (!geometry.colors.empty())
+                    geometry.colors[i] = arrays.colors[corner.position];
+                if (!geometry.uvs.empty())
+                    geometry.uvs[i] = corner.uv != NO_INDEX ? arrays.uvs[corner.uv] : glm::vec2(0.0f);
+            }
+        });
+    }
+    geometry.materials = std::move(arrays.materials);
+
+    if (material_names.empty())
+        return;
+    std::unordered_map<std::string, MaterialData> library;
+    std::string dir = get_directory(fpath);
+    for (const std::string &name : libraries)
+        read_mtl(dir + "/" + name, library);
+    materials.resize(material_names.size());
+    for (std::size_t i = 0; i < material_names.size(); ++i) {
+        auto it = library.find(material_names[i]);
+        if (it != library.end())
+            materials[i] = it->second;
+        materials[i].name = material_names[i];
+    }
+}
+
+enum class PlyFormat { Ascii, BinaryLittleEndian, BinaryBigEndian };
+
+enum class PlyType { Int8, UInt8, Int16, UInt16, Int32, UInt32, Float32, Float64, Invalid };
+
+// A property of a PLY element, lists have a count type
+struct PlyProperty {
+    std::string name;
+    PlyType type = PlyType::Invalid;
+    PlyType count_type = PlyType::Invalid; // Invalid for scalar properties
+    std::size_t offset = 0;                // Offset in the record, for fixed-size binary records
+
+    bool is_list() const { return count_type != PlyType::Invalid; }
+};
+
+struct PlyElement {
+    std::string name;
+    std::size_t count = 0;
+    std::vector<PlyProperty> properties;
+    std::size_t size = 0; // Binary record size, 0 when the element has lists
+
+    int find(std::initializer_list<const char *> names) const {
+        for (const char *name : names)
+            for (std::size_t i = 0; i < properties.size(); ++i)
+                if (properties[i].name == name)
+                    return static_cast<int>(i);
+        return -1;
+    }
+};
+
+PlyType parse_ply_type(const std::string &name) {
+    if (name == "char" || name == "int8")
+        return PlyType::Int8;
+    if (name == "uchar" || name == "uint8")
+        return PlyType::UInt8;
+    if (name == "short" || name == "int16")
+        return PlyType::Int16;
+    if (name == "ushort" || name == "uint16")
+        return PlyType::UInt16;
+    if (name == "int" || name == "int32")
+        return PlyType::Int32;
+    if (name == "uint" || name == "uint32")
+        return PlyType::UInt32;
+    if (name == "float" || name == "float32")
+        return PlyType::Float32;
+    if (name == "double" || name == "float64")
+        return PlyType::Float64;
+    return PlyType::Invalid;
+}
+
+std::size_t ply_type_size(PlyType type) {
+    switch (type) {
+    case PlyType::Int8:
+    case PlyType::UInt8:
+        return 1;
+    case PlyType::Int16:
+    case PlyType::UInt16:
+        return 2;
+    case PlyType::Int32:
+    case PlyType::UInt32:
+    case PlyType::Float32:
+        return 4;
+    case PlyType::Float64:
+        return 8;
+    default:
+        return 0;
+    }
+}
+
+// Largest value of an integer type, colors stored as integers are normalized by it
+float ply_type_max(PlyType type) {
+    switch (type) {
+    case PlyType::Int8:
+        return 127.0f;
+    case PlyType::UInt8:
+        return 255.0f;
+    case PlyType::Int16:
+        return 32767.0f;
+    case PlyType::UInt16:
+        return 65535.0f;
+    case PlyType::Int32:
+        return 2147483647.0f;
+    case PlyType::UInt32:
+        return 4294967295.0f;
+    default:
+        return 1.0f;
+    }
+}
+
+// Reads a binary value, swapping bytes for files of the other byte order
+double read_ply_value(PlyType type, const unsigned char *p, bool swap) {
+    unsigned char bytes[8];
+    std::size_t size = ply_type_size(type);
+    if (swap)
+        std::reverse_copy(p, p + size, bytes);
+    else
+        std::memcpy(bytes, p, size);
+    switch (type) {
+    case PlyType::Int8:
+        return static_cast<int8_t>(bytes[0]);
+    case PlyType::UInt8:
+        return bytes[0];
+    case PlyType::Int16: {
+        int16_t value;
+        std::memcpy(&value, bytes, 2);
+        return value;
+    }
+    case PlyType::UInt16: {
+        uint16_t value;
+        std::memcpy(&value, bytes, 2);
+        return value;
+    }
+    case PlyType::Int32: {
+        int32_t value;
+        std::memcpy(&value, bytes, 4);
+        return value;
+    }
+    case PlyType::UInt32: {
+        uint32_t value;
+        std::memcpy(&value, bytes, 4);
+        return value;
+    }
+    case PlyType::Float32: {
+        float value;
+        std::memcpy(&value, bytes, 4);
+        return value;
+    }
+    case PlyType::Float64: {
+        double value;
+        std::memcpy(&value, bytes, 8);
+        return value;
+    }
+    default:
+        return 0.0;
+    }
+}
+
+// Where the properties of the vertex element go
+struct PlyVertexLayout {
+    int position[3] = {-1, -1, -1};
+    int normal[3] = {-1, -1, -1};
+    int color[4] = {-1, -1, -1, -1};
+    int uv[2] = {-1, -1};
+    float color_scale[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+
+    explicit PlyVertexLayout(const PlyElement &element) {
+        position[0] = element.find({"x"});
+        position[1] = element.find({"y"});
+        position[2] = element.find({"z"});
+        normal[0] = element.find({"nx"});
+        normal[1] = element.find({"ny"});
+        normal[2] = element.find({"nz"});
+        color[0] = element.find({"red", "r", "diffuse_red"});
+        color[1] = element.find({"green", "g", "diffuse_green"});
+        color[2] = element.find({"blue", "b", "diffuse_blue"});
+        color[3] = element.find({"alpha", "a", "diffuse_alpha"});
+        uv[0] = element.find({"u", "s", "texture_u", "texture_s"});
+        uv[1] = element.find({"v", "t", "texture_v", "texture_t"});
+        if (position[0] < 0 || position[1] < 0 || position[2] < 0)
+            throw std::runtime_error("vertices without positions");
+        for (int i = 0; i < 3; ++i)
+            if (normal[i] < 0)
+                normal[0] = -1;
+        for (int i = 0; i < 3; ++i)
+            if (color[i] < 0)
+                color[0] = -1;
+        if (uv[1] < 0)
+            uv[0] = -1;
+        for (int i = 0; i < 4; ++i)
+            if (color[i] >= 0)
+                color_scale[i] = 1.0f / ply_type_max(element.properties[color[i]].type);
+    }
+
+    // Stores the values of a vertex, indexed like the properties
+    void store(const double *values, std::size_t index, Geometry &geometry, bool flip_uvs) const {
+        geometry.positions[index] = glm::vec3(values[position[0]], values[position[1]], values[position[2]]);
+        if (normal[0] >= 0)
+            geometry.normals[index] = glm::vec3(values[normal[0]], values[normal[1]], values[normal[2]]);
+        if (color[0] >= 0) {
+            glm::vec4 rgba(values[color[0]] * color_scale[0], values[color[1]] * color_scale[1],
+                           values[color[2]] * color_scale[2], color[3] >= 0 ? values[color[3]] * color_scale[3] : 1.0);
+            geometry.colors[index] = glm::packUnorm4x8(rgba);
+        }
+        if (uv[0] >= 0) {
+            glm::vec2 uv_value(values[uv[0]], values[uv[1]]);
+            if (flip_uvs)
+                uv_value.y = 1.0f - uv_value.y;
+            geometry.uvs[index] = uv_value;
+        }
+    }
+};
+
+// Reads the PLY header, returning the offset of the body
+std::size_t read_ply_header(const MappedFile &file, PlyFormat &format, std::vector<PlyElement> &elements) {
+    const char *data = reinterpret_cast<const char *>(file.data());
+    const char *end = data + file.size();
+    const char *p = data;
+    bool magic = false, has_format = false;
+    while (p < end) {
+        const char *line_end = find_line_end(p, end);
+        std::istringstream line(std::string(p, line_end));
+        p = line_end + 1;
+        std::string keyword;
+        line >> keyword;
+        if (!magic) {
+            if (keyword != "ply")
+                throw std::runtime_error("not a PLY file");
+            magic = true;
+        } else if (keyword == "format") {
+            std::string name;
+            line >> name;
+            if (name == "ascii")
+                format = PlyFormat::Ascii;
+            else if (name == "binary_little_endian")
+                format = PlyFormat::BinaryLittleEndian;
+            else if (name == "binary_big_endian")
+                format = PlyFormat::BinaryBigEndian;
+            else
+                throw std::runtime_error("unknown format " + name);
+            has_format = true;
+        } else if (keyword == "element") {
+            PlyElement element;
+            line >> element.name >> element.count;
+            if (!line)
+                throw std::runtime_error("malformed element");
+            elements.push_back(element);
+        } else if (keyword == "property") {
+            if (elements.empty())
+                throw std::runtime_error("property outside an element");
+            PlyProperty property;
+            std::string type;
+            line >> type;
+            if (type == "list") {
+                std::string count_type;
+                line >> count_type >> type;
+                property.count_type = parse_ply_type(count_type);
+                if (property.count_type == PlyType::Invalid)
+                    throw std::runtime_error("unknown type " + count_type);
+            }
+            property.type = parse_ply_type(type);
+            line >> property.name;
+            if (property.type == PlyType::Invalid || !line)
+                throw std::runtime_error("malformed property");
+            elements.back().properties.push_back(property);
+        } else if (keyword == "end_header") {
+            if (!has_format)
+                throw std::runtime_error("missing format");
+            for (PlyElement &element : elements) {
+                std::size_t size = 0;
+                for (PlyProperty &property : element.properties) {
+                    property.offset = size;
+                    size += ply_type_size(property.type);
+                    if (property.is_list())
+                        size = 0;
+                    if (size == 0)
+                        break;
+                }
+                element.size = size;
+            }
+            return static_cast<std::size_t>(p - data);
+        }
+        // comment and obj_info lines are skipped
+    }
+    throw std::runtime_error("missing end_header");
+}
+
+// Faces with other than three corners, found while parsing in parallel
+struct PlyPolygon {
+    std::size_t face;
+    std::vector<unsigned int> corners;
+};
+
+// Rewrites a triangle list where polygons left gaps, fan triangulating the polygons
+void insert_polygons(std::vector<unsigned int> &indices, const std::vector<std::vector<PlyPolygon>> &polygons) {
+    std::vector<unsigned int> result;
+    std::size_t extra = 0;
+    for (const auto &chunk : polygons)
+        for (const PlyPolygon &polygon : chunk)
+            extra += polygon.corners.size() >= 3 ? (polygon.corners.size() - 3) * 3 : 0;
+    result.reserve(indices.size() + extra);
+    std::size_t face = 0;
+    auto copy_until = [&](std::size_t stop) {
+        result.insert(result.end(), indices.begin() + face * 3, indices.begin() + stop * 3);
+        face = stop;
+    };
+    for (const auto &chunk : polygons) {
+        for (const PlyPolygon &polygon : chunk) {
+            copy_until(polygon.face);
+            for (std::size_t i = 1; i + 1 < polygon.corners.size(); ++i)
+                result.insert(result.end(), {polygon.corners[0], polygon.corners[i], polygon.corners[i + 1]});
+            ++face;
+        }
+    }
+    copy_until(indices.size() / 3);
+    indices = std::move(result);
+}
+
+void allocate_ply_vertices(const PlyVertexLayout &layout, std::size_t count, Geometry &geometry) {
+    if (count >= NO_INDEX)
+        throw std::runtime_error("too many vertices for 32-bit indices");
+    geometry.positions.resize(count);
+    if (layout.normal[0] >= 0)
+        geometry.normals.resize(count);
+    if (layout.color[0] >= 0)
+        geometry.colors.resize(count);
+    if (layout.uv[0] >= 0)
+        geometry.uvs.resize(count);
+}
+
+void read_ascii_ply(const MappedFile &file, std::size_t body, const std::vector<PlyElement> &elements,
+                    const ModelLoadOptions &options, Geometry &geometry) {
+    auto &pool = core::ThreadPool::get_instance();
+    const char *data = reinterpret_cast<const char *>(file.data());
+    auto chunks = split_lines(data, body, file.size());
+    // Elements are one per line: counting the lines of every chunk tells which elements it holds
+    std::vector<std::size_t> first_line(chunks.size() + 1, 0);
+    pool.parallel_for(chunks.size(), [&](std::size_t i) {
+        std::size_t lines = 0;
+        const char *end = data + chunks[i].second;
+        for (const char *p = data + chunks[i].first; p < end; p = find_line_end(p, end) + 1)
+            ++lines;
+        first_line[i + 1] = lines;
+    });
+    std::partial_sum(first_line.begin(), first_line.end(), first_line.begin());
+    std::vector<std::size_t> element_line(elements.size() + 1, 0);
+    for (std::size_t i = 0; i < elements.size(); ++i)
+        element_line[i + 1] = element_line[i] + elements[i].count;
+    if (first_line.back() < element_line.back())
+        throw std::runtime_error("file ends before its last element");
+
+    int vertex_element = -1, face_element = -1, index_property = -1;
+    for (std::size_t i = 0; i < elements.size(); ++i) {
+        if (elements[i].name == "vertex")
+            vertex_element = static_cast<int>(i);
+        else if (elements[i].name == "face")
+            face_element = static_cast<int>(i);
+    }
+    if (vertex_element < 0)
+        throw std::runtime_error("no vertex element");
+    PlyVertexLayout layout(elements[vertex_element]);
+    std::size_t vertex_count = elements[vertex_element].count;
+    allocate_ply_vertices(layout, vertex_count, geometry);
+    if (face_element >= 0) {
+        index_property = elements[face_element].find({"vertex_indices", "vertex_index"});
+        if (index_property < 0 || !elements[face_element].properties[index_property].is_list())
+            throw std::runtime_error("faces without vertex indices");
+        geometry.indices.resize(elements[face_element].count * 3);
+    }
+
+    std::vector<std::vector<PlyPolygon>> polygons(chunks.size());
+    pool.parallel_for(chunks.size(), [&](std::size_t c) {
+        const char *end = data + chunks[c].second;
+        std::size_t line = first_line[c];
+        std::size_t element = 0;
+        std::vector<double> values;
+        std::vector<unsigned int> corners;
+        for (const char *p = data + chunks[c].first; p < end; ++line) {
+            const char *line_end = find_line_end(p, end);
+            const char *q = p;
+            p = line_end + 1;
+            while (element < elements.size() && line >= element_line[element + 1])
+                ++element;
+            if (element >= elements.size())
+                break;
+            const bool is_vertex = static_cast<int>(element) == vertex_element;
+            const bool is_face = static_cast<int>(element) == face_element;
+            if (!is_vertex && !is_face)
+                continue;
+            const std::vector<PlyProperty> &properties = elements[element].properties;
+            values.assign(properties.size(), 0.0);
+            for (std::size_t i = 0; i < properties.size(); ++i) {
+                float value = 0.0f;
+                if (!properties[i].is_list()) {
+                    if (!parse_float(q, line_end, value))
+                        throw std::runtime_error("malformed " + elements[element].name);
+                    values[i] = value;
+                    continue;
+                }
+                long long count = 0, index = 0;
+                if (!parse_integer(q, line_end, count) || count < 0)
+                    throw std::runtime_error("malformed list");
+                const bool indices = is_face && static_cast<int>(i) == index_property;
+                corners.clear();
+                for (long long k = 0; k < count; ++k) {
+                    if (!indices) {
+                        if (!parse_float(q, line_end, value))
+                            throw std::runtime_error("malformed list");
+                    } else if (!parse_integer(q, line_end, index) || index < 0 ||
+                               static_cast<std::size_t>(index) >= vertex_count) {
+                        throw std::runtime_error("face index out of range");
+                    } else {
+                        corners.push_back(static_cast<unsigned int>(index));
+                    }
+                }
+            }
+            std::size_t record = line - element_line[element];
+            if (is_vertex) {
+                layout.store(values.data(), record, geometry, options.flip_uvs);
+            } else if (corners.size() == 3) {
+                std::copy(corners.begin(), corners.end(), geometry.indices.begin() + record * 3);
+            } else {
+                polygons[c].push_back({record, corners});
+            }
+        }
+    });
+    for (const auto &chunk : polygons) {
+        if (!chunk.empty()) {
+            insert_polygons(geometry.indices, polygons);
+            break;
+        }
+    }
+}
+
+// Reads the faces of a binary PLY one record after the other, for faces of varying size
+std::size_t read_binary_faces(const unsigned char *p, const unsigned char *end, const PlyElement &element,
+                              int index_property, bool swap, std::size_t vertex_count, Geometry &geometry) {
+    const unsigned char *start = p;
+    geometry.indices.clear();
+    geometry.indices.reserve(element.count * 3);
+    std::vector<unsigned int> corners;
+    for (std::size_t f = 0; f < element.count; ++f) {
+        for (std::size_t i = 0; i < element.properties.size(); ++i) {
+            const PlyProperty &property = element.properties[i];
+            std::size_t size = ply_type_size(property.type);
+            if (!property.is_list()) {
+                p += size;
+                continue;
+            }
+            std::size_t count_size = ply_type_size(property.count_type);
+            if (p + count_size > end)
+                throw std::runtime_error("file ends inside a face");
+            std::size_t count = static_cast<std::size_t>(read_ply_value(property.count_type, p, swap));
+            p += count_size;
+            if (p + count * size > end)
+                throw std::runtime_error("file ends inside a face");
+            if (static_cast<int>(i) != index_property) {
+                p += count * size;
+                continue;
+            }
+            corners.resize(count);
+            for (std::size_t k = 0; k < count; ++k, p += size) {
+                double index = read_ply_value(property.type, p, swap);
+                if (index < 0.0 || index >= static_cast<double>(vertex_count))
+                    throw std::runtime_error("face index out of range");
+                corners[k] = static_cast<unsigned int>(index);
+            }
+            for (std::size_t k = 1; k + 1 < count; ++k)
+                geometry.indices.insert(geometry.indices.end(), {corners[0], corners[k], corners[k + 1]});
+        }
+        if (p > end)
+            throw std::runtime_error("file ends inside a face");
+    }
+    return static_cast<std::size_t>(p - start);
+}
+
+// Skips the records of a binary element with lists
+std::size_t skip_binary_element(const unsigned char *p, const unsigned char *end, const PlyElement &element,
+                                bool swap) {
+    const unsigned char *start = p;
+    for (std::size_t r = 0; r < element.count; ++r) {
+        for (const PlyProperty &property : element.properties) {
+            std::size_t size = ply_type_size(property.type);
+            if (property.is_list()) {
+                if (p + ply_type_size(property.count_type) > end)
+                    throw std::runtime_error("file ends inside " + element.name);
+                size *= static_cast<std::size_t>(read_ply_value(property.count_type, p, swap));
+                p += ply_type_size(property.count_type);
+            }
+            p += size;
+        }
+        if (p > end)
+            throw std::runtime_error("file ends inside " + element.name);
+    }
+    return static_cast<std::size_t>(p - start);
+}
+
+void read_binary_ply(const MappedFile &file, std::size_t body, PlyFormat format,
+                     const std::vector<PlyElement> &elements, const ModelLoadOptions &options, Geometry &geometry) {
+    auto &pool = core::ThreadPool::get_instance();
+    const unsigned char *end = file.data() + file.size();
+    const unsigned char *p = file.data() + body;
+    uint16_t probe = 1;
+    unsigned char first_byte;
+    std::memcpy(&first_byte, &probe, 1);
+    const bool swap = (format == PlyFormat::BinaryLittleEndian) != (first_byte == 1);
+
+    const PlyElement *vertices = nullptr;
+    std::size_t vertex_count = 0;
+    for (const PlyElement &element : elements) {
+        if (element.name == "vertex") {
+            if (element.size == 0)
+                throw std::runtime_error("vertices with list properties");
+            if (static_cast<std::size_t>(end - p) / element.size < element.count)
+                throw std::runtime_error("file ends inside the vertices");
+            PlyVertexLayout layout(element);
+            vertices = &element;
+            vertex_count = element.count;
+            allocate_ply_vertices(layout, vertex_count, geometry);
+            auto ranges = split_records(element.count);
+            const unsigned char *records = p;
+            pool.parallel_for(ranges.size(), [&](std::size_t r) {
+                std::vector<double> values(element.properties.size());
+                for (std::size_t v = ranges[r].first; v < ranges[r].second; ++v) {
+                    const unsigned char *record = records + v * element.size;
+                    for (std::size_t i = 0; i < values.size(); ++i)
+                        values[i] = read_ply_value(element.properties[i].type, record + element.properties[i].offset,
+                                                   swap);
+                    layout.store(values.data(), v, geometry, options.flip_uvs);
+                }
+            });
+            p += element.count * element.size;
+        } else if (element.name == "face") {
+            if (!vertices)
+                throw std::runtime_error("faces before vertices");
+            int index_property = element.find({"vertex_indices", "vertex_index"});
+            if (index_property < 0 || !element.properties[index_property].is_list())
+                throw std::runtime_error("faces without vertex indices");
+            // Try records of triangles, the usual case, which have a fixed size
+            std::size_t triangle_size = 0, index_offset = 0;
+            bool fixed = true;
+            for (std::size_t i = 0; i < element.properties.size(); ++i) {
+                const PlyProperty &property = element.properties[i];
+                if (static_cast<int>(i) == index_property) {
+                    index_offset = triangle_size;
+                    triangle_size += ply_type_size(property.count_type) + 3 * ply_type_size(property.type);
+                } else if (property.is_list()) {
+                    fixed = false;
+                } else {
+                    triangle_size += ply_type_size(property.type);
+                }
+            }
+            fixed = fixed && static_cast<std::size_t>(end - p) / triangle_size >= element.count;
+            std::atomic<bool> triangles{fixed};
+            if (fixed) {
+                const PlyProperty &property = element.properties[index_property];
+                std::size_t count_size = ply_type_size(property.count_type);
+                std::size_t index_size = ply_type_size(property.type);
+                geometry.indices.resize(element.count * 3);
+                auto ranges = split_records(element.count);
+                const unsigned char *records = p;
+                pool.parallel_for(ranges.size(), [&](std::size_t r) {
+                    for (std::size_t f = ranges[r].first; f < ranges[r].second && triangles; ++f) {
+                        const unsigned char *record = records + f * triangle_size + index_offset;
+                        if (read_ply_value(property.count_type, record, swap) != 3.0) {
+                            triangles = false;
+                            return;
+                        }
+                        for (std::size_t k = 0; k < 3; ++k) {
+                            double index = read_ply_value(property.type, record + count_size + k * index_size, swap);
+                            // Past a polygon the records are misaligned, leave the error to the slow path
+                            if (index < 0.0 || index >= static_cast<double>(vertex_count)) {
+                                triangles = false;
+                                return;
+                            }
+                            geometry.indices[f * 3 + k] = static_cast<unsigned int>(index);
+                        }
+                    }
+                });
+            }
+            if (triangles)
+                p += element.count * triangle_size;
+            else
+                p += read_binary_faces(p, end, element, index_property, swap, vertex_count, geometry);
+        } else if (element.size > 0) {
+            if (static_cast<std::size_t>(end - p) / element.size < element.count)
+                throw std::runtime_error("file ends inside " + element.name);
+            p += element.count * element.size;
+        } else {
+            p += skip_binary_element(p, end, element, swap);
+        }
+    }
+    if (!vertices)
+        throw std::runtime_error("no vertex element");
+}
+
+void read_ply(const MappedFile &file, const ModelLoadOptions &options, Geometry &geometry) {
+    PlyFormat format = PlyFormat::Ascii;
+    std::vector<PlyElement> elements;
+    std::size_t body = read_ply_header(file, format, elements);
+    if (format == PlyFormat::Ascii)
+        read_ascii_ply(file, body, elements, options, geometry);
+    else
+        read_binary_ply(file, body, format, elements, options, geometry);
+    if (geometry.indices.size() >= NO_INDEX)
+        throw std::runtime_error("too many indices for 32-bit indices");
+    if (geometry.normals.empty())
+        geometry.normals = generate_normals(geometry.positions, geometry.indices);
+}
+
+// Splits triangles [begin, end) of order at the median centroid until every range fits
+void split_range(std::vector<unsigned int> &order, const std::vector<glm::vec3> &centroids, std::size_t begin,
+                 std::size_t end, std::size_t limit, std::vector<std::pair<std::size_t, std::size_t>> &ranges) {
+    if (end - begin <= limit) {
+        ranges.emplace_back(begin, end);
+        return;
+    }
+    glm::vec3 min(std::numeric_limits<float>::max());
+    glm::vec3 max(-std::numeric_limits<float>::max());
+    for (std::size_t i = begin; i < end; ++i) {
+        min = glm::min(min, centroids[order[i]]);
+        max = glm::max(max, centroids[order[i]]);
+    }
+    glm::vec3 extent = max - min;
+    int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+    std::size_t middle = begin + (end - begin) / 2;
+    std::nth_element(order.begin() + begin, order.begin() + middle, order.begin() + end,
+                     [&](unsigned int a, unsigned int b) { return centroids[a][axis] < centroids[b][axis]; });
+    split_range(order, centroids, begin, middle, limit, ranges);
+    split_range(order, centroids, middle, end, limit, ranges);
+}
+
+} // namespace
+
+struct ScanLoader::Model {
+    //! @brief A mesh of the scan, referring to the model vertices.
+    struct Part {
+        uint32_t material = NO_INDEX;       //!< Material of every triangle, NO_INDEX for none
+        std::vector<unsigned int> vertices; //!< Model vertex of every part vertex, empty when they are the same
+        std::vector<unsigned int> indices;  //!< Triangle list over the part vertices
+        std::shared_ptr<scene::Mesh> mesh;  //!< The uploaded mesh, once built
+    };
+
+    std::string path;                                           //!< File path of the model
+    Geometry geometry;                                          //!< Vertices of every part, indices are moved out
+    std::vector<Part> parts;                                    //!< Meshes to build
+    std::size_t unbuilt = 0;                                    //!< Parts left to build, the last frees geometry
+    std::vector<MaterialData> materials;                        //!< OBJ materials, by id
+    std::vector<std::shared_ptr<scene::Material>> built;        //!< Built materials, by id
+    std::unordered_map<std::string, renderer::ImageData> images; //!< Decoded textures, by path
+};
+
+bool ScanLoader::handles(const std::string &fpath, const ModelLoadOptions &options) {
+    std::string extension = get_extension(fpath);
+    if (extension != ".obj" && extension != ".ply")
+        return false;
+    std::error_code error;
+    std::uintmax_t size = std::filesystem::file_size(fpath, error);
+    return !error && size >= options.scan_threshold;
+}
+
+std::shared_ptr<scene::Node> ScanLoader::load(const std::string &fpath, std::shared_ptr<renderer::Shader> shader,
+                                              const ModelLoadOptions &options) {
+    auto model = parse(fpath, options);
+    return model ? build(*model, shader, options) : nullptr;
+}
+
+std::shared_ptr<ScanLoader::Model> ScanLoader::parse(const std::string &fpath, const ModelLoadOptions &options) {
+    auto &pool = core::ThreadPool::get_instance();
+    auto model = std::make_shared<Model>();
+    model->path = fpath;
+    Geometry &geometry = model->geometry;
+    try {
+        MappedFile file;
+        if (!file.open(fpath))
+            throw std::runtime_error("cannot open the file");
+        std::string extension = get_extension(fpath);
+        if (extension == ".obj")
+            read_obj(fpath, file, options, geometry, model->materials);
+        else if (extension == ".ply")
+            read_ply(file, options, geometry);
+        else
+            throw std::runtime_error("not an OBJ or PLY file");
+    } catch (const std::exception &e) {
+        std::cerr << "ERROR: ScanLoader: could not read " << fpath << ": " << e.what() << std::endl;
+        return nullptr;
+    }
+
+    // Triangles grouped by material, then split in space
+    std::size_t triangle_count = geometry.indices.size() / 3;
+    bool split = options.scan_part_triangles > 0 && triangle_count > options.scan_part_triangles;
+    std::vector<unsigned int> order;
+    if (split || !geometry.materials.empty()) {
+        order.resize(triangle_count);
+        std::iota(order.begin(), order.end(), 0u);
+    }
+    std::vector<std::pair<std::size_t, std::size_t>> groups;
+    if (geometry.materials.empty()) {
+        if (triangle_count > 0)
+            groups.emplace_back(0, triangle_count);
+    } else {
+        std::stable_sort(order.begin(), order.end(),
+                         [&](unsigned int a, unsigned int b) { return geometry.materials[a] < geometry.materials[b]; });
+        for (std::size_t begin = 0, end = 0; begin < triangle_count; begin = end) {
+            for (end = begin; end < triangle_count &&
+                              geometry.materials[order[end]] == geometry.materials[order[begin]];)
+                ++end;
+            groups.emplace_back(begin, end);
+        }
+    }
+    std::vector<std::pair<std::size_t, std::size_t>> ranges;
+    if (split) {
+        std::vector<glm::vec3> centroids(triangle_count);
+        auto records = split_records(triangle_count);
+        pool.parallel_for(records.size(), [&](std::size_t r) {
+            for (std::size_t t = records[r].first; t < records[r].second; ++t)
+                centroids[t] = (geometry.positions[geometry.indices[t * 3]] +
+                                geometry.positions[geometry.indices[t * 3 + 1]] +
+                                geometry.positions[geometry.indices[t * 3 + 2]]) /
+                               3.0f;
+        });
+        for (const auto &group : groups)
+            split_range(order, centroids, group.first, group.second, options.scan_part_triangles, ranges);
+    } else {
+        ranges = groups;
+    }
+
+    // Every part numbers its own vertices, in the order the optimized triangles use them
+    model->parts.resize(ranges.size());
+    model->unbuilt = ranges.size();
+    if (ranges.size() == 1 && ranges[0].second - ranges[0].first == triangle_count) {
+        // A single part uses the model vertices and indices as they are, without a copy
+        Model::Part &part = model->parts[0];
+        if (!geometry.materials.empty())
+            part.material = geometry.materials[0];
+        part.indices = std::move(geometry.indices);
+        if (options.optimize_vertex_order) {
+            unsigned int vertex_count = static_cast<unsigned int>(geometry.positions.size());
+            part.indices = scene::MeshOptimizer::optimize_vertex_cache(part.indices, vertex_count);
+            std::vector<unsigned int> remap =
+                scene::MeshOptimizer::optimize_vertex_fetch_remap(part.indices, vertex_count);
+            // Vertices no triangle uses are left out
+            unsigned int used = 0;
+            for (unsigned int v : remap)
+                used += v != scene::MeshOptimizer::invalid;
+            part.vertices.resize(used);
+            for (std::size_t v = 0; v < remap.size(); ++v)
+                if (remap[v] != scene::MeshOptimizer::invalid)
+                    part.vertices[remap[v]] = static_cast<unsigned int>(v);
+        }
+        ranges.clear();
+    }
+    pool.parallel_for(ranges.size(), [&](std::size_t i) {
+        Model::Part &part = model->parts[i];
+        std::size_t begin = ranges[i].first, end = ranges[i].second;
+        if (!geometry.materials.empty())
+            part.material = geometry.materials[order[begin]];
+        part.indices.resize((end - begin) * 3);
+        for (std::size_t t = begin; t < end; ++t)
+            for (int k = 0; k < 3; ++k)
+                part.indices[(t - begin) * 3 + k] = geometry.indices[order[t] * 3 + k];
+        part.vertices = part.indices;
+        std::sort(part.vertices.begin(), part.vertices.end());
+        part.vertices.erase(std::unique(part.vertices.begin(), part.vertices.end()), part.vertices.end());
+        part.vertices.shrink_to_fit();
+        for (unsigned int &index : part.indices)
+            index = static_cast<unsigned int>(
+                std::lower_bound(part.vertices.begin(), part.vertices.end(), index) - part.vertices.begin());
+        if (!options.optimize_vertex_order)
+            return;
+        unsigned int vertex_count = static_cast<unsigned int>(part.vertices.size());
+        part.indices = scene::MeshOptimizer::optimize_vertex_cache(part.indices, vertex_count);
+        std::vector<unsigned int> remap = scene::MeshOptimizer::optimize_vertex_fetch_remap(part.indices, vertex_count);
+        std::vector<unsigned int> vertices(part.vertices.size());
+        for (std::size_t v = 0; v < remap.size(); ++v)
+            if (remap[v] != scene::MeshOptimizer::invalid)
+                vertices[remap[v]] = part.vertices[v];
+        part.vertices = std::move(vertices);
+    });
+    geometry.indices = {};
+    geometry.materials = {};
+
+    // Textures decode in parallel, uploading them is left to the render thread
+    std::vector<std::string> texture_paths;
+    for (const MaterialData &material : model->materials) {
+        if (!material.albedo_map.empty() && model->images.emplace(material.albedo_map, renderer::ImageData()).second)
+            texture_paths.push_back(material.albedo_map);
+    }
+    pool.parallel_for(texture_paths.size(), [&](std::size_t i) {
+        renderer::Texture::decode(texture_paths[i], model->images.at(texture_paths[i]));
+    });
+    model->built.resize(model->materials.size());
+
+    std::cout << "ScanLoader: Loading model from " << fpath << std::endl;
+    std::cout << "  Vertices: " << geometry.positions.size() << ", triangles: " << triangle_count << std::endl;
+    std::cout << "  Parts: " << model->parts.size() << ", materials: " << model->materials.size() << std::endl;
+    return model;
+}
+
+std::size_t ScanLoader::get_part_count(const Model &model) { return model.parts.size(); }
+
+std::size_t ScanLoader::get_upload_size(const Model &model, std::size_t part) {
+    const Model::Part &entry = model.parts[part];
+    std::size_t vertex_count = entry.vertices.empty() ? model.geometry.positions.size() : entry.vertices.size();
+    return vertex_count * sizeof(scene::Vertex) + entry.indices.size() * sizeof(unsigned int);
+}
+
+void ScanLoader::build_part(Model &model, std::size_t part, std::shared_ptr<renderer::Shader> shader,
+                            const ModelLoadOptions &options) {
+    Model::Part &entry = model.parts[part];
+    Geometry &geometry = model.geometry;
+    // The last part built frees every source array once copied, so the peak stays close to the mesh size
+    bool last = --model.unbuilt == 0;
+    std::vector<scene::Vertex> vertices(entry.vertices.empty() ? geometry.positions.size() : entry.vertices.size());
+    auto source = [&entry](std::size_t i) { return entry.vertices.empty() ? i : entry.vertices[i]; };
+    auto copy = [&](auto &array, auto assign) {
+        if (array.empty())
+            return;
+        for (std::size_t i = 0; i < vertices.size(); ++i)
+            assign(vertices[i], array[source(i)]);
+        if (last)
+            array = {};
+    };
+    copy(geometry.positions, [](scene::Vertex &vertex, const glm::vec3 &value) { vertex.position = value; });
+    copy(geometry.normals, [](scene::Vertex &vertex, const glm::vec3 &value) { vertex.normal = value; });
+    copy(geometry.colors, [](scene::Vertex &vertex, uint32_t value) { vertex.color = glm::unpackUnorm4x8(value); });
+    copy(geometry.uvs, [](scene::Vertex &vertex, const glm::vec2 &value) { vertex.uvs = value; });
+    entry.vertices = {};
+    auto mesh = std::make_shared<scene::Mesh>(std::move(vertices), std::move(entry.indices), shader,
+                                              options.geometry_pool, options.pack_vertices);
+    entry.indices = {};
+    if (options.depth_stream)
+        mesh->create_depth_stream();
+    mesh->set_residency(options.residency);
+    if (entry.material != NO_INDEX) {
+        // Parts of the same material share the object, which also keeps them batched together
+        auto &material = model.built[entry.material];
+        if (!material) {
+            const MaterialData &data = model.materials[entry.material];
+            material = std::make_shared<scene::Material>(data.name);
+            material->set_albedo(data.albedo);
+            material->set_emissive(data.emissive);
+            if (!data.albedo_map.empty()) {
+                auto &tex_lib = TextureLibrary::get_instance();
+                auto texture = tex_lib.get(data.albedo_map);
+                auto image = model.images.find(data.albedo_map);
+                if (!texture && image != model.images.end() && image->second.is_valid())
+                    texture = tex_lib.insert(data.albedo_map, tex_lib.create(data.albedo_map, image->second));
+                if (image != model.images.end())
+                    model.images.erase(image);
+                material->set_albedo_map(texture);
+            }
+        }
+        mesh->set_material(material);
+    }
+    entry.mesh = mesh;
+}
+
+std::shared_ptr<scene::Node> ScanLoader::assemble(Model &model, const ModelLoadOptions &options) {
+    std::string name = std::filesystem::path(model.path).filename().string();
+    auto root = std::make_shared<scene::Node>(name);
+    if (model.parts.size() == 1) {
+        root->set_mesh(model.parts[0].mesh);
+    } else {
+        for (std::size_t i = 0; i < model.parts.size(); ++i) {
+            auto part_node = std::make_shared<scene::Node>(name + "_part_" + std::to_string(i));
+            part_node->set_mesh(model.parts[i].mesh);
+            root->add_child(part_node);
+        }
+    }
+    if (options.scale != 1.0f)
+        root->set_scale(glm::vec3(options.scale));
+    // The last reference to the model may be dropped by a worker, keep every GL object out of it
+    model.geometry = Geometry();
+    model.parts.clear();
+    model.built.clear();
+    model.images.clear();
+    std::cout << "ScanLoader: Finished loading model " << model.path << std::endl;
+    return root;
+}
+
+std::shared_ptr<scene::Node> ScanLoader::build(Model &model, std::shared_ptr<renderer::Shader> shader,
+                                               const ModelLoadOptions &options) {
+    for (std::size_t i = 0; i < model.parts.size(); ++i)
+        build_part(model, i, shader, options);
+    return assemble(model, options);
+}
+
+} // namespace assets
+
+} // namespace lmgl
@@ -1,36 +1,85 @@
 #include "lmgl/assets/texture_library.hpp"
+#include "lmgl/assets/upload_queue.hpp"
+#include "lmgl/core/thread_pool.hpp"
 #include "lmgl/renderer/texture.hpp"
+#include "lmgl/renderer/texture_streamer.hpp"
 
 #include <iostream>
+#include <utility>
 
 namespace lmgl {
 
 namespace assets {
 
+TextureLibrary::TextureLibrary()
+    : m_textures([](const renderer::Texture &texture) { return texture.get_memory_usage(); }) {
+    m_textures.set_budget(DEFAULT_BUDGET);
+}
+
 TextureLibrary &TextureLibrary::get_instance() {
     static TextureLibrary instance;
     return instance;
 }
 
 std::shared_ptr<renderer::Texture> TextureLibrary::load(const std::string &fpath) {
-    auto it = m_textures.find(fpath);
-    if (it != m_textures.end())
-        return it->second;
-    auto texture = std::make_shared<renderer::Texture>(fpath);
-    m_textures[fpath] = texture;
+    if (auto cached = m_textures.find(fpath))
+        return cached;
+    std::shared_ptr<renderer::Texture> texture;
+    if (m_streaming)
+        texture = renderer::TextureStreamer::get_instance().load(fpath);
+    // Files the streamer cannot decode get the regular error texture
+    if (!texture)
+        texture = std::make_shared<renderer::Texture>(fpath);
+    texture = m_textures.insert(fpath, std::move(texture));
     std::cout << "Loaded texture: " << fpath << std::endl;
     return texture;
 }
 
-bool TextureLibrary::exists(const std::string &fpath) const { return m_textures.find(fpath) != m_textures.end(); }
+std::shared_ptr<renderer::Texture> TextureLibrary::load_async(const std::string &fpath, bool flip_vertically) {
+    if (auto cached = m_textures.find(fpath))
+        return cached;
+    auto texture = m_textures.insert(fpath, renderer::Texture::create_placeholder(fpath));
+    ++m_pending;
+    core::ThreadPool::get_instance().submit([this, texture, fpath, flip_vertically]() mutable {
+        auto image = std::make_shared<renderer::ImageData>();
+        renderer::Texture::decode(fpath, *image, flip_vertically);
+        // A failed decode keeps the placeholder, the task still runs to settle the count.
+        // The texture moves to the render thread task, so that it is never released here.
+        UploadQueue::get_instance().push(
+            [this, texture = std::move(texture), fpath, image]() {
+                texture->set_image(*image);
+                --m_pending;
+                // The placeholder was measured at a single pixel
+                m_textures.update_size(fpath);
+                m_textures.trim();
+                if (!texture->is_placeholder())
+                    std::cout << "Loaded texture: " << fpath << std::endl;
+            },
+            image->size());
+    });
+    return texture;
+}
+
+std::shared_ptr<renderer::Texture> TextureLibrary::insert(const std::string &fpath,
+                                                          std::shared_ptr<renderer::Texture> texture) {
+    return m_textures.insert(fpath, std::move(texture));
+}
 
-std::shared_ptr<renderer::Texture> TextureLibrary::get(const std::string &fpath) const {
-    auto it = m_textures.find(fpath);
-    if (it != m_textures.end())
-        return it->second;
-    return nullptr;
+std::shared_ptr<renderer::Texture> TextureLibrary::create(const std::string &fpath, const renderer::ImageData &image,
+                                                          bool from_file) const {
+    if (m_streaming) {
+        auto &streamer = renderer::TextureStreamer::get_instance();
+        auto texture = from_file ? streamer.add_file(fpath, image) : streamer.add(fpath, image);
+        if (texture)
+            return texture;
+    }
+    return std::make_shared<renderer::Texture>(fpath, image);
 }
 
+bool TextureLibrary::exists(const std::string &fpath) const { return m_textures.contains(fpath); }
+
+std::shared_ptr<renderer::Texture> TextureLibrary::get(const std::string &fpath) const { return m_textures.get(fpath); }
+
 void TextureLibrary::clear() { m_textures.clear(); }
 
 } // namespace assets
@@ -0,0 +1,83 @@
+#include "lmgl/assets/upload_queue.hpp"
+
+#include <chrono>
+#include <utility>
+
+namespace lmgl {
+
+namespace assets {
+
+UploadQueue &UploadQueue::get_instance() {
+    static UploadQueue instance;
+    return instance;
+}
+
+void UploadQueue::push(std::function<void()> task, std::size_t bytes) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_tasks.push_back({std::move(task), bytes});
+}
+
+bool UploadQueue::pop(Task &task) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_tasks.empty())
+        return false;
+    task = std::move(m_tasks.front());
+    m_tasks.pop_front();
+    return true;
+}
+
+std::size_t UploadQueue::process() {
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point start = Clock::now();
+    const auto budget = std::chrono::duration<double, std::milli>(m_time_budget);
+    std::size_t count = 0;
+    std::size_t bytes = 0;
+    Task task;
+    while (pop(task)) {
+        task.run();
+        // Release what the task captured here, on the render thread
+        task.run = nullptr;
+        ++count;
+        bytes += task.bytes;
+        if (Clock::now() - start >= budget || (m_byte_budget > 0 && bytes >= m_byte_budget))
+            break;
+        // Stop before a task that would overshoot the byte budget
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_byte_budget > 0 && !m_tasks.empty() && bytes + m_tasks.front().bytes > m_byte_budget)
+            break;
+    }
+    return count;
+}
+
+std::size_t UploadQueue::flush() {
+    std::size_t count = 0;
+    Task task;
+    while (pop(task)) {
+        task.run();
+        task.run = nullptr;
+        ++count;
+    }
+    return count;
+}
+
+void UploadQueue::set_budget(double milliseconds, std::size_t bytes) {
+    m_time_budget = milliseconds;
+    m_byte_budget = bytes;
+}
+
+std::size_t UploadQueue::get_pending() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_tasks.size();
+}
+
+void UploadQueue::clear() {
+    std::deque<Task> dropped;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        dropped.swap(m_tasks);
+    }
+}
+
+} // namespace assets
+
+} // namespace lmgl
@@ -1,4 +1,8 @@
 #include "lmgl/core/engine.hpp"
+#include "lmgl/assets/upload_queue.hpp"
+#include "lmgl/core/thread_pool.hpp"
+#include "lmgl/renderer/capabilities.hpp"
+#include "lmgl/renderer/texture_streamer.hpp"
 #include "GLFW/glfw3.h"
 
 #include <iostream>
@@ -35,6 +39,7 @@ bool Engine::init(int w, int h, std::string title, bool resizable, bool vsync) {
         glfwTerminate();
         return false;
     }
+    renderer::Capabilities::get_instance().detect();
     m_width = w;
     m_height = h;
     glfwSetWindowUserPointer(m_window, this);
@@ -73,6 +78,10 @@ void Engine::run(std::function<void(float)> update_callback) {
         update_input_state();
         glfwPollEvents();
         glViewport(0, 0, m_width, m_height);
+        // Finish a slice of the assets streaming in, within the per-frame budget
+        assets::UploadQueue::get_instance().process();
+        // Move mip levels in and out for what the last frame drew
+        renderer::TextureStreamer::get_instance().update();
         update_callback(m_delta_time);
         glfwSwapBuffers(m_window);
 
@@ -85,6 +94,9 @@ void Engine::run(std::function<void(float)> update_callback) {
 }
 
 void Engine::free() {
+    // Loads in flight hold meshes and textures, release them while the context is still alive
+    ThreadPool::get_instance().wait_idle();
+    assets::UploadQueue::get_instance().clear();
     if (m_window) {
         glfwDestroyWindow(m_window);
         m_window = nullptr;
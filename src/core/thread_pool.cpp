@@ -0,0 +1,122 @@
+#include "lmgl/core/thread_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <iostream>
+#include <utility>
+
+namespace lmgl {
+
+namespace core {
+
+ThreadPool &ThreadPool::get_instance() {
+    static ThreadPool instance;
+    return instance;
+}
+
+ThreadPool::ThreadPool(unsigned int thread_count) {
+    if (thread_count == 0) {
+        // Leave a hardware thread to the render loop
+        unsigned int hardware = std::thread::hardware_concurrency();
+        thread_count = std::max(1u, hardware > 1 ? hardware - 1 : 1u);
+    }
+    m_threads.reserve(thread_count);
+    for (unsigned int i = 0; i < thread_count; ++i)
+        m_threads.emplace_back(&ThreadPool::worker, this);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_task_available.notify_all();
+    for (auto &thread : m_threads)
+        thread.join();
+}
+
+void ThreadPool::enqueue(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_tasks.push_back(std::move(task));
+    }
+    m_task_available.notify_one();
+}
+
+void ThreadPool::parallel_for(std::size_t count, const std::function<void(std::size_t)> &body) {
+    if (count == 0)
+        return;
+    struct Loop {
+        std::atomic<std::size_t> next{0};
+        std::size_t done = 0;
+        std::exception_ptr error;
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+    auto loop = std::make_shared<Loop>();
+    // Helpers starting after every index is claimed return without touching the body
+    auto run = [loop, &body, count]() {
+        for (std::size_t i = loop->next.fetch_add(1); i < count; i = loop->next.fetch_add(1)) {
+            std::exception_ptr error;
+            try {
+                body(i);
+            } catch (...) {
+                error = std::current_exception();
+            }
+            std::lock_guard<std::mutex> lock(loop->mutex);
+            if (error && !loop->error)
+                loop->error = error;
+            if (++loop->done == count)
+                loop->finished.notify_all();
+        }
+    };
+    std::size_t helpers = std::min<std::size_t>(count - 1, m_threads.size());
+    for (std::size_t i = 0; i < helpers; ++i)
+        enqueue(run);
+    run();
+    std::unique_lock<std::mutex> lock(loop->mutex);
+    loop->finished.wait(lock, [&loop, count]() { return loop->done == count; });
+    if (loop->error)
+        std::rethrow_exception(loop->error);
+}
+
+void ThreadPool::wait_idle() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_task_done.wait(lock, [this]() { return m_tasks.empty() && m_active == 0; });
+}
+
+std::size_t ThreadPool::get_pending() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_tasks.size();
+}
+
+void ThreadPool::worker() {
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_task_available.wait(lock, [this]() { return m_stopping || !m_tasks.empty(); });
+            if (m_tasks.empty())
+                return;
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+            ++m_active;
+        }
+        // submit() routes exceptions to the future, this only guards raw tasks
+        try {
+            task();
+        } catch (const std::exception &e) {
+            std::cerr << "ERROR: ThreadPool: task threw: " << e.what() << std::endl;
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            --m_active;
+        }
+        m_task_done.notify_all();
+    }
+}
+
+} // namespace core
+
+} // namespace lmgl
@@ -0,0 +1,405 @@
+#include "lmgl/renderer/block_encoder.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+namespace lmgl {
+
+namespace renderer {
+
+namespace {
+
+// BC7 mode 6 interpolation weights for 4-bit indices
+constexpr int BC7_WEIGHTS[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+// Writes bit fields into a block, least significant bit first
+class BitWriter {
+  public:
+    explicit BitWriter(unsigned char *out, std::size_t size) : m_out(out) { std::memset(out, 0, size); }
+
+    void write(uint32_t value, int bits) {
+        for (int i = 0; i < bits; ++i, ++m_position) {
+            if (value >> i & 1u)
+                m_out[m_position / 8] |= static_cast<unsigned char>(1u << (m_position % 8));
+        }
+    }
+
+  private:
+    unsigned char *m_out;
+    int m_position = 0;
+};
+
+// Principal axis of the first N channels of a block, by power iteration
+template <int N> void principal_axis(const unsigned char *pixels, float (&mean)[N], float (&axis)[N]) {
+    for (int c = 0; c < N; ++c)
+        mean[c] = 0.0f;
+    for (int i = 0; i < 16; ++i) {
+        for (int c = 0; c < N; ++c)
+            mean[c] += pixels[i * 4 + c];
+    }
+    for (int c = 0; c < N; ++c)
+        mean[c] /= 16.0f;
+    float covariance[N][N] = {};
+    for (int i = 0; i < 16; ++i) {
+        for (int a = 0; a < N; ++a) {
+            for (int b = 0; b < N; ++b)
+                covariance[a][b] += (pixels[i * 4 + a] - mean[a]) * (pixels[i * 4 + b] - mean[b]);
+        }
+    }
+    for (int c = 0; c < N; ++c)
+        axis[c] = 1.0f;
+    for (int iteration = 0; iteration < 8; ++iteration) {
+        float next[N] = {};
+        float length = 0.0f;
+        for (int a = 0; a < N; ++a) {
+            for (int b = 0; b < N; ++b)
+                next[a] += covariance[a][b] * axis[b];
+            length = std::max(length, std::fabs(next[a]));
+        }
+        // Flat block, any axis will do
+        if (length < 1e-6f)
+            return;
+        for (int c = 0; c < N; ++c)
+            axis[c] = next[c] / length;
+    }
+}
+
+// Fits the endpoints of a block along its principal axis
+template <int N> void fit_endpoints(const unsigned char *pixels, float (&low)[N], float (&high)[N]) {
+    float mean[N];
+    float axis[N];
+    principal_axis(pixels, mean, axis);
+    float t_min = 0.0f;
+    float t_max = 0.0f;
+    for (int i = 0; i < 16; ++i) {
+        float t = 0.0f;
+        for (int c = 0; c < N; ++c)
+            t += (pixels[i * 4 + c] - mean[c]) * axis[c];
+        t_min = std::min(t_min, t);
+        t_max = std::max(t_max, t);
+    }
+    // Inset the range slightly, extremes are rarely worth exact representation
+    float inset = (t_max - t_min) / 16.0f;
+    t_min += inset;
+    t_max -= inset;
+    for (int c = 0; c < N; ++c) {
+        low[c] = std::clamp(mean[c] + axis[c] * t_min, 0.0f, 255.0f);
+        high[c] = std::clamp(mean[c] + axis[c] * t_max, 0.0f, 255.0f);
+    }
+}
+
+uint16_t to_565(const float (&color)[3]) {
+    int r = static_cast<int>(color[0] * 31.0f / 255.0f + 0.5f);
+    int g = static_cast<int>(color[1] * 63.0f / 255.0f + 0.5f);
+    int b = static_cast<int>(color[2] * 31.0f / 255.0f + 0.5f);
+    return static_cast<uint16_t>(r << 11 | g << 5 | b);
+}
+
+void from_565(uint16_t value, int (&color)[3]) {
+    int r = value >> 11 & 31;
+    int g = value >> 5 & 63;
+    int b = value & 31;
+    color[0] = r << 3 | r >> 2;
+    color[1] = g << 2 | g >> 4;
+    color[2] = b << 3 | b >> 2;
+}
+
+// BC1 color block in four-color mode, which BC3 also uses for its color
+void encode_bc1(const unsigned char *pixels, unsigned char *block) {
+    float low[3];
+    float high[3];
+    fit_endpoints(pixels, low, high);
+    uint16_t c0 = to_565(high);
+    uint16_t c1 = to_565(low);
+    // Four-color mode needs c0 > c1
+    if (c0 < c1)
+        std::swap(c0, c1);
+    int palette[4][3];
+    from_565(c0, palette[0]);
+    from_565(c1, palette[1]);
+    for (int c = 0; c < 3; ++c) {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+    uint32_t indices = 0;
+    // Equal endpoints select three-color mode, where index 0 is still c0
+    if (c0 != c1) {
+        for (int i = 0; i < 16; ++i) {
+            int best = 0;
+            int best_error = 1 << 30;
+            for (int k = 0; k < 4; ++k) {
+                int error = 0;
+                for (int c = 0; c < 3; ++c) {
+                    int d = pixels[i * 4 + c] - palette[k][c];
+                    error += d * d;
+                }
+                if (error < best_error) {
+                    best_error = error;
+                    best = k;
+                }
+            }
+            indices |= static_cast<uint32_t>(best) << (2 * i);
+        }
+    }
+    block[0] = static_cast<unsigned char>(c0 & 0xFF);
+    block[1] = static_cast<unsigned char>(c0 >> 8);
+    block[2] = static_cast<unsigned char>(c1 & 0xFF);
+    block[3] = static_cast<unsigned char>(c1 >> 8);
+    for (int i = 0; i < 4; ++i)
+        block[4 + i] = static_cast<unsigned char>(indices >> (8 * i) & 0xFF);
+}
+
+// BC4 block of one channel of the pixels, in eight-value mode
+void encode_bc4(const unsigned char *pixels, int channel, unsigned char *block) {
+    int r0 = 0;
+    int r1 = 255;
+    for (int i = 0; i < 16; ++i) {
+        r0 = std::max(r0, static_cast<int>(pixels[i * 4 + channel]));
+        r1 = std::min(r1, static_cast<int>(pixels[i * 4 + channel]));
+    }
+    int palette[8] = {r0, r1};
+    for (int k = 2; k < 8; ++k)
+        palette[k] = ((8 - k) * r0 + (k - 1) * r1) / 7;
+    uint64_t indices = 0;
+    // Equal endpoints select six-value mode, where index 0 is still r0
+    if (r0 != r1) {
+        for (int i = 0; i < 16; ++i) {
+            int value = pixels[i * 4 + channel];
+            int best = 0;
+            for (int k = 1; k < 8; ++k) {
+                if (std::abs(value - palette[k]) < std::abs(value - palette[best]))
+                    best = k;
+            }
+            indices |= static_cast<uint64_t>(best) << (3 * i);
+        }
+    }
+    block[0] = static_cast<unsigned char>(r0);
+    block[1] = static_cast<unsigned char>(r1);
+    for (int i = 0; i < 6; ++i)
+        block[2 + i] = static_cast<unsigned char>(indices >> (8 * i) & 0xFF);
+}
+
+// Quantizes a BC7 mode 6 endpoint to 7 bits per channel plus a shared p-bit
+void quantize_bc7_endpoint(const float (&color)[4], int (&q)[4], int &p_bit) {
+    int best_error = 1 << 30;
+    for (int p = 0; p < 2; ++p) {
+        int candidate[4];
+        int error = 0;
+        for (int c = 0; c < 4; ++c) {
+            candidate[c] = std::clamp(static_cast<int>(std::lround((color[c] - p) / 2.0f)), 0, 127);
+            int d = static_cast<int>(color[c] + 0.5f) - (candidate[c] << 1 | p);
+            error += d * d;
+        }
+        if (error < best_error) {
+            best_error = error;
+            p_bit = p;
+            std::copy(candidate, candidate + 4, q);
+        }
+    }
+}
+
+// BC7 block in mode 6
+void encode_bc7(const unsigned char *pixels, unsigned char *block) {
+    float low[4];
+    float high[4];
+    fit_endpoints(pixels, low, high);
+    int q[2][4];
+    int p[2];
+    quantize_bc7_endpoint(low, q[0], p[0]);
+    quantize_bc7_endpoint(high, q[1], p[1]);
+    int endpoints[2][4];
+    for (int e = 0; e < 2; ++e) {
+        for (int c = 0; c < 4; ++c)
+            endpoints[e][c] = q[e][c] << 1 | p[e];
+    }
+    int palette[16][4];
+    for (int k = 0; k < 16; ++k) {
+        for (int c = 0; c < 4; ++c)
+            palette[k][c] = ((64 - BC7_WEIGHTS[k]) * endpoints[0][c] + BC7_WEIGHTS[k] * endpoints[1][c] + 32) >> 6;
+    }
+    int indices[16];
+    for (int i = 0; i < 16; ++i) {
+        int best_error = 1 << 30;
+        for (int k = 0; k < 16; ++k) {
+            int error = 0;
+            for (int c = 0; c < 4; ++c) {
+                int d = pixels[i * 4 + c] - palette[k][c];
+                error += d * d;
+            }
+            if (error < best_error) {
+                best_error = error;
+                indices[i] = k;
+            }
+        }
+    }
+    // The anchor index is stored without its top bit, swap the endpoints to clear it
+    if (indices[0] & 8) {
+        std::swap(q[0], q[1]);
+        std::swap(p[0], p[1]);
+        for (int &index : indices)
+            index = 15 - index;
+    }
+    BitWriter writer(block, 16);
+    writer.write(1u << 6, 7);
+    for (int c = 0; c < 4; ++c) {
+        writer.write(static_cast<uint32_t>(q[0][c]), 7);
+        writer.write(static_cast<uint32_t>(q[1][c]), 7);
+    }
+    writer.write(static_cast<uint32_t>(p[0]), 1);
+    writer.write(static_cast<uint32_t>(p[1]), 1);
+    for (int i = 0; i < 16; ++i)
+        writer.write(static_cast<uint32_t>(indices[i]), i == 0 ? 3 : 4);
+}
+
+// Expands any channel count to RGBA8
+std::vector<unsigned char> to_rgba(const ImageData &image) {
+    std::size_t count = static_cast<std::size_t>(image.width) * static_cast<std::size_t>(image.height);
+    std::vector<unsigned char> rgba(count * 4);
+    const unsigned char *src = image.pixels.get();
+    for (std::size_t i = 0; i < count; ++i) {
+        const unsigned char *pixel = src + i * static_cast<std::size_t>(image.channels);
+        unsigned char *out = rgba.data() + i * 4;
+        if (image.channels >= 3) {
+            out[0] = pixel[0];
+            out[1] = pixel[1];
+            out[2] = pixel[2];
+            out[3] = image.channels == 4 ? pixel[3] : 255;
+        } else {
+            out[0] = out[1] = out[2] = pixel[0];
+            out[3] = image.channels == 2 ? pixel[1] : 255;
+        }
+    }
+    return rgba;
+}
+
+// Halves an RGBA8 image with a box filter, clamping at odd edges
+std::vector<unsigned char> downsample(const std::vector<unsigned char> &rgba, int width, int height) {
+    int next_width = std::max(1, width / 2);
+    int next_height = std::max(1, height / 2);
+    std::vector<unsigned char> next(static_cast<std::size_t>(next_width) * next_height * 4);
+    for (int y = 0; y < next_height; ++y) {
+        int y0 = std::min(2 * y, height - 1);
+        int y1 = std::min(2 * y + 1, height - 1);
+        for (int x = 0; x < next_width; ++x) {
+            int x0 = std::min(2 * x, width - 1);
+            int x1 = std::min(2 * x + 1, width - 1);
+            const unsigned char *p00 = rgba.data() + (static_cast<std::size_t>(y0) * width + x0) * 4;
+            const unsigned char *p01 = rgba.data() + (static_cast<std::size_t>(y0) * width + x1) * 4;
+            const unsigned char *p10 = rgba.data() + (static_cast<std::size_t>(y1) * width + x0) * 4;
+            const unsigned char *p11 = rgba.data() + (static_cast<std::size_t>(y1) * width + x1) * 4;
+            unsigned char *out = next.data() + (static_cast<std::size_t>(y) * next_width + x) * 4;
+            for (int c = 0; c < 4; ++c)
+                out[c] = static_cast<unsigned char>((p00[c] + p01[c] + p10[c] + p11[c] + 2) / 4);
+        }
+    }
+    return next;
+}
+
+CompressedLevel encode_level(const std::vector<unsigned char> &rgba, int width, int height, BlockFormat format) {
+    CompressedLevel level;
+    level.width = width;
+    level.height = height;
+    level.data.resize(TextureContainer::get_level_size(format, width, height));
+    std::size_t block_size = TextureContainer::get_block_size(format);
+    unsigned char *out = level.data.data();
+    unsigned char pixels[64];
+    for (int by = 0; by < height; by += 4) {
+        for (int bx = 0; bx < width; bx += 4) {
+            // Partial blocks repeat the edge pixels
+            for (int i = 0; i < 16; ++i) {
+                int x = std::min(bx + i % 4, width - 1);
+                int y = std::min(by + i / 4, height - 1);
+                std::memcpy(pixels + i * 4, rgba.data() + (static_cast<std::size_t>(y) * width + x) * 4, 4);
+            }
+            BlockEncoder::encode_block(pixels, format, out);
+            out += block_size;
+        }
+    }
+    return level;
+}
+
+} // namespace
+
+void BlockEncoder::encode_block(const unsigned char *pixels, BlockFormat format, unsigned char *block) {
+    switch (format) {
+    case BlockFormat::BC1:
+        encode_bc1(pixels, block);
+        break;
+    case BlockFormat::BC3:
+        encode_bc4(pixels, 3, block);
+        encode_bc1(pixels, block + 8);
+        break;
+    case BlockFormat::BC4:
+        encode_bc4(pixels, 0, block);
+        break;
+    case BlockFormat::BC5:
+        encode_bc4(pixels, 0, block);
+        encode_bc4(pixels, 1, block + 8);
+        break;
+    case BlockFormat::BC7:
+        encode_bc7(pixels, block);
+        break;
+    }
+}
+
+bool BlockEncoder::encode(const ImageData &image, BlockFormat format, CompressedImage &compressed, bool mipmaps) {
+    if (!image.pixels || image.width <= 0 || image.height <= 0 || image.channels < 1 || image.channels > 4)
+        return false;
+    CompressedImage result;
+    result.format = format;
+    std::vector<unsigned char> rgba = to_rgba(image);
+    int width = image.width;
+    int height = image.height;
+    for (;;) {
+        result.levels.push_back(encode_level(rgba, width, height, format));
+        if (!mipmaps || (width == 1 && height == 1))
+            break;
+        rgba = downsample(rgba, width, height);
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+    }
+    compressed = std::move(result);
+    return true;
+}
+
+bool BlockEncoder::build_mip_chain(const ImageData &image, std::vector<CompressedLevel> &levels) {
+    if (!image.pixels || image.width <= 0 || image.height <= 0 || image.channels < 1 || image.channels > 4)
+        return false;
+    levels.clear();
+    CompressedLevel level;
+    level.width = image.width;
+    level.height = image.height;
+    level.data = to_rgba(image);
+    for (;;) {
+        levels.push_back(level);
+        if (level.width == 1 && level.height == 1)
+            break;
+        level.data = downsample(level.data, level.width, level.height);
+        level.width = std::max(1, level.width / 2);
+        level.height = std::max(1, level.height / 2);
+    }
+    return true;
+}
+
+bool BlockEncoder::convert(const std::string &source_path, const std::string &dds_path, BlockFormat format,
+                           bool mipmaps) {
+    ImageData image;
+    if (!Texture::decode(source_path, image) || !image.pixels)
+        return false;
+    CompressedImage compressed;
+    if (!encode(image, format, compressed, mipmaps))
+        return false;
+    if (!TextureContainer::save_dds(dds_path, compressed))
+        return false;
+    std::cout << "BlockEncoder: " << source_path << " -> " << dds_path << " (" << image.size() << " -> "
+              << compressed.size() << " bytes)" << std::endl;
+    return true;
+}
+
+} // namespace renderer
+
+} // namespace lmgl
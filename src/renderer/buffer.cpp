@@ -1,49 +1,68 @@
 #include "lmgl/renderer/buffer.hpp"
+#include "lmgl/renderer/capabilities.hpp"
 
 #include <glad/glad.h>
 
 #include <cstddef>
+#include <cstring>
+#include <iostream>
+
+// Buffer storage flags are not part of the GL 4.1 loader
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
 
 namespace lmgl {
 
 namespace renderer {
 
-static unsigned int shader_data_type_size(ShaderDataType type) {
-    switch (type) {
-    case ShaderDataType::Float:  return 4;
-    case ShaderDataType::Float2: return 4 * 2;
-    case ShaderDataType::Float3: return 4 * 3;
-    case ShaderDataType::Float4: return 4 * 4;
-    case ShaderDataType::Mat3:   return 4 * 3 * 3;
-    case ShaderDataType::Mat4:   return 4 * 4 * 4;
-    case ShaderDataType::Int:    return 4;
-    case ShaderDataType::Int2:   return 4 * 2;
-    case ShaderDataType::Int3:   return 4 * 3;
-    case ShaderDataType::Int4:   return 4 * 4;
-    case ShaderDataType::Bool:   return 1;
-    default:                     return 0;
-    }
-}
-
 // BufferElement
 
-BufferElement::BufferElement(ShaderDataType type, const std::string &name, bool normalized)
-    : name(name), type(type), size(shader_data_type_size(type)), offset(0), normalized(normalized) {}
+BufferElement::BufferElement(ShaderDataType type, const std::string &name, bool normalized, int location)
+    : name(name), type(type), size(shader_data_type_size(type)), offset(0), normalized(normalized),
+      location(location) {}
 
 unsigned int BufferElement::get_component_count() const {
     switch (type) {
-    case ShaderDataType::Float:  return 1;
-    case ShaderDataType::Float2: return 2;
-    case ShaderDataType::Float3: return 3;
-    case ShaderDataType::Float4: return 4;
-    case ShaderDataType::Mat3:   return 3 * 3;
-    case ShaderDataType::Mat4:   return 4 * 4;
-    case ShaderDataType::Int:    return 1;
-    case ShaderDataType::Int2:   return 2;
-    case ShaderDataType::Int3:   return 3;
-    case ShaderDataType::Int4:   return 4;
-    case ShaderDataType::Bool:   return 1;
-    default:                     return 0;
+    case ShaderDataType::Float:         return 1;
+    case ShaderDataType::Float2:        return 2;
+    case ShaderDataType::Float3:        return 3;
+    case ShaderDataType::Float4:        return 4;
+    case ShaderDataType::Mat3:          return 3 * 3;
+    case ShaderDataType::Mat4:          return 4 * 4;
+    case ShaderDataType::Int:           return 1;
+    case ShaderDataType::Int2:          return 2;
+    case ShaderDataType::Int3:          return 3;
+    case ShaderDataType::Int4:          return 4;
+    case ShaderDataType::Bool:          return 1;
+    case ShaderDataType::Half2:         return 2;
+    case ShaderDataType::Half4:         return 4;
+    case ShaderDataType::Byte4:         return 4;
+    case ShaderDataType::UByte4:        return 4;
+    case ShaderDataType::UByte4I:       return 4;
+    case ShaderDataType::Short2:        return 2;
+    case ShaderDataType::Short4:        return 4;
+    case ShaderDataType::UShort2:       return 2;
+    case ShaderDataType::UShort4:       return 4;
+    case ShaderDataType::Int2_10_10_10: return 4;
+    default:                            return 0;
+    }
+}
+
+bool BufferElement::is_integer() const {
+    switch (type) {
+    case ShaderDataType::Int:
+    case ShaderDataType::Int2:
+    case ShaderDataType::Int3:
+    case ShaderDataType::Int4:
+    case ShaderDataType::Bool:
+    case ShaderDataType::UByte4I:
+        return true;
+    default:
+        return false;
     }
 }
 
@@ -53,6 +72,9 @@ BufferLayout::BufferLayout(const std::initializer_list<BufferElement> &elements)
     calculate_offsets_and_stride();
 }
 
+BufferLayout::BufferLayout(const std::vector<BufferElement> &elements, unsigned int stride)
+    : m_elements(elements), m_stride(stride) {}
+
 std::vector<BufferElement>::const_iterator BufferLayout::begin() const { return m_elements.begin(); }
 
 std::vector<BufferElement>::const_iterator BufferLayout::end() const { return m_elements.end(); }
@@ -85,9 +107,14 @@ void VertexBuffer::bind() const { glBindBuffer(GL_ARRAY_BUFFER, m_renderer_id);
 
 void VertexBuffer::unbind() const { glBindBuffer(GL_ARRAY_BUFFER, 0); }
 
-void VertexBuffer::set_data(const void *data, unsigned int size) {
+void VertexBuffer::set_data(const void *data, unsigned int size, unsigned int offset) {
     glBindBuffer(GL_ARRAY_BUFFER, m_renderer_id);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, size, data);
+    glBufferSubData(GL_ARRAY_BUFFER, offset, size, data);
+}
+
+void VertexBuffer::reallocate(const void *data, unsigned int size) {
+    glBindBuffer(GL_ARRAY_BUFFER, m_renderer_id);
+    glBufferData(GL_ARRAY_BUFFER, size, data, GL_STREAM_DRAW);
 }
 
 void VertexBuffer::set_layout(const BufferLayout &layout) { m_layout = layout; }
@@ -96,18 +123,154 @@ const BufferLayout &VertexBuffer::get_layout() const { return m_layout; }
 
 // IndexBuffer
 
-IndexBuffer::IndexBuffer(const unsigned int *indices, unsigned int count) : m_count(count) {
+IndexBuffer::IndexBuffer(const unsigned int *indices, unsigned int count)
+    : m_count(count), m_index_type(GL_UNSIGNED_INT) {
     glGenBuffers(1, &m_renderer_id);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_renderer_id);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, count * sizeof(unsigned int), indices, GL_STATIC_DRAW);
 }
 
+IndexBuffer::IndexBuffer(const uint16_t *indices, unsigned int count)
+    : m_count(count), m_index_type(GL_UNSIGNED_SHORT) {
+    glGenBuffers(1, &m_renderer_id);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_renderer_id);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, count * sizeof(uint16_t), indices, GL_STATIC_DRAW);
+}
+
+unsigned int IndexBuffer::get_index_size() const {
+    return m_index_type == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(unsigned int);
+}
+
 IndexBuffer::~IndexBuffer() { glDeleteBuffers(1, &m_renderer_id); }
 
 void IndexBuffer::bind() const { glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_renderer_id); }
 
 void IndexBuffer::unbind() const { glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0); }
 
+void IndexBuffer::set_data(const unsigned int *indices, unsigned int count, unsigned int offset) {
+    if (m_index_type != GL_UNSIGNED_INT) {
+        std::cerr << "ERROR: IndexBuffer: set_data requires a 32-bit index buffer" << std::endl;
+        return;
+    }
+    // Binding GL_ELEMENT_ARRAY_BUFFER with a VAO bound would rebind that VAO's index buffer.
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_renderer_id);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, offset * sizeof(unsigned int), count * sizeof(unsigned int), indices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+// StreamBuffer
+
+StreamBuffer::StreamBuffer(unsigned int region_size, unsigned int region_count, bool allow_persistent)
+    : m_region_size(region_size), m_region_count(region_count > 0 ? region_count : 1),
+      m_fences(m_region_count, nullptr) {
+    GLsizeiptr total = static_cast<GLsizeiptr>(m_region_size) * m_region_count;
+    glGenBuffers(1, &m_renderer_id);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_renderer_id);
+    auto &caps = Capabilities::get_instance();
+    if (allow_persistent && caps.has_buffer_storage()) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        caps.buffer_storage(GL_COPY_WRITE_BUFFER, total, nullptr, flags);
+        m_mapped = static_cast<unsigned char *>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, total, flags));
+        if (!m_mapped) {
+            // Immutable storage cannot be respecified, start over with a mutable buffer
+            glDeleteBuffers(1, &m_renderer_id);
+            glGenBuffers(1, &m_renderer_id);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, m_renderer_id);
+        }
+    }
+    if (!m_mapped)
+        glBufferData(GL_COPY_WRITE_BUFFER, total, nullptr, GL_STREAM_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+StreamBuffer::~StreamBuffer() {
+    for (void *fence : m_fences) {
+        if (fence)
+            glDeleteSync(static_cast<GLsync>(fence));
+    }
+    if (m_mapped) {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, m_renderer_id);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+    glDeleteBuffers(1, &m_renderer_id);
+}
+
+unsigned int StreamBuffer::push(const void *data, unsigned int size, unsigned int alignment) {
+    if (size == 0)
+        return invalid;
+    if (size > m_region_size) {
+        std::cerr << "Warning: StreamBuffer push of " << size << " bytes exceeds region size " << m_region_size
+                  << std::endl;
+        return invalid;
+    }
+    if (alignment == 0)
+        alignment = 1;
+    unsigned int base = m_region * m_region_size;
+    unsigned int offset = (base + m_head + alignment - 1) / alignment * alignment;
+    if (offset + size > base + m_region_size) {
+        advance(false);
+        base = m_region * m_region_size;
+        offset = (base + alignment - 1) / alignment * alignment;
+        if (offset + size > base + m_region_size)
+            return invalid;
+    }
+    if (m_mapped) {
+        std::memcpy(m_mapped + offset, data, size);
+    } else {
+        // The region is known to be free (or freshly orphaned), so no synchronization is needed
+        glBindBuffer(GL_COPY_WRITE_BUFFER, m_renderer_id);
+        void *ptr = glMapBufferRange(GL_COPY_WRITE_BUFFER, offset, size,
+                                     GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        if (ptr) {
+            std::memcpy(ptr, data, size);
+            glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        } else {
+            glBufferSubData(GL_COPY_WRITE_BUFFER, offset, size, data);
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+    m_head = offset - base + size;
+    return offset;
+}
+
+void StreamBuffer::end_frame() {
+    if (m_head > 0)
+        advance(true);
+}
+
+void StreamBuffer::advance(bool end_of_frame) {
+    m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_region = (m_region + 1) % m_region_count;
+    m_head = 0;
+    GLsync fence = static_cast<GLsync>(m_fences[m_region]);
+    if (!fence)
+        return;
+    GLenum status = glClientWaitSync(fence, 0, 0);
+    if (status == GL_TIMEOUT_EXPIRED) {
+        // Mid-frame, data pushed earlier may not be drawn yet and must survive: wait for the region instead
+        if (!m_mapped && end_of_frame) {
+            // Orphan the storage: the driver keeps the old one alive for pending draws
+            glBindBuffer(GL_COPY_WRITE_BUFFER, m_renderer_id);
+            glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(m_region_size) * m_region_count, nullptr,
+                         GL_STREAM_DRAW);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+            for (auto &pending : m_fences) {
+                if (pending)
+                    glDeleteSync(static_cast<GLsync>(pending));
+                pending = nullptr;
+            }
+            m_orphan_count++;
+            return;
+        }
+        m_stall_count++;
+        while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) {
+        }
+    }
+    glDeleteSync(fence);
+    m_fences[m_region] = nullptr;
+}
+
 } // namespace renderer
 
 } // namespace lmgl
@@ -0,0 +1,90 @@
+#include "lmgl/renderer/capabilities.hpp"
+
+#include <glad/glad.h>
+
+#include <GLFW/glfw3.h>
+
+namespace lmgl {
+
+namespace renderer {
+
+// Entry points above GL 4.1 are not part of the generated loader
+typedef void(APIENTRYP PFN_MULTI_DRAW_ELEMENTS_INDIRECT)(GLenum mode, GLenum type, const void *indirect,
+                                                          GLsizei drawcount, GLsizei stride);
+typedef void(APIENTRYP PFN_BUFFER_STORAGE)(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+typedef void(APIENTRYP PFN_MAX_SHADER_COMPILER_THREADS)(GLuint count);
+
+Capabilities &Capabilities::get_instance() {
+    static Capabilities instance;
+    return instance;
+}
+
+void *Capabilities::get_proc_address(const char *name) { return reinterpret_cast<void *>(glfwGetProcAddress(name)); }
+
+void Capabilities::detect() {
+    m_detected = false;
+    m_major = 0;
+    m_minor = 0;
+    m_extensions.clear();
+    m_multi_draw_indirect = false;
+    m_multi_draw_elements_indirect = nullptr;
+    m_buffer_storage = nullptr;
+    m_max_shader_compiler_threads = nullptr;
+    // Loader not initialised, no context to query
+    if (!glGetIntegerv || !glGetStringi)
+        return;
+    glGetIntegerv(GL_MAJOR_VERSION, &m_major);
+    glGetIntegerv(GL_MINOR_VERSION, &m_minor);
+    int count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (int i = 0; i < count; ++i) {
+        const char *name = reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, i));
+        if (name)
+            m_extensions.insert(name);
+    }
+    m_detected = m_major > 0;
+
+    bool base_instance = is_version_at_least(4, 2) || has_extension("GL_ARB_base_instance");
+    if (is_version_at_least(4, 3) || has_extension("GL_ARB_multi_draw_indirect"))
+        m_multi_draw_elements_indirect = get_proc_address("glMultiDrawElementsIndirect");
+    m_multi_draw_indirect = base_instance && m_multi_draw_elements_indirect != nullptr;
+    if (is_version_at_least(4, 4) || has_extension("GL_ARB_buffer_storage"))
+        m_buffer_storage = get_proc_address("glBufferStorage");
+    if (has_extension("GL_KHR_parallel_shader_compile"))
+        m_max_shader_compiler_threads = get_proc_address("glMaxShaderCompilerThreadsKHR");
+    else if (has_extension("GL_ARB_parallel_shader_compile"))
+        m_max_shader_compiler_threads = get_proc_address("glMaxShaderCompilerThreadsARB");
+    // 0xFFFFFFFF lets the driver choose
+    set_max_shader_compiler_threads(0xFFFFFFFFu);
+}
+
+bool Capabilities::has_extension(const std::string &name) const { return m_extensions.count(name) > 0; }
+
+bool Capabilities::is_version_at_least(int major, int minor) const {
+    return m_major > major || (m_major == major && m_minor >= minor);
+}
+
+void Capabilities::multi_draw_elements_indirect(unsigned int mode, unsigned int type, const void *indirect,
+                                                int draw_count, int stride) const {
+    if (!m_multi_draw_elements_indirect)
+        return;
+    reinterpret_cast<PFN_MULTI_DRAW_ELEMENTS_INDIRECT>(m_multi_draw_elements_indirect)(mode, type, indirect,
+                                                                                      draw_count, stride);
+}
+
+void Capabilities::buffer_storage(unsigned int target, std::ptrdiff_t size, const void *data,
+                                  unsigned int flags) const {
+    if (!m_buffer_storage)
+        return;
+    reinterpret_cast<PFN_BUFFER_STORAGE>(m_buffer_storage)(target, size, data, flags);
+}
+
+void Capabilities::set_max_shader_compiler_threads(unsigned int count) const {
+    if (!m_max_shader_compiler_threads)
+        return;
+    reinterpret_cast<PFN_MAX_SHADER_COMPILER_THREADS>(m_max_shader_compiler_threads)(count);
+}
+
+} // namespace renderer
+
+} // namespace lmgl
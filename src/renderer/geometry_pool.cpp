@@ -0,0 +1,217 @@
+#include "lmgl/renderer/geometry_pool.hpp"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <iostream>
+
+namespace lmgl {
+
+namespace renderer {
+
+// RangeAllocator
+
+RangeAllocator::RangeAllocator(unsigned int capacity) : m_capacity(capacity) { reset(); }
+
+unsigned int RangeAllocator::allocate(unsigned int size) {
+    if (size == 0)
+        return invalid;
+    for (auto it = m_free_blocks.begin(); it != m_free_blocks.end(); ++it) {
+        if (it->second < size)
+            continue;
+        unsigned int offset = it->first;
+        unsigned int remaining = it->second - size;
+        m_free_blocks.erase(it);
+        if (remaining > 0)
+            m_free_blocks.emplace(offset + size, remaining);
+        m_used += size;
+        return offset;
+    }
+    return invalid;
+}
+
+void RangeAllocator::free(unsigned int offset, unsigned int size) {
+    if (size == 0 || offset == invalid)
+        return;
+    m_used -= size;
+    auto next = m_free_blocks.lower_bound(offset);
+    // Merge with the following block
+    if (next != m_free_blocks.end() && offset + size == next->first) {
+        size += next->second;
+        next = m_free_blocks.erase(next);
+    }
+    // Merge with the preceding block
+    if (next != m_free_blocks.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == offset) {
+            prev->second += size;
+            return;
+        }
+    }
+    m_free_blocks.emplace(offset, size);
+}
+
+void RangeAllocator::reset(unsigned int used) {
+    m_free_blocks.clear();
+    m_used = std::min(used, m_capacity);
+    if (m_used < m_capacity)
+        m_free_blocks.emplace(m_used, m_capacity - m_used);
+}
+
+bool RangeAllocator::is_compact() const {
+    return m_free_blocks.empty() || (m_free_blocks.size() == 1 && m_free_blocks.begin()->first == m_used);
+}
+
+unsigned int RangeAllocator::get_largest_free_block() const {
+    unsigned int largest = 0;
+    for (const auto &block : m_free_blocks)
+        largest = std::max(largest, block.second);
+    return largest;
+}
+
+// GeometryAllocation
+
+GeometryAllocation::GeometryAllocation(std::shared_ptr<GeometryPage> page, unsigned int base_vertex,
+                                       unsigned int vertex_count, unsigned int first_index, unsigned int index_count)
+    : m_page(std::move(page)), m_base_vertex(base_vertex), m_vertex_count(vertex_count), m_first_index(first_index),
+      m_index_count(index_count) {}
+
+GeometryAllocation::~GeometryAllocation() {
+    if (m_page)
+        m_page->release(this);
+}
+
+const std::shared_ptr<VertexArray> &GeometryAllocation::get_vertex_array() const { return m_page->get_vertex_array(); }
+
+// GeometryPage
+
+GeometryPage::GeometryPage(const BufferLayout &layout, unsigned int vertex_capacity, unsigned int index_capacity)
+    : m_stride(layout.get_stride()), m_vertex_allocator(vertex_capacity), m_index_allocator(index_capacity) {
+    m_vertex_buffer = std::make_shared<VertexBuffer>(nullptr, vertex_capacity * m_stride);
+    m_vertex_buffer->set_layout(layout);
+    m_index_buffer = std::make_shared<IndexBuffer>(static_cast<const unsigned int *>(nullptr), index_capacity);
+    m_vertex_array = std::make_shared<VertexArray>();
+    m_vertex_array->add_vertex_buffer(m_vertex_buffer);
+    m_vertex_array->set_index_buffer(m_index_buffer);
+}
+
+std::shared_ptr<GeometryAllocation> GeometryPage::allocate(const void *vertices, unsigned int vertex_count,
+                                                           const unsigned int *indices, unsigned int index_count) {
+    unsigned int base_vertex = m_vertex_allocator.allocate(vertex_count);
+    if (base_vertex == RangeAllocator::invalid)
+        return nullptr;
+    unsigned int first_index = m_index_allocator.allocate(index_count);
+    if (first_index == RangeAllocator::invalid) {
+        m_vertex_allocator.free(base_vertex, vertex_count);
+        return nullptr;
+    }
+    m_vertex_buffer->set_data(vertices, vertex_count * m_stride, base_vertex * m_stride);
+    m_index_buffer->set_data(indices, index_count, first_index);
+    std::shared_ptr<GeometryAllocation> allocation(
+        new GeometryAllocation(shared_from_this(), base_vertex, vertex_count, first_index, index_count));
+    m_allocations.push_back(allocation.get());
+    return allocation;
+}
+
+void GeometryPage::release(GeometryAllocation *allocation) {
+    auto it = std::find(m_allocations.begin(), m_allocations.end(), allocation);
+    if (it == m_allocations.end())
+        return;
+    m_allocations.erase(it);
+    m_vertex_allocator.free(allocation->m_base_vertex, allocation->m_vertex_count);
+    m_index_allocator.free(allocation->m_first_index, allocation->m_index_count);
+}
+
+void GeometryPage::defragment() {
+    if (m_vertex_allocator.is_compact() && m_index_allocator.is_compact())
+        return;
+    std::sort(m_allocations.begin(), m_allocations.end(), [](const GeometryAllocation *a, const GeometryAllocation *b) {
+        return a->m_base_vertex < b->m_base_vertex;
+    });
+    unsigned int vertex_bytes = m_vertex_allocator.get_used() * m_stride;
+    unsigned int index_bytes = m_index_allocator.get_used() * sizeof(unsigned int);
+
+    // Gather live ranges into a scratch buffer, then copy the packed result back
+    unsigned int scratch;
+    glGenBuffers(1, &scratch);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, scratch);
+    glBufferData(GL_COPY_WRITE_BUFFER, std::max(vertex_bytes + index_bytes, 1u), nullptr, GL_STREAM_COPY);
+    glBindBuffer(GL_COPY_READ_BUFFER, m_vertex_buffer->get_id());
+    unsigned int next_vertex = 0;
+    for (auto *allocation : m_allocations) {
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, allocation->m_base_vertex * m_stride,
+                            next_vertex * m_stride, allocation->m_vertex_count * m_stride);
+        allocation->m_base_vertex = next_vertex;
+        next_vertex += allocation->m_vertex_count;
+    }
+    std::sort(m_allocations.begin(), m_allocations.end(), [](const GeometryAllocation *a, const GeometryAllocation *b) {
+        return a->m_first_index < b->m_first_index;
+    });
+    glBindBuffer(GL_COPY_READ_BUFFER, m_index_buffer->get_id());
+    unsigned int next_index = 0;
+    for (auto *allocation : m_allocations) {
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                            allocation->m_first_index * sizeof(unsigned int),
+                            vertex_bytes + next_index * sizeof(unsigned int),
+                            allocation->m_index_count * sizeof(unsigned int));
+        allocation->m_first_index = next_index;
+        next_index += allocation->m_index_count;
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, scratch);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_vertex_buffer->get_id());
+    if (vertex_bytes > 0)
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, vertex_bytes);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_index_buffer->get_id());
+    if (index_bytes > 0)
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, vertex_bytes, 0, index_bytes);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glDeleteBuffers(1, &scratch);
+
+    m_vertex_allocator.reset(next_vertex);
+    m_index_allocator.reset(next_index);
+}
+
+// GeometryPool
+
+GeometryPool::GeometryPool(const BufferLayout &layout, unsigned int vertices_per_page, unsigned int indices_per_page)
+    : m_layout(layout), m_vertices_per_page(vertices_per_page), m_indices_per_page(indices_per_page) {}
+
+std::shared_ptr<GeometryAllocation> GeometryPool::allocate(const void *vertices, unsigned int vertex_count,
+                                                           const unsigned int *indices, unsigned int index_count) {
+    if (vertex_count == 0 || index_count == 0)
+        return nullptr;
+    for (auto &page : m_pages) {
+        if (page->get_vertex_allocator().get_largest_free_block() < vertex_count ||
+            page->get_index_allocator().get_largest_free_block() < index_count)
+            continue;
+        if (auto allocation = page->allocate(vertices, vertex_count, indices, index_count))
+            return allocation;
+    }
+    unsigned int vertex_capacity = std::max(m_vertices_per_page, vertex_count);
+    unsigned int index_capacity = std::max(m_indices_per_page, index_count);
+    if (vertex_count > m_vertices_per_page || index_count > m_indices_per_page) {
+        std::cerr << "Warning: GeometryPool: mesh with " << vertex_count << " vertices and " << index_count
+                  << " indices exceeds the page size, creating a dedicated page" << std::endl;
+    }
+    auto page = std::make_shared<GeometryPage>(m_layout, vertex_capacity, index_capacity);
+    m_pages.push_back(page);
+    return page->allocate(vertices, vertex_count, indices, index_count);
+}
+
+void GeometryPool::defragment() {
+    for (size_t i = 0; i < m_pages.size();) {
+        auto &page = m_pages[i];
+        // Only the pool references an empty page, so it can be dropped
+        if (i > 0 && page->get_allocation_count() == 0 && page.use_count() == 1) {
+            m_pages.erase(m_pages.begin() + i);
+            continue;
+        }
+        page->defragment();
+        ++i;
+    }
+}
+
+} // namespace renderer
+
+} // namespace lmgl
@@ -0,0 +1,214 @@
+#include "lmgl/renderer/program_cache.hpp"
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace lmgl {
+
+namespace renderer {
+
+namespace {
+
+constexpr char MAGIC[4] = {'L', 'M', 'P', 'G'};
+
+// Fixed-size file header, followed by the program binary
+struct Header {
+    char magic[4];
+    uint32_t version;
+    uint64_t key;
+    uint32_t format;
+    uint32_t reserved;
+    uint64_t binary_size;
+    uint64_t checksum;
+};
+
+// 64-bit FNV-1a, the hash of the model cache
+uint64_t hash(const void *data, std::size_t size, uint64_t h = 14695981039346656037ull) {
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    for (std::size_t i = 0; i < size; ++i) {
+        h ^= bytes[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+// Hashes the length first, so that moving text between two strings changes the key
+uint64_t hash_string(const std::string &value, uint64_t h) {
+    uint64_t size = value.size();
+    h = hash(&size, sizeof(size), h);
+    return hash(value.data(), value.size(), h);
+}
+
+double get_elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+std::string ProgramCache::s_directory = ".lmgl_cache/programs";
+ProgramCacheStats ProgramCache::s_stats;
+
+void ProgramCache::set_directory(const std::string &directory) { s_directory = directory; }
+
+const std::string &ProgramCache::get_directory() { return s_directory; }
+
+bool ProgramCache::is_enabled() {
+    if (s_directory.empty() || !glGetIntegerv)
+        return false;
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+}
+
+uint64_t ProgramCache::make_key(const std::vector<std::string> &sources) {
+    uint64_t h = hash(&VERSION, sizeof(VERSION));
+    for (const auto &source : sources)
+        h = hash_string(source, h);
+    // Binaries only load on the driver that produced them
+    if (glGetString) {
+        for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+            const char *value = reinterpret_cast<const char *>(glGetString(name));
+            h = hash_string(value ? value : "", h);
+        }
+    }
+    return h;
+}
+
+std::string ProgramCache::get_cache_path(uint64_t key) {
+    std::ostringstream name;
+    name << std::hex << std::setw(16) << std::setfill('0') << key << ".lprog";
+    return (std::filesystem::path(s_directory) / name.str()).string();
+}
+
+unsigned int ProgramCache::load(uint64_t key) {
+    if (!is_enabled())
+        return 0;
+    auto start = std::chrono::steady_clock::now();
+    std::string cache_path = get_cache_path(key);
+    std::error_code error;
+    auto size = std::filesystem::file_size(cache_path, error);
+    if (error)
+        return 0;
+
+    std::vector<char> binary;
+    Header header = {};
+    bool intact = false;
+    {
+        std::ifstream file(cache_path, std::ios::binary);
+        if (file.read(reinterpret_cast<char *>(&header), sizeof(header)) &&
+            std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 && header.version == VERSION &&
+            header.key == key && header.binary_size == size - sizeof(Header)) {
+            binary.resize(header.binary_size);
+            intact = file.read(binary.data(), static_cast<std::streamsize>(binary.size())) &&
+                     hash(binary.data(), binary.size()) == header.checksum;
+        }
+    }
+    unsigned int program = 0;
+    if (intact) {
+        program = glCreateProgram();
+        glProgramBinary(program, header.format, binary.data(), static_cast<GLsizei>(binary.size()));
+        GLint success = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success) {
+            glDeleteProgram(program);
+            program = 0;
+            // An unsupported format raises GL_INVALID_ENUM, which is expected here
+            while (glGetError() != GL_NO_ERROR) {
+            }
+        }
+    }
+    if (program == 0) {
+        std::cerr << "Warning: ProgramCache: rejected " << cache_path << ", compiling from source" << std::endl;
+        std::remove(cache_path.c_str());
+        ++s_stats.rejected;
+        return 0;
+    }
+    ++s_stats.hits;
+    s_stats.load_ms += get_elapsed_ms(start);
+    return program;
+}
+
+bool ProgramCache::store(uint64_t key, unsigned int program) {
+    if (program == 0 || !is_enabled())
+        return false;
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return false;
+    std::vector<char> binary(static_cast<size_t>(length));
+    GLsizei written = 0;
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &written, &format, binary.data());
+    if (written <= 0)
+        return false;
+    binary.resize(static_cast<size_t>(written));
+
+    Header header = {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.key = key;
+    header.format = format;
+    header.binary_size = binary.size();
+    header.checksum = hash(binary.data(), binary.size());
+
+    std::error_code error;
+    std::filesystem::create_directories(s_directory, error);
+    std::string cache_path = get_cache_path(key);
+    std::string temporary = cache_path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            std::cerr << "Warning: ProgramCache: cannot write " << temporary << std::endl;
+            return false;
+        }
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(binary.data(), static_cast<std::streamsize>(binary.size()));
+        if (!file) {
+            std::cerr << "Warning: ProgramCache: failed writing " << temporary << std::endl;
+            file.close();
+            std::remove(temporary.c_str());
+            return false;
+        }
+    }
+    std::filesystem::rename(temporary, cache_path, error);
+    if (error) {
+        std::cerr << "Warning: ProgramCache: cannot replace " << cache_path << ": " << error.message() << std::endl;
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+unsigned int ProgramCache::get_or_build(const std::vector<std::string> &sources,
+                                        const std::function<unsigned int()> &build) {
+    uint64_t key = make_key(sources);
+    unsigned int program = load(key);
+    if (program != 0)
+        return program;
+    auto start = std::chrono::steady_clock::now();
+    program = build();
+    record_build(get_elapsed_ms(start));
+    store(key, program);
+    return program;
+}
+
+void ProgramCache::record_build(double milliseconds) {
+    ++s_stats.misses;
+    s_stats.compile_ms += milliseconds;
+}
+
+const ProgramCacheStats &ProgramCache::get_stats() { return s_stats; }
+
+void ProgramCache::reset_stats() { s_stats = ProgramCacheStats(); }
+
+} // namespace renderer
+
+} // namespace lmgl
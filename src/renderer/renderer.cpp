@@ -1,4 +1,5 @@
 #include "lmgl/renderer/renderer.hpp"
+#include "lmgl/renderer/texture_streamer.hpp"
 #include "lmgl/scene/frustum.hpp"
 #include "lmgl/scene/light.hpp"
 #include "lmgl/scene/mesh.hpp"
@@ -8,12 +9,21 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include <algorithm>
+#include <cstdint>
 #include <memory>
+#include <string>
 
 namespace lmgl {
 
 namespace renderer {
 
+//! Attribute location of the per-draw model matrix used by indirect batches
+static constexpr int INSTANCE_TRANSFORM_LOCATION = 6;
+
+//! Region sizes of the per-frame indirect rings, enough for 16384 batched draws
+static constexpr unsigned int INSTANCE_STREAM_REGION_SIZE = 16384 * sizeof(glm::mat4);
+static constexpr unsigned int COMMAND_STREAM_REGION_SIZE = 16384 * sizeof(DrawElementsIndirectCommand);
+
 Renderer::Renderer()
     : m_render_mode(RenderMode::Solid), m_depth_test_enabled(true), m_culling_enabled(true), m_blending_enabled(false),
       m_draw_calls(0), m_triangles_count(0) {
@@ -31,6 +41,10 @@ Renderer::Renderer()
     m_screen_quad = scene::Mesh::create_quad(m_postprocess_shader, 2.0f, 2.0f);
 }
 
+bool Renderer::is_multi_draw_indirect_active() const {
+    return m_multi_draw_indirect && Capabilities::get_instance().has_multi_draw_indirect();
+}
+
 void Renderer::render(std::shared_ptr<scene::Scene> scene, std::shared_ptr<scene::Camera> camera) {
     if (!scene || !camera)
         return;
@@ -38,14 +52,18 @@ void Renderer::render(std::shared_ptr<scene::Scene> scene, std::shared_ptr<scene
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     m_draw_calls = 0;
     m_triangles_count = 0;
+    m_culled_triangles = 0;
+    m_pending_shaders = 0;
     m_render_queue.clear();
     clear_material_cache();
-    scene::Frustum frustum;
-    frustum.update(camera->get_view_projection_matrix());
+    m_frustum.update(camera->get_view_projection_matrix());
+    m_scene_features = get_scene_features(scene);
     glm::mat4 identity(1.0f);
-    build_render_queue_culled(scene->get_root(), camera, identity, m_render_queue, frustum);
+    build_render_queue_culled(scene->get_root(), camera, identity, m_render_queue, m_frustum);
     collect_lights(scene);
+    prepare_scene_uniforms();
     sort_render_queue(m_render_queue);
+    request_texture_levels(camera);
     apply_render_mode();
 
     // Render scene to framebuffer
@@ -57,8 +75,24 @@ void Renderer::render(std::shared_ptr<scene::Scene> scene, std::shared_ptr<scene
         scene->get_skybox()->render(camera);
     }
 
-    for (const auto &item : m_render_queue) {
-        render_mesh(item.mesh, item.transform, camera, scene);
+    m_indirect_batches.clear();
+    if (is_multi_draw_indirect_active())
+        build_indirect_batches(camera->get_position());
+    size_t next_batch = 0;
+    for (size_t i = 0; i < m_render_queue.size();) {
+        if (next_batch < m_indirect_batches.size() && m_indirect_batches[next_batch].first_item == i) {
+            const auto &batch = m_indirect_batches[next_batch++];
+            render_indirect_batch(batch, camera, scene);
+            i += batch.item_count;
+            continue;
+        }
+        const auto &item = m_render_queue[i++];
+        render_mesh(item, camera, scene);
+    }
+    // Fence this frame's indirect data so the next frames write elsewhere
+    if (m_instance_stream) {
+        m_instance_stream->end_frame();
+        m_command_stream->end_frame();
     }
 
     // Post-process pass
@@ -83,6 +117,7 @@ void Renderer::render(std::shared_ptr<scene::Scene> scene, std::shared_ptr<scene
     m_framebuffer->get_color_attachment()->bind(0);
     if (m_screen_quad->get_vertex_array())
         m_screen_quad->get_vertex_array()->bind();
+    m_last_bound_vertex_array = nullptr;
     m_screen_quad->render();
     m_postprocess_shader->unbind();
     if (m_depth_test_enabled)
@@ -150,6 +185,7 @@ void Renderer::build_render_queue(std::shared_ptr<scene::Node> node, std::shared
         item.distance_to_camera = glm::length(cam_pos - mesh_pos);
         item.is_transparent = false;
         item.layer = RenderLayer::Opaque;
+        item.features = get_mesh_features(*item.mesh);
         out_items.push_back(item);
     }
     for (const auto &child : node->get_children()) {
@@ -175,6 +211,7 @@ void Renderer::build_render_queue_culled(std::shared_ptr<scene::Node> node, std:
             item.distance_to_camera = glm::length(cam_pos - mesh_pos);
             item.is_transparent = false;
             item.layer = RenderLayer::Opaque;
+            item.features = get_mesh_features(*item.mesh);
             out_items.push_back(item);
         }
     }
@@ -193,11 +230,20 @@ void Renderer::sort_render_queue(std::vector<RenderItem> &items) {
         if (shader_a != shader_b) {
             return shader_a < shader_b;
         }
+        // Items of one variant follow each other, so each variant is bound once
+        if (a.features != b.features) {
+            return a.features < b.features;
+        }
         scene::Material *mat_a = a.mesh->get_material().get();
         scene::Material *mat_b = b.mesh->get_material().get();
         if (mat_a != mat_b) {
             return mat_a < mat_b;
         }
+        VertexArray *vao_a = a.mesh->get_vertex_array().get();
+        VertexArray *vao_b = b.mesh->get_vertex_array().get();
+        if (vao_a != vao_b) {
+            return vao_a < vao_b;
+        }
         if (a.is_transparent) {
             return a.distance_to_camera > b.distance_to_camera;
         } else {
@@ -206,15 +252,27 @@ void Renderer::sort_render_queue(std::vector<RenderItem> &items) {
     });
 }
 
-void Renderer::render_mesh(std::shared_ptr<scene::Mesh> mesh, const glm::mat4 &transform,
-                           std::shared_ptr<scene::Camera> camera, std::shared_ptr<scene::Scene> scene) {
+void Renderer::render_mesh(const RenderItem &item, std::shared_ptr<scene::Camera> camera,
+                           std::shared_ptr<scene::Scene> scene) {
+    const auto &mesh = item.mesh;
+    const glm::mat4 &transform = item.transform;
     if (!mesh || !camera)
         return;
-    auto shader = mesh->get_shader();
+    auto shader = get_item_shader(item);
     if (!shader)
         return;
-    if (mesh->get_vertex_array())
-        mesh->get_vertex_array()->bind();
+    bool draw_meshlets = m_meshlet_culling && mesh->has_meshlets();
+    unsigned int triangles = mesh->get_index_count() / 3;
+    if (draw_meshlets) {
+        triangles = cull_mesh_meshlets(*mesh, transform, camera->get_position());
+        if (m_meshlet_ranges.empty())
+            return;
+    }
+    auto vertex_array = mesh->get_vertex_array();
+    if (vertex_array && vertex_array.get() != m_last_bound_vertex_array) {
+        vertex_array->bind();
+        m_last_bound_vertex_array = vertex_array.get();
+    }
     shader->bind();
     glm::mat4 view(camera->get_view_matrix());
     glm::mat4 proj(camera->get_projection_matrix());
@@ -223,6 +281,104 @@ void Renderer::render_mesh(std::shared_ptr<scene::Mesh> mesh, const glm::mat4 &t
     shader->set_mat4("u_MVP", mvp);
     glm::mat3 normal_matrix = glm::transpose(glm::inverse(glm::mat3(transform)));
     shader->set_mat3("u_NormalMatrix", normal_matrix);
+    if (shader->get_attribute_location("a_InstanceModel") == INSTANCE_TRANSFORM_LOCATION)
+        shader->set_int("u_UseInstanceTransform", 0);
+    if (shader->has_uniform("u_PackedVertex"))
+        shader->set_int("u_PackedVertex", mesh->is_packed() ? 1 : 0);
+    bind_scene_uniforms(shader, camera, scene);
+    auto material = mesh->get_material();
+    if (material)
+        bind_material(material, shader);
+    else {
+        bind_material(m_default_material, shader);
+    }
+    if (draw_meshlets)
+        mesh->render_ranges(m_meshlet_ranges);
+    else
+        mesh->render();
+    m_draw_calls++;
+    m_triangles_count += triangles;
+}
+
+unsigned int Renderer::cull_mesh_meshlets(const scene::Mesh &mesh, const glm::mat4 &transform,
+                                          const glm::vec3 &camera_position) {
+    unsigned int visible = scene::cull_meshlets(mesh.get_meshlets(), m_frustum, transform, camera_position,
+                                                m_culling_enabled, m_meshlet_ranges);
+    m_culled_triangles += mesh.get_index_count() / 3 - visible;
+    return visible;
+}
+
+void Renderer::request_texture_levels(std::shared_ptr<scene::Camera> camera) {
+    TextureStreamer &streamer = TextureStreamer::get_instance();
+    if (streamer.is_empty())
+        return;
+    const glm::mat4 &proj = camera->get_projection_matrix();
+    bool perspective = proj[2][3] != 0.0f;
+    float half_height = 0.5f * static_cast<float>(m_window_height);
+    for (const auto &item : m_render_queue) {
+        auto material = item.mesh->get_material();
+        if (!material)
+            continue;
+        float radius = item.mesh->get_bounding_sphere().transform(item.transform).radius;
+        // Projected diameter in pixels, unbounded once the camera is inside the sphere
+        float screen_size = 2.0f * radius * proj[1][1] * half_height;
+        if (perspective)
+            screen_size = item.distance_to_camera > radius ? screen_size / item.distance_to_camera : 1e9f;
+        for (const auto &texture : {material->get_albedo_map(), material->get_normal_map(),
+                                    material->get_metallic_map(), material->get_roughness_map(),
+                                    material->get_ao_map(), material->get_emissive_map()}) {
+            if (texture)
+                streamer.request(texture.get(), screen_size);
+        }
+    }
+}
+
+void Renderer::prepare_scene_uniforms() {
+    m_scene_uniform_programs.clear();
+    m_cascade_matrices.clear();
+    m_point_shadow_rects.clear();
+    m_spot_shadow_rects.clear();
+    m_spot_shadow_matrices.clear();
+    if (!m_shadow_enabled)
+        return;
+    if (m_shadow_map) {
+        for (unsigned int i = 0; i < m_shadow_map->get_active_cascade_count(); ++i)
+            m_cascade_matrices.push_back(m_shadow_map->get_shadow_matrix(i));
+    }
+    if (m_shadow_atlas) {
+        // Lights without a tile get an empty rect and stay unshadowed
+        for (size_t i = 0; i < m_atlas_lights.size(); ++i) {
+            int first_tile = m_shadow_atlas->get_first_tile(static_cast<unsigned int>(i));
+            if (m_atlas_lights[i]->get_type() == scene::LightType::Point) {
+                for (int face = 0; face < 6; ++face) {
+                    glm::vec4 rect(0.0f);
+                    if (first_tile >= 0)
+                        rect = m_shadow_atlas->get_tile_rect(static_cast<unsigned int>(first_tile + face));
+                    m_point_shadow_rects.push_back(rect);
+                }
+            } else {
+                glm::vec4 rect(0.0f);
+                glm::mat4 matrix(1.0f);
+                if (first_tile >= 0) {
+                    auto tile = static_cast<unsigned int>(first_tile);
+                    rect = m_shadow_atlas->get_tile_rect(tile);
+                    matrix = m_shadow_atlas->get_tile(tile).light_space_matrix;
+                }
+                m_spot_shadow_rects.push_back(rect);
+                m_spot_shadow_matrices.push_back(matrix);
+            }
+        }
+    }
+}
+
+void Renderer::bind_scene_uniforms(std::shared_ptr<Shader> shader, std::shared_ptr<scene::Camera> camera,
+                                   std::shared_ptr<scene::Scene> scene) {
+    // Programs keep their uniforms, each one only needs them once per frame
+    unsigned int program = shader->get_id();
+    if (std::find(m_scene_uniform_programs.begin(), m_scene_uniform_programs.end(), program) !=
+        m_scene_uniform_programs.end())
+        return;
+    m_scene_uniform_programs.push_back(program);
     shader->set_vec3("u_CameraPos", camera->get_position());
     bind_lights(shader);
     if (m_shadow_enabled) {
@@ -230,17 +386,24 @@ void Renderer::render_mesh(std::shared_ptr<scene::Mesh> mesh, const glm::mat4 &t
             m_shadow_map->bind_texture(15);
             shader->set_int("u_ShadowMap", 15);
             shader->set_int("u_UseDirectionalShadow", 1);
-            shader->set_mat4("u_LightSpaceMatrix", m_light_space_matrix);
+            shader->set_int("u_ShadowDirLight", m_shadow_dir_light);
+            shader->set_int("u_CascadeCount", static_cast<int>(m_cascade_matrices.size()));
+            shader->set_mat4_array("u_LightSpaceMatrices", m_cascade_matrices.data(),
+                                   static_cast<unsigned int>(m_cascade_matrices.size()));
         } else {
             shader->set_int("u_UseDirectionalShadow", 0);
         }
 
-        if (m_cubemap_shadow_map) {
-            m_cubemap_shadow_map->bind_texture(16);
-            shader->set_int("u_ShadowCubemap", 16);
+        if (m_shadow_atlas) {
+            m_shadow_atlas->bind_texture(16);
+            shader->set_int("u_ShadowAtlas", 16);
             shader->set_int("u_UsePointShadow", 1);
-            shader->set_vec3("u_ShadowLightPos", m_shadow_light_pos);
-            shader->set_float("u_ShadowFarPlane", m_shadow_far_plane);
+            shader->set_vec4_array("u_PointShadowRects", m_point_shadow_rects.data(),
+                                   static_cast<unsigned int>(m_point_shadow_rects.size()));
+            shader->set_vec4_array("u_SpotShadowRects", m_spot_shadow_rects.data(),
+                                   static_cast<unsigned int>(m_spot_shadow_rects.size()));
+            shader->set_mat4_array("u_SpotShadowMatrices", m_spot_shadow_matrices.data(),
+                                   static_cast<unsigned int>(m_spot_shadow_matrices.size()));
         } else {
             shader->set_int("u_UsePointShadow", 0);
         }
@@ -255,15 +418,173 @@ void Renderer::render_mesh(std::shared_ptr<scene::Mesh> mesh, const glm::mat4 &t
     } else {
         shader->set_int("u_UseEnvironmentMap", 0);
     }
-    auto material = mesh->get_material();
-    if (material)
-        bind_material(material, shader);
-    else {
-        bind_material(m_default_material, shader);
+}
+
+std::shared_ptr<Shader> Renderer::get_ready_shader(const std::shared_ptr<Shader> &shader) {
+    // Failed programs are drawn as before, only builds in flight are replaced
+    if (!shader || shader->poll() != Shader::State::Compiling)
+        return shader;
+    m_pending_shaders++;
+    if (m_fallback_shader && m_fallback_shader->is_ready())
+        return m_fallback_shader;
+    return nullptr;
+}
+
+std::shared_ptr<Shader> Renderer::get_item_shader(const RenderItem &item) {
+    auto shader = item.mesh->get_shader();
+    if (shader && shader->has_variants()) {
+        if (auto variant = shader->get_variant(item.features))
+            return variant;
     }
-    mesh->render();
+    return get_ready_shader(shader);
+}
+
+uint32_t Renderer::get_scene_features(std::shared_ptr<scene::Scene> scene) const {
+    // Mirrors the flags bind_scene_uniforms() sets
+    uint32_t features = 0;
+    if (m_shadow_enabled && m_shadow_map)
+        features |= Shader::DirectionalShadow;
+    if (m_shadow_enabled && m_shadow_atlas)
+        features |= Shader::PointShadow;
+    if (scene && scene->get_skybox() && scene->get_skybox()->get_cubemap())
+        features |= Shader::EnvironmentMap;
+    return features;
+}
+
+uint32_t Renderer::get_mesh_features(const scene::Mesh &mesh) const {
+    auto material = mesh.get_material();
+    return m_scene_features | (material ? material->get_features() : m_default_material->get_features());
+}
+
+bool Renderer::can_draw_indirect(const RenderItem &item) {
+    if (!item.mesh->is_pooled())
+        return false;
+    auto shader = item.mesh->get_shader();
+    // Pending shaders take the per-mesh path, which substitutes the fallback
+    if (!shader || shader->poll() == Shader::State::Compiling)
+        return false;
+    if (shader->get_attribute_location("a_InstanceModel") != INSTANCE_TRANSFORM_LOCATION)
+        return false;
+    auto vertex_array = item.mesh->get_vertex_array();
+    for (const auto &buffer : vertex_array->get_stream_buffers()) {
+        if (buffer == m_instance_stream)
+            return true;
+    }
+    // Attach the transform stream to the page VAO once, unless its vertex attributes already use the slot
+    if (vertex_array->get_next_attribute_location() > INSTANCE_TRANSFORM_LOCATION)
+        return false;
+    vertex_array->add_stream_buffer(
+        m_instance_stream, {{ShaderDataType::Mat4, "a_InstanceModel", false, INSTANCE_TRANSFORM_LOCATION}}, 1);
+    return true;
+}
+
+void Renderer::build_indirect_batches(const glm::vec3 &camera_position) {
+    if (!m_instance_stream) {
+        m_instance_stream = std::make_shared<StreamBuffer>(INSTANCE_STREAM_REGION_SIZE);
+        m_command_stream = std::make_unique<StreamBuffer>(COMMAND_STREAM_REGION_SIZE);
+    }
+    m_instance_transforms.clear();
+    m_indirect_commands.clear();
+    const size_t count = m_render_queue.size();
+    for (size_t i = 0; i < count;) {
+        const auto &first = m_render_queue[i];
+        if (!can_draw_indirect(first)) {
+            ++i;
+            continue;
+        }
+        size_t end = i + 1;
+        while (end < count) {
+            const auto &next = m_render_queue[end];
+            if (next.layer != first.layer || next.mesh->get_shader() != first.mesh->get_shader() ||
+                next.features != first.features || next.mesh->get_material() != first.mesh->get_material() ||
+                next.mesh->get_vertex_array() != first.mesh->get_vertex_array())
+                break;
+            ++end;
+        }
+        // A single draw gains nothing from going through the indirect buffer
+        if (end - i < 2) {
+            i = end;
+            continue;
+        }
+        IndirectBatch batch{i, static_cast<unsigned int>(m_indirect_commands.size()), 0,
+                            static_cast<unsigned int>(end - i), 0};
+        for (size_t j = i; j < end; ++j) {
+            const auto &item = m_render_queue[j];
+            auto allocation = item.mesh->get_allocation();
+            if (m_meshlet_culling && item.mesh->has_meshlets())
+                cull_mesh_meshlets(*item.mesh, item.transform, camera_position);
+            else
+                m_meshlet_ranges.assign(1, {0, item.mesh->get_index_count()});
+            if (m_meshlet_ranges.empty())
+                continue;
+            // Every range of an item reads the same transform
+            for (const auto &range : m_meshlet_ranges) {
+                DrawElementsIndirectCommand command;
+                command.count = range.index_count;
+                command.instance_count = 1;
+                command.first_index = allocation->get_first_index() + range.first_index;
+                command.base_vertex = static_cast<int>(allocation->get_base_vertex());
+                command.base_instance = static_cast<unsigned int>(m_instance_transforms.size());
+                m_indirect_commands.push_back(command);
+                batch.triangles += command.count / 3;
+            }
+            m_instance_transforms.push_back(item.transform);
+        }
+        batch.command_count = static_cast<unsigned int>(m_indirect_commands.size()) - batch.first_command;
+        m_indirect_batches.push_back(batch);
+        i = end;
+    }
+    // Attaching the transform stream rebinds VAOs behind the cache's back
+    m_last_bound_vertex_array = nullptr;
+    if (m_indirect_commands.empty())
+        return;
+    unsigned int transform_offset =
+        m_instance_stream->push(m_instance_transforms.data(),
+                                static_cast<unsigned int>(m_instance_transforms.size() * sizeof(glm::mat4)),
+                                sizeof(glm::mat4));
+    if (transform_offset == StreamBuffer::invalid) {
+        m_indirect_batches.clear();
+        return;
+    }
+    // The instanced attribute reads from the start of the ring, so skip to this frame's matrices
+    unsigned int first_transform = transform_offset / sizeof(glm::mat4);
+    for (auto &command : m_indirect_commands)
+        command.base_instance += first_transform;
+    m_command_offset = m_command_stream->push(
+        m_indirect_commands.data(),
+        static_cast<unsigned int>(m_indirect_commands.size() * sizeof(DrawElementsIndirectCommand)), 4);
+    if (m_command_offset == StreamBuffer::invalid)
+        m_indirect_batches.clear();
+}
+
+void Renderer::render_indirect_batch(const IndirectBatch &batch, std::shared_ptr<scene::Camera> camera,
+                                     std::shared_ptr<scene::Scene> scene) {
+    // Every meshlet of the batch was culled
+    if (batch.command_count == 0)
+        return;
+    auto mesh = m_render_queue[batch.first_item].mesh;
+    // The generic program is built, see can_draw_indirect(), so this never counts as pending
+    auto shader = get_item_shader(m_render_queue[batch.first_item]);
+    auto vertex_array = mesh->get_vertex_array();
+    if (vertex_array.get() != m_last_bound_vertex_array) {
+        vertex_array->bind();
+        m_last_bound_vertex_array = vertex_array.get();
+    }
+    shader->bind();
+    shader->set_mat4("u_ViewProjection", camera->get_view_projection_matrix());
+    shader->set_int("u_UseInstanceTransform", 1);
+    if (shader->has_uniform("u_PackedVertex"))
+        shader->set_int("u_PackedVertex", mesh->is_packed() ? 1 : 0);
+    bind_scene_uniforms(shader, camera, scene);
+    auto material = mesh->get_material();
+    bind_material(material ? material : m_default_material, shader);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_command_stream->get_id());
+    const void *offset = reinterpret_cast<const void *>(
+        m_command_offset + static_cast<uintptr_t>(batch.first_command) * sizeof(DrawElementsIndirectCommand));
+    Capabilities::get_instance().multi_draw_elements_indirect(GL_TRIANGLES, GL_UNSIGNED_INT, offset,
+                                                              static_cast<int>(batch.command_count), 0);
     m_draw_calls++;
-    m_triangles_count += mesh->get_index_count() / 3;
+    m_triangles_count += batch.triangles;
 }
 
 void Renderer::collect_lights(std::shared_ptr<scene::Scene> scene) {
@@ -332,31 +653,35 @@ void Renderer::bind_lights(std::shared_ptr<renderer::Shader> shader) {
         shader->set_float(base + ".range", m_point_lights[i]->get_range());
     }
     int num_spot_lights = std::min((int)m_spot_lights.size(), 8);
-    if (num_spot_lights > 0) {
-        shader->set_int("u_NumSpotLights", num_spot_lights);
-        for (int i = 0; i < num_spot_lights; ++i) {
-            std::string base = "u_SpotLights[" + std::to_string(i) + "]";
-            shader->set_vec3(base + ".position", m_spot_lights[i]->get_position());
-            shader->set_vec3(base + ".direction", m_spot_lights[i]->get_direction());
-            shader->set_vec3(base + ".color", m_spot_lights[i]->get_color());
-            shader->set_float(base + ".intensity", m_spot_lights[i]->get_intensity());
-            shader->set_float(base + ".range", m_spot_lights[i]->get_range());
-            shader->set_float(base + ".innerCutoff", m_spot_lights[i]->get_inner_cone());
-            shader->set_float(base + ".outerCutoff", m_spot_lights[i]->get_outer_cone());
-        }
+    shader->set_int("u_NumSpotLights", num_spot_lights);
+    for (int i = 0; i < num_spot_lights; ++i) {
+        std::string base = "u_SpotLights[" + std::to_string(i) + "]";
+        shader->set_vec3(base + ".position", m_spot_lights[i]->get_position());
+        shader->set_vec3(base + ".direction", m_spot_lights[i]->get_direction());
+        shader->set_vec3(base + ".color", m_spot_lights[i]->get_color());
+        shader->set_float(base + ".intensity", m_spot_lights[i]->get_intensity());
+        shader->set_float(base + ".range", m_spot_lights[i]->get_range());
+        shader->set_float(base + ".innerCutoff", m_spot_lights[i]->get_inner_cone());
+        shader->set_float(base + ".outerCutoff", m_spot_lights[i]->get_outer_cone());
     }
 }
 
 void Renderer::bind_material(std::shared_ptr<scene::Material> material, std::shared_ptr<renderer::Shader> shader) {
     if (!material || !shader)
         return;
-    if (material == m_last_bound_material)
+    // A variant that became ready mid-frame draws the next items of the same material with another program
+    if (material == m_last_bound_material && shader == m_last_bound_material_shader)
         return;
     material->bind(shader);
     m_last_bound_material = material;
+    m_last_bound_material_shader = shader;
 }
 
-void Renderer::clear_material_cache() { m_last_bound_material = nullptr; }
+void Renderer::clear_material_cache() {
+    m_last_bound_material = nullptr;
+    m_last_bound_material_shader = nullptr;
+    m_last_bound_vertex_array = nullptr;
+}
 
 void Renderer::resize(int width, int height) {
     m_window_width = width;
@@ -365,8 +690,28 @@ void Renderer::resize(int width, int height) {
         m_framebuffer->resize(width, height);
 }
 
+ShadowRenderer &Renderer::get_shadow_renderer() {
+    if (!m_shadow_renderer)
+        m_shadow_renderer = std::make_unique<ShadowRenderer>();
+    return *m_shadow_renderer;
+}
+
 void Renderer::setup_shadows(std::shared_ptr<scene::Scene> scene, std::shared_ptr<Shader> shader,
                             bool enable_point, bool enable_directional) {
+    setup_shadows(scene, shader, nullptr, enable_point, enable_directional);
+}
+
+void Renderer::set_shadow_cascades(unsigned int count) {
+    m_shadow_cascades = std::clamp(count, 1u, CascadedShadowMap::MAX_CASCADES);
+}
+
+void Renderer::set_shadow_atlas_size(unsigned int size) {
+    m_shadow_atlas_size = size;
+    m_shadow_atlas = nullptr;
+}
+
+void Renderer::setup_shadows(std::shared_ptr<scene::Scene> scene, std::shared_ptr<Shader> shader,
+                            std::shared_ptr<scene::Camera> camera, bool enable_point, bool enable_directional) {
     if (!scene || !shader)
         return;
 
@@ -375,39 +720,48 @@ void Renderer::setup_shadows(std::shared_ptr<scene::Scene> scene, std::shared_pt
         return;
     }
     m_shadow_enabled = true;
-    if (!m_shadow_renderer) {
-        m_shadow_renderer = std::make_unique<ShadowRenderer>();
-    }
-    auto lights = scene->get_lights();
-    std::shared_ptr<scene::Light> point_light = nullptr;
+    // Shadow indices follow the light uniforms of bind_lights()
+    collect_lights(scene);
     std::shared_ptr<scene::Light> directional_light = nullptr;
-    for (auto &light : lights) {
-        if (light->get_type() == scene::LightType::Point && !point_light) {
-            point_light = light;
-        }
-        if (light->get_type() == scene::LightType::Directional && !directional_light) {
-            directional_light = light;
+    m_shadow_dir_light = -1;
+    int num_dir_lights = std::min((int)m_directional_lights.size(), 4);
+    for (int i = 0; i < num_dir_lights && enable_directional; ++i) {
+        if (m_directional_lights[i]->casts_shadows()) {
+            directional_light = m_directional_lights[i];
+            m_shadow_dir_light = i;
+            break;
         }
     }
-    if (enable_point && point_light) {
-        if (!m_cubemap_shadow_map) {
-            int resolution = scene->get_shadow_resolution();
-            m_cubemap_shadow_map = std::make_shared<CubemapShadowMap>(resolution);
-        }
-        m_shadow_renderer->render_point_shadow(scene, point_light, m_cubemap_shadow_map);
-        m_shadow_light_pos = point_light->get_position();
-        m_shadow_far_plane = point_light->get_range();
+    m_atlas_lights.clear();
+    bool atlas_shadows = false;
+    if (enable_point) {
+        m_atlas_lights.insert(m_atlas_lights.end(), m_point_lights.begin(),
+                              m_point_lights.begin() + std::min((int)m_point_lights.size(), 16));
+        m_atlas_lights.insert(m_atlas_lights.end(), m_spot_lights.begin(),
+                              m_spot_lights.begin() + std::min((int)m_spot_lights.size(), 8));
+        for (const auto &light : m_atlas_lights)
+            atlas_shadows = atlas_shadows || light->casts_shadows();
+    }
+    if (atlas_shadows) {
+        if (!m_shadow_atlas)
+            m_shadow_atlas = std::make_shared<ShadowAtlas>(m_shadow_atlas_size);
+        get_shadow_renderer().render_atlas_shadows(scene, m_atlas_lights, m_shadow_atlas, camera,
+                                                   static_cast<float>(m_window_height));
     } else {
-        m_cubemap_shadow_map = nullptr;
+        m_shadow_atlas = nullptr;
+        m_atlas_lights.clear();
     }
     if (enable_directional && directional_light) {
-        if (!m_shadow_map) {
-            int resolution = scene->get_shadow_resolution();
-            m_shadow_map = std::make_shared<ShadowMap>(resolution, resolution);
+        auto resolution = static_cast<unsigned int>(scene->get_shadow_resolution());
+        if (!m_shadow_map || m_shadow_map->get_resolution() != resolution ||
+            m_shadow_map->get_cascade_count() != m_shadow_cascades) {
+            m_shadow_map = std::make_shared<CascadedShadowMap>(resolution, m_shadow_cascades);
         }
-        m_shadow_renderer->render_directional_shadow(scene, directional_light, m_shadow_map);
-        m_light_space_matrix =
-            m_shadow_renderer->get_light_space_matrix(directional_light, glm::vec3(0.0f, 2.0f, 0.0f), 20.0f);
+        if (camera)
+            m_shadow_map->fit(*camera, directional_light->get_direction());
+        else
+            m_shadow_map->fit_sphere(glm::vec3(0.0f, 2.0f, 0.0f), 20.0f, directional_light->get_direction());
+        get_shadow_renderer().render_cascaded_shadow(scene, directional_light, m_shadow_map);
     } else {
         m_shadow_map = nullptr;
     }
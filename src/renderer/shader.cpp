@@ -1,7 +1,12 @@
 #include "lmgl/renderer/shader.hpp"
+#include "lmgl/renderer/capabilities.hpp"
+#include "lmgl/renderer/program_cache.hpp"
 
 #include <glad/glad.h>
 
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <memory>
@@ -12,56 +17,247 @@ namespace lmgl {
 
 namespace renderer {
 
-std::unordered_map<std::string, std::shared_ptr<Shader>> ShaderLibrary::s_shaders;
+// Programs are measured by their driver binary, the closest thing to their GPU footprint. Asking for
+// the length of a program still linking would wait for it, so those are measured once poll() sees them done.
+core::ResourceCache<Shader> ShaderLibrary::s_shaders([](const Shader &shader) -> size_t {
+    GLint length = 0;
+    if (shader.poll() == Shader::State::Ready)
+        glGetProgramiv(shader.get_id(), GL_PROGRAM_BINARY_LENGTH, &length);
+    return static_cast<size_t>(length);
+});
+
+std::vector<std::pair<std::string, std::shared_ptr<Shader>>> ShaderLibrary::s_pending;
+
+// GL_COMPLETION_STATUS_KHR, newer than the generated loader
+constexpr GLenum COMPLETION_STATUS = 0x91B1;
+
+// Deeper nesting than this is taken for an include cycle
+constexpr int MAX_INCLUDE_DEPTH = 16;
 
 // Shader
 
+struct Shader::PendingBuild {
+    std::vector<unsigned int> stages;
+    std::vector<unsigned int> types;
+    uint64_t key = 0;
+    std::chrono::steady_clock::time_point start;
+};
+
+struct Shader::VariantSet {
+    std::vector<std::string> stages;
+    uint32_t features = 0;
+    std::unordered_map<uint32_t, std::shared_ptr<Shader>> shaders;
+};
+
+Shader::Shader() = default;
+
 Shader::Shader(const std::string &vert, const std::string &frag) {
-    unsigned int vertex_shader = compile_shader(GL_VERTEX_SHADER, vert);
-    unsigned int fragment_shader = compile_shader(GL_FRAGMENT_SHADER, frag);
-    m_renderer_id = create_program(vertex_shader, fragment_shader);
+    m_renderer_id = ProgramCache::get_or_build({vert, frag}, [&]() {
+        unsigned int vertex_shader = compile_shader(GL_VERTEX_SHADER, vert);
+        unsigned int fragment_shader = compile_shader(GL_FRAGMENT_SHADER, frag);
+        return create_program(vertex_shader, fragment_shader);
+    });
+    m_state = m_renderer_id != 0 ? State::Ready : State::Failed;
 }
 
 Shader::Shader(const std::string &vert, const std::string &geom, const std::string &frag) {
-    unsigned int vertex_shader = compile_shader(GL_VERTEX_SHADER, vert);
-    unsigned int geometry_shader = compile_shader(GL_GEOMETRY_SHADER, geom);
-    unsigned int fragment_shader = compile_shader(GL_FRAGMENT_SHADER, frag);
-    m_renderer_id = create_program(vertex_shader, geometry_shader, fragment_shader);
+    m_renderer_id = ProgramCache::get_or_build({vert, geom, frag}, [&]() {
+        unsigned int vertex_shader = compile_shader(GL_VERTEX_SHADER, vert);
+        unsigned int geometry_shader = compile_shader(GL_GEOMETRY_SHADER, geom);
+        unsigned int fragment_shader = compile_shader(GL_FRAGMENT_SHADER, frag);
+        return create_program(vertex_shader, geometry_shader, fragment_shader);
+    });
+    m_state = m_renderer_id != 0 ? State::Ready : State::Failed;
 }
 
-Shader::~Shader() { glDeleteProgram(m_renderer_id); }
+Shader::~Shader() {
+    if (m_pending) {
+        for (unsigned int stage : m_pending->stages)
+            glDeleteShader(stage);
+    }
+    glDeleteProgram(m_renderer_id);
+}
 
 std::shared_ptr<Shader> Shader::from_vf_files(const std::string &vert, const std::string &frag) {
-    std::string vertex_src = read_file(vert);
-    std::string fragment_src = read_file(frag);
+    std::string vertex_src = preprocess(read_file(vert), std::filesystem::path(vert).parent_path().string());
+    std::string fragment_src = preprocess(read_file(frag), std::filesystem::path(frag).parent_path().string());
     return std::make_shared<Shader>(vertex_src, fragment_src);
 }
 
 std::shared_ptr<Shader> Shader::from_vgf_files(const std::string &vert, const std::string &geom, const std::string &frag) {
-    std::string vertex_src = read_file(vert);
-    std::string geometry_src = read_file(geom);
-    std::string fragment_src = read_file(frag);
+    std::string vertex_src = preprocess(read_file(vert), std::filesystem::path(vert).parent_path().string());
+    std::string geometry_src = preprocess(read_file(geom), std::filesystem::path(geom).parent_path().string());
+    std::string fragment_src = preprocess(read_file(frag), std::filesystem::path(frag).parent_path().string());
     return std::make_shared<Shader>(vertex_src, geometry_src, fragment_src);
 }
 
-std::shared_ptr<Shader> Shader::from_glsl_file(const std::string &glsl) {
-    std::string src = read_file(glsl);
-    auto shaders = parse_glsl_shader(src);
+std::shared_ptr<Shader> Shader::from_glsl_file(const std::string &glsl, const std::vector<std::string> &defines) {
+    auto shaders = load_glsl_stages(glsl, defines);
     if (shaders.size() == 2) {
         return std::make_shared<Shader>(shaders[0], shaders[1]);
     } else if (shaders.size() == 3) {
         return std::make_shared<Shader>(shaders[0], shaders[1], shaders[2]);
     }
-    std::cerr << "ERROR: Invalid shader file format" << std::endl;
     return nullptr;
 }
 
-void Shader::bind() const { glUseProgram(m_renderer_id); }
+std::shared_ptr<Shader> Shader::from_glsl_file_with_variants(const std::string &glsl, uint32_t features) {
+    auto stages = load_glsl_stages(glsl, {});
+    std::shared_ptr<Shader> shader;
+    if (stages.size() == 2)
+        shader = std::make_shared<Shader>(stages[0], stages[1]);
+    else if (stages.size() == 3)
+        shader = std::make_shared<Shader>(stages[0], stages[1], stages[2]);
+    if (!shader)
+        return nullptr;
+    shader->m_variants = std::make_unique<VariantSet>();
+    shader->m_variants->stages = std::move(stages);
+    shader->m_variants->features = features & ALL_FEATURES;
+    return shader;
+}
+
+std::shared_ptr<Shader> Shader::compile_async(const std::string &vert, const std::string &frag) {
+    auto shader = std::shared_ptr<Shader>(new Shader());
+    shader->submit({GL_VERTEX_SHADER, GL_FRAGMENT_SHADER}, {vert, frag});
+    return shader;
+}
+
+std::shared_ptr<Shader> Shader::compile_async(const std::string &vert, const std::string &geom,
+                                              const std::string &frag) {
+    auto shader = std::shared_ptr<Shader>(new Shader());
+    shader->submit({GL_VERTEX_SHADER, GL_GEOMETRY_SHADER, GL_FRAGMENT_SHADER}, {vert, geom, frag});
+    return shader;
+}
+
+std::shared_ptr<Shader> Shader::from_glsl_file_async(const std::string &glsl,
+                                                     const std::vector<std::string> &defines) {
+    auto shaders = load_glsl_stages(glsl, defines);
+    if (shaders.size() == 2) {
+        return compile_async(shaders[0], shaders[1]);
+    } else if (shaders.size() == 3) {
+        return compile_async(shaders[0], shaders[1], shaders[2]);
+    }
+    return nullptr;
+}
+
+std::string Shader::preprocess(const std::string &src, const std::string &directory,
+                               const std::vector<std::string> &defines) {
+    std::vector<std::string> included;
+    std::string expanded = expand_includes(src, directory, included, 0);
+    if (defines.empty())
+        return expanded;
+    std::string block;
+    for (const auto &define : defines)
+        block += "#define " + define + "\n";
+    // #version has to stay the first directive of the stage
+    size_t version = expanded.find("#version");
+    if (version == std::string::npos)
+        return block + expanded;
+    size_t line_end = expanded.find('\n', version);
+    if (line_end == std::string::npos) {
+        expanded += '\n';
+        line_end = expanded.size() - 1;
+    }
+    expanded.insert(line_end + 1, block);
+    return expanded;
+}
+
+const char *Shader::get_feature_define(Feature feature) {
+    switch (feature) {
+    case AlbedoMap:
+        return "FEATURE_ALBEDO_MAP";
+    case NormalMap:
+        return "FEATURE_NORMAL_MAP";
+    case MetallicMap:
+        return "FEATURE_METALLIC_MAP";
+    case RoughnessMap:
+        return "FEATURE_ROUGHNESS_MAP";
+    case AoMap:
+        return "FEATURE_AO_MAP";
+    case EmissiveMap:
+        return "FEATURE_EMISSIVE_MAP";
+    case DirectionalShadow:
+        return "FEATURE_DIRECTIONAL_SHADOW";
+    case PointShadow:
+        return "FEATURE_POINT_SHADOW";
+    case EnvironmentMap:
+        return "FEATURE_ENVIRONMENT_MAP";
+    }
+    return "FEATURE_UNKNOWN";
+}
+
+uint32_t Shader::get_variant_features() const { return m_variants ? m_variants->features : 0; }
+
+std::shared_ptr<Shader> Shader::get_variant(uint32_t features) {
+    if (!m_variants)
+        return nullptr;
+    features &= m_variants->features;
+    auto it = m_variants->shaders.find(features);
+    if (it == m_variants->shaders.end()) {
+        std::vector<std::string> defines = {"LMGL_VARIANT"};
+        for (unsigned int bit = 0; bit < FEATURE_COUNT; ++bit) {
+            if (features & (1u << bit))
+                defines.push_back(get_feature_define(static_cast<Feature>(1u << bit)));
+        }
+        std::vector<std::string> stages;
+        for (const auto &stage : m_variants->stages)
+            stages.push_back(preprocess(stage, "", defines));
+        auto variant = stages.size() == 3 ? compile_async(stages[0], stages[1], stages[2])
+                                          : compile_async(stages[0], stages[1]);
+        variant->m_is_variant = true;
+        it = m_variants->shaders.emplace(features, variant).first;
+    }
+    return it->second->poll() == State::Ready ? it->second : nullptr;
+}
+
+size_t Shader::get_variant_count() const { return m_variants ? m_variants->shaders.size() : 0; }
+
+Shader::State Shader::poll() const {
+    if (!m_pending)
+        return m_state;
+    if (Capabilities::get_instance().has_parallel_shader_compile()) {
+        GLint done = GL_FALSE;
+        glGetProgramiv(m_renderer_id, COMPLETION_STATUS, &done);
+        if (!done)
+            return m_state;
+    }
+    finish();
+    return m_state;
+}
+
+Shader::State Shader::wait() const {
+    if (m_pending)
+        finish();
+    return m_state;
+}
+
+void Shader::bind() const {
+    wait();
+    glUseProgram(m_renderer_id);
+}
 
 void Shader::unbind() const { glUseProgram(0); }
 
 unsigned int Shader::get_id() const { return m_renderer_id; }
 
+int Shader::get_attribute_location(const std::string &name) const {
+    wait();
+    auto it = m_attribute_location_cache.find(name);
+    if (it != m_attribute_location_cache.end())
+        return it->second;
+    int loc = glGetAttribLocation(m_renderer_id, name.c_str());
+    m_attribute_location_cache[name] = loc;
+    return loc;
+}
+
+bool Shader::has_uniform(const std::string &name) const {
+    wait();
+    auto it = m_uniform_location_cache.find(name);
+    if (it == m_uniform_location_cache.end())
+        it = m_uniform_location_cache.emplace(name, glGetUniformLocation(m_renderer_id, name.c_str())).first;
+    return it->second != -1;
+}
+
 void Shader::set_int(const std::string &name, int val) { glUniform1i(get_uniform_location(name), val); }
 
 void Shader::set_int_array(const std::string &name, int *vals, unsigned int count) {
@@ -82,6 +278,11 @@ void Shader::set_vec4(const std::string &name, const glm::vec4 &val) {
     glUniform4f(get_uniform_location(name), val.x, val.y, val.z, val.w);
 }
 
+void Shader::set_vec4_array(const std::string &name, const glm::vec4 *vals, unsigned int count) {
+    if (count > 0)
+        glUniform4fv(get_uniform_location(name), count, &vals[0][0]);
+}
+
 void Shader::set_mat3(const std::string &name, const glm::mat3 &val) {
     glUniformMatrix3fv(get_uniform_location(name), 1, GL_FALSE, &val[0][0]);
 }
@@ -90,16 +291,21 @@ void Shader::set_mat4(const std::string &name, const glm::mat4 &val) {
     glUniformMatrix4fv(get_uniform_location(name), 1, GL_FALSE, &val[0][0]);
 }
 
+void Shader::set_mat4_array(const std::string &name, const glm::mat4 *vals, unsigned int count) {
+    if (count > 0)
+        glUniformMatrix4fv(get_uniform_location(name), count, GL_FALSE, &vals[0][0][0]);
+}
+
 int Shader::get_uniform_location(const std::string &name) const {
-    if (m_uniform_location_cache.find(name) != m_uniform_location_cache.end()) {
-        return m_uniform_location_cache[name];
-    }
+    wait();
+    auto it = m_uniform_location_cache.find(name);
+    if (it != m_uniform_location_cache.end())
+        return it->second;
     int loc = glGetUniformLocation(m_renderer_id, name.c_str());
-    if (loc == -1) {
+    // Variants compile out the uniforms of the features they lack
+    if (loc == -1 && !m_is_variant)
         std::cerr << "Warning: uniform '" << name << "' doesn't exist!" << std::endl;
-    } else {
-        m_uniform_location_cache[name] = loc;
-    }
+    m_uniform_location_cache[name] = loc;
     return loc;
 }
 
@@ -108,20 +314,7 @@ unsigned int Shader::compile_shader(unsigned int type, const std::string &source
     const char *src = source.c_str();
     glShaderSource(shader, 1, &src, nullptr);
     glCompileShader(shader);
-    int success;
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        int len;
-        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &len);
-        char *msg = new char[len];
-        glGetShaderInfoLog(shader, len, &len, msg);
-        const char* shader_type = 
-            type == GL_VERTEX_SHADER ? "VERTEX" :
-            type == GL_GEOMETRY_SHADER ? "GEOMETRY" :
-            type == GL_FRAGMENT_SHADER ? "FRAGMENT" : "UNKNOWN";
-        std::cerr << "ERROR: Shader compilation failed (" << shader_type << "):" << std::endl;
-        std::cerr << msg << std::endl;
-        delete[] msg;
+    if (!check_compile_status(shader, type)) {
         glDeleteShader(shader);
         return 0;
     }
@@ -132,19 +325,11 @@ unsigned int Shader::create_program(unsigned int vert, unsigned int frag) {
     if (vert == 0 || frag == 0)
         return 0;
     unsigned int program = glCreateProgram();
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     glAttachShader(program, vert);
     glAttachShader(program, frag);
     glLinkProgram(program);
-    int success;
-    glGetProgramiv(program, GL_LINK_STATUS, &success);
-    if (!success) {
-        int len;
-        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &len);
-        char *msg = new char[len];
-        glGetProgramInfoLog(program, len, &len, msg);
-        std::cerr << "ERROR: Shader program linking failed:" << std::endl;
-        std::cerr << msg << std::endl;
-        delete[] msg;
+    if (!check_link_status(program)) {
         glDeleteProgram(program);
         return 0;
     }
@@ -157,20 +342,12 @@ unsigned int Shader::create_program(unsigned int vert, unsigned int geom, unsign
     if (vert == 0 || geom == 0 || frag == 0)
         return 0;
     unsigned int program = glCreateProgram();
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     glAttachShader(program, vert);
     glAttachShader(program, geom);
     glAttachShader(program, frag);
     glLinkProgram(program);
-    int success;
-    glGetProgramiv(program, GL_LINK_STATUS, &success);
-    if (!success) {
-        int len;
-        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &len);
-        char *msg = new char[len];
-        glGetProgramInfoLog(program, len, &len, msg);
-        std::cerr << "ERROR: Shader program linking failed:" << std::endl;
-        std::cerr << msg << std::endl;
-        delete[] msg;
+    if (!check_link_status(program)) {
         glDeleteProgram(program);
         return 0;
     }
@@ -180,6 +357,88 @@ unsigned int Shader::create_program(unsigned int vert, unsigned int geom, unsign
     return program;
 }
 
+void Shader::submit(const std::vector<unsigned int> &types, const std::vector<std::string> &sources) {
+    auto start = std::chrono::steady_clock::now();
+    uint64_t key = ProgramCache::make_key(sources);
+    m_renderer_id = ProgramCache::load(key);
+    if (m_renderer_id != 0) {
+        m_state = State::Ready;
+        return;
+    }
+    // Nothing is queried between the calls, so the driver is free to build in the background
+    m_pending = std::make_unique<PendingBuild>();
+    m_pending->types = types;
+    m_pending->key = key;
+    m_pending->start = start;
+    m_renderer_id = glCreateProgram();
+    glProgramParameteri(m_renderer_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    for (size_t i = 0; i < types.size(); ++i) {
+        unsigned int stage = glCreateShader(types[i]);
+        const char *src = sources[i].c_str();
+        glShaderSource(stage, 1, &src, nullptr);
+        glCompileShader(stage);
+        glAttachShader(m_renderer_id, stage);
+        m_pending->stages.push_back(stage);
+    }
+    glLinkProgram(m_renderer_id);
+    m_state = State::Compiling;
+}
+
+void Shader::finish() const {
+    std::unique_ptr<PendingBuild> pending = std::move(m_pending);
+    // Link errors follow from compile errors, which say more
+    bool compiled = true;
+    for (size_t i = 0; i < pending->stages.size(); ++i)
+        compiled = check_compile_status(pending->stages[i], pending->types[i]) && compiled;
+    bool linked = compiled && check_link_status(m_renderer_id);
+    for (unsigned int stage : pending->stages) {
+        glDetachShader(m_renderer_id, stage);
+        glDeleteShader(stage);
+    }
+    ProgramCache::record_build(
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - pending->start).count());
+    if (!linked) {
+        glDeleteProgram(m_renderer_id);
+        m_renderer_id = 0;
+        m_state = State::Failed;
+        return;
+    }
+    ProgramCache::store(pending->key, m_renderer_id);
+    m_state = State::Ready;
+}
+
+bool Shader::check_compile_status(unsigned int shader, unsigned int type) {
+    int success;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (success)
+        return true;
+    int len;
+    glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &len);
+    std::vector<char> msg(static_cast<size_t>(std::max(len, 1)), '\0');
+    glGetShaderInfoLog(shader, len, &len, msg.data());
+    const char *shader_type = type == GL_VERTEX_SHADER     ? "VERTEX"
+                              : type == GL_GEOMETRY_SHADER ? "GEOMETRY"
+                              : type == GL_FRAGMENT_SHADER ? "FRAGMENT"
+                                                           : "UNKNOWN";
+    std::cerr << "ERROR: Shader compilation failed (" << shader_type << "):" << std::endl;
+    std::cerr << msg.data() << std::endl;
+    return false;
+}
+
+bool Shader::check_link_status(unsigned int program) {
+    int success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (success)
+        return true;
+    int len;
+    glGetProgramiv(program, GL_INFO_LOG_LENGTH, &len);
+    std::vector<char> msg(static_cast<size_t>(std::max(len, 1)), '\0');
+    glGetProgramInfoLog(program, len, &len, msg.data());
+    std::cerr << "ERROR: Shader program linking failed:" << std::endl;
+    std::cerr << msg.data() << std::endl;
+    return false;
+}
+
 std::string Shader::read_file(const std::string &fpath) {
     std::ifstream file(fpath);
     if (!file.is_open()) {
@@ -191,6 +450,49 @@ std::string Shader::read_file(const std::string &fpath) {
     return ss.str();
 }
 
+std::string Shader::expand_includes(const std::string &src, const std::string &directory,
+                                    std::vector<std::string> &included, int depth) {
+    if (depth > MAX_INCLUDE_DEPTH) {
+        std::cerr << "ERROR: Shader includes nested deeper than " << MAX_INCLUDE_DEPTH << " levels" << std::endl;
+        return "";
+    }
+    std::stringstream ss(src);
+    std::stringstream out;
+    std::string line;
+    while (std::getline(ss, line)) {
+        size_t start = line.find_first_not_of(" \t");
+        if (start == std::string::npos || line.compare(start, 8, "#include") != 0) {
+            out << line << '\n';
+            continue;
+        }
+        size_t open = line.find('"', start + 8);
+        size_t close = open == std::string::npos ? std::string::npos : line.find('"', open + 1);
+        if (close == std::string::npos) {
+            std::cerr << "ERROR: Invalid include directive: " << line << std::endl;
+            continue;
+        }
+        auto path = (std::filesystem::path(directory) / line.substr(open + 1, close - open - 1)).lexically_normal();
+        // Every file is pasted once, later includes of it are dropped
+        if (std::find(included.begin(), included.end(), path.string()) != included.end())
+            continue;
+        included.push_back(path.string());
+        out << expand_includes(read_file(path.string()), path.parent_path().string(), included, depth + 1);
+    }
+    return out.str();
+}
+
+std::vector<std::string> Shader::load_glsl_stages(const std::string &glsl, const std::vector<std::string> &defines) {
+    auto stages = parse_glsl_shader(read_file(glsl));
+    if (stages.size() != 2 && stages.size() != 3) {
+        std::cerr << "ERROR: Invalid shader file format" << std::endl;
+        return {};
+    }
+    std::string directory = std::filesystem::path(glsl).parent_path().string();
+    for (auto &stage : stages)
+        stage = preprocess(stage, directory, defines);
+    return stages;
+}
+
 std::vector<std::string> Shader::parse_glsl_shader(const std::string &src) {
     enum class ShaderType { NONE = -1, VERTEX = 0, GEOMETRY = 1, FRAGMENT = 2 };
     std::stringstream ss(src);
@@ -230,7 +532,7 @@ void ShaderLibrary::add(const std::string &name, std::shared_ptr<Shader> shader)
         std::cerr << "Error: Cannot add invalid shader '" << name << "' to the library!" << std::endl;
         return;
     }
-    s_shaders[name] = shader;
+    s_shaders.insert(name, shader, true);
 }
 
 std::shared_ptr<Shader> ShaderLibrary::load_vf(const std::string &name, const std::string &vert,
@@ -247,16 +549,68 @@ std::shared_ptr<Shader> ShaderLibrary::load_glsl(const std::string &name, const
 }
 
 std::shared_ptr<Shader> ShaderLibrary::get(const std::string &name) {
-    if (!exists(name)) {
+    auto shader = s_shaders.find(name);
+    if (!shader)
         std::cerr << "Error: Shader '" << name << "' not found in the library!" << std::endl;
-        return nullptr;
+    return shader;
+}
+
+size_t ShaderLibrary::warm_up(const std::vector<std::pair<std::string, std::string>> &shaders) {
+    size_t submitted = 0;
+    for (const auto &[name, glsl] : shaders) {
+        if (exists(name))
+            continue;
+        auto shader = Shader::from_glsl_file_async(glsl);
+        if (!shader)
+            continue;
+        s_shaders.insert(name, shader);
+        s_pending.emplace_back(name, shader);
+        ++submitted;
     }
-    return s_shaders[name];
+    return submitted;
 }
 
-bool ShaderLibrary::exists(const std::string &name) { return s_shaders.find(name) != s_shaders.end(); }
+size_t ShaderLibrary::poll() {
+    auto done = std::remove_if(s_pending.begin(), s_pending.end(), [](const auto &entry) {
+        const auto &[name, shader] = entry;
+        Shader::State state = shader->poll();
+        if (state == Shader::State::Compiling)
+            return false;
+        // Replaced or evicted while compiling
+        if (s_shaders.get(name) != shader)
+            return true;
+        if (state == Shader::State::Failed) {
+            std::cerr << "Error: Shader '" << name << "' failed to build, removed from the library!" << std::endl;
+            s_shaders.erase(name);
+        } else {
+            s_shaders.update_size(name);
+        }
+        return true;
+    });
+    s_pending.erase(done, s_pending.end());
+    return s_pending.size();
+}
+
+void ShaderLibrary::finish() {
+    for (const auto &entry : s_pending)
+        entry.second->wait();
+    poll();
+}
+
+bool ShaderLibrary::exists(const std::string &name) { return s_shaders.contains(name); }
+
+void ShaderLibrary::clear() {
+    s_pending.clear();
+    s_shaders.clear();
+}
+
+void ShaderLibrary::set_budget(size_t bytes) { s_shaders.set_budget(bytes); }
+
+size_t ShaderLibrary::get_budget() { return s_shaders.get_budget(); }
+
+const core::CacheStats &ShaderLibrary::get_stats() { return s_shaders.get_stats(); }
 
-void ShaderLibrary::clear() { s_shaders.clear(); }
+void ShaderLibrary::reset_stats() { s_shaders.reset_stats(); }
 
 } // namespace renderer
 
@@ -0,0 +1,199 @@
+#include "lmgl/renderer/shadow_atlas.hpp"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <iostream>
+#include <numeric>
+
+namespace lmgl {
+
+namespace renderer {
+
+namespace {
+
+unsigned int floor_power_of_two(unsigned int value) {
+    unsigned int power = 1;
+    while (power <= value / 2)
+        power *= 2;
+    return power;
+}
+
+// Every other bit of a Z-order index, the x or the y coordinate
+unsigned int compact_bits(uint64_t index) {
+    unsigned int value = 0;
+    for (unsigned int bit = 0; bit < 32; ++bit)
+        value |= static_cast<unsigned int>((index >> (2 * bit)) & 1u) << bit;
+    return value;
+}
+
+GLuint create_depth_texture(unsigned int size) {
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32F, size, size, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    return texture;
+}
+
+GLuint create_depth_framebuffer(GLuint texture) {
+    GLuint fbo = 0;
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, texture, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "ERROR: Shadow atlas framebuffer is not complete!" << std::endl;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    return fbo;
+}
+
+} // namespace
+
+ShadowAtlas::ShadowAtlas(unsigned int size, unsigned int min_tile_size, unsigned int max_tile_size)
+    : m_size(floor_power_of_two(std::max(size, 1u))) {
+    m_min_tile_size = std::min(floor_power_of_two(std::max(min_tile_size, 1u)), m_size);
+    m_max_tile_size = std::clamp(floor_power_of_two(std::max(max_tile_size, 1u)), m_min_tile_size, m_size);
+
+    m_depth_map = create_depth_texture(m_size);
+    m_static_depth_map = create_depth_texture(m_size);
+    m_fbo = create_depth_framebuffer(m_depth_map);
+    m_static_fbo = create_depth_framebuffer(m_static_depth_map);
+}
+
+ShadowAtlas::~ShadowAtlas() {
+    if (m_depth_map)
+        glDeleteTextures(1, &m_depth_map);
+    if (m_fbo)
+        glDeleteFramebuffers(1, &m_fbo);
+    if (m_static_depth_map)
+        glDeleteTextures(1, &m_static_depth_map);
+    if (m_static_fbo)
+        glDeleteFramebuffers(1, &m_static_fbo);
+}
+
+const std::vector<int> &ShadowAtlas::allocate(const std::vector<ShadowAtlasRequest> &requests) {
+    std::vector<unsigned int> sizes(requests.size(), 0);
+    for (size_t i = 0; i < requests.size(); ++i) {
+        if (requests[i].tile_count > 0)
+            sizes[i] = get_tile_size(static_cast<float>(requests[i].tile_size));
+    }
+    // Largest tiles first; the sort is stable so that equal requests keep their tiles between frames
+    std::vector<size_t> order(requests.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sizes[a] > sizes[b]; });
+    size_t kept = order.size();
+    while (kept > 0 && sizes[order[kept - 1]] == 0)
+        --kept;
+
+    uint64_t capacity = static_cast<uint64_t>(m_size) * m_size;
+    auto get_area = [&]() {
+        uint64_t area = 0;
+        for (size_t k = 0; k < kept; ++k) {
+            uint64_t size = sizes[order[k]];
+            area += size * size * requests[order[k]].tile_count;
+        }
+        return area;
+    };
+    while (kept > 0 && get_area() > capacity) {
+        unsigned int largest = sizes[order[0]];
+        if (largest > m_min_tile_size) {
+            // Halving the largest group keeps the order sorted
+            for (size_t k = 0; k < kept && sizes[order[k]] == largest; ++k)
+                sizes[order[k]] /= 2;
+        } else {
+            --kept;
+        }
+    }
+
+    // Aligned power-of-two squares taken in decreasing size tile the Z-order curve without gaps
+    m_tiles.clear();
+    m_first_tiles.assign(requests.size(), -1);
+    uint64_t offset = 0;
+    for (size_t k = 0; k < kept; ++k) {
+        size_t request = order[k];
+        uint64_t cells = sizes[request] / m_min_tile_size;
+        m_first_tiles[request] = static_cast<int>(m_tiles.size());
+        for (unsigned int i = 0; i < requests[request].tile_count; ++i) {
+            ShadowAtlasTile tile;
+            tile.x = compact_bits(offset) * m_min_tile_size;
+            tile.y = compact_bits(offset >> 1) * m_min_tile_size;
+            tile.size = sizes[request];
+            m_tiles.push_back(tile);
+            offset += cells * cells;
+        }
+    }
+    m_tile_caches.resize(m_tiles.size());
+    return m_first_tiles;
+}
+
+unsigned int ShadowAtlas::get_tile_size(float screen_size) const {
+    unsigned int size = m_min_tile_size;
+    while (size < m_max_tile_size && static_cast<float>(size) < screen_size)
+        size *= 2;
+    return size;
+}
+
+void ShadowAtlas::bind_tile(unsigned int tile) {
+    bind_region(m_fbo, tile);
+    // The clear only touches the tile, the other lights keep their depth
+    glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+void ShadowAtlas::bind_static_tile(unsigned int tile) {
+    bind_region(m_static_fbo, tile);
+    glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+void ShadowAtlas::composite_tile(unsigned int tile) {
+    const ShadowAtlasTile &region = m_tiles[tile];
+    GLint x0 = static_cast<GLint>(region.x);
+    GLint y0 = static_cast<GLint>(region.y);
+    GLint x1 = x0 + static_cast<GLint>(region.size);
+    GLint y1 = y0 + static_cast<GLint>(region.size);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_static_fbo);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_fbo);
+    glDisable(GL_SCISSOR_TEST);
+    glBlitFramebuffer(x0, y0, x1, y1, x0, y0, x1, y1, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    bind_region(m_fbo, tile);
+}
+
+void ShadowAtlas::bind_region(unsigned int fbo, unsigned int tile) {
+    const ShadowAtlasTile &region = m_tiles[tile];
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glViewport(region.x, region.y, region.size, region.size);
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(region.x, region.y, region.size, region.size);
+}
+
+void ShadowAtlas::unbind() {
+    glDisable(GL_SCISSOR_TEST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void ShadowAtlas::bind_texture(unsigned int slot) const {
+    glActiveTexture(GL_TEXTURE0 + slot);
+    glBindTexture(GL_TEXTURE_2D, m_depth_map);
+}
+
+glm::vec4 ShadowAtlas::get_tile_rect(unsigned int tile) const {
+    const ShadowAtlasTile &region = m_tiles[tile];
+    float size = static_cast<float>(m_size);
+    return glm::vec4(static_cast<float>(region.x) / size, static_cast<float>(region.y) / size,
+                     static_cast<float>(region.size) / size, static_cast<float>(region.size) / size);
+}
+
+int ShadowAtlas::get_first_tile(unsigned int request) const {
+    return request < m_first_tiles.size() ? m_first_tiles[request] : -1;
+}
+
+void ShadowAtlas::invalidate() { std::fill(m_tile_caches.begin(), m_tile_caches.end(), ShadowAtlasTileCache()); }
+
+} // namespace renderer
+
+} // namespace lmgl
@@ -2,7 +2,10 @@
 #include "lmgl/renderer/shader.hpp"
 #include "lmgl/renderer/texture.hpp"
 
-#include <functional>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
 #include <iostream>
 #include <memory>
 
@@ -10,6 +13,119 @@ namespace lmgl {
 
 namespace renderer {
 
+namespace {
+
+// The shadow frustum without its near plane: casters between the light and the volume still shade it
+bool overlaps_extruded_frustum(const scene::Frustum &frustum, const scene::BoundingSphere &sphere) {
+    for (auto index : {scene::Frustum::Left, scene::Frustum::Right, scene::Frustum::Bottom, scene::Frustum::Top,
+                       scene::Frustum::Far}) {
+        if (frustum.get_plane(index).distance_to_point(sphere.center) < -sphere.radius)
+            return false;
+    }
+    return true;
+}
+
+// Directions and up vectors of the cube faces, +X, -X, +Y, -Y, +Z, -Z; pbr.glsl uses the same
+const glm::vec3 CUBE_FACE_DIRECTIONS[6] = {glm::vec3(1.0f, 0.0f, 0.0f),  glm::vec3(-1.0f, 0.0f, 0.0f),
+                                           glm::vec3(0.0f, 1.0f, 0.0f),  glm::vec3(0.0f, -1.0f, 0.0f),
+                                           glm::vec3(0.0f, 0.0f, 1.0f),  glm::vec3(0.0f, 0.0f, -1.0f)};
+const glm::vec3 CUBE_FACE_UPS[6] = {glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+                                    glm::vec3(0.0f, 0.0f, 1.0f),  glm::vec3(0.0f, 0.0f, -1.0f),
+                                    glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)};
+
+// Sphere around what a spot or point light can reach
+scene::BoundingSphere get_light_volume(const scene::Light &light) {
+    float range = light.get_range();
+    if (light.get_type() != scene::LightType::Spot || light.get_outer_cone() > glm::radians(45.0f))
+        return scene::BoundingSphere(light.get_position(), range);
+    // Centered halfway along the cone, through its apex and the rim of its base
+    float base_radius = range * std::tan(light.get_outer_cone());
+    float radius = std::sqrt(0.25f * range * range + base_radius * base_radius);
+    return scene::BoundingSphere(light.get_position() + light.get_direction() * (0.5f * range), radius);
+}
+
+// 64-bit FNV-1a, the hash of the model and program caches
+uint64_t hash(const void *data, std::size_t size, uint64_t h = 14695981039346656037ull) {
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    for (std::size_t i = 0; i < size; ++i) {
+        h ^= bytes[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+uint64_t hash_matrix(const glm::mat4 &matrix, uint64_t h) {
+    for (int column = 0; column < 4; ++column) {
+        for (int row = 0; row < 4; ++row) {
+            float value = matrix[column][row];
+            h = hash(&value, sizeof(value), h);
+        }
+    }
+    return h;
+}
+
+// Meshes are hashed by id, a freed mesh's address may be reused by a different one
+uint64_t hash_caster(const scene::Mesh *mesh, const glm::mat4 &transform, uint64_t h) {
+    uint64_t uid = mesh->get_uid();
+    h = hash(&uid, sizeof(uid), h);
+    return hash_matrix(transform, h);
+}
+
+// Picks the next slice of a mask in round-robin order, so every stale slice gets its turn
+unsigned int pick_slice(unsigned int mask, unsigned int count, unsigned int &next) {
+    for (unsigned int i = 0; i < count; ++i) {
+        unsigned int slice = (next + i) % count;
+        if (mask & (1u << slice)) {
+            next = (slice + 1) % count;
+            return 1u << slice;
+        }
+    }
+    return 0;
+}
+
+// Layered depth texture for the cascades, the shadow map and its static cache share the layout
+GLuint create_depth_array(unsigned int resolution, unsigned int layers) {
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT32F, resolution, resolution, layers, 0,
+                 GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+    float border_color[] = {1.0f, 1.0f, 1.0f, 1.0f};
+    glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, border_color);
+    return texture;
+}
+
+GLuint create_depth_cubemap(unsigned int resolution) {
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+    for (unsigned int i = 0; i < 6; ++i) {
+        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_DEPTH_COMPONENT, resolution, resolution, 0,
+                     GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+    }
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    return texture;
+}
+
+// Copies the depth attached to one framebuffer into the other, both the size of a shadow map slice
+void copy_depth(GLuint read_fbo, GLuint draw_fbo, unsigned int resolution) {
+    GLint size = static_cast<GLint>(resolution);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, read_fbo);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, draw_fbo);
+    glBlitFramebuffer(0, 0, size, size, 0, 0, size, size, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, draw_fbo);
+}
+
+} // namespace
+
 ShadowMap::ShadowMap(unsigned int width, unsigned int height) : m_width(width), m_height(height) {
     glGenFramebuffers(1, &m_fbo);
     glGenTextures(1, &m_depth_map);
@@ -58,25 +174,144 @@ void ShadowMap::resize(unsigned int width, unsigned int height) {
     glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, width, height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
 }
 
-CubemapShadowMap::CubemapShadowMap(unsigned int resolution) : m_resolution(resolution) {
+CascadedShadowMap::CascadedShadowMap(unsigned int resolution, unsigned int cascade_count)
+    : m_resolution(resolution), m_cascade_count(std::clamp(cascade_count, 1u, MAX_CASCADES)) {
+    for (unsigned int i = 0; i < MAX_CASCADES; ++i) {
+        m_matrices[i] = glm::mat4(1.0f);
+        m_shadow_matrices[i] = glm::mat4(1.0f);
+    }
+    m_depth_array = create_depth_array(resolution, m_cascade_count);
+    m_static_depth_array = create_depth_array(resolution, m_cascade_count);
     glGenFramebuffers(1, &m_fbo);
-    glGenTextures(1, &m_depth_cubemap);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, m_depth_cubemap);
-    for (unsigned int i = 0; i < 6; ++i) {
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_DEPTH_COMPONENT, resolution, resolution, 0,
-                     GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+    glGenFramebuffers(1, &m_static_fbo);
+    for (GLuint fbo : {m_fbo, m_static_fbo}) {
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                                  fbo == m_fbo ? m_depth_array : m_static_depth_array, 0, 0);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cerr << "ERROR: Cascaded shadow map framebuffer is not complete!" << std::endl;
+        }
     }
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+CascadedShadowMap::~CascadedShadowMap() {
+    if (m_depth_array)
+        glDeleteTextures(1, &m_depth_array);
+    if (m_static_depth_array)
+        glDeleteTextures(1, &m_static_depth_array);
+    if (m_fbo)
+        glDeleteFramebuffers(1, &m_fbo);
+    if (m_static_fbo)
+        glDeleteFramebuffers(1, &m_static_fbo);
+}
+
+void CascadedShadowMap::bind(unsigned int cascade) {
     glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
-    glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_depth_cubemap, 0);
-    glDrawBuffer(GL_NONE);
-    glReadBuffer(GL_NONE);
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-        std::cerr << "ERROR: Cubemap shadow map framebuffer is not complete!" << std::endl;
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_depth_array, 0, cascade);
+    glViewport(0, 0, m_resolution, m_resolution);
+    glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+void CascadedShadowMap::unbind() { glBindFramebuffer(GL_FRAMEBUFFER, 0); }
+
+void CascadedShadowMap::bind_texture(unsigned int slot) const {
+    glActiveTexture(GL_TEXTURE0 + slot);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_depth_array);
+}
+
+void CascadedShadowMap::set_split_lambda(float lambda) { m_split_lambda = std::clamp(lambda, 0.0f, 1.0f); }
+
+void CascadedShadowMap::fit(const scene::Camera &camera, const glm::vec3 &light_direction) {
+    // Corners of the near and far planes, in world space
+    glm::mat4 inverse = glm::inverse(camera.get_view_projection_matrix());
+    glm::vec3 near_corners[4];
+    glm::vec3 far_corners[4];
+    for (int i = 0; i < 4; ++i) {
+        float x = (i & 1) ? 1.0f : -1.0f;
+        float y = (i & 2) ? 1.0f : -1.0f;
+        glm::vec4 near_corner = inverse * glm::vec4(x, y, -1.0f, 1.0f);
+        glm::vec4 far_corner = inverse * glm::vec4(x, y, 1.0f, 1.0f);
+        near_corners[i] = glm::vec3(near_corner) / near_corner.w;
+        far_corners[i] = glm::vec3(far_corner) / far_corner.w;
+    }
+    const glm::mat4 &view = camera.get_view_matrix();
+    float near_plane = -(view * glm::vec4(near_corners[0], 1.0f)).z;
+    float far_plane = -(view * glm::vec4(far_corners[0], 1.0f)).z;
+    float shadow_far = std::min(m_max_distance, far_plane);
+    glm::vec3 direction = glm::normalize(light_direction);
+
+    float slice_near = near_plane;
+    for (unsigned int cascade = 0; cascade < m_cascade_count; ++cascade) {
+        float t = static_cast<float>(cascade + 1) / static_cast<float>(m_cascade_count);
+        float uniform = near_plane + (shadow_far - near_plane) * t;
+        // The logarithmic split needs a positive near plane, which orthographic cameras may not have
+        float logarithmic = near_plane > 0.0f ? near_plane * std::pow(shadow_far / near_plane, t) : uniform;
+        float slice_far = m_split_lambda * logarithmic + (1.0f - m_split_lambda) * uniform;
+        m_splits[cascade] = slice_far;
+
+        // View depth is linear along each corner edge, for perspective and orthographic cameras alike
+        glm::vec3 corners[8];
+        glm::vec3 center(0.0f);
+        for (int i = 0; i < 4; ++i) {
+            glm::vec3 edge = far_corners[i] - near_corners[i];
+            corners[i] = near_corners[i] + edge * ((slice_near - near_plane) / (far_plane - near_plane));
+            corners[i + 4] = near_corners[i] + edge * ((slice_far - near_plane) / (far_plane - near_plane));
+            center += corners[i] + corners[i + 4];
+        }
+        center /= 8.0f;
+        float radius = 0.0f;
+        for (const auto &corner : corners)
+            radius = std::max(radius, glm::length(corner - center));
+        fit_cascade(cascade, center, radius, direction);
+        slice_near = slice_far;
+    }
+    m_active_cascades = m_cascade_count;
+}
+
+void CascadedShadowMap::fit_sphere(const glm::vec3 &center, float radius, const glm::vec3 &light_direction) {
+    fit_cascade(0, center, radius, glm::normalize(light_direction));
+    m_splits[0] = radius;
+    m_active_cascades = 1;
+}
+
+void CascadedShadowMap::fit_cascade(unsigned int cascade, const glm::vec3 &center, float radius,
+                                    const glm::vec3 &light_direction) {
+    // A size that only depends on the slice keeps texels the same size while the camera turns
+    radius = std::ceil(radius * 16.0f) / 16.0f;
+    m_bounds[cascade] = scene::BoundingSphere(center, radius);
+    glm::vec3 up =
+        std::abs(light_direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::mat4 light_view = glm::lookAt(glm::vec3(0.0f), light_direction, up);
+    // Move the volume in whole texels, so a moving camera does not make the shadow edges crawl. Snapping the depth
+    // as well keeps the matrix identical between small camera moves, which the static caster cache relies on.
+    float texel = 2.0f * radius / static_cast<float>(m_resolution);
+    glm::vec4 light_center = light_view * glm::vec4(center, 1.0f);
+    float x = std::round(light_center.x / texel) * texel;
+    float y = std::round(light_center.y / texel) * texel;
+    float z = std::round(light_center.z / texel) * texel;
+    // The eye sits radius behind the center, against the light direction
+    light_view[3] = glm::vec4(-x, -y, -z - radius, 1.0f);
+    glm::mat4 light_projection = glm::ortho(-radius, radius, -radius, radius, 0.0f, 2.0f * radius);
+    m_matrices[cascade] = light_projection * light_view;
+}
+
+CubemapShadowMap::CubemapShadowMap(unsigned int resolution) : m_resolution(resolution) {
+    m_depth_cubemap = create_depth_cubemap(resolution);
+    m_static_cubemap = create_depth_cubemap(resolution);
+    glGenFramebuffers(1, &m_fbo);
+    glGenFramebuffers(1, &m_static_fbo);
+    for (GLuint fbo : {m_fbo, m_static_fbo}) {
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, fbo == m_fbo ? m_depth_cubemap : m_static_cubemap,
+                             0);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cerr << "ERROR: Cubemap shadow map framebuffer is not complete!" << std::endl;
+        }
     }
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
@@ -84,8 +319,12 @@ CubemapShadowMap::CubemapShadowMap(unsigned int resolution) : m_resolution(resol
 CubemapShadowMap::~CubemapShadowMap() {
     if (m_depth_cubemap)
         glDeleteTextures(1, &m_depth_cubemap);
+    if (m_static_cubemap)
+        glDeleteTextures(1, &m_static_cubemap);
     if (m_fbo)
         glDeleteFramebuffers(1, &m_fbo);
+    if (m_static_fbo)
+        glDeleteFramebuffers(1, &m_static_fbo);
 }
 
 void CubemapShadowMap::bind(unsigned int face) {
@@ -105,6 +344,7 @@ void CubemapShadowMap::bind_texture(unsigned int slot) const {
 ShadowRenderer::ShadowRenderer() {
     m_depth_shader = Shader::from_glsl_file("shaders/dir_light_depth.glsl");
     m_depth_cubemap_shader = Shader::from_glsl_file("shaders/pt_light_depth.glsl");
+    m_atlas_depth_shader = Shader::from_glsl_file("shaders/atlas_depth.glsl");
 }
 
 void ShadowRenderer::render_directional_shadow(std::shared_ptr<scene::Scene> scene, std::shared_ptr<scene::Light> light,
@@ -117,10 +357,11 @@ void ShadowRenderer::render_directional_shadow(std::shared_ptr<scene::Scene> sce
     GLint cull_face_mode;
     glGetIntegerv(GL_CULL_FACE_MODE, &cull_face_mode);
 
-    glm::mat4 light_space_matrix = get_light_space_matrix(light, glm::vec3(0.0f, 2.0f, 0.0f), 20.0f);
+    glm::vec3 scene_center(0.0f, 2.0f, 0.0f);
+    glm::mat4 light_space_matrix = get_light_space_matrix(light, scene_center, 20.0f);
     shadow_map->bind();
     glCullFace(GL_FRONT);
-    render_scene_depth(scene, light_space_matrix);
+    render_scene_depth(scene, light_space_matrix, scene_center);
     shadow_map->unbind();
     m_depth_shader->unbind();
 
@@ -128,27 +369,222 @@ void ShadowRenderer::render_directional_shadow(std::shared_ptr<scene::Scene> sce
     glCullFace(cull_face_mode);
 }
 
-void ShadowRenderer::render_point_shadow(std::shared_ptr<scene::Scene> scene, std::shared_ptr<scene::Light> light,
-                                         std::shared_ptr<CubemapShadowMap> shadow_map) {
-    if (!scene || !light || !shadow_map)
+void ShadowRenderer::render_cascaded_shadow(std::shared_ptr<scene::Scene> scene, std::shared_ptr<scene::Light> light,
+                                            std::shared_ptr<CascadedShadowMap> shadow_map) {
+    if (!scene || !light || !shadow_map || shadow_map->get_active_cascade_count() == 0)
+        return;
+
+    unsigned int cascade_count = shadow_map->get_active_cascade_count();
+    ShadowCacheState &cache = shadow_map->get_cache_state();
+    m_directional_stats = ShadowPassStats();
+    m_casters.clear();
+    collect_casters(scene->get_root(), glm::mat4(1.0f), shadow_map->get_bounds(0).center);
+
+    // Static casters are keyed against the fitted volumes, to find the cascades whose cache is stale
+    std::vector<unsigned int> static_masks(m_casters.size(), 0);
+    uint64_t static_keys[CascadedShadowMap::MAX_CASCADES];
+    unsigned int stale = 0;
+    unsigned int unrendered = 0;
+    for (unsigned int cascade = 0; cascade < cascade_count; ++cascade) {
+        const glm::mat4 &matrix = shadow_map->get_light_space_matrix(cascade);
+        scene::Frustum frustum;
+        frustum.update(matrix);
+        static_keys[cascade] = hash_matrix(matrix, hash(&cascade, sizeof(cascade)));
+        for (size_t i = 0; i < m_casters.size(); ++i) {
+            const auto &caster = m_casters[i];
+            if (!caster.is_static || (m_caster_culling && !overlaps_extruded_frustum(frustum, caster.bounds)))
+                continue;
+            static_masks[i] |= 1u << cascade;
+            static_keys[cascade] = hash_caster(caster.mesh.get(), caster.transform, static_keys[cascade]);
+        }
+        if (static_keys[cascade] != cache.static_keys[cascade])
+            stale |= 1u << cascade;
+        if (cache.static_keys[cascade] == 0)
+            unrendered |= 1u << cascade;
+    }
+    // The first cascade covers what is nearest to the camera and is never left behind
+    unsigned int refresh = stale;
+    if (m_time_slicing) {
+        refresh = stale & (unrendered | 1u);
+        refresh |= pick_slice(stale & ~refresh, cascade_count, cache.next_slice);
+    }
+    for (unsigned int cascade = 0; cascade < cascade_count; ++cascade) {
+        if (refresh & (1u << cascade))
+            shadow_map->set_shadow_matrix(cascade, shadow_map->get_light_space_matrix(cascade));
+    }
+
+    // Dynamic casters are drawn with the volume each cascade is sampled with
+    std::vector<unsigned int> dynamic_masks(m_casters.size(), 0);
+    uint64_t dynamic_keys[CascadedShadowMap::MAX_CASCADES];
+    unsigned int composite = refresh;
+    for (unsigned int cascade = 0; cascade < cascade_count; ++cascade) {
+        const glm::mat4 &matrix = shadow_map->get_shadow_matrix(cascade);
+        scene::Frustum frustum;
+        frustum.update(matrix);
+        dynamic_keys[cascade] = hash_matrix(matrix, hash(&cascade, sizeof(cascade)));
+        for (size_t i = 0; i < m_casters.size(); ++i) {
+            const auto &caster = m_casters[i];
+            if (caster.is_static || (m_caster_culling && !overlaps_extruded_frustum(frustum, caster.bounds)))
+                continue;
+            dynamic_masks[i] |= 1u << cascade;
+            dynamic_keys[cascade] = hash_caster(caster.mesh.get(), caster.transform, dynamic_keys[cascade]);
+        }
+        if (dynamic_keys[cascade] != cache.dynamic_keys[cascade])
+            composite |= 1u << cascade;
+    }
+    for (size_t i = 0; i < m_casters.size(); ++i) {
+        if ((static_masks[i] | dynamic_masks[i]) == 0)
+            ++m_directional_stats.culled;
+        else if ((static_masks[i] & refresh) | (dynamic_masks[i] & composite))
+            ++m_directional_stats.casters;
+        else
+            ++m_directional_stats.cached;
+    }
+    if (composite == 0)
         return;
 
     GLint viewport[4];
     glGetIntegerv(GL_VIEWPORT, viewport);
     GLint cull_face_mode;
     glGetIntegerv(GL_CULL_FACE_MODE, &cull_face_mode);
+    glCullFace(GL_FRONT);
+    // Casters in front of the near plane are flattened onto it rather than clipped away
+    GLboolean depth_clamp = glIsEnabled(GL_DEPTH_CLAMP);
+    glEnable(GL_DEPTH_CLAMP);
+    glViewport(0, 0, shadow_map->get_resolution(), shadow_map->get_resolution());
+    m_depth_shader->bind();
+
+    const VertexArray *bound_vertex_array = nullptr;
+    auto draw_casters = [&](const std::vector<unsigned int> &masks, unsigned int cascade) {
+        for (size_t i = 0; i < m_casters.size(); ++i) {
+            if (!(masks[i] & (1u << cascade)))
+                continue;
+            const auto &caster = m_casters[i];
+            m_depth_shader->set_mat4("u_Model", caster.transform);
+            auto vertex_array = caster.mesh->get_depth_vertex_array();
+            if (vertex_array && vertex_array.get() != bound_vertex_array) {
+                vertex_array->bind();
+                bound_vertex_array = vertex_array.get();
+            }
+            caster.mesh->render_depth();
+            ++m_directional_stats.cascade_casters[cascade];
+            m_directional_stats.triangles += caster.mesh->get_index_count() / 3;
+        }
+    };
+    for (unsigned int cascade = 0; cascade < cascade_count; ++cascade) {
+        if (!(composite & (1u << cascade)))
+            continue;
+        m_depth_shader->set_mat4("u_LightSpaceMatrix", shadow_map->get_shadow_matrix(cascade));
+        glBindFramebuffer(GL_FRAMEBUFFER, shadow_map->get_static_fbo());
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, shadow_map->get_static_texture_id(), 0,
+                                  cascade);
+        if (refresh & (1u << cascade)) {
+            glClear(GL_DEPTH_BUFFER_BIT);
+            draw_casters(static_masks, cascade);
+            cache.static_keys[cascade] = static_keys[cascade];
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, shadow_map->get_fbo());
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, shadow_map->get_texture_id(), 0, cascade);
+        copy_depth(shadow_map->get_static_fbo(), shadow_map->get_fbo(), shadow_map->get_resolution());
+        draw_casters(dynamic_masks, cascade);
+        cache.dynamic_keys[cascade] = dynamic_keys[cascade];
+        ++m_directional_stats.updated_slices;
+    }
+    if (!depth_clamp)
+        glDisable(GL_DEPTH_CLAMP);
+    shadow_map->unbind();
+    m_depth_shader->unbind();
+
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    glCullFace(cull_face_mode);
+}
+
+void ShadowRenderer::render_point_shadow(std::shared_ptr<scene::Scene> scene, std::shared_ptr<scene::Light> light,
+                                         std::shared_ptr<CubemapShadowMap> shadow_map) {
+    if (!scene || !light || !shadow_map)
+        return;
 
     glm::vec3 light_pos = light->get_position();
     float far_plane = light->get_range();
     glm::mat4 shadow_proj = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, far_plane);
     
-    std::vector<glm::mat4> shadow_transforms;
-    shadow_transforms.push_back(shadow_proj * glm::lookAt(light_pos, light_pos + glm::vec3( 1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)));
-    shadow_transforms.push_back(shadow_proj * glm::lookAt(light_pos, light_pos + glm::vec3(-1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)));
-    shadow_transforms.push_back(shadow_proj * glm::lookAt(light_pos, light_pos + glm::vec3( 0.0f,  1.0f,  0.0f), glm::vec3(0.0f,  0.0f,  1.0f)));
-    shadow_transforms.push_back(shadow_proj * glm::lookAt(light_pos, light_pos + glm::vec3( 0.0f, -1.0f,  0.0f), glm::vec3(0.0f,  0.0f, -1.0f)));
-    shadow_transforms.push_back(shadow_proj * glm::lookAt(light_pos, light_pos + glm::vec3( 0.0f,  0.0f,  1.0f), glm::vec3(0.0f, -1.0f,  0.0f)));
-    shadow_transforms.push_back(shadow_proj * glm::lookAt(light_pos, light_pos + glm::vec3( 0.0f,  0.0f, -1.0f), glm::vec3(0.0f, -1.0f,  0.0f)));
+    std::array<glm::mat4, 6> shadow_transforms;
+    for (unsigned int i = 0; i < 6; ++i)
+        shadow_transforms[i] =
+            shadow_proj * glm::lookAt(light_pos, light_pos + CUBE_FACE_DIRECTIONS[i], CUBE_FACE_UPS[i]);
+
+    ShadowCacheState &cache = shadow_map->get_cache_state();
+    m_point_stats = ShadowPassStats();
+    m_casters.clear();
+    collect_casters(scene->get_root(), glm::mat4(1.0f), light_pos);
+    std::array<scene::Frustum, 6> face_frustums;
+    for (unsigned int i = 0; i < 6; ++i)
+        face_frustums[i].update(shadow_transforms[i]);
+
+    // Every face shares the light position and range, a moving light makes the whole cube stale
+    uint64_t light_key = hash(&light_pos, sizeof(light_pos));
+    light_key = hash(&far_plane, sizeof(far_plane), light_key);
+    std::vector<unsigned int> face_masks(m_casters.size(), 0);
+    uint64_t static_keys[6];
+    uint64_t dynamic_keys[6];
+    for (unsigned int face = 0; face < 6; ++face) {
+        static_keys[face] = hash(&face, sizeof(face), light_key);
+        dynamic_keys[face] = static_keys[face];
+    }
+    for (size_t i = 0; i < m_casters.size(); ++i) {
+        const auto &caster = m_casters[i];
+        unsigned int face_mask = 0x3f;
+        if (m_caster_culling) {
+            face_mask = 0;
+            if (glm::length(caster.bounds.center - light_pos) - caster.bounds.radius <= far_plane) {
+                for (unsigned int face = 0; face < 6; ++face) {
+                    if (face_frustums[face].contains_sphere(caster.bounds))
+                        face_mask |= 1u << face;
+                }
+            }
+        }
+        face_masks[i] = face_mask;
+        uint64_t *keys = caster.is_static ? static_keys : dynamic_keys;
+        for (unsigned int face = 0; face < 6; ++face) {
+            if (face_mask & (1u << face))
+                keys[face] = hash_caster(caster.mesh.get(), caster.transform, keys[face]);
+        }
+    }
+    unsigned int stale = 0;
+    unsigned int unrendered = 0;
+    unsigned int composite = 0;
+    for (unsigned int face = 0; face < 6; ++face) {
+        if (static_keys[face] != cache.static_keys[face])
+            stale |= 1u << face;
+        if (cache.static_keys[face] == 0)
+            unrendered |= 1u << face;
+        if (dynamic_keys[face] != cache.dynamic_keys[face])
+            composite |= 1u << face;
+    }
+    unsigned int refresh = stale;
+    if (m_time_slicing && light_key == cache.light_key) {
+        refresh = stale & unrendered;
+        refresh |= pick_slice(stale & ~refresh, 6, cache.next_slice);
+    }
+    composite |= refresh;
+    cache.light_key = light_key;
+
+    for (size_t i = 0; i < m_casters.size(); ++i) {
+        unsigned int drawn = face_masks[i] & (m_casters[i].is_static ? refresh : composite);
+        if (face_masks[i] == 0)
+            ++m_point_stats.culled;
+        else if (drawn)
+            ++m_point_stats.casters;
+        else
+            ++m_point_stats.cached;
+    }
+    if (composite == 0)
+        return;
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    GLint cull_face_mode;
+    glGetIntegerv(GL_CULL_FACE_MODE, &cull_face_mode);
 
     m_depth_cubemap_shader->bind();
     m_depth_cubemap_shader->set_vec3("u_LightPos", light_pos);
@@ -156,33 +592,65 @@ void ShadowRenderer::render_point_shadow(std::shared_ptr<scene::Scene> scene, st
     for (unsigned int i = 0; i < 6; ++i) {
         m_depth_cubemap_shader->set_mat4("u_ShadowMatrices[" + std::to_string(i) + "]", shadow_transforms[i]);
     }
-
-    glBindFramebuffer(GL_FRAMEBUFFER, shadow_map->get_fbo());
     glViewport(0, 0, shadow_map->get_resolution(), shadow_map->get_resolution());
-    glClear(GL_DEPTH_BUFFER_BIT);
     glCullFace(GL_FRONT);
 
-    std::function<void(std::shared_ptr<scene::Node>, const glm::mat4&)> traverse;
-    traverse = [&](std::shared_ptr<scene::Node> node, const glm::mat4& parent_transform) {
-        if (!node)
-            return;
-        glm::mat4 transform = parent_transform * node->get_local_transform();
-        auto mesh = node->get_mesh();
-        if (mesh) {
-            auto material = mesh->get_material();
-            bool is_emissive = material && glm::length(material->get_emissive()) > 0.0f;
-            if (!is_emissive) {
-                m_depth_cubemap_shader->set_mat4("u_Model", transform);
-                if (mesh->get_vertex_array())
-                    mesh->get_vertex_array()->bind();
-                mesh->render();
+    const VertexArray *bound_vertex_array = nullptr;
+    int bound_face_mask = -1;
+    auto draw_casters = [&](bool is_static, unsigned int faces) {
+        for (size_t i = 0; i < m_casters.size(); ++i) {
+            const auto &caster = m_casters[i];
+            unsigned int face_mask = face_masks[i] & faces;
+            if (caster.is_static != is_static || face_mask == 0)
+                continue;
+            // The geometry shader only emits the caster to the faces it can reach
+            if (static_cast<int>(face_mask) != bound_face_mask) {
+                m_depth_cubemap_shader->set_int("u_FaceMask", static_cast<int>(face_mask));
+                bound_face_mask = static_cast<int>(face_mask);
             }
-        }
-        for (const auto& child : node->get_children()) {
-            traverse(child, transform);
+            for (unsigned int face = 0; face < 6; ++face) {
+                if (face_mask & (1u << face))
+                    ++m_point_stats.face_casters[face];
+            }
+            m_depth_cubemap_shader->set_mat4("u_Model", caster.transform);
+            auto vertex_array = caster.mesh->get_depth_vertex_array();
+            if (vertex_array && vertex_array.get() != bound_vertex_array) {
+                vertex_array->bind();
+                bound_vertex_array = vertex_array.get();
+            }
+            caster.mesh->render_depth();
+            m_point_stats.triangles += caster.mesh->get_index_count() / 3;
         }
     };
-    traverse(scene->get_root(), glm::mat4(1.0f));
+
+    // Stale faces of the cache are cleared one by one, then drawn in a single layered pass
+    glBindFramebuffer(GL_FRAMEBUFFER, shadow_map->get_static_fbo());
+    if (refresh) {
+        for (unsigned int face = 0; face < 6; ++face) {
+            if (!(refresh & (1u << face)))
+                continue;
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_CUBE_MAP_POSITIVE_X + face,
+                                   shadow_map->get_static_texture_id(), 0);
+            glClear(GL_DEPTH_BUFFER_BIT);
+            cache.static_keys[face] = static_keys[face];
+        }
+        glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, shadow_map->get_static_texture_id(), 0);
+        draw_casters(true, refresh);
+    }
+    for (unsigned int face = 0; face < 6; ++face) {
+        if (!(composite & (1u << face)))
+            continue;
+        GLenum target = GL_TEXTURE_CUBE_MAP_POSITIVE_X + face;
+        glBindFramebuffer(GL_FRAMEBUFFER, shadow_map->get_static_fbo());
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, target, shadow_map->get_static_texture_id(), 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, shadow_map->get_fbo());
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, target, shadow_map->get_texture_id(), 0);
+        copy_depth(shadow_map->get_static_fbo(), shadow_map->get_fbo(), shadow_map->get_resolution());
+        cache.dynamic_keys[face] = dynamic_keys[face];
+        ++m_point_stats.updated_slices;
+    }
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, shadow_map->get_texture_id(), 0);
+    draw_casters(false, composite);
 
     shadow_map->unbind();
     m_depth_cubemap_shader->unbind();
@@ -191,34 +659,237 @@ void ShadowRenderer::render_point_shadow(std::shared_ptr<scene::Scene> scene, st
     glCullFace(cull_face_mode);
 }
 
-void ShadowRenderer::render_scene_depth(std::shared_ptr<scene::Scene> scene, const glm::mat4 &light_space_matrix) {
+void ShadowRenderer::render_atlas_shadows(std::shared_ptr<scene::Scene> scene,
+                                          const std::vector<std::shared_ptr<scene::Light>> &lights,
+                                          std::shared_ptr<ShadowAtlas> atlas, std::shared_ptr<scene::Camera> camera,
+                                          float viewport_height) {
+    if (!scene || !atlas)
+        return;
+
+    // Lights covering more of the screen ask for larger tiles
+    std::vector<ShadowAtlasRequest> requests(lights.size());
+    for (size_t i = 0; i < lights.size(); ++i) {
+        const auto &light = lights[i];
+        if (!light || !light->casts_shadows() || light->get_type() == scene::LightType::Directional) {
+            requests[i].tile_count = 0;
+            continue;
+        }
+        requests[i].tile_count = light->get_type() == scene::LightType::Point ? 6 : 1;
+        float screen_size = static_cast<float>(atlas->get_max_tile_size());
+        if (camera) {
+            scene::BoundingSphere volume = get_light_volume(*light);
+            float distance = glm::length(volume.center - camera->get_position());
+            if (distance > volume.radius) {
+                screen_size = volume.radius / distance * camera->get_projection_matrix()[1][1] * viewport_height;
+            }
+        }
+        requests[i].tile_size =
+            static_cast<unsigned int>(std::min(screen_size, static_cast<float>(atlas->get_max_tile_size())));
+    }
+    atlas->allocate(requests);
+
+    m_atlas_stats = ShadowPassStats();
+    m_casters.clear();
+    collect_casters(scene->get_root(), glm::mat4(1.0f), camera ? camera->get_position() : glm::vec3(0.0f));
+    // 1 when a caster reaches a tile, 2 when it was drawn into one
+    std::vector<unsigned char> caster_states(m_casters.size(), 0);
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    GLint cull_face_mode;
+    glGetIntegerv(GL_CULL_FACE_MODE, &cull_face_mode);
+    glCullFace(GL_FRONT);
+    m_atlas_depth_shader->bind();
+
+    const VertexArray *bound_vertex_array = nullptr;
+    // Bit f set when a caster reaches the tile of face f of the current light
+    std::vector<unsigned int> tile_masks(m_casters.size(), 0);
+    auto draw_casters = [&](bool is_static, unsigned int face) {
+        for (size_t i = 0; i < m_casters.size(); ++i) {
+            const auto &caster = m_casters[i];
+            if (caster.is_static != is_static || !(tile_masks[i] & (1u << face)))
+                continue;
+            m_atlas_depth_shader->set_mat4("u_Model", caster.transform);
+            auto vertex_array = caster.mesh->get_depth_vertex_array();
+            if (vertex_array && vertex_array.get() != bound_vertex_array) {
+                vertex_array->bind();
+                bound_vertex_array = vertex_array.get();
+            }
+            caster.mesh->render_depth();
+            caster_states[i] = 2;
+            m_atlas_stats.triangles += caster.mesh->get_index_count() / 3;
+        }
+    };
+    for (size_t light_index = 0; light_index < lights.size(); ++light_index) {
+        int first_tile = atlas->get_first_tile(static_cast<unsigned int>(light_index));
+        if (first_tile < 0)
+            continue;
+        const auto &light = lights[light_index];
+        glm::vec3 light_pos = light->get_position();
+        float far_plane = light->get_range();
+        scene::BoundingSphere volume = get_light_volume(*light);
+        unsigned int tile_count = requests[light_index].tile_count;
+        std::fill(tile_masks.begin(), tile_masks.end(), 0);
+        uint64_t light_keys[ShadowCacheState::MAX_SLICES];
+        uint64_t static_keys[ShadowCacheState::MAX_SLICES];
+        uint64_t dynamic_keys[ShadowCacheState::MAX_SLICES];
+        for (unsigned int face = 0; face < tile_count; ++face) {
+            unsigned int tile = static_cast<unsigned int>(first_tile) + face;
+            glm::mat4 matrix;
+            if (light->get_type() == scene::LightType::Point) {
+                glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, far_plane);
+                matrix = projection *
+                         glm::lookAt(light_pos, light_pos + CUBE_FACE_DIRECTIONS[face], CUBE_FACE_UPS[face]);
+            } else {
+                glm::vec3 direction = glm::normalize(light->get_direction());
+                glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
+                if (std::abs(direction.y) > 0.99f)
+                    up = glm::vec3(0.0f, 0.0f, 1.0f);
+                float fov = std::min(2.0f * light->get_outer_cone(), glm::radians(170.0f));
+                matrix = glm::perspective(fov, 1.0f, 0.1f, far_plane) *
+                         glm::lookAt(light_pos, light_pos + direction, up);
+            }
+            atlas->set_tile_matrix(tile, matrix);
+
+            scene::Frustum frustum;
+            frustum.update(matrix);
+            const ShadowAtlasTile &region = atlas->get_tile(tile);
+            uint64_t key = hash(&region.x, sizeof(region.x));
+            key = hash(&region.y, sizeof(region.y), key);
+            key = hash(&region.size, sizeof(region.size), key);
+            light_keys[face] = hash(&far_plane, sizeof(far_plane), hash_matrix(matrix, key));
+            static_keys[face] = light_keys[face];
+            dynamic_keys[face] = light_keys[face];
+            for (size_t i = 0; i < m_casters.size(); ++i) {
+                const auto &caster = m_casters[i];
+                float distance = glm::length(caster.bounds.center - volume.center) - caster.bounds.radius;
+                bool in_range = distance <= volume.radius;
+                if (m_caster_culling && (!in_range || !frustum.contains_sphere(caster.bounds)))
+                    continue;
+                tile_masks[i] |= 1u << face;
+                uint64_t &caster_key = caster.is_static ? static_keys[face] : dynamic_keys[face];
+                caster_key = hash_caster(caster.mesh.get(), caster.transform, caster_key);
+                caster_states[i] = std::max<unsigned char>(caster_states[i], 1);
+            }
+        }
+
+        // As for cube maps, static casters are cached per tile and dynamic ones drawn over a copy of them
+        unsigned int stale = 0;
+        unsigned int unrendered = 0;
+        unsigned int composite = 0;
+        for (unsigned int face = 0; face < tile_count; ++face) {
+            const ShadowAtlasTileCache &cache = atlas->get_tile_cache(static_cast<unsigned int>(first_tile) + face);
+            if (static_keys[face] != cache.static_key)
+                stale |= 1u << face;
+            // A tile that moved or whose light moved has no static depth to keep
+            if (light_keys[face] != cache.light_key)
+                unrendered |= 1u << face;
+            if (dynamic_keys[face] != cache.dynamic_key)
+                composite |= 1u << face;
+        }
+        unsigned int refresh = stale;
+        if (m_time_slicing) {
+            refresh = stale & unrendered;
+            refresh |= pick_slice(stale & ~refresh, tile_count,
+                                  atlas->get_tile_cache(static_cast<unsigned int>(first_tile)).next_slice);
+        }
+        composite |= refresh;
+        if (composite == 0)
+            continue;
+
+        m_atlas_depth_shader->set_vec3("u_LightPos", light_pos);
+        m_atlas_depth_shader->set_float("u_FarPlane", far_plane);
+        for (unsigned int face = 0; face < tile_count; ++face) {
+            if (!(composite & (1u << face)))
+                continue;
+            unsigned int tile = static_cast<unsigned int>(first_tile) + face;
+            ShadowAtlasTileCache &cache = atlas->get_tile_cache(tile);
+            m_atlas_depth_shader->set_mat4("u_LightSpaceMatrix", atlas->get_tile(tile).light_space_matrix);
+            if (refresh & (1u << face)) {
+                atlas->bind_static_tile(tile);
+                draw_casters(true, face);
+                cache.light_key = light_keys[face];
+                cache.static_key = static_keys[face];
+            }
+            atlas->composite_tile(tile);
+            draw_casters(false, face);
+            cache.dynamic_key = dynamic_keys[face];
+            ++m_atlas_stats.updated_slices;
+        }
+    }
+    for (unsigned char state : caster_states) {
+        if (state == 0)
+            ++m_atlas_stats.culled;
+        else if (state == 1)
+            ++m_atlas_stats.cached;
+        else
+            ++m_atlas_stats.casters;
+    }
+
+    atlas->unbind();
+    m_atlas_depth_shader->unbind();
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    glCullFace(cull_face_mode);
+}
+
+void ShadowRenderer::render_scene_depth(std::shared_ptr<scene::Scene> scene, const glm::mat4 &light_space_matrix,
+                                        const glm::vec3 &lod_origin) {
     if (!scene)
         return;
 
+    m_directional_stats = ShadowPassStats();
+    m_casters.clear();
+    collect_casters(scene->get_root(), glm::mat4(1.0f), lod_origin);
+    scene::Frustum frustum;
+    frustum.update(light_space_matrix);
+
     m_depth_shader->bind();
     m_depth_shader->set_mat4("u_LightSpaceMatrix", light_space_matrix);
-
-    std::function<void(std::shared_ptr<scene::Node>, const glm::mat4&)> traverse;
-    traverse = [&](std::shared_ptr<scene::Node> node, const glm::mat4& parent_transform) {
-        if (!node)
-            return;
-        glm::mat4 transform = parent_transform * node->get_local_transform();
-        auto mesh = node->get_mesh();
-        if (mesh) {
-            auto material = mesh->get_material();
-            bool is_emissive = material && glm::length(material->get_emissive()) > 0.0f;
-            if (!is_emissive) {
-                m_depth_shader->set_mat4("u_Model", transform);
-                if (mesh->get_vertex_array())
-                    mesh->get_vertex_array()->bind();
-                mesh->render();
-            }
+    // Casters in front of the near plane are flattened onto it rather than clipped away
+    GLboolean depth_clamp = glIsEnabled(GL_DEPTH_CLAMP);
+    glEnable(GL_DEPTH_CLAMP);
+
+    const VertexArray *bound_vertex_array = nullptr;
+    for (const auto &caster : m_casters) {
+        if (m_caster_culling && !overlaps_extruded_frustum(frustum, caster.bounds)) {
+            ++m_directional_stats.culled;
+            continue;
         }
-        for (const auto& child : node->get_children()) {
-            traverse(child, transform);
+        m_depth_shader->set_mat4("u_Model", caster.transform);
+        auto vertex_array = caster.mesh->get_depth_vertex_array();
+        if (vertex_array && vertex_array.get() != bound_vertex_array) {
+            vertex_array->bind();
+            bound_vertex_array = vertex_array.get();
         }
-    };
-    traverse(scene->get_root(), glm::mat4(1.0f));
+        caster.mesh->render_depth();
+        ++m_directional_stats.casters;
+        m_directional_stats.triangles += caster.mesh->get_index_count() / 3;
+    }
+    if (!depth_clamp)
+        glDisable(GL_DEPTH_CLAMP);
+}
+
+void ShadowRenderer::collect_casters(std::shared_ptr<scene::Node> node, const glm::mat4 &parent_transform,
+                                     const glm::vec3 &lod_origin) {
+    if (!node)
+        return;
+    glm::mat4 transform = parent_transform * node->get_local_transform();
+    auto mesh = node->get_mesh();
+    if (m_lod_bias > 0 && node->has_lod()) {
+        auto lod = node->get_lod();
+        glm::vec3 offset = glm::vec3(transform[3]) - lod_origin;
+        size_t level = std::min(lod->get_level_index(glm::dot(offset, offset)) + m_lod_bias,
+                                lod->get_level_count() - 1);
+        mesh = lod->get_level(level).mesh;
+    }
+    if (mesh) {
+        auto material = mesh->get_material();
+        bool is_emissive = material && glm::length(material->get_emissive()) > 0.0f;
+        if (!is_emissive)
+            m_casters.push_back({mesh, transform, mesh->get_bounding_sphere().transform(transform), node->is_static()});
+    }
+    for (const auto &child : node->get_children())
+        collect_casters(child, transform, lod_origin);
 }
 
 glm::mat4 ShadowRenderer::get_light_space_matrix(std::shared_ptr<scene::Light> light, const glm::vec3& scene_center,
@@ -229,7 +900,9 @@ glm::mat4 ShadowRenderer::get_light_space_matrix(std::shared_ptr<scene::Light> l
     glm::mat4 light_projection = glm::ortho(-scene_radius, scene_radius,
                                            -scene_radius, scene_radius,
                                            0.1f, scene_radius * 2.0f);
-    glm::mat4 light_view = glm::lookAt(light_pos, scene_center, glm::vec3(0.0f, 1.0f, 0.0f));
+    // lookAt degenerates when the up vector is parallel to the light, as for a light straight overhead
+    glm::vec3 up = std::abs(light_dir.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::mat4 light_view = glm::lookAt(light_pos, scene_center, up);
 
     return light_projection * light_view;
 }
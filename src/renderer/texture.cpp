@@ -1,5 +1,7 @@
 #include "lmgl/renderer/texture.hpp"
+#include "lmgl/renderer/capabilities.hpp"
 
+#include <algorithm>
 #include <iostream>
 #include <memory>
 
@@ -10,43 +12,283 @@ namespace lmgl {
 
 namespace renderer {
 
+// Compressed formats above the GL 4.1 core profile are not part of the generated loader
+constexpr GLenum COMPRESSED_RGB_S3TC_DXT1 = 0x83F0;
+constexpr GLenum COMPRESSED_RGBA_S3TC_DXT5 = 0x83F3;
+constexpr GLenum COMPRESSED_SRGB_S3TC_DXT1 = 0x8C4C;
+constexpr GLenum COMPRESSED_SRGB_ALPHA_S3TC_DXT5 = 0x8C4F;
+constexpr GLenum COMPRESSED_RGBA_BPTC_UNORM = 0x8E8C;
+constexpr GLenum COMPRESSED_SRGB_ALPHA_BPTC_UNORM = 0x8E8D;
+
+static GLenum get_compressed_format(BlockFormat format, bool srgb) {
+    switch (format) {
+    case BlockFormat::BC1:
+        return srgb ? COMPRESSED_SRGB_S3TC_DXT1 : COMPRESSED_RGB_S3TC_DXT1;
+    case BlockFormat::BC3:
+        return srgb ? COMPRESSED_SRGB_ALPHA_S3TC_DXT5 : COMPRESSED_RGBA_S3TC_DXT5;
+    case BlockFormat::BC4:
+        return GL_COMPRESSED_RED_RGTC1;
+    case BlockFormat::BC5:
+        return GL_COMPRESSED_RG_RGTC2;
+    case BlockFormat::BC7:
+        return srgb ? COMPRESSED_SRGB_ALPHA_BPTC_UNORM : COMPRESSED_RGBA_BPTC_UNORM;
+    }
+    return 0;
+}
+
 Texture::Texture(int width, int height)
     : m_renderer_id(0), m_width(width), m_height(height), m_internal_format(GL_RGBA8), m_data_format(GL_RGBA) {
     glGenTextures(1, &m_renderer_id);
     glBindTexture(GL_TEXTURE_2D, m_renderer_id);
     glTexImage2D(GL_TEXTURE_2D, 0, m_internal_format, m_width, m_height, 0, m_data_format, GL_UNSIGNED_BYTE, nullptr);
     init_texture_params();
+    m_memory_usage = static_cast<std::size_t>(m_width) * static_cast<std::size_t>(m_height) * 4;
 }
 
 Texture::Texture(unsigned int id, int width, int height)
     : m_renderer_id(id), m_width(width), m_height(height) {}
 
-Texture::Texture(const std::string &path) : m_renderer_id(0), m_file_path(path), m_width(0), m_height(0) {
-    // TODO: Make flip configurable
-    stbi_set_flip_vertically_on_load(0);
-    using StbiPtr = std::unique_ptr<unsigned char, void (*)(void *)>;
-    int channels;
-
-    unsigned char *raw_data = stbi_load(path.c_str(), &m_width, &m_height, &channels, 0);
-    StbiPtr data(raw_data, stbi_image_free);
-    if (data) {
-        if (channels == 4) {
-            m_internal_format = GL_RGBA8;
-            m_data_format = GL_RGBA;
-        } else if (channels == 3) {
-            m_internal_format = GL_RGB8;
-            m_data_format = GL_RGB;
+Texture::Texture(const std::string &path, bool flip_vertically)
+    : m_renderer_id(0), m_file_path(path), m_width(0), m_height(0) {
+    ImageData image;
+    if (decode(path, image, flip_vertically))
+        upload(image);
+}
+
+Texture::Texture(const std::string &fpath, const ImageData &image)
+    : m_renderer_id(0), m_file_path(fpath), m_width(0), m_height(0) {
+    if (image.is_valid())
+        upload(image);
+}
+
+std::shared_ptr<Texture> Texture::create_placeholder(const std::string &fpath) {
+    ImageData image;
+    image.width = 1;
+    image.height = 1;
+    image.channels = 4;
+    image.pixels = std::shared_ptr<unsigned char>(new unsigned char[4]{255, 255, 255, 255},
+                                                  std::default_delete<unsigned char[]>());
+    auto texture = std::make_shared<Texture>(fpath, image);
+    texture->m_placeholder = true;
+    return texture;
+}
+
+void Texture::set_image(const ImageData &image) {
+    if (!image.is_valid())
+        return;
+    upload(image);
+    m_placeholder = false;
+}
+
+bool Texture::is_format_supported(BlockFormat format) {
+    const Capabilities &caps = Capabilities::get_instance();
+    switch (format) {
+    case BlockFormat::BC1:
+    case BlockFormat::BC3:
+        return caps.has_extension("GL_EXT_texture_compression_s3tc");
+    case BlockFormat::BC4:
+    case BlockFormat::BC5:
+        return true;
+    case BlockFormat::BC7:
+        return caps.is_version_at_least(4, 2) || caps.has_extension("GL_ARB_texture_compression_bptc");
+    }
+    return false;
+}
+
+bool Texture::decode(const std::string &fpath, ImageData &image, bool flip_vertically) {
+    if (TextureContainer::is_container(fpath)) {
+        auto compressed = std::make_shared<CompressedImage>();
+        if (!TextureContainer::load(fpath, *compressed)) {
+            std::cerr << "Failed to load texture: " << fpath << std::endl;
+            image = ImageData();
+            return false;
+        }
+        image = ImageData();
+        image.width = compressed->levels[0].width;
+        image.height = compressed->levels[0].height;
+        image.channels = TextureContainer::get_channels(compressed->format);
+        image.compressed = std::move(compressed);
+        return true;
+    }
+    // The process-wide setting would race between workers decoding at the same time
+    stbi_set_flip_vertically_on_load_thread(flip_vertically ? 1 : 0);
+    unsigned char *raw_data = stbi_load(fpath.c_str(), &image.width, &image.height, &image.channels, 0);
+    if (!raw_data) {
+        std::cerr << "Failed to load texture: " << fpath << std::endl;
+        std::cerr << "Cause: " << stbi_failure_reason() << std::endl;
+        image = ImageData();
+        return false;
+    }
+    image.pixels = std::shared_ptr<unsigned char>(raw_data, stbi_image_free);
+    return true;
+}
+
+bool Texture::decode_memory(const unsigned char *data, std::size_t size, ImageData &image, bool flip_vertically) {
+    stbi_set_flip_vertically_on_load_thread(flip_vertically ? 1 : 0);
+    unsigned char *raw_data = stbi_load_from_memory(data, static_cast<int>(size), &image.width, &image.height,
+                                                    &image.channels, 0);
+    if (!raw_data) {
+        std::cerr << "Failed to decode embedded texture, cause: " << stbi_failure_reason() << std::endl;
+        image = ImageData();
+        return false;
+    }
+    image.pixels = std::shared_ptr<unsigned char>(raw_data, stbi_image_free);
+    return true;
+}
+
+void Texture::upload(const ImageData &image) {
+    if (image.compressed) {
+        upload_compressed(*image.compressed);
+        return;
+    }
+    m_width = image.width;
+    m_height = image.height;
+    set_pixel_format(image.channels);
+    // Keep the name when replacing a placeholder, only the storage changes
+    if (m_renderer_id == 0)
+        glGenTextures(1, &m_renderer_id);
+    glBindTexture(GL_TEXTURE_2D, m_renderer_id);
+    // Decoded rows are tightly packed, which breaks the default 4-byte alignment for odd RGB widths
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, m_internal_format, m_width, m_height, 0, m_data_format, GL_UNSIGNED_BYTE,
+                 image.pixels.get());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    init_texture_params();
+    // A compressed image uploaded before may have capped the chain
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 1000);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    m_compressed = false;
+    m_streamed = false;
+    m_base_level = 0;
+    m_level_count = 1;
+    m_level_sizes.clear();
+    // The full mip chain adds a third to the base level
+    m_memory_usage = image.size() * 4 / 3;
+}
+
+void Texture::upload_compressed(const CompressedImage &image) {
+    if (image.levels.empty())
+        return;
+    if (!is_format_supported(image.format)) {
+        std::cerr << "ERROR: Texture: " << m_file_path << " uses a block format this context cannot sample"
+                  << std::endl;
+        return;
+    }
+    m_width = image.levels[0].width;
+    m_height = image.levels[0].height;
+    m_internal_format = get_compressed_format(image.format, image.srgb);
+    m_data_format = m_internal_format;
+    if (m_renderer_id == 0)
+        glGenTextures(1, &m_renderer_id);
+    glBindTexture(GL_TEXTURE_2D, m_renderer_id);
+    // The levels come precomputed, nothing is generated at load time
+    for (size_t i = 0; i < image.levels.size(); ++i) {
+        const CompressedLevel &level = image.levels[i];
+        glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(i), m_internal_format, level.width, level.height,
+                               0, static_cast<GLsizei>(level.data.size()), level.data.data());
+    }
+    init_texture_params();
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(image.levels.size() - 1));
+    if (image.levels.size() > 1)
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    m_compressed = true;
+    m_streamed = false;
+    m_base_level = 0;
+    m_level_count = static_cast<int>(image.levels.size());
+    m_level_sizes.clear();
+    m_memory_usage = image.size();
+}
+
+void Texture::set_pixel_format(int channels) {
+    if (channels == 4) {
+        m_internal_format = GL_RGBA8;
+        m_data_format = GL_RGBA;
+    } else if (channels == 3) {
+        m_internal_format = GL_RGB8;
+        m_data_format = GL_RGB;
+    } else if (channels == 2) {
+        m_internal_format = GL_RG8;
+        m_data_format = GL_RG;
+    } else {
+        m_internal_format = GL_R8;
+        m_data_format = GL_RED;
+    }
+}
+
+void Texture::init_streaming(const ImageData &image, int level_count) {
+    if (image.compressed) {
+        if (!is_format_supported(image.compressed->format)) {
+            std::cerr << "ERROR: Texture: " << m_file_path << " uses a block format this context cannot sample"
+                      << std::endl;
+            return;
         }
+        m_internal_format = get_compressed_format(image.compressed->format, image.compressed->srgb);
+        m_data_format = m_internal_format;
+    } else {
+        set_pixel_format(4);
+    }
+    m_width = image.width;
+    m_height = image.height;
+    m_compressed = image.compressed != nullptr;
+    m_placeholder = false;
+    m_streamed = true;
+    m_level_count = std::max(1, level_count);
+    m_base_level = m_level_count;
+    m_level_sizes.assign(m_level_count, 0);
+    m_memory_usage = 0;
+    if (m_renderer_id == 0)
         glGenTextures(1, &m_renderer_id);
-        glBindTexture(GL_TEXTURE_2D, m_renderer_id);
-        glTexImage2D(GL_TEXTURE_2D, 0, m_internal_format, m_width, m_height, 0, m_data_format, GL_UNSIGNED_BYTE,
-                     data.get());
-        init_texture_params();
-        glGenerateMipmap(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, m_renderer_id);
+    init_texture_params();
+    if (m_level_count > 1)
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    apply_level_range();
+}
+
+bool Texture::upload_level(int level, const CompressedLevel &data) {
+    if (!m_streamed || m_renderer_id == 0 || level != m_base_level - 1)
+        return false;
+    glBindTexture(GL_TEXTURE_2D, m_renderer_id);
+    if (m_compressed) {
+        glCompressedTexImage2D(GL_TEXTURE_2D, level, m_internal_format, data.width, data.height, 0,
+                               static_cast<GLsizei>(data.data.size()), data.data.data());
     } else {
-        std::cerr << "Failed to load texture: " << path << std::endl;
-        std::cerr << "Cause: " << stbi_failure_reason() << std::endl;
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(GL_TEXTURE_2D, level, m_internal_format, data.width, data.height, 0, m_data_format,
+                     GL_UNSIGNED_BYTE, data.data.data());
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
     }
+    m_base_level = level;
+    m_level_sizes[level] = data.data.size();
+    m_memory_usage += data.data.size();
+    apply_level_range();
+    return true;
+}
+
+std::size_t Texture::evict_level() {
+    if (!m_streamed || m_base_level >= m_level_count - 1)
+        return 0;
+    int level = m_base_level;
+    glBindTexture(GL_TEXTURE_2D, m_renderer_id);
+    // Move sampling off the level before its storage goes away
+    m_base_level = level + 1;
+    apply_level_range();
+    // A zero-sized level holds no storage
+    if (m_compressed)
+        glCompressedTexImage2D(GL_TEXTURE_2D, level, m_internal_format, 0, 0, 0, 0, nullptr);
+    else
+        glTexImage2D(GL_TEXTURE_2D, level, m_internal_format, 0, 0, 0, m_data_format, GL_UNSIGNED_BYTE, nullptr);
+    std::size_t bytes = m_level_sizes[level];
+    m_level_sizes[level] = 0;
+    m_memory_usage -= bytes;
+    return bytes;
+}
+
+void Texture::apply_level_range() {
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, std::min(m_base_level, m_level_count - 1));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, m_level_count - 1);
 }
 
 Texture::~Texture() { glDeleteTextures(1, &m_renderer_id); }
@@ -0,0 +1,332 @@
+#include "lmgl/renderer/texture_container.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+namespace lmgl {
+
+namespace renderer {
+
+namespace {
+
+constexpr uint32_t DDS_MAGIC = 0x20534444; // "DDS "
+constexpr uint32_t DDSD_CAPS = 0x1;
+constexpr uint32_t DDSD_HEIGHT = 0x2;
+constexpr uint32_t DDSD_WIDTH = 0x4;
+constexpr uint32_t DDSD_PIXELFORMAT = 0x1000;
+constexpr uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+constexpr uint32_t DDSD_LINEARSIZE = 0x80000;
+constexpr uint32_t DDPF_FOURCC = 0x4;
+constexpr uint32_t DDSCAPS_COMPLEX = 0x8;
+constexpr uint32_t DDSCAPS_TEXTURE = 0x1000;
+constexpr uint32_t DDSCAPS_MIPMAP = 0x400000;
+constexpr uint32_t DDS_DIMENSION_TEXTURE2D = 3;
+
+constexpr unsigned char KTX2_MAGIC[12] = {0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+
+struct DDSPixelFormat {
+    uint32_t size;
+    uint32_t flags;
+    uint32_t four_cc;
+    uint32_t rgb_bit_count;
+    uint32_t masks[4];
+};
+
+struct DDSHeader {
+    uint32_t size;
+    uint32_t flags;
+    uint32_t height;
+    uint32_t width;
+    uint32_t pitch_or_linear_size;
+    uint32_t depth;
+    uint32_t mip_map_count;
+    uint32_t reserved1[11];
+    DDSPixelFormat pixel_format;
+    uint32_t caps[4];
+    uint32_t reserved2;
+};
+
+struct DDSHeaderDX10 {
+    uint32_t dxgi_format;
+    uint32_t resource_dimension;
+    uint32_t misc_flag;
+    uint32_t array_size;
+    uint32_t misc_flags2;
+};
+
+struct KTX2Header {
+    uint32_t vk_format;
+    uint32_t type_size;
+    uint32_t pixel_width;
+    uint32_t pixel_height;
+    uint32_t pixel_depth;
+    uint32_t layer_count;
+    uint32_t face_count;
+    uint32_t level_count;
+    uint32_t supercompression_scheme;
+};
+
+// Data format descriptor, key/value and supercompression offsets follow the header, none are needed
+constexpr std::size_t KTX2_INDEX_SIZE = 4 * sizeof(uint32_t) + 2 * sizeof(uint64_t);
+
+struct KTX2Level {
+    uint64_t byte_offset;
+    uint64_t byte_length;
+    uint64_t uncompressed_byte_length;
+};
+
+constexpr uint32_t four_cc(char a, char b, char c, char d) {
+    return static_cast<uint32_t>(a) | static_cast<uint32_t>(b) << 8 | static_cast<uint32_t>(c) << 16 |
+           static_cast<uint32_t>(d) << 24;
+}
+
+// Format codes of the supported formats, DXGI_FORMAT values for DDS
+struct FormatCode {
+    uint32_t value;
+    BlockFormat format;
+    bool srgb;
+};
+
+constexpr FormatCode DXGI_FORMATS[] = {
+    {71, BlockFormat::BC1, false}, {72, BlockFormat::BC1, true},  {77, BlockFormat::BC3, false},
+    {78, BlockFormat::BC3, true},  {80, BlockFormat::BC4, false}, {83, BlockFormat::BC5, false},
+    {98, BlockFormat::BC7, false}, {99, BlockFormat::BC7, true},
+};
+
+// VkFormat values for KTX2
+constexpr FormatCode VK_FORMATS[] = {
+    {131, BlockFormat::BC1, false}, {132, BlockFormat::BC1, true},  {133, BlockFormat::BC1, false},
+    {134, BlockFormat::BC1, true},  {137, BlockFormat::BC3, false}, {138, BlockFormat::BC3, true},
+    {139, BlockFormat::BC4, false}, {141, BlockFormat::BC5, false}, {145, BlockFormat::BC7, false},
+    {146, BlockFormat::BC7, true},
+};
+
+template <std::size_t N> bool find_format(const FormatCode (&table)[N], uint32_t value, CompressedImage &image) {
+    for (const auto &entry : table) {
+        if (entry.value == value) {
+            image.format = entry.format;
+            image.srgb = entry.srgb;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Appends a level read from data, checking that it lies inside the file
+bool read_level(const unsigned char *data, std::size_t size, uint64_t offset, int width, int height,
+                CompressedImage &image) {
+    std::size_t level_size = TextureContainer::get_level_size(image.format, width, height);
+    if (offset > size || size - offset < level_size)
+        return false;
+    CompressedLevel level;
+    level.width = width;
+    level.height = height;
+    level.data.assign(data + offset, data + offset + level_size);
+    image.levels.push_back(std::move(level));
+    return true;
+}
+
+bool parse_dds(const unsigned char *data, std::size_t size, CompressedImage &image) {
+    DDSHeader header;
+    std::size_t offset = sizeof(uint32_t) + sizeof(DDSHeader);
+    if (size < offset)
+        return false;
+    std::memcpy(&header, data + sizeof(uint32_t), sizeof(DDSHeader));
+    if (header.size != sizeof(DDSHeader) || header.pixel_format.size != sizeof(DDSPixelFormat) ||
+        !(header.pixel_format.flags & DDPF_FOURCC))
+        return false;
+    switch (header.pixel_format.four_cc) {
+    case four_cc('D', 'X', 'T', '1'):
+        image.format = BlockFormat::BC1;
+        break;
+    case four_cc('D', 'X', 'T', '5'):
+        image.format = BlockFormat::BC3;
+        break;
+    case four_cc('A', 'T', 'I', '1'):
+    case four_cc('B', 'C', '4', 'U'):
+        image.format = BlockFormat::BC4;
+        break;
+    case four_cc('A', 'T', 'I', '2'):
+    case four_cc('B', 'C', '5', 'U'):
+        image.format = BlockFormat::BC5;
+        break;
+    case four_cc('D', 'X', '1', '0'): {
+        DDSHeaderDX10 dx10;
+        if (size < offset + sizeof(DDSHeaderDX10))
+            return false;
+        std::memcpy(&dx10, data + offset, sizeof(DDSHeaderDX10));
+        offset += sizeof(DDSHeaderDX10);
+        if (dx10.resource_dimension != DDS_DIMENSION_TEXTURE2D || dx10.array_size > 1 ||
+            !find_format(DXGI_FORMATS, dx10.dxgi_format, image))
+            return false;
+        break;
+    }
+    default:
+        return false;
+    }
+    int width = static_cast<int>(header.width);
+    int height = static_cast<int>(header.height);
+    if (width <= 0 || height <= 0)
+        return false;
+    uint32_t level_count = (header.flags & DDSD_MIPMAPCOUNT) ? std::max(1u, header.mip_map_count) : 1u;
+    for (uint32_t i = 0; i < level_count; ++i) {
+        if (!read_level(data, size, offset, width, height, image))
+            return false;
+        offset += image.levels.back().data.size();
+        if (width == 1 && height == 1)
+            break;
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+    }
+    return true;
+}
+
+bool parse_ktx2(const unsigned char *data, std::size_t size, CompressedImage &image) {
+    KTX2Header header;
+    std::size_t offset = sizeof(KTX2_MAGIC) + sizeof(KTX2Header) + KTX2_INDEX_SIZE;
+    if (size < offset)
+        return false;
+    std::memcpy(&header, data + sizeof(KTX2_MAGIC), sizeof(KTX2Header));
+    // Only plain 2D images, no arrays, cube maps or supercompression
+    if (header.supercompression_scheme != 0 || header.pixel_depth > 0 || header.layer_count > 1 ||
+        header.face_count != 1 || !find_format(VK_FORMATS, header.vk_format, image))
+        return false;
+    int width = static_cast<int>(header.pixel_width);
+    int height = static_cast<int>(header.pixel_height);
+    if (width <= 0 || height <= 0)
+        return false;
+    uint32_t level_count = std::max(1u, header.level_count);
+    if (level_count > 32 || size < offset + level_count * sizeof(KTX2Level))
+        return false;
+    for (uint32_t i = 0; i < level_count; ++i) {
+        KTX2Level level;
+        std::memcpy(&level, data + offset + i * sizeof(KTX2Level), sizeof(KTX2Level));
+        int level_width = std::max(1, width >> i);
+        int level_height = std::max(1, height >> i);
+        if (level.byte_length != TextureContainer::get_level_size(image.format, level_width, level_height) ||
+            !read_level(data, size, level.byte_offset, level_width, level_height, image))
+            return false;
+    }
+    return true;
+}
+
+} // namespace
+
+std::size_t CompressedImage::size() const {
+    std::size_t total = 0;
+    for (const auto &level : levels)
+        total += level.data.size();
+    return total;
+}
+
+bool TextureContainer::is_container(const std::string &fpath) {
+    std::size_t dot = fpath.find_last_of('.');
+    if (dot == std::string::npos)
+        return false;
+    std::string extension = fpath.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return extension == "dds" || extension == "ktx2";
+}
+
+bool TextureContainer::load(const std::string &fpath, CompressedImage &image) {
+    std::ifstream file(fpath, std::ios::binary);
+    if (!file)
+        return false;
+    std::vector<unsigned char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (!parse(data.data(), data.size(), image)) {
+        std::cerr << "ERROR: TextureContainer: " << fpath << " is malformed or holds an unsupported format"
+                  << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool TextureContainer::parse(const unsigned char *data, std::size_t size, CompressedImage &image) {
+    CompressedImage result;
+    bool parsed = false;
+    uint32_t magic = 0;
+    if (size >= sizeof(uint32_t))
+        std::memcpy(&magic, data, sizeof(uint32_t));
+    if (magic == DDS_MAGIC)
+        parsed = parse_dds(data, size, result);
+    else if (size >= sizeof(KTX2_MAGIC) && std::memcmp(data, KTX2_MAGIC, sizeof(KTX2_MAGIC)) == 0)
+        parsed = parse_ktx2(data, size, result);
+    if (parsed)
+        image = std::move(result);
+    return parsed;
+}
+
+bool TextureContainer::save_dds(const std::string &fpath, const CompressedImage &image) {
+    if (image.levels.empty())
+        return false;
+    DDSHeader header = {};
+    header.size = sizeof(DDSHeader);
+    header.flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_LINEARSIZE;
+    header.width = static_cast<uint32_t>(image.levels[0].width);
+    header.height = static_cast<uint32_t>(image.levels[0].height);
+    header.pitch_or_linear_size = static_cast<uint32_t>(image.levels[0].data.size());
+    header.mip_map_count = static_cast<uint32_t>(image.levels.size());
+    header.pixel_format.size = sizeof(DDSPixelFormat);
+    header.pixel_format.flags = DDPF_FOURCC;
+    header.pixel_format.four_cc = four_cc('D', 'X', '1', '0');
+    header.caps[0] = DDSCAPS_TEXTURE;
+    if (image.levels.size() > 1) {
+        header.flags |= DDSD_MIPMAPCOUNT;
+        header.caps[0] |= DDSCAPS_COMPLEX | DDSCAPS_MIPMAP;
+    }
+    DDSHeaderDX10 dx10 = {};
+    dx10.resource_dimension = DDS_DIMENSION_TEXTURE2D;
+    dx10.array_size = 1;
+    for (const auto &entry : DXGI_FORMATS) {
+        if (entry.format == image.format && entry.srgb == image.srgb)
+            dx10.dxgi_format = entry.value;
+    }
+    if (dx10.dxgi_format == 0) {
+        std::cerr << "ERROR: TextureContainer: no sRGB DXGI format for this block format" << std::endl;
+        return false;
+    }
+    std::ofstream file(fpath, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cerr << "ERROR: TextureContainer: cannot write " << fpath << std::endl;
+        return false;
+    }
+    file.write(reinterpret_cast<const char *>(&DDS_MAGIC), sizeof(DDS_MAGIC));
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(&dx10), sizeof(dx10));
+    for (const auto &level : image.levels)
+        file.write(reinterpret_cast<const char *>(level.data.data()), static_cast<std::streamsize>(level.data.size()));
+    return static_cast<bool>(file);
+}
+
+std::size_t TextureContainer::get_block_size(BlockFormat format) {
+    return format == BlockFormat::BC1 || format == BlockFormat::BC4 ? 8 : 16;
+}
+
+int TextureContainer::get_channels(BlockFormat format) {
+    switch (format) {
+    case BlockFormat::BC1:
+        return 3;
+    case BlockFormat::BC4:
+        return 1;
+    case BlockFormat::BC5:
+        return 2;
+    default:
+        return 4;
+    }
+}
+
+std::size_t TextureContainer::get_level_size(BlockFormat format, int width, int height) {
+    std::size_t blocks_x = static_cast<std::size_t>(std::max(1, (width + 3) / 4));
+    std::size_t blocks_y = static_cast<std::size_t>(std::max(1, (height + 3) / 4));
+    return blocks_x * blocks_y * get_block_size(format);
+}
+
+} // namespace renderer
+
+} // namespace lmgl
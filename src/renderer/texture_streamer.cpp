@@ -0,0 +1,243 @@
+#include "lmgl/renderer/texture_streamer.hpp"
+#include "lmgl/core/thread_pool.hpp"
+#include "lmgl/renderer/block_encoder.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace lmgl {
+
+namespace renderer {
+
+TextureStreamer &TextureStreamer::get_instance() {
+    static TextureStreamer instance;
+    return instance;
+}
+
+std::shared_ptr<Texture> TextureStreamer::load(const std::string &fpath, bool flip_vertically) {
+    ImageData image;
+    if (!Texture::decode(fpath, image, flip_vertically))
+        return nullptr;
+    return add_file(fpath, image, flip_vertically);
+}
+
+bool TextureStreamer::build_levels(const ImageData &image, std::vector<CompressedLevel> &levels) {
+    if (image.compressed)
+        levels = image.compressed->levels;
+    else if (!BlockEncoder::build_mip_chain(image, levels))
+        return false;
+    return !levels.empty();
+}
+
+std::shared_ptr<Texture> TextureStreamer::add(const std::string &fpath, const ImageData &image) {
+    Entry entry;
+    if (!build_levels(image, entry.levels))
+        return nullptr;
+    return add_entry(fpath, image, std::move(entry));
+}
+
+std::shared_ptr<Texture> TextureStreamer::add_file(const std::string &fpath, const ImageData &image,
+                                                   bool flip_vertically) {
+    Entry entry;
+    if (!build_levels(image, entry.levels))
+        return nullptr;
+    entry.source = fpath;
+    entry.flip_vertically = flip_vertically;
+    return add_entry(fpath, image, std::move(entry));
+}
+
+std::shared_ptr<Texture> TextureStreamer::add_entry(const std::string &fpath, const ImageData &image, Entry entry) {
+    auto texture = std::make_shared<Texture>(fpath, ImageData());
+    int level_count = static_cast<int>(entry.levels.size());
+    texture->init_streaming(image, level_count);
+    if (!texture->is_streamed())
+        return texture;
+    entry.min_level = level_count - 1;
+    while (entry.min_level > 0 && std::max(entry.levels[entry.min_level - 1].width,
+                                           entry.levels[entry.min_level - 1].height) <= m_resident_size)
+        --entry.min_level;
+    // Resident levels never leave the GPU, their data is not needed again
+    for (int level = level_count - 1; level >= entry.min_level; --level) {
+        texture->upload_level(level, entry.levels[level]);
+        std::vector<unsigned char>().swap(entry.levels[level].data);
+    }
+    release_levels(entry);
+    entry.texture = texture;
+    entry.wanted = entry.min_level;
+    entry.last_used = m_frame;
+    m_memory_usage += texture->get_memory_usage();
+    // A destroyed texture may have left its address to this one
+    m_entries[texture.get()] = std::move(entry);
+    return texture;
+}
+
+int TextureStreamer::select_level(int width, int height, float screen_size) {
+    float texels = static_cast<float>(std::max(width, height));
+    if (screen_size >= texels)
+        return 0;
+    return static_cast<int>(std::floor(std::log2(texels / std::max(screen_size, 1.0f))));
+}
+
+void TextureStreamer::request(const Texture *texture, float screen_size) {
+    auto it = m_entries.find(texture);
+    if (it == m_entries.end())
+        return;
+    const CompressedLevel &base = it->second.levels[0];
+    int level = select_level(base.width, base.height, screen_size);
+    it->second.requested = std::min(it->second.requested, level);
+}
+
+void TextureStreamer::request_level(const Texture *texture, int level) {
+    auto it = m_entries.find(texture);
+    if (it != m_entries.end())
+        it->second.requested = std::min(it->second.requested, std::max(level, 0));
+}
+
+bool TextureStreamer::fetch_level(Entry &entry, int level) {
+    if (!entry.levels[level].data.empty())
+        return true;
+    if (entry.source.empty())
+        return false;
+    if (!entry.reload) {
+        auto reload = std::make_shared<Reload>();
+        entry.reload = reload;
+        core::ThreadPool::get_instance().submit(
+            [reload, fpath = entry.source, flip_vertically = entry.flip_vertically]() {
+                ImageData image;
+                if (Texture::decode(fpath, image, flip_vertically))
+                    build_levels(image, reload->levels);
+                reload->done.store(true, std::memory_order_release);
+            });
+        return false;
+    }
+    if (!entry.reload->done.load(std::memory_order_acquire))
+        return false;
+    std::shared_ptr<Reload> reload = std::move(entry.reload);
+    bool matches = reload->levels.size() == entry.levels.size();
+    for (std::size_t i = 0; matches && i < reload->levels.size(); ++i)
+        matches = reload->levels[i].width == entry.levels[i].width &&
+                  reload->levels[i].height == entry.levels[i].height && !reload->levels[i].data.empty();
+    if (!matches) {
+        // Missing or changed on disk, the texture stays at the levels it has
+        std::cerr << "Warning: TextureStreamer: could not read " << entry.source << " again" << std::endl;
+        entry.source.clear();
+        return false;
+    }
+    for (int i = 0; i < entry.min_level; ++i)
+        if (entry.levels[i].data.empty())
+            entry.levels[i].data = std::move(reload->levels[i].data);
+    return true;
+}
+
+void TextureStreamer::release_levels(Entry &entry) {
+    if (entry.source.empty())
+        return;
+    for (int level = 0; level < entry.min_level; ++level)
+        std::vector<unsigned char>().swap(entry.levels[level].data);
+    entry.reload.reset();
+}
+
+TextureStreamer::Entry *TextureStreamer::pick_victim(const Entry *exclude, bool allow_visible) {
+    Entry *victim = nullptr;
+    int victim_surplus = 0;
+    for (auto &pair : m_entries) {
+        Entry &entry = pair.second;
+        auto texture = entry.texture.lock();
+        if (&entry == exclude || !texture || texture->get_base_level() >= entry.min_level)
+            continue;
+        bool visible = entry.last_used == m_frame;
+        int surplus = entry.wanted - texture->get_base_level();
+        if (visible && surplus <= 0 && !allow_visible)
+            continue;
+        if (!victim || entry.last_used < victim->last_used ||
+            (entry.last_used == victim->last_used && surplus > victim_surplus)) {
+            victim = &entry;
+            victim_surplus = surplus;
+        }
+    }
+    return victim;
+}
+
+void TextureStreamer::update() {
+    ++m_frame;
+    std::vector<Entry *> wanting;
+    std::size_t usage = 0;
+    for (auto it = m_entries.begin(); it != m_entries.end();) {
+        auto texture = it->second.texture.lock();
+        if (!texture) {
+            it = m_entries.erase(it);
+            continue;
+        }
+        Entry &entry = it->second;
+        if (entry.requested != NO_REQUEST) {
+            entry.wanted = std::min(entry.requested, entry.min_level);
+            entry.last_used = m_frame;
+            entry.requested = NO_REQUEST;
+            if (texture->get_base_level() > entry.wanted)
+                wanting.push_back(&entry);
+        }
+        // Levels read back for a texture off screen or sharp enough are not kept
+        if (wanting.empty() || wanting.back() != &entry)
+            release_levels(entry);
+        usage += texture->get_memory_usage();
+        ++it;
+    }
+
+    // A lowered budget takes levels from anything above its resident size
+    while (usage > m_budget) {
+        Entry *victim = pick_victim(nullptr, true);
+        if (!victim)
+            break;
+        usage -= victim->texture.lock()->evict_level();
+    }
+
+    // The blurriest textures on screen go first
+    std::sort(wanting.begin(), wanting.end(), [](const Entry *a, const Entry *b) {
+        return a->texture.lock()->get_base_level() - a->wanted > b->texture.lock()->get_base_level() - b->wanted;
+    });
+    std::size_t uploaded = 0;
+    for (Entry *entry : wanting) {
+        auto texture = entry->texture.lock();
+        int level = texture->get_base_level() - 1;
+        // Still reading the file, the level comes on a later frame
+        if (!fetch_level(*entry, level))
+            continue;
+        std::size_t bytes = entry->levels[level].data.size();
+        if (uploaded > 0 && uploaded + bytes > m_upload_budget)
+            break;
+        while (usage + bytes > m_budget) {
+            Entry *victim = pick_victim(entry, false);
+            if (!victim)
+                break;
+            usage -= victim->texture.lock()->evict_level();
+        }
+        // Out of room, the texture stays at a coarser level
+        if (usage + bytes > m_budget)
+            continue;
+        if (texture->upload_level(level, entry->levels[level])) {
+            usage += bytes;
+            uploaded += bytes;
+            if (!entry->source.empty())
+                std::vector<unsigned char>().swap(entry->levels[level].data);
+        }
+    }
+    m_memory_usage = usage;
+}
+
+std::size_t TextureStreamer::get_cpu_memory_usage() const {
+    std::size_t bytes = 0;
+    for (const auto &pair : m_entries)
+        for (const CompressedLevel &level : pair.second.levels)
+            bytes += level.data.size();
+    return bytes;
+}
+
+void TextureStreamer::clear() {
+    m_entries.clear();
+    m_memory_usage = 0;
+}
+
+} // namespace renderer
+
+} // namespace lmgl
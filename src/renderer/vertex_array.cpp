@@ -20,8 +20,25 @@ static GLenum shader_data_type_to_opengl_type(ShaderDataType type) {
     case ShaderDataType::Int2:
     case ShaderDataType::Int3:
     case ShaderDataType::Int4:
+        return GL_INT;
     case ShaderDataType::Bool:
-        return GL_BOOL;
+        return GL_UNSIGNED_BYTE;
+    case ShaderDataType::Half2:
+    case ShaderDataType::Half4:
+        return GL_HALF_FLOAT;
+    case ShaderDataType::Byte4:
+        return GL_BYTE;
+    case ShaderDataType::UByte4:
+    case ShaderDataType::UByte4I:
+        return GL_UNSIGNED_BYTE;
+    case ShaderDataType::Short2:
+    case ShaderDataType::Short4:
+        return GL_SHORT;
+    case ShaderDataType::UShort2:
+    case ShaderDataType::UShort4:
+        return GL_UNSIGNED_SHORT;
+    case ShaderDataType::Int2_10_10_10:
+        return GL_INT_2_10_10_10_REV;
     default:
         return 0;
     }
@@ -35,22 +52,65 @@ void VertexArray::bind() const { glBindVertexArray(m_renderer_id); }
 
 void VertexArray::unbind() const { glBindVertexArray(0); }
 
-void VertexArray::add_vertex_buffer(const std::shared_ptr<VertexBuffer> &vertex_buffer) {
+void VertexArray::add_vertex_buffer(const std::shared_ptr<VertexBuffer> &vertex_buffer, unsigned int divisor) {
+    add_vertex_buffer(vertex_buffer, vertex_buffer->get_layout(), divisor);
+}
+
+void VertexArray::add_vertex_buffer(const std::shared_ptr<VertexBuffer> &vertex_buffer, const BufferLayout &layout,
+                                    unsigned int divisor) {
     glBindVertexArray(m_renderer_id);
     vertex_buffer->bind();
-    const auto &layout = vertex_buffer->get_layout();
-    unsigned int index = 0;
-    for (const auto &element : layout) {
-        glEnableVertexAttribArray(index);
-        glVertexAttribPointer(index, element.get_component_count(), shader_data_type_to_opengl_type(element.type),
-                              element.normalized ? GL_TRUE : GL_FALSE, layout.get_stride(),
-                              (const void *)element.offset);
-        index++;
-    }
+    add_attributes(layout, divisor);
     m_vertex_buffers.push_back(vertex_buffer);
     glBindVertexArray(0);
 }
 
+void VertexArray::add_stream_buffer(const std::shared_ptr<StreamBuffer> &stream_buffer, const BufferLayout &layout,
+                                    unsigned int divisor) {
+    glBindVertexArray(m_renderer_id);
+    glBindBuffer(GL_ARRAY_BUFFER, stream_buffer->get_id());
+    add_attributes(layout, divisor);
+    m_stream_buffers.push_back(stream_buffer);
+    glBindVertexArray(0);
+}
+
+void VertexArray::add_attributes(const BufferLayout &layout, unsigned int divisor) {
+    unsigned int index = m_next_attribute_location;
+    for (const auto &element : layout) {
+        if (element.location >= 0)
+            index = static_cast<unsigned int>(element.location);
+        if (element.type == ShaderDataType::Mat3 || element.type == ShaderDataType::Mat4) {
+            // Matrices are passed as one attribute per column
+            unsigned int columns = element.type == ShaderDataType::Mat3 ? 3 : 4;
+            for (unsigned int column = 0; column < columns; ++column) {
+                glEnableVertexAttribArray(index);
+                glVertexAttribPointer(index, columns, GL_FLOAT, element.normalized ? GL_TRUE : GL_FALSE,
+                                      layout.get_stride(),
+                                      (const void *)(element.offset + sizeof(float) * columns * column));
+                glVertexAttribDivisor(index, divisor);
+                index++;
+            }
+        } else {
+            glEnableVertexAttribArray(index);
+            if (element.is_integer()) {
+                // Integer inputs must not go through float conversion
+                glVertexAttribIPointer(index, element.get_component_count(),
+                                       shader_data_type_to_opengl_type(element.type), layout.get_stride(),
+                                       (const void *)element.offset);
+            } else {
+                glVertexAttribPointer(index, element.get_component_count(),
+                                      shader_data_type_to_opengl_type(element.type),
+                                      element.normalized ? GL_TRUE : GL_FALSE, layout.get_stride(),
+                                      (const void *)element.offset);
+            }
+            glVertexAttribDivisor(index, divisor);
+            index++;
+        }
+        if (index > m_next_attribute_location)
+            m_next_attribute_location = index;
+    }
+}
+
 void VertexArray::set_index_buffer(const std::shared_ptr<IndexBuffer> &index_buffer) {
     glBindVertexArray(m_renderer_id);
     index_buffer->bind();
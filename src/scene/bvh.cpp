@@ -0,0 +1,152 @@
+#include "lmgl/scene/bvh.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace lmgl {
+
+namespace scene {
+
+void TriangleBVH::build(const glm::vec3 *positions, std::size_t vertex_count, std::size_t stride,
+                        const std::vector<unsigned int> &indices) {
+    m_nodes.clear();
+    m_positions.resize(vertex_count);
+    const unsigned char *position = reinterpret_cast<const unsigned char *>(positions);
+    for (std::size_t i = 0; i < vertex_count; ++i, position += stride)
+        m_positions[i] = *reinterpret_cast<const glm::vec3 *>(position);
+
+    std::size_t triangle_count = indices.size() / 3;
+    m_triangle_ids.resize(triangle_count);
+    std::iota(m_triangle_ids.begin(), m_triangle_ids.end(), 0u);
+    m_indices.clear();
+    if (triangle_count == 0 || vertex_count == 0) {
+        m_positions.clear();
+        m_triangle_ids.clear();
+        return;
+    }
+
+    std::vector<glm::vec3> centroids(triangle_count);
+    for (std::size_t t = 0; t < triangle_count; ++t) {
+        centroids[t] = (m_positions[indices[t * 3]] + m_positions[indices[t * 3 + 1]] +
+                        m_positions[indices[t * 3 + 2]]) /
+                       3.0f;
+    }
+
+    struct Task {
+        unsigned int parent;
+        unsigned int first;
+        unsigned int count;
+    };
+    const unsigned int none = std::numeric_limits<unsigned int>::max();
+    m_nodes.reserve(2 * triangle_count / LEAF_SIZE + 1);
+    // Nodes are allocated when popped, so a left child always directly follows its parent
+    std::vector<Task> stack = {{none, 0, static_cast<unsigned int>(triangle_count)}};
+    while (!stack.empty()) {
+        Task task = stack.back();
+        stack.pop_back();
+        unsigned int node = static_cast<unsigned int>(m_nodes.size());
+        m_nodes.emplace_back();
+        if (task.parent != none && node != task.parent + 1)
+            m_nodes[task.parent].first = node;
+        AABB bounds(glm::vec3(std::numeric_limits<float>::max()), glm::vec3(std::numeric_limits<float>::lowest()));
+        AABB centroid_bounds = bounds;
+        for (unsigned int i = task.first; i < task.first + task.count; ++i) {
+            unsigned int t = m_triangle_ids[i];
+            for (int k = 0; k < 3; ++k)
+                bounds.expand(m_positions[indices[t * 3 + k]]);
+            centroid_bounds.expand(centroids[t]);
+        }
+        m_nodes[node].bounds = bounds;
+        if (task.count <= LEAF_SIZE) {
+            m_nodes[node].first = task.first;
+            m_nodes[node].count = task.count;
+            continue;
+        }
+        glm::vec3 extent = centroid_bounds.max - centroid_bounds.min;
+        int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+        unsigned int half = task.count / 2;
+        auto begin = m_triangle_ids.begin() + task.first;
+        std::nth_element(begin, begin + half, begin + task.count,
+                         [&](unsigned int a, unsigned int b) { return centroids[a][axis] < centroids[b][axis]; });
+        stack.push_back({node, task.first + half, task.count - half});
+        stack.push_back({node, task.first, half});
+    }
+
+    m_indices.reserve(triangle_count * 3);
+    for (unsigned int t : m_triangle_ids)
+        m_indices.insert(m_indices.end(), {indices[t * 3], indices[t * 3 + 1], indices[t * 3 + 2]});
+}
+
+std::size_t TriangleBVH::get_memory_usage() const {
+    return m_nodes.capacity() * sizeof(Node) + m_positions.capacity() * sizeof(glm::vec3) +
+           (m_indices.capacity() + m_triangle_ids.capacity()) * sizeof(unsigned int);
+}
+
+// Slab test, returns the entry distance or a negative value on a miss
+static float intersect_box(const AABB &box, const glm::vec3 &origin, const glm::vec3 &inverse_direction,
+                           float max_distance) {
+    glm::vec3 t0 = (box.min - origin) * inverse_direction;
+    glm::vec3 t1 = (box.max - origin) * inverse_direction;
+    glm::vec3 near = glm::min(t0, t1);
+    glm::vec3 far = glm::max(t0, t1);
+    float enter = std::max(std::max(near.x, near.y), std::max(near.z, 0.0f));
+    float exit = std::min(std::min(far.x, far.y), std::min(far.z, max_distance));
+    return enter <= exit ? enter : -1.0f;
+}
+
+bool TriangleBVH::intersect(const glm::vec3 &origin, const glm::vec3 &direction, RayHit &hit,
+                            float max_distance) const {
+    if (m_nodes.empty())
+        return false;
+    glm::vec3 inverse_direction(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+    float closest = max_distance;
+    bool found = false;
+    unsigned int stack[64];
+    int size = 0;
+    stack[size++] = 0;
+    while (size > 0) {
+        const Node &node = m_nodes[stack[--size]];
+        if (intersect_box(node.bounds, origin, inverse_direction, closest) < 0.0f)
+            continue;
+        if (node.count == 0) {
+            unsigned int left = static_cast<unsigned int>(&node - m_nodes.data()) + 1;
+            stack[size++] = node.first;
+            stack[size++] = left;
+            continue;
+        }
+        for (unsigned int i = node.first; i < node.first + node.count; ++i) {
+            // Moller-Trumbore, without back-face rejection
+            const glm::vec3 &p0 = m_positions[m_indices[i * 3]];
+            glm::vec3 edge1 = m_positions[m_indices[i * 3 + 1]] - p0;
+            glm::vec3 edge2 = m_positions[m_indices[i * 3 + 2]] - p0;
+            glm::vec3 p = glm::cross(direction, edge2);
+            float determinant = glm::dot(edge1, p);
+            if (std::abs(determinant) < 1e-12f)
+                continue;
+            float inverse_determinant = 1.0f / determinant;
+            glm::vec3 offset = origin - p0;
+            float u = glm::dot(offset, p) * inverse_determinant;
+            if (u < 0.0f || u > 1.0f)
+                continue;
+            glm::vec3 q = glm::cross(offset, edge1);
+            float v = glm::dot(direction, q) * inverse_determinant;
+            if (v < 0.0f || u + v > 1.0f)
+                continue;
+            float t = glm::dot(edge2, q) * inverse_determinant;
+            if (t < 0.0f || t >= closest)
+                continue;
+            closest = t;
+            hit.distance = t;
+            hit.triangle = m_triangle_ids[i];
+            hit.barycentric = glm::vec2(u, v);
+            found = true;
+        }
+    }
+    return found;
+}
+
+} // namespace scene
+
+} // namespace lmgl
@@ -22,6 +22,14 @@ std::shared_ptr<Mesh> LOD::get_mesh(float distance_sq) const {
     return m_levels.back().mesh;
 }
 
+size_t LOD::get_level_index(float distance_sq) const {
+    for (size_t i = 0; i < m_levels.size(); ++i) {
+        if (distance_sq <= m_levels[i].max_distance_sq)
+            return i;
+    }
+    return m_levels.empty() ? 0 : m_levels.size() - 1;
+}
+
 std::shared_ptr<Mesh> LOD::get_mesh(const glm::vec3 &camera_pos, const glm::vec3 &object_pos) const {
     glm::vec3 diff = camera_pos - object_pos;
     float distance_sq = glm::dot(diff, diff);
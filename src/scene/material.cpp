@@ -77,6 +77,23 @@ void Material::bind(const std::shared_ptr<renderer::Shader> &shader) const {
     }
 }
 
+uint32_t Material::get_features() const {
+    uint32_t features = 0;
+    if (m_albedo_map)
+        features |= renderer::Shader::AlbedoMap;
+    if (m_normal_map)
+        features |= renderer::Shader::NormalMap;
+    if (m_metallic_map)
+        features |= renderer::Shader::MetallicMap;
+    if (m_roughness_map)
+        features |= renderer::Shader::RoughnessMap;
+    if (m_ao_map)
+        features |= renderer::Shader::AoMap;
+    if (m_emissive_map)
+        features |= renderer::Shader::EmissiveMap;
+    return features;
+}
+
 } // namespace scene
 
 } // namespace lmgl
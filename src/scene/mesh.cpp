@@ -1,13 +1,20 @@
 #include "lmgl/scene/mesh.hpp"
 #include "glm/ext/scalar_constants.hpp"
+#include "glm/gtc/packing.hpp"
 #include "lmgl/renderer/buffer.hpp"
 #include "lmgl/renderer/vertex_array.hpp"
+#include "lmgl/scene/mesh_optimizer.hpp"
 
 #include <glad/glad.h>
 
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <cstdint>
+#include <iostream>
 #include <limits>
 #include <memory>
+#include <utility>
 
 namespace lmgl {
 
@@ -15,38 +22,310 @@ namespace scene {
 
 Mesh::Mesh(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices,
            std::shared_ptr<renderer::Shader> shader)
-    : m_vertices(vertices), m_indices(indices), m_shader(shader), m_index_count(indices.size()) {
-    setup_mesh();
+    : Mesh(std::vector<Vertex>(vertices), std::vector<unsigned int>(indices), shader) {}
+
+Mesh::Mesh(std::vector<Vertex> &&vertices, std::vector<unsigned int> &&indices,
+           std::shared_ptr<renderer::Shader> shader)
+    : m_shader(shader), m_index_count(indices.size()), m_index_type(GL_UNSIGNED_INT),
+      m_vertices(std::move(vertices)), m_indices(std::move(indices)) {
+    upload(m_vertices.data(), m_vertices.size(), get_vertex_layout(), nullptr);
+    calculate_bounds();
+}
+
+Mesh::Mesh(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices,
+           std::shared_ptr<renderer::Shader> shader, std::shared_ptr<renderer::GeometryPool> pool, bool packed)
+    : Mesh(std::vector<Vertex>(vertices), std::vector<unsigned int>(indices), shader, pool, packed) {}
+
+Mesh::Mesh(std::vector<Vertex> &&vertices, std::vector<unsigned int> &&indices,
+           std::shared_ptr<renderer::Shader> shader, std::shared_ptr<renderer::GeometryPool> pool, bool packed)
+    : m_shader(shader), m_index_count(indices.size()), m_index_type(GL_UNSIGNED_INT),
+      m_vertices(std::move(vertices)), m_indices(std::move(indices)), m_packed(packed) {
+    if (m_packed) {
+        auto packed_vertices = pack_vertices(m_vertices);
+        upload(packed_vertices.data(), packed_vertices.size(), get_packed_vertex_layout(), pool.get());
+    } else {
+        upload(m_vertices.data(), m_vertices.size(), get_vertex_layout(), pool.get());
+    }
     calculate_bounds();
 }
 
 Mesh::Mesh(const std::shared_ptr<renderer::VertexArray> vao, const std::shared_ptr<renderer::Shader> shader,
            unsigned int index_count)
-    : m_vertex_array(vao), m_shader(shader), m_index_count(index_count) {}
-
-void Mesh::setup_mesh() {
-    auto vbo = std::make_shared<renderer::VertexBuffer>(m_vertices.data(), m_vertices.size() * sizeof(Vertex));
-    renderer::BufferLayout layout = {
-        {renderer::ShaderDataType::Float3, "a_Position"}, {renderer::ShaderDataType::Float3, "a_Normal"},
-        {renderer::ShaderDataType::Float4, "a_Color"},    {renderer::ShaderDataType::Float2, "a_TexCoords"},
-        {renderer::ShaderDataType::Float3, "a_Tangent"},  {renderer::ShaderDataType::Float3, "a_Bitangent"}};
+    : m_vertex_array(vao), m_shader(shader), m_index_count(index_count), m_index_type(GL_UNSIGNED_INT) {
+    if (m_vertex_array && m_vertex_array->get_index_buffer())
+        m_index_type = m_vertex_array->get_index_buffer()->get_index_type();
+}
+
+std::shared_ptr<Mesh> Mesh::create_from_vertex_array(std::shared_ptr<renderer::VertexArray> vertex_array,
+                                                     std::vector<unsigned int> indices, const glm::vec3 *positions,
+                                                     std::size_t vertex_count, std::size_t stride,
+                                                     std::shared_ptr<renderer::Shader> shader) {
+    auto mesh = std::make_shared<Mesh>(vertex_array, shader, static_cast<unsigned int>(indices.size()));
+    mesh->m_indices = std::move(indices);
+    mesh->calculate_bounds(positions, vertex_count, stride);
+    return mesh;
+}
+
+uint64_t Mesh::next_uid() {
+    static std::atomic<uint64_t> s_next_uid{1};
+    return s_next_uid.fetch_add(1, std::memory_order_relaxed);
+}
+
+renderer::BufferLayout Mesh::get_vertex_layout() { return renderer::make_vertex_layout<Vertex>(); }
+
+renderer::BufferLayout Mesh::get_packed_vertex_layout() { return renderer::make_vertex_layout<PackedVertex>(); }
+
+// Octahedral mapping of a unit vector to [-1, 1]^2
+static glm::vec2 octahedral_encode(const glm::vec3 &n) {
+    float sum = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+    if (sum == 0.0f)
+        return glm::vec2(0.0f);
+    glm::vec2 p(n.x / sum, n.y / sum);
+    if (n.z < 0.0f) {
+        glm::vec2 folded((1.0f - std::abs(p.y)) * (p.x >= 0.0f ? 1.0f : -1.0f),
+                         (1.0f - std::abs(p.x)) * (p.y >= 0.0f ? 1.0f : -1.0f));
+        p = folded;
+    }
+    return p;
+}
+
+std::vector<PackedVertex> Mesh::pack_vertices(const std::vector<Vertex> &vertices) {
+    std::vector<PackedVertex> packed;
+    packed.reserve(vertices.size());
+    for (const auto &vertex : vertices) {
+        PackedVertex p;
+        p.position = vertex.position;
+        p.normal = glm::packSnorm2x16(octahedral_encode(vertex.normal));
+        p.color = glm::packUnorm4x8(vertex.color);
+        p.uvs = glm::packHalf2x16(vertex.uvs);
+        float handedness = glm::dot(glm::cross(vertex.normal, vertex.tangent), vertex.bitangent) < 0.0f ? -1.0f : 1.0f;
+        p.tangent = glm::packSnorm3x10_1x2(glm::vec4(vertex.tangent, handedness));
+        packed.push_back(p);
+    }
+    return packed;
+}
+
+// Inverse of octahedral_encode
+static glm::vec3 octahedral_decode(const glm::vec2 &p) {
+    glm::vec3 n(p.x, p.y, 1.0f - std::abs(p.x) - std::abs(p.y));
+    float t = std::max(-n.z, 0.0f);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    float length = glm::length(n);
+    return length > 0.0f ? n / length : glm::vec3(0.0f, 1.0f, 0.0f);
+}
+
+std::vector<Vertex> Mesh::unpack_vertices(const std::vector<PackedVertex> &packed) {
+    std::vector<Vertex> vertices;
+    vertices.reserve(packed.size());
+    for (const auto &p : packed) {
+        Vertex vertex(p.position, octahedral_decode(glm::unpackSnorm2x16(p.normal)), glm::unpackUnorm4x8(p.color),
+                      glm::unpackHalf2x16(p.uvs));
+        glm::vec4 tangent = glm::unpackSnorm3x10_1x2(p.tangent);
+        vertex.tangent = glm::vec3(tangent);
+        vertex.bitangent = glm::cross(vertex.normal, vertex.tangent) * (tangent.w < 0.0f ? -1.0f : 1.0f);
+        vertices.push_back(vertex);
+    }
+    return vertices;
+}
+
+// 16-bit indices when every vertex is addressable with them
+static std::shared_ptr<renderer::IndexBuffer> make_index_buffer(const std::vector<unsigned int> &indices,
+                                                              size_t vertex_count) {
+    if (vertex_count > std::numeric_limits<uint16_t>::max() + 1u)
+        return std::make_shared<renderer::IndexBuffer>(indices.data(), indices.size());
+    std::vector<uint16_t> short_indices(indices.begin(), indices.end());
+    return std::make_shared<renderer::IndexBuffer>(short_indices.data(), short_indices.size());
+}
+
+void Mesh::upload(const void *vertices, unsigned int vertex_count, const renderer::BufferLayout &layout,
+                  renderer::GeometryPool *pool) {
+    if (pool) {
+        if (pool->get_layout().get_stride() != layout.get_stride()) {
+            std::cerr << "Warning: Mesh: geometry pool layout does not match the vertex format, "
+                      << "using dedicated buffers" << std::endl;
+        } else {
+            m_allocation = pool->allocate(vertices, vertex_count, m_indices.data(), m_indices.size());
+            if (m_allocation) {
+                m_vertex_array = m_allocation->get_vertex_array();
+                return;
+            }
+        }
+    }
+    auto vbo = std::make_shared<renderer::VertexBuffer>(vertices, vertex_count * layout.get_stride());
     vbo->set_layout(layout);
-    auto ibo = std::make_shared<renderer::IndexBuffer>(m_indices.data(), m_indices.size());
+    auto ibo = make_index_buffer(m_indices, vertex_count);
+    m_index_type = ibo->get_index_type();
     m_vertex_array = std::make_shared<renderer::VertexArray>();
     m_vertex_array->add_vertex_buffer(vbo);
     m_vertex_array->set_index_buffer(ibo);
 }
 
+const glm::vec3 *Mesh::cpu_positions(std::size_t &stride, std::size_t &count) const {
+    if (!m_vertices.empty()) {
+        stride = sizeof(Vertex);
+        count = m_vertices.size();
+        return &m_vertices[0].position;
+    }
+    if (!m_compressed_vertices.empty()) {
+        stride = sizeof(PackedVertex);
+        count = m_compressed_vertices.size();
+        return &m_compressed_vertices[0].position;
+    }
+    stride = 0;
+    count = 0;
+    return nullptr;
+}
+
+bool Mesh::create_depth_stream() {
+    std::size_t stride, count;
+    const glm::vec3 *positions = cpu_positions(stride, count);
+    if (!positions || m_indices.empty()) {
+        std::cerr << "Warning: Mesh: no CPU vertices to build a depth stream from" << std::endl;
+        return false;
+    }
+    create_depth_stream(positions, count, stride);
+    return true;
+}
+
+void Mesh::create_depth_stream(const std::vector<glm::vec3> &positions) {
+    if (positions.empty() || m_indices.empty()) {
+        std::cerr << "Warning: Mesh: no positions to build a depth stream from" << std::endl;
+        return;
+    }
+    create_depth_stream(positions.data(), positions.size(), sizeof(glm::vec3));
+}
+
+void Mesh::create_depth_stream(const glm::vec3 *first_position, size_t count, size_t stride) {
+    std::vector<PositionVertex> positions(count);
+    const unsigned char *position = reinterpret_cast<const unsigned char *>(first_position);
+    for (size_t i = 0; i < count; ++i, position += stride)
+        positions[i].position = *reinterpret_cast<const glm::vec3 *>(position);
+    static const renderer::BufferLayout layout = renderer::make_vertex_layout<PositionVertex>();
+    auto vbo = std::make_shared<renderer::VertexBuffer>(positions.data(), count * layout.get_stride());
+    vbo->set_layout(layout);
+    // Dedicated meshes share their index buffer, pooled ones need indices relative to the new buffer
+    std::shared_ptr<renderer::IndexBuffer> ibo;
+    if (!m_allocation && m_vertex_array)
+        ibo = m_vertex_array->get_index_buffer();
+    if (!ibo)
+        ibo = make_index_buffer(m_indices, count);
+    m_depth_vertex_array = std::make_shared<renderer::VertexArray>();
+    m_depth_vertex_array->add_vertex_buffer(vbo);
+    m_depth_vertex_array->set_index_buffer(ibo);
+}
+
+bool Mesh::build_meshlets(unsigned int max_vertices, unsigned int max_triangles) {
+    std::size_t stride, count;
+    const glm::vec3 *positions = cpu_positions(stride, count);
+    if (!positions || m_indices.empty()) {
+        std::cerr << "Warning: Mesh: no CPU vertices to build meshlets from" << std::endl;
+        return false;
+    }
+    m_meshlets = scene::build_meshlets(m_indices, positions, static_cast<unsigned int>(count), stride, max_vertices,
+                                       max_triangles);
+    if (m_allocation) {
+        m_allocation->get_page()->get_index_buffer()->set_data(m_indices.data(), m_indices.size(),
+                                                               m_allocation->get_first_index());
+        return true;
+    }
+    auto ibo = make_index_buffer(m_indices, count);
+    m_vertex_array->set_index_buffer(ibo);
+    // The depth stream shares the dedicated index buffer, keep them in sync
+    if (m_depth_vertex_array)
+        m_depth_vertex_array->set_index_buffer(ibo);
+    return true;
+}
+
+bool Mesh::build_bvh() {
+    std::size_t stride, count;
+    const glm::vec3 *positions = cpu_positions(stride, count);
+    if (!positions || m_indices.empty()) {
+        std::cerr << "Warning: Mesh: no CPU geometry to build a BVH from" << std::endl;
+        return false;
+    }
+    m_bvh.build(positions, count, stride, m_indices);
+    return true;
+}
+
+bool Mesh::build_bvh(const glm::vec3 *positions, std::size_t vertex_count, std::size_t stride) {
+    if (!positions || m_indices.empty()) {
+        std::cerr << "Warning: Mesh: no geometry to build a BVH from" << std::endl;
+        return false;
+    }
+    m_bvh.build(positions, vertex_count, stride, m_indices);
+    return true;
+}
+
+bool Mesh::set_residency(GeometryResidency residency) {
+    if (residency == m_residency)
+        return true;
+    if (m_residency == GeometryResidency::Release) {
+        std::cerr << "ERROR: Mesh: released geometry cannot be restored" << std::endl;
+        return false;
+    }
+    if (residency == GeometryResidency::Keep) {
+        m_vertices = unpack_vertices(m_compressed_vertices);
+        std::vector<PackedVertex>().swap(m_compressed_vertices);
+        m_residency = residency;
+        return true;
+    }
+    if (residency == GeometryResidency::Compressed) {
+        m_compressed_vertices = pack_vertices(m_vertices);
+    } else {
+        // Picking must survive the geometry, build the BVH while positions are still here
+        if (m_bvh.empty() && !m_indices.empty() && (!m_vertices.empty() || !m_compressed_vertices.empty()))
+            build_bvh();
+        std::vector<PackedVertex>().swap(m_compressed_vertices);
+        std::vector<unsigned int>().swap(m_indices);
+    }
+    std::vector<Vertex>().swap(m_vertices);
+    m_residency = residency;
+    return true;
+}
+
+std::size_t Mesh::get_cpu_memory_usage() const {
+    return m_vertices.capacity() * sizeof(Vertex) + m_compressed_vertices.capacity() * sizeof(PackedVertex) +
+           m_indices.capacity() * sizeof(unsigned int) + m_bvh.get_memory_usage();
+}
+
+void Mesh::render_ranges(const std::vector<MeshletRange> &ranges) const {
+    if (ranges.empty())
+        return;
+    unsigned int first_index = m_allocation ? m_allocation->get_first_index() : 0;
+    unsigned int index_type = m_allocation ? GL_UNSIGNED_INT : m_index_type;
+    size_t index_size = index_type == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(unsigned int);
+    std::vector<GLsizei> counts(ranges.size());
+    std::vector<const void *> offsets(ranges.size());
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        counts[i] = static_cast<GLsizei>(ranges[i].index_count);
+        offsets[i] = reinterpret_cast<const void *>(
+            static_cast<uintptr_t>(first_index + ranges[i].first_index) * index_size);
+    }
+    if (m_allocation) {
+        std::vector<GLint> base_vertices(ranges.size(), static_cast<GLint>(m_allocation->get_base_vertex()));
+        glMultiDrawElementsBaseVertex(GL_TRIANGLES, counts.data(), index_type, offsets.data(),
+                                      static_cast<GLsizei>(ranges.size()), base_vertices.data());
+        return;
+    }
+    glMultiDrawElements(GL_TRIANGLES, counts.data(), index_type, offsets.data(), static_cast<GLsizei>(ranges.size()));
+}
+
 void Mesh::calculate_bounds() {
-    if (m_vertices.empty()) {
+    calculate_bounds(m_vertices.empty() ? nullptr : &m_vertices[0].position, m_vertices.size(), sizeof(Vertex));
+}
+
+void Mesh::calculate_bounds(const glm::vec3 *first_position, size_t count, size_t stride) {
+    if (!first_position || count == 0) {
         m_bounding_box = AABB();
         m_bounding_sphere = BoundingSphere();
         return;
     }
     m_bounding_box.min = glm::vec3(std::numeric_limits<float>::max());
     m_bounding_box.max = glm::vec3(std::numeric_limits<float>::lowest());
-    for (const auto &vertex : m_vertices)
-        m_bounding_box.expand(vertex.position);
+    const unsigned char *position = reinterpret_cast<const unsigned char *>(first_position);
+    for (size_t i = 0; i < count; ++i, position += stride)
+        m_bounding_box.expand(*reinterpret_cast<const glm::vec3 *>(position));
     m_bounding_sphere = BoundingSphere::from_aabb(m_bounding_box);
 }
 
@@ -64,7 +343,24 @@ void Mesh::unbind() const {
         m_vertex_array->unbind();
 }
 
-void Mesh::render() const { glDrawElements(GL_TRIANGLES, m_index_count, GL_UNSIGNED_INT, nullptr); }
+void Mesh::render() const {
+    if (m_allocation) {
+        const void *first_index = reinterpret_cast<const void *>(
+            static_cast<uintptr_t>(m_allocation->get_first_index()) * sizeof(unsigned int));
+        glDrawElementsBaseVertex(GL_TRIANGLES, m_index_count, GL_UNSIGNED_INT, first_index,
+                                 m_allocation->get_base_vertex());
+        return;
+    }
+    glDrawElements(GL_TRIANGLES, m_index_count, m_index_type, nullptr);
+}
+
+void Mesh::render_depth() const {
+    if (!m_depth_vertex_array) {
+        render();
+        return;
+    }
+    glDrawElements(GL_TRIANGLES, m_index_count, m_depth_vertex_array->get_index_buffer()->get_index_type(), nullptr);
+}
 
 std::shared_ptr<Mesh> Mesh::create_cube(std::shared_ptr<renderer::Shader> shader, unsigned int subdivisions) {
     std::vector<Vertex> vertices;
@@ -105,7 +401,8 @@ std::shared_ptr<Mesh> Mesh::create_cube(std::shared_ptr<renderer::Shader> shader
     generate_face(glm::vec3(0, -0.5f, 0), glm::vec3(1, 0, 0), glm::vec3(0, 0, 1), glm::vec3(0, -1, 0));
     generate_face(glm::vec3(0.5f, 0, 0), glm::vec3(0, 0, -1), glm::vec3(0, 1, 0), glm::vec3(1, 0, 0));
     generate_face(glm::vec3(-0.5f, 0, 0), glm::vec3(0, 0, 1), glm::vec3(0, 1, 0), glm::vec3(-1, 0, 0));
-    return std::make_shared<Mesh>(vertices, indices, shader);
+    MeshOptimizer::optimize(vertices, indices);
+    return std::make_shared<Mesh>(std::move(vertices), std::move(indices), shader);
 }
 
 std::shared_ptr<Mesh> Mesh::create_quad(std::shared_ptr<renderer::Shader> shader, float width, float height) {
@@ -117,7 +414,7 @@ std::shared_ptr<Mesh> Mesh::create_quad(std::shared_ptr<renderer::Shader> shader
         {glm::vec3(halfw, halfh, 0.0f), glm::vec3(0, 0, 1), glm::vec4(1.0f), glm::vec2(1.0f, 1.0f)},
         {glm::vec3(-halfw, halfh, 0.0f), glm::vec3(0, 0, 1), glm::vec4(1.0f), glm::vec2(0.0f, 1.0f)}};
     std::vector<unsigned int> indices = {0, 1, 2, 2, 3, 0};
-    return std::make_shared<Mesh>(vertices, indices, shader);
+    return std::make_shared<Mesh>(std::move(vertices), std::move(indices), shader);
 }
 
 std::shared_ptr<Mesh> Mesh::create_sphere(std::shared_ptr<renderer::Shader> shader, float radius, unsigned int latsegs,
@@ -161,7 +458,8 @@ std::shared_ptr<Mesh> Mesh::create_sphere(std::shared_ptr<renderer::Shader> shad
         }
     }
 
-    return std::make_shared<Mesh>(vertices, indices, shader);
+    MeshOptimizer::optimize(vertices, indices);
+    return std::make_shared<Mesh>(std::move(vertices), std::move(indices), shader);
 }
 
 } // namespace scene
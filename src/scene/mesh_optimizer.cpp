@@ -0,0 +1,298 @@
+#include "lmgl/scene/mesh_optimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace lmgl {
+
+namespace scene {
+
+// Position of a vertex inside a strided array
+static const glm::vec3 &position_at(const glm::vec3 *positions, std::size_t stride, unsigned int index) {
+    return *reinterpret_cast<const glm::vec3 *>(reinterpret_cast<const unsigned char *>(positions) + index * stride);
+}
+
+// FIFO post-transform cache, timestamps avoid clearing on reset
+class FifoCacheSimulator {
+  public:
+    FifoCacheSimulator(unsigned int vertex_count, unsigned int cache_size)
+        : m_timestamps(vertex_count, 0), m_cache_size(cache_size), m_time(cache_size + 1) {}
+
+    // Returns the number of misses of one triangle
+    unsigned int add_triangle(const unsigned int *triangle) {
+        unsigned int misses = 0;
+        for (int i = 0; i < 3; ++i) {
+            unsigned int vertex = triangle[i];
+            if (m_time - m_timestamps[vertex] > m_cache_size) {
+                m_timestamps[vertex] = m_time++;
+                ++misses;
+            }
+        }
+        return misses;
+    }
+
+    void flush() { m_time += m_cache_size + 1; }
+
+  private:
+    std::vector<unsigned int> m_timestamps;
+    unsigned int m_cache_size;
+    unsigned int m_time;
+};
+
+VertexCacheStatistics MeshOptimizer::analyze_vertex_cache(const std::vector<unsigned int> &indices,
+                                                          unsigned int vertex_count, unsigned int cache_size) {
+    VertexCacheStatistics statistics;
+    size_t triangle_count = indices.size() / 3;
+    if (triangle_count == 0 || vertex_count == 0)
+        return statistics;
+    FifoCacheSimulator cache(vertex_count, cache_size);
+    for (size_t i = 0; i < triangle_count; ++i)
+        statistics.vertices_transformed += cache.add_triangle(&indices[i * 3]);
+    statistics.acmr = static_cast<float>(statistics.vertices_transformed) / triangle_count;
+    statistics.atvr = static_cast<float>(statistics.vertices_transformed) / vertex_count;
+    return statistics;
+}
+
+// Forsyth scoring constants, see "Linear-Speed Vertex Cache Optimisation" (2006)
+static constexpr int forsyth_cache_size = 32;
+static constexpr float forsyth_cache_decay = 1.5f;
+static constexpr float forsyth_last_triangle_score = 0.75f;
+static constexpr float forsyth_valence_scale = 2.0f;
+static constexpr float forsyth_valence_power = 0.5f;
+
+static float forsyth_vertex_score(int cache_position, unsigned int live_triangles) {
+    if (live_triangles == 0)
+        return -1.0f;
+    float score = 0.0f;
+    if (cache_position >= 0) {
+        // The three vertices of the last triangle get a fixed score so that no winding is preferred
+        if (cache_position < 3) {
+            score = forsyth_last_triangle_score;
+        } else {
+            float scaler = 1.0f / (forsyth_cache_size - 3);
+            score = std::pow(1.0f - (cache_position - 3) * scaler, forsyth_cache_decay);
+        }
+    }
+    score += forsyth_valence_scale * std::pow(static_cast<float>(live_triangles), -forsyth_valence_power);
+    return score;
+}
+
+std::vector<unsigned int> MeshOptimizer::optimize_vertex_cache(const std::vector<unsigned int> &indices,
+                                                               unsigned int vertex_count) {
+    size_t triangle_count = indices.size() / 3;
+    if (triangle_count == 0 || vertex_count == 0)
+        return indices;
+
+    // Vertex to triangle adjacency, stored as offsets into one array
+    std::vector<unsigned int> live_triangles(vertex_count, 0);
+    for (size_t i = 0; i < triangle_count * 3; ++i)
+        ++live_triangles[indices[i]];
+    std::vector<unsigned int> adjacency_offsets(vertex_count + 1, 0);
+    for (unsigned int v = 0; v < vertex_count; ++v)
+        adjacency_offsets[v + 1] = adjacency_offsets[v] + live_triangles[v];
+    std::vector<unsigned int> adjacency(triangle_count * 3);
+    std::vector<unsigned int> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+    for (size_t t = 0; t < triangle_count; ++t) {
+        for (int k = 0; k < 3; ++k)
+            adjacency[fill[indices[t * 3 + k]]++] = static_cast<unsigned int>(t);
+    }
+
+    std::vector<int> cache_position(vertex_count, -1);
+    std::vector<float> vertex_score(vertex_count);
+    for (unsigned int v = 0; v < vertex_count; ++v)
+        vertex_score[v] = forsyth_vertex_score(-1, live_triangles[v]);
+    std::vector<bool> emitted(triangle_count, false);
+
+    std::vector<unsigned int> result;
+    result.reserve(triangle_count * 3);
+    std::vector<unsigned int> cache;
+    std::vector<unsigned int> next_cache;
+    cache.reserve(forsyth_cache_size + 3);
+    next_cache.reserve(forsyth_cache_size + 3);
+    size_t scan_cursor = 0;
+    long best_triangle = -1;
+
+    for (size_t emitted_count = 0; emitted_count < triangle_count; ++emitted_count) {
+        // Nothing adjacent to the cache, restart from the first remaining triangle in input order
+        if (best_triangle < 0)
+            best_triangle = static_cast<long>(scan_cursor);
+        const unsigned int *triangle = &indices[best_triangle * 3];
+        result.insert(result.end(), triangle, triangle + 3);
+        emitted[best_triangle] = true;
+        while (scan_cursor < triangle_count && emitted[scan_cursor])
+            ++scan_cursor;
+
+        // Emitted vertices move to the front of the LRU cache
+        next_cache.clear();
+        for (int k = 0; k < 3; ++k) {
+            if (std::find(next_cache.begin(), next_cache.end(), triangle[k]) == next_cache.end())
+                next_cache.push_back(triangle[k]);
+        }
+        for (int k = 0; k < 3; ++k) {
+            unsigned int v = triangle[k];
+            unsigned int *begin = &adjacency[adjacency_offsets[v]];
+            unsigned int *end = begin + live_triangles[v];
+            std::iter_swap(std::find(begin, end, static_cast<unsigned int>(best_triangle)), end - 1);
+            --live_triangles[v];
+        }
+        for (unsigned int v : cache) {
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+                next_cache.push_back(v);
+        }
+        cache.swap(next_cache);
+
+        // Rescore cached and evicted vertices, then the triangles that use them
+        for (size_t i = 0; i < cache.size(); ++i) {
+            unsigned int v = cache[i];
+            cache_position[v] = i < static_cast<size_t>(forsyth_cache_size) ? static_cast<int>(i) : -1;
+            vertex_score[v] = forsyth_vertex_score(cache_position[v], live_triangles[v]);
+        }
+        best_triangle = -1;
+        float best_score = -1.0f;
+        for (unsigned int v : cache) {
+            for (unsigned int a = 0; a < live_triangles[v]; ++a) {
+                unsigned int t = adjacency[adjacency_offsets[v] + a];
+                float score = vertex_score[indices[t * 3]] + vertex_score[indices[t * 3 + 1]] +
+                              vertex_score[indices[t * 3 + 2]];
+                if (score > best_score) {
+                    best_score = score;
+                    best_triangle = t;
+                }
+            }
+        }
+        if (cache.size() > static_cast<size_t>(forsyth_cache_size))
+            cache.resize(forsyth_cache_size);
+    }
+    return result;
+}
+
+std::vector<unsigned int> MeshOptimizer::optimize_overdraw(const std::vector<unsigned int> &indices,
+                                                           const glm::vec3 *positions, unsigned int vertex_count,
+                                                           std::size_t stride, float threshold) {
+    size_t triangle_count = indices.size() / 3;
+    if (triangle_count == 0 || vertex_count == 0 || !positions)
+        return indices;
+
+    // Hard boundaries: triangles that miss on every vertex start over with a cold cache anyway
+    std::vector<size_t> hard_boundaries = {0};
+    FifoCacheSimulator cache(vertex_count, default_cache_size);
+    for (size_t t = 0; t < triangle_count; ++t) {
+        if (cache.add_triangle(&indices[t * 3]) == 3 && t > 0)
+            hard_boundaries.push_back(t);
+    }
+    hard_boundaries.push_back(triangle_count);
+
+    // Soft boundaries: cut inside a hard cluster where its running ACMR stays within threshold
+    std::vector<size_t> clusters;
+    for (size_t h = 0; h + 1 < hard_boundaries.size(); ++h) {
+        size_t start = hard_boundaries[h];
+        size_t end = hard_boundaries[h + 1];
+        cache.flush();
+        unsigned int cluster_misses = 0;
+        for (size_t t = start; t < end; ++t)
+            cluster_misses += cache.add_triangle(&indices[t * 3]);
+        float cluster_threshold = threshold * cluster_misses / (end - start);
+
+        cache.flush();
+        clusters.push_back(start);
+        unsigned int running_misses = 0;
+        size_t running_start = start;
+        for (size_t t = start; t < end; ++t) {
+            running_misses += cache.add_triangle(&indices[t * 3]);
+            if (t + 1 < end && static_cast<float>(running_misses) / (t + 1 - running_start) <= cluster_threshold) {
+                clusters.push_back(t + 1);
+                running_start = t + 1;
+                running_misses = 0;
+                cache.flush();
+            }
+        }
+    }
+
+    // Area-weighted centroid of the whole mesh
+    glm::vec3 mesh_centroid(0.0f);
+    float mesh_area = 0.0f;
+    std::vector<glm::vec3> triangle_centroids(triangle_count);
+    std::vector<glm::vec3> triangle_normals(triangle_count);
+    for (size_t t = 0; t < triangle_count; ++t) {
+        const glm::vec3 &p0 = position_at(positions, stride, indices[t * 3]);
+        const glm::vec3 &p1 = position_at(positions, stride, indices[t * 3 + 1]);
+        const glm::vec3 &p2 = position_at(positions, stride, indices[t * 3 + 2]);
+        // Cross product length is twice the area, the factor cancels out
+        triangle_normals[t] = glm::cross(p1 - p0, p2 - p0);
+        triangle_centroids[t] = (p0 + p1 + p2) / 3.0f;
+        float area = glm::length(triangle_normals[t]);
+        mesh_centroid += triangle_centroids[t] * area;
+        mesh_area += area;
+    }
+    if (mesh_area > 0.0f)
+        mesh_centroid /= mesh_area;
+
+    // Clusters facing away from the centre are likely to occlude the others
+    size_t cluster_count = clusters.size();
+    clusters.push_back(triangle_count);
+    std::vector<float> sort_keys(cluster_count);
+    for (size_t c = 0; c < cluster_count; ++c) {
+        glm::vec3 centroid(0.0f);
+        glm::vec3 normal(0.0f);
+        float area = 0.0f;
+        for (size_t t = clusters[c]; t < clusters[c + 1]; ++t) {
+            float triangle_area = glm::length(triangle_normals[t]);
+            centroid += triangle_centroids[t] * triangle_area;
+            normal += triangle_normals[t];
+            area += triangle_area;
+        }
+        if (area > 0.0f)
+            centroid /= area;
+        float normal_length = glm::length(normal);
+        if (normal_length > 0.0f)
+            normal /= normal_length;
+        sort_keys[c] = glm::dot(centroid - mesh_centroid, normal);
+    }
+    std::vector<size_t> order(cluster_count);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sort_keys[a] > sort_keys[b]; });
+
+    std::vector<unsigned int> result;
+    result.reserve(triangle_count * 3);
+    for (size_t c : order)
+        result.insert(result.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+    return result;
+}
+
+std::vector<unsigned int> MeshOptimizer::optimize_vertex_fetch_remap(std::vector<unsigned int> &indices,
+                                                                     unsigned int vertex_count) {
+    std::vector<unsigned int> remap(vertex_count, invalid);
+    unsigned int next = 0;
+    for (unsigned int &index : indices) {
+        if (remap[index] == invalid)
+            remap[index] = next++;
+        index = remap[index];
+    }
+    return remap;
+}
+
+MeshOptimizationReport MeshOptimizer::optimize(std::vector<Vertex> &vertices, std::vector<unsigned int> &indices,
+                                               const MeshOptimizerOptions &options) {
+    MeshOptimizationReport report;
+    unsigned int vertex_count = static_cast<unsigned int>(vertices.size());
+    report.before = analyze_vertex_cache(indices, vertex_count);
+    if (indices.size() % 3 != 0 || vertices.empty()) {
+        report.after = report.before;
+        return report;
+    }
+    if (options.vertex_cache)
+        indices = optimize_vertex_cache(indices, vertex_count);
+    if (options.overdraw) {
+        indices = optimize_overdraw(indices, &vertices[0].position, vertex_count, sizeof(Vertex),
+                                    options.overdraw_threshold);
+    }
+    if (options.vertex_fetch)
+        optimize_vertex_fetch(vertices, indices);
+    report.after = analyze_vertex_cache(indices, static_cast<unsigned int>(vertices.size()));
+    return report;
+}
+
+} // namespace scene
+
+} // namespace lmgl
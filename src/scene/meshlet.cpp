@@ -0,0 +1,203 @@
+#include "lmgl/scene/meshlet.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace lmgl {
+
+namespace scene {
+
+// Position of a vertex inside a strided array
+static const glm::vec3 &position_at(const glm::vec3 *positions, std::size_t stride, unsigned int index) {
+    return *reinterpret_cast<const glm::vec3 *>(reinterpret_cast<const unsigned char *>(positions) + index * stride);
+}
+
+// Normal cones wider than this (dot of the widest normal with the axis) never cull, so skip them
+static constexpr float MIN_CONE_SPREAD = 0.1f;
+
+// Bounds and normal cone of the triangles in [first, first + count * 3)
+static void compute_meshlet_bounds(Meshlet &meshlet, const std::vector<unsigned int> &indices,
+                                   const glm::vec3 *positions, std::size_t stride) {
+    AABB box(glm::vec3(std::numeric_limits<float>::max()), glm::vec3(std::numeric_limits<float>::lowest()));
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec3> corners;
+    normals.reserve(meshlet.triangle_count);
+    corners.reserve(meshlet.triangle_count);
+    glm::vec3 axis(0.0f);
+    for (unsigned int t = 0; t < meshlet.triangle_count; ++t) {
+        const unsigned int *triangle = &indices[meshlet.first_index + t * 3];
+        const glm::vec3 &p0 = position_at(positions, stride, triangle[0]);
+        const glm::vec3 &p1 = position_at(positions, stride, triangle[1]);
+        const glm::vec3 &p2 = position_at(positions, stride, triangle[2]);
+        box.expand(p0);
+        box.expand(p1);
+        box.expand(p2);
+        glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+        float length = glm::length(normal);
+        // Degenerate triangles are never rasterized and do not constrain the cone
+        if (length > 0.0f) {
+            normals.push_back(normal / length);
+            corners.push_back(p0);
+            axis += normals.back();
+        }
+    }
+    meshlet.bounds = BoundingSphere::from_aabb(box);
+    float axis_length = glm::length(axis);
+    meshlet.cone_cutoff = 1.0f;
+    if (normals.empty() || axis_length == 0.0f)
+        return;
+    meshlet.cone_axis = axis / axis_length;
+    float min_dot = 1.0f;
+    for (const auto &normal : normals)
+        min_dot = std::min(min_dot, glm::dot(meshlet.cone_axis, normal));
+    if (min_dot <= MIN_CONE_SPREAD)
+        return;
+    meshlet.cone_cutoff = std::sqrt(1.0f - min_dot * min_dot);
+    // Move back from the centre along the axis until the point is behind every triangle plane
+    float max_t = 0.0f;
+    for (size_t i = 0; i < normals.size(); ++i) {
+        float t = glm::dot(meshlet.bounds.center - corners[i], normals[i]) / glm::dot(meshlet.cone_axis, normals[i]);
+        max_t = std::max(max_t, t);
+    }
+    meshlet.cone_apex = meshlet.bounds.center - meshlet.cone_axis * max_t;
+}
+
+std::vector<Meshlet> build_meshlets(std::vector<unsigned int> &indices, const glm::vec3 *positions,
+                                    unsigned int vertex_count, std::size_t stride, unsigned int max_vertices,
+                                    unsigned int max_triangles) {
+    std::vector<Meshlet> meshlets;
+    size_t triangle_count = indices.size() / 3;
+    if (triangle_count == 0 || vertex_count == 0 || !positions)
+        return meshlets;
+    max_vertices = std::max(max_vertices, 3u);
+    max_triangles = std::max(max_triangles, 1u);
+
+    // Vertex to triangle adjacency, stored as offsets into one array
+    std::vector<unsigned int> adjacency_offsets(vertex_count + 1, 0);
+    for (size_t i = 0; i < triangle_count * 3; ++i)
+        ++adjacency_offsets[indices[i] + 1];
+    for (unsigned int v = 0; v < vertex_count; ++v)
+        adjacency_offsets[v + 1] += adjacency_offsets[v];
+    std::vector<unsigned int> adjacency(triangle_count * 3);
+    std::vector<unsigned int> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+    for (size_t t = 0; t < triangle_count; ++t) {
+        for (int k = 0; k < 3; ++k)
+            adjacency[fill[indices[t * 3 + k]]++] = static_cast<unsigned int>(t);
+    }
+
+    const unsigned int none = std::numeric_limits<unsigned int>::max();
+    // Meshlet that last used each vertex, avoids clearing a set for every meshlet
+    std::vector<unsigned int> vertex_owner(vertex_count, none);
+    std::vector<bool> emitted(triangle_count, false);
+    std::vector<unsigned int> meshlet_vertices;
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+    size_t seed = 0;
+
+    auto new_vertex_count = [&](size_t t, unsigned int owner) {
+        unsigned int a = indices[t * 3], b = indices[t * 3 + 1], c = indices[t * 3 + 2];
+        unsigned int count = (vertex_owner[a] != owner) + (vertex_owner[b] != owner && b != a) +
+                             (vertex_owner[c] != owner && c != a && c != b);
+        return count;
+    };
+
+    while (true) {
+        while (seed < triangle_count && emitted[seed])
+            ++seed;
+        if (seed == triangle_count)
+            break;
+        unsigned int id = static_cast<unsigned int>(meshlets.size());
+        Meshlet meshlet;
+        meshlet.first_index = static_cast<unsigned int>(result.size());
+        meshlet_vertices.clear();
+        glm::vec3 position_sum(0.0f);
+
+        size_t candidate = seed;
+        while (candidate != none) {
+            for (int k = 0; k < 3; ++k) {
+                unsigned int v = indices[candidate * 3 + k];
+                if (vertex_owner[v] != id) {
+                    vertex_owner[v] = id;
+                    meshlet_vertices.push_back(v);
+                    position_sum += position_at(positions, stride, v);
+                }
+                result.push_back(v);
+            }
+            emitted[candidate] = true;
+            if (++meshlet.triangle_count == max_triangles)
+                break;
+
+            // Neighbour that adds the fewest vertices, closest to the meshlet centre on ties
+            glm::vec3 centroid = position_sum / static_cast<float>(meshlet_vertices.size());
+            candidate = none;
+            unsigned int best_new = 4;
+            float best_distance = std::numeric_limits<float>::max();
+            for (unsigned int v : meshlet_vertices) {
+                for (unsigned int a = adjacency_offsets[v]; a < adjacency_offsets[v + 1]; ++a) {
+                    unsigned int t = adjacency[a];
+                    if (emitted[t])
+                        continue;
+                    unsigned int added = new_vertex_count(t, id);
+                    if (meshlet_vertices.size() + added > max_vertices || added > best_new)
+                        continue;
+                    glm::vec3 center = (position_at(positions, stride, indices[t * 3]) +
+                                        position_at(positions, stride, indices[t * 3 + 1]) +
+                                        position_at(positions, stride, indices[t * 3 + 2])) /
+                                       3.0f;
+                    glm::vec3 offset = center - centroid;
+                    float distance = glm::dot(offset, offset);
+                    if (added < best_new || distance < best_distance) {
+                        best_new = added;
+                        best_distance = distance;
+                        candidate = t;
+                    }
+                }
+            }
+        }
+        meshlet.vertex_count = static_cast<unsigned int>(meshlet_vertices.size());
+        meshlets.push_back(meshlet);
+    }
+
+    indices.swap(result);
+    for (auto &meshlet : meshlets)
+        compute_meshlet_bounds(meshlet, indices, positions, stride);
+    return meshlets;
+}
+
+bool is_meshlet_backfacing(const Meshlet &meshlet, const glm::vec3 &camera_position) {
+    if (meshlet.cone_cutoff >= 1.0f)
+        return false;
+    // Every triangle faces away when the view direction to the apex lies inside the cone
+    glm::vec3 to_apex = meshlet.cone_apex - camera_position;
+    float distance = glm::length(to_apex);
+    return distance > 0.0f && glm::dot(to_apex, meshlet.cone_axis) >= meshlet.cone_cutoff * distance;
+}
+
+unsigned int cull_meshlets(const std::vector<Meshlet> &meshlets, const Frustum &frustum, const glm::mat4 &model,
+                           const glm::vec3 &camera_position, bool cone_culling, std::vector<MeshletRange> &ranges) {
+    ranges.clear();
+    // Facing is affine invariant, so test cones in object space; mirrored transforms flip the winding
+    cone_culling = cone_culling && glm::determinant(glm::mat3(model)) > 0.0f;
+    glm::vec3 local_camera(0.0f);
+    if (cone_culling)
+        local_camera = glm::vec3(glm::inverse(model) * glm::vec4(camera_position, 1.0f));
+    unsigned int visible_triangles = 0;
+    for (const auto &meshlet : meshlets) {
+        if (cone_culling && is_meshlet_backfacing(meshlet, local_camera))
+            continue;
+        if (!frustum.contains_sphere(meshlet.bounds.transform(model)))
+            continue;
+        unsigned int index_count = meshlet.triangle_count * 3;
+        if (!ranges.empty() && ranges.back().first_index + ranges.back().index_count == meshlet.first_index)
+            ranges.back().index_count += index_count;
+        else
+            ranges.push_back({meshlet.first_index, index_count});
+        visible_triangles += meshlet.triangle_count;
+    }
+    return visible_triangles;
+}
+
+} // namespace scene
+
+} // namespace lmgl
@@ -55,6 +55,24 @@ void Node::look_at(const glm::vec3 &target, const glm::vec3 &up) {
 
 // Hierarchy
 
+std::shared_ptr<Node> Node::clone() const {
+    auto node = std::make_shared<Node>(m_name);
+    node->m_position = m_position;
+    node->m_rotation = m_rotation;
+    node->m_scale = m_scale;
+    node->m_local_transform = m_local_transform;
+    node->m_world_transform = m_world_transform;
+    node->m_mesh = m_mesh;
+    node->m_lod = m_lod;
+    node->m_static = m_static;
+    if (m_light)
+        node->m_light = std::make_shared<Light>(*m_light);
+    node->m_children.reserve(m_children.size());
+    for (const auto &child : m_children)
+        node->add_child(child->clone());
+    return node;
+}
+
 void Node::add_child(std::shared_ptr<Node> child) {
     if (!child)
         return;
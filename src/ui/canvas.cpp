@@ -1,4 +1,5 @@
 #include "lmgl/ui/canvas.hpp"
+#include "lmgl/ui/text.hpp"
 
 #include <glad/glad.h>
 #include <glm/gtc/matrix_transform.hpp>
@@ -46,6 +47,7 @@ void Canvas::render() {
     for (const auto &item : render_items) {
         item->render(static_cast<float>(m_width), static_cast<float>(m_height), m_projection);
     }
+    Text::end_frame();
     glDisable(GL_BLEND);
     glEnable(GL_DEPTH_TEST);
     glEnable(GL_CULL_FACE);
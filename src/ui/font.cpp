@@ -154,7 +154,7 @@ float Font::measure_text(const std::string &text) const {
 }
 
 // FontManager implementation
-std::unordered_map<std::string, std::shared_ptr<Font>> FontManager::s_fonts;
+core::ResourceCache<Font> FontManager::s_fonts([](const Font &font) { return font.get_memory_usage(); });
 
 FontManager &FontManager::get() {
     static FontManager instance;
@@ -164,14 +164,12 @@ FontManager &FontManager::get() {
 std::shared_ptr<Font> FontManager::load(const std::string &name, const std::string &filepath, unsigned int font_size) {
     std::string key = name + "_" + std::to_string(font_size);
     
-    if (exists(key)) {
-        return s_fonts[key];
+    if (auto font = s_fonts.find(key)) {
+        return font;
     }
 
     try {
-        auto font = std::make_shared<Font>(filepath, font_size);
-        s_fonts[key] = font;
-        return font;
+        return s_fonts.insert(key, std::make_shared<Font>(filepath, font_size));
     } catch (const std::exception &e) {
         std::cerr << "Failed to load font '" << name << "': " << e.what() << std::endl;
         return nullptr;
@@ -179,21 +177,33 @@ std::shared_ptr<Font> FontManager::load(const std::string &name, const std::stri
 }
 
 std::shared_ptr<Font> FontManager::get_font(const std::string &name) {
-    auto it = s_fonts.find(name);
-    if (it != s_fonts.end()) {
-        return it->second;
-    }
-    return nullptr;
+    return s_fonts.get(name);
 }
 
 bool FontManager::exists(const std::string &name) const {
-    return s_fonts.find(name) != s_fonts.end();
+    return s_fonts.contains(name);
 }
 
 void FontManager::clear() {
     s_fonts.clear();
 }
 
+void FontManager::set_budget(size_t bytes) {
+    s_fonts.set_budget(bytes);
+}
+
+size_t FontManager::get_budget() const {
+    return s_fonts.get_budget();
+}
+
+const core::CacheStats &FontManager::get_stats() const {
+    return s_fonts.get_stats();
+}
+
+void FontManager::reset_stats() {
+    s_fonts.reset_stats();
+}
+
 } // namespace ui
 
 } // namespace lmgl
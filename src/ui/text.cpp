@@ -12,6 +12,7 @@
 #include "lmgl/renderer/shader.hpp"
 #include "lmgl/renderer/texture.hpp"
 #include "lmgl/renderer/vertex_array.hpp"
+#include "lmgl/scene/vertex.hpp"
 
 #include <glad/glad.h>
 
@@ -21,7 +22,7 @@ namespace ui {
 
 std::shared_ptr<renderer::Shader> Text::s_shader = nullptr;
 std::shared_ptr<renderer::VertexArray> Text::s_vao = nullptr;
-std::shared_ptr<renderer::VertexBuffer> Text::s_vbo = nullptr;
+std::shared_ptr<renderer::StreamBuffer> Text::s_stream = nullptr;
 bool Text::s_initialized = false;
 
 Text::Text(const std::string &text, const std::string &name)
@@ -35,14 +36,9 @@ void Text::initialize_resources() {
 
     s_vao = std::make_shared<renderer::VertexArray>();
 
-    // Create dynamic vertex buffer (large enough for long strings)
-    s_vbo = std::make_shared<renderer::VertexBuffer>(nullptr, 4096 * sizeof(float), true);
-    s_vbo->set_layout({
-        {renderer::ShaderDataType::Float2, "a_position"},
-        {renderer::ShaderDataType::Float2, "a_tex_coord"}
-    });
-
-    s_vao->add_vertex_buffer(s_vbo);
+    // Streaming ring for glyph quads (each region fits 2730 characters)
+    s_stream = std::make_shared<renderer::StreamBuffer>(256 * 1024);
+    s_vao->add_stream_buffer(s_stream, renderer::make_vertex_layout<scene::UIVertex>());
 
     s_initialized = true;
 }
@@ -97,8 +93,8 @@ void Text::render(float canvas_width, float canvas_height, const glm::mat4 &proj
     s_vao->bind();
 
     // Batch render all characters
-    std::vector<float> vertices;
-    vertices.reserve(m_text.size() * 24); // 6 vertices * 4 floats per character
+    std::vector<scene::UIVertex> vertices;
+    vertices.reserve(m_text.size() * 6); // 6 vertices per character
 
     for (char c : m_text) {
         const Glyph &glyph = m_font->get_glyph(c);
@@ -111,51 +107,36 @@ void Text::render(float canvas_width, float canvas_height, const glm::mat4 &proj
 
         // Add 6 vertices (2 triangles) for this character
         // Triangle 1
-        vertices.push_back(xpos);
-        vertices.push_back(ypos + h);
-        vertices.push_back(glyph.tex_coord_min.x);
-        vertices.push_back(glyph.tex_coord_max.y);
-
-        vertices.push_back(xpos);
-        vertices.push_back(ypos);
-        vertices.push_back(glyph.tex_coord_min.x);
-        vertices.push_back(glyph.tex_coord_min.y);
-
-        vertices.push_back(xpos + w);
-        vertices.push_back(ypos);
-        vertices.push_back(glyph.tex_coord_max.x);
-        vertices.push_back(glyph.tex_coord_min.y);
+        vertices.push_back({glm::vec2(xpos, ypos + h), glm::vec2(glyph.tex_coord_min.x, glyph.tex_coord_max.y)});
+        vertices.push_back({glm::vec2(xpos, ypos), glm::vec2(glyph.tex_coord_min.x, glyph.tex_coord_min.y)});
+        vertices.push_back({glm::vec2(xpos + w, ypos), glm::vec2(glyph.tex_coord_max.x, glyph.tex_coord_min.y)});
 
         // Triangle 2
-        vertices.push_back(xpos);
-        vertices.push_back(ypos + h);
-        vertices.push_back(glyph.tex_coord_min.x);
-        vertices.push_back(glyph.tex_coord_max.y);
-
-        vertices.push_back(xpos + w);
-        vertices.push_back(ypos);
-        vertices.push_back(glyph.tex_coord_max.x);
-        vertices.push_back(glyph.tex_coord_min.y);
-
-        vertices.push_back(xpos + w);
-        vertices.push_back(ypos + h);
-        vertices.push_back(glyph.tex_coord_max.x);
-        vertices.push_back(glyph.tex_coord_max.y);
+        vertices.push_back({glm::vec2(xpos, ypos + h), glm::vec2(glyph.tex_coord_min.x, glyph.tex_coord_max.y)});
+        vertices.push_back({glm::vec2(xpos + w, ypos), glm::vec2(glyph.tex_coord_max.x, glyph.tex_coord_min.y)});
+        vertices.push_back({glm::vec2(xpos + w, ypos + h), glm::vec2(glyph.tex_coord_max.x, glyph.tex_coord_max.y)});
 
         x += glyph.advance;
     }
 
-    // Upload all vertices at once and render
+    // Stream all vertices at once and render from where they landed in the ring
     if (!vertices.empty()) {
-        s_vbo->bind();
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_DYNAMIC_DRAW);
-        glDrawArrays(GL_TRIANGLES, 0, vertices.size() / 4);
+        const unsigned int stride = sizeof(scene::UIVertex);
+        unsigned int offset =
+            s_stream->push(vertices.data(), static_cast<unsigned int>(vertices.size() * stride), stride);
+        if (offset != renderer::StreamBuffer::invalid)
+            glDrawArrays(GL_TRIANGLES, offset / stride, vertices.size());
     }
 
     s_vao->unbind();
     s_shader->unbind();
 }
 
+void Text::end_frame() {
+    if (s_stream)
+        s_stream->end_frame();
+}
+
 } // namespace ui
 
 } // namespace lmgl
@@ -0,0 +1,430 @@
+#include "lmgl/assets/gltf_loader.hpp"
+#include "lmgl/assets/texture_library.hpp"
+#include "lmgl/assets/upload_queue.hpp"
+#include <gtest/gtest.h>
+
+#ifndef TEST_HEADLESS
+#include "lmgl/core/engine.hpp"
+#include "lmgl/renderer/vertex_array.hpp"
+#endif
+
+#include <json.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace lmgl {
+
+namespace assets {
+
+using json = nlohmann::json;
+
+class GLTFLoaderTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+#ifndef TEST_HEADLESS
+        auto &engine = core::Engine::get_instance();
+        if (!engine.get_window())
+            engine.init(800, 600, "GLTF Loader Test");
+#endif
+        m_directory = std::filesystem::temp_directory_path() / "lmgl_gltf_test";
+        std::filesystem::create_directories(m_directory);
+    }
+
+    void TearDown() override { std::filesystem::remove_all(m_directory); }
+
+    std::string path(const std::string &name) const { return (m_directory / name).string(); }
+
+    // Appends data to the BIN chunk at a 4-byte boundary, returning its offset
+    template <typename T> static std::size_t append(std::vector<unsigned char> &bin, const std::vector<T> &data) {
+        while (bin.size() % 4)
+            bin.push_back(0);
+        std::size_t offset = bin.size();
+        bin.resize(offset + data.size() * sizeof(T));
+        std::memcpy(bin.data() + offset, data.data(), data.size() * sizeof(T));
+        return offset;
+    }
+
+    static void add_view(json &document, std::size_t offset, std::size_t length, std::size_t stride = 0) {
+        json view = {{"buffer", 0}, {"byteOffset", offset}, {"byteLength", length}};
+        if (stride)
+            view["byteStride"] = stride;
+        document["bufferViews"].push_back(view);
+    }
+
+    static void add_accessor(json &document, int view, int component_type, std::size_t count, const char *type,
+                             bool normalized = false) {
+        json accessor = {{"bufferView", view}, {"componentType", component_type}, {"count", count}, {"type", type}};
+        if (normalized)
+            accessor["normalized"] = true;
+        document["accessors"].push_back(accessor);
+    }
+
+    static void write_glb(const std::string &fpath, const json &document, std::vector<unsigned char> bin) {
+        std::string text = document.dump();
+        while (text.size() % 4)
+            text.push_back(' ');
+        while (bin.size() % 4)
+            bin.push_back(0);
+        auto u32 = [](std::ofstream &file, uint32_t value) { file.write(reinterpret_cast<const char *>(&value), 4); };
+        std::ofstream file(fpath, std::ios::binary);
+        u32(file, 0x46546C67);
+        u32(file, 2);
+        u32(file, static_cast<uint32_t>(12 + 8 + text.size() + 8 + bin.size()));
+        u32(file, static_cast<uint32_t>(text.size()));
+        u32(file, 0x4E4F534A);
+        file.write(text.data(), text.size());
+        u32(file, static_cast<uint32_t>(bin.size()));
+        u32(file, 0x004E4942);
+        file.write(reinterpret_cast<const char *>(bin.data()), bin.size());
+    }
+
+    // A triangle with float positions, normals and UVs and 16-bit indices
+    static json make_triangle(std::vector<unsigned char> &bin) {
+        json document = {{"asset", {{"version", "2.0"}}}, {"buffers", json::array()}};
+        std::vector<float> positions = {0, 0, 0, 1, 0, 0, 0, 2, 0};
+        std::vector<float> normals = {0, 0, 1, 0, 0, 1, 0, 0, 1};
+        std::vector<float> uvs = {0, 0, 1, 0, 0, 1};
+        std::vector<uint16_t> indices = {0, 1, 2};
+        add_view(document, append(bin, positions), positions.size() * 4);
+        add_view(document, append(bin, normals), normals.size() * 4);
+        add_view(document, append(bin, uvs), uvs.size() * 4);
+        add_view(document, append(bin, indices), indices.size() * 2);
+        add_accessor(document, 0, 5126, 3, "VEC3");
+        add_accessor(document, 1, 5126, 3, "VEC3");
+        add_accessor(document, 2, 5126, 3, "VEC2");
+        add_accessor(document, 3, 5123, 3, "SCALAR");
+        document["meshes"] = json::array(
+            {{{"name", "Triangle"},
+              {"primitives",
+               json::array({{{"attributes", {{"POSITION", 0}, {"NORMAL", 1}, {"TEXCOORD_0", 2}}}, {"indices", 3}}})}}});
+        document["nodes"] = json::array({{{"name", "Triangle"}, {"mesh", 0}}});
+        document["scenes"] = json::array({{{"nodes", {0}}}});
+        document["scene"] = 0;
+        document["buffers"].push_back({{"byteLength", bin.size()}});
+        return document;
+    }
+
+    std::filesystem::path m_directory;
+};
+
+TEST_F(GLTFLoaderTest, IsGlb) {
+    EXPECT_TRUE(GLTFLoader::is_glb("model.glb"));
+    EXPECT_TRUE(GLTFLoader::is_glb("dir/MODEL.GLB"));
+    EXPECT_FALSE(GLTFLoader::is_glb("model.gltf"));
+    EXPECT_FALSE(GLTFLoader::is_glb("model.obj"));
+    EXPECT_FALSE(GLTFLoader::is_glb("glb"));
+}
+
+TEST_F(GLTFLoaderTest, RejectsWhatItCannotServe) {
+    ModelLoadOptions options;
+    EXPECT_EQ(GLTFLoader::parse(path("missing.glb"), options), nullptr);
+    std::ofstream(path("garbage.glb")) << "not a glb file at all";
+    EXPECT_EQ(GLTFLoader::parse(path("garbage.glb"), options), nullptr);
+
+    std::vector<unsigned char> bin;
+    json document = make_triangle(bin);
+    write_glb(path("triangle.glb"), document, bin);
+    EXPECT_NE(GLTFLoader::parse(path("triangle.glb"), options), nullptr);
+    // Interleaved vertices and flipped UVs are left to Assimp
+    ModelLoadOptions packed;
+    packed.pack_vertices = true;
+    EXPECT_EQ(GLTFLoader::parse(path("triangle.glb"), packed), nullptr);
+    ModelLoadOptions unflipped;
+    unflipped.flip_uvs = false;
+    EXPECT_EQ(GLTFLoader::parse(path("triangle.glb"), unflipped), nullptr);
+
+    json compressed = document;
+    compressed["extensionsRequired"] = {"KHR_draco_mesh_compression"};
+    write_glb(path("compressed.glb"), compressed, bin);
+    EXPECT_EQ(GLTFLoader::parse(path("compressed.glb"), options), nullptr);
+    json quantized = document;
+    quantized["extensionsRequired"] = {"KHR_mesh_quantization"};
+    write_glb(path("quantized.glb"), quantized, bin);
+    EXPECT_NE(GLTFLoader::parse(path("quantized.glb"), options), nullptr);
+
+    json lines = document;
+    lines["meshes"][0]["primitives"][0]["mode"] = 1;
+    write_glb(path("lines.glb"), lines, bin);
+    EXPECT_EQ(GLTFLoader::parse(path("lines.glb"), options), nullptr);
+
+    // Accessors reaching past their view
+    json truncated = document;
+    truncated["accessors"][0]["count"] = 4;
+    write_glb(path("truncated.glb"), truncated, bin);
+    EXPECT_EQ(GLTFLoader::parse(path("truncated.glb"), options), nullptr);
+
+    json cycle = document;
+    cycle["nodes"][0]["children"] = {0};
+    write_glb(path("cycle.glb"), cycle, bin);
+    EXPECT_EQ(GLTFLoader::parse(path("cycle.glb"), options), nullptr);
+}
+
+TEST_F(GLTFLoaderTest, UploadSizeCountsViewsOnce) {
+    std::vector<unsigned char> bin;
+    json document = make_triangle(bin);
+    // A second primitive reading the same views
+    document["meshes"][0]["primitives"].push_back(document["meshes"][0]["primitives"][0]);
+    write_glb(path("twice.glb"), document, bin);
+    auto model = GLTFLoader::parse(path("twice.glb"), ModelLoadOptions());
+    ASSERT_NE(model, nullptr);
+    // Three vertex views, plus the indices of both primitives
+    EXPECT_EQ(GLTFLoader::get_upload_size(*model), (9 + 9 + 6) * sizeof(float) + 2 * 3 * sizeof(uint16_t));
+
+    // One step per view, then one per primitive, adding up to the whole upload
+    ASSERT_EQ(GLTFLoader::get_step_count(*model), 5u);
+    std::size_t bytes = 0;
+    for (std::size_t i = 0; i < GLTFLoader::get_step_count(*model); ++i)
+        bytes += GLTFLoader::get_upload_size(*model, i);
+    EXPECT_EQ(bytes, GLTFLoader::get_upload_size(*model));
+    EXPECT_EQ(GLTFLoader::get_upload_size(*model, 3), 3 * sizeof(uint16_t));
+}
+
+#ifndef TEST_HEADLESS
+
+static GLint get_attribute(const renderer::VertexArray &vertex_array, GLuint location, GLenum parameter) {
+    GLint value = 0;
+    vertex_array.bind();
+    glGetVertexAttribiv(location, parameter, &value);
+    vertex_array.unbind();
+    return value;
+}
+
+TEST_F(GLTFLoaderTest, UploadsAttributesInPlace) {
+    std::vector<unsigned char> bin;
+    json document = make_triangle(bin);
+    write_glb(path("triangle.glb"), document, bin);
+    auto root = GLTFLoader::load(path("triangle.glb"), nullptr, ModelLoadOptions());
+    ASSERT_NE(root, nullptr);
+    ASSERT_EQ(root->get_children().size(), 1u);
+    auto mesh = root->get_children()[0]->get_mesh();
+    ASSERT_NE(mesh, nullptr);
+    EXPECT_EQ(mesh->get_index_count(), 3u);
+    EXPECT_EQ(mesh->get_index_type(), static_cast<unsigned int>(GL_UNSIGNED_SHORT));
+    EXPECT_TRUE(mesh->get_vertices().empty());
+    EXPECT_EQ(mesh->get_indices().size(), 3u);
+    EXPECT_FLOAT_EQ(mesh->get_bounding_box().max.y, 2.0f);
+
+    auto vertex_array = mesh->get_vertex_array();
+    ASSERT_EQ(vertex_array->get_vertex_buffers().size(), 3u);
+    for (GLuint location : {0u, 1u, 3u})
+        EXPECT_EQ(get_attribute(*vertex_array, location, GL_VERTEX_ATTRIB_ARRAY_ENABLED), GL_TRUE);
+    EXPECT_EQ(get_attribute(*vertex_array, 2, GL_VERTEX_ATTRIB_ARRAY_ENABLED), GL_FALSE);
+    // The position buffer holds the view as stored in the file
+    float positions[9] = {};
+    vertex_array->get_vertex_buffers()[0]->bind();
+    glGetBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(positions), positions);
+    EXPECT_EQ(std::memcmp(positions, bin.data(), sizeof(positions)), 0);
+}
+
+TEST_F(GLTFLoaderTest, ReadsQuantizedAttributes) {
+    std::vector<unsigned char> bin;
+    json document = {{"asset", {{"version", "2.0"}}}, {"extensionsRequired", {"KHR_mesh_quantization"}}};
+    // Shorts padded to 8 bytes, bytes padded to 4 bytes, as the extension requires
+    std::vector<int16_t> positions = {0, 0, 0, 0, 100, 0, 0, 0, 0, 200, -50, 0};
+    std::vector<int8_t> normals = {0, 0, 127, 0, 0, 0, 127, 0, 0, 0, 127, 0};
+    std::vector<uint16_t> uvs = {0, 0, 65535, 0, 0, 65535};
+    std::vector<uint8_t> indices = {0, 1, 2};
+    add_view(document, append(bin, positions), positions.size() * 2, 8);
+    add_view(document, append(bin, normals), normals.size(), 4);
+    add_view(document, append(bin, uvs), uvs.size() * 2);
+    add_view(document, append(bin, indices), indices.size());
+    add_accessor(document, 0, 5122, 3, "VEC3");
+    add_accessor(document, 1, 5120, 3, "VEC3", true);
+    add_accessor(document, 2, 5123, 3, "VEC2", true);
+    add_accessor(document, 3, 5121, 3, "SCALAR");
+    document["meshes"] = json::array(
+        {{{"primitives",
+           json::array({{{"attributes", {{"POSITION", 0}, {"NORMAL", 1}, {"TEXCOORD_0", 2}}}, {"indices", 3}}})}}});
+    // Dequantization goes in the node transform
+    document["nodes"] = json::array({{{"mesh", 0}, {"scale", {0.01, 0.01, 0.01}}}});
+    document["buffers"] = json::array({{{"byteLength", bin.size()}}});
+    write_glb(path("quantized.glb"), document, bin);
+
+    auto root = GLTFLoader::load(path("quantized.glb"), nullptr, ModelLoadOptions());
+    ASSERT_NE(root, nullptr);
+    ASSERT_EQ(root->get_children().size(), 1u);
+    auto node = root->get_children()[0];
+    EXPECT_FLOAT_EQ(node->get_scale().x, 0.01f);
+    auto mesh = node->get_mesh();
+    ASSERT_NE(mesh, nullptr);
+    EXPECT_FLOAT_EQ(mesh->get_bounding_box().max.x, 100.0f);
+    EXPECT_FLOAT_EQ(mesh->get_bounding_box().max.y, 200.0f);
+    EXPECT_FLOAT_EQ(mesh->get_bounding_box().min.z, -50.0f);
+    // 8-bit indices are widened, the attributes are read as stored
+    EXPECT_EQ(mesh->get_index_type(), static_cast<unsigned int>(GL_UNSIGNED_INT));
+    auto vertex_array = mesh->get_vertex_array();
+    EXPECT_EQ(get_attribute(*vertex_array, 0, GL_VERTEX_ATTRIB_ARRAY_TYPE), GL_SHORT);
+    EXPECT_EQ(get_attribute(*vertex_array, 0, GL_VERTEX_ATTRIB_ARRAY_NORMALIZED), GL_FALSE);
+    EXPECT_EQ(get_attribute(*vertex_array, 1, GL_VERTEX_ATTRIB_ARRAY_TYPE), GL_BYTE);
+    EXPECT_EQ(get_attribute(*vertex_array, 1, GL_VERTEX_ATTRIB_ARRAY_NORMALIZED), GL_TRUE);
+    EXPECT_EQ(get_attribute(*vertex_array, 3, GL_VERTEX_ATTRIB_ARRAY_TYPE), GL_UNSIGNED_SHORT);
+    EXPECT_EQ(get_attribute(*vertex_array, 3, GL_VERTEX_ATTRIB_ARRAY_STRIDE), 4);
+}
+
+TEST_F(GLTFLoaderTest, GeneratesNormalsAndTangents) {
+    std::vector<unsigned char> bin;
+    json document = make_triangle(bin);
+    // An embedded 2x1 image as the normal map
+    const std::string ppm = std::string("P6 2 1 255\n") + std::string("\x80\x80\xff\x80\x80\xff", 6);
+    std::size_t image = append(bin, std::vector<char>(ppm.begin(), ppm.end()));
+    add_view(document, image, ppm.size());
+    document["images"] = json::array({{{"bufferView", 4}, {"mimeType", "image/x-portable-pixmap"}}});
+    document["textures"] = json::array({{{"source", 0}}});
+    document["materials"] = json::array({{{"name", "Bumpy"}, {"normalTexture", {{"index", 0}}}}});
+    auto &primitive = document["meshes"][0]["primitives"][0];
+    primitive["material"] = 0;
+    primitive["attributes"].erase("NORMAL");
+    document["buffers"][0]["byteLength"] = bin.size();
+    write_glb(path("bumpy.glb"), document, bin);
+
+    auto root = GLTFLoader::load(path("bumpy.glb"), nullptr, ModelLoadOptions());
+    ASSERT_NE(root, nullptr);
+    auto mesh = root->get_children()[0]->get_mesh();
+    ASSERT_NE(mesh, nullptr);
+    ASSERT_NE(mesh->get_material(), nullptr);
+    EXPECT_EQ(mesh->get_material()->get_name(), "Bumpy");
+    auto normal_map = mesh->get_material()->get_normal_map();
+    ASSERT_NE(normal_map, nullptr);
+    EXPECT_EQ(normal_map->get_width(), 2);
+    EXPECT_EQ(TextureLibrary::get_instance().get(path("bumpy.glb") + "#image0"), normal_map);
+
+    auto vertex_array = mesh->get_vertex_array();
+    for (GLuint location : {1u, 4u, 5u})
+        EXPECT_EQ(get_attribute(*vertex_array, location, GL_VERTEX_ATTRIB_ARRAY_ENABLED), GL_TRUE);
+    // Counter-clockwise in the XY plane faces +Z, U runs along +X
+    float normal[3] = {};
+    float tangent[4] = {};
+    for (const auto &buffer : vertex_array->get_vertex_buffers()) {
+        buffer->bind();
+        GLint size = 0;
+        glGetBufferParameteriv(GL_ARRAY_BUFFER, GL_BUFFER_SIZE, &size);
+        if (size == 3 * 3 * static_cast<GLint>(sizeof(float)) && buffer != vertex_array->get_vertex_buffers()[0] &&
+            normal[2] == 0.0f)
+            glGetBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(normal), normal);
+        if (size == 3 * 4 * static_cast<GLint>(sizeof(float)))
+            glGetBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(tangent), tangent);
+    }
+    EXPECT_NEAR(normal[2], 1.0f, 1e-5f);
+    EXPECT_NEAR(tangent[0], 1.0f, 1e-5f);
+    EXPECT_FLOAT_EQ(tangent[3], 1.0f);
+    TextureLibrary::get_instance().clear();
+}
+
+TEST_F(GLTFLoaderTest, SharesMeshesAcrossNodes) {
+    std::vector<unsigned char> bin;
+    json document = make_triangle(bin);
+    document["nodes"] = json::array({{{"name", "Parent"},
+                                      {"mesh", 0},
+                                      {"translation", {1, 2, 3}},
+                                      {"rotation", {0, 0, 0, 1}},
+                                      {"children", {1}}},
+                                     {{"name", "Child"}, {"mesh", 0}, {"matrix", {2, 0, 0, 0, 0, 2, 0, 0, 0, 0, 2, 0,
+                                                                                  4, 5, 6, 1}}}});
+    document["scenes"][0]["nodes"] = {0};
+    write_glb(path("shared.glb"), document, bin);
+
+    ModelLoadOptions options;
+    options.residency = scene::GeometryResidency::Release;
+    options.depth_stream = true;
+    auto root = GLTFLoader::load(path("shared.glb"), nullptr, options);
+    ASSERT_NE(root, nullptr);
+    EXPECT_EQ(root->get_name(), "shared.glb");
+    auto parent = root->get_children()[0];
+    ASSERT_EQ(parent->get_children().size(), 1u);
+    auto child = parent->get_children()[0];
+    EXPECT_EQ(parent->get_name(), "Parent");
+    EXPECT_FLOAT_EQ(parent->get_position().z, 3.0f);
+    EXPECT_FLOAT_EQ(child->get_position().x, 4.0f);
+    EXPECT_FLOAT_EQ(child->get_scale().y, 2.0f);
+    EXPECT_EQ(parent->get_mesh(), child->get_mesh());
+    // Released geometry keeps picking and the depth stream
+    auto mesh = parent->get_mesh();
+    EXPECT_TRUE(mesh->get_indices().empty());
+    EXPECT_FALSE(mesh->get_bvh().empty());
+    EXPECT_TRUE(mesh->has_depth_stream());
+}
+
+TEST_F(GLTFLoaderTest, MissingRotationIsIdentity) {
+    std::vector<unsigned char> bin;
+    json document = make_triangle(bin);
+    document["nodes"] = json::array({{{"name", "Moved"}, {"mesh", 0}, {"translation", {1, 2, 3}}}});
+    document["scenes"][0]["nodes"] = {0};
+    write_glb(path("translated.glb"), document, bin);
+
+    auto root = GLTFLoader::load(path("translated.glb"), nullptr, ModelLoadOptions());
+    ASSERT_NE(root, nullptr);
+    ASSERT_EQ(root->get_children().size(), 1u);
+    auto node = root->get_children()[0];
+    EXPECT_FLOAT_EQ(node->get_position().y, 2.0f);
+    const glm::quat &rotation = node->get_rotation();
+    EXPECT_FLOAT_EQ(rotation.w, 1.0f);
+    EXPECT_FLOAT_EQ(rotation.x, 0.0f);
+    EXPECT_FLOAT_EQ(rotation.y, 0.0f);
+    EXPECT_FLOAT_EQ(rotation.z, 0.0f);
+    EXPECT_EQ(node->get_scale(), glm::vec3(1.0f));
+}
+
+TEST_F(GLTFLoaderTest, ModelLoaderTakesFastPath) {
+    std::vector<unsigned char> bin;
+    json document = make_triangle(bin);
+    write_glb(path("triangle.glb"), document, bin);
+    ModelLoadOptions options;
+    options.cache_directory = path("cache");
+    auto node = ModelLoader::load(path("triangle.glb"), nullptr, options);
+    ASSERT_NE(node, nullptr);
+    EXPECT_EQ(node->get_children()[0]->get_mesh()->get_index_type(), static_cast<unsigned int>(GL_UNSIGNED_SHORT));
+    // No cache file, reading the GLB is as fast
+    EXPECT_FALSE(std::filesystem::exists(path("cache")));
+
+    auto handle = ModelLoader::load_async(path("triangle.glb"), nullptr, options);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!handle->is_done() && std::chrono::steady_clock::now() < deadline) {
+        UploadQueue::get_instance().process();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_EQ(handle->get_state(), ModelLoadHandle::State::Ready);
+    ASSERT_NE(handle->get_node(), nullptr);
+    EXPECT_NE(handle->get_node()->get_children()[0]->get_mesh(), nullptr);
+}
+
+TEST_F(GLTFLoaderTest, ModelLoaderUploadsUnderBudget) {
+    std::vector<unsigned char> bin;
+    json document = make_triangle(bin);
+    document["meshes"][0]["primitives"].push_back(document["meshes"][0]["primitives"][0]);
+    write_glb(path("twice.glb"), document, bin);
+
+    // A byte budget smaller than any step leaves a single upload per frame
+    auto &queue = UploadQueue::get_instance();
+    double time_budget = queue.get_time_budget();
+    std::size_t byte_budget = queue.get_byte_budget();
+    queue.set_budget(1000.0, 1);
+    auto handle = ModelLoader::load_async(path("twice.glb"), nullptr, ModelLoadOptions());
+    std::size_t frames = 0;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!handle->is_done() && std::chrono::steady_clock::now() < deadline) {
+        std::size_t count = queue.process();
+        EXPECT_LE(count, 1u);
+        frames += count;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    queue.set_budget(time_budget, byte_budget);
+    ASSERT_EQ(handle->get_state(), ModelLoadHandle::State::Ready);
+    // Three views, two primitives and the scene graph
+    EXPECT_EQ(frames, 6u);
+    EXPECT_EQ(handle->get_node()->get_mesh(), nullptr);
+    ASSERT_EQ(handle->get_node()->get_children().size(), 1u);
+    EXPECT_EQ(handle->get_node()->get_children()[0]->get_children().size(), 2u);
+}
+
+#endif
+
+} // namespace assets
+
+} // namespace lmgl
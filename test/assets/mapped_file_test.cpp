@@ -0,0 +1,66 @@
+#include "lmgl/assets/mapped_file.hpp"
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace lmgl {
+
+namespace assets {
+
+class MappedFileTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        // Mapped file tests are CPU-only, no OpenGL needed
+        directory = std::filesystem::temp_directory_path() / "lmgl_mapped_file_test";
+        std::filesystem::create_directories(directory);
+    }
+
+    void TearDown() override { std::filesystem::remove_all(directory); }
+
+    std::string write_file(const std::string &name, const std::string &contents) {
+        std::string path = (directory / name).string();
+        std::ofstream file(path, std::ios::binary);
+        file << contents;
+        return path;
+    }
+
+    std::filesystem::path directory;
+};
+
+TEST_F(MappedFileTest, MapsFileContents) {
+    std::string path = write_file("data.bin", "mapped contents");
+    MappedFile file(path);
+    ASSERT_TRUE(file.is_open());
+    ASSERT_EQ(file.size(), 15u);
+    EXPECT_EQ(std::memcmp(file.data(), "mapped contents", 15), 0);
+    file.close();
+    EXPECT_FALSE(file.is_open());
+    EXPECT_EQ(file.data(), nullptr);
+    EXPECT_EQ(file.size(), 0u);
+}
+
+TEST_F(MappedFileTest, MissingFileFails) {
+    MappedFile file;
+    EXPECT_FALSE(file.open((directory / "missing.bin").string()));
+    EXPECT_FALSE(file.is_open());
+}
+
+TEST_F(MappedFileTest, EmptyFileHasNoData) {
+    MappedFile file;
+    ASSERT_TRUE(file.open(write_file("empty.bin", "")));
+    EXPECT_EQ(file.size(), 0u);
+    EXPECT_EQ(file.data(), nullptr);
+}
+
+TEST_F(MappedFileTest, ReopenReplacesMapping) {
+    MappedFile file(write_file("first.bin", "first"));
+    ASSERT_TRUE(file.open(write_file("second.bin", "second!")));
+    ASSERT_EQ(file.size(), 7u);
+    EXPECT_EQ(std::memcmp(file.data(), "second!", 7), 0);
+}
+
+} // namespace assets
+
+} // namespace lmgl
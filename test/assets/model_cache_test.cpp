@@ -0,0 +1,154 @@
+#include "lmgl/assets/model_cache.hpp"
+#include "lmgl/assets/model_loader.hpp"
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+
+namespace lmgl {
+
+namespace assets {
+
+class ModelCacheTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        // Model cache tests are CPU-only, no OpenGL needed
+        directory = std::filesystem::temp_directory_path() / "lmgl_model_cache_test";
+        std::filesystem::remove_all(directory);
+        std::filesystem::create_directories(directory);
+        cache_path = (directory / "model.lmodel").string();
+
+        MeshData mesh;
+        mesh.name = "triangle";
+        mesh.vertices = {scene::Vertex(glm::vec3(0.0f)), scene::Vertex(glm::vec3(1.0f, 0.0f, 0.0f)),
+                         scene::Vertex(glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f))};
+        mesh.indices = {0, 1, 2};
+        mesh.has_material = true;
+        mesh.material.name = "red";
+        mesh.material.albedo = glm::vec3(1.0f, 0.0f, 0.0f);
+        mesh.material.roughness = 0.25f;
+        mesh.material_index = 7;
+        mesh.material.normal_map = "textures/normal.png";
+        model.meshes.push_back(mesh);
+        mesh.name = "plain";
+        mesh.has_material = false;
+        model.meshes.push_back(mesh);
+        model.root.name = "root";
+        model.root.meshes = {0};
+        NodeData child;
+        child.name = "child";
+        child.meshes = {0, 1};
+        model.root.children.push_back(child);
+        key = {123, 456, 789};
+    }
+
+    void TearDown() override { std::filesystem::remove_all(directory); }
+
+    std::filesystem::path directory;
+    std::string cache_path;
+    ModelData model;
+    ModelCacheKey key;
+};
+
+TEST_F(ModelCacheTest, RoundTrip) {
+    ASSERT_TRUE(ModelCache::write(cache_path, key, model));
+    EXPECT_FALSE(std::filesystem::exists(cache_path + ".tmp"));
+    ModelData loaded;
+    ASSERT_TRUE(ModelCache::read(cache_path, key, loaded));
+    ASSERT_EQ(loaded.meshes.size(), 2u);
+    const MeshData &mesh = loaded.meshes[0];
+    EXPECT_EQ(mesh.name, "triangle");
+    // The geometry is read in place from the mapping, aligned in the file
+    ASSERT_NE(loaded.mapping, nullptr);
+    EXPECT_TRUE(mesh.vertices.empty());
+    ASSERT_EQ(mesh.get_vertex_count(), 3u);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(mesh.get_vertices()) % 16, 0u);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(mesh.get_indices()) % 16, 0u);
+    EXPECT_EQ(mesh.get_vertices()[1].position, glm::vec3(1.0f, 0.0f, 0.0f));
+    EXPECT_EQ(mesh.get_vertices()[2].normal, glm::vec3(0.0f, 0.0f, 1.0f));
+    EXPECT_EQ(std::vector<unsigned int>(mesh.get_indices(), mesh.get_indices() + mesh.get_index_count()),
+              (std::vector<unsigned int>{0, 1, 2}));
+    EXPECT_EQ(loaded.meshes[1].get_index_count(), 3u);
+    ASSERT_TRUE(mesh.has_material);
+    EXPECT_EQ(mesh.material.name, "red");
+    EXPECT_EQ(mesh.material.albedo, glm::vec3(1.0f, 0.0f, 0.0f));
+    EXPECT_FLOAT_EQ(mesh.material.roughness, 0.25f);
+    EXPECT_EQ(mesh.material_index, 7u);
+    EXPECT_EQ(mesh.material.normal_map, "textures/normal.png");
+    EXPECT_TRUE(mesh.material.albedo_map.empty());
+    EXPECT_FALSE(loaded.meshes[1].has_material);
+    EXPECT_EQ(loaded.root.name, "root");
+    EXPECT_EQ(loaded.root.meshes, (std::vector<unsigned int>{0}));
+    ASSERT_EQ(loaded.root.children.size(), 1u);
+    EXPECT_EQ(loaded.root.children[0].name, "child");
+    EXPECT_EQ(loaded.root.children[0].meshes, (std::vector<unsigned int>{0, 1}));
+}
+
+TEST_F(ModelCacheTest, RejectsMismatchedKey) {
+    ASSERT_TRUE(ModelCache::write(cache_path, key, model));
+    ModelData loaded;
+    ModelCacheKey newer = key;
+    newer.source_time++;
+    EXPECT_FALSE(ModelCache::read(cache_path, newer, loaded));
+    ModelCacheKey other_options = key;
+    other_options.options_hash++;
+    EXPECT_FALSE(ModelCache::read(cache_path, other_options, loaded));
+    EXPECT_FALSE(ModelCache::read((directory / "missing.lmodel").string(), key, loaded));
+    EXPECT_TRUE(loaded.meshes.empty());
+}
+
+TEST_F(ModelCacheTest, RejectsCorruptedFiles) {
+    ASSERT_TRUE(ModelCache::write(cache_path, key, model));
+    auto size = std::filesystem::file_size(cache_path);
+    {
+        // Flip a byte in the payload
+        std::fstream file(cache_path, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(static_cast<std::streamoff>(size - 10));
+        file.put('\x7f');
+    }
+    ModelData loaded;
+    EXPECT_FALSE(ModelCache::read(cache_path, key, loaded));
+
+    ASSERT_TRUE(ModelCache::write(cache_path, key, model));
+    std::filesystem::resize_file(cache_path, size - 1);
+    EXPECT_FALSE(ModelCache::read(cache_path, key, loaded));
+    std::filesystem::resize_file(cache_path, 8);
+    EXPECT_FALSE(ModelCache::read(cache_path, key, loaded));
+}
+
+TEST_F(ModelCacheTest, CachePathDependsOnSource) {
+    std::string a = ModelCache::get_cache_path("assets/a.obj", "cache");
+    EXPECT_EQ(a, ModelCache::get_cache_path("assets/a.obj", "cache"));
+    EXPECT_NE(a, ModelCache::get_cache_path("other/a.obj", "cache"));
+    EXPECT_EQ(std::filesystem::path(a).parent_path(), std::filesystem::path("cache"));
+}
+
+TEST_F(ModelCacheTest, MakeKeyReadsSourceFile) {
+    std::string source = (directory / "source.obj").string();
+    ModelCacheKey source_key;
+    EXPECT_FALSE(ModelCache::make_key(source, 1, source_key));
+    {
+        std::ofstream file(source);
+        file << "v 0 0 0\n";
+    }
+    ASSERT_TRUE(ModelCache::make_key(source, 1, source_key));
+    EXPECT_EQ(source_key.source_size, 8u);
+    EXPECT_EQ(source_key.options_hash, 1u);
+}
+
+TEST_F(ModelCacheTest, OptionsHashIgnoresPostImportOptions) {
+    ModelLoadOptions options;
+    uint64_t hash = ModelLoader::get_options_hash(options);
+    ModelLoadOptions scaled = options;
+    scaled.scale = 2.0f;
+    scaled.pack_vertices = true;
+    EXPECT_EQ(ModelLoader::get_options_hash(scaled), hash);
+    ModelLoadOptions flipped = options;
+    flipped.flip_uvs = !options.flip_uvs;
+    EXPECT_NE(ModelLoader::get_options_hash(flipped), hash);
+}
+
+} // namespace assets
+
+} // namespace lmgl
@@ -1,6 +1,15 @@
 #include "lmgl/assets/model_loader.hpp"
+#include "lmgl/assets/texture_library.hpp"
+#include "lmgl/assets/upload_queue.hpp"
 #include <gtest/gtest.h>
 
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <thread>
+
 using namespace lmgl::assets;
 
 class ModelLoaderTest : public ::testing::Test {
@@ -17,6 +26,11 @@ TEST_F(ModelLoaderTest, ModelLoadOptionsDefaults) {
     EXPECT_TRUE(options.optimize_meshes);
     EXPECT_TRUE(options.triangulate);
     EXPECT_FLOAT_EQ(options.scale, 1.0f);
+    EXPECT_FALSE(options.pack_vertices);
+    EXPECT_FALSE(options.depth_stream);
+    EXPECT_EQ(options.residency, lmgl::scene::GeometryResidency::Keep);
+    // Large OBJ and PLY files keep loading through Assimp unless ScanLoader is asked for
+    EXPECT_EQ(options.scan_threshold, std::numeric_limits<std::size_t>::max());
 }
 
 TEST_F(ModelLoaderTest, ModelLoadOptionsCustom) {
@@ -49,9 +63,32 @@ TEST_F(ModelLoaderTest, ModelLoadOptionsAllFlags) {
     EXPECT_FLOAT_EQ(options.scale, 0.1f);
 }
 
+// Pumps the upload queue like the render loop does, until the load is over
+static bool wait_for_load(const ModelLoadHandle &handle) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!handle.is_done() && std::chrono::steady_clock::now() < deadline) {
+        UploadQueue::get_instance().process();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return handle.is_done();
+}
+
+TEST_F(ModelLoaderTest, LoadAsyncNonExistentModelFails) {
+    ModelLoadOptions options;
+    options.use_cache = false;
+    auto handle = ModelLoader::load_async("nonexistent_model.obj", nullptr, options);
+    ASSERT_NE(handle, nullptr);
+    EXPECT_EQ(handle->get_path(), "nonexistent_model.obj");
+    ASSERT_TRUE(wait_for_load(*handle));
+    EXPECT_EQ(handle->get_state(), ModelLoadHandle::State::Failed);
+    EXPECT_EQ(handle->get_node(), nullptr);
+    EXPECT_FLOAT_EQ(handle->get_progress(), 1.0f);
+}
+
 #ifndef TEST_HEADLESS
 #include "lmgl/renderer/shader.hpp"
 #include "lmgl/core/engine.hpp"
+#include "lmgl/core/thread_pool.hpp"
 
 TEST_F(ModelLoaderTest, LoadNonExistentModel) {
     auto& engine = lmgl::core::Engine::get_instance();
@@ -74,6 +111,231 @@ TEST_F(ModelLoaderTest, LoadNonExistentModel) {
     EXPECT_EQ(node, nullptr);
 }
 
+TEST_F(ModelLoaderTest, LoadAsyncFromCache) {
+    auto &engine = lmgl::core::Engine::get_instance();
+    if (!engine.get_window()) {
+        engine.init(800, 600, "Test");
+    }
+    // A cached model needs no importer, so the whole asynchronous path runs without Assimp
+    const std::string fpath = "model_loader_test_async.obj";
+    const std::string cache_directory = "model_loader_test_cache";
+    std::ofstream(fpath) << "o triangle\n";
+    ModelLoadOptions options;
+    options.cache_directory = cache_directory;
+    options.scale = 2.0f;
+    ModelData model;
+    for (int i = 0; i < 2; ++i) {
+        MeshData mesh;
+        mesh.name = "triangle" + std::to_string(i);
+        mesh.vertices.resize(3);
+        mesh.vertices[1].position = glm::vec3(1.0f, 0.0f, 0.0f);
+        mesh.vertices[2].position = glm::vec3(0.0f, 1.0f, 0.0f);
+        mesh.indices = {0, 1, 2};
+        mesh.has_material = i == 0;
+        mesh.material.name = "red";
+        mesh.material.albedo = glm::vec3(1.0f, 0.0f, 0.0f);
+        model.meshes.push_back(mesh);
+    }
+    model.root.name = "root";
+    model.root.meshes = {0, 1};
+    ModelCacheKey key;
+    ASSERT_TRUE(ModelCache::make_key(fpath, ModelLoader::get_options_hash(options), key));
+    ASSERT_TRUE(ModelCache::write(ModelCache::get_cache_path(fpath, cache_directory), key, model));
+
+    auto handle = ModelLoader::load_async(fpath, nullptr, options);
+    EXPECT_EQ(handle->get_node(), nullptr);
+    ASSERT_TRUE(wait_for_load(*handle));
+    ASSERT_EQ(handle->get_state(), ModelLoadHandle::State::Ready);
+    auto node = handle->get_node();
+    ASSERT_NE(node, nullptr);
+    EXPECT_EQ(node->get_name(), "root");
+    EXPECT_EQ(node->get_scale(), glm::vec3(2.0f));
+    ASSERT_EQ(node->get_children().size(), 2u);
+    auto mesh = node->get_children()[0]->get_mesh();
+    ASSERT_NE(mesh, nullptr);
+    EXPECT_EQ(mesh->get_index_count(), 3u);
+    ASSERT_NE(mesh->get_material(), nullptr);
+    EXPECT_EQ(mesh->get_material()->get_name(), "red");
+    EXPECT_EQ(node->get_children()[1]->get_mesh()->get_material(), nullptr);
+    EXPECT_FLOAT_EQ(handle->get_progress(), 1.0f);
+
+    std::remove(fpath.c_str());
+    std::filesystem::remove_all(cache_directory);
+}
+
+TEST_F(ModelLoaderTest, LoadAsyncHoldsTexturesUntilBuilt) {
+    auto &engine = lmgl::core::Engine::get_instance();
+    if (!engine.get_window()) {
+        engine.init(800, 600, "Test");
+    }
+    const std::string fpath = "model_loader_test_textured.obj";
+    const std::string cache_directory = "model_loader_test_textured_cache";
+    const std::string albedo_path = "model_loader_test_albedo.ppm";
+    const std::string normal_path = "model_loader_test_normal.ppm";
+    std::ofstream(fpath) << "o triangle\n";
+    std::ofstream(albedo_path, std::ios::binary) << "P6\n3 2\n255\n" << std::string(3 * 2 * 3, '\x7f');
+    std::ofstream(normal_path, std::ios::binary) << "P6\n5 2\n255\n" << std::string(5 * 2 * 3, '\x7f');
+    ModelLoadOptions options;
+    options.cache_directory = cache_directory;
+    ModelData model;
+    MeshData data;
+    data.name = "triangle";
+    data.vertices.resize(3);
+    data.indices = {0, 1, 2};
+    data.has_material = true;
+    data.material.albedo_map = albedo_path;
+    data.material.normal_map = normal_path;
+    model.meshes.push_back(data);
+    model.root.meshes = {0};
+    ModelCacheKey key;
+    ASSERT_TRUE(ModelCache::make_key(fpath, ModelLoader::get_options_hash(options), key));
+    ASSERT_TRUE(ModelCache::write(ModelCache::get_cache_path(fpath, cache_directory), key, model));
+
+    // Over budget each insertion evicts the textures nobody holds, the load must not decode them again
+    auto &tex_lib = TextureLibrary::get_instance();
+    const size_t budget = tex_lib.get_budget();
+    tex_lib.clear();
+    tex_lib.set_budget(1);
+    tex_lib.reset_stats();
+    auto handle = ModelLoader::load_async(fpath, nullptr, options);
+    ASSERT_TRUE(wait_for_load(*handle));
+    ASSERT_EQ(handle->get_state(), ModelLoadHandle::State::Ready);
+    auto mesh = handle->get_node()->get_mesh();
+    ASSERT_NE(mesh, nullptr);
+    ASSERT_NE(mesh->get_material(), nullptr);
+    auto albedo = mesh->get_material()->get_albedo_map();
+    ASSERT_NE(albedo, nullptr);
+    EXPECT_EQ(albedo->get_width(), 3);
+    ASSERT_NE(mesh->get_material()->get_normal_map(), nullptr);
+    EXPECT_EQ(mesh->get_material()->get_normal_map()->get_width(), 5);
+    EXPECT_EQ(tex_lib.get_stats().misses, 0u);
+    tex_lib.set_budget(budget);
+    tex_lib.clear();
+
+    std::remove(fpath.c_str());
+    std::remove(albedo_path.c_str());
+    std::remove(normal_path.c_str());
+    std::filesystem::remove_all(cache_directory);
+}
+
+TEST_F(ModelLoaderTest, ReleasedMeshesUploadFromCacheMapping) {
+    auto &engine = lmgl::core::Engine::get_instance();
+    if (!engine.get_window()) {
+        engine.init(800, 600, "Test");
+    }
+    const std::string fpath = "model_loader_test_release.obj";
+    const std::string cache_directory = "model_loader_test_release_cache";
+    std::ofstream(fpath) << "o triangle\n";
+    ModelLoadOptions options;
+    options.cache_directory = cache_directory;
+    options.residency = lmgl::scene::GeometryResidency::Release;
+    ModelData model;
+    MeshData data;
+    data.name = "triangle";
+    data.vertices.resize(3);
+    data.vertices[1].position = glm::vec3(1.0f, 0.0f, 0.0f);
+    data.vertices[2].position = glm::vec3(0.0f, 1.0f, 0.0f);
+    data.indices = {0, 1, 2};
+    model.meshes.push_back(data);
+    model.root.name = "root";
+    model.root.meshes = {0};
+    ModelCacheKey key;
+    ASSERT_TRUE(ModelCache::make_key(fpath, ModelLoader::get_options_hash(options), key));
+    ASSERT_TRUE(ModelCache::write(ModelCache::get_cache_path(fpath, cache_directory), key, model));
+
+    auto node = ModelLoader::load(fpath, nullptr, options);
+    ASSERT_NE(node, nullptr);
+    auto mesh = node->get_mesh();
+    ASSERT_NE(mesh, nullptr);
+    EXPECT_EQ(mesh->get_residency(), lmgl::scene::GeometryResidency::Release);
+    EXPECT_TRUE(mesh->get_vertices().empty());
+    EXPECT_EQ(mesh->get_index_count(), 3u);
+    EXPECT_EQ(mesh->get_bounding_box().max, glm::vec3(1.0f, 1.0f, 0.0f));
+    EXPECT_FALSE(mesh->get_bvh().empty());
+
+    std::remove(fpath.c_str());
+    std::filesystem::remove_all(cache_directory);
+}
+
+TEST_F(ModelLoaderTest, InstantiateSharesMeshesAndMaterials) {
+    auto &engine = lmgl::core::Engine::get_instance();
+    if (!engine.get_window()) {
+        engine.init(800, 600, "Test");
+    }
+    const std::string fpath = "model_loader_test_prefab.obj";
+    const std::string cache_directory = "model_loader_test_prefab_cache";
+    std::ofstream(fpath) << "o triangles\n";
+    ModelLoadOptions options;
+    options.cache_directory = cache_directory;
+    ModelData model;
+    // The first two meshes use the same material of the source file
+    for (uint32_t i = 0; i < 3; ++i) {
+        MeshData mesh;
+        mesh.name = "triangle" + std::to_string(i);
+        mesh.vertices.resize(3);
+        mesh.vertices[1].position = glm::vec3(1.0f, 0.0f, 0.0f);
+        mesh.vertices[2].position = glm::vec3(0.0f, 1.0f, 0.0f);
+        mesh.indices = {0, 1, 2};
+        mesh.has_material = true;
+        mesh.material_index = i / 2;
+        mesh.material.name = i < 2 ? "red" : "blue";
+        model.meshes.push_back(mesh);
+    }
+    model.root.name = "root";
+    model.root.meshes = {0, 1, 2};
+    ModelCacheKey key;
+    ASSERT_TRUE(ModelCache::make_key(fpath, ModelLoader::get_options_hash(options), key));
+    ASSERT_TRUE(ModelCache::write(ModelCache::get_cache_path(fpath, cache_directory), key, model));
+
+    ModelLoader::clear_prefabs();
+    const lmgl::core::CacheStats before = ModelLoader::get_prefab_stats();
+    auto first = ModelLoader::instantiate(fpath, nullptr, options);
+    ASSERT_NE(first, nullptr);
+    ASSERT_EQ(first->get_children().size(), 3u);
+    auto material = first->get_children()[0]->get_mesh()->get_material();
+    ASSERT_NE(material, nullptr);
+    EXPECT_EQ(first->get_children()[1]->get_mesh()->get_material(), material);
+    EXPECT_NE(first->get_children()[2]->get_mesh()->get_material(), material);
+
+    // A second placement is a clone: new nodes, same meshes, no import
+    std::filesystem::remove_all(cache_directory);
+    auto second = ModelLoader::instantiate(fpath, nullptr, options);
+    ASSERT_NE(second, nullptr);
+    EXPECT_NE(second, first);
+    ASSERT_EQ(second->get_children().size(), 3u);
+    for (size_t i = 0; i < 3; ++i) {
+        EXPECT_NE(second->get_children()[i], first->get_children()[i]);
+        EXPECT_EQ(second->get_children()[i]->get_mesh(), first->get_children()[i]->get_mesh());
+    }
+    second->set_position(glm::vec3(5.0f, 0.0f, 0.0f));
+    EXPECT_EQ(first->get_position(), glm::vec3(0.0f));
+    EXPECT_EQ(ModelLoader::get_prefab_stats().misses - before.misses, 1u);
+    EXPECT_EQ(ModelLoader::get_prefab_stats().hits - before.hits, 1u);
+    ModelLoader::clear_prefabs();
+    std::remove(fpath.c_str());
+}
+
+TEST_F(ModelLoaderTest, EngineFreeDropsLoadsInFlight) {
+    auto &engine = lmgl::core::Engine::get_instance();
+    if (!engine.get_window()) {
+        engine.init(800, 600, "Test");
+    }
+    const std::string fpath = "model_loader_test_free.obj";
+    std::ofstream(fpath) << "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\n";
+    ModelLoadOptions options;
+    options.use_cache = false;
+    auto handle = ModelLoader::load_async(fpath, nullptr, options);
+    engine.free();
+    // Nothing is left to run, and the workers are done pushing
+    EXPECT_EQ(lmgl::core::ThreadPool::get_instance().get_pending(), 0u);
+    EXPECT_EQ(UploadQueue::get_instance().get_pending(), 0u);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(UploadQueue::get_instance().get_pending(), 0u);
+    EXPECT_EQ(handle->get_node(), nullptr);
+    std::remove(fpath.c_str());
+    engine.init(800, 600, "Test");
+}
+
 TEST_F(ModelLoaderTest, LoadWithNullShader) {
     ModelLoadOptions options;
     auto node = ModelLoader::load("model.obj", nullptr, options);
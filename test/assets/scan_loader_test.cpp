@@ -0,0 +1,367 @@
+#include "lmgl/assets/scan_loader.hpp"
+#include "lmgl/assets/upload_queue.hpp"
+#include <gtest/gtest.h>
+
+#ifndef TEST_HEADLESS
+#include "lmgl/core/engine.hpp"
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace lmgl {
+
+namespace assets {
+
+class ScanLoaderTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+#ifndef TEST_HEADLESS
+        auto &engine = core::Engine::get_instance();
+        if (!engine.get_window())
+            engine.init(800, 600, "Scan Loader Test");
+#endif
+        m_directory = std::filesystem::temp_directory_path() / "lmgl_scan_test";
+        std::filesystem::create_directories(m_directory);
+    }
+
+    void TearDown() override { std::filesystem::remove_all(m_directory); }
+
+    std::string write(const std::string &name, const std::string &contents) const {
+        std::string fpath = (m_directory / name).string();
+        std::ofstream(fpath, std::ios::binary) << contents;
+        return fpath;
+    }
+
+    // A size x size grid of quads in the XZ plane, large enough to be parsed in several chunks
+    static std::string make_grid(int size) {
+        std::ostringstream obj;
+        for (int z = 0; z <= size; ++z)
+            for (int x = 0; x <= size; ++x)
+                obj << "v " << x * 0.25 << " 0.0 " << z * 0.25 << "\n";
+        for (int z = 0; z < size; ++z) {
+            for (int x = 0; x < size; ++x) {
+                int a = z * (size + 1) + x + 1;
+                obj << "f " << a << " " << a + size + 1 << " " << a + size + 2 << " " << a + 1 << "\n";
+            }
+        }
+        return obj.str();
+    }
+
+    std::filesystem::path m_directory;
+};
+
+TEST_F(ScanLoaderTest, Handles) {
+    ModelLoadOptions options;
+    std::string obj = write("small.obj", "v 0 0 0\n");
+    std::string ply = write("small.PLY", "ply\n");
+    std::string other = write("small.fbx", "");
+    // Small files are left to Assimp unless the threshold is lowered
+    EXPECT_FALSE(ScanLoader::handles(obj, options));
+    options.scan_threshold = 0;
+    EXPECT_TRUE(ScanLoader::handles(obj, options));
+    EXPECT_TRUE(ScanLoader::handles(ply, options));
+    EXPECT_FALSE(ScanLoader::handles(other, options));
+    EXPECT_FALSE(ScanLoader::handles((m_directory / "missing.obj").string(), options));
+}
+
+TEST_F(ScanLoaderTest, RejectsMalformedFiles) {
+    ModelLoadOptions options;
+    EXPECT_EQ(ScanLoader::parse((m_directory / "missing.obj").string(), options), nullptr);
+    EXPECT_EQ(ScanLoader::parse(write("range.obj", "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 4\n"), options), nullptr);
+    EXPECT_EQ(ScanLoader::parse(write("relative.obj", "v 0 0 0\nf -1 -2 -3\n"), options), nullptr);
+    EXPECT_EQ(ScanLoader::parse(write("uvs.obj", "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1/1 2/2 3/3\n"), options), nullptr);
+    EXPECT_EQ(ScanLoader::parse(write("vertex.obj", "v 0 zero 0\n"), options), nullptr);
+    EXPECT_EQ(ScanLoader::parse(write("header.ply", "ply\nelement vertex 1\nend_header\n0 0 0\n"), options),
+              nullptr);
+    EXPECT_EQ(ScanLoader::parse(write("short.ply", "ply\nformat ascii 1.0\nelement vertex 3\nproperty float x\n"
+                                                   "property float y\nproperty float z\nend_header\n0 0 0\n"),
+                                options),
+              nullptr);
+    EXPECT_EQ(ScanLoader::parse(write("truncated.ply", "ply\nformat binary_little_endian 1.0\nelement vertex 3\n"
+                                                       "property float x\nproperty float y\nproperty float z\n"
+                                                       "end_header\n0123456789"),
+                                options),
+              nullptr);
+}
+
+TEST_F(ScanLoaderTest, SplitsIntoParts) {
+    std::string fpath = write("grid.obj", make_grid(300));
+    ASSERT_GT(std::filesystem::file_size(fpath), std::uintmax_t(2) << 20);
+    ModelLoadOptions options;
+    auto whole = ScanLoader::parse(fpath, options);
+    ASSERT_NE(whole, nullptr);
+    ASSERT_EQ(ScanLoader::get_part_count(*whole), 1u);
+    // Every vertex is used once, every quad gives two triangles
+    EXPECT_EQ(ScanLoader::get_upload_size(*whole, 0),
+              301u * 301u * sizeof(scene::Vertex) + 300u * 300u * 6u * sizeof(unsigned int));
+
+    options.scan_part_triangles = 20000;
+    auto split = ScanLoader::parse(fpath, options);
+    ASSERT_NE(split, nullptr);
+    std::size_t parts = ScanLoader::get_part_count(*split);
+    EXPECT_GE(parts, 9u);
+    std::size_t bytes = 0;
+    for (std::size_t i = 0; i < parts; ++i) {
+        std::size_t size = ScanLoader::get_upload_size(*split, i);
+        EXPECT_LE(size, 20000u * 3u * (sizeof(unsigned int) + sizeof(scene::Vertex)));
+        bytes += size;
+    }
+    // Vertices on the cuts belong to both sides
+    EXPECT_GT(bytes, ScanLoader::get_upload_size(*whole, 0));
+}
+
+TEST_F(ScanLoaderTest, SinglePartUsesTheModelVertices) {
+    // The second vertex is used by no triangle
+    std::string fpath = write("unused.obj", "v 0 0 0\nv 5 5 5\nv 1 0 0\nv 0 1 0\nf 1 3 4\n");
+    ModelLoadOptions options;
+    options.optimize_vertex_order = false;
+    auto model = ScanLoader::parse(fpath, options);
+    ASSERT_NE(model, nullptr);
+    ASSERT_EQ(ScanLoader::get_part_count(*model), 1u);
+    // Without reordering the part takes the model vertices as they are
+    EXPECT_EQ(ScanLoader::get_upload_size(*model, 0), 4u * sizeof(scene::Vertex) + 3u * sizeof(unsigned int));
+
+    options.optimize_vertex_order = true;
+    model = ScanLoader::parse(fpath, options);
+    ASSERT_NE(model, nullptr);
+    EXPECT_EQ(ScanLoader::get_upload_size(*model, 0), 3u * sizeof(scene::Vertex) + 3u * sizeof(unsigned int));
+}
+
+#ifndef TEST_HEADLESS
+
+// Meshes of a loaded scan, in part order
+static std::vector<std::shared_ptr<scene::Mesh>> get_meshes(const std::shared_ptr<scene::Node> &root) {
+    std::vector<std::shared_ptr<scene::Mesh>> meshes;
+    if (root->has_mesh())
+        meshes.push_back(root->get_mesh());
+    for (const auto &child : root->get_children())
+        meshes.push_back(child->get_mesh());
+    return meshes;
+}
+
+TEST_F(ScanLoaderTest, ReadsObjNumbersColorsAndPolygons) {
+    std::string fpath = write("quad.obj", "# a colored quad\n"
+                                          "v 0 0 0 1 0 0\n"
+                                          "v 1.5e2 0 0 0 1 0\r\n"
+                                          "v\t150 -0.000125 2\t0 0 1\n"
+                                          "v 3.14159265358979323846264 0 2 1 1 1\n"
+                                          "vn 0 1 0\n"
+                                          "f -4//1 -3//1 -2//1 -1//1\n");
+    ModelLoadOptions options;
+    options.optimize_vertex_order = false;
+    auto root = ScanLoader::load(fpath, nullptr, options);
+    ASSERT_NE(root, nullptr);
+    EXPECT_EQ(root->get_name(), "quad.obj");
+    auto meshes = get_meshes(root);
+    ASSERT_EQ(meshes.size(), 1u);
+    const auto &vertices = meshes[0]->get_vertices();
+    ASSERT_EQ(vertices.size(), 4u);
+    EXPECT_EQ(meshes[0]->get_index_count(), 6u);
+    EXPECT_FLOAT_EQ(vertices[1].position.x, 150.0f);
+    EXPECT_FLOAT_EQ(vertices[2].position.y, -0.000125f);
+    EXPECT_FLOAT_EQ(vertices[3].position.x, 3.14159265358979f);
+    EXPECT_EQ(vertices[1].color, glm::vec4(0.0f, 1.0f, 0.0f, 1.0f));
+    // Corners index the normals apart from the positions
+    EXPECT_EQ(vertices[2].normal, glm::vec3(0.0f, 1.0f, 0.0f));
+    EXPECT_FLOAT_EQ(meshes[0]->get_bounding_box().max.z, 2.0f);
+}
+
+TEST_F(ScanLoaderTest, WeldsCornersAndGeneratesNormals) {
+    // Two triangles sharing an edge with different UVs on each side
+    std::string fpath = write("seam.obj", "v 0 0 0\nv 1 0 0\nv 1 0 -1\nv 0 0 -1\n"
+                                          "vt 0 0\nvt 1 0\nvt 1 1\nvt 0 1\nvt 0.5 0.5\n"
+                                          "f 1/1 2/2 3/3\nf 1/5 3/5 4/4\n");
+    ModelLoadOptions options;
+    auto root = ScanLoader::load(fpath, nullptr, options);
+    ASSERT_NE(root, nullptr);
+    auto mesh = get_meshes(root)[0];
+    // Positions 1 and 3 appear with two UVs each
+    EXPECT_EQ(mesh->get_vertices().size(), 6u);
+    for (const auto &vertex : mesh->get_vertices()) {
+        EXPECT_NEAR(vertex.normal.y, 1.0f, 1e-5f);
+        if (vertex.position == glm::vec3(1.0f, 0.0f, -1.0f) && vertex.uvs != glm::vec2(0.5f))
+            // UVs are flipped like Assimp does
+            EXPECT_EQ(vertex.uvs, glm::vec2(1.0f, 0.0f));
+    }
+}
+
+TEST_F(ScanLoaderTest, ReadsMaterials) {
+    write("scan.mtl", "newmtl red\nKd 1 0 0\nnewmtl blue\nKd 0 0 1\nKe 0.5 0.5 0.5\n");
+    std::string fpath = write("scan.obj", "mtllib scan.mtl\n"
+                                          "v 0 0 0\nv 1 0 0\nv 0 1 0\nv 5 0 0\nv 6 0 0\nv 5 1 0\n"
+                                          "usemtl red\nf 1 2 3\nusemtl blue\nf 4 5 6\nusemtl red\nf 3 2 1\n");
+    ModelLoadOptions options;
+    auto root = ScanLoader::load(fpath, nullptr, options);
+    ASSERT_NE(root, nullptr);
+    auto meshes = get_meshes(root);
+    ASSERT_EQ(meshes.size(), 2u);
+    ASSERT_NE(meshes[0]->get_material(), nullptr);
+    EXPECT_EQ(meshes[0]->get_material()->get_name(), "red");
+    EXPECT_EQ(meshes[0]->get_index_count(), 6u);
+    EXPECT_EQ(meshes[0]->get_material()->get_albedo(), glm::vec3(1.0f, 0.0f, 0.0f));
+    EXPECT_EQ(meshes[1]->get_material()->get_name(), "blue");
+    EXPECT_EQ(meshes[1]->get_material()->get_emissive(), glm::vec3(0.5f));
+    EXPECT_EQ(root->get_children()[1]->get_name(), "scan.obj_part_1");
+}
+
+// Writes a value in the byte order of a binary PLY
+template <typename T> static void put(std::string &out, T value, bool big_endian) {
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    if (big_endian)
+        std::reverse(bytes, bytes + sizeof(T));
+    out.append(bytes, sizeof(T));
+}
+
+TEST_F(ScanLoaderTest, AsciiAndBinaryPlyMatch) {
+    const float positions[5][3] = {{0, 0, 0}, {1, 0, 0}, {1, 1, 0}, {0, 1, 0}, {2, 0, 0}};
+    const unsigned char colors[5][3] = {{255, 0, 0}, {0, 255, 0}, {0, 0, 255}, {255, 255, 255}, {0, 0, 0}};
+    const std::string header_end = "element vertex 5\nproperty float x\nproperty float y\nproperty float z\n"
+                                   "property uchar red\nproperty uchar green\nproperty uchar blue\n"
+                                   "element face 2\nproperty list uchar int vertex_indices\n"
+                                   "element edge 1\nproperty list uchar int vertex\nend_header\n";
+    std::string ascii = "ply\nformat ascii 1.0\ncomment made by hand\n" + header_end;
+    for (int i = 0; i < 5; ++i)
+        ascii += std::to_string(positions[i][0]) + " " + std::to_string(positions[i][1]) + " " +
+                 std::to_string(positions[i][2]) + " " + std::to_string(colors[i][0]) + " " +
+                 std::to_string(colors[i][1]) + " " + std::to_string(colors[i][2]) + "\n";
+    ascii += "4 0 1 2 3\n3 1 4 2\n2 0 1\n";
+    std::string files[3] = {write("ascii.ply", ascii), "", ""};
+    for (int big_endian = 0; big_endian < 2; ++big_endian) {
+        std::string binary = std::string("ply\nformat ") + (big_endian ? "binary_big_endian" : "binary_little_endian") +
+                             " 1.0\n" + header_end;
+        for (int i = 0; i < 5; ++i) {
+            for (float value : positions[i])
+                put(binary, value, big_endian);
+            binary.append(reinterpret_cast<const char *>(colors[i]), 3);
+        }
+        // The quad comes first, so the faces are read one by one
+        binary += char(4);
+        for (int32_t index : {0, 1, 2, 3})
+            put(binary, index, big_endian);
+        binary += char(3);
+        for (int32_t index : {1, 4, 2})
+            put(binary, index, big_endian);
+        binary += char(2);
+        for (int32_t index : {0, 1})
+            put(binary, index, big_endian);
+        files[1 + big_endian] = write(big_endian ? "big.ply" : "little.ply", binary);
+    }
+
+    ModelLoadOptions options;
+    options.optimize_vertex_order = false;
+    for (const std::string &fpath : files) {
+        SCOPED_TRACE(fpath);
+        auto root = ScanLoader::load(fpath, nullptr, options);
+        ASSERT_NE(root, nullptr);
+        auto mesh = get_meshes(root)[0];
+        ASSERT_EQ(mesh->get_vertices().size(), 5u);
+        EXPECT_EQ(mesh->get_indices(), (std::vector<unsigned int>{0, 1, 2, 0, 2, 3, 1, 4, 2}));
+        EXPECT_EQ(mesh->get_vertices()[2].position, glm::vec3(1.0f, 1.0f, 0.0f));
+        EXPECT_EQ(mesh->get_vertices()[2].color, glm::vec4(0.0f, 0.0f, 1.0f, 1.0f));
+        EXPECT_NEAR(mesh->get_vertices()[0].normal.z, 1.0f, 1e-5f);
+    }
+}
+
+TEST_F(ScanLoaderTest, BinaryTrianglesReadInParallel) {
+    // Enough triangles for several tasks, all of them with three corners
+    const int size = 200;
+    std::string binary = "ply\nformat binary_little_endian 1.0\nelement vertex " +
+                         std::to_string((size + 1) * (size + 1)) +
+                         "\nproperty float x\nproperty float y\nproperty float z\nelement face " +
+                         std::to_string(size * size * 2) + "\nproperty list uchar uint vertex_indices\nend_header\n";
+    for (int z = 0; z <= size; ++z) {
+        for (int x = 0; x <= size; ++x) {
+            put(binary, static_cast<float>(x), false);
+            put(binary, 0.0f, false);
+            put(binary, static_cast<float>(z), false);
+        }
+    }
+    for (uint32_t z = 0; z < size; ++z) {
+        for (uint32_t x = 0; x < size; ++x) {
+            uint32_t a = z * (size + 1) + x;
+            binary += char(3);
+            for (uint32_t index : {a, a + size + 1, a + size + 2})
+                put(binary, index, false);
+            binary += char(3);
+            for (uint32_t index : {a, a + size + 2, a + 1})
+                put(binary, index, false);
+        }
+    }
+    std::string fpath = write("grid.ply", binary);
+
+    ModelLoadOptions options;
+    options.optimize_vertex_order = false;
+    auto root = ScanLoader::load(fpath, nullptr, options);
+    ASSERT_NE(root, nullptr);
+    auto mesh = get_meshes(root)[0];
+    EXPECT_EQ(mesh->get_index_count(), static_cast<unsigned int>(size * size * 6));
+    EXPECT_EQ(mesh->get_indices()[6 * (size * size - 1) + 5], static_cast<unsigned int>(size * (size + 1) - 1));
+    EXPECT_FLOAT_EQ(mesh->get_bounding_box().max.x, static_cast<float>(size));
+}
+
+TEST_F(ScanLoaderTest, PartsCoverTheScan) {
+    std::string fpath = write("grid.obj", make_grid(300));
+    ModelLoadOptions options;
+    options.scan_part_triangles = 20000;
+    options.residency = scene::GeometryResidency::Release;
+    auto root = ScanLoader::load(fpath, nullptr, options);
+    ASSERT_NE(root, nullptr);
+    auto meshes = get_meshes(root);
+    ASSERT_GE(meshes.size(), 9u);
+    unsigned int indices = 0;
+    glm::vec3 min(1e9f), max(-1e9f);
+    for (const auto &mesh : meshes) {
+        indices += mesh->get_index_count();
+        min = glm::min(min, mesh->get_bounding_box().min);
+        max = glm::max(max, mesh->get_bounding_box().max);
+        // Released geometry keeps its BVH for picking
+        EXPECT_FALSE(mesh->get_bvh().empty());
+        EXPECT_TRUE(mesh->get_vertices().empty());
+        // Parts are compact in space
+        glm::vec3 extent = mesh->get_bounding_box().max - mesh->get_bounding_box().min;
+        EXPECT_LT(extent.x * extent.z, 75.0f * 75.0f / 4.0f);
+    }
+    EXPECT_EQ(indices, 300u * 300u * 6u);
+    EXPECT_FLOAT_EQ(min.x, 0.0f);
+    EXPECT_FLOAT_EQ(max.x, 75.0f);
+    EXPECT_FLOAT_EQ(max.z, 75.0f);
+}
+
+TEST_F(ScanLoaderTest, ModelLoaderRoutesLargeScans) {
+    std::string fpath = write("triangle.obj", "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\n");
+    ModelLoadOptions options;
+    options.scan_threshold = 0;
+    options.cache_directory = (m_directory / "cache").string();
+    auto node = ModelLoader::load(fpath, nullptr, options);
+    ASSERT_NE(node, nullptr);
+    EXPECT_EQ(node->get_mesh()->get_index_count(), 3u);
+    EXPECT_FALSE(std::filesystem::exists(m_directory / "cache"));
+
+    options.scan_part_triangles = 1;
+    std::string pair = write("pair.obj", "v 0 0 0\nv 1 0 0\nv 0 1 0\nv 5 0 0\nf 1 2 3\nf 2 4 3\n");
+    auto handle = ModelLoader::load_async(pair, nullptr, options);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!handle->is_done() && std::chrono::steady_clock::now() < deadline) {
+        UploadQueue::get_instance().process();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_EQ(handle->get_state(), ModelLoadHandle::State::Ready);
+    ASSERT_EQ(handle->get_node()->get_children().size(), 2u);
+    EXPECT_EQ(handle->get_node()->get_children()[1]->get_mesh()->get_index_count(), 3u);
+}
+
+#endif
+
+} // namespace assets
+
+} // namespace lmgl
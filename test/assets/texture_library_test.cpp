@@ -1,6 +1,20 @@
 #include "lmgl/assets/texture_library.hpp"
 #include <gtest/gtest.h>
 
+#ifndef TEST_HEADLESS
+#include "lmgl/assets/upload_queue.hpp"
+#include "lmgl/core/engine.hpp"
+#include "lmgl/renderer/texture.hpp"
+#include "lmgl/renderer/texture_streamer.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#endif
+
 namespace lmgl {
 
 namespace assets {
@@ -38,7 +52,7 @@ TEST_F(TextureLibraryTest, ExistsReturnsFalseForNonExistent) {
 }
 
 TEST_F(TextureLibraryTest, GetReturnsNullptrForNonExistent) {
-    auto &lib = TextureLibrary::get_instance();
+    const auto &lib = TextureLibrary::get_instance();
     EXPECT_EQ(lib.get("nonexistent.png"), nullptr);
 }
 
@@ -48,6 +62,119 @@ TEST_F(TextureLibraryTest, Clear) {
     EXPECT_EQ(lib.size(), 0);
 }
 
+#ifndef TEST_HEADLESS
+
+TEST_F(TextureLibraryTest, InsertKeepsFirstTexture) {
+    auto &engine = core::Engine::get_instance();
+    if (!engine.get_window())
+        engine.init(800, 600, "Texture Library Test");
+    auto &lib = TextureLibrary::get_instance();
+    auto first = std::make_shared<renderer::Texture>(4, 4);
+    auto second = std::make_shared<renderer::Texture>(8, 8);
+    EXPECT_EQ(lib.insert("streamed.png", first), first);
+    EXPECT_EQ(lib.insert("streamed.png", second), first);
+    EXPECT_EQ(lib.get("streamed.png"), first);
+    EXPECT_EQ(lib.size(), 1u);
+}
+
+TEST_F(TextureLibraryTest, StreamingRoutesThroughStreamer) {
+    auto &engine = core::Engine::get_instance();
+    if (!engine.get_window())
+        engine.init(800, 600, "Texture Library Test");
+    auto &lib = TextureLibrary::get_instance();
+    const std::string fpath = "texture_library_test_streamed.ppm";
+    {
+        std::ofstream file(fpath, std::ios::binary);
+        file << "P6\n256 256\n255\n";
+        std::vector<char> pixels(256 * 256 * 3, 40);
+        file.write(pixels.data(), static_cast<std::streamsize>(pixels.size()));
+    }
+    EXPECT_FALSE(lib.load(fpath)->is_streamed());
+    lib.clear();
+
+    lib.set_streaming(true);
+    auto texture = lib.load(fpath);
+    ASSERT_NE(texture, nullptr);
+    EXPECT_TRUE(texture->is_streamed());
+    EXPECT_EQ(texture->get_base_level(), 2);
+    EXPECT_EQ(lib.load(fpath), texture);
+    renderer::ImageData image;
+    ASSERT_TRUE(renderer::Texture::decode(fpath, image));
+    EXPECT_TRUE(lib.create("embedded#image0", image, false)->is_streamed());
+    // Unreadable files fall back to the regular texture
+    EXPECT_NE(lib.load("non_existent_file.png"), nullptr);
+    lib.set_streaming(false);
+    EXPECT_FALSE(lib.create(fpath, image)->is_streamed());
+    std::remove(fpath.c_str());
+}
+
+TEST_F(TextureLibraryTest, EvictsUnusedTexturesOverBudget) {
+    auto &engine = core::Engine::get_instance();
+    if (!engine.get_window())
+        engine.init(800, 600, "Texture Library Test");
+    auto &lib = TextureLibrary::get_instance();
+    const size_t budget = lib.get_budget();
+    lib.reset_stats();
+    // Each 64x64 RGBA texture takes 16 KiB
+    lib.set_budget(40 * 1024);
+    auto held = lib.insert("held.png", std::make_shared<renderer::Texture>(64, 64));
+    lib.insert("first.png", std::make_shared<renderer::Texture>(64, 64));
+    EXPECT_EQ(lib.get_stats().resident_bytes, 32u * 1024u);
+    EXPECT_EQ(lib.size(), 2u);
+    lib.insert("second.png", std::make_shared<renderer::Texture>(64, 64));
+    // The held texture is the oldest but still in use
+    EXPECT_TRUE(lib.exists("held.png"));
+    EXPECT_FALSE(lib.exists("first.png"));
+    EXPECT_TRUE(lib.exists("second.png"));
+    EXPECT_EQ(lib.get_stats().evictions, 1u);
+    EXPECT_EQ(lib.get_stats().resident_bytes, 32u * 1024u);
+
+    EXPECT_EQ(lib.load("held.png"), held);
+    EXPECT_EQ(lib.get_stats().hits, 1u);
+    EXPECT_EQ(lib.get_stats().misses, 0u);
+    lib.set_budget(budget);
+}
+
+TEST_F(TextureLibraryTest, LoadAsyncSwapsPlaceholders) {
+    auto &engine = core::Engine::get_instance();
+    if (!engine.get_window())
+        engine.init(800, 600, "Texture Library Test");
+    auto &lib = TextureLibrary::get_instance();
+    std::vector<std::string> paths;
+    for (int i = 0; i < 16; ++i) {
+        paths.push_back("texture_library_test_" + std::to_string(i) + ".ppm");
+        std::ofstream file(paths.back(), std::ios::binary);
+        file << "P6\n" << i + 1 << " 2\n255\n" << std::string(static_cast<size_t>(i + 1) * 2 * 3, '\x7f');
+    }
+    std::vector<std::shared_ptr<renderer::Texture>> textures;
+    for (const auto &path : paths) {
+        textures.push_back(lib.load_async(path));
+        EXPECT_TRUE(textures.back()->is_placeholder());
+        EXPECT_EQ(lib.load_async(path), textures.back());
+    }
+    auto missing = lib.load_async("nonexistent_async.png");
+    EXPECT_EQ(lib.size(), paths.size() + 1);
+    EXPECT_EQ(lib.get_pending(), paths.size() + 1);
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (lib.get_pending() > 0 && std::chrono::steady_clock::now() < deadline) {
+        UploadQueue::get_instance().process();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_EQ(lib.get_pending(), 0u);
+    for (size_t i = 0; i < textures.size(); ++i) {
+        EXPECT_FALSE(textures[i]->is_placeholder());
+        EXPECT_EQ(textures[i]->get_width(), static_cast<int>(i) + 1);
+        EXPECT_EQ(textures[i]->get_height(), 2);
+        std::remove(paths[i].c_str());
+    }
+    // A file that fails to decode keeps its placeholder
+    EXPECT_TRUE(missing->is_placeholder());
+    EXPECT_GT(missing->get_id(), 0u);
+}
+
+#endif
+
 } // namespace assets
 
 } // namespace lmgl
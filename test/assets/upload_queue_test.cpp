@@ -0,0 +1,120 @@
+#include "lmgl/assets/upload_queue.hpp"
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace lmgl {
+
+namespace assets {
+
+class UploadQueueTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        // Upload queue tests run plain tasks, no OpenGL needed
+    }
+};
+
+TEST_F(UploadQueueTest, SingletonReturnsSameInstance) {
+    auto &queue1 = UploadQueue::get_instance();
+    auto &queue2 = UploadQueue::get_instance();
+    EXPECT_EQ(&queue1, &queue2);
+}
+
+TEST_F(UploadQueueTest, RunsTasksInOrder) {
+    UploadQueue queue;
+    std::vector<int> order;
+    for (int i = 0; i < 5; ++i)
+        queue.push([&order, i]() { order.push_back(i); });
+    EXPECT_EQ(queue.get_pending(), 5u);
+    EXPECT_EQ(queue.process(), 5u);
+    EXPECT_EQ(order, std::vector<int>({0, 1, 2, 3, 4}));
+    EXPECT_EQ(queue.get_pending(), 0u);
+    EXPECT_EQ(queue.process(), 0u);
+}
+
+TEST_F(UploadQueueTest, TimeBudgetSlicesWork) {
+    UploadQueue queue;
+    queue.set_budget(5.0, 0);
+    EXPECT_DOUBLE_EQ(queue.get_time_budget(), 5.0);
+    EXPECT_EQ(queue.get_byte_budget(), 0u);
+    int count = 0;
+    for (int i = 0; i < 4; ++i) {
+        queue.push([&count]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(4));
+            ++count;
+        });
+    }
+    // Each task takes most of the budget, so they are spread over frames
+    std::size_t first = queue.process();
+    EXPECT_GE(first, 1u);
+    EXPECT_LE(first, 2u);
+    while (queue.get_pending() > 0)
+        queue.process();
+    EXPECT_EQ(count, 4);
+}
+
+TEST_F(UploadQueueTest, ByteBudgetSlicesWork) {
+    UploadQueue queue;
+    queue.set_budget(1000.0, 100);
+    int count = 0;
+    for (int i = 0; i < 6; ++i)
+        queue.push([&count]() { ++count; }, 40);
+    EXPECT_EQ(queue.process(), 2u);
+    EXPECT_EQ(count, 2);
+    // A task over the whole budget still runs, alone
+    queue.push([&count]() { ++count; }, 500);
+    EXPECT_EQ(queue.process(), 2u);
+    EXPECT_EQ(queue.process(), 2u);
+    EXPECT_EQ(queue.process(), 1u);
+    EXPECT_EQ(count, 7);
+}
+
+TEST_F(UploadQueueTest, TasksQueuedWhileProcessingRun) {
+    UploadQueue queue;
+    bool second = false;
+    queue.push([&]() { queue.push([&second]() { second = true; }); });
+    EXPECT_EQ(queue.process(), 2u);
+    EXPECT_TRUE(second);
+}
+
+TEST_F(UploadQueueTest, FlushIgnoresBudget) {
+    UploadQueue queue;
+    queue.set_budget(0.0, 1);
+    int count = 0;
+    for (int i = 0; i < 10; ++i)
+        queue.push([&count]() { ++count; }, 1000);
+    EXPECT_EQ(queue.flush(), 10u);
+    EXPECT_EQ(count, 10);
+}
+
+TEST_F(UploadQueueTest, ClearDropsTasks) {
+    UploadQueue queue;
+    bool ran = false;
+    queue.push([&ran]() { ran = true; });
+    queue.clear();
+    EXPECT_EQ(queue.get_pending(), 0u);
+    EXPECT_EQ(queue.process(), 0u);
+    EXPECT_FALSE(ran);
+}
+
+TEST_F(UploadQueueTest, PushFromWorkerThreads) {
+    UploadQueue queue;
+    int count = 0;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&queue, &count]() {
+            for (int i = 0; i < 100; ++i)
+                queue.push([&count]() { ++count; });
+        });
+    }
+    for (auto &thread : threads)
+        thread.join();
+    EXPECT_EQ(queue.flush(), 400u);
+    EXPECT_EQ(count, 400);
+}
+
+} // namespace assets
+
+} // namespace lmgl
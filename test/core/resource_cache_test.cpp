@@ -0,0 +1,116 @@
+#include "lmgl/core/resource_cache.hpp"
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+
+namespace lmgl {
+
+namespace core {
+
+class ResourceCacheTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        // Resource cache tests are CPU-only, no OpenGL needed
+    }
+
+    struct Resource {
+        std::size_t bytes;
+    };
+
+    static ResourceCache<Resource> make_cache() {
+        return ResourceCache<Resource>([](const Resource &resource) { return resource.bytes; });
+    }
+};
+
+TEST_F(ResourceCacheTest, CountsHitsAndMisses) {
+    auto cache = make_cache();
+    EXPECT_EQ(cache.find("a"), nullptr);
+    cache.insert("a", std::make_shared<Resource>(Resource{10}));
+    EXPECT_NE(cache.find("a"), nullptr);
+    EXPECT_NE(cache.find("a"), nullptr);
+    // Plain lookups leave the counters alone
+    EXPECT_NE(cache.get("a"), nullptr);
+    EXPECT_EQ(cache.get_stats().hits, 2u);
+    EXPECT_EQ(cache.get_stats().misses, 1u);
+    EXPECT_EQ(cache.get_stats().resident_bytes, 10u);
+    cache.reset_stats();
+    EXPECT_EQ(cache.get_stats().hits, 0u);
+    EXPECT_EQ(cache.get_stats().resident_bytes, 10u);
+}
+
+TEST_F(ResourceCacheTest, InsertKeepsOrReplaces) {
+    auto cache = make_cache();
+    auto first = std::make_shared<Resource>(Resource{10});
+    auto second = std::make_shared<Resource>(Resource{30});
+    EXPECT_EQ(cache.insert("a", first), first);
+    EXPECT_EQ(cache.insert("a", second), first);
+    EXPECT_EQ(cache.get_stats().resident_bytes, 10u);
+    EXPECT_EQ(cache.insert("a", second, true), second);
+    EXPECT_EQ(cache.get_stats().resident_bytes, 30u);
+    EXPECT_EQ(cache.insert("b", nullptr), nullptr);
+    EXPECT_EQ(cache.size(), 1u);
+}
+
+TEST_F(ResourceCacheTest, EvictsLeastRecentlyUsed) {
+    auto cache = make_cache();
+    cache.set_budget(25);
+    cache.insert("a", std::make_shared<Resource>(Resource{10}));
+    cache.insert("b", std::make_shared<Resource>(Resource{10}));
+    // Touching a makes b the oldest, const lookups included
+    const ResourceCache<Resource> &const_cache = cache;
+    const_cache.get("a");
+    cache.insert("c", std::make_shared<Resource>(Resource{10}));
+    EXPECT_TRUE(cache.contains("a"));
+    EXPECT_FALSE(cache.contains("b"));
+    EXPECT_TRUE(cache.contains("c"));
+    EXPECT_EQ(cache.get_stats().evictions, 1u);
+    EXPECT_EQ(cache.get_stats().resident_bytes, 20u);
+}
+
+TEST_F(ResourceCacheTest, KeepsResourcesInUse) {
+    auto cache = make_cache();
+    cache.set_budget(15);
+    auto held = cache.insert("a", std::make_shared<Resource>(Resource{10}));
+    cache.insert("b", std::make_shared<Resource>(Resource{10}));
+    // a is older but still held, b goes instead
+    EXPECT_TRUE(cache.contains("a"));
+    EXPECT_TRUE(cache.contains("b"));
+    auto small = cache.insert("c", std::make_shared<Resource>(Resource{1}));
+    EXPECT_TRUE(cache.contains("a"));
+    EXPECT_FALSE(cache.contains("b"));
+    EXPECT_TRUE(cache.contains("c"));
+
+    // Over budget with everything in use, nothing can go
+    auto big = cache.insert("d", std::make_shared<Resource>(Resource{100}));
+    EXPECT_TRUE(cache.contains("d"));
+    EXPECT_GT(cache.get_stats().resident_bytes, cache.get_budget());
+    // Released resources are evicted on the next trim
+    held.reset();
+    big.reset();
+    EXPECT_EQ(cache.trim(), 2u);
+    EXPECT_TRUE(cache.contains("c"));
+    EXPECT_LE(cache.get_stats().resident_bytes, cache.get_budget());
+}
+
+TEST_F(ResourceCacheTest, UpdateSizeAndErase) {
+    auto cache = make_cache();
+    auto resource = cache.insert("a", std::make_shared<Resource>(Resource{1}));
+    resource->bytes = 50;
+    EXPECT_EQ(cache.get_stats().resident_bytes, 1u);
+    cache.update_size("a");
+    EXPECT_EQ(cache.get_stats().resident_bytes, 50u);
+    EXPECT_TRUE(cache.erase("a"));
+    EXPECT_FALSE(cache.erase("a"));
+    EXPECT_EQ(cache.get_stats().resident_bytes, 0u);
+    // No budget means no eviction
+    cache.insert("b", std::make_shared<Resource>(Resource{1000}));
+    EXPECT_EQ(cache.trim(), 0u);
+    cache.clear();
+    EXPECT_EQ(cache.size(), 0u);
+    EXPECT_EQ(cache.get_stats().resident_bytes, 0u);
+}
+
+} // namespace core
+
+} // namespace lmgl
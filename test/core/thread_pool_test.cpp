@@ -0,0 +1,133 @@
+#include "lmgl/core/thread_pool.hpp"
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <set>
+#include <stdexcept>
+#include <vector>
+
+namespace lmgl {
+
+namespace core {
+
+class ThreadPoolTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        // Thread pool tests are CPU-only, no OpenGL needed
+    }
+};
+
+TEST_F(ThreadPoolTest, SingletonReturnsSameInstance) {
+    auto &pool1 = ThreadPool::get_instance();
+    auto &pool2 = ThreadPool::get_instance();
+    EXPECT_EQ(&pool1, &pool2);
+    EXPECT_GE(pool1.get_thread_count(), 1u);
+}
+
+TEST_F(ThreadPoolTest, SubmitReturnsResult) {
+    ThreadPool pool(2);
+    EXPECT_EQ(pool.get_thread_count(), 2u);
+    auto answer = pool.submit([]() { return 6 * 7; });
+    auto nothing = pool.submit([]() {});
+    EXPECT_EQ(answer.get(), 42);
+    nothing.get();
+}
+
+TEST_F(ThreadPoolTest, ExceptionReachesFuture) {
+    ThreadPool pool(1);
+    auto future = pool.submit([]() -> int { throw std::runtime_error("task failed"); });
+    EXPECT_THROW(future.get(), std::runtime_error);
+    // The worker survives the exception
+    EXPECT_EQ(pool.submit([]() { return 1; }).get(), 1);
+}
+
+TEST_F(ThreadPoolTest, RunsTasksOnSeveralThreads) {
+    ThreadPool pool(4);
+    std::atomic<int> running{0};
+    std::atomic<int> peak{0};
+    std::vector<std::future<std::thread::id>> futures;
+    for (int i = 0; i < 4; ++i) {
+        futures.push_back(pool.submit([&]() {
+            int now = ++running;
+            int expected = peak.load();
+            while (now > expected && !peak.compare_exchange_weak(expected, now)) {
+            }
+            // Wait for the others so that the tasks overlap
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+            while (peak.load() < 4 && std::chrono::steady_clock::now() < deadline)
+                std::this_thread::yield();
+            --running;
+            return std::this_thread::get_id();
+        }));
+    }
+    std::set<std::thread::id> threads;
+    for (auto &future : futures)
+        threads.insert(future.get());
+    EXPECT_EQ(peak.load(), 4);
+    EXPECT_EQ(threads.size(), 4u);
+    EXPECT_EQ(threads.count(std::this_thread::get_id()), 0u);
+}
+
+TEST_F(ThreadPoolTest, TasksCanSubmitTasks) {
+    ThreadPool pool(2);
+    std::atomic<int> count{0};
+    for (int i = 0; i < 8; ++i) {
+        pool.submit([&]() {
+            ++count;
+            pool.submit([&]() { ++count; });
+        });
+    }
+    pool.wait_idle();
+    EXPECT_EQ(count.load(), 16);
+    EXPECT_EQ(pool.get_pending(), 0u);
+}
+
+TEST_F(ThreadPoolTest, ParallelForVisitsEveryIndexOnce) {
+    ThreadPool pool(3);
+    std::vector<std::atomic<int>> visits(1000);
+    pool.parallel_for(visits.size(), [&](std::size_t i) { ++visits[i]; });
+    for (const auto &count : visits)
+        EXPECT_EQ(count.load(), 1);
+    // Nothing to do returns at once
+    pool.parallel_for(0, [](std::size_t) { FAIL(); });
+}
+
+TEST_F(ThreadPoolTest, ParallelForRethrowsAfterFinishing) {
+    ThreadPool pool(2);
+    std::atomic<int> count{0};
+    EXPECT_THROW(pool.parallel_for(64,
+                                   [&](std::size_t i) {
+                                       ++count;
+                                       if (i == 10)
+                                           throw std::runtime_error("index 10");
+                                   }),
+                 std::runtime_error);
+    EXPECT_EQ(count.load(), 64);
+}
+
+TEST_F(ThreadPoolTest, ParallelForFromTasks) {
+    // Every worker is inside a loop, the callers run the indices themselves
+    ThreadPool pool(2);
+    std::atomic<int> count{0};
+    std::vector<std::future<void>> futures;
+    for (int i = 0; i < 4; ++i)
+        futures.push_back(pool.submit([&]() { pool.parallel_for(16, [&](std::size_t) { ++count; }); }));
+    for (auto &future : futures)
+        future.get();
+    EXPECT_EQ(count.load(), 64);
+}
+
+TEST_F(ThreadPoolTest, DestructorFinishesQueuedTasks) {
+    std::atomic<int> count{0};
+    {
+        ThreadPool pool(1);
+        for (int i = 0; i < 32; ++i)
+            pool.submit([&]() { ++count; });
+    }
+    EXPECT_EQ(count.load(), 32);
+}
+
+} // namespace core
+
+} // namespace lmgl
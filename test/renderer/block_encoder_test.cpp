@@ -0,0 +1,207 @@
+#include <gtest/gtest.h>
+
+#ifndef TEST_HEADLESS
+#include "lmgl/core/engine.hpp"
+#endif
+#include "lmgl/renderer/block_encoder.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <vector>
+
+namespace lmgl {
+
+namespace renderer {
+
+class BlockEncoderTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+#ifndef TEST_HEADLESS
+        auto &engine_instance = core::Engine::get_instance();
+        if (!engine_instance.get_window())
+            engine_instance.init(800, 600, "Block Encoder Test");
+#endif
+    }
+
+    // Smooth RGBA gradient, the typical content of albedo textures
+    static ImageData make_gradient(int width, int height, int channels = 4) {
+        ImageData image;
+        image.width = width;
+        image.height = height;
+        image.channels = channels;
+        image.pixels = std::shared_ptr<unsigned char>(new unsigned char[image.size()],
+                                                      std::default_delete<unsigned char[]>());
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                unsigned char *pixel = image.pixels.get() + (y * width + x) * channels;
+                const int values[4] = {x * 255 / (width - 1), y * 255 / (height - 1),
+                                       (x + y) * 255 / (width + height - 2), 255 - x * 255 / (width - 1)};
+                for (int c = 0; c < channels; ++c)
+                    pixel[c] = static_cast<unsigned char>(values[c]);
+            }
+        }
+        return image;
+    }
+};
+
+TEST_F(BlockEncoderTest, EncodeBuildsMipChain) {
+    ImageData image = make_gradient(13, 7, 3);
+    CompressedImage compressed;
+    ASSERT_TRUE(BlockEncoder::encode(image, BlockFormat::BC1, compressed));
+    EXPECT_EQ(compressed.format, BlockFormat::BC1);
+    // 13x7, 6x3, 3x1, 1x1
+    ASSERT_EQ(compressed.levels.size(), 4u);
+    EXPECT_EQ(compressed.levels[1].width, 6);
+    EXPECT_EQ(compressed.levels[1].height, 3);
+    EXPECT_EQ(compressed.levels[3].width, 1);
+    EXPECT_EQ(compressed.levels[3].height, 1);
+    for (const auto &level : compressed.levels)
+        EXPECT_EQ(level.data.size(), TextureContainer::get_level_size(BlockFormat::BC1, level.width, level.height));
+
+    ASSERT_TRUE(BlockEncoder::encode(image, BlockFormat::BC7, compressed, false));
+    EXPECT_EQ(compressed.levels.size(), 1u);
+    EXPECT_EQ(compressed.levels[0].data.size(), 4u * 2u * 16u);
+}
+
+TEST_F(BlockEncoderTest, EncodeRejectsEmptyImage) {
+    CompressedImage compressed;
+    EXPECT_FALSE(BlockEncoder::encode(ImageData(), BlockFormat::BC1, compressed));
+    EXPECT_TRUE(compressed.levels.empty());
+}
+
+TEST_F(BlockEncoderTest, BC4KeepsTwoValuesExact) {
+    unsigned char pixels[64] = {};
+    for (int i = 0; i < 16; ++i)
+        pixels[i * 4] = i % 3 == 0 ? 200 : 10;
+    unsigned char block[8];
+    BlockEncoder::encode_block(pixels, BlockFormat::BC4, block);
+    EXPECT_EQ(block[0], 200);
+    EXPECT_EQ(block[1], 10);
+    uint64_t indices = 0;
+    for (int i = 0; i < 6; ++i)
+        indices |= static_cast<uint64_t>(block[2 + i]) << (8 * i);
+    for (int i = 0; i < 16; ++i)
+        EXPECT_EQ(indices >> (3 * i) & 7u, i % 3 == 0 ? 0u : 1u);
+}
+
+TEST_F(BlockEncoderTest, SolidBlocks) {
+    unsigned char pixels[64];
+    for (int i = 0; i < 16; ++i) {
+        pixels[i * 4] = 255;
+        pixels[i * 4 + 1] = 0;
+        pixels[i * 4 + 2] = 0;
+        pixels[i * 4 + 3] = 255;
+    }
+    unsigned char block[16];
+    BlockEncoder::encode_block(pixels, BlockFormat::BC1, block);
+    // Pure red is exact in 5:6:5, with every index on the first endpoint
+    EXPECT_EQ(block[0] | block[1] << 8, 0xF800);
+    EXPECT_EQ(block[4] | block[5] | block[6] | block[7], 0);
+    BlockEncoder::encode_block(pixels, BlockFormat::BC7, block);
+    // Mode 6 is six zero bits followed by a one
+    EXPECT_EQ(block[0] & 0x7F, 0x40);
+}
+
+TEST_F(BlockEncoderTest, ConvertWritesDds) {
+    const std::string source = "block_encoder_test.ppm";
+    const std::string target = "block_encoder_test.dds";
+    {
+        std::ofstream file(source, std::ios::binary);
+        file << "P6\n16 16\n255\n";
+        for (int i = 0; i < 16 * 16; ++i)
+            file.put(static_cast<char>(i)).put(static_cast<char>(255 - i)).put(static_cast<char>(128));
+    }
+    ASSERT_TRUE(BlockEncoder::convert(source, target, BlockFormat::BC1));
+    CompressedImage loaded;
+    ASSERT_TRUE(TextureContainer::load(target, loaded));
+    EXPECT_EQ(loaded.format, BlockFormat::BC1);
+    EXPECT_EQ(loaded.levels.size(), 5u);
+    // 16x16 RGB8 is 768 bytes, BC1 needs 128 for the base level
+    EXPECT_EQ(loaded.levels[0].data.size(), 128u);
+    EXPECT_FALSE(BlockEncoder::convert("non_existent_file.png", target, BlockFormat::BC1));
+    std::remove(source.c_str());
+    std::remove(target.c_str());
+}
+
+#ifndef TEST_HEADLESS
+
+TEST_F(BlockEncoderTest, DecodedByDriverWithinTolerance) {
+    struct Case {
+        BlockFormat format;
+        int channels;
+        float tolerance;
+    };
+    // Mean absolute error per channel, out of 255
+    const Case cases[] = {{BlockFormat::BC1, 3, 4.0f},
+                          {BlockFormat::BC3, 4, 4.0f},
+                          {BlockFormat::BC4, 1, 1.5f},
+                          {BlockFormat::BC5, 2, 1.5f},
+                          {BlockFormat::BC7, 4, 3.0f}};
+    const int size = 64;
+    ImageData source = make_gradient(size, size);
+    for (const Case &test : cases) {
+        SCOPED_TRACE(static_cast<int>(test.format));
+        if (!Texture::is_format_supported(test.format))
+            GTEST_SKIP() << "Block format not supported by this context";
+        ImageData image;
+        image.width = size;
+        image.height = size;
+        image.channels = test.channels;
+        image.compressed = std::make_shared<CompressedImage>();
+        ASSERT_TRUE(BlockEncoder::encode(source, test.format, *image.compressed));
+        while (glGetError() != GL_NO_ERROR) {
+        }
+        Texture texture("gradient", image);
+        EXPECT_EQ(glGetError(), static_cast<GLenum>(GL_NO_ERROR));
+        ASSERT_GT(texture.get_id(), 0u);
+        EXPECT_TRUE(texture.is_compressed());
+        EXPECT_EQ(texture.get_memory_usage(), image.compressed->size());
+        // 4 bits per pixel for BC1 and BC4, 8 for the others, against 32 for RGBA8
+        size_t bits = TextureContainer::get_block_size(test.format) / 2;
+        EXPECT_EQ(image.compressed->levels[0].data.size(), size * size * bits / 8);
+
+        GLint max_level = 0;
+        texture.bind(0);
+        glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, &max_level);
+        EXPECT_EQ(max_level, 6);
+        std::vector<unsigned char> decoded(size * size * 4);
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, decoded.data());
+        double error = 0.0;
+        for (int i = 0; i < size * size; ++i) {
+            for (int c = 0; c < test.channels; ++c)
+                error += std::abs(decoded[i * 4 + c] - source.pixels.get()[i * 4 + c]);
+        }
+        error /= size * size * test.channels;
+        EXPECT_LT(error, test.tolerance);
+
+        // The smallest level is a single block
+        std::vector<unsigned char> last(4);
+        glGetTexImage(GL_TEXTURE_2D, 6, GL_RGBA, GL_UNSIGNED_BYTE, last.data());
+        EXPECT_NEAR(last[0], 128, 8);
+    }
+}
+
+TEST_F(BlockEncoderTest, TextureLoadsDdsFile) {
+    if (!Texture::is_format_supported(BlockFormat::BC7))
+        GTEST_SKIP() << "BC7 not supported by this context";
+    const std::string fpath = "block_encoder_test_load.dds";
+    CompressedImage compressed;
+    ASSERT_TRUE(BlockEncoder::encode(make_gradient(32, 16), BlockFormat::BC7, compressed));
+    ASSERT_TRUE(TextureContainer::save_dds(fpath, compressed));
+    Texture texture(fpath);
+    EXPECT_GT(texture.get_id(), 0u);
+    EXPECT_TRUE(texture.is_compressed());
+    EXPECT_EQ(texture.get_width(), 32);
+    EXPECT_EQ(texture.get_height(), 16);
+    // RGBA8 with generated mipmaps would take 32 * 16 * 4 * 4 / 3 bytes
+    EXPECT_LT(texture.get_memory_usage() * 3, 32u * 16u * 4u * 4u / 3u);
+    std::remove(fpath.c_str());
+}
+
+#endif
+
+} // namespace renderer
+
+} // namespace lmgl
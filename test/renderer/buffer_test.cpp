@@ -2,9 +2,13 @@
 
 #ifndef TEST_HEADLESS
 #include "lmgl/core/engine.hpp"
+#include "lmgl/renderer/capabilities.hpp"
+#include <glad/glad.h>
 #endif
 #include "lmgl/renderer/buffer.hpp"
 
+#include <vector>
+
 namespace lmgl {
 
 namespace renderer {
@@ -65,6 +69,27 @@ TEST_F(BufferTest, ComponentCountCorrect) {
     EXPECT_EQ(elem_mat4.get_component_count(), 16);
 }
 
+TEST_F(BufferTest, PackedTypeSizes) {
+    EXPECT_EQ(BufferElement(ShaderDataType::Half2, "h").size, 4u);
+    EXPECT_EQ(BufferElement(ShaderDataType::Half4, "h").size, 8u);
+    EXPECT_EQ(BufferElement(ShaderDataType::UByte4, "b").size, 4u);
+    EXPECT_EQ(BufferElement(ShaderDataType::Short2, "s").size, 4u);
+    EXPECT_EQ(BufferElement(ShaderDataType::UShort4, "s").size, 8u);
+    EXPECT_EQ(BufferElement(ShaderDataType::Int2_10_10_10, "p").size, 4u);
+    EXPECT_EQ(BufferElement(ShaderDataType::Int2_10_10_10, "p").get_component_count(), 4u);
+    EXPECT_EQ(BufferElement(ShaderDataType::Short2, "s").get_component_count(), 2u);
+}
+
+TEST_F(BufferTest, IntegerTypesAreFlagged) {
+    EXPECT_TRUE(BufferElement(ShaderDataType::Int2, "i").is_integer());
+    EXPECT_TRUE(BufferElement(ShaderDataType::Bool, "b").is_integer());
+    EXPECT_FALSE(BufferElement(ShaderDataType::UByte4, "c", true).is_integer());
+    EXPECT_TRUE(BufferElement(ShaderDataType::UByte4I, "j").is_integer());
+    EXPECT_EQ(BufferElement(ShaderDataType::UByte4I, "j").size, 4u);
+    EXPECT_EQ(BufferElement(ShaderDataType::UByte4I, "j").get_component_count(), 4u);
+    EXPECT_FALSE(BufferElement(ShaderDataType::Float3, "f").is_integer());
+}
+
 TEST_F(BufferTest, BufferLayoutStrideCalculation) {
     BufferLayout layout = {{ShaderDataType::Float3, "a_Position"}, {ShaderDataType::Float4, "a_Color"}};
 
@@ -112,6 +137,19 @@ TEST_F(BufferTest, IndexBufferCreation) {
     EXPECT_EQ(ibo->get_count(), 6);
 }
 
+TEST_F(BufferTest, ShortIndexBufferCreation) {
+    uint16_t indices[] = {0, 1, 2, 2, 3, 0};
+    auto ibo = std::make_shared<IndexBuffer>(indices, 6);
+    EXPECT_EQ(ibo->get_count(), 6u);
+    EXPECT_EQ(ibo->get_index_type(), static_cast<unsigned int>(GL_UNSIGNED_SHORT));
+    EXPECT_EQ(ibo->get_index_size(), 2u);
+
+    unsigned int wide_indices[] = {0, 1, 2};
+    IndexBuffer wide(wide_indices, 3);
+    EXPECT_EQ(wide.get_index_type(), static_cast<unsigned int>(GL_UNSIGNED_INT));
+    EXPECT_EQ(wide.get_index_size(), 4u);
+}
+
 TEST_F(BufferTest, BufferBindUnbind) {
     float vertices[] = {-0.5f, -0.5f, 0.0f};
     auto vbo = std::make_shared<VertexBuffer>(vertices, sizeof(vertices));
@@ -128,6 +166,70 @@ TEST_F(BufferTest, BufferBindUnbind) {
     ibo->unbind();
 }
 
+TEST_F(BufferTest, StreamBufferAlignsOffsets) {
+    StreamBuffer stream(256);
+    float data[3] = {1.0f, 2.0f, 3.0f};
+    EXPECT_EQ(stream.push(data, sizeof(data)), 0u);
+    EXPECT_EQ(stream.push(data, sizeof(data)), 16u);
+    EXPECT_EQ(stream.push(data, sizeof(data), 64), 64u);
+    EXPECT_EQ(stream.get_current_region(), 0u);
+}
+
+TEST_F(BufferTest, StreamBufferRejectsOversizedPush) {
+    StreamBuffer stream(64);
+    std::vector<unsigned char> data(65, 0);
+    EXPECT_EQ(stream.push(data.data(), 65), StreamBuffer::invalid);
+    EXPECT_EQ(stream.push(data.data(), 0), StreamBuffer::invalid);
+}
+
+TEST_F(BufferTest, StreamBufferAdvancesWhenRegionIsFull) {
+    StreamBuffer stream(64, 3);
+    std::vector<unsigned char> data(48, 0);
+    EXPECT_EQ(stream.push(data.data(), 48), 0u);
+    EXPECT_EQ(stream.push(data.data(), 32), 64u);
+    EXPECT_EQ(stream.get_current_region(), 1u);
+    stream.end_frame();
+    EXPECT_EQ(stream.get_current_region(), 2u);
+    // Nothing pushed since the last frame, the region is kept
+    stream.end_frame();
+    EXPECT_EQ(stream.get_current_region(), 2u);
+    EXPECT_EQ(stream.push(data.data(), 16), 128u);
+    stream.end_frame();
+    glFinish();
+    EXPECT_EQ(stream.push(data.data(), 16), 0u);
+    EXPECT_EQ(stream.get_stall_count(), 0u);
+}
+
+TEST_F(BufferTest, StreamBufferOnlyOrphansAtFrameEnd) {
+    StreamBuffer stream(64, 2, false);
+    std::vector<unsigned char> data(48, 0);
+    // Regions filling up mid-frame wait for their fence rather than dropping pending data
+    for (int i = 0; i < 8; ++i)
+        EXPECT_NE(stream.push(data.data(), 48), StreamBuffer::invalid);
+    EXPECT_EQ(stream.get_orphan_count(), 0u);
+    stream.end_frame();
+    glFinish();
+    EXPECT_EQ(stream.push(data.data(), 48), 64u * stream.get_current_region());
+}
+
+TEST_F(BufferTest, StreamBufferWritesPushedData) {
+    for (bool persistent : {false, true}) {
+        StreamBuffer stream(128, 3, persistent);
+        EXPECT_EQ(stream.is_persistent(), persistent && Capabilities::get_instance().has_buffer_storage());
+        float first[4] = {1.0f, 2.0f, 3.0f, 4.0f};
+        float second[4] = {5.0f, 6.0f, 7.0f, 8.0f};
+        stream.push(first, sizeof(first));
+        unsigned int offset = stream.push(second, sizeof(second));
+        glFinish();
+        float readback[4] = {};
+        glBindBuffer(GL_COPY_READ_BUFFER, stream.get_id());
+        glGetBufferSubData(GL_COPY_READ_BUFFER, offset, sizeof(readback), readback);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        EXPECT_FLOAT_EQ(readback[0], 5.0f);
+        EXPECT_FLOAT_EQ(readback[3], 8.0f);
+    }
+}
+
 #endif
 
 } // namespace renderer
@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+
+#ifndef TEST_HEADLESS
+#include "lmgl/core/engine.hpp"
+#endif
+#include "lmgl/renderer/capabilities.hpp"
+
+namespace lmgl {
+
+namespace renderer {
+
+class CapabilitiesTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        // Setup code before each test
+#ifndef TEST_HEADLESS
+        auto &engine = core::Engine::get_instance();
+        if (!engine.get_window())
+            engine.init(800, 600, "Capabilities Test");
+#endif
+    }
+
+    void TearDown() override {
+        // Cleanup code after each test
+    }
+};
+
+TEST_F(CapabilitiesTest, IndirectCommandMatchesSpecLayout) {
+    EXPECT_EQ(sizeof(DrawElementsIndirectCommand), 5 * sizeof(unsigned int));
+}
+
+TEST_F(CapabilitiesTest, UnknownExtensionIsAbsent) {
+    EXPECT_FALSE(Capabilities::get_instance().has_extension("GL_LMGL_does_not_exist"));
+}
+
+#ifdef TEST_HEADLESS
+
+TEST_F(CapabilitiesTest, DetectWithoutContextReportsNothing) {
+    auto &caps = Capabilities::get_instance();
+    caps.detect();
+    EXPECT_FALSE(caps.is_detected());
+    EXPECT_FALSE(caps.has_multi_draw_indirect());
+    EXPECT_FALSE(caps.has_buffer_storage());
+    EXPECT_FALSE(caps.has_parallel_shader_compile());
+}
+
+#else
+
+TEST_F(CapabilitiesTest, DetectsContextVersion) {
+    auto &caps = Capabilities::get_instance();
+    EXPECT_TRUE(caps.is_detected());
+    EXPECT_TRUE(caps.is_version_at_least(4, 1));
+    EXPECT_FALSE(caps.is_version_at_least(caps.get_major_version() + 1, 0));
+}
+
+TEST_F(CapabilitiesTest, MultiDrawIndirectFollowsVersionOrExtension) {
+    auto &caps = Capabilities::get_instance();
+    bool expected = (caps.is_version_at_least(4, 3) || caps.has_extension("GL_ARB_multi_draw_indirect")) &&
+                    (caps.is_version_at_least(4, 2) || caps.has_extension("GL_ARB_base_instance"));
+    EXPECT_EQ(caps.has_multi_draw_indirect(), expected);
+}
+
+TEST_F(CapabilitiesTest, BufferStorageFollowsVersionOrExtension) {
+    auto &caps = Capabilities::get_instance();
+    bool expected = caps.is_version_at_least(4, 4) || caps.has_extension("GL_ARB_buffer_storage");
+    EXPECT_EQ(caps.has_buffer_storage(), expected);
+}
+
+TEST_F(CapabilitiesTest, ParallelShaderCompileFollowsExtension) {
+    auto &caps = Capabilities::get_instance();
+    bool expected =
+        caps.has_extension("GL_KHR_parallel_shader_compile") || caps.has_extension("GL_ARB_parallel_shader_compile");
+    EXPECT_EQ(caps.has_parallel_shader_compile(), expected);
+}
+
+#endif
+
+} // namespace renderer
+
+} // namespace lmgl
@@ -0,0 +1,225 @@
+#include <gtest/gtest.h>
+
+#ifndef TEST_HEADLESS
+#include "lmgl/core/engine.hpp"
+#include "lmgl/scene/mesh.hpp"
+#include <glad/glad.h>
+#endif
+#include "lmgl/renderer/geometry_pool.hpp"
+
+#include <vector>
+
+namespace lmgl {
+
+namespace renderer {
+
+class GeometryPoolTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        // Setup code before each test
+#ifndef TEST_HEADLESS
+        auto &engine = core::Engine::get_instance();
+        if (!engine.get_window())
+            engine.init(800, 600, "Geometry Pool Test");
+#endif
+    }
+
+    void TearDown() override {
+        // Cleanup code after each test
+    }
+};
+
+TEST_F(GeometryPoolTest, RangeAllocatorFirstFit) {
+    RangeAllocator allocator(100);
+    EXPECT_EQ(allocator.allocate(10), 0u);
+    EXPECT_EQ(allocator.allocate(20), 10u);
+    EXPECT_EQ(allocator.allocate(30), 30u);
+    EXPECT_EQ(allocator.get_used(), 60u);
+    EXPECT_EQ(allocator.get_largest_free_block(), 40u);
+}
+
+TEST_F(GeometryPoolTest, RangeAllocatorFailsWhenFull) {
+    RangeAllocator allocator(16);
+    EXPECT_EQ(allocator.allocate(16), 0u);
+    EXPECT_EQ(allocator.allocate(1), RangeAllocator::invalid);
+    EXPECT_EQ(allocator.allocate(0), RangeAllocator::invalid);
+}
+
+TEST_F(GeometryPoolTest, RangeAllocatorReusesFreedHole) {
+    RangeAllocator allocator(100);
+    unsigned int a = allocator.allocate(10);
+    unsigned int b = allocator.allocate(10);
+    allocator.allocate(10);
+    allocator.free(b, 10);
+    EXPECT_EQ(allocator.allocate(5), b);
+    EXPECT_EQ(allocator.allocate(5), b + 5);
+    EXPECT_EQ(a, 0u);
+}
+
+TEST_F(GeometryPoolTest, RangeAllocatorCoalescesNeighbours) {
+    RangeAllocator allocator(30);
+    unsigned int a = allocator.allocate(10);
+    unsigned int b = allocator.allocate(10);
+    unsigned int c = allocator.allocate(10);
+    allocator.free(a, 10);
+    allocator.free(c, 10);
+    EXPECT_EQ(allocator.get_free_block_count(), 2u);
+    allocator.free(b, 10);
+    EXPECT_EQ(allocator.get_free_block_count(), 1u);
+    EXPECT_EQ(allocator.get_largest_free_block(), 30u);
+    EXPECT_EQ(allocator.get_used(), 0u);
+}
+
+TEST_F(GeometryPoolTest, RangeAllocatorCompactness) {
+    RangeAllocator allocator(30);
+    unsigned int a = allocator.allocate(10);
+    allocator.allocate(10);
+    EXPECT_TRUE(allocator.is_compact());
+    allocator.free(a, 10);
+    EXPECT_FALSE(allocator.is_compact());
+    allocator.reset(10);
+    EXPECT_TRUE(allocator.is_compact());
+    EXPECT_EQ(allocator.get_used(), 10u);
+    EXPECT_EQ(allocator.allocate(20), 10u);
+}
+
+#ifndef TEST_HEADLESS
+
+TEST_F(GeometryPoolTest, AllocationsShareVertexArray) {
+    BufferLayout layout = {{ShaderDataType::Float3, "a_Position"}};
+    GeometryPool pool(layout, 64, 128);
+    std::vector<float> vertices(3 * 4, 1.0f);
+    std::vector<unsigned int> indices = {0, 1, 2, 2, 3, 0};
+    auto first = pool.allocate(vertices.data(), 4, indices.data(), 6);
+    auto second = pool.allocate(vertices.data(), 4, indices.data(), 6);
+    ASSERT_NE(first, nullptr);
+    ASSERT_NE(second, nullptr);
+    EXPECT_EQ(first->get_vertex_array(), second->get_vertex_array());
+    EXPECT_EQ(first->get_base_vertex(), 0u);
+    EXPECT_EQ(second->get_base_vertex(), 4u);
+    EXPECT_EQ(second->get_first_index(), 6u);
+    EXPECT_EQ(pool.get_page_count(), 1u);
+}
+
+TEST_F(GeometryPoolTest, FullPageCreatesNewPage) {
+    BufferLayout layout = {{ShaderDataType::Float3, "a_Position"}};
+    GeometryPool pool(layout, 4, 6);
+    std::vector<float> vertices(3 * 4, 0.0f);
+    std::vector<unsigned int> indices = {0, 1, 2, 2, 3, 0};
+    auto first = pool.allocate(vertices.data(), 4, indices.data(), 6);
+    auto second = pool.allocate(vertices.data(), 4, indices.data(), 6);
+    EXPECT_EQ(pool.get_page_count(), 2u);
+    EXPECT_NE(first->get_page(), second->get_page());
+}
+
+TEST_F(GeometryPoolTest, ReleasingAllocationFreesRange) {
+    BufferLayout layout = {{ShaderDataType::Float3, "a_Position"}};
+    GeometryPool pool(layout, 64, 128);
+    std::vector<float> vertices(3 * 4, 0.0f);
+    std::vector<unsigned int> indices = {0, 1, 2, 2, 3, 0};
+    auto allocation = pool.allocate(vertices.data(), 4, indices.data(), 6);
+    auto page = allocation->get_page();
+    EXPECT_EQ(page->get_vertex_allocator().get_used(), 4u);
+    allocation.reset();
+    EXPECT_EQ(page->get_vertex_allocator().get_used(), 0u);
+    EXPECT_EQ(page->get_index_allocator().get_used(), 0u);
+    EXPECT_EQ(page->get_allocation_count(), 0u);
+}
+
+TEST_F(GeometryPoolTest, DefragmentCompactsAndPreservesData) {
+    BufferLayout layout = {{ShaderDataType::Float, "a_Value"}};
+    GeometryPool pool(layout, 64, 64);
+    std::vector<float> a_data = {1.0f, 1.0f, 1.0f};
+    std::vector<float> b_data = {2.0f, 2.0f, 2.0f};
+    std::vector<float> c_data = {3.0f, 3.0f, 3.0f};
+    std::vector<unsigned int> indices = {0, 1, 2};
+    auto a = pool.allocate(a_data.data(), 3, indices.data(), 3);
+    auto b = pool.allocate(b_data.data(), 3, indices.data(), 3);
+    auto c = pool.allocate(c_data.data(), 3, indices.data(), 3);
+    b.reset();
+    auto page = a->get_page();
+    EXPECT_FALSE(page->get_vertex_allocator().is_compact());
+
+    pool.defragment();
+    EXPECT_TRUE(page->get_vertex_allocator().is_compact());
+    EXPECT_TRUE(page->get_index_allocator().is_compact());
+    EXPECT_EQ(a->get_base_vertex(), 0u);
+    EXPECT_EQ(c->get_base_vertex(), 3u);
+    EXPECT_EQ(c->get_first_index(), 3u);
+
+    std::vector<float> readback(6, 0.0f);
+    glBindBuffer(GL_COPY_READ_BUFFER, page->get_vertex_buffer()->get_id());
+    glGetBufferSubData(GL_COPY_READ_BUFFER, 0, readback.size() * sizeof(float), readback.data());
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    EXPECT_FLOAT_EQ(readback[0], 1.0f);
+    EXPECT_FLOAT_EQ(readback[3], 3.0f);
+    EXPECT_FLOAT_EQ(readback[5], 3.0f);
+}
+
+TEST_F(GeometryPoolTest, DefragmentDropsEmptyPages) {
+    BufferLayout layout = {{ShaderDataType::Float3, "a_Position"}};
+    GeometryPool pool(layout, 4, 6);
+    std::vector<float> vertices(3 * 4, 0.0f);
+    std::vector<unsigned int> indices = {0, 1, 2, 2, 3, 0};
+    auto first = pool.allocate(vertices.data(), 4, indices.data(), 6);
+    auto second = pool.allocate(vertices.data(), 4, indices.data(), 6);
+    ASSERT_EQ(pool.get_page_count(), 2u);
+    second.reset();
+    pool.defragment();
+    EXPECT_EQ(pool.get_page_count(), 1u);
+}
+
+TEST_F(GeometryPoolTest, PooledMeshesShareVertexArray) {
+    const char *vert = R"(
+#version 410 core
+layout(location = 0) in vec3 a_Position;
+void main() { gl_Position = vec4(a_Position, 1.0); }
+    )";
+    const char *frag = R"(
+#version 410 core
+out vec4 FragColor;
+void main() { FragColor = vec4(1.0); }
+    )";
+    auto shader = std::make_shared<Shader>(vert, frag);
+    auto pool = std::make_shared<GeometryPool>(scene::Mesh::get_vertex_layout());
+    std::vector<scene::Vertex> vertices = {
+        {glm::vec3(0.0f)}, {glm::vec3(1.0f, 0.0f, 0.0f)}, {glm::vec3(0.0f, 1.0f, 0.0f)}};
+    std::vector<unsigned int> indices = {0, 1, 2};
+    auto first = std::make_shared<scene::Mesh>(vertices, indices, shader, pool);
+    auto second = std::make_shared<scene::Mesh>(vertices, indices, shader, pool);
+    EXPECT_TRUE(first->is_pooled());
+    EXPECT_EQ(first->get_vertex_array(), second->get_vertex_array());
+    EXPECT_EQ(second->get_allocation()->get_base_vertex(), 3u);
+
+    first->bind();
+    first->render();
+    second->render();
+    first->unbind();
+    EXPECT_EQ(glGetError(), static_cast<GLenum>(GL_NO_ERROR));
+}
+
+TEST_F(GeometryPoolTest, MismatchedPoolFallsBackToDedicatedBuffers) {
+    const char *vert = R"(
+#version 410 core
+layout(location = 0) in vec3 a_Position;
+void main() { gl_Position = vec4(a_Position, 1.0); }
+    )";
+    const char *frag = R"(
+#version 410 core
+out vec4 FragColor;
+void main() { FragColor = vec4(1.0); }
+    )";
+    auto shader = std::make_shared<Shader>(vert, frag);
+    auto pool = std::make_shared<GeometryPool>(BufferLayout{{ShaderDataType::Float3, "a_Position"}});
+    std::vector<scene::Vertex> vertices(3);
+    std::vector<unsigned int> indices = {0, 1, 2};
+    scene::Mesh mesh(vertices, indices, shader, pool);
+    EXPECT_FALSE(mesh.is_pooled());
+    EXPECT_NE(mesh.get_vertex_array(), nullptr);
+}
+
+#endif
+
+} // namespace renderer
+
+} // namespace lmgl
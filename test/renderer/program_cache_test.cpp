@@ -0,0 +1,174 @@
+#include "lmgl/renderer/program_cache.hpp"
+#include "lmgl/renderer/shader.hpp"
+#include <gtest/gtest.h>
+
+#ifndef TEST_HEADLESS
+#include "lmgl/core/engine.hpp"
+#endif
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+namespace lmgl {
+
+namespace renderer {
+
+static const std::string VERTEX = R"(
+#version 410 core
+layout(location = 0) in vec3 a_Position;
+uniform mat4 u_Transform;
+void main() {
+    gl_Position = u_Transform * vec4(a_Position, 1.0);
+}
+)";
+
+static const std::string FRAGMENT = R"(
+#version 410 core
+uniform vec4 u_Color;
+out vec4 FragColor;
+void main() {
+    FragColor = u_Color;
+}
+)";
+
+class ProgramCacheTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+#ifndef TEST_HEADLESS
+        auto &engine = core::Engine::get_instance();
+        if (!engine.get_window())
+            engine.init(800, 600, "Program Cache Test");
+#endif
+        m_previous = ProgramCache::get_directory();
+        m_directory = std::filesystem::temp_directory_path() / "lmgl_program_cache_test";
+        std::filesystem::remove_all(m_directory);
+        ProgramCache::set_directory(m_directory.string());
+        ProgramCache::reset_stats();
+    }
+
+    void TearDown() override {
+        ProgramCache::set_directory(m_previous);
+        std::filesystem::remove_all(m_directory);
+    }
+
+    std::string m_previous;
+    std::filesystem::path m_directory;
+};
+
+TEST_F(ProgramCacheTest, KeyDependsOnEverySource) {
+    uint64_t key = ProgramCache::make_key({VERTEX, FRAGMENT});
+    EXPECT_EQ(key, ProgramCache::make_key({VERTEX, FRAGMENT}));
+    EXPECT_NE(key, ProgramCache::make_key({VERTEX, FRAGMENT + " "}));
+    EXPECT_NE(key, ProgramCache::make_key({FRAGMENT, VERTEX}));
+    EXPECT_NE(ProgramCache::make_key({"ab", "c"}), ProgramCache::make_key({"a", "bc"}));
+    EXPECT_EQ(std::filesystem::path(ProgramCache::get_cache_path(key)).parent_path(), m_directory);
+}
+
+TEST_F(ProgramCacheTest, MissingFileLoadsNothing) {
+    EXPECT_EQ(ProgramCache::load(ProgramCache::make_key({VERTEX, FRAGMENT})), 0u);
+    EXPECT_EQ(ProgramCache::get_stats().rejected, 0u);
+}
+
+#ifndef TEST_HEADLESS
+
+TEST_F(ProgramCacheTest, SecondBuildLoadsTheBinary) {
+    if (!ProgramCache::is_enabled())
+        GTEST_SKIP() << "The driver supports no program binary format";
+    uint64_t key = ProgramCache::make_key({VERTEX, FRAGMENT});
+    {
+        Shader shader(VERTEX, FRAGMENT);
+        ASSERT_NE(shader.get_id(), 0u);
+    }
+    EXPECT_EQ(ProgramCache::get_stats().misses, 1u);
+    EXPECT_EQ(ProgramCache::get_stats().hits, 0u);
+    EXPECT_TRUE(std::filesystem::exists(ProgramCache::get_cache_path(key)));
+
+    Shader shader(VERTEX, FRAGMENT);
+    ASSERT_NE(shader.get_id(), 0u);
+    EXPECT_EQ(ProgramCache::get_stats().hits, 1u);
+    EXPECT_EQ(ProgramCache::get_stats().misses, 1u);
+    // The loaded program behaves like the linked one
+    EXPECT_TRUE(shader.has_uniform("u_Color"));
+    EXPECT_TRUE(shader.has_uniform("u_Transform"));
+    EXPECT_EQ(shader.get_attribute_location("a_Position"), 0);
+    shader.bind();
+    shader.set_vec4("u_Color", glm::vec4(1.0f));
+    shader.unbind();
+
+    // Both paths were timed; the numbers go to the test report rather than the console
+    const ProgramCacheStats &stats = ProgramCache::get_stats();
+    EXPECT_GT(stats.compile_ms, 0.0);
+    EXPECT_GT(stats.load_ms, 0.0);
+    RecordProperty("compile_ms", std::to_string(stats.compile_ms));
+    RecordProperty("load_ms", std::to_string(stats.load_ms));
+}
+
+// Reads a cache file, lets the test edit it and writes it back
+template <typename Edit> static void rewrite(const std::string &cache_path, Edit edit) {
+    std::ifstream input(cache_path, std::ios::binary);
+    std::string contents((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+    input.close();
+    edit(contents);
+    std::ofstream(cache_path, std::ios::binary | std::ios::trunc) << contents;
+}
+
+TEST_F(ProgramCacheTest, CorruptedFileIsCompiledAgain) {
+    if (!ProgramCache::is_enabled())
+        GTEST_SKIP() << "The driver supports no program binary format";
+    std::string cache_path = ProgramCache::get_cache_path(ProgramCache::make_key({VERTEX, FRAGMENT}));
+    { Shader shader(VERTEX, FRAGMENT); }
+    rewrite(cache_path, [](std::string &contents) { contents.back() ^= 0x5a; });
+
+    Shader shader(VERTEX, FRAGMENT);
+    EXPECT_NE(shader.get_id(), 0u);
+    EXPECT_EQ(ProgramCache::get_stats().rejected, 1u);
+    EXPECT_EQ(ProgramCache::get_stats().misses, 2u);
+    // Rebuilding wrote a good file back
+    EXPECT_TRUE(std::filesystem::exists(cache_path));
+    Shader cached(VERTEX, FRAGMENT);
+    EXPECT_EQ(ProgramCache::get_stats().hits, 1u);
+}
+
+TEST_F(ProgramCacheTest, BinaryRejectedByTheDriverIsCompiledAgain) {
+    if (!ProgramCache::is_enabled())
+        GTEST_SKIP() << "The driver supports no program binary format";
+    std::string cache_path = ProgramCache::get_cache_path(ProgramCache::make_key({VERTEX, FRAGMENT}));
+    { Shader shader(VERTEX, FRAGMENT); }
+    // An intact file in a format the driver does not know, as an update could leave behind
+    rewrite(cache_path, [](std::string &contents) {
+        uint32_t format = 0xdeadbeef;
+        std::memcpy(&contents[16], &format, sizeof(format));
+    });
+
+    Shader shader(VERTEX, FRAGMENT);
+    EXPECT_NE(shader.get_id(), 0u);
+    EXPECT_TRUE(shader.has_uniform("u_Color"));
+    EXPECT_EQ(ProgramCache::get_stats().rejected, 1u);
+}
+
+TEST_F(ProgramCacheTest, DisabledCacheWritesNothing) {
+    ProgramCache::set_directory("");
+    EXPECT_FALSE(ProgramCache::is_enabled());
+    Shader shader(VERTEX, FRAGMENT);
+    EXPECT_NE(shader.get_id(), 0u);
+    Shader again(VERTEX, FRAGMENT);
+    EXPECT_EQ(ProgramCache::get_stats().misses, 2u);
+    EXPECT_EQ(ProgramCache::get_stats().hits, 0u);
+    EXPECT_FALSE(std::filesystem::exists(m_directory));
+}
+
+TEST_F(ProgramCacheTest, FailedBuildIsNotStored) {
+    Shader shader(VERTEX, "#version 410 core\nvoid main() { broken }\n");
+    EXPECT_EQ(shader.get_id(), 0u);
+    EXPECT_FALSE(std::filesystem::exists(m_directory) && !std::filesystem::is_empty(m_directory));
+}
+
+#endif
+
+} // namespace renderer
+
+} // namespace lmgl
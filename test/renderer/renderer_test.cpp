@@ -3,13 +3,25 @@
 #ifndef TEST_HEADLESS
 
 #include "lmgl/core/engine.hpp"
+#include "lmgl/renderer/capabilities.hpp"
+#include "lmgl/renderer/geometry_pool.hpp"
+#include "lmgl/renderer/program_cache.hpp"
 #include "lmgl/renderer/renderer.hpp"
 #include "lmgl/renderer/shader.hpp"
+#include "lmgl/renderer/texture_streamer.hpp"
 #include "lmgl/scene/camera.hpp"
+#include "lmgl/scene/material.hpp"
 #include "lmgl/scene/mesh.hpp"
 #include "lmgl/scene/node.hpp"
 #include "lmgl/scene/scene.hpp"
 
+#include <glad/glad.h>
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <thread>
+
 namespace lmgl {
 
 namespace renderer {
@@ -344,6 +356,48 @@ TEST_F(RendererTest, MaterialCachingClearsBetweenFrames) {
     EXPECT_EQ(renderer->get_draw_calls(), 1);
 }
 
+TEST_F(RendererTest, MaterialCachingRebindsForEachShader) {
+    const char *vert = R"(
+#version 410 core
+layout(location = 0) in vec3 a_Position;
+uniform mat4 u_MVP;
+void main() { gl_Position = u_MVP * vec4(a_Position, 1.0); }
+    )";
+    const char *frag = R"(
+#version 410 core
+struct Material { vec3 albedo; };
+uniform Material u_Material;
+out vec4 FragColor;
+void main() { FragColor = vec4(u_Material.albedo, 1.0); }
+    )";
+    // Two programs, as when a variant becomes ready mid-frame, drawing the same material
+    std::vector<std::shared_ptr<Shader>> shaders = {std::make_shared<Shader>(vert, frag),
+                                                    std::make_shared<Shader>(vert, frag)};
+    auto material = std::make_shared<scene::Material>("Shared");
+    material->set_albedo(glm::vec3(0.25f, 0.5f, 0.75f));
+    for (int i = 0; i < 4; ++i) {
+        auto mesh = scene::Mesh::create_cube(shaders[i % 2]);
+        mesh->set_material(material);
+        auto node = std::make_shared<scene::Node>("Cube" + std::to_string(i));
+        node->set_mesh(mesh);
+        node->set_position(glm::vec3(float(i * 2), 0.0f, 0.0f));
+        scene->get_root()->add_child(node);
+    }
+    camera->set_position(glm::vec3(3.0f, 0.0f, 15.0f));
+    renderer->render(scene, camera);
+    EXPECT_EQ(renderer->get_draw_calls(), 4);
+
+    // Both programs got the material uniforms
+    for (const auto &shader : shaders) {
+        GLfloat albedo[3] = {0.0f, 0.0f, 0.0f};
+        GLint location = glGetUniformLocation(shader->get_id(), "u_Material.albedo");
+        ASSERT_GE(location, 0);
+        glGetUniformfv(shader->get_id(), location, albedo);
+        EXPECT_FLOAT_EQ(albedo[0], 0.25f);
+        EXPECT_FLOAT_EQ(albedo[2], 0.75f);
+    }
+}
+
 TEST_F(RendererTest, MaterialCachingSortsByMaterial) {
     auto shader = Shader::from_glsl_file("basic.glsl");
     
@@ -402,6 +456,438 @@ TEST_F(RendererTest, MaterialCachingHandlesMaterialChangeBetweenFrames) {
     EXPECT_EQ(renderer->get_draw_calls(), 1);
 }
 
+static std::shared_ptr<Shader> create_instance_transform_shader() {
+    const char *vert = R"(
+#version 410 core
+layout(location = 0) in vec3 a_Position;
+layout(location = 6) in mat4 a_InstanceModel;
+uniform mat4 u_MVP;
+uniform mat4 u_ViewProjection;
+uniform int u_UseInstanceTransform;
+void main() {
+    if (u_UseInstanceTransform == 1)
+        gl_Position = u_ViewProjection * a_InstanceModel * vec4(a_Position, 1.0);
+    else
+        gl_Position = u_MVP * vec4(a_Position, 1.0);
+}
+    )";
+    const char *frag = R"(
+#version 410 core
+out vec4 FragColor;
+void main() { FragColor = vec4(1.0); }
+    )";
+    return std::make_shared<Shader>(vert, frag);
+}
+
+static void add_pooled_cubes(std::shared_ptr<scene::Scene> scene, std::shared_ptr<Shader> shader,
+                             std::shared_ptr<GeometryPool> pool, int count) {
+    auto cube = scene::Mesh::create_cube(shader);
+    for (int i = 0; i < count; ++i) {
+        auto mesh = std::make_shared<scene::Mesh>(cube->get_vertices(), cube->get_indices(), shader, pool);
+        auto node = std::make_shared<scene::Node>("PooledCube" + std::to_string(i));
+        node->set_mesh(mesh);
+        node->set_position(glm::vec3(i * 2.0f, 0.0f, 0.0f));
+        scene->get_root()->add_child(node);
+    }
+}
+
+TEST_F(RendererTest, MultiDrawIndirectCollapsesPooledDraws) {
+    if (!Capabilities::get_instance().has_multi_draw_indirect())
+        GTEST_SKIP() << "Context does not support multi-draw indirect";
+    auto shader = create_instance_transform_shader();
+    auto pool = std::make_shared<GeometryPool>(scene::Mesh::get_vertex_layout());
+    add_pooled_cubes(scene, shader, pool, 5);
+    camera->set_position(glm::vec3(5.0f, 0.0f, 15.0f));
+    EXPECT_TRUE(renderer->is_multi_draw_indirect_active());
+    while (glGetError() != GL_NO_ERROR) {
+    }
+    renderer->render(scene, camera);
+    EXPECT_EQ(renderer->get_draw_calls(), 1);
+    EXPECT_EQ(renderer->get_triangles_count(), 5 * 12);
+    EXPECT_EQ(glGetError(), static_cast<GLenum>(GL_NO_ERROR));
+}
+
+TEST_F(RendererTest, MultiDrawIndirectMatchesPerMeshOutput) {
+    if (!Capabilities::get_instance().has_multi_draw_indirect())
+        GTEST_SKIP() << "Context does not support multi-draw indirect";
+    auto shader = create_instance_transform_shader();
+    auto pool = std::make_shared<GeometryPool>(scene::Mesh::get_vertex_layout());
+    add_pooled_cubes(scene, shader, pool, 5);
+    camera->set_position(glm::vec3(5.0f, 0.0f, 15.0f));
+    std::vector<unsigned char> indirect(64 * 64 * 4), direct(64 * 64 * 4);
+    renderer->render(scene, camera);
+    glReadPixels(0, 0, 64, 64, GL_RGBA, GL_UNSIGNED_BYTE, indirect.data());
+    renderer->set_multi_draw_indirect(false);
+    renderer->render(scene, camera);
+    glReadPixels(0, 0, 64, 64, GL_RGBA, GL_UNSIGNED_BYTE, direct.data());
+    EXPECT_EQ(indirect, direct);
+}
+
+TEST_F(RendererTest, MultiDrawIndirectFallsBackWhenDisabled) {
+    auto shader = create_instance_transform_shader();
+    auto pool = std::make_shared<GeometryPool>(scene::Mesh::get_vertex_layout());
+    add_pooled_cubes(scene, shader, pool, 5);
+    camera->set_position(glm::vec3(5.0f, 0.0f, 15.0f));
+    renderer->set_multi_draw_indirect(false);
+    EXPECT_FALSE(renderer->is_multi_draw_indirect_active());
+    renderer->render(scene, camera);
+    EXPECT_EQ(renderer->get_draw_calls(), 5);
+    EXPECT_EQ(renderer->get_triangles_count(), 5 * 12);
+}
+
+TEST_F(RendererTest, MultiDrawIndirectSkipsShadersWithoutInstanceTransform) {
+    const char *vert = R"(
+#version 410 core
+layout(location = 0) in vec3 a_Position;
+uniform mat4 u_MVP;
+void main() { gl_Position = u_MVP * vec4(a_Position, 1.0); }
+    )";
+    const char *frag = R"(
+#version 410 core
+out vec4 FragColor;
+void main() { FragColor = vec4(1.0); }
+    )";
+    auto shader = std::make_shared<Shader>(vert, frag);
+    auto pool = std::make_shared<GeometryPool>(scene::Mesh::get_vertex_layout());
+    add_pooled_cubes(scene, shader, pool, 3);
+    camera->set_position(glm::vec3(5.0f, 0.0f, 15.0f));
+    renderer->render(scene, camera);
+    EXPECT_EQ(renderer->get_draw_calls(), 3);
+}
+
+TEST_F(RendererTest, PendingShadersUseTheFallback) {
+    const char *vert = R"(
+#version 410 core
+layout(location = 0) in vec3 a_Position;
+uniform mat4 u_MVP;
+void main() { gl_Position = u_MVP * vec4(a_Position, 1.0); }
+    )";
+    const char *frag = R"(
+#version 410 core
+out vec4 FragColor;
+void main() { FragColor = vec4(1.0); }
+    )";
+    std::string directory = ProgramCache::get_directory();
+    ProgramCache::set_directory("");
+    auto pending = Shader::compile_async(vert, frag);
+    ProgramCache::set_directory(directory);
+    auto fallback = std::make_shared<Shader>(vert, frag);
+    auto pool = std::make_shared<GeometryPool>(scene::Mesh::get_vertex_layout());
+    add_pooled_cubes(scene, pending, pool, 3);
+    camera->set_position(glm::vec3(5.0f, 0.0f, 15.0f));
+
+    // Whether the driver is done by now is up to it, every cube is drawn either way
+    renderer->set_fallback_shader(fallback);
+    renderer->render(scene, camera);
+    EXPECT_EQ(renderer->get_draw_calls(), 3);
+    EXPECT_EQ(renderer->get_triangles_count(), 3 * 12);
+    if (renderer->get_pending_shader_count() > 0) {
+        EXPECT_EQ(renderer->get_pending_shader_count(), 3);
+        renderer->set_fallback_shader(nullptr);
+        renderer->render(scene, camera);
+        if (renderer->get_pending_shader_count() > 0)
+            EXPECT_EQ(renderer->get_draw_calls(), 0);
+    }
+
+    pending->wait();
+    renderer->render(scene, camera);
+    EXPECT_EQ(renderer->get_pending_shader_count(), 0);
+    EXPECT_EQ(renderer->get_draw_calls(), 3);
+}
+
+TEST_F(RendererTest, FailedShadersAreNotPending) {
+    auto broken = Shader::compile_async("#version 410 core\nvoid main() { broken }\n",
+                                        "#version 410 core\nout vec4 c;\nvoid main() { c = vec4(1.0); }\n");
+    EXPECT_EQ(broken->wait(), Shader::State::Failed);
+    auto node = std::make_shared<scene::Node>("Cube");
+    node->set_mesh(scene::Mesh::create_cube(broken));
+    scene->get_root()->add_child(node);
+    camera->set_position(glm::vec3(0.0f, 0.0f, 5.0f));
+    renderer->render(scene, camera);
+    EXPECT_EQ(renderer->get_pending_shader_count(), 0);
+}
+
+TEST_F(RendererTest, VariantShadersFollowTheMaterial) {
+    std::ofstream("renderer_variant_test.glsl") << R"(#shader vertex
+#version 410 core
+layout(location = 0) in vec3 a_Position;
+uniform mat4 u_MVP;
+void main() { gl_Position = u_MVP * vec4(a_Position, 1.0); }
+#shader fragment
+#version 410 core
+out vec4 FragColor;
+#ifdef FEATURE_ALBEDO_MAP
+uniform sampler2D u_AlbedoMap;
+void main() { FragColor = texture(u_AlbedoMap, vec2(0.5)); }
+#else
+void main() { FragColor = vec4(1.0); }
+#endif
+)";
+    auto shader = Shader::from_glsl_file_with_variants("renderer_variant_test.glsl");
+    std::remove("renderer_variant_test.glsl");
+    ASSERT_NE(shader, nullptr);
+    auto textured = std::make_shared<scene::Material>("Textured");
+    textured->set_albedo_map(std::make_shared<Texture>(4, 4));
+    EXPECT_EQ(textured->get_features(), static_cast<uint32_t>(Shader::AlbedoMap));
+    for (int i = 0; i < 4; ++i) {
+        auto mesh = scene::Mesh::create_cube(shader);
+        if (i % 2 == 0)
+            mesh->set_material(textured);
+        auto node = std::make_shared<scene::Node>("Cube");
+        node->set_mesh(mesh);
+        node->set_position(glm::vec3(static_cast<float>(i) * 2.0f, 0.0f, 0.0f));
+        scene->get_root()->add_child(node);
+    }
+    camera->set_position(glm::vec3(3.0f, 0.0f, 15.0f));
+
+    // The uber-shader draws every cube while the two variants compile
+    for (int i = 0; i < 5000 && !(shader->get_variant(Shader::AlbedoMap) && shader->get_variant(0)); ++i) {
+        renderer->render(scene, camera);
+        EXPECT_EQ(renderer->get_draw_calls(), 4);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    renderer->render(scene, camera);
+    EXPECT_EQ(renderer->get_draw_calls(), 4);
+    EXPECT_EQ(renderer->get_pending_shader_count(), 0);
+    // Without shadows or a skybox, the scene adds no features
+    EXPECT_EQ(shader->get_variant_count(), 2u);
+    EXPECT_NE(shader->get_variant(Shader::AlbedoMap), nullptr);
+    EXPECT_NE(shader->get_variant(0), nullptr);
+}
+
+TEST_F(RendererTest, DirectionalShadowsUseCameraCascades) {
+    auto shader = Shader::from_glsl_file("shaders/pbr.glsl");
+    ASSERT_NE(shader, nullptr);
+    scene->set_shadows_enabled(true);
+    scene->set_shadow_resolution(256);
+    auto sun = scene::Light::create_directional(glm::vec3(0.3f, -1.0f, 0.2f));
+    sun->set_casts_shadows(true);
+    scene->add_light(sun);
+    auto node = std::make_shared<scene::Node>("Cube");
+    node->set_mesh(scene::Mesh::create_cube(shader));
+    scene->get_root()->add_child(node);
+    camera->set_position(glm::vec3(0.0f, 2.0f, 8.0f));
+
+    while (glGetError() != GL_NO_ERROR) {
+    }
+    renderer->setup_shadows(scene, shader, camera);
+    EXPECT_EQ(glGetError(), static_cast<GLenum>(GL_NO_ERROR));
+    auto shadow_map = renderer->get_cascaded_shadow_map();
+    ASSERT_NE(shadow_map, nullptr);
+    EXPECT_EQ(shadow_map->get_cascade_count(), 3u);
+    EXPECT_EQ(shadow_map->get_active_cascade_count(), 3u);
+    EXPECT_GT(renderer->get_shadow_renderer().get_directional_stats().casters, 0u);
+    renderer->render(scene, camera);
+    EXPECT_EQ(renderer->get_draw_calls(), 1);
+
+    // Changing the count builds a new array texture
+    renderer->set_shadow_cascades(2);
+    renderer->setup_shadows(scene, shader, camera);
+    EXPECT_NE(renderer->get_cascaded_shadow_map(), shadow_map);
+    EXPECT_EQ(renderer->get_cascaded_shadow_map()->get_active_cascade_count(), 2u);
+    // Without a camera a single cascade covers a fixed box
+    renderer->setup_shadows(scene, shader);
+    EXPECT_EQ(renderer->get_cascaded_shadow_map()->get_active_cascade_count(), 1u);
+}
+
+TEST_F(RendererTest, ShadowedSpotAndPointLightsShareTheAtlas) {
+    auto shader = Shader::from_glsl_file("shaders/pbr.glsl");
+    ASSERT_NE(shader, nullptr);
+    scene->set_shadows_enabled(true);
+    // Lights not casting shadows get no tile
+    scene->add_light(scene::Light::create_point(glm::vec3(0.0f, 4.0f, 0.0f)));
+    for (int i = 0; i < 4; ++i) {
+        auto point = scene::Light::create_point(glm::vec3(static_cast<float>(i) * 3.0f, 3.0f, 0.0f), 5.0f);
+        point->set_casts_shadows(true);
+        scene->add_light(point);
+    }
+    // Spot lights beyond the eight the shader binds are not shadowed either
+    for (int i = 0; i < 10; ++i) {
+        auto spot = scene::Light::create_spot(glm::vec3(static_cast<float>(i) * 2.0f, 4.0f, -10.0f * i),
+                                              glm::vec3(0.0f, -1.0f, 0.0f), 30.0f);
+        spot->set_casts_shadows(true);
+        scene->add_light(spot);
+    }
+    auto node = std::make_shared<scene::Node>("Cube");
+    node->set_mesh(scene::Mesh::create_cube(shader));
+    scene->get_root()->add_child(node);
+    camera->set_position(glm::vec3(0.0f, 2.0f, 8.0f));
+
+    renderer->setup_shadows(scene, shader, camera);
+    auto atlas = renderer->get_shadow_atlas();
+    ASSERT_NE(atlas, nullptr);
+    EXPECT_EQ(atlas->get_size(), 4096u);
+    EXPECT_EQ(atlas->get_tile_count(), 4u * 6u + 8u);
+    EXPECT_EQ(atlas->get_first_tile(0), -1);
+    // Far lights cover less of the screen and get smaller tiles
+    unsigned int near_spot = static_cast<unsigned int>(atlas->get_first_tile(5));
+    unsigned int far_spot = static_cast<unsigned int>(atlas->get_first_tile(12));
+    EXPECT_GT(atlas->get_tile(near_spot).size, atlas->get_tile(far_spot).size);
+    EXPECT_GT(renderer->get_shadow_renderer().get_atlas_stats().updated_slices, 0u);
+    renderer->render(scene, camera);
+    EXPECT_EQ(renderer->get_draw_calls(), 1);
+
+    // The rect and matrix arrays follow the point lights, then the spot lights, of the atlas
+    auto get_uniform = [&](const char *name, float *values) {
+        glGetUniformfv(shader->get_id(), glGetUniformLocation(shader->get_id(), name), values);
+    };
+    glm::vec4 rect;
+    get_uniform("u_PointShadowRects[0]", &rect[0]);
+    EXPECT_EQ(rect, glm::vec4(0.0f));
+    get_uniform("u_PointShadowRects[11]", &rect[0]);
+    EXPECT_EQ(rect, atlas->get_tile_rect(static_cast<unsigned int>(atlas->get_first_tile(1)) + 5));
+    get_uniform("u_SpotShadowRects[7]", &rect[0]);
+    EXPECT_EQ(rect, atlas->get_tile_rect(far_spot));
+    glm::mat4 matrix;
+    get_uniform("u_SpotShadowMatrices[0]", &matrix[0][0]);
+    EXPECT_EQ(matrix, atlas->get_tile(near_spot).light_space_matrix);
+
+    // Scene uniforms are bound again on the next frame
+    shader->bind();
+    shader->set_int("u_UsePointShadow", 0);
+    renderer->render(scene, camera);
+    GLint use_point_shadow = 0;
+    glGetUniformiv(shader->get_id(), glGetUniformLocation(shader->get_id(), "u_UsePointShadow"), &use_point_shadow);
+    EXPECT_EQ(use_point_shadow, 1);
+
+    renderer->set_shadow_atlas_size(1024);
+    renderer->setup_shadows(scene, shader, camera);
+    ASSERT_NE(renderer->get_shadow_atlas(), atlas);
+    EXPECT_EQ(renderer->get_shadow_atlas()->get_size(), 1024u);
+    // Without shadowed lights the atlas is released
+    renderer->setup_shadows(scene, shader, camera, false);
+    EXPECT_EQ(renderer->get_shadow_atlas(), nullptr);
+}
+
+// Large flat grid facing +Z, only a small part of it is visible from the test cameras
+static std::shared_ptr<scene::Mesh> create_grid_mesh(std::shared_ptr<Shader> shader,
+                                                     std::shared_ptr<GeometryPool> pool = nullptr) {
+    const unsigned int size = 60;
+    std::vector<scene::Vertex> vertices;
+    std::vector<unsigned int> indices;
+    for (unsigned int y = 0; y <= size; ++y) {
+        for (unsigned int x = 0; x <= size; ++x) {
+            scene::Vertex vertex;
+            vertex.position = glm::vec3(static_cast<float>(x) - 30.0f, static_cast<float>(y) - 30.0f, 0.0f);
+            vertex.normal = glm::vec3(0.0f, 0.0f, 1.0f);
+            vertices.push_back(vertex);
+        }
+    }
+    for (unsigned int y = 0; y < size; ++y) {
+        for (unsigned int x = 0; x < size; ++x) {
+            unsigned int i0 = y * (size + 1) + x;
+            unsigned int i2 = i0 + size + 1;
+            indices.insert(indices.end(), {i0, i0 + 1, i2, i0 + 1, i2 + 1, i2});
+        }
+    }
+    auto mesh = std::make_shared<scene::Mesh>(vertices, indices, shader, pool);
+    mesh->build_meshlets();
+    return mesh;
+}
+
+TEST_F(RendererTest, MeshletCullingSubmitsVisibleClusters) {
+    auto shader = create_instance_transform_shader();
+    auto node = std::make_shared<scene::Node>("Grid");
+    node->set_mesh(create_grid_mesh(shader));
+    scene->get_root()->add_child(node);
+    camera->set_position(glm::vec3(0.0f, 0.0f, 5.0f));
+    camera->set_target(glm::vec3(0.0f));
+    std::vector<unsigned char> culled(64 * 64 * 4), whole(64 * 64 * 4);
+
+    renderer->render(scene, camera);
+    glReadPixels(0, 0, 64, 64, GL_RGBA, GL_UNSIGNED_BYTE, culled.data());
+    unsigned int total = node->get_mesh()->get_index_count() / 3;
+    EXPECT_EQ(renderer->get_draw_calls(), 1);
+    EXPECT_GT(renderer->get_triangles_count(), 0u);
+    EXPECT_LT(renderer->get_triangles_count(), total / 2);
+    EXPECT_EQ(renderer->get_triangles_count() + renderer->get_culled_triangles_count(), total);
+
+    renderer->set_meshlet_culling(false);
+    renderer->render(scene, camera);
+    glReadPixels(0, 0, 64, 64, GL_RGBA, GL_UNSIGNED_BYTE, whole.data());
+    EXPECT_EQ(renderer->get_triangles_count(), total);
+    EXPECT_EQ(renderer->get_culled_triangles_count(), 0u);
+    EXPECT_EQ(culled, whole);
+
+    // From behind, every cluster faces away and nothing is submitted
+    renderer->set_meshlet_culling(true);
+    camera->set_position(glm::vec3(0.0f, 0.0f, -5.0f));
+    renderer->render(scene, camera);
+    EXPECT_EQ(renderer->get_draw_calls(), 0);
+}
+
+TEST_F(RendererTest, MeshletCullingInIndirectBatches) {
+    if (!Capabilities::get_instance().has_multi_draw_indirect())
+        GTEST_SKIP() << "Context does not support multi-draw indirect";
+    auto shader = create_instance_transform_shader();
+    auto pool = std::make_shared<GeometryPool>(scene::Mesh::get_vertex_layout());
+    for (int i = 0; i < 3; ++i) {
+        auto node = std::make_shared<scene::Node>("Grid" + std::to_string(i));
+        node->set_mesh(create_grid_mesh(shader, pool));
+        node->set_position(glm::vec3(0.0f, 0.0f, -2.0f * i));
+        scene->get_root()->add_child(node);
+    }
+    camera->set_position(glm::vec3(0.0f, 0.0f, 5.0f));
+    camera->set_target(glm::vec3(0.0f));
+    std::vector<unsigned char> indirect(64 * 64 * 4), direct(64 * 64 * 4);
+    while (glGetError() != GL_NO_ERROR) {
+    }
+    renderer->render(scene, camera);
+    glReadPixels(0, 0, 64, 64, GL_RGBA, GL_UNSIGNED_BYTE, indirect.data());
+    EXPECT_EQ(renderer->get_draw_calls(), 1);
+    unsigned int indirect_triangles = renderer->get_triangles_count();
+    EXPECT_GT(renderer->get_culled_triangles_count(), 0u);
+
+    renderer->set_multi_draw_indirect(false);
+    renderer->render(scene, camera);
+    glReadPixels(0, 0, 64, 64, GL_RGBA, GL_UNSIGNED_BYTE, direct.data());
+    EXPECT_EQ(renderer->get_draw_calls(), 3);
+    EXPECT_EQ(renderer->get_triangles_count(), indirect_triangles);
+    EXPECT_EQ(indirect, direct);
+    EXPECT_EQ(glGetError(), static_cast<GLenum>(GL_NO_ERROR));
+}
+
+TEST_F(RendererTest, StreamedTexturesFollowScreenSize) {
+    auto &streamer = TextureStreamer::get_instance();
+    ImageData image;
+    image.width = 1024;
+    image.height = 1024;
+    image.channels = 4;
+    image.pixels = std::shared_ptr<unsigned char>(new unsigned char[image.size()](),
+                                                  std::default_delete<unsigned char[]>());
+    auto texture = streamer.add("streamed_albedo", image);
+    ASSERT_NE(texture, nullptr);
+    // Levels up to 64x64 are resident from the start
+    ASSERT_EQ(texture->get_base_level(), 4);
+    auto shader = Shader::from_glsl_file("basic.glsl");
+    auto mesh = scene::Mesh::create_cube(shader);
+    auto material = std::make_shared<scene::Material>("StreamedMaterial");
+    material->set_albedo_map(texture);
+    mesh->set_material(material);
+    auto node = std::make_shared<scene::Node>("CubeNode");
+    node->set_mesh(mesh);
+    scene->get_root()->add_child(node);
+    camera->set_target(glm::vec3(0.0f));
+
+    // A few dozen pixels on screen need nothing finer
+    camera->set_position(glm::vec3(0.0f, 0.0f, 60.0f));
+    for (int frame = 0; frame < 4; ++frame) {
+        renderer->render(scene, camera);
+        streamer.update();
+    }
+    EXPECT_EQ(texture->get_base_level(), 4);
+
+    // Close up, finer levels stream in one per frame
+    camera->set_position(glm::vec3(0.0f, 0.0f, 3.0f));
+    for (int frame = 0; frame < 4; ++frame) {
+        renderer->render(scene, camera);
+        streamer.update();
+    }
+    EXPECT_LT(texture->get_base_level(), 4);
+    EXPECT_GT(streamer.get_memory_usage(), 64u * 64u * 4u);
+    streamer.clear();
+}
+
 } // namespace renderer
 
 } // namespace lmgl
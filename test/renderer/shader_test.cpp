@@ -4,9 +4,13 @@
 #ifndef TEST_HEADLESS
 #include "lmgl/core/engine.hpp"
 #endif
+#include "lmgl/renderer/program_cache.hpp"
 #include "lmgl/renderer/shader.hpp"
 
+#include <chrono>
+#include <filesystem>
 #include <fstream>
+#include <thread>
 
 namespace lmgl {
 
@@ -33,6 +37,41 @@ class ShaderTest : public ::testing::Test {
         remove("test_shader.glsl");
         remove("test_geom_shader.glsl");
         remove("test_invalid.glsl");
+        std::filesystem::remove_all("test_shader_includes");
+    }
+
+    // A fragment shader split over two includes, the second one included twice
+    void create_include_shaders() {
+        std::filesystem::create_directories("test_shader_includes/common");
+        std::ofstream("test_shader_includes/common/color.glsl") << R"(
+#include "../common/constant.glsl"
+#ifdef LMGL_VARIANT
+#define COLOR_SCALE 0.5
+#else
+uniform float u_Scale;
+#define COLOR_SCALE u_Scale
+#endif
+)";
+        std::ofstream("test_shader_includes/common/constant.glsl") << "const float BASE = 1.0;\n";
+        std::ofstream("test_shader_includes/feature.glsl") << R"(#shader vertex
+#version 410 core
+layout(location = 0) in vec3 a_Position;
+void main() {
+    gl_Position = vec4(a_Position, 1.0);
+}
+#shader fragment
+#version 410 core
+#include "common/color.glsl"
+#include "common/constant.glsl"
+out vec4 FragColor;
+void main() {
+#ifdef FEATURE_ALBEDO_MAP
+    FragColor = vec4(BASE * COLOR_SCALE);
+#else
+    FragColor = vec4(0.0);
+#endif
+}
+)";
     }
 
     void create_test_shaders() {
@@ -149,6 +188,38 @@ TEST_F(ShaderTest, ShaderLibraryStartsEmpty) {
     EXPECT_EQ(ShaderLibrary::get("any_shader"), nullptr);
 }
 
+TEST_F(ShaderTest, PreprocessorAddsDefinesAfterVersion) {
+    std::string src = Shader::preprocess("#version 410 core\nvoid main() {}\n", "", {"LMGL_VARIANT", "COUNT 4"});
+    EXPECT_EQ(src, "#version 410 core\n#define LMGL_VARIANT\n#define COUNT 4\nvoid main() {}\n");
+    EXPECT_EQ(Shader::preprocess("void main() {}\n", "", {"A"}), "#define A\nvoid main() {}\n");
+    EXPECT_EQ(Shader::preprocess("void main() {}\n", ""), "void main() {}\n");
+}
+
+TEST_F(ShaderTest, PreprocessorExpandsIncludesOnce) {
+    create_include_shaders();
+    std::string src = Shader::preprocess("#version 410 core\n#include \"common/color.glsl\"\n"
+                                         "  #include \"common/constant.glsl\"\nvoid main() {}\n",
+                                         "test_shader_includes");
+    EXPECT_EQ(src.find("#include"), std::string::npos);
+    size_t constant = src.find("const float BASE");
+    ASSERT_NE(constant, std::string::npos);
+    EXPECT_EQ(src.find("const float BASE", constant + 1), std::string::npos);
+    EXPECT_LT(constant, src.find("uniform float u_Scale"));
+    EXPECT_EQ(src.rfind("void main() {}"), src.size() - 15);
+}
+
+TEST_F(ShaderTest, PreprocessorDropsMissingIncludes) {
+    std::string src = Shader::preprocess("#include \"missing.glsl\"\n#include broken\nvoid main() {}\n", ".");
+    EXPECT_EQ(src, "void main() {}\n");
+}
+
+TEST_F(ShaderTest, FeatureDefines) {
+    EXPECT_STREQ(Shader::get_feature_define(Shader::AlbedoMap), "FEATURE_ALBEDO_MAP");
+    EXPECT_STREQ(Shader::get_feature_define(Shader::EnvironmentMap), "FEATURE_ENVIRONMENT_MAP");
+    EXPECT_EQ(Shader::ALL_FEATURES, (1u << Shader::FEATURE_COUNT) - 1);
+    EXPECT_EQ(Shader::EnvironmentMap, 1u << (Shader::FEATURE_COUNT - 1));
+}
+
 #ifndef TEST_HEADLESS
 
 TEST_F(ShaderTest, CreateFromSourceStrings) {
@@ -306,6 +377,34 @@ void main() {
     shader->set_int_array("u_IntArray", values, 4);
 }
 
+TEST_F(ShaderTest, SetVec4AndMat4ArrayUniforms) {
+    const char *vert = R"(
+#version 410 core
+layout(location = 0) in vec3 a_Position;
+uniform mat4 u_Matrices[2];
+void main() { gl_Position = u_Matrices[0] * u_Matrices[1] * vec4(a_Position, 1.0); }
+    )";
+    const char *frag = R"(
+#version 410 core
+uniform vec4 u_Colors[3];
+out vec4 FragColor;
+void main() { FragColor = u_Colors[0] + u_Colors[1] + u_Colors[2]; }
+    )";
+    auto shader = std::make_shared<Shader>(vert, frag);
+    shader->bind();
+
+    glm::vec4 colors[3] = {glm::vec4(1.0f), glm::vec4(2.0f), glm::vec4(3.0f)};
+    glm::mat4 matrices[2] = {glm::mat4(1.0f), glm::mat4(2.0f)};
+    shader->set_vec4_array("u_Colors", colors, 3);
+    shader->set_mat4_array("u_Matrices", matrices, 2);
+    glm::vec4 color;
+    glGetUniformfv(shader->get_id(), glGetUniformLocation(shader->get_id(), "u_Colors[2]"), &color[0]);
+    EXPECT_EQ(color, colors[2]);
+    glm::mat4 matrix;
+    glGetUniformfv(shader->get_id(), glGetUniformLocation(shader->get_id(), "u_Matrices[1]"), &matrix[0][0]);
+    EXPECT_EQ(matrix, matrices[1]);
+}
+
 TEST_F(ShaderTest, UniformLocationCaching) {
     auto shader = Shader::from_vf_files("test_shader.vert", "test_shader.frag");
     shader->bind();
@@ -326,8 +425,119 @@ TEST_F(ShaderTest, InvalidUniformName) {
     SUCCEED();
 }
 
+TEST_F(ShaderTest, MissingUniformIsCached) {
+    auto shader = Shader::from_vf_files("test_shader.vert", "test_shader.frag");
+    shader->bind();
+    while (glGetError() != GL_NO_ERROR) {
+    }
+    shader->set_float("u_NonExistentUniform", 1.0f);
+    EXPECT_FALSE(shader->has_uniform("u_NonExistentUniform"));
+    EXPECT_FALSE(shader->has_uniform("u_NonExistentUniform"));
+    EXPECT_TRUE(shader->has_uniform("u_Color"));
+    EXPECT_TRUE(shader->has_uniform("u_Color"));
+    // A cached -1 is a no-op for glUniform, like the first lookup
+    shader->set_float("u_NonExistentUniform", 1.0f);
+    EXPECT_EQ(glGetError(), static_cast<GLenum>(GL_NO_ERROR));
+}
+
+TEST_F(ShaderTest, LoadGLSLFileWithIncludesAndDefines) {
+    create_include_shaders();
+    auto shader = Shader::from_glsl_file("test_shader_includes/feature.glsl");
+    ASSERT_NE(shader, nullptr);
+    EXPECT_TRUE(shader->is_ready());
+    // Without FEATURE_ALBEDO_MAP the scale is unused
+    EXPECT_FALSE(shader->has_uniform("u_Scale"));
+
+    auto featured = Shader::from_glsl_file("test_shader_includes/feature.glsl", {"FEATURE_ALBEDO_MAP"});
+    ASSERT_NE(featured, nullptr);
+    EXPECT_TRUE(featured->is_ready());
+    EXPECT_TRUE(featured->has_uniform("u_Scale"));
+}
+
+TEST_F(ShaderTest, VariantsCompileOnDemand) {
+    create_include_shaders();
+    auto plain = Shader::from_glsl_file("test_shader_includes/feature.glsl");
+    EXPECT_FALSE(plain->has_variants());
+    EXPECT_EQ(plain->get_variant(Shader::AlbedoMap), nullptr);
+
+    auto shader = Shader::from_glsl_file_with_variants("test_shader_includes/feature.glsl",
+                                                       Shader::AlbedoMap | Shader::NormalMap);
+    ASSERT_NE(shader, nullptr);
+    EXPECT_TRUE(shader->has_variants());
+    EXPECT_EQ(shader->get_variant_features(), Shader::AlbedoMap | Shader::NormalMap);
+    EXPECT_EQ(shader->get_variant_count(), 0u);
+
+    // Bits outside the variant features pick the same variant
+    std::shared_ptr<Shader> variant;
+    for (int i = 0; i < 5000 && !variant; ++i) {
+        variant = shader->get_variant(Shader::AlbedoMap | Shader::DirectionalShadow);
+        if (!variant)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_NE(variant, nullptr);
+    EXPECT_EQ(shader->get_variant(Shader::AlbedoMap), variant);
+    EXPECT_EQ(shader->get_variant_count(), 1u);
+    EXPECT_FALSE(variant->has_variants());
+
+    // The variant resolved the scale at compile time, the uber-shader reads it
+    EXPECT_FALSE(variant->has_uniform("u_Scale"));
+    EXPECT_FALSE(shader->has_uniform("u_Scale"));
+    EXPECT_NE(variant->get_id(), shader->get_id());
+
+    // Every other mask is a variant of its own
+    shader->get_variant(0);
+    EXPECT_EQ(shader->get_variant_count(), 2u);
+}
+
+TEST_F(ShaderTest, PbrVariantsCompile) {
+    auto shader = Shader::from_glsl_file_with_variants("shaders/pbr.glsl");
+    if (!shader || !shader->is_ready())
+        GTEST_SKIP() << "shaders/pbr.glsl is not available";
+    EXPECT_TRUE(shader->has_uniform("u_UseDirectionalShadow"));
+    EXPECT_TRUE(shader->has_uniform("u_UseEnvironmentMap"));
+    uint32_t features = Shader::AlbedoMap | Shader::NormalMap | Shader::DirectionalShadow;
+    shader->get_variant(features);
+    shader->get_variant(0);
+    EXPECT_EQ(shader->get_variant_count(), 2u);
+    for (int i = 0; i < 10000 && !(shader->get_variant(features) && shader->get_variant(0)); ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    auto full = shader->get_variant(features);
+    auto bare = shader->get_variant(0);
+    ASSERT_NE(full, nullptr);
+    ASSERT_NE(bare, nullptr);
+    // Feature flags are compiled out, and so are the maps a variant does not sample. Drivers
+    // may keep every member of a used struct active, so only plain uniforms are checked.
+    EXPECT_FALSE(full->has_uniform("u_UseDirectionalShadow"));
+    EXPECT_FALSE(full->has_uniform("u_UseEnvironmentMap"));
+    EXPECT_TRUE(full->has_uniform("u_ShadowMap"));
+    EXPECT_FALSE(full->has_uniform("u_EnvironmentMap"));
+    EXPECT_FALSE(bare->has_uniform("u_ShadowMap"));
+    EXPECT_FALSE(bare->has_uniform("u_ShadowAtlas"));
+}
+
 // ShaderLibrary
 
+TEST_F(ShaderTest, ShaderLibraryBudget) {
+    ShaderLibrary::reset_stats();
+    auto held = ShaderLibrary::load_vf("held_shader", "test_shader.vert", "test_shader.frag");
+    ShaderLibrary::load_glsl("unused_shader", "test_shader.glsl");
+    ASSERT_TRUE(ShaderLibrary::exists("unused_shader"));
+    EXPECT_NE(ShaderLibrary::get("held_shader"), nullptr);
+    EXPECT_EQ(ShaderLibrary::get("missing_shader"), nullptr);
+    EXPECT_EQ(ShaderLibrary::get_stats().hits, 1u);
+    EXPECT_EQ(ShaderLibrary::get_stats().misses, 1u);
+
+    // A budget of one byte keeps only the programs still in use
+    ShaderLibrary::set_budget(1);
+    EXPECT_EQ(ShaderLibrary::get_budget(), 1u);
+    if (ShaderLibrary::get_stats().resident_bytes > 1) {
+        EXPECT_TRUE(ShaderLibrary::exists("held_shader"));
+        EXPECT_FALSE(ShaderLibrary::exists("unused_shader"));
+        EXPECT_EQ(ShaderLibrary::get_stats().evictions, 1u);
+    }
+    ShaderLibrary::set_budget(0);
+}
+
 TEST_F(ShaderTest, AddToShaderLibrary) {
     const char *vert = R"(
 #version 410 core
@@ -458,6 +668,68 @@ TEST_F(ShaderTest, GeometryShaderInLibrary) {
     EXPECT_TRUE(ShaderLibrary::exists("geom_shader"));
 }
 
+TEST_F(ShaderTest, CompileAsyncBecomesReady) {
+    // Without the cache, so that the program really compiles
+    std::string directory = ProgramCache::get_directory();
+    ProgramCache::set_directory("");
+    auto shader = Shader::from_glsl_file_async("test_shader.glsl");
+    ProgramCache::set_directory(directory);
+    ASSERT_NE(shader, nullptr);
+    EXPECT_NE(shader->get_id(), 0u);
+    // Polling never blocks with parallel compilation, so give the driver time
+    for (int i = 0; i < 5000 && shader->poll() == Shader::State::Compiling; ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    EXPECT_EQ(shader->poll(), Shader::State::Ready);
+    EXPECT_TRUE(shader->is_ready());
+    EXPECT_TRUE(shader->has_uniform("u_Color"));
+}
+
+TEST_F(ShaderTest, CompileAsyncReportsErrors) {
+    const char *vert = R"(
+#version 410 core
+void main() { gl_Position = vec4(0.0); }
+)";
+    auto shader = Shader::compile_async(vert, "#version 410 core\nvoid main() { broken }\n");
+    EXPECT_EQ(shader->wait(), Shader::State::Failed);
+    EXPECT_EQ(shader->get_id(), 0u);
+    EXPECT_FALSE(shader->is_ready());
+}
+
+TEST_F(ShaderTest, UsingAsyncShaderWaitsForTheLink) {
+    // Without the cache, so that the program really compiles
+    std::string directory = ProgramCache::get_directory();
+    ProgramCache::set_directory("");
+    auto shader = Shader::from_glsl_file_async("test_geom_shader.glsl");
+    ProgramCache::set_directory(directory);
+    while (glGetError() != GL_NO_ERROR) {
+    }
+    shader->bind();
+    EXPECT_EQ(shader->poll(), Shader::State::Ready);
+    shader->unbind();
+    EXPECT_EQ(glGetError(), static_cast<GLenum>(GL_NO_ERROR));
+}
+
+TEST_F(ShaderTest, ShaderLibraryWarmUp) {
+    ShaderLibrary::load_glsl("kept", "test_shader.glsl");
+    auto kept = ShaderLibrary::get("kept");
+    size_t submitted = ShaderLibrary::warm_up({{"kept", "test_shader.glsl"},
+                                               {"warm", "test_shader.glsl"},
+                                               {"warm_geom", "test_geom_shader.glsl"},
+                                               {"warm_invalid", "test_invalid.glsl"}});
+    EXPECT_EQ(submitted, 3u);
+    EXPECT_EQ(ShaderLibrary::get("kept"), kept);
+    EXPECT_TRUE(ShaderLibrary::exists("warm_invalid"));
+    // Polling is bookkeeping, it does not count as a lookup
+    ShaderLibrary::reset_stats();
+    ShaderLibrary::finish();
+    EXPECT_EQ(ShaderLibrary::poll(), 0u);
+    EXPECT_EQ(ShaderLibrary::get_stats().hits, 0u);
+    EXPECT_EQ(ShaderLibrary::get_stats().misses, 0u);
+    EXPECT_TRUE(ShaderLibrary::get("warm")->is_ready());
+    EXPECT_TRUE(ShaderLibrary::get("warm_geom")->is_ready());
+    EXPECT_FALSE(ShaderLibrary::exists("warm_invalid"));
+}
+
 #endif
 
 } // namespace renderer
@@ -0,0 +1,144 @@
+#include "lmgl/renderer/shadow_atlas.hpp"
+#include <gtest/gtest.h>
+
+using namespace lmgl::renderer;
+
+#ifndef TEST_HEADLESS
+
+// Shadow atlas tests require OpenGL context
+#include "lmgl/core/engine.hpp"
+#include <glad/glad.h>
+
+class ShadowAtlasTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        auto& engine = lmgl::core::Engine::get_instance();
+        if (!engine.get_window()) {
+            engine.init(800, 600, "Shadow Atlas Test");
+        }
+    }
+};
+
+static bool tiles_overlap(const ShadowAtlasTile &a, const ShadowAtlasTile &b) {
+    return a.x < b.x + b.size && b.x < a.x + a.size && a.y < b.y + b.size && b.y < a.y + a.size;
+}
+
+TEST_F(ShadowAtlasTest, Construction) {
+    while (glGetError() != GL_NO_ERROR) {
+    }
+    ShadowAtlas atlas(3000, 100, 5000);
+    EXPECT_EQ(glGetError(), static_cast<GLenum>(GL_NO_ERROR));
+    EXPECT_NE(atlas.get_texture_id(), 0u);
+    EXPECT_NE(atlas.get_fbo(), 0u);
+    // Sizes are rounded down to powers of two, the largest tile fits in the atlas
+    EXPECT_EQ(atlas.get_size(), 2048u);
+    EXPECT_EQ(atlas.get_min_tile_size(), 64u);
+    EXPECT_EQ(atlas.get_max_tile_size(), 2048u);
+    EXPECT_EQ(atlas.get_tile_count(), 0u);
+}
+
+TEST_F(ShadowAtlasTest, TileSizeFollowsScreenSize) {
+    ShadowAtlas atlas(1024, 64, 256);
+    EXPECT_EQ(atlas.get_tile_size(0.0f), 64u);
+    EXPECT_EQ(atlas.get_tile_size(64.0f), 64u);
+    EXPECT_EQ(atlas.get_tile_size(65.0f), 128u);
+    EXPECT_EQ(atlas.get_tile_size(5000.0f), 256u);
+}
+
+TEST_F(ShadowAtlasTest, PacksTilesWithoutOverlap) {
+    ShadowAtlas atlas(1024, 64, 512);
+    std::vector<ShadowAtlasRequest> requests = {{100, 1}, {256, 6}, {512, 0}, {512, 1}};
+    const std::vector<int> &first_tiles = atlas.allocate(requests);
+    ASSERT_EQ(first_tiles.size(), 4u);
+    EXPECT_EQ(atlas.get_tile_count(), 8u);
+    // Largest first, requests without tiles are skipped
+    EXPECT_EQ(first_tiles[3], 0);
+    EXPECT_EQ(first_tiles[1], 1);
+    EXPECT_EQ(first_tiles[0], 7);
+    EXPECT_EQ(first_tiles[2], -1);
+    EXPECT_EQ(atlas.get_first_tile(2), -1);
+    EXPECT_EQ(atlas.get_first_tile(10), -1);
+    EXPECT_EQ(atlas.get_tile(0).size, 512u);
+    EXPECT_EQ(atlas.get_tile(1).size, 256u);
+    EXPECT_EQ(atlas.get_tile(7).size, 128u);
+
+    for (unsigned int i = 0; i < atlas.get_tile_count(); ++i) {
+        const ShadowAtlasTile &tile = atlas.get_tile(i);
+        EXPECT_LE(tile.x + tile.size, atlas.get_size());
+        EXPECT_LE(tile.y + tile.size, atlas.get_size());
+        EXPECT_EQ(tile.x % tile.size, 0u);
+        EXPECT_EQ(tile.y % tile.size, 0u);
+        for (unsigned int j = 0; j < i; ++j)
+            EXPECT_FALSE(tiles_overlap(tile, atlas.get_tile(j))) << i << " overlaps " << j;
+    }
+    glm::vec4 rect = atlas.get_tile_rect(7);
+    EXPECT_FLOAT_EQ(rect.x, atlas.get_tile(7).x / 1024.0f);
+    EXPECT_FLOAT_EQ(rect.y, atlas.get_tile(7).y / 1024.0f);
+    EXPECT_FLOAT_EQ(rect.z, 0.125f);
+    EXPECT_FLOAT_EQ(rect.w, 0.125f);
+}
+
+TEST_F(ShadowAtlasTest, OverflowHalvesLargestTilesThenDrops) {
+    ShadowAtlas atlas(512, 128, 512);
+    // Two full size tiles do not fit, both are halved
+    atlas.allocate({{512, 1}, {512, 1}, {128, 1}});
+    EXPECT_EQ(atlas.get_tile(0).size, 256u);
+    EXPECT_EQ(atlas.get_tile(1).size, 256u);
+    EXPECT_EQ(atlas.get_tile(2).size, 128u);
+
+    // Three point lights need 18 tiles, only 16 of the smallest fit: the last light is dropped
+    const std::vector<int> &first_tiles = atlas.allocate({{512, 6}, {512, 6}, {512, 6}});
+    EXPECT_EQ(atlas.get_tile_count(), 12u);
+    EXPECT_EQ(first_tiles[0], 0);
+    EXPECT_EQ(first_tiles[1], 6);
+    EXPECT_EQ(first_tiles[2], -1);
+    EXPECT_EQ(atlas.get_tile(11).size, 128u);
+}
+
+TEST_F(ShadowAtlasTest, EqualRequestsKeepTheirTiles) {
+    ShadowAtlas atlas(1024, 64, 256);
+    std::vector<ShadowAtlasRequest> requests = {{200, 6}, {90, 1}, {256, 1}};
+    atlas.allocate(requests);
+    std::vector<ShadowAtlasTile> tiles;
+    for (unsigned int i = 0; i < atlas.get_tile_count(); ++i)
+        tiles.push_back(atlas.get_tile(i));
+    atlas.allocate(requests);
+    ASSERT_EQ(atlas.get_tile_count(), tiles.size());
+    for (unsigned int i = 0; i < atlas.get_tile_count(); ++i) {
+        EXPECT_EQ(atlas.get_tile(i).x, tiles[i].x);
+        EXPECT_EQ(atlas.get_tile(i).y, tiles[i].y);
+        EXPECT_EQ(atlas.get_tile(i).size, tiles[i].size);
+    }
+}
+
+TEST_F(ShadowAtlasTest, TileCachesTrackRenderedTiles) {
+    ShadowAtlas atlas(512, 128, 256);
+    atlas.allocate({{256, 1}});
+    EXPECT_EQ(atlas.get_tile_cache(0).light_key, 0u);
+    atlas.get_tile_cache(0).light_key = 42;
+    atlas.get_tile_cache(0).static_key = 43;
+    atlas.get_tile_cache(0).dynamic_key = 44;
+    atlas.allocate({{256, 1}});
+    EXPECT_EQ(atlas.get_tile_cache(0).static_key, 43u);
+    atlas.invalidate();
+    EXPECT_EQ(atlas.get_tile_cache(0).light_key, 0u);
+    EXPECT_EQ(atlas.get_tile_cache(0).static_key, 0u);
+    EXPECT_EQ(atlas.get_tile_cache(0).dynamic_key, 0u);
+
+    while (glGetError() != GL_NO_ERROR) {
+    }
+    EXPECT_NE(atlas.get_static_texture_id(), atlas.get_texture_id());
+    atlas.bind_tile(0);
+    EXPECT_TRUE(glIsEnabled(GL_SCISSOR_TEST));
+    atlas.bind_static_tile(0);
+    atlas.composite_tile(0);
+    EXPECT_TRUE(glIsEnabled(GL_SCISSOR_TEST));
+    GLint fbo = 0;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &fbo);
+    EXPECT_EQ(static_cast<unsigned int>(fbo), atlas.get_fbo());
+    atlas.unbind();
+    EXPECT_FALSE(glIsEnabled(GL_SCISSOR_TEST));
+    EXPECT_EQ(glGetError(), static_cast<GLenum>(GL_NO_ERROR));
+}
+
+#endif
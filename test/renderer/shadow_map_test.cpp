@@ -7,6 +7,10 @@ using namespace lmgl::renderer;
 
 // Shadow map tests require OpenGL context
 #include "lmgl/core/engine.hpp"
+#include "lmgl/scene/scene.hpp"
+#include <glad/glad.h>
+
+#include <cmath>
 
 class ShadowMapTest : public ::testing::Test {
 protected:
@@ -59,4 +63,494 @@ TEST_F(ShadowMapTest, ShadowRendererConstruction) {
     });
 }
 
+TEST_F(ShadowMapTest, RendersMeshesWithDepthStream) {
+    auto scene = std::make_shared<lmgl::scene::Scene>();
+    auto with_stream = lmgl::scene::Mesh::create_cube(nullptr);
+    ASSERT_TRUE(with_stream->create_depth_stream());
+    auto without_stream = lmgl::scene::Mesh::create_sphere(nullptr);
+    auto first = std::make_shared<lmgl::scene::Node>("with_stream");
+    first->set_mesh(with_stream);
+    auto second = std::make_shared<lmgl::scene::Node>("without_stream");
+    second->set_mesh(without_stream);
+    scene->get_root()->add_child(first);
+    scene->get_root()->add_child(second);
+
+    while (glGetError() != GL_NO_ERROR) {
+    }
+    ShadowRenderer renderer;
+    auto shadow_map = std::make_shared<ShadowMap>(256, 256);
+    auto cubemap_shadow_map = std::make_shared<CubemapShadowMap>(64);
+    renderer.render_directional_shadow(scene, lmgl::scene::Light::create_directional(glm::vec3(0.0f, -1.0f, 0.0f)),
+                                       shadow_map);
+    renderer.render_point_shadow(scene, lmgl::scene::Light::create_point(glm::vec3(0.0f, 3.0f, 0.0f)),
+                                 cubemap_shadow_map);
+    EXPECT_EQ(glGetError(), static_cast<GLenum>(GL_NO_ERROR));
+}
+
+static std::shared_ptr<lmgl::scene::Node> add_cube(std::shared_ptr<lmgl::scene::Scene> scene,
+                                                   const glm::vec3 &position, bool is_static = false) {
+    auto node = std::make_shared<lmgl::scene::Node>("cube");
+    node->set_mesh(lmgl::scene::Mesh::create_cube(nullptr));
+    node->set_position(position);
+    node->set_static(is_static);
+    scene->get_root()->add_child(node);
+    return node;
+}
+
+static std::vector<float> read_cube_face(const CubemapShadowMap &shadow_map, unsigned int face) {
+    std::vector<float> depth(shadow_map.get_resolution() * shadow_map.get_resolution());
+    glBindTexture(GL_TEXTURE_CUBE_MAP, shadow_map.get_texture_id());
+    glGetTexImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, GL_DEPTH_COMPONENT, GL_FLOAT, depth.data());
+    return depth;
+}
+
+TEST_F(ShadowMapTest, DirectionalPassCullsCastersOutsideTheVolume) {
+    auto scene = std::make_shared<lmgl::scene::Scene>();
+    add_cube(scene, glm::vec3(0.0f, 0.0f, 0.0f));
+    // Above the near plane, between the light and the volume, it still casts
+    add_cube(scene, glm::vec3(0.0f, 60.0f, 0.0f));
+    add_cube(scene, glm::vec3(100.0f, 0.0f, 0.0f));
+    add_cube(scene, glm::vec3(0.0f, -100.0f, 0.0f));
+
+    ShadowRenderer renderer;
+    auto shadow_map = std::make_shared<ShadowMap>(256, 256);
+    auto light = lmgl::scene::Light::create_directional(glm::vec3(0.0f, -1.0f, 0.0f));
+    // A light straight overhead still has a valid light space matrix to cull with
+    glm::mat4 light_space_matrix = renderer.get_light_space_matrix(light, glm::vec3(0.0f), 20.0f);
+    EXPECT_FALSE(std::isnan(light_space_matrix[0][0]) || std::isnan(light_space_matrix[2][2]));
+    renderer.render_directional_shadow(scene, light, shadow_map);
+    EXPECT_EQ(renderer.get_directional_stats().casters, 2u);
+    EXPECT_EQ(renderer.get_directional_stats().culled, 2u);
+    EXPECT_EQ(renderer.get_directional_stats().triangles, 2u * 12u);
+    EXPECT_FALSE(glIsEnabled(GL_DEPTH_CLAMP));
+
+    renderer.set_caster_culling(false);
+    renderer.render_directional_shadow(scene, light, shadow_map);
+    EXPECT_EQ(renderer.get_directional_stats().casters, 4u);
+    EXPECT_EQ(renderer.get_directional_stats().culled, 0u);
+}
+
+TEST_F(ShadowMapTest, PointPassCullsByRangeAndFace) {
+    auto scene = std::make_shared<lmgl::scene::Scene>();
+    add_cube(scene, glm::vec3(5.0f, 0.0f, 0.0f));
+    add_cube(scene, glm::vec3(0.0f, 5.0f, 0.0f));
+    add_cube(scene, glm::vec3(0.0f, 0.0f, 0.0f));
+    add_cube(scene, glm::vec3(-50.0f, 0.0f, 0.0f));
+
+    while (glGetError() != GL_NO_ERROR) {
+    }
+    ShadowRenderer renderer;
+    auto shadow_map = std::make_shared<CubemapShadowMap>(64);
+    auto light = lmgl::scene::Light::create_point(glm::vec3(0.0f), 10.0f);
+    renderer.render_point_shadow(scene, light, shadow_map);
+    const ShadowPassStats &stats = renderer.get_point_stats();
+    EXPECT_EQ(stats.casters, 3u);
+    EXPECT_EQ(stats.culled, 1u);
+    // The cube around the light reaches every face, the others one face each
+    EXPECT_EQ(stats.face_casters[0], 2u); // +X
+    EXPECT_EQ(stats.face_casters[1], 1u); // -X
+    EXPECT_EQ(stats.face_casters[2], 2u); // +Y
+    EXPECT_EQ(stats.face_casters[3], 1u); // -Y
+    EXPECT_EQ(stats.face_casters[4], 1u); // +Z
+    EXPECT_EQ(stats.face_casters[5], 1u); // -Z
+    EXPECT_EQ(glGetError(), static_cast<GLenum>(GL_NO_ERROR));
+
+    renderer.set_caster_culling(false);
+    renderer.render_point_shadow(scene, light, shadow_map);
+    EXPECT_EQ(renderer.get_point_stats().casters, 4u);
+    EXPECT_EQ(renderer.get_point_stats().face_casters[5], 4u);
+}
+
+TEST_F(ShadowMapTest, LodBiasCastsWithCoarserLevels) {
+    auto scene = std::make_shared<lmgl::scene::Scene>();
+    auto fine = lmgl::scene::Mesh::create_cube(nullptr, 4);
+    auto coarse = lmgl::scene::Mesh::create_cube(nullptr);
+    auto lod = std::make_shared<lmgl::scene::LOD>();
+    lod->add_level(fine, 10.0f);
+    lod->add_level(coarse, 100.0f);
+    auto node = std::make_shared<lmgl::scene::Node>("lod");
+    node->set_mesh(fine);
+    node->set_lod(lod);
+    scene->get_root()->add_child(node);
+
+    ShadowRenderer renderer;
+    auto shadow_map = std::make_shared<ShadowMap>(256, 256);
+    auto light = lmgl::scene::Light::create_directional(glm::vec3(0.0f, -1.0f, 0.0f));
+    renderer.render_directional_shadow(scene, light, shadow_map);
+    EXPECT_EQ(renderer.get_directional_stats().triangles, fine->get_index_count() / 3);
+
+    renderer.set_lod_bias(1);
+    renderer.render_directional_shadow(scene, light, shadow_map);
+    EXPECT_EQ(renderer.get_directional_stats().triangles, coarse->get_index_count() / 3);
+    // Past the last level the coarsest one is kept
+    renderer.set_lod_bias(5);
+    renderer.render_directional_shadow(scene, light, shadow_map);
+    EXPECT_EQ(renderer.get_directional_stats().triangles, coarse->get_index_count() / 3);
+}
+
+TEST_F(ShadowMapTest, CascadedShadowMapConstruction) {
+    CascadedShadowMap shadow_map(512, 3);
+    EXPECT_NE(shadow_map.get_texture_id(), 0u);
+    EXPECT_EQ(shadow_map.get_resolution(), 512u);
+    EXPECT_EQ(shadow_map.get_cascade_count(), 3u);
+    EXPECT_EQ(shadow_map.get_active_cascade_count(), 0u);
+    EXPECT_EQ(CascadedShadowMap(64, 0).get_cascade_count(), 1u);
+    EXPECT_EQ(CascadedShadowMap(64, 9).get_cascade_count(), CascadedShadowMap::MAX_CASCADES);
+}
+
+TEST_F(ShadowMapTest, CascadesFollowTheCameraFrustum) {
+    lmgl::scene::Camera camera(45.0f, 16.0f / 9.0f, 0.1f, 500.0f);
+    camera.set_position(glm::vec3(0.0f, 2.0f, 0.0f));
+    camera.set_target(glm::vec3(0.0f, 2.0f, -10.0f));
+    glm::vec3 light_direction = glm::normalize(glm::vec3(0.3f, -1.0f, 0.2f));
+
+    CascadedShadowMap shadow_map(1024, 3);
+    shadow_map.set_max_distance(100.0f);
+    shadow_map.fit(camera, light_direction);
+    ASSERT_EQ(shadow_map.get_active_cascade_count(), 3u);
+    // Practical splits grow with the distance and end at the shadow distance
+    EXPECT_LT(shadow_map.get_split_distance(0), 100.0f / 3.0f);
+    EXPECT_LT(shadow_map.get_split_distance(0), shadow_map.get_split_distance(1));
+    EXPECT_NEAR(shadow_map.get_split_distance(2), 100.0f, 0.01f);
+    EXPECT_LT(shadow_map.get_bounds(0).radius, shadow_map.get_bounds(2).radius);
+
+    float slice_near = 0.1f;
+    for (unsigned int cascade = 0; cascade < 3; ++cascade) {
+        // Points of the slice on the view axis land inside their cascade
+        float slice_far = shadow_map.get_split_distance(cascade);
+        for (float depth : {slice_near, (slice_near + slice_far) * 0.5f, slice_far}) {
+            glm::vec4 point = shadow_map.get_light_space_matrix(cascade) * glm::vec4(0.0f, 2.0f, -depth, 1.0f);
+            EXPECT_LE(std::abs(point.x), 1.0f);
+            EXPECT_LE(std::abs(point.y), 1.0f);
+            EXPECT_GE(point.z, -1.0f);
+            EXPECT_LE(point.z, 1.0f);
+        }
+        slice_near = slice_far;
+
+        // The world origin lands on a texel corner, so moving the camera does not shimmer
+        glm::vec4 origin = shadow_map.get_light_space_matrix(cascade) * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        float texel_x = origin.x * 512.0f;
+        float texel_y = origin.y * 512.0f;
+        EXPECT_NEAR(texel_x, std::round(texel_x), 0.01f);
+        EXPECT_NEAR(texel_y, std::round(texel_y), 0.01f);
+    }
+
+    shadow_map.set_split_lambda(0.0f);
+    shadow_map.fit(camera, light_direction);
+    EXPECT_NEAR(shadow_map.get_split_distance(0), 0.1f + 99.9f / 3.0f, 0.01f);
+    EXPECT_NEAR(shadow_map.get_split_distance(1), 0.1f + 99.9f * 2.0f / 3.0f, 0.01f);
+
+    shadow_map.fit_sphere(glm::vec3(0.0f, 2.0f, 0.0f), 20.0f, light_direction);
+    EXPECT_EQ(shadow_map.get_active_cascade_count(), 1u);
+}
+
+TEST_F(ShadowMapTest, CascadesFitOrthographicCamerasWithoutNearPlane) {
+    lmgl::scene::Camera camera(45.0f, 1.0f, 0.1f, 500.0f);
+    camera.set_position(glm::vec3(0.0f, 2.0f, 0.0f));
+    camera.set_target(glm::vec3(0.0f, 2.0f, -10.0f));
+    glm::vec3 light_direction = glm::normalize(glm::vec3(0.3f, -1.0f, 0.2f));
+    CascadedShadowMap shadow_map(1024, 3);
+    shadow_map.set_max_distance(100.0f);
+
+    // The logarithmic split is undefined without a positive near plane, the uniform split is used instead
+    for (float near_plane : {0.0f, -20.0f}) {
+        camera.set_orthographic(-10.0f, 10.0f, -10.0f, 10.0f, near_plane, 100.0f);
+        shadow_map.fit(camera, light_direction);
+        ASSERT_EQ(shadow_map.get_active_cascade_count(), 3u);
+        for (unsigned int cascade = 0; cascade < 3; ++cascade) {
+            float expected = near_plane + (100.0f - near_plane) * static_cast<float>(cascade + 1) / 3.0f;
+            EXPECT_NEAR(shadow_map.get_split_distance(cascade), expected, 0.01f);
+            EXPECT_TRUE(std::isfinite(shadow_map.get_bounds(cascade).radius));
+            const glm::mat4 &matrix = shadow_map.get_light_space_matrix(cascade);
+            for (int column = 0; column < 4; ++column) {
+                for (int row = 0; row < 4; ++row)
+                    EXPECT_TRUE(std::isfinite(matrix[column][row])) << cascade;
+            }
+        }
+    }
+}
+
+TEST_F(ShadowMapTest, CascadedPassCullsCastersPerCascade) {
+    auto scene = std::make_shared<lmgl::scene::Scene>();
+    add_cube(scene, glm::vec3(0.0f, 0.0f, -4.0f));
+    add_cube(scene, glm::vec3(0.0f, 0.0f, -60.0f));
+    add_cube(scene, glm::vec3(500.0f, 0.0f, -4.0f));
+
+    lmgl::scene::Camera camera(45.0f, 16.0f / 9.0f, 0.1f, 500.0f);
+    camera.set_position(glm::vec3(0.0f, 2.0f, 0.0f));
+    camera.set_target(glm::vec3(0.0f, 2.0f, -10.0f));
+    auto light = lmgl::scene::Light::create_directional(glm::vec3(0.1f, -1.0f, 0.1f));
+    auto shadow_map = std::make_shared<CascadedShadowMap>(256, 3);
+    shadow_map->fit(camera, light->get_direction());
+
+    while (glGetError() != GL_NO_ERROR) {
+    }
+    ShadowRenderer renderer;
+    renderer.render_cascaded_shadow(scene, light, shadow_map);
+    const ShadowPassStats &stats = renderer.get_directional_stats();
+    EXPECT_EQ(stats.casters, 2u);
+    EXPECT_EQ(stats.culled, 1u);
+    // The far cube is outside the first cascade, the last one reaches both
+    EXPECT_EQ(stats.cascade_casters[0], 1u);
+    EXPECT_EQ(stats.cascade_casters[2], 2u);
+    unsigned int draws = stats.cascade_casters[0] + stats.cascade_casters[1] + stats.cascade_casters[2];
+    EXPECT_EQ(stats.triangles, draws * 12u);
+    EXPECT_FALSE(glIsEnabled(GL_DEPTH_CLAMP));
+    EXPECT_EQ(glGetError(), static_cast<GLenum>(GL_NO_ERROR));
+
+    renderer.set_caster_culling(false);
+    renderer.render_cascaded_shadow(scene, light, shadow_map);
+    EXPECT_EQ(renderer.get_directional_stats().casters, 3u);
+    EXPECT_EQ(renderer.get_directional_stats().cascade_casters[0], 3u);
+}
+
+TEST_F(ShadowMapTest, PointPassCachesStaticCasters) {
+    auto scene = std::make_shared<lmgl::scene::Scene>();
+    add_cube(scene, glm::vec3(4.0f, 0.0f, 0.0f), true);
+    auto dynamic = add_cube(scene, glm::vec3(-4.0f, 0.0f, 0.0f));
+
+    while (glGetError() != GL_NO_ERROR) {
+    }
+    ShadowRenderer renderer;
+    auto shadow_map = std::make_shared<CubemapShadowMap>(32);
+    auto light = lmgl::scene::Light::create_point(glm::vec3(0.0f), 10.0f);
+    renderer.render_point_shadow(scene, light, shadow_map);
+    EXPECT_EQ(renderer.get_point_stats().casters, 2u);
+    EXPECT_EQ(renderer.get_point_stats().updated_slices, 6u);
+
+    // Nothing moved, nothing is drawn
+    renderer.render_point_shadow(scene, light, shadow_map);
+    EXPECT_EQ(renderer.get_point_stats().casters, 0u);
+    EXPECT_EQ(renderer.get_point_stats().cached, 2u);
+    EXPECT_EQ(renderer.get_point_stats().updated_slices, 0u);
+
+    // Only the face of the dynamic cube is composited again, over the cached static depth
+    dynamic->set_position(glm::vec3(-5.0f, 0.0f, 0.0f));
+    renderer.render_point_shadow(scene, light, shadow_map);
+    EXPECT_EQ(renderer.get_point_stats().casters, 1u);
+    EXPECT_EQ(renderer.get_point_stats().cached, 1u);
+    EXPECT_EQ(renderer.get_point_stats().updated_slices, 1u);
+    EXPECT_EQ(renderer.get_point_stats().face_casters[0], 0u);
+    EXPECT_EQ(renderer.get_point_stats().face_casters[1], 1u);
+    EXPECT_EQ(glGetError(), static_cast<GLenum>(GL_NO_ERROR));
+
+    // The composited faces match a map rendered from scratch
+    ShadowRenderer reference_renderer;
+    auto reference = std::make_shared<CubemapShadowMap>(32);
+    reference_renderer.render_point_shadow(scene, light, reference);
+    for (unsigned int face : {0u, 1u})
+        EXPECT_EQ(read_cube_face(*shadow_map, face), read_cube_face(*reference, face));
+
+    // A moving light makes every face stale
+    light->set_position(glm::vec3(0.0f, 0.5f, 0.0f));
+    renderer.render_point_shadow(scene, light, shadow_map);
+    EXPECT_EQ(renderer.get_point_stats().updated_slices, 6u);
+    shadow_map->invalidate();
+    renderer.render_point_shadow(scene, light, shadow_map);
+    EXPECT_EQ(renderer.get_point_stats().casters, 2u);
+}
+
+TEST_F(ShadowMapTest, TimeSlicingRefreshesOneFarCascadePerPass) {
+    auto scene = std::make_shared<lmgl::scene::Scene>();
+    add_cube(scene, glm::vec3(0.0f, 0.0f, -4.0f), true);
+    add_cube(scene, glm::vec3(0.0f, 0.0f, -60.0f), true);
+
+    lmgl::scene::Camera camera(45.0f, 16.0f / 9.0f, 0.1f, 500.0f);
+    camera.set_position(glm::vec3(0.0f, 2.0f, 0.0f));
+    camera.set_target(glm::vec3(0.0f, 2.0f, -10.0f));
+    auto light = lmgl::scene::Light::create_directional(glm::vec3(0.1f, -1.0f, 0.1f));
+    auto shadow_map = std::make_shared<CascadedShadowMap>(256, 3);
+    shadow_map->fit(camera, light->get_direction());
+
+    ShadowRenderer renderer;
+    renderer.set_time_slicing(true);
+    // Cascades never rendered are all rendered on the first pass
+    renderer.render_cascaded_shadow(scene, light, shadow_map);
+    EXPECT_EQ(renderer.get_directional_stats().updated_slices, 3u);
+    renderer.render_cascaded_shadow(scene, light, shadow_map);
+    EXPECT_EQ(renderer.get_directional_stats().updated_slices, 0u);
+    EXPECT_EQ(renderer.get_directional_stats().cached, 2u);
+
+    // After the camera moved, the first cascade and one further cascade follow on each pass
+    camera.set_position(glm::vec3(3.0f, 2.0f, 0.0f));
+    camera.set_target(glm::vec3(3.0f, 2.0f, -10.0f));
+    shadow_map->fit(camera, light->get_direction());
+    renderer.render_cascaded_shadow(scene, light, shadow_map);
+    EXPECT_EQ(renderer.get_directional_stats().updated_slices, 2u);
+    EXPECT_EQ(shadow_map->get_shadow_matrix(1), shadow_map->get_light_space_matrix(1));
+    EXPECT_NE(shadow_map->get_shadow_matrix(2), shadow_map->get_light_space_matrix(2));
+    renderer.render_cascaded_shadow(scene, light, shadow_map);
+    EXPECT_EQ(renderer.get_directional_stats().updated_slices, 1u);
+    EXPECT_EQ(shadow_map->get_shadow_matrix(2), shadow_map->get_light_space_matrix(2));
+    renderer.render_cascaded_shadow(scene, light, shadow_map);
+    EXPECT_EQ(renderer.get_directional_stats().updated_slices, 0u);
+}
+
+TEST_F(ShadowMapTest, SmallCameraMovesKeepTheStaticCascades) {
+    auto scene = std::make_shared<lmgl::scene::Scene>();
+    add_cube(scene, glm::vec3(0.0f, 0.0f, -4.0f), true);
+    add_cube(scene, glm::vec3(0.0f, 0.0f, -60.0f), true);
+
+    lmgl::scene::Camera camera(45.0f, 16.0f / 9.0f, 0.1f, 500.0f);
+    camera.set_position(glm::vec3(0.0f, 2.0f, 0.0f));
+    camera.set_target(glm::vec3(0.0f, 2.0f, -10.0f));
+    auto light = lmgl::scene::Light::create_directional(glm::vec3(0.1f, -1.0f, 0.1f));
+    auto shadow_map = std::make_shared<CascadedShadowMap>(256, 3);
+    shadow_map->fit(camera, light->get_direction());
+    std::vector<glm::mat4> matrices;
+    for (unsigned int cascade = 0; cascade < 3; ++cascade)
+        matrices.push_back(shadow_map->get_light_space_matrix(cascade));
+
+    ShadowRenderer renderer;
+    renderer.render_cascaded_shadow(scene, light, shadow_map);
+    EXPECT_EQ(renderer.get_directional_stats().updated_slices, 3u);
+
+    // Less than a texel in every direction, depth along the light included: the volumes are snapped in place
+    camera.set_position(glm::vec3(0.002f, 2.002f, -0.002f));
+    camera.set_target(glm::vec3(0.002f, 2.002f, -10.002f));
+    shadow_map->fit(camera, light->get_direction());
+    for (unsigned int cascade = 0; cascade < 3; ++cascade)
+        EXPECT_EQ(shadow_map->get_light_space_matrix(cascade), matrices[cascade]) << cascade;
+    renderer.render_cascaded_shadow(scene, light, shadow_map);
+    EXPECT_EQ(renderer.get_directional_stats().updated_slices, 0u);
+    EXPECT_EQ(renderer.get_directional_stats().cached, 2u);
+}
+
+TEST_F(ShadowMapTest, AtlasPassShadowsEveryCastingLight) {
+    auto scene = std::make_shared<lmgl::scene::Scene>();
+    auto cube = add_cube(scene, glm::vec3(0.0f, 0.0f, 0.0f));
+    add_cube(scene, glm::vec3(0.0f, 0.0f, -50.0f));
+
+    auto point = lmgl::scene::Light::create_point(glm::vec3(3.0f, 0.0f, 0.0f), 10.0f);
+    point->set_casts_shadows(true);
+    auto spot = lmgl::scene::Light::create_spot(glm::vec3(0.0f, 5.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f));
+    spot->set_casts_shadows(true);
+    auto unshadowed = lmgl::scene::Light::create_point(glm::vec3(0.0f, 3.0f, 0.0f), 10.0f);
+    // Directional lights use the cascades, not the atlas
+    auto sun = lmgl::scene::Light::create_directional(glm::vec3(0.0f, -1.0f, 0.0f));
+    sun->set_casts_shadows(true);
+    std::vector<std::shared_ptr<lmgl::scene::Light>> lights = {point, unshadowed, spot, sun};
+
+    while (glGetError() != GL_NO_ERROR) {
+    }
+    // The renderer enables face culling, the shadow passes only pick the culled side
+    GLboolean cull_face = glIsEnabled(GL_CULL_FACE);
+    glEnable(GL_CULL_FACE);
+    ShadowRenderer renderer;
+    auto atlas = std::make_shared<ShadowAtlas>(1024, 64, 256);
+    renderer.render_atlas_shadows(scene, lights, atlas);
+    EXPECT_EQ(glGetError(), static_cast<GLenum>(GL_NO_ERROR));
+    EXPECT_EQ(atlas->get_tile_count(), 7u);
+    EXPECT_EQ(atlas->get_first_tile(0), 0);
+    EXPECT_EQ(atlas->get_first_tile(1), -1);
+    EXPECT_EQ(atlas->get_first_tile(2), 6);
+    EXPECT_EQ(atlas->get_first_tile(3), -1);
+    // Without a camera every light gets the largest tiles
+    EXPECT_EQ(atlas->get_tile(6).size, 256u);
+    const ShadowPassStats &stats = renderer.get_atlas_stats();
+    EXPECT_EQ(stats.casters, 1u);
+    EXPECT_EQ(stats.culled, 1u);
+    EXPECT_EQ(stats.updated_slices, 7u);
+    EXPECT_EQ(atlas->get_tile(6).light_space_matrix,
+              glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 10.0f) *
+                  glm::lookAt(spot->get_position(), glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f)));
+
+    // The spot light sees the back faces of the cube in the middle of its tile
+    const ShadowAtlasTile &tile = atlas->get_tile(6);
+    std::vector<float> depth(atlas->get_size() * atlas->get_size());
+    glBindTexture(GL_TEXTURE_2D, atlas->get_texture_id());
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, GL_FLOAT, depth.data());
+    unsigned int center = (tile.y + tile.size / 2) * atlas->get_size() + tile.x + tile.size / 2;
+    EXPECT_NEAR(depth[center], 5.5f / 10.0f, 0.01f);
+    EXPECT_FLOAT_EQ(depth[tile.y * atlas->get_size() + tile.x], 1.0f);
+
+    // Tiles whose light and casters did not change keep their depth
+    renderer.render_atlas_shadows(scene, lights, atlas);
+    EXPECT_EQ(renderer.get_atlas_stats().updated_slices, 0u);
+    EXPECT_EQ(renderer.get_atlas_stats().cached, 1u);
+    EXPECT_EQ(renderer.get_atlas_stats().casters, 0u);
+
+    // Only the point light face looking at the cube and the spot light tile follow it
+    cube->set_position(glm::vec3(0.0f, 0.0f, 0.2f));
+    renderer.render_atlas_shadows(scene, lights, atlas);
+    EXPECT_EQ(renderer.get_atlas_stats().updated_slices, 2u);
+    EXPECT_EQ(renderer.get_atlas_stats().casters, 1u);
+    EXPECT_EQ(glGetError(), static_cast<GLenum>(GL_NO_ERROR));
+    if (!cull_face)
+        glDisable(GL_CULL_FACE);
+}
+
+TEST_F(ShadowMapTest, AtlasPassCachesStaticCasters) {
+    auto scene = std::make_shared<lmgl::scene::Scene>();
+    // Both in the tile of the -x face
+    add_cube(scene, glm::vec3(-4.0f, 0.0f, 0.0f), true);
+    auto dynamic = add_cube(scene, glm::vec3(-7.0f, 2.0f, 0.0f));
+    auto light = lmgl::scene::Light::create_point(glm::vec3(0.0f), 10.0f);
+    light->set_casts_shadows(true);
+    std::vector<std::shared_ptr<lmgl::scene::Light>> lights = {light};
+
+    while (glGetError() != GL_NO_ERROR) {
+    }
+    GLboolean cull_face = glIsEnabled(GL_CULL_FACE);
+    glEnable(GL_CULL_FACE);
+    ShadowRenderer renderer;
+    auto atlas = std::make_shared<ShadowAtlas>(512, 64, 128);
+    renderer.render_atlas_shadows(scene, lights, atlas);
+    EXPECT_EQ(renderer.get_atlas_stats().casters, 2u);
+    EXPECT_EQ(renderer.get_atlas_stats().updated_slices, 6u);
+
+    // Only the tile of the dynamic cube is composited again, the static cube is copied from the cache
+    dynamic->set_position(glm::vec3(-7.0f, 2.5f, 0.0f));
+    renderer.render_atlas_shadows(scene, lights, atlas);
+    EXPECT_EQ(renderer.get_atlas_stats().casters, 1u);
+    EXPECT_EQ(renderer.get_atlas_stats().cached, 1u);
+    EXPECT_EQ(renderer.get_atlas_stats().updated_slices, 1u);
+    EXPECT_EQ(glGetError(), static_cast<GLenum>(GL_NO_ERROR));
+
+    // The atlas matches one rendered from scratch
+    ShadowRenderer reference_renderer;
+    auto reference = std::make_shared<ShadowAtlas>(512, 64, 128);
+    reference_renderer.render_atlas_shadows(scene, lights, reference);
+    std::vector<float> depth(atlas->get_size() * atlas->get_size());
+    std::vector<float> reference_depth(depth.size());
+    glBindTexture(GL_TEXTURE_2D, atlas->get_texture_id());
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, GL_FLOAT, depth.data());
+    glBindTexture(GL_TEXTURE_2D, reference->get_texture_id());
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, GL_FLOAT, reference_depth.data());
+    EXPECT_EQ(depth, reference_depth);
+    if (!cull_face)
+        glDisable(GL_CULL_FACE);
+}
+
+TEST_F(ShadowMapTest, TimeSlicingRefreshesOneAtlasTilePerPass) {
+    auto scene = std::make_shared<lmgl::scene::Scene>();
+    auto right = add_cube(scene, glm::vec3(4.0f, 0.0f, 0.0f), true);
+    auto left = add_cube(scene, glm::vec3(-4.0f, 0.0f, 0.0f), true);
+    auto light = lmgl::scene::Light::create_point(glm::vec3(0.0f), 10.0f);
+    light->set_casts_shadows(true);
+    std::vector<std::shared_ptr<lmgl::scene::Light>> lights = {light};
+
+    ShadowRenderer renderer;
+    renderer.set_time_slicing(true);
+    auto atlas = std::make_shared<ShadowAtlas>(512, 64, 128);
+    // Tiles never rendered are all rendered on the first pass
+    renderer.render_atlas_shadows(scene, lights, atlas);
+    EXPECT_EQ(renderer.get_atlas_stats().updated_slices, 6u);
+
+    // Two stale tiles of a light in place are refreshed over two passes
+    right->set_position(glm::vec3(5.0f, 0.0f, 0.0f));
+    left->set_position(glm::vec3(-5.0f, 0.0f, 0.0f));
+    renderer.render_atlas_shadows(scene, lights, atlas);
+    EXPECT_EQ(renderer.get_atlas_stats().updated_slices, 1u);
+    renderer.render_atlas_shadows(scene, lights, atlas);
+    EXPECT_EQ(renderer.get_atlas_stats().updated_slices, 1u);
+    renderer.render_atlas_shadows(scene, lights, atlas);
+    EXPECT_EQ(renderer.get_atlas_stats().updated_slices, 0u);
+
+    // A moving light makes every tile stale at once
+    light->set_position(glm::vec3(0.0f, 0.5f, 0.0f));
+    renderer.render_atlas_shadows(scene, lights, atlas);
+    EXPECT_EQ(renderer.get_atlas_stats().updated_slices, 6u);
+}
+
 #endif
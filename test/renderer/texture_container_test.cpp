@@ -0,0 +1,169 @@
+#include "lmgl/renderer/texture_container.hpp"
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+namespace lmgl {
+
+namespace renderer {
+
+class TextureContainerTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        // Container tests only parse files, no OpenGL needed
+    }
+
+    // Image with a full mip chain filled with a recognizable pattern
+    static CompressedImage make_image(BlockFormat format, int width, int height) {
+        CompressedImage image;
+        image.format = format;
+        for (;;) {
+            CompressedLevel level;
+            level.width = width;
+            level.height = height;
+            level.data.resize(TextureContainer::get_level_size(format, width, height));
+            for (size_t i = 0; i < level.data.size(); ++i)
+                level.data[i] = static_cast<unsigned char>(i * 7 + image.levels.size());
+            image.levels.push_back(level);
+            if (width == 1 && height == 1)
+                break;
+            width = std::max(1, width / 2);
+            height = std::max(1, height / 2);
+        }
+        return image;
+    }
+
+    static std::vector<unsigned char> read_file(const std::string &fpath) {
+        std::ifstream file(fpath, std::ios::binary);
+        return std::vector<unsigned char>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    }
+
+    template <typename T> static void append(std::vector<unsigned char> &data, T value) {
+        const unsigned char *bytes = reinterpret_cast<const unsigned char *>(&value);
+        data.insert(data.end(), bytes, bytes + sizeof(T));
+    }
+};
+
+TEST_F(TextureContainerTest, IsContainer) {
+    EXPECT_TRUE(TextureContainer::is_container("textures/albedo.dds"));
+    EXPECT_TRUE(TextureContainer::is_container("NORMAL.KTX2"));
+    EXPECT_FALSE(TextureContainer::is_container("albedo.png"));
+    EXPECT_FALSE(TextureContainer::is_container("dds"));
+    EXPECT_FALSE(TextureContainer::is_container("archive.ktx"));
+}
+
+TEST_F(TextureContainerTest, BlockAndLevelSizes) {
+    EXPECT_EQ(TextureContainer::get_block_size(BlockFormat::BC1), 8u);
+    EXPECT_EQ(TextureContainer::get_block_size(BlockFormat::BC4), 8u);
+    EXPECT_EQ(TextureContainer::get_block_size(BlockFormat::BC3), 16u);
+    EXPECT_EQ(TextureContainer::get_block_size(BlockFormat::BC5), 16u);
+    EXPECT_EQ(TextureContainer::get_block_size(BlockFormat::BC7), 16u);
+    EXPECT_EQ(TextureContainer::get_level_size(BlockFormat::BC1, 4, 4), 8u);
+    EXPECT_EQ(TextureContainer::get_level_size(BlockFormat::BC1, 5, 5), 32u);
+    EXPECT_EQ(TextureContainer::get_level_size(BlockFormat::BC1, 1, 1), 8u);
+    EXPECT_EQ(TextureContainer::get_level_size(BlockFormat::BC7, 16, 8), 128u);
+    EXPECT_EQ(TextureContainer::get_channels(BlockFormat::BC4), 1);
+    EXPECT_EQ(TextureContainer::get_channels(BlockFormat::BC5), 2);
+    EXPECT_EQ(TextureContainer::get_channels(BlockFormat::BC7), 4);
+}
+
+TEST_F(TextureContainerTest, DdsRoundTrip) {
+    const std::string fpath = "texture_container_test.dds";
+    CompressedImage image = make_image(BlockFormat::BC7, 16, 8);
+    image.srgb = true;
+    ASSERT_EQ(image.levels.size(), 5u);
+    ASSERT_TRUE(TextureContainer::save_dds(fpath, image));
+
+    CompressedImage loaded;
+    ASSERT_TRUE(TextureContainer::load(fpath, loaded));
+    EXPECT_EQ(loaded.format, BlockFormat::BC7);
+    EXPECT_TRUE(loaded.srgb);
+    ASSERT_EQ(loaded.levels.size(), image.levels.size());
+    for (size_t i = 0; i < image.levels.size(); ++i) {
+        EXPECT_EQ(loaded.levels[i].width, image.levels[i].width);
+        EXPECT_EQ(loaded.levels[i].height, image.levels[i].height);
+        EXPECT_EQ(loaded.levels[i].data, image.levels[i].data);
+    }
+    EXPECT_EQ(loaded.size(), image.size());
+    std::remove(fpath.c_str());
+}
+
+TEST_F(TextureContainerTest, ParsesLegacyDds) {
+    const std::string fpath = "texture_container_test_legacy.dds";
+    CompressedImage image = make_image(BlockFormat::BC1, 8, 8);
+    ASSERT_TRUE(TextureContainer::save_dds(fpath, image));
+    std::vector<unsigned char> data = read_file(fpath);
+    std::remove(fpath.c_str());
+    // Turn the DX10 file into a legacy one: DXT1 code and no extended header
+    std::memcpy(data.data() + 84, "DXT1", 4);
+    data.erase(data.begin() + 128, data.begin() + 148);
+
+    CompressedImage loaded;
+    ASSERT_TRUE(TextureContainer::parse(data.data(), data.size(), loaded));
+    EXPECT_EQ(loaded.format, BlockFormat::BC1);
+    EXPECT_FALSE(loaded.srgb);
+    ASSERT_EQ(loaded.levels.size(), 4u);
+    EXPECT_EQ(loaded.levels[3].data, image.levels[3].data);
+
+    // Truncated data is rejected
+    EXPECT_FALSE(TextureContainer::parse(data.data(), data.size() - 1, loaded));
+    // Uncompressed pixel formats are not supported
+    std::memcpy(data.data() + 84, "ABCD", 4);
+    EXPECT_FALSE(TextureContainer::parse(data.data(), data.size(), loaded));
+    // A failed parse leaves the image untouched
+    EXPECT_EQ(loaded.levels.size(), 4u);
+}
+
+TEST_F(TextureContainerTest, ParsesKtx2) {
+    CompressedImage image = make_image(BlockFormat::BC5, 8, 4);
+    std::vector<unsigned char> data = {0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+    const uint32_t level_count = static_cast<uint32_t>(image.levels.size());
+    for (uint32_t value : {141u, 1u, 8u, 4u, 0u, 0u, 1u, level_count, 0u, 0u, 0u, 0u, 0u})
+        append(data, value);
+    append(data, uint64_t(0));
+    append(data, uint64_t(0));
+    // Levels are stored smallest first, after the level index
+    uint64_t offset = data.size() + level_count * 3 * sizeof(uint64_t);
+    std::vector<uint64_t> offsets(level_count);
+    for (uint32_t i = level_count; i-- > 0;) {
+        offsets[i] = offset;
+        offset += image.levels[i].data.size();
+    }
+    for (uint32_t i = 0; i < level_count; ++i) {
+        append(data, offsets[i]);
+        append(data, uint64_t(image.levels[i].data.size()));
+        append(data, uint64_t(image.levels[i].data.size()));
+    }
+    for (uint32_t i = level_count; i-- > 0;)
+        data.insert(data.end(), image.levels[i].data.begin(), image.levels[i].data.end());
+
+    CompressedImage loaded;
+    ASSERT_TRUE(TextureContainer::parse(data.data(), data.size(), loaded));
+    EXPECT_EQ(loaded.format, BlockFormat::BC5);
+    ASSERT_EQ(loaded.levels.size(), image.levels.size());
+    for (size_t i = 0; i < image.levels.size(); ++i)
+        EXPECT_EQ(loaded.levels[i].data, image.levels[i].data);
+
+    // Supercompressed files are rejected
+    uint32_t zstd = 2;
+    std::memcpy(data.data() + 12 + 8 * sizeof(uint32_t), &zstd, sizeof(zstd));
+    EXPECT_FALSE(TextureContainer::parse(data.data(), data.size(), loaded));
+}
+
+TEST_F(TextureContainerTest, RejectsGarbage) {
+    CompressedImage image;
+    std::vector<unsigned char> data(256, 0x5A);
+    EXPECT_FALSE(TextureContainer::parse(data.data(), data.size(), image));
+    EXPECT_FALSE(TextureContainer::parse(data.data(), 0, image));
+    EXPECT_FALSE(TextureContainer::load("non_existent_file.dds", image));
+    EXPECT_FALSE(TextureContainer::save_dds("texture_container_test_empty.dds", CompressedImage()));
+}
+
+} // namespace renderer
+
+} // namespace lmgl
@@ -0,0 +1,312 @@
+#include <gtest/gtest.h>
+
+#ifndef TEST_HEADLESS
+#include "lmgl/core/engine.hpp"
+#include "lmgl/core/thread_pool.hpp"
+#endif
+#include "lmgl/renderer/block_encoder.hpp"
+#include "lmgl/renderer/texture_streamer.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace lmgl {
+
+namespace renderer {
+
+class TextureStreamerTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+#ifndef TEST_HEADLESS
+        auto &engine_instance = core::Engine::get_instance();
+        if (!engine_instance.get_window())
+            engine_instance.init(800, 600, "Texture Streamer Test");
+#endif
+    }
+
+    static ImageData make_image(int size, unsigned char value) {
+        ImageData image;
+        image.width = size;
+        image.height = size;
+        image.channels = 4;
+        image.pixels = std::shared_ptr<unsigned char>(new unsigned char[image.size()],
+                                                      std::default_delete<unsigned char[]>());
+        std::fill(image.pixels.get(), image.pixels.get() + image.size(), value);
+        return image;
+    }
+
+    static std::size_t level_bytes(int size) { return static_cast<std::size_t>(size) * size * 4; }
+
+    // Writes a binary PPM of a single gray value
+    static void write_ppm(const std::string &fpath, int size, unsigned char value) {
+        std::ofstream file(fpath, std::ios::binary);
+        file << "P6\n" << size << " " << size << "\n255\n";
+        std::vector<char> pixels(static_cast<std::size_t>(size) * size * 3, static_cast<char>(value));
+        file.write(pixels.data(), static_cast<std::streamsize>(pixels.size()));
+    }
+
+#ifndef TEST_HEADLESS
+    static GLint get_parameter(const Texture &texture, GLenum parameter) {
+        GLint value = 0;
+        texture.bind(0);
+        glGetTexParameteriv(GL_TEXTURE_2D, parameter, &value);
+        return value;
+    }
+#endif
+};
+
+TEST_F(TextureStreamerTest, SelectLevel) {
+    EXPECT_EQ(TextureStreamer::select_level(1024, 1024, 2000.0f), 0);
+    EXPECT_EQ(TextureStreamer::select_level(1024, 1024, 1024.0f), 0);
+    EXPECT_EQ(TextureStreamer::select_level(1024, 1024, 600.0f), 0);
+    EXPECT_EQ(TextureStreamer::select_level(1024, 1024, 512.0f), 1);
+    EXPECT_EQ(TextureStreamer::select_level(1024, 512, 100.0f), 3);
+    EXPECT_EQ(TextureStreamer::select_level(1024, 1024, 0.0f), 10);
+}
+
+TEST_F(TextureStreamerTest, EmptyStreamer) {
+    TextureStreamer streamer;
+    EXPECT_TRUE(streamer.is_empty());
+    EXPECT_EQ(streamer.add("empty", ImageData()), nullptr);
+    EXPECT_EQ(streamer.load("non_existent_file.png"), nullptr);
+    streamer.request(nullptr, 100.0f);
+    streamer.update();
+    EXPECT_EQ(streamer.get_count(), 0u);
+    EXPECT_EQ(streamer.get_memory_usage(), 0u);
+}
+
+#ifndef TEST_HEADLESS
+
+TEST_F(TextureStreamerTest, StartsWithLowMips) {
+    TextureStreamer streamer;
+    while (glGetError() != GL_NO_ERROR) {
+    }
+    auto texture = streamer.add("stream", make_image(256, 100));
+    ASSERT_NE(texture, nullptr);
+    EXPECT_EQ(glGetError(), static_cast<GLenum>(GL_NO_ERROR));
+    EXPECT_TRUE(texture->is_streamed());
+    EXPECT_EQ(texture->get_width(), 256);
+    EXPECT_EQ(texture->get_level_count(), 9);
+    // 256 and 128 stay on the CPU, 64 down to 1 are resident
+    EXPECT_EQ(texture->get_base_level(), 2);
+    EXPECT_EQ(get_parameter(*texture, GL_TEXTURE_BASE_LEVEL), 2);
+    EXPECT_EQ(get_parameter(*texture, GL_TEXTURE_MAX_LEVEL), 8);
+    std::size_t resident = 0;
+    for (int size = 64; size >= 1; size /= 2)
+        resident += level_bytes(size);
+    EXPECT_EQ(texture->get_memory_usage(), resident);
+    // The image has no file to read back from, its finer levels stay on the CPU
+    EXPECT_EQ(streamer.get_cpu_memory_usage(), level_bytes(256) + level_bytes(128));
+
+    // Nothing drawn, nothing streamed in
+    streamer.update();
+    EXPECT_EQ(texture->get_base_level(), 2);
+    EXPECT_EQ(streamer.get_memory_usage(), resident);
+
+    std::vector<unsigned char> pixels(level_bytes(64));
+    glGetTexImage(GL_TEXTURE_2D, 2, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    EXPECT_EQ(pixels[0], 100);
+}
+
+TEST_F(TextureStreamerTest, StreamsRequestedLevels) {
+    TextureStreamer streamer;
+    auto texture = streamer.add("stream", make_image(256, 50));
+    ASSERT_NE(texture, nullptr);
+    // Levels arrive one per frame, coarse to fine
+    streamer.request(texture.get(), 300.0f);
+    streamer.update();
+    EXPECT_EQ(texture->get_base_level(), 1);
+    streamer.update();
+    EXPECT_EQ(texture->get_base_level(), 1);
+    streamer.request(texture.get(), 300.0f);
+    streamer.update();
+    EXPECT_EQ(texture->get_base_level(), 0);
+    EXPECT_EQ(get_parameter(*texture, GL_TEXTURE_BASE_LEVEL), 0);
+    EXPECT_EQ(texture->get_memory_usage(), streamer.get_memory_usage());
+
+    // Finer requests than needed are harmless, coarser ones evict nothing without pressure
+    streamer.request_level(texture.get(), 5);
+    streamer.update();
+    EXPECT_EQ(texture->get_base_level(), 0);
+    std::vector<unsigned char> pixels(level_bytes(256));
+    texture->bind(0);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    EXPECT_EQ(pixels[0], 50);
+}
+
+TEST_F(TextureStreamerTest, ReadsFinerLevelsBackFromFile) {
+    const std::string fpath = "texture_streamer_test_reload.ppm";
+    write_ppm(fpath, 256, 70);
+    TextureStreamer streamer;
+    auto texture = streamer.load(fpath);
+    ASSERT_NE(texture, nullptr);
+    EXPECT_EQ(texture->get_base_level(), 2);
+    EXPECT_EQ(streamer.get_cpu_memory_usage(), 0u);
+
+    // The first request reads the file on a worker, the levels follow
+    for (int pass = 0; pass < 2; ++pass) {
+        for (int frame = 0; frame < 8 && texture->get_base_level() > 0; ++frame) {
+            streamer.request_level(texture.get(), 0);
+            streamer.update();
+            core::ThreadPool::get_instance().wait_idle();
+        }
+        EXPECT_EQ(texture->get_base_level(), 0);
+        streamer.update();
+        EXPECT_EQ(streamer.get_cpu_memory_usage(), 0u);
+        // Evicted levels are read again as well
+        streamer.set_budget(0);
+        streamer.update();
+        EXPECT_EQ(texture->get_base_level(), 2);
+        streamer.set_budget(256 * 1024 * 1024);
+    }
+
+    for (int frame = 0; frame < 8 && texture->get_base_level() > 0; ++frame) {
+        streamer.request_level(texture.get(), 0);
+        streamer.update();
+        core::ThreadPool::get_instance().wait_idle();
+    }
+    std::vector<unsigned char> pixels(level_bytes(256));
+    texture->bind(0);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    EXPECT_EQ(pixels[0], 70);
+    std::remove(fpath.c_str());
+}
+
+TEST_F(TextureStreamerTest, MissingFileKeepsCoarseLevels) {
+    const std::string fpath = "texture_streamer_test_missing.ppm";
+    write_ppm(fpath, 256, 90);
+    TextureStreamer streamer;
+    auto texture = streamer.load(fpath);
+    ASSERT_NE(texture, nullptr);
+    std::remove(fpath.c_str());
+    for (int frame = 0; frame < 4; ++frame) {
+        streamer.request_level(texture.get(), 0);
+        streamer.update();
+        core::ThreadPool::get_instance().wait_idle();
+    }
+    EXPECT_EQ(texture->get_base_level(), 2);
+    EXPECT_EQ(streamer.get_cpu_memory_usage(), 0u);
+}
+
+TEST_F(TextureStreamerTest, EvictsUnusedUnderBudget) {
+    TextureStreamer streamer;
+    auto first = streamer.add("first", make_image(256, 10));
+    auto second = streamer.add("second", make_image(256, 20));
+    ASSERT_NE(first, nullptr);
+    ASSERT_NE(second, nullptr);
+    std::size_t low = first->get_memory_usage();
+    // Room for one texture at full resolution, on top of the resident mips
+    streamer.set_budget(2 * low + level_bytes(256) + level_bytes(128));
+    for (int frame = 0; frame < 2; ++frame) {
+        streamer.request_level(first.get(), 0);
+        streamer.update();
+    }
+    EXPECT_EQ(first->get_base_level(), 0);
+
+    // The first texture leaves the screen, the second takes its memory
+    for (int frame = 0; frame < 2; ++frame) {
+        streamer.request_level(second.get(), 0);
+        streamer.update();
+    }
+    EXPECT_EQ(second->get_base_level(), 0);
+    EXPECT_EQ(first->get_base_level(), 2);
+    EXPECT_LE(streamer.get_memory_usage(), streamer.get_budget());
+
+    // Both on screen: the second keeps its levels, the first stays blurry
+    for (int frame = 0; frame < 3; ++frame) {
+        streamer.request_level(first.get(), 0);
+        streamer.request_level(second.get(), 0);
+        streamer.update();
+    }
+    EXPECT_EQ(second->get_base_level(), 0);
+    EXPECT_EQ(first->get_base_level(), 2);
+    EXPECT_EQ(get_parameter(*first, GL_TEXTURE_BASE_LEVEL), 2);
+    EXPECT_LE(streamer.get_memory_usage(), streamer.get_budget());
+}
+
+TEST_F(TextureStreamerTest, LoweredBudgetDegrades) {
+    TextureStreamer streamer;
+    auto texture = streamer.add("stream", make_image(256, 30));
+    ASSERT_NE(texture, nullptr);
+    std::size_t low = texture->get_memory_usage();
+    for (int frame = 0; frame < 2; ++frame) {
+        streamer.request_level(texture.get(), 0);
+        streamer.update();
+    }
+    ASSERT_EQ(texture->get_base_level(), 0);
+    // Even the visible texture gives levels up, never its resident ones
+    streamer.set_budget(0);
+    streamer.request_level(texture.get(), 0);
+    streamer.update();
+    EXPECT_EQ(texture->get_base_level(), 2);
+    EXPECT_EQ(texture->get_memory_usage(), low);
+    EXPECT_EQ(streamer.get_memory_usage(), low);
+}
+
+TEST_F(TextureStreamerTest, UploadBudgetSpreadsLevels) {
+    TextureStreamer streamer;
+    auto first = streamer.add("first", make_image(256, 10));
+    auto second = streamer.add("second", make_image(256, 20));
+    streamer.set_upload_budget(level_bytes(128));
+    streamer.request_level(first.get(), 1);
+    streamer.request_level(second.get(), 1);
+    streamer.update();
+    EXPECT_EQ(first->get_base_level() + second->get_base_level(), 3);
+    streamer.request_level(first.get(), 1);
+    streamer.request_level(second.get(), 1);
+    streamer.update();
+    EXPECT_EQ(first->get_base_level(), 1);
+    EXPECT_EQ(second->get_base_level(), 1);
+}
+
+TEST_F(TextureStreamerTest, ForgetsDestroyedTextures) {
+    TextureStreamer streamer;
+    auto texture = streamer.add("stream", make_image(64, 0));
+    ASSERT_NE(texture, nullptr);
+    // Small textures are fully resident
+    EXPECT_EQ(texture->get_base_level(), 0);
+    EXPECT_EQ(streamer.get_count(), 1u);
+    texture.reset();
+    streamer.update();
+    EXPECT_EQ(streamer.get_count(), 0u);
+    EXPECT_EQ(streamer.get_memory_usage(), 0u);
+}
+
+TEST_F(TextureStreamerTest, StreamsCompressedLevels) {
+    if (!Texture::is_format_supported(BlockFormat::BC7))
+        GTEST_SKIP() << "BC7 not supported by this context";
+    ImageData image = make_image(256, 200);
+    image.compressed = std::make_shared<CompressedImage>();
+    ASSERT_TRUE(BlockEncoder::encode(image, BlockFormat::BC7, *image.compressed));
+    image.pixels.reset();
+    TextureStreamer streamer;
+    while (glGetError() != GL_NO_ERROR) {
+    }
+    auto texture = streamer.add("compressed", image);
+    ASSERT_NE(texture, nullptr);
+    EXPECT_TRUE(texture->is_compressed());
+    EXPECT_EQ(texture->get_base_level(), 2);
+    streamer.request_level(texture.get(), 0);
+    streamer.update();
+    streamer.request_level(texture.get(), 0);
+    streamer.update();
+    EXPECT_EQ(texture->get_base_level(), 0);
+    EXPECT_EQ(texture->get_memory_usage(), image.compressed->size());
+    streamer.set_budget(0);
+    streamer.update();
+    EXPECT_EQ(texture->get_base_level(), 2);
+    EXPECT_EQ(glGetError(), static_cast<GLenum>(GL_NO_ERROR));
+
+    std::vector<unsigned char> pixels(level_bytes(64));
+    texture->bind(0);
+    glGetTexImage(GL_TEXTURE_2D, 2, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    EXPECT_NEAR(pixels[0], 200, 4);
+}
+
+#endif
+
+} // namespace renderer
+
+} // namespace lmgl
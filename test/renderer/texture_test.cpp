@@ -5,6 +5,9 @@
 #endif
 #include "lmgl/renderer/texture.hpp"
 
+#include <cstdio>
+#include <fstream>
+#include <thread>
 #include <vector>
 
 namespace lmgl {
@@ -27,8 +30,103 @@ class TextureTest : public ::testing::Test {
     }
 };
 
+// Writes a binary PPM, the smallest format stb_image decodes
+static void write_ppm(const std::string &fpath, int width, int height) {
+    std::ofstream file(fpath, std::ios::binary);
+    file << "P6\n" << width << " " << height << "\n255\n";
+    for (int i = 0; i < width * height; ++i) {
+        unsigned char pixel[3] = {static_cast<unsigned char>(i), 128, 255};
+        file.write(reinterpret_cast<const char *>(pixel), sizeof(pixel));
+    }
+}
+
+TEST_F(TextureTest, DecodeReadsPixels) {
+    const std::string fpath = "texture_test_decode.ppm";
+    write_ppm(fpath, 3, 2);
+    ImageData image;
+    ASSERT_TRUE(Texture::decode(fpath, image));
+    EXPECT_EQ(image.width, 3);
+    EXPECT_EQ(image.height, 2);
+    EXPECT_EQ(image.channels, 3);
+    EXPECT_EQ(image.size(), 18u);
+    ASSERT_NE(image.pixels, nullptr);
+    EXPECT_EQ(image.pixels.get()[3], 1);
+    EXPECT_EQ(image.pixels.get()[4], 128);
+    std::remove(fpath.c_str());
+}
+
+TEST_F(TextureTest, DecodeFlipIsPerThread) {
+    const std::string fpath = "texture_test_flip.ppm";
+    write_ppm(fpath, 1, 2);
+    ImageData flipped;
+    ImageData upright;
+    // Concurrent decodes with different settings must not see each other's flip
+    std::thread worker([&]() { Texture::decode(fpath, flipped, true); });
+    Texture::decode(fpath, upright, false);
+    worker.join();
+    ASSERT_NE(flipped.pixels, nullptr);
+    ASSERT_NE(upright.pixels, nullptr);
+    EXPECT_EQ(upright.pixels.get()[0], 0);
+    EXPECT_EQ(flipped.pixels.get()[0], 1);
+    std::remove(fpath.c_str());
+}
+
+TEST_F(TextureTest, DecodeMissingFileFails) {
+    ImageData image;
+    EXPECT_FALSE(Texture::decode("non_existent_file.png", image));
+    EXPECT_EQ(image.pixels, nullptr);
+    EXPECT_EQ(image.size(), 0u);
+}
+
 #ifndef TEST_HEADLESS
 
+TEST_F(TextureTest, CreateFromDecodedImage) {
+    // Odd RGB width, rows are not 4-byte aligned
+    const std::string fpath = "texture_test_upload.ppm";
+    write_ppm(fpath, 3, 3);
+    ImageData image;
+    ASSERT_TRUE(Texture::decode(fpath, image));
+    Texture texture(fpath, image);
+    EXPECT_GT(texture.get_id(), 0u);
+    EXPECT_EQ(texture.get_width(), 3);
+    EXPECT_EQ(texture.get_height(), 3);
+    std::vector<unsigned char> pixels(3 * 3 * 4);
+    texture.bind(0);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    // Last pixel of the second row
+    EXPECT_EQ(pixels[5 * 4], 5);
+    EXPECT_EQ(pixels[5 * 4 + 1], 128);
+    EXPECT_EQ(pixels[5 * 4 + 2], 255);
+    std::remove(fpath.c_str());
+
+    Texture empty(fpath, ImageData());
+    EXPECT_EQ(empty.get_id(), 0u);
+}
+
+TEST_F(TextureTest, PlaceholderIsReplacedInPlace) {
+    auto texture = Texture::create_placeholder("texture_test_placeholder.ppm");
+    ASSERT_NE(texture, nullptr);
+    EXPECT_TRUE(texture->is_placeholder());
+    EXPECT_GT(texture->get_id(), 0u);
+    EXPECT_EQ(texture->get_width(), 1);
+    EXPECT_EQ(texture->get_height(), 1);
+    unsigned int id = texture->get_id();
+
+    texture->set_image(ImageData());
+    EXPECT_TRUE(texture->is_placeholder());
+
+    const std::string fpath = "texture_test_placeholder.ppm";
+    write_ppm(fpath, 4, 2);
+    ImageData image;
+    ASSERT_TRUE(Texture::decode(fpath, image));
+    texture->set_image(image);
+    EXPECT_FALSE(texture->is_placeholder());
+    EXPECT_EQ(texture->get_id(), id);
+    EXPECT_EQ(texture->get_width(), 4);
+    EXPECT_EQ(texture->get_height(), 2);
+    std::remove(fpath.c_str());
+}
+
 TEST_F(TextureTest, CreateEmptyTexture) {
     int width = 128;
     int height = 128;
@@ -92,6 +92,35 @@ TEST_F(VertexArrayTest, MultipleVertexBuffers) {
     EXPECT_EQ(vao->get_vertex_buffers().size(), 2);
 }
 
+TEST_F(VertexArrayTest, AttributeLocationsContinueAcrossBuffers) {
+    float positions[] = {0.0f, 0.0f, 0.0f};
+    auto p_vbo = std::make_shared<VertexBuffer>(positions, sizeof(positions));
+    p_vbo->set_layout({{ShaderDataType::Float3, "a_Position"}, {ShaderDataType::Float2, "a_TexCoords"}});
+    float matrix[16] = {};
+    auto m_vbo = std::make_shared<VertexBuffer>(matrix, sizeof(matrix));
+    m_vbo->set_layout({{ShaderDataType::Mat4, "a_InstanceModel"}});
+    auto vao = std::make_shared<VertexArray>();
+    vao->add_vertex_buffer(p_vbo);
+    EXPECT_EQ(vao->get_next_attribute_location(), 2u);
+    vao->add_vertex_buffer(m_vbo, 1);
+    // One location per matrix column
+    EXPECT_EQ(vao->get_next_attribute_location(), 6u);
+}
+
+TEST_F(VertexArrayTest, AddStreamBuffer) {
+    float positions[] = {0.0f, 0.0f, 0.0f};
+    auto vbo = std::make_shared<VertexBuffer>(positions, sizeof(positions));
+    vbo->set_layout({{ShaderDataType::Float3, "a_Position"}});
+    auto stream = std::make_shared<StreamBuffer>(1024);
+    auto vao = std::make_shared<VertexArray>();
+    vao->add_vertex_buffer(vbo);
+    vao->add_stream_buffer(stream, {{ShaderDataType::Mat4, "a_InstanceModel"}}, 1);
+    EXPECT_EQ(vao->get_next_attribute_location(), 5u);
+    ASSERT_EQ(vao->get_stream_buffers().size(), 1u);
+    EXPECT_EQ(vao->get_stream_buffers()[0], stream);
+    EXPECT_EQ(vao->get_vertex_buffers().size(), 1u);
+}
+
 TEST_F(VertexArrayTest, BindUnbind) {
     auto vao = std::make_shared<VertexArray>();
 
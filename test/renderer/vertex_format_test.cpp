@@ -0,0 +1,125 @@
+#include <gtest/gtest.h>
+
+#ifndef TEST_HEADLESS
+#include "lmgl/core/engine.hpp"
+#include "lmgl/renderer/vertex_array.hpp"
+#include <glad/glad.h>
+#endif
+#include "lmgl/renderer/vertex_format.hpp"
+#include "lmgl/scene/vertex.hpp"
+
+namespace lmgl {
+
+namespace renderer {
+
+// Deliberately broken formats, checked with is_valid_vertex_format()
+struct WrongSizeVertex {
+    glm::vec3 position;
+};
+
+struct OverlappingVertex {
+    glm::vec3 position;
+    glm::vec4 color;
+};
+
+template <> struct VertexFormat<WrongSizeVertex> {
+    static constexpr VertexAttribute attributes[] = {
+        LMGL_VERTEX_ATTRIBUTE(WrongSizeVertex, position, ShaderDataType::Float4, 0, false)};
+};
+
+template <> struct VertexFormat<OverlappingVertex> {
+    static constexpr VertexAttribute attributes[] = {
+        LMGL_VERTEX_ATTRIBUTE(OverlappingVertex, position, ShaderDataType::Float3, 0, false),
+        LMGL_VERTEX_ATTRIBUTE(OverlappingVertex, color, ShaderDataType::Float4, 0, false)};
+};
+
+static_assert(is_valid_vertex_format<scene::Vertex>(), "Vertex format is inconsistent");
+static_assert(is_valid_vertex_format<scene::PackedVertex>(), "PackedVertex format is inconsistent");
+static_assert(is_valid_vertex_format<scene::SkinnedVertex>(), "SkinnedVertex format is inconsistent");
+static_assert(!is_valid_vertex_format<WrongSizeVertex>(), "Size mismatch must be rejected");
+static_assert(!is_valid_vertex_format<OverlappingVertex>(), "Shared locations must be rejected");
+
+class VertexFormatTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        // Setup code before each test
+#ifndef TEST_HEADLESS
+        auto &engine = core::Engine::get_instance();
+        if (!engine.get_window())
+            engine.init(800, 600, "Vertex Format Test");
+#endif
+    }
+
+    void TearDown() override {
+        // Cleanup code after each test
+    }
+};
+
+TEST_F(VertexFormatTest, LayoutUsesStructStride) {
+    EXPECT_EQ(make_vertex_layout<scene::Vertex>().get_stride(), sizeof(scene::Vertex));
+    EXPECT_EQ(make_vertex_layout<scene::PositionVertex>().get_stride(), 12u);
+    EXPECT_EQ(make_vertex_layout<scene::PositionNormalUVVertex>().get_stride(), 32u);
+    EXPECT_EQ(make_vertex_layout<scene::UIVertex>().get_stride(), 16u);
+}
+
+TEST_F(VertexFormatTest, LayoutKeepsOffsetsAndLocations) {
+    auto layout = make_vertex_layout<scene::PositionNormalUVVertex>();
+    const auto &elements = layout.get_elements();
+    ASSERT_EQ(elements.size(), 3u);
+    EXPECT_EQ(elements[1].offset, offsetof(scene::PositionNormalUVVertex, normal));
+    EXPECT_EQ(elements[2].offset, offsetof(scene::PositionNormalUVVertex, uvs));
+    EXPECT_EQ(elements[0].location, 0);
+    EXPECT_EQ(elements[1].location, 1);
+    // UVs keep the location used by the full Vertex, skipping color
+    EXPECT_EQ(elements[2].location, 3);
+}
+
+TEST_F(VertexFormatTest, SkinnedVertexUsesIntegerJoints) {
+    auto layout = make_vertex_layout<scene::SkinnedVertex>();
+    const auto &joints = layout.get_elements()[4];
+    const auto &weights = layout.get_elements()[5];
+    EXPECT_EQ(joints.type, ShaderDataType::UByte4I);
+    EXPECT_FALSE(joints.normalized);
+    EXPECT_TRUE(joints.is_integer());
+    EXPECT_TRUE(weights.normalized);
+    EXPECT_EQ(weights.location, 11);
+}
+
+#ifndef TEST_HEADLESS
+
+TEST_F(VertexFormatTest, VertexArrayHonorsExplicitLocations) {
+    std::vector<scene::PositionNormalUVVertex> vertices(3);
+    auto vbo = std::make_shared<VertexBuffer>(vertices.data(), vertices.size() * sizeof(vertices[0]));
+    vbo->set_layout(make_vertex_layout<scene::PositionNormalUVVertex>());
+    VertexArray vao;
+    vao.add_vertex_buffer(vbo);
+    EXPECT_EQ(vao.get_next_attribute_location(), 4u);
+    vao.bind();
+    int enabled = 1;
+    glGetVertexAttribiv(2, GL_VERTEX_ATTRIB_ARRAY_ENABLED, &enabled);
+    EXPECT_EQ(enabled, 0);
+    glGetVertexAttribiv(3, GL_VERTEX_ATTRIB_ARRAY_ENABLED, &enabled);
+    EXPECT_EQ(enabled, 1);
+    vao.unbind();
+}
+
+TEST_F(VertexFormatTest, SkinnedJointsAreIntegerAttributes) {
+    std::vector<scene::SkinnedVertex> vertices(3);
+    auto vbo = std::make_shared<VertexBuffer>(vertices.data(), vertices.size() * sizeof(vertices[0]));
+    vbo->set_layout(make_vertex_layout<scene::SkinnedVertex>());
+    VertexArray vao;
+    vao.add_vertex_buffer(vbo);
+    vao.bind();
+    int integer = 0;
+    glGetVertexAttribiv(10, GL_VERTEX_ATTRIB_ARRAY_INTEGER, &integer);
+    EXPECT_EQ(integer, 1);
+    glGetVertexAttribiv(11, GL_VERTEX_ATTRIB_ARRAY_INTEGER, &integer);
+    EXPECT_EQ(integer, 0);
+    vao.unbind();
+}
+
+#endif
+
+} // namespace renderer
+
+} // namespace lmgl
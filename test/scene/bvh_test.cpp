@@ -0,0 +1,106 @@
+#include "lmgl/scene/bvh.hpp"
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace lmgl {
+
+namespace scene {
+
+class BVHTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        // BVH tests are CPU-only, no OpenGL needed
+        // Flat 20x20 grid in the XY plane, from (0, 0) to (20, 20)
+        const unsigned int size = 20;
+        for (unsigned int y = 0; y <= size; ++y) {
+            for (unsigned int x = 0; x <= size; ++x)
+                positions.push_back(glm::vec3(static_cast<float>(x), static_cast<float>(y), 0.0f));
+        }
+        for (unsigned int y = 0; y < size; ++y) {
+            for (unsigned int x = 0; x < size; ++x) {
+                unsigned int i0 = y * (size + 1) + x;
+                unsigned int i1 = i0 + 1;
+                unsigned int i2 = i0 + size + 1;
+                unsigned int i3 = i2 + 1;
+                indices.insert(indices.end(), {i0, i1, i2, i1, i3, i2});
+            }
+        }
+    }
+
+    std::vector<glm::vec3> positions;
+    std::vector<unsigned int> indices;
+};
+
+TEST_F(BVHTest, EmptyByDefault) {
+    TriangleBVH bvh;
+    EXPECT_TRUE(bvh.empty());
+    RayHit hit;
+    EXPECT_FALSE(bvh.intersect(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f), hit));
+    bvh.build(positions.data(), positions.size(), sizeof(glm::vec3), {});
+    EXPECT_TRUE(bvh.empty());
+}
+
+TEST_F(BVHTest, BuildCoversAllTriangles) {
+    TriangleBVH bvh;
+    bvh.build(positions.data(), positions.size(), sizeof(glm::vec3), indices);
+    ASSERT_FALSE(bvh.empty());
+    EXPECT_EQ(bvh.get_bounds().min, glm::vec3(0.0f));
+    EXPECT_EQ(bvh.get_bounds().max, glm::vec3(20.0f, 20.0f, 0.0f));
+    // 800 triangles in leaves of at most 4 need at least 200 leaves
+    EXPECT_GE(bvh.get_node_count(), 2 * 200u - 1);
+    EXPECT_GT(bvh.get_memory_usage(), positions.size() * sizeof(glm::vec3));
+}
+
+TEST_F(BVHTest, IntersectFindsTriangle) {
+    TriangleBVH bvh;
+    bvh.build(positions.data(), positions.size(), sizeof(glm::vec3), indices);
+    RayHit hit;
+    ASSERT_TRUE(bvh.intersect(glm::vec3(3.25f, 7.25f, 5.0f), glm::vec3(0.0f, 0.0f, -1.0f), hit));
+    EXPECT_FLOAT_EQ(hit.distance, 5.0f);
+    // Lower-left triangle of cell (3, 7)
+    EXPECT_EQ(hit.triangle, (7u * 20u + 3u) * 2u);
+    const glm::vec3 &p0 = positions[indices[hit.triangle * 3]];
+    const glm::vec3 &p1 = positions[indices[hit.triangle * 3 + 1]];
+    const glm::vec3 &p2 = positions[indices[hit.triangle * 3 + 2]];
+    glm::vec3 point = p0 + (p1 - p0) * hit.barycentric.x + (p2 - p0) * hit.barycentric.y;
+    EXPECT_NEAR(point.x, 3.25f, 1e-5f);
+    EXPECT_NEAR(point.y, 7.25f, 1e-5f);
+
+    // Back side and unnormalized direction
+    ASSERT_TRUE(bvh.intersect(glm::vec3(3.25f, 7.25f, -2.0f), glm::vec3(0.0f, 0.0f, 2.0f), hit));
+    EXPECT_FLOAT_EQ(hit.distance, 1.0f);
+}
+
+TEST_F(BVHTest, IntersectMisses) {
+    TriangleBVH bvh;
+    bvh.build(positions.data(), positions.size(), sizeof(glm::vec3), indices);
+    RayHit hit;
+    EXPECT_FALSE(bvh.intersect(glm::vec3(30.0f, 5.0f, 5.0f), glm::vec3(0.0f, 0.0f, -1.0f), hit));
+    EXPECT_FALSE(bvh.intersect(glm::vec3(5.0f, 5.0f, 5.0f), glm::vec3(0.0f, 0.0f, 1.0f), hit));
+    EXPECT_FALSE(bvh.intersect(glm::vec3(5.0f, 5.0f, 5.0f), glm::vec3(0.0f, 0.0f, -1.0f), hit, 4.0f));
+}
+
+TEST_F(BVHTest, IntersectReturnsClosestHit) {
+    // A second grid above the first one, sharing the same triangles
+    std::vector<glm::vec3> layered = positions;
+    std::vector<unsigned int> layered_indices = indices;
+    unsigned int offset = static_cast<unsigned int>(positions.size());
+    for (const auto &p : positions)
+        layered.push_back(p + glm::vec3(0.0f, 0.0f, 2.0f));
+    for (unsigned int index : indices)
+        layered_indices.push_back(index + offset);
+    TriangleBVH bvh;
+    bvh.build(layered.data(), layered.size(), sizeof(glm::vec3), layered_indices);
+    RayHit hit;
+    ASSERT_TRUE(bvh.intersect(glm::vec3(10.5f, 10.2f, 5.0f), glm::vec3(0.0f, 0.0f, -1.0f), hit));
+    EXPECT_FLOAT_EQ(hit.distance, 3.0f);
+    EXPECT_GE(hit.triangle, static_cast<unsigned int>(indices.size() / 3));
+    ASSERT_TRUE(bvh.intersect(glm::vec3(10.5f, 10.2f, -5.0f), glm::vec3(0.0f, 0.0f, 1.0f), hit));
+    EXPECT_FLOAT_EQ(hit.distance, 5.0f);
+    EXPECT_LT(hit.triangle, static_cast<unsigned int>(indices.size() / 3));
+}
+
+} // namespace scene
+
+} // namespace lmgl
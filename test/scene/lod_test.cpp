@@ -212,6 +212,23 @@ TEST_F(LODTest, GetMeshMultipleLevels) {
 #endif
 }
 
+TEST_F(LODTest, GetLevelIndex) {
+    LOD lod;
+    EXPECT_EQ(lod.get_level_index(100.0f), 0u);
+
+#ifndef TEST_HEADLESS
+    std::vector<Vertex> vertices = {Vertex()};
+    std::vector<unsigned int> indices = {0};
+    lod.add_level(std::make_shared<Mesh>(vertices, indices, shader), 10.0f);
+    lod.add_level(std::make_shared<Mesh>(vertices, indices, shader), 50.0f);
+
+    EXPECT_EQ(lod.get_level_index(100.0f), 0u);  // distance = 10 (boundary)
+    EXPECT_EQ(lod.get_level_index(121.0f), 1u);  // distance = 11
+    EXPECT_EQ(lod.get_level_index(10000.0f), 1u); // beyond all thresholds
+    EXPECT_EQ(lod.get_level(lod.get_level_index(121.0f)).mesh, lod.get_mesh(121.0f));
+#endif
+}
+
 TEST_F(LODTest, GetMeshWithPositions) {
     std::vector<Vertex> vertices = {Vertex()};
     std::vector<unsigned int> indices = {0};
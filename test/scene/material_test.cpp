@@ -2,6 +2,12 @@
 #include <glm/glm.hpp>
 #include <gtest/gtest.h>
 
+#ifndef TEST_HEADLESS
+#include "lmgl/core/engine.hpp"
+#include "lmgl/renderer/shader.hpp"
+#include "lmgl/renderer/texture.hpp"
+#endif
+
 namespace lmgl {
 
 namespace scene {
@@ -104,6 +110,46 @@ TEST_F(MaterialTest, DielectricWorkflow) {
     EXPECT_FLOAT_EQ(material->get_roughness(), 0.7f);
 }
 
+#ifndef TEST_HEADLESS
+
+TEST_F(MaterialTest, FeaturesFollowTextureMaps) {
+    auto &engine = core::Engine::get_instance();
+    if (!engine.get_window())
+        engine.init(800, 600, "Material Test");
+    EXPECT_EQ(material->get_features(), 0u);
+    auto texture = std::make_shared<renderer::Texture>(4, 4);
+    // Each map sets its own bit, on top of those set before
+    uint32_t expected = 0;
+    material->set_albedo_map(texture);
+    expected |= renderer::Shader::AlbedoMap;
+    EXPECT_EQ(material->get_features(), expected);
+    material->set_normal_map(texture);
+    expected |= renderer::Shader::NormalMap;
+    EXPECT_EQ(material->get_features(), expected);
+    material->set_metallic_map(texture);
+    expected |= renderer::Shader::MetallicMap;
+    EXPECT_EQ(material->get_features(), expected);
+    material->set_roughness_map(texture);
+    expected |= renderer::Shader::RoughnessMap;
+    EXPECT_EQ(material->get_features(), expected);
+    material->set_ao_map(texture);
+    expected |= renderer::Shader::AoMap;
+    EXPECT_EQ(material->get_features(), expected);
+    material->set_emissive_map(texture);
+    expected |= renderer::Shader::EmissiveMap;
+    EXPECT_EQ(material->get_features(), expected);
+
+    // Removing a map clears its bit only
+    material->set_normal_map(nullptr);
+    EXPECT_EQ(material->get_features(), expected & ~static_cast<uint32_t>(renderer::Shader::NormalMap));
+    // Scene features are never reported by a material
+    EXPECT_EQ(material->get_features() & (renderer::Shader::DirectionalShadow | renderer::Shader::PointShadow |
+                                          renderer::Shader::EnvironmentMap),
+              0u);
+}
+
+#endif
+
 } // namespace scene
 
 } // namespace lmgl
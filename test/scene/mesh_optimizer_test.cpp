@@ -0,0 +1,167 @@
+#include "lmgl/scene/mesh_optimizer.hpp"
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <set>
+#include <vector>
+
+namespace lmgl {
+
+namespace scene {
+
+class MeshOptimizerTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        // Optimizer tests are CPU-only, no OpenGL needed
+        const unsigned int size = 32;
+        for (unsigned int y = 0; y <= size; ++y) {
+            for (unsigned int x = 0; x <= size; ++x) {
+                Vertex vertex;
+                vertex.position = glm::vec3(static_cast<float>(x), static_cast<float>(y), 0.0f);
+                grid_vertices.push_back(vertex);
+            }
+        }
+        // Column-major triangle order makes a poor use of the cache
+        for (unsigned int x = 0; x < size; ++x) {
+            for (unsigned int y = 0; y < size; ++y) {
+                unsigned int i0 = y * (size + 1) + x;
+                unsigned int i1 = i0 + 1;
+                unsigned int i2 = i0 + size + 1;
+                unsigned int i3 = i2 + 1;
+                grid_indices.insert(grid_indices.end(), {i0, i1, i2, i1, i3, i2});
+            }
+        }
+    }
+
+    // Triangles as sorted vertex triples, to compare meshes regardless of order
+    static std::multiset<std::array<unsigned int, 3>> triangles(const std::vector<unsigned int> &indices) {
+        std::multiset<std::array<unsigned int, 3>> result;
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+            std::array<unsigned int, 3> triangle = {indices[i], indices[i + 1], indices[i + 2]};
+            // Rotate so that the smallest index comes first, keeping the winding
+            std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+            result.insert(triangle);
+        }
+        return result;
+    }
+
+    std::vector<Vertex> grid_vertices;
+    std::vector<unsigned int> grid_indices;
+};
+
+TEST_F(MeshOptimizerTest, AnalyzeVertexCache) {
+    std::vector<unsigned int> indices = {0, 1, 2, 2, 1, 3};
+    auto statistics = MeshOptimizer::analyze_vertex_cache(indices, 4);
+    EXPECT_EQ(statistics.vertices_transformed, 4u);
+    EXPECT_FLOAT_EQ(statistics.acmr, 2.0f);
+    EXPECT_FLOAT_EQ(statistics.atvr, 1.0f);
+
+    auto empty = MeshOptimizer::analyze_vertex_cache({}, 0);
+    EXPECT_EQ(empty.vertices_transformed, 0u);
+    EXPECT_FLOAT_EQ(empty.acmr, 0.0f);
+}
+
+TEST_F(MeshOptimizerTest, AnalyzeVertexCacheEvicts) {
+    // Two triangles sharing vertices 0 and 1, separated by enough vertices to evict them
+    std::vector<unsigned int> indices = {0, 1, 2, 3, 4, 5, 0, 1, 6};
+    EXPECT_EQ(MeshOptimizer::analyze_vertex_cache(indices, 7, 16).vertices_transformed, 7u);
+    EXPECT_EQ(MeshOptimizer::analyze_vertex_cache(indices, 7, 3).vertices_transformed, 9u);
+}
+
+TEST_F(MeshOptimizerTest, VertexCacheKeepsTrianglesAndImprovesAcmr) {
+    unsigned int vertex_count = static_cast<unsigned int>(grid_vertices.size());
+    auto optimized = MeshOptimizer::optimize_vertex_cache(grid_indices, vertex_count);
+    ASSERT_EQ(optimized.size(), grid_indices.size());
+    EXPECT_EQ(triangles(optimized), triangles(grid_indices));
+    auto before = MeshOptimizer::analyze_vertex_cache(grid_indices, vertex_count);
+    auto after = MeshOptimizer::analyze_vertex_cache(optimized, vertex_count);
+    EXPECT_LT(after.acmr, before.acmr);
+    EXPECT_LT(after.acmr, 0.8f);
+}
+
+TEST_F(MeshOptimizerTest, VertexCacheHandlesDegenerateTriangles) {
+    std::vector<unsigned int> indices = {0, 0, 1, 1, 2, 3, 2, 2, 2};
+    auto optimized = MeshOptimizer::optimize_vertex_cache(indices, 4);
+    EXPECT_EQ(triangles(optimized), triangles(indices));
+}
+
+TEST_F(MeshOptimizerTest, OverdrawKeepsTrianglesWithinThreshold) {
+    unsigned int vertex_count = static_cast<unsigned int>(grid_vertices.size());
+    auto cache_optimized = MeshOptimizer::optimize_vertex_cache(grid_indices, vertex_count);
+    auto optimized = MeshOptimizer::optimize_overdraw(cache_optimized, &grid_vertices[0].position, vertex_count,
+                                                      sizeof(Vertex), 1.05f);
+    ASSERT_EQ(optimized.size(), cache_optimized.size());
+    EXPECT_EQ(triangles(optimized), triangles(cache_optimized));
+    auto reference = MeshOptimizer::analyze_vertex_cache(cache_optimized, vertex_count);
+    auto after = MeshOptimizer::analyze_vertex_cache(optimized, vertex_count);
+    // Cluster cuts cost a few misses each, but must stay close to the cache-optimized order
+    EXPECT_LT(after.acmr, reference.acmr * 1.25f);
+}
+
+TEST_F(MeshOptimizerTest, OverdrawDrawsOutwardClustersFirst) {
+    // A triangle facing the mesh centre, then one facing away from it, with no shared vertices
+    std::vector<Vertex> vertices(6);
+    vertices[0].position = glm::vec3(0.0f, 0.0f, 0.1f);
+    vertices[1].position = glm::vec3(1.0f, 0.0f, 0.1f);
+    vertices[2].position = glm::vec3(0.0f, 1.0f, 0.1f);
+    vertices[3].position = glm::vec3(0.0f, 0.0f, 5.0f);
+    vertices[4].position = glm::vec3(1.0f, 0.0f, 5.0f);
+    vertices[5].position = glm::vec3(0.0f, 1.0f, 5.0f);
+    std::vector<unsigned int> indices = {3, 5, 4, 0, 2, 1};
+    auto optimized = MeshOptimizer::optimize_overdraw(indices, &vertices[0].position, 6, sizeof(Vertex));
+    EXPECT_EQ(optimized, (std::vector<unsigned int>{0, 2, 1, 3, 5, 4}));
+}
+
+TEST_F(MeshOptimizerTest, VertexFetchOrdersByFirstUse) {
+    std::vector<Vertex> vertices(4);
+    for (unsigned int i = 0; i < 4; ++i)
+        vertices[i].position = glm::vec3(static_cast<float>(i));
+    std::vector<unsigned int> indices = {3, 1, 2, 2, 1, 3};
+    MeshOptimizer::optimize_vertex_fetch(vertices, indices);
+    EXPECT_EQ(indices, (std::vector<unsigned int>{0, 1, 2, 2, 1, 0}));
+    // Vertex 0 was never referenced and is dropped
+    ASSERT_EQ(vertices.size(), 3u);
+    EXPECT_EQ(vertices[0].position, glm::vec3(3.0f));
+    EXPECT_EQ(vertices[1].position, glm::vec3(1.0f));
+    EXPECT_EQ(vertices[2].position, glm::vec3(2.0f));
+}
+
+TEST_F(MeshOptimizerTest, OptimizeReportsImprovement) {
+    std::vector<Vertex> vertices = grid_vertices;
+    std::vector<unsigned int> indices = grid_indices;
+    auto report = MeshOptimizer::optimize(vertices, indices);
+    EXPECT_EQ(indices.size(), grid_indices.size());
+    EXPECT_EQ(vertices.size(), grid_vertices.size());
+    EXPECT_LT(report.after.acmr, report.before.acmr);
+    EXPECT_LT(report.after.atvr, report.before.atvr);
+    // Every optimized triangle maps back to an input triangle with the same positions
+    std::multiset<std::array<float, 9>> input_positions;
+    std::multiset<std::array<float, 9>> output_positions;
+    auto collect = [](const std::vector<Vertex> &v, const std::vector<unsigned int> &idx,
+                      std::multiset<std::array<float, 9>> &out) {
+        for (size_t i = 0; i < idx.size(); i += 3) {
+            std::array<std::array<float, 3>, 3> corners;
+            for (int k = 0; k < 3; ++k)
+                corners[k] = {v[idx[i + k]].position.x, v[idx[i + k]].position.y, v[idx[i + k]].position.z};
+            std::rotate(corners.begin(), std::min_element(corners.begin(), corners.end()), corners.end());
+            out.insert({corners[0][0], corners[0][1], corners[0][2], corners[1][0], corners[1][1], corners[1][2],
+                        corners[2][0], corners[2][1], corners[2][2]});
+        }
+    };
+    collect(grid_vertices, grid_indices, input_positions);
+    collect(vertices, indices, output_positions);
+    EXPECT_EQ(input_positions, output_positions);
+}
+
+TEST_F(MeshOptimizerTest, OptimizeSkipsNonTriangleLists) {
+    std::vector<Vertex> vertices(4);
+    std::vector<unsigned int> indices = {0, 1, 2, 3};
+    auto report = MeshOptimizer::optimize(vertices, indices);
+    EXPECT_EQ(indices, (std::vector<unsigned int>{0, 1, 2, 3}));
+    EXPECT_FLOAT_EQ(report.after.acmr, report.before.acmr);
+}
+
+} // namespace scene
+
+} // namespace lmgl
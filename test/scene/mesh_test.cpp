@@ -3,9 +3,15 @@
 
 #include "lmgl/scene/mesh.hpp"
 
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+
 #ifndef TEST_HEADLESS
 #include "lmgl/core/engine.hpp"
 #include "lmgl/renderer/shader.hpp"
+#include <glad/glad.h>
 #endif
 
 namespace lmgl {
@@ -45,8 +51,355 @@ TEST_F(MeshTest, VertexCustomConstruction) {
     EXPECT_EQ(v.uvs, glm::vec2(0.5f, 0.5f));
 }
 
+TEST_F(MeshTest, PackedVertexIsCompact) {
+    EXPECT_EQ(sizeof(PackedVertex), 28u);
+    EXPECT_EQ(Mesh::get_packed_vertex_layout().get_stride(), sizeof(PackedVertex));
+    EXPECT_EQ(Mesh::get_vertex_layout().get_stride(), sizeof(Vertex));
+}
+
+TEST_F(MeshTest, PackVerticesRoundTrip) {
+    Vertex v(glm::vec3(1.5f, -2.0f, 3.25f), glm::normalize(glm::vec3(0.3f, -0.4f, -0.8f)),
+             glm::vec4(1.0f, 0.5f, 0.0f, 1.0f), glm::vec2(0.25f, 0.75f));
+    v.tangent = glm::normalize(glm::cross(v.normal, glm::vec3(0.0f, 1.0f, 0.0f)));
+    v.bitangent = -glm::cross(v.normal, v.tangent);
+    auto packed = Mesh::pack_vertices({v});
+    ASSERT_EQ(packed.size(), 1u);
+    EXPECT_EQ(packed[0].position, v.position);
+
+    // Octahedral decode, as done in the shader
+    glm::vec2 e = glm::unpackSnorm2x16(packed[0].normal);
+    glm::vec3 n(e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y));
+    float t = std::max(-n.z, 0.0f);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    n = glm::normalize(n);
+    EXPECT_NEAR(n.x, v.normal.x, 1e-3f);
+    EXPECT_NEAR(n.y, v.normal.y, 1e-3f);
+    EXPECT_NEAR(n.z, v.normal.z, 1e-3f);
+
+    glm::vec4 color = glm::unpackUnorm4x8(packed[0].color);
+    EXPECT_NEAR(color.y, 0.5f, 1.0f / 255.0f);
+    glm::vec2 uv = glm::unpackHalf2x16(packed[0].uvs);
+    EXPECT_FLOAT_EQ(uv.x, 0.25f);
+    EXPECT_FLOAT_EQ(uv.y, 0.75f);
+    glm::vec4 tangent = glm::unpackSnorm3x10_1x2(packed[0].tangent);
+    EXPECT_NEAR(tangent.x, v.tangent.x, 2e-3f);
+    EXPECT_NEAR(tangent.z, v.tangent.z, 2e-3f);
+    // Bitangent was flipped, the sign lands in w
+    EXPECT_FLOAT_EQ(tangent.w, -1.0f);
+}
+
+TEST_F(MeshTest, UnpackVerticesRoundTrip) {
+    Vertex v(glm::vec3(1.5f, -2.0f, 3.25f), glm::normalize(glm::vec3(0.3f, -0.4f, -0.8f)),
+             glm::vec4(1.0f, 0.5f, 0.0f, 1.0f), glm::vec2(0.25f, 0.75f));
+    v.tangent = glm::normalize(glm::cross(v.normal, glm::vec3(0.0f, 1.0f, 0.0f)));
+    v.bitangent = -glm::cross(v.normal, v.tangent);
+    auto unpacked = Mesh::unpack_vertices(Mesh::pack_vertices({v}));
+    ASSERT_EQ(unpacked.size(), 1u);
+    EXPECT_EQ(unpacked[0].position, v.position);
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_NEAR(unpacked[0].normal[i], v.normal[i], 1e-3f);
+        EXPECT_NEAR(unpacked[0].tangent[i], v.tangent[i], 2e-3f);
+        EXPECT_NEAR(unpacked[0].bitangent[i], v.bitangent[i], 5e-3f);
+    }
+    EXPECT_NEAR(unpacked[0].color.y, 0.5f, 1.0f / 255.0f);
+    EXPECT_FLOAT_EQ(unpacked[0].uvs.x, 0.25f);
+}
+
 #ifndef TEST_HEADLESS
 
+TEST_F(MeshTest, PackedMeshMatchesUnpackedAttributes) {
+    const char *vert = R"(
+#version 410 core
+layout(location = 0) in vec3 a_Position;
+layout(location = 1) in vec3 a_Normal;
+layout(location = 2) in vec4 a_Color;
+layout(location = 3) in vec2 a_TexCoord;
+layout(location = 4) in vec4 a_Tangent;
+uniform int u_PackedVertex;
+out vec4 v_Value;
+void main() {
+    vec3 n = a_Normal;
+    if (u_PackedVertex == 1) {
+        n = vec3(a_Normal.xy, 1.0 - abs(a_Normal.x) - abs(a_Normal.y));
+        n = normalize(n);
+    }
+    v_Value = vec4(n.z, a_TexCoord.x, a_Tangent.x, a_Color.r);
+    gl_Position = vec4(a_Position, 1.0);
+}
+    )";
+    const char *frag = R"(
+#version 410 core
+in vec4 v_Value;
+out vec4 FragColor;
+void main() { FragColor = v_Value; }
+    )";
+    auto shader = std::make_shared<renderer::Shader>(vert, frag);
+    std::vector<Vertex> vertices = {
+        {glm::vec3(-1.0f, -1.0f, 0.0f), glm::vec3(0, 0, 1), glm::vec4(0.6f, 0, 0, 1), glm::vec2(0.25f, 0.0f)},
+        {glm::vec3(3.0f, -1.0f, 0.0f), glm::vec3(0, 0, 1), glm::vec4(0.6f, 0, 0, 1), glm::vec2(0.25f, 0.0f)},
+        {glm::vec3(-1.0f, 3.0f, 0.0f), glm::vec3(0, 0, 1), glm::vec4(0.6f, 0, 0, 1), glm::vec2(0.25f, 0.0f)}};
+    for (auto &vertex : vertices) {
+        vertex.tangent = glm::vec3(0.5f, 0.0f, 0.0f);
+        vertex.bitangent = glm::vec3(0.0f, 1.0f, 0.0f);
+    }
+    std::vector<unsigned int> indices = {0, 1, 2};
+    Mesh unpacked(vertices, indices, shader, nullptr);
+    Mesh packed(vertices, indices, shader, nullptr, true);
+    EXPECT_FALSE(unpacked.is_packed());
+    EXPECT_TRUE(packed.is_packed());
+
+    while (glGetError() != GL_NO_ERROR) {
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, 64, 64);
+    glDisable(GL_DEPTH_TEST);
+    unsigned char results[2][4] = {};
+    Mesh *meshes[2] = {&unpacked, &packed};
+    for (int i = 0; i < 2; ++i) {
+        glClear(GL_COLOR_BUFFER_BIT);
+        meshes[i]->bind();
+        shader->set_int("u_PackedVertex", meshes[i]->is_packed() ? 1 : 0);
+        meshes[i]->render();
+        meshes[i]->unbind();
+        glReadPixels(8, 8, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, results[i]);
+    }
+    EXPECT_EQ(glGetError(), static_cast<GLenum>(GL_NO_ERROR));
+    for (int c = 0; c < 4; ++c)
+        EXPECT_NEAR(results[0][c], results[1][c], 1) << "channel " << c;
+    EXPECT_EQ(results[0][0], 255);
+    glEnable(GL_DEPTH_TEST);
+}
+
+TEST_F(MeshTest, CreateTypedMesh) {
+    const char *vert = R"(
+#version 410 core
+layout(location = 0) in vec3 a_Position;
+void main() { gl_Position = vec4(a_Position, 1.0); }
+    )";
+    const char *frag = R"(
+#version 410 core
+out vec4 FragColor;
+void main() { FragColor = vec4(1.0); }
+    )";
+    auto shader = std::make_shared<renderer::Shader>(vert, frag);
+    std::vector<PositionVertex> vertices = {
+        {glm::vec3(-1.0f, 0.0f, 0.0f)}, {glm::vec3(1.0f, 0.0f, 0.0f)}, {glm::vec3(0.0f, 2.0f, 0.0f)}};
+    auto mesh = Mesh::create(vertices, {0, 1, 2}, shader);
+    ASSERT_NE(mesh->get_vertex_array(), nullptr);
+    EXPECT_EQ(mesh->get_index_count(), 3u);
+    EXPECT_FALSE(mesh->is_packed());
+    EXPECT_TRUE(mesh->get_vertices().empty());
+    EXPECT_EQ(mesh->get_bounding_box().min, glm::vec3(-1.0f, 0.0f, 0.0f));
+    EXPECT_EQ(mesh->get_bounding_box().max, glm::vec3(1.0f, 2.0f, 0.0f));
+    const auto &layout = mesh->get_vertex_array()->get_vertex_buffers()[0]->get_layout();
+    EXPECT_EQ(layout.get_stride(), sizeof(PositionVertex));
+
+    auto pool = std::make_shared<renderer::GeometryPool>(renderer::make_vertex_layout<PositionVertex>());
+    auto pooled = Mesh::create(vertices, {0, 1, 2}, shader, pool);
+    EXPECT_TRUE(pooled->is_pooled());
+    auto packed = Mesh::create(Mesh::pack_vertices({Vertex(), Vertex(), Vertex()}), {0, 1, 2}, shader);
+    EXPECT_TRUE(packed->is_packed());
+}
+
+TEST_F(MeshTest, DepthStreamIsPositionOnly) {
+    const char *vert = R"(
+#version 410 core
+layout(location = 0) in vec3 a_Position;
+void main() { gl_Position = vec4(a_Position, 1.0); }
+    )";
+    const char *frag = R"(
+#version 410 core
+out vec4 FragColor;
+void main() { FragColor = vec4(1.0); }
+    )";
+    auto shader = std::make_shared<renderer::Shader>(vert, frag);
+    auto mesh = Mesh::create_cube(shader);
+    EXPECT_FALSE(mesh->has_depth_stream());
+    EXPECT_EQ(mesh->get_depth_vertex_array(), mesh->get_vertex_array());
+    ASSERT_TRUE(mesh->create_depth_stream());
+    EXPECT_TRUE(mesh->has_depth_stream());
+    auto depth_vertex_array = mesh->get_depth_vertex_array();
+    ASSERT_NE(depth_vertex_array, mesh->get_vertex_array());
+    ASSERT_EQ(depth_vertex_array->get_vertex_buffers().size(), 1u);
+    EXPECT_EQ(depth_vertex_array->get_vertex_buffers()[0]->get_layout().get_stride(), sizeof(PositionVertex));
+    EXPECT_EQ(depth_vertex_array->get_index_buffer(), mesh->get_vertex_array()->get_index_buffer());
+
+    while (glGetError() != GL_NO_ERROR) {
+    }
+    shader->bind();
+    depth_vertex_array->bind();
+    mesh->render_depth();
+    depth_vertex_array->unbind();
+    shader->unbind();
+    EXPECT_EQ(glGetError(), static_cast<GLenum>(GL_NO_ERROR));
+}
+
+TEST_F(MeshTest, DepthStreamForPooledAndTypedMeshes) {
+    const char *vert = R"(
+#version 410 core
+layout(location = 0) in vec3 a_Position;
+void main() { gl_Position = vec4(a_Position, 1.0); }
+    )";
+    const char *frag = R"(
+#version 410 core
+out vec4 FragColor;
+void main() { FragColor = vec4(1.0); }
+    )";
+    auto shader = std::make_shared<renderer::Shader>(vert, frag);
+    auto pool = std::make_shared<renderer::GeometryPool>(Mesh::get_vertex_layout());
+    std::vector<Vertex> vertices(3);
+    auto first = std::make_shared<Mesh>(vertices, std::vector<unsigned int>{0, 1, 2}, shader, pool);
+    auto second = std::make_shared<Mesh>(vertices, std::vector<unsigned int>{0, 1, 2}, shader, pool);
+    ASSERT_TRUE(second->is_pooled());
+    ASSERT_TRUE(second->create_depth_stream());
+    // Pooled indices are relative to the page, the depth stream needs its own
+    EXPECT_NE(second->get_depth_vertex_array()->get_index_buffer(),
+              second->get_vertex_array()->get_index_buffer());
+
+    std::vector<PositionVertex> positions = {
+        {glm::vec3(0.0f)}, {glm::vec3(1.0f, 0.0f, 0.0f)}, {glm::vec3(0.0f, 1.0f, 0.0f)}};
+    auto typed = Mesh::create(positions, {0, 1, 2}, shader);
+    EXPECT_FALSE(typed->create_depth_stream());
+    typed->create_depth_stream({glm::vec3(0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f)});
+    EXPECT_TRUE(typed->has_depth_stream());
+}
+
+TEST_F(MeshTest, SmallMeshesUseShortIndices) {
+    const char *vert = R"(
+#version 410 core
+layout(location = 0) in vec3 a_Position;
+void main() { gl_Position = vec4(a_Position, 1.0); }
+    )";
+    const char *frag = R"(
+#version 410 core
+out vec4 FragColor;
+void main() { FragColor = vec4(1.0); }
+    )";
+    auto shader = std::make_shared<renderer::Shader>(vert, frag);
+    auto mesh = Mesh::create_sphere(shader);
+    EXPECT_EQ(mesh->get_index_type(), static_cast<unsigned int>(GL_UNSIGNED_SHORT));
+    EXPECT_EQ(mesh->get_vertex_array()->get_index_buffer()->get_index_size(), 2u);
+
+    std::vector<Vertex> vertices(70000);
+    auto large = std::make_shared<Mesh>(vertices, std::vector<unsigned int>{0, 1, 69999}, shader);
+    EXPECT_EQ(large->get_index_type(), static_cast<unsigned int>(GL_UNSIGNED_INT));
+
+    // Pooled meshes share the 32-bit index buffer of their page
+    auto pool = std::make_shared<renderer::GeometryPool>(Mesh::get_vertex_layout());
+    auto pooled = std::make_shared<Mesh>(std::vector<Vertex>(3), std::vector<unsigned int>{0, 1, 2}, shader, pool);
+    EXPECT_EQ(pooled->get_vertex_array()->get_index_buffer()->get_index_type(),
+              static_cast<unsigned int>(GL_UNSIGNED_INT));
+
+    while (glGetError() != GL_NO_ERROR) {
+    }
+    mesh->bind();
+    mesh->render();
+    mesh->unbind();
+    EXPECT_EQ(glGetError(), static_cast<GLenum>(GL_NO_ERROR));
+}
+
+TEST_F(MeshTest, BuildMeshletsReordersIndices) {
+    const char *vert = R"(
+#version 410 core
+layout(location = 0) in vec3 a_Position;
+void main() { gl_Position = vec4(a_Position, 1.0); }
+    )";
+    const char *frag = R"(
+#version 410 core
+out vec4 FragColor;
+void main() { FragColor = vec4(1.0); }
+    )";
+    auto shader = std::make_shared<renderer::Shader>(vert, frag);
+    auto mesh = Mesh::create_sphere(shader);
+    EXPECT_FALSE(mesh->has_meshlets());
+    ASSERT_TRUE(mesh->build_meshlets());
+    EXPECT_TRUE(mesh->has_meshlets());
+    unsigned int triangles = 0;
+    for (const auto &meshlet : mesh->get_meshlets())
+        triangles += meshlet.triangle_count;
+    EXPECT_EQ(triangles, mesh->get_index_count() / 3);
+
+    std::vector<unsigned short> uploaded(mesh->get_index_count());
+    glBindBuffer(GL_COPY_READ_BUFFER, mesh->get_vertex_array()->get_index_buffer()->get_id());
+    glGetBufferSubData(GL_COPY_READ_BUFFER, 0, uploaded.size() * sizeof(unsigned short), uploaded.data());
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    EXPECT_TRUE(std::equal(uploaded.begin(), uploaded.end(), mesh->get_indices().begin()));
+
+    auto typed = Mesh::create(std::vector<PositionVertex>(3), {0, 1, 2}, shader);
+    EXPECT_FALSE(typed->build_meshlets());
+
+    while (glGetError() != GL_NO_ERROR) {
+    }
+    mesh->bind();
+    mesh->render_ranges({{0, 6}, {12, mesh->get_index_count() - 12}});
+    mesh->unbind();
+    EXPECT_EQ(glGetError(), static_cast<GLenum>(GL_NO_ERROR));
+}
+
+TEST_F(MeshTest, MoveConstructionTakesGeometry) {
+    std::vector<Vertex> vertices = {Vertex(glm::vec3(0.0f)), Vertex(glm::vec3(1.0f, 0.0f, 0.0f)),
+                                    Vertex(glm::vec3(0.0f, 1.0f, 0.0f))};
+    std::vector<unsigned int> indices = {0, 1, 2};
+    const Vertex *vertex_data = vertices.data();
+    Mesh mesh(std::move(vertices), std::move(indices), nullptr);
+    // The buffers were moved, not copied
+    EXPECT_EQ(mesh.get_vertices().data(), vertex_data);
+    EXPECT_EQ(mesh.get_index_count(), 3u);
+    EXPECT_EQ(mesh.get_indices().size(), 3u);
+    EXPECT_EQ(mesh.get_bounding_box().max, glm::vec3(1.0f, 1.0f, 0.0f));
+}
+
+TEST_F(MeshTest, IdsAreNeverReused) {
+    std::vector<Vertex> vertices = {Vertex(glm::vec3(0.0f)), Vertex(glm::vec3(1.0f, 0.0f, 0.0f)),
+                                    Vertex(glm::vec3(0.0f, 1.0f, 0.0f))};
+    std::vector<unsigned int> indices = {0, 1, 2};
+    auto first = std::make_shared<Mesh>(vertices, indices, nullptr);
+    uint64_t first_uid = first->get_uid();
+    first.reset();
+    // The new mesh may well take the freed address, it still gets a new id
+    auto second = std::make_shared<Mesh>(vertices, indices, nullptr);
+    EXPECT_NE(second->get_uid(), first_uid);
+    EXPECT_GT(Mesh::create_quad(nullptr)->get_uid(), second->get_uid());
+}
+
+TEST_F(MeshTest, ResidencyDropsCpuGeometry) {
+    auto mesh = Mesh::create_sphere(nullptr);
+    size_t vertex_count = mesh->get_vertices().size();
+    size_t index_count = mesh->get_indices().size();
+    std::vector<Vertex> original = mesh->get_vertices();
+    EXPECT_EQ(mesh->get_residency(), GeometryResidency::Keep);
+    size_t full = mesh->get_cpu_memory_usage();
+    EXPECT_GE(full, vertex_count * sizeof(Vertex) + index_count * sizeof(unsigned int));
+    EXPECT_TRUE(mesh->get_bvh().empty());
+
+    ASSERT_TRUE(mesh->set_residency(GeometryResidency::Compressed));
+    EXPECT_TRUE(mesh->get_vertices().empty());
+    EXPECT_EQ(mesh->get_indices().size(), index_count);
+    EXPECT_LT(mesh->get_cpu_memory_usage(), full);
+    // Positions are still there to build meshlets from
+    EXPECT_TRUE(mesh->build_meshlets());
+
+    ASSERT_TRUE(mesh->set_residency(GeometryResidency::Keep));
+    ASSERT_EQ(mesh->get_vertices().size(), vertex_count);
+    EXPECT_EQ(mesh->get_vertices()[7].position, original[7].position);
+    EXPECT_NEAR(glm::dot(mesh->get_vertices()[7].normal, original[7].normal), 1.0f, 1e-3f);
+
+    ASSERT_TRUE(mesh->set_residency(GeometryResidency::Release));
+    EXPECT_FALSE(mesh->has_vert_data());
+    EXPECT_TRUE(mesh->get_indices().empty());
+    EXPECT_EQ(mesh->get_index_count(), index_count);
+    EXPECT_EQ(mesh->get_cpu_memory_usage(), mesh->get_bvh().get_memory_usage());
+    EXPECT_FALSE(mesh->set_residency(GeometryResidency::Keep));
+    EXPECT_FALSE(mesh->build_bvh());
+
+    // Picking works without the CPU geometry
+    RayHit hit;
+    ASSERT_TRUE(mesh->raycast(glm::vec3(0.0f, 0.0f, 5.0f), glm::vec3(0.0f, 0.0f, -1.0f), hit));
+    EXPECT_NEAR(hit.distance, 4.5f, 0.01f);
+    EXPECT_GT(mesh->get_bounding_sphere().radius, 0.0f);
+}
+
 TEST_F(MeshTest, CreateCubeDefault) {
     const char *vert = R"(
 #version 410 core
@@ -0,0 +1,149 @@
+#include "lmgl/scene/meshlet.hpp"
+#include <gtest/gtest.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <array>
+#include <set>
+#include <vector>
+
+namespace lmgl {
+
+namespace scene {
+
+class MeshletTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        // Meshlet tests are CPU-only, no OpenGL needed
+        // Flat grid in the XY plane, counter-clockwise when seen from +Z
+        const unsigned int size = 40;
+        for (unsigned int y = 0; y <= size; ++y) {
+            for (unsigned int x = 0; x <= size; ++x)
+                positions.push_back(glm::vec3(static_cast<float>(x) - 20.0f, static_cast<float>(y) - 20.0f, 0.0f));
+        }
+        for (unsigned int y = 0; y < size; ++y) {
+            for (unsigned int x = 0; x < size; ++x) {
+                unsigned int i0 = y * (size + 1) + x;
+                unsigned int i1 = i0 + 1;
+                unsigned int i2 = i0 + size + 1;
+                unsigned int i3 = i2 + 1;
+                indices.insert(indices.end(), {i0, i1, i2, i1, i3, i2});
+            }
+        }
+    }
+
+    static std::multiset<std::array<unsigned int, 3>> triangles(const std::vector<unsigned int> &list) {
+        std::multiset<std::array<unsigned int, 3>> result;
+        for (size_t i = 0; i + 2 < list.size(); i += 3) {
+            std::array<unsigned int, 3> triangle = {list[i], list[i + 1], list[i + 2]};
+            std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+            result.insert(triangle);
+        }
+        return result;
+    }
+
+    std::vector<Meshlet> build(unsigned int max_vertices = 64, unsigned int max_triangles = 124) {
+        return build_meshlets(indices, positions.data(), static_cast<unsigned int>(positions.size()),
+                              sizeof(glm::vec3), max_vertices, max_triangles);
+    }
+
+    std::vector<glm::vec3> positions;
+    std::vector<unsigned int> indices;
+};
+
+TEST_F(MeshletTest, BuildMeshletsRespectsLimits) {
+    auto original = triangles(indices);
+    auto meshlets = build();
+    ASSERT_FALSE(meshlets.empty());
+    EXPECT_EQ(triangles(indices), original);
+    unsigned int next_index = 0;
+    for (const auto &meshlet : meshlets) {
+        EXPECT_EQ(meshlet.first_index, next_index);
+        EXPECT_LE(meshlet.vertex_count, 64u);
+        EXPECT_LE(meshlet.triangle_count, 124u);
+        std::set<unsigned int> vertices(indices.begin() + meshlet.first_index,
+                                        indices.begin() + meshlet.first_index + meshlet.triangle_count * 3);
+        EXPECT_EQ(vertices.size(), meshlet.vertex_count);
+        next_index += meshlet.triangle_count * 3;
+    }
+    EXPECT_EQ(next_index, indices.size());
+    // Greedy growth should fill most meshlets: 3200 triangles need at least 26 of them
+    EXPECT_LT(meshlets.size(), 60u);
+}
+
+TEST_F(MeshletTest, MeshletBoundsContainVertices) {
+    auto meshlets = build(32, 32);
+    for (const auto &meshlet : meshlets) {
+        for (unsigned int i = 0; i < meshlet.triangle_count * 3; ++i) {
+            const glm::vec3 &p = positions[indices[meshlet.first_index + i]];
+            EXPECT_LE(glm::length(p - meshlet.bounds.center), meshlet.bounds.radius + 1e-4f);
+        }
+    }
+}
+
+TEST_F(MeshletTest, FlatMeshletConeCullsFromBehind) {
+    auto meshlets = build();
+    const auto &meshlet = meshlets.front();
+    EXPECT_NEAR(meshlet.cone_axis.z, 1.0f, 1e-5f);
+    EXPECT_NEAR(meshlet.cone_cutoff, 0.0f, 1e-3f);
+    EXPECT_TRUE(is_meshlet_backfacing(meshlet, glm::vec3(0.0f, 0.0f, -10.0f)));
+    EXPECT_FALSE(is_meshlet_backfacing(meshlet, glm::vec3(0.0f, 0.0f, 10.0f)));
+}
+
+TEST_F(MeshletTest, OpposingNormalsNeverCull) {
+    std::vector<glm::vec3> points = {glm::vec3(0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f)};
+    std::vector<unsigned int> both_sides = {0, 1, 2, 0, 2, 1};
+    auto meshlets = build_meshlets(both_sides, points.data(), 3, sizeof(glm::vec3));
+    ASSERT_EQ(meshlets.size(), 1u);
+    EXPECT_FLOAT_EQ(meshlets[0].cone_cutoff, 1.0f);
+    EXPECT_FALSE(is_meshlet_backfacing(meshlets[0], glm::vec3(0.0f, 0.0f, -10.0f)));
+    EXPECT_FALSE(is_meshlet_backfacing(meshlets[0], glm::vec3(0.0f, 0.0f, 10.0f)));
+}
+
+TEST_F(MeshletTest, CullMeshletsKeepsVisibleRanges) {
+    auto meshlets = build();
+    unsigned int total = static_cast<unsigned int>(indices.size() / 3);
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 1.0f, 0.1f, 100.0f);
+    glm::vec3 eye(0.0f, 0.0f, 5.0f);
+    Frustum frustum;
+    frustum.update(projection * glm::lookAt(eye, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+    std::vector<MeshletRange> ranges;
+    unsigned int visible = cull_meshlets(meshlets, frustum, glm::mat4(1.0f), eye, true, ranges);
+    EXPECT_GT(visible, 0u);
+    EXPECT_LT(visible, total / 2);
+    unsigned int range_indices = 0;
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        range_indices += ranges[i].index_count;
+        // Adjacent ranges are merged
+        if (i > 0)
+            EXPECT_NE(ranges[i - 1].first_index + ranges[i - 1].index_count, ranges[i].first_index);
+    }
+    EXPECT_EQ(range_indices, visible * 3);
+
+    // Seen from behind, every meshlet is back-facing
+    glm::vec3 behind(0.0f, 0.0f, -5.0f);
+    frustum.update(projection * glm::lookAt(behind, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+    EXPECT_EQ(cull_meshlets(meshlets, frustum, glm::mat4(1.0f), behind, true, ranges), 0u);
+    EXPECT_TRUE(ranges.empty());
+    EXPECT_GT(cull_meshlets(meshlets, frustum, glm::mat4(1.0f), behind, false, ranges), 0u);
+}
+
+TEST_F(MeshletTest, CullMeshletsUsesModelTransform) {
+    auto meshlets = build();
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 1.0f, 0.1f, 100.0f);
+    glm::vec3 eye(0.0f, 0.0f, 5.0f);
+    Frustum frustum;
+    frustum.update(projection * glm::lookAt(eye, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+    std::vector<MeshletRange> ranges;
+    // Rotated half a turn around Y the grid faces away from the camera
+    glm::mat4 flipped = glm::rotate(glm::mat4(1.0f), glm::radians(180.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    EXPECT_EQ(cull_meshlets(meshlets, frustum, flipped, eye, true, ranges), 0u);
+    // Moved far to the side it leaves the frustum
+    glm::mat4 moved = glm::translate(glm::mat4(1.0f), glm::vec3(200.0f, 0.0f, 0.0f));
+    EXPECT_EQ(cull_meshlets(meshlets, frustum, moved, eye, false, ranges), 0u);
+}
+
+} // namespace scene
+
+} // namespace lmgl
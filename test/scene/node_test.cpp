@@ -30,6 +30,7 @@ TEST_F(NodeTest, DefaultConstruction) {
     EXPECT_EQ(node->get_scale(), glm::vec3(1.0f));
     EXPECT_EQ(node->get_local_transform(), glm::mat4(1.0f));
     EXPECT_EQ(node->get_world_transform(), glm::mat4(1.0f));
+    EXPECT_FALSE(node->is_static());
 }
 
 TEST_F(NodeTest, SetPosition) {
@@ -174,6 +175,42 @@ TEST_F(NodeTest, RenameNode) {
     EXPECT_EQ(node->get_name(), "NewName");
 }
 
+TEST_F(NodeTest, CloneCopiesHierarchy) {
+    auto root = std::make_shared<Node>("Root");
+    root->set_position(glm::vec3(1.0f, 2.0f, 3.0f));
+    root->set_scale(2.0f);
+    auto child = std::make_shared<Node>("Child");
+    child->set_light(std::make_shared<Light>(LightType::Spot));
+    child->set_static(true);
+    root->add_child(child);
+    auto grandchild = std::make_shared<Node>("Grandchild");
+    grandchild->set_rotation(glm::vec3(0.0f, 90.0f, 0.0f));
+    child->add_child(grandchild);
+
+    auto copy = root->clone();
+    EXPECT_NE(copy, root);
+    EXPECT_EQ(copy->get_parent(), nullptr);
+    EXPECT_EQ(copy->get_name(), "Root");
+    EXPECT_EQ(copy->get_position(), root->get_position());
+    EXPECT_EQ(copy->get_local_transform(), root->get_local_transform());
+    ASSERT_EQ(copy->get_children().size(), 1u);
+    auto copied_child = copy->get_children()[0];
+    EXPECT_NE(copied_child, child);
+    EXPECT_EQ(copied_child->get_parent(), copy);
+    EXPECT_TRUE(copied_child->is_static());
+    // Lights are per instance
+    ASSERT_NE(copied_child->get_light(), nullptr);
+    EXPECT_NE(copied_child->get_light(), child->get_light());
+    EXPECT_EQ(copied_child->get_light()->get_type(), LightType::Spot);
+    ASSERT_EQ(copied_child->get_children().size(), 1u);
+    EXPECT_EQ(copied_child->get_children()[0]->get_local_transform(), grandchild->get_local_transform());
+
+    // Moving the copy leaves the original in place
+    copy->set_position(glm::vec3(0.0f));
+    EXPECT_EQ(root->get_position(), glm::vec3(1.0f, 2.0f, 3.0f));
+    EXPECT_EQ(root->get_children().size(), 1u);
+}
+
 } // namespace scene
 
 } // namespace lmgl